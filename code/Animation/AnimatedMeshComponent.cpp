@@ -200,6 +200,13 @@ void AnimatedMeshComponent::update(const world::UpdateParams& update)
 	mesh::MeshComponent::update(update);
 }
 
+bool AnimatedMeshComponent::getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const
+{
+	// Skeleton is synchronized, ie pending pose evaluation is completed, before skinning.
+	outWrites.insert(&type_of< SkeletonComponent >());
+	return true;
+}
+
 void AnimatedMeshComponent::build(const world::WorldBuildContext& context, const world::WorldRenderView& worldRenderView, const world::IWorldRenderPass& worldRenderPass)
 {
 	const Scalar interval(worldRenderView.getInterval());
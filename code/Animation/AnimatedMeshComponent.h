@@ -74,6 +74,8 @@ public:
 
 	virtual void update(const world::UpdateParams& update) override final;
 
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const override final;
+
 	virtual void build(const world::WorldBuildContext& context, const world::WorldRenderView& worldRenderView, const world::IWorldRenderPass& worldRenderPass) override final;
 
 	/*! Get skin transform of joint in delta space. */
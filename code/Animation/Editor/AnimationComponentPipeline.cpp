@@ -49,6 +49,11 @@ bool AnimationComponentPipeline::shouldCache() const
 	return false;
 }
 
+bool AnimationComponentPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 bool AnimationComponentPipeline::buildDependencies(
 	editor::IPipelineDepends* pipelineDepends,
 	const db::Instance* sourceInstance,
@@ -26,6 +26,11 @@ TypeInfoSet PoseControllerPipeline::getAssetTypes() const
 	>();
 }
 
+bool PoseControllerPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 bool PoseControllerPipeline::buildDependencies(
 	editor::IPipelineDepends* pipelineDepends,
 	const db::Instance* sourceInstance,
@@ -31,6 +31,8 @@ class T_DLLCLASS PoseControllerPipeline : public editor::DefaultPipeline
 public:
 	virtual TypeInfoSet getAssetTypes() const override final;
 
+	virtual bool isThreadSafe() const override final;
+
 	virtual bool buildDependencies(
 		editor::IPipelineDepends* pipelineDepends,
 		const db::Instance* sourceInstance,
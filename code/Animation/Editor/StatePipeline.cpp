@@ -28,6 +28,11 @@ TypeInfoSet StatePipeline::getAssetTypes() const
 	>();
 }
 
+bool StatePipeline::isThreadSafe() const
+{
+	return true;
+}
+
 bool StatePipeline::buildDependencies(
 	editor::IPipelineDepends* pipelineDepends,
 	const db::Instance* sourceInstance,
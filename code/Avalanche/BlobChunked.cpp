@@ -0,0 +1,334 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cstring>
+#include "Avalanche/BlobChunked.h"
+#include "Avalanche/Chunker.h"
+#include "Avalanche/ChunkStore.h"
+#include "Core/Io/DynamicMemoryStream.h"
+#include "Core/Io/FileSystem.h"
+#include "Core/Io/MemoryStream.h"
+
+namespace traktor::avalanche
+{
+	namespace
+	{
+
+const uint32_t c_manifestMagic = 0x314d4354;	//!< "TCM1"
+
+#pragma pack(1)
+struct ManifestHeader
+{
+	uint32_t magic;
+	uint32_t chunkCount;
+	int64_t size;
+};
+#pragma pack()
+
+/*! Read blob by reading each chunk in sequence.
+ *
+ * Chunks are referenced while stream is open so they're not
+ * removed if blob is replaced or removed during read.
+ */
+class ChunkedStream : public IStream
+{
+public:
+	explicit ChunkedStream(ChunkStore* store, const AlignedVector< BlobChunked::ChunkRef >& chunks, int64_t size)
+	:	m_store(store)
+	,	m_chunks(chunks)
+	,	m_size(size)
+	{
+		for (uint32_t i = 0; i < (uint32_t)m_chunks.size(); ++i)
+		{
+			if (!m_store->acquire(m_chunks[i].key))
+			{
+				// Blob has already been released; stream is unreadable.
+				m_chunks.resize(i);
+				releaseChunks();
+				m_broken = true;
+				break;
+			}
+		}
+	}
+
+	virtual ~ChunkedStream()
+	{
+		close();
+	}
+
+	virtual void close() override final
+	{
+		if (m_chunk)
+		{
+			m_chunk->close();
+			m_chunk = nullptr;
+		}
+		releaseChunks();
+	}
+
+	virtual bool canRead() const override final { return true; }
+
+	virtual bool canWrite() const override final { return false; }
+
+	virtual bool canSeek() const override final { return false; }
+
+	virtual int64_t tell() const override final { return m_position; }
+
+	virtual int64_t available() const override final { return m_size - m_position; }
+
+	virtual int64_t seek(SeekOriginType origin, int64_t offset) override final { return -1; }
+
+	virtual int64_t read(void* block, int64_t nbytes) override final
+	{
+		if (m_broken)
+			return -1;
+
+		uint8_t* ptr = (uint8_t*)block;
+		int64_t nread = 0;
+
+		while (nread < nbytes)
+		{
+			if (!m_chunk)
+			{
+				if (m_index >= (uint32_t)m_chunks.size())
+					break;
+
+				m_chunk = m_store->read(m_chunks[m_index].key);
+				if (!m_chunk)
+					return -1;
+			}
+
+			const int64_t n = m_chunk->read(ptr + nread, nbytes - nread);
+			if (n < 0)
+				return -1;
+			else if (n == 0)
+			{
+				m_chunk->close();
+				m_chunk = nullptr;
+				m_index++;
+				continue;
+			}
+
+			nread += n;
+			m_position += n;
+		}
+
+		return nread;
+	}
+
+	virtual int64_t write(const void* block, int64_t nbytes) override final { return -1; }
+
+	virtual void flush() override final {}
+
+private:
+	Ref< ChunkStore > m_store;
+	AlignedVector< BlobChunked::ChunkRef > m_chunks;
+	Ref< IStream > m_chunk;
+	uint32_t m_index = 0;
+	int64_t m_size = 0;
+	int64_t m_position = 0;
+	bool m_broken = false;
+
+	void releaseChunks()
+	{
+		for (const auto& chunk : m_chunks)
+			m_store->release(chunk.key);
+		m_chunks.resize(0);
+		m_index = 0;
+	}
+};
+
+	}
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.avalanche.BlobChunked", BlobChunked, IBlob)
+
+BlobChunked::BlobChunked(ChunkStore* store, const Path& path, const DateTime& lastAccessed)
+:	m_store(store)
+,	m_path(path)
+,	m_lastAccessed(lastAccessed)
+{
+}
+
+BlobChunked::~BlobChunked()
+{
+	FileSystem::getInstance().modify(m_path, nullptr, &m_lastAccessed, nullptr);
+}
+
+bool BlobChunked::create(IStream* source)
+{
+	AlignedVector< uint8_t > buffer;
+	buffer.resize(2 * Chunker::c_maxSize);
+	int64_t buffered = 0;
+	bool eos = false;
+
+	T_ASSERT(m_chunks.empty());
+
+	// Split source into chunks, each chunk is added to store as soon as it's found.
+	while (!eos || buffered > 0)
+	{
+		while (!eos && buffered < (int64_t)buffer.size())
+		{
+			const int64_t nread = source->read(buffer.ptr() + buffered, (int64_t)buffer.size() - buffered);
+			if (nread < 0)
+			{
+				release();
+				return false;
+			}
+			else if (nread == 0)
+				eos = true;
+			buffered += nread;
+		}
+
+		int64_t offset = 0;
+		while (offset < buffered)
+		{
+			const int64_t chunkSize = Chunker::boundary(buffer.c_ptr() + offset, buffered - offset, eos);
+			if (chunkSize <= 0)
+				break;
+
+			const Key chunkKey = Chunker::hash(buffer.c_ptr() + offset, chunkSize);
+			if (!m_store->put(chunkKey, buffer.c_ptr() + offset, chunkSize))
+			{
+				release();
+				return false;
+			}
+
+			m_chunks.push_back({ chunkKey, chunkSize });
+			m_size += chunkSize;
+			offset += chunkSize;
+		}
+
+		std::memmove(buffer.ptr(), buffer.c_ptr() + offset, (size_t)(buffered - offset));
+		buffered -= offset;
+	}
+
+	// Write manifest to temporary file and move into place.
+	const Path tmpPath = m_path.getPathName() + L".tmp";
+
+	Ref< IStream > file = FileSystem::getInstance().open(tmpPath, File::FmWrite);
+	if (!file)
+	{
+		release();
+		return false;
+	}
+
+	AlignedVector< uint8_t > manifest;
+	DynamicMemoryStream ms(manifest, false, true);
+
+	const ManifestHeader header = { c_manifestMagic, (uint32_t)m_chunks.size(), m_size };
+	ms.write(&header, sizeof(header));
+	for (const auto& chunk : m_chunks)
+	{
+		const uint32_t chunkSize = (uint32_t)chunk.size;
+		chunk.key.write(&ms);
+		ms.write(&chunkSize, sizeof(chunkSize));
+	}
+
+	const bool result = (file->write(manifest.c_ptr(), (int64_t)manifest.size()) == (int64_t)manifest.size());
+
+	file->close();
+	file = nullptr;
+
+	if (!result || !FileSystem::getInstance().move(m_path, tmpPath, true))
+	{
+		FileSystem::getInstance().remove(tmpPath);
+		release();
+		return false;
+	}
+
+	return true;
+}
+
+bool BlobChunked::load()
+{
+	Ref< IStream > file = FileSystem::getInstance().open(m_path, File::FmRead);
+	if (!file)
+		return false;
+
+	AlignedVector< uint8_t > manifest((size_t)file->available());
+	if (file->read(manifest.ptr(), (int64_t)manifest.size()) != (int64_t)manifest.size())
+		return false;
+
+	file->close();
+	file = nullptr;
+
+	MemoryStream ms(manifest.c_ptr(), (int64_t)manifest.size());
+
+	ManifestHeader header;
+	if (ms.read(&header, sizeof(header)) != sizeof(header) || header.magic != c_manifestMagic)
+		return false;
+
+	// Reference all chunks; fail if any chunk is missing.
+	for (uint32_t i = 0; i < header.chunkCount; ++i)
+	{
+		const Key chunkKey = Key::read(&ms);
+		uint32_t chunkSize = 0;
+		if (!chunkKey.valid() || ms.read(&chunkSize, sizeof(chunkSize)) != sizeof(chunkSize) || !m_store->acquire(chunkKey))
+		{
+			release();
+			return false;
+		}
+		m_chunks.push_back({ chunkKey, (int64_t)chunkSize });
+		m_size += chunkSize;
+	}
+
+	if (m_size != header.size)
+	{
+		release();
+		return false;
+	}
+
+	return true;
+}
+
+void BlobChunked::release()
+{
+	for (const auto& chunk : m_chunks)
+		m_store->release(chunk.key);
+	m_chunks.clear();
+	m_size = 0;
+}
+
+int64_t BlobChunked::size() const
+{
+	return m_size;
+}
+
+Ref< IStream > BlobChunked::append()
+{
+	// Chunked blobs are immutable.
+	return nullptr;
+}
+
+Ref< IStream > BlobChunked::read() const
+{
+	m_lastAccessed = DateTime::now();
+	return new ChunkedStream(m_store, m_chunks, m_size);
+}
+
+bool BlobChunked::remove()
+{
+	if (!FileSystem::getInstance().remove(m_path))
+		return false;
+
+	release();
+	return true;
+}
+
+bool BlobChunked::touch()
+{
+	m_lastAccessed = DateTime::now();
+	return true;
+}
+
+DateTime BlobChunked::lastAccessed() const
+{
+	return m_lastAccessed;
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Avalanche/IBlob.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Io/Path.h"
+#include "Core/Misc/Key.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_AVALANCHE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::avalanche
+{
+
+class ChunkStore;
+
+/*! Blob stored as a list of chunks.
+ * \ingroup Avalanche
+ *
+ * Blob content is split into content defined chunks, which
+ * are stored in a chunk store shared by all blobs, and only
+ * a manifest with the list of chunks is stored per blob.
+ */
+class T_DLLCLASS BlobChunked : public IBlob
+{
+	T_RTTI_CLASS;
+
+public:
+	struct ChunkRef
+	{
+		Key key;
+		int64_t size;
+	};
+
+	explicit BlobChunked(ChunkStore* store, const Path& path, const DateTime& lastAccessed);
+
+	virtual ~BlobChunked();
+
+	/*! Split source into chunks, store chunks and write manifest. */
+	bool create(IStream* source);
+
+	/*! Read existing manifest and reference it's chunks. */
+	bool load();
+
+	/*! Release chunk references without removing manifest, ie. when manifest has been replaced. */
+	void release();
+
+	virtual int64_t size() const override final;
+
+	virtual Ref< IStream > append() override final;
+
+	virtual Ref< IStream > read() const override final;
+
+	virtual bool remove() override final;
+
+	virtual bool touch() override final;
+
+	virtual DateTime lastAccessed() const override final;
+
+	const AlignedVector< ChunkRef >& getChunks() const { return m_chunks; }
+
+private:
+	Ref< ChunkStore > m_store;
+	Path m_path;
+	AlignedVector< ChunkRef > m_chunks;
+	int64_t m_size = 0;
+	mutable DateTime m_lastAccessed;
+};
+
+}
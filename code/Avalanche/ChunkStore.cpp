@@ -0,0 +1,217 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <unordered_map>
+#include "Avalanche/ChunkStore.h"
+#include "Core/Io/FileSystem.h"
+#include "Core/Io/IStream.h"
+#include "Core/Log/Log.h"
+#include "Core/Misc/String.h"
+#include "Core/Thread/Acquire.h"
+#include "Core/Thread/Semaphore.h"
+
+namespace traktor::avalanche
+{
+	namespace
+	{
+
+struct KeyHash
+{
+	size_t operator () (const Key& key) const
+	{
+		return (size_t)key.hash();
+	}
+};
+
+	}
+
+struct ChunkStore::Shard
+{
+	struct Chunk
+	{
+		int64_t size = 0;
+		int32_t references = 0;
+	};
+
+	Semaphore lock;
+	std::unordered_map< Key, Chunk, KeyHash > chunks;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.avalanche.ChunkStore", ChunkStore, Object)
+
+ChunkStore::ChunkStore()
+{
+	for (uint32_t i = 0; i < c_shardCount; ++i)
+		m_shards.push_back(new Shard());
+}
+
+ChunkStore::~ChunkStore()
+{
+	for (auto shard : m_shards)
+		delete shard;
+	m_shards.clear();
+}
+
+bool ChunkStore::create(const Path& chunksPath)
+{
+	m_chunksPath = chunksPath;
+
+	// Chunks are spread over sub folders, named by first two characters of key, to keep folders small.
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		const Path folderPath = m_chunksPath.getPathName() + L"/" + str(L"%02x", i);
+		if (!FileSystem::getInstance().makeAllDirectories(folderPath))
+		{
+			log::error << L"Unable to create chunk store; failed to create folder \"" << folderPath.getPathName() << L"\"." << Endl;
+			return false;
+		}
+
+		RefArray< File > chunkFiles = FileSystem::getInstance().find(folderPath.getPathName() + L"/*.chunk");
+		for (auto chunkFile : chunkFiles)
+		{
+			const Key chunkKey = Key::parse(chunkFile->getPath().getFileNameNoExtension());
+			if (!chunkKey.valid())
+				continue;
+
+			auto& chunk = shard(chunkKey).chunks[chunkKey];
+			chunk.size = chunkFile->getSize();
+			chunk.references = 0;
+
+			m_chunkCount++;
+			m_size += chunk.size;
+		}
+	}
+
+	return true;
+}
+
+bool ChunkStore::put(const Key& chunkKey, const void* data, int64_t size)
+{
+	Shard& s = shard(chunkKey);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+	auto it = s.chunks.find(chunkKey);
+	if (it != s.chunks.end())
+	{
+		it->second.references++;
+		return true;
+	}
+
+	// Write to temporary file and move into place, never leave a partial chunk.
+	const Path chunkPath = getChunkPath(chunkKey);
+	const Path tmpPath = chunkPath.getPathName() + L".tmp";
+
+	Ref< IStream > file = FileSystem::getInstance().open(tmpPath, File::FmWrite);
+	if (!file)
+		return false;
+
+	bool result = (file->write(data, size) == size);
+
+	file->close();
+	file = nullptr;
+
+	if (result)
+		result = FileSystem::getInstance().move(chunkPath, tmpPath, true);
+
+	if (!result)
+	{
+		FileSystem::getInstance().remove(tmpPath);
+		return false;
+	}
+
+	auto& chunk = s.chunks[chunkKey];
+	chunk.size = size;
+	chunk.references = 1;
+
+	m_chunkCount++;
+	m_size += size;
+	return true;
+}
+
+bool ChunkStore::acquire(const Key& chunkKey)
+{
+	Shard& s = shard(chunkKey);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+	auto it = s.chunks.find(chunkKey);
+	if (it == s.chunks.end())
+		return false;
+
+	it->second.references++;
+	return true;
+}
+
+void ChunkStore::release(const Key& chunkKey)
+{
+	Shard& s = shard(chunkKey);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+	auto it = s.chunks.find(chunkKey);
+	if (it == s.chunks.end())
+		return;
+
+	if (--it->second.references > 0)
+		return;
+
+	FileSystem::getInstance().remove(getChunkPath(chunkKey));
+
+	m_chunkCount--;
+	m_size -= it->second.size;
+
+	s.chunks.erase(it);
+}
+
+uint32_t ChunkStore::purge()
+{
+	uint32_t removed = 0;
+	for (auto shard : m_shards)
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(shard->lock);
+		for (auto it = shard->chunks.begin(); it != shard->chunks.end(); )
+		{
+			if (it->second.references <= 0)
+			{
+				FileSystem::getInstance().remove(getChunkPath(it->first));
+
+				m_chunkCount--;
+				m_size -= it->second.size;
+
+				it = shard->chunks.erase(it);
+				++removed;
+			}
+			else
+				++it;
+		}
+	}
+	return removed;
+}
+
+Ref< IStream > ChunkStore::read(const Key& chunkKey) const
+{
+	Shard& s = shard(chunkKey);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+	if (s.chunks.find(chunkKey) == s.chunks.end())
+		return nullptr;
+
+	// Open while holding lock so chunk cannot be removed before it's opened.
+	return FileSystem::getInstance().open(getChunkPath(chunkKey), File::FmRead);
+}
+
+ChunkStore::Shard& ChunkStore::shard(const Key& chunkKey) const
+{
+	return *m_shards[(chunkKey.hash() >> 16) % c_shardCount];
+}
+
+Path ChunkStore::getChunkPath(const Key& chunkKey) const
+{
+	const std::wstring name = chunkKey.format();
+	return m_chunksPath.getPathName() + L"/" + name.substr(0, 2) + L"/" + name + L".chunk";
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <atomic>
+#include "Core/Object.h"
+#include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Io/Path.h"
+#include "Core/Misc/Key.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_AVALANCHE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor
+{
+
+class IStream;
+
+}
+
+namespace traktor::avalanche
+{
+
+/*! Reference counted store of content addressed chunks.
+ * \ingroup Avalanche
+ *
+ * Each chunk is stored once, in a file named by it's key,
+ * no matter how many blobs reference it. A chunk is removed
+ * when last reference is released.
+ */
+class T_DLLCLASS ChunkStore : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	ChunkStore();
+
+	virtual ~ChunkStore();
+
+	/*! Create store, existing chunks are registered without any references. */
+	bool create(const Path& chunksPath);
+
+	/*! Store chunk, or reference existing chunk with same key. */
+	bool put(const Key& chunkKey, const void* data, int64_t size);
+
+	/*! Reference existing chunk.
+	 *
+	 * \return False if chunk doesn't exist.
+	 */
+	bool acquire(const Key& chunkKey);
+
+	/*! Release chunk reference, chunk is removed when no longer referenced. */
+	void release(const Key& chunkKey);
+
+	/*! Remove all chunks without references, ie. left from an interrupted put.
+	 *
+	 * \return Number of removed chunks.
+	 */
+	uint32_t purge();
+
+	/*! Open chunk for reading.
+	 *
+	 * \return Chunk data stream, null if chunk doesn't exist.
+	 */
+	Ref< IStream > read(const Key& chunkKey) const;
+
+	uint32_t getChunkCount() const { return m_chunkCount; }
+
+	/*! Get size of all chunks, in bytes. */
+	uint64_t getSize() const { return m_size; }
+
+private:
+	struct Shard;
+
+	constexpr static uint32_t c_shardCount = 16;
+
+	Path m_chunksPath;
+	AlignedVector< Shard* > m_shards;
+	std::atomic< uint32_t > m_chunkCount = 0;
+	std::atomic< uint64_t > m_size = 0;
+
+	Shard& shard(const Key& chunkKey) const;
+
+	Path getChunkPath(const Key& chunkKey) const;
+};
+
+}
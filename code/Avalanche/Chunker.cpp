@@ -0,0 +1,84 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Avalanche/Chunker.h"
+#include "Core/Misc/MD5.h"
+
+namespace traktor::avalanche
+{
+	namespace
+	{
+
+/*! Table of random values for gear hash; generated from fixed seed so it's identical everywhere. */
+struct GearTable
+{
+	uint64_t values[256];
+
+	GearTable()
+	{
+		uint64_t x = 0x5452414b544f5221ULL;
+		for (int32_t i = 0; i < 256; ++i)
+		{
+			uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			values[i] = z ^ (z >> 31);
+		}
+	}
+};
+
+const GearTable c_gear;
+
+// Top bits of hash depend on last 64 bytes; stricter mask before average size
+// and looser after normalize chunk sizes around average.
+const uint64_t c_maskStrict = ~0ULL << (64 - 18);
+const uint64_t c_maskLoose = ~0ULL << (64 - 14);
+
+	}
+
+int64_t Chunker::boundary(const uint8_t* data, int64_t size, bool final)
+{
+	if (size <= c_minSize)
+		return final ? size : 0;
+
+	const int64_t end = std::min(size, c_maxSize);
+	const int64_t average = std::min(end, c_averageSize);
+	uint64_t h = 0;
+	int64_t i = c_minSize;
+
+	for (; i < average; ++i)
+	{
+		h = (h << 1) + c_gear.values[data[i]];
+		if ((h & c_maskStrict) == 0)
+			return i + 1;
+	}
+	for (; i < end; ++i)
+	{
+		h = (h << 1) + c_gear.values[data[i]];
+		if ((h & c_maskLoose) == 0)
+			return i + 1;
+	}
+
+	if (end >= c_maxSize || final)
+		return end;
+	else
+		return 0;
+}
+
+Key Chunker::hash(const void* data, int64_t size)
+{
+	MD5 md5;
+	md5.begin();
+	md5.feedBuffer(data, (uint64_t)size);
+	md5.end();
+	const uint32_t* kv = md5.get();
+	return Key(kv[0], kv[1], kv[2], kv[3]);
+}
+
+}
@@ -0,0 +1,56 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/Config.h"
+#include "Core/Misc/Key.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_AVALANCHE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::avalanche
+{
+
+/*! Content defined chunking.
+ * \ingroup Avalanche
+ *
+ * Chunk boundaries are found using a rolling (gear) hash over
+ * content thus an insertion or removal only affect chunks near
+ * the modification, remaining chunks are identical and can be
+ * shared between similar blobs.
+ *
+ * Both client and server must use same chunking in order
+ * for chunks to match.
+ */
+class T_DLLCLASS Chunker
+{
+public:
+	constexpr static int64_t c_minSize = 16 * 1024;
+	constexpr static int64_t c_averageSize = 64 * 1024;
+	constexpr static int64_t c_maxSize = 256 * 1024;
+
+	/*! Find end of first chunk in data.
+	 *
+	 * \param data Data beginning at a chunk boundary.
+	 * \param size Size of data in bytes.
+	 * \param final True if no more data follows, thus last chunk ends at end of data.
+	 * \return Size of chunk, 0 if more data is required to determine boundary.
+	 */
+	static int64_t boundary(const uint8_t* data, int64_t size, bool final);
+
+	/*! Calculate key identifying chunk by content. */
+	static Key hash(const void* data, int64_t size);
+};
+
+}
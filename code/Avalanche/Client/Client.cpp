@@ -6,6 +6,7 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include "Core/Io/DynamicMemoryStream.h"
 #include "Core/Log/Log.h"
 #include "Core/Thread/Acquire.h"
 #include "Avalanche/Protocol.h"
@@ -53,40 +54,64 @@ bool Client::ping()
 
 bool Client::have(const Key& key)
 {
-	Ref< net::SocketStream > stream  = establish(c_commandStat);
-	if (!stream)
-		return false;
-
-	if (!key.write(stream))
-	{
-		log::error << L"Unable to write key to server (have)." << Endl;
-		return false;
-	}
+	int64_t blobSize = -1;
+	return stat(key, blobSize) && blobSize >= 0;
+}
 
-	uint8_t reply = 0;
-	if (stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t))
-	{
-		log::error << L"Unable to read reply from server (have)." << Endl;
-		return false;
-	}
+bool Client::statMany(const AlignedVector< Key >& keys, AlignedVector< int64_t >& outBlobSizes)
+{
+	outBlobSizes.resize(keys.size(), -1);
+	if (keys.empty())
+		return true;
 
-	if (reply == c_replyOk)
+	if (m_batchSupported)
 	{
-		int64_t blobSize = 0;
-		if (stream->read(&blobSize, sizeof(int64_t)) != sizeof(int64_t))
+		Ref< net::SocketStream > stream = establishMany(c_commandStatMany, keys);
+		if (stream)
 		{
-			log::error << L"Unable to read blob size from server (have)." << Endl;
-			return false;
+			for (uint32_t i = 0; i < (uint32_t)keys.size(); ++i)
+			{
+				uint8_t reply = 0;
+				if (stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t))
+				{
+					if (i == 0 && !batchSupported())
+						break;
+					log::error << L"Unable to read reply from server (stat many)." << Endl;
+					return false;
+				}
+
+				if (reply == c_replyOk)
+				{
+					if (stream->read(&outBlobSizes[i], sizeof(int64_t)) != sizeof(int64_t))
+					{
+						log::error << L"Unable to read blob size from server (stat many)." << Endl;
+						return false;
+					}
+				}
+				else if (reply == c_replyFailure)
+					outBlobSizes[i] = -1;
+				else
+					return false;
+			}
+
+			if (m_batchSupported)
+			{
+				T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+				m_streams.push_back(stream);
+				return true;
+			}
 		}
+		else
+			return false;
 	}
 
-	if (reply == c_replyOk || reply == c_replyFailure)
+	// Server doesn't support batches; stat each key.
+	for (uint32_t i = 0; i < (uint32_t)keys.size(); ++i)
 	{
-		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
-		m_streams.push_back(stream);
+		if (!stat(keys[i], outBlobSizes[i]))
+			return false;
 	}
-
-	return reply == c_replyOk;
+	return true;
 }
 
 bool Client::touch(const AlignedVector< Key >& keys)
@@ -206,36 +231,83 @@ Ref< IStream > Client::get(const Key& key)
 	return new ClientGetStream(this, stream, blobSize);
 }
 
-Ref< IStream > Client::put(const Key& key)
+bool Client::getMany(const AlignedVector< Key >& keys, const std::function< void (uint32_t, IStream*) >& received)
 {
-	Ref< net::SocketStream > stream = establish(c_commandPut);
-	if (!stream)
-		return nullptr;
+	if (keys.empty())
+		return true;
 
-	if (!key.write(stream))
+	if (m_batchSupported)
 	{
-		log::error << L"Unable to write key to server (put)." << Endl;
-		return nullptr;
+		Ref< net::SocketStream > stream = establishMany(c_commandGetMany, keys);
+		if (stream)
+		{
+			for (uint32_t i = 0; i < (uint32_t)keys.size(); ++i)
+			{
+				uint8_t reply = 0;
+				if (stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t))
+				{
+					if (i == 0 && !batchSupported())
+						break;
+					log::error << L"Unable to read reply from server (get many)." << Endl;
+					return false;
+				}
+
+				if (reply == c_replyOk)
+				{
+					int64_t blobSize = 0;
+					if (stream->read(&blobSize, sizeof(int64_t)) != sizeof(int64_t))
+					{
+						log::error << L"Unable to read blob size from server (get many)." << Endl;
+						return false;
+					}
+
+					// Blob stream doesn't release connection, ensure entire blob has been read before next reply.
+					Ref< ClientGetStream > blobStream = new ClientGetStream(nullptr, stream, blobSize);
+					received(i, blobStream);
+					blobStream->close();
+					if (blobStream->available() > 0)
+					{
+						log::error << L"Unable to read blob from server (get many)." << Endl;
+						return false;
+					}
+				}
+				else if (reply == c_replyFailure)
+					received(i, nullptr);
+				else
+					return false;
+			}
+
+			if (m_batchSupported)
+			{
+				T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+				m_streams.push_back(stream);
+				return true;
+			}
+		}
+		else
+			return false;
 	}
 
-	uint8_t reply = 0;
-	if (stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t))
+	// Server doesn't support batches; get each key.
+	for (uint32_t i = 0; i < (uint32_t)keys.size(); ++i)
 	{
-		log::error << L"Unable to read reply from server (put)." << Endl;
-		return nullptr;
+		Ref< IStream > blobStream = get(keys[i]);
+		received(i, blobStream);
+		if (blobStream)
+			blobStream->close();
 	}
+	return true;
+}
 
-	if (reply != c_replyOk)
-	{
-		if (reply == c_replyFailure)
-		{
-			T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
-			m_streams.push_back(stream);
-		}
+Ref< IStream > Client::put(const Key& key)
+{
+	const bool chunked = chunksSupported();
+
+	Ref< net::SocketStream > stream = establishPut(key);
+	if (!stream)
 		return nullptr;
-	}
 
-	return new ClientPutStream(this, stream);
+	return new ClientPutStream(this, stream, chunked);
 }
 
 bool Client::stats(Dictionary::Stats& outStats)
@@ -256,6 +328,43 @@ bool Client::stats(Dictionary::Stats& outStats)
 	return true;
 }
 
+bool Client::tierStats(Dictionary::Stats& outStats)
+{
+	if (!stats(outStats))
+		return false;
+
+	Ref< net::SocketStream > stream = establish(c_commandStatsTiers);
+	if (!stream)
+		return false;
+
+	uint64_t tiers[13];
+	if (stream->read(tiers, sizeof(tiers)) != sizeof(tiers))
+	{
+		log::error << L"Unable to read reply from server (stats tiers)." << Endl;
+		return false;
+	}
+
+	outStats.memoryTier.blobCount = (uint32_t)tiers[0];
+	outStats.memoryTier.size = tiers[1];
+	outStats.memoryTier.hits = tiers[2];
+	outStats.diskTier.blobCount = (uint32_t)tiers[3];
+	outStats.diskTier.size = tiers[4];
+	outStats.diskTier.hits = tiers[5];
+	outStats.misses = tiers[6];
+	outStats.promotions = tiers[7];
+	outStats.demotions = tiers[8];
+	outStats.evictions = tiers[9];
+	outStats.chunkCount = (uint32_t)tiers[10];
+	outStats.chunkSize = tiers[11];
+	outStats.chunkedSize = tiers[12];
+
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		m_streams.push_back(stream);
+	}
+	return true;
+}
+
 bool Client::getKeys(AlignedVector< Key >& outKeys)
 {
 	Ref< net::SocketStream > stream = establish(c_commandKeys);
@@ -281,6 +390,118 @@ bool Client::getKeys(AlignedVector< Key >& outKeys)
 	return true;
 }
 
+bool Client::stat(const Key& key, int64_t& outBlobSize)
+{
+	outBlobSize = -1;
+
+	Ref< net::SocketStream > stream  = establish(c_commandStat);
+	if (!stream)
+		return false;
+
+	if (!key.write(stream))
+	{
+		log::error << L"Unable to write key to server (stat)." << Endl;
+		return false;
+	}
+
+	uint8_t reply = 0;
+	if (stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t))
+	{
+		log::error << L"Unable to read reply from server (stat)." << Endl;
+		return false;
+	}
+
+	if (reply == c_replyOk)
+	{
+		if (stream->read(&outBlobSize, sizeof(int64_t)) != sizeof(int64_t))
+		{
+			log::error << L"Unable to read blob size from server (stat)." << Endl;
+			return false;
+		}
+	}
+
+	if (reply == c_replyOk || reply == c_replyFailure)
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		m_streams.push_back(stream);
+	}
+
+	return reply == c_replyOk || reply == c_replyFailure;
+}
+
+Ref< net::SocketStream > Client::establishMany(uint8_t command, const AlignedVector< Key >& keys)
+{
+	Ref< net::SocketStream > stream = establish(command);
+	if (!stream)
+		return nullptr;
+
+	// Write all keys at once, not to send each key separately.
+	AlignedVector< uint8_t > request;
+	DynamicMemoryStream dms(request, false, true);
+	const uint32_t nkeys = (uint32_t)keys.size();
+	dms.write(&nkeys, sizeof(uint32_t));
+	for (const auto& key : keys)
+		key.write(&dms);
+
+	if (stream->write(request.c_ptr(), (int64_t)request.size()) != (int64_t)request.size())
+	{
+		log::error << L"Unable to write keys to server." << Endl;
+		return nullptr;
+	}
+
+	return stream;
+}
+
+bool Client::batchSupported()
+{
+	// Previous server versions terminate connection on unknown commands;
+	// if server still respond to ping we assume batches are not supported.
+	if (ping())
+	{
+		log::warning << L"Avalanche server doesn't support batched requests; using single key requests." << Endl;
+		m_batchSupported = false;
+	}
+	return m_batchSupported;
+}
+
+bool Client::chunksSupported()
+{
+	if (m_chunksSupported >= 0)
+		return m_chunksSupported != 0;
+
+	Ref< net::SocketStream > stream = establish(c_commandVersion);
+	if (!stream)
+		return false;
+
+	uint8_t reply = 0;
+	int32_t version[2] = { 0, 0 };
+	if (
+		stream->read(&reply, sizeof(uint8_t)) == sizeof(uint8_t) &&
+		reply == c_replyOk &&
+		stream->read(version, sizeof(version)) == sizeof(version)
+	)
+	{
+		{
+			T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+			m_streams.push_back(stream);
+		}
+		m_chunksSupported = (version[0] > 7 || (version[0] == 7 && version[1] >= 3)) ? 1 : 0;
+	}
+	else
+	{
+		// Previous server versions terminate connection on unknown commands;
+		// if server still respond to ping it doesn't support chunks, else try again on next put.
+		if (!ping())
+			return false;
+		m_chunksSupported = 0;
+	}
+
+	if (!m_chunksSupported)
+		log::warning << L"Avalanche server doesn't support chunked uploads; uploading entire blobs." << Endl;
+
+	return m_chunksSupported != 0;
+}
+
 Ref< net::SocketStream > Client::establish(uint8_t command)
 {
 	for (;;)
@@ -306,6 +527,9 @@ Ref< net::SocketStream > Client::establish(uint8_t command)
 		return nullptr;
 	}
 
+	// Requests are written in several small pieces; don't wait for acknowledge of each piece.
+	socket->setNoDelay(true);
+
 	Ref< net::SocketStream > stream = new net::SocketStream(socket, true, true, 5000);
 	if (stream->write(&command, sizeof(uint8_t)) != sizeof(uint8_t))
 	{
@@ -316,4 +540,36 @@ Ref< net::SocketStream > Client::establish(uint8_t command)
 	return stream;
 }
 
+Ref< net::SocketStream > Client::establishPut(const Key& key)
+{
+	Ref< net::SocketStream > stream = establish(c_commandPut);
+	if (!stream)
+		return nullptr;
+
+	if (!key.write(stream))
+	{
+		log::error << L"Unable to write key to server (put)." << Endl;
+		return nullptr;
+	}
+
+	uint8_t reply = 0;
+	if (stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t))
+	{
+		log::error << L"Unable to read reply from server (put)." << Endl;
+		return nullptr;
+	}
+
+	if (reply != c_replyOk)
+	{
+		if (reply == c_replyFailure)
+		{
+			T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+			m_streams.push_back(stream);
+		}
+		return nullptr;
+	}
+
+	return stream;
+}
+
 }
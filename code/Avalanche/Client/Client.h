@@ -8,6 +8,8 @@
  */
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include "Avalanche/Dictionary.h"
 #include "Core/Object.h"
 #include "Core/Ref.h"
@@ -46,16 +48,45 @@ public:
 
 	bool have(const Key& key);
 
+	/*! Get size of multiple blobs in a single request.
+	 *
+	 * \param keys Blob keys.
+	 * \param outBlobSizes Size of each blob, -1 if blob doesn't exist.
+	 * \return True if request succeeded.
+	 */
+	bool statMany(const AlignedVector< Key >& keys, AlignedVector< int64_t >& outBlobSizes);
+
 	bool touch(const AlignedVector< Key >& keys);
 
 	bool evict(const AlignedVector< Key >& keys);
 
 	Ref< IStream > get(const Key& key);
 
+	/*! Get multiple blobs in a single request.
+	 *
+	 * Callback is called in key order with a stream of each
+	 * blob, or null if blob doesn't exist. Stream is only valid
+	 * until callback returns.
+	 *
+	 * \param keys Blob keys.
+	 * \param received Callback receiving each blob.
+	 * \return True if request succeeded.
+	 */
+	bool getMany(const AlignedVector< Key >& keys, const std::function< void (uint32_t, IStream*) >& received);
+
+	/*! Put blob.
+	 *
+	 * Blob is split into content defined chunks and only chunks
+	 * which server doesn't already have are uploaded, unless server
+	 * is older than protocol 7.3 in which case entire blob is uploaded.
+	 */
 	Ref< IStream > put(const Key& key);
 
 	bool stats(Dictionary::Stats& outStats);
 
+	/*! Get stats including per tier and chunk statistics, requires protocol 7.3. */
+	bool tierStats(Dictionary::Stats& outStats);
+
 	bool getKeys(AlignedVector< Key >& outKeys);
 
 	const net::SocketAddressIPv4& getServerAddress() const { return m_serverAddress; }
@@ -67,8 +98,21 @@ private:
 	net::SocketAddressIPv4 m_serverAddress;
 	RefArray< net::SocketStream > m_streams;
 	Semaphore m_lock;
+	std::atomic< bool > m_batchSupported = true;
+	std::atomic< int32_t > m_chunksSupported = -1;	//!< -1 until negotiated with server.
+
+	bool stat(const Key& key, int64_t& outBlobSize);
+
+	bool batchSupported();
+
+	/*! Check if server support chunked uploads, negotiated with server on first call. */
+	bool chunksSupported();
 
 	Ref< net::SocketStream > establish(uint8_t command);
+
+	Ref< net::SocketStream > establishMany(uint8_t command, const AlignedVector< Key >& keys);
+
+	Ref< net::SocketStream > establishPut(const Key& key);
 };
 
 }
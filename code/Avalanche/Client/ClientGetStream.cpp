@@ -40,8 +40,8 @@ void ClientGetStream::close()
 		}
 	}
 	
-	// Return socket to be reused.
-	if (m_stream)
+	// Return socket to be reused, unless part of batch.
+	if (m_stream && m_client)
 	{
 		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_client->m_lock);
 		m_client->m_streams.push_back(m_stream);
@@ -6,22 +6,32 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include "Avalanche/Chunker.h"
 #include "Avalanche/Protocol.h"
 #include "Avalanche/Client/Client.h"
 #include "Avalanche/Client/ClientPutStream.h"
+#include "Core/Io/DynamicMemoryStream.h"
 #include "Core/Io/Reader.h"
 #include "Core/Io/Writer.h"
+#include "Core/Log/Log.h"
 #include "Core/Thread/Acquire.h"
 #include "Net/SocketStream.h"
 
 namespace traktor::avalanche
 {
+	namespace
+	{
+
+const int64_t c_flushSize = 2 * 1024 * 1024;	//!< Buffered size before chunks are sent.
+
+	}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.avalanche.ClientPutStream", ClientPutStream, IStream)
 
-ClientPutStream::ClientPutStream(Client* client, net::SocketStream* stream)
+ClientPutStream::ClientPutStream(Client* client, net::SocketStream* stream, bool chunked)
 :	m_client(client)
 ,	m_stream(stream)
+,	m_chunked(chunked)
 {
 }
 
@@ -30,6 +40,13 @@ void ClientPutStream::close()
 	if (!m_stream)
 		return;
 
+	// Send remaining buffered data, last chunk ends at end of blob.
+	if (m_chunked && !putChunks(true))
+	{
+		m_stream = nullptr;
+		return;
+	}
+
 	const uint8_t cmd = c_subCommandPutCommit;
 	if (m_stream->write(&cmd, sizeof(uint8_t)) != sizeof(uint8_t))
 	{
@@ -96,28 +113,113 @@ int64_t ClientPutStream::write(const void* block, int64_t nbytes)
 	if (nbytes <= 0)
 		return 0;
 
-	const uint8_t cmd = c_subCommandPutAppend;
-	if (m_stream->write(&cmd, sizeof(uint8_t)) != sizeof(uint8_t))
+	if (m_chunked)
 	{
-		m_stream = nullptr;
-		return -1;
+		// Buffer data until there is enough to find chunk boundaries.
+		m_buffer.insert(m_buffer.end(), (const uint8_t*)block, (const uint8_t*)block + nbytes);
+		if ((int64_t)m_buffer.size() >= c_flushSize && !putChunks(false))
+		{
+			m_stream = nullptr;
+			return -1;
+		}
+		return nbytes;
 	}
-	if (m_stream->write(&nbytes, sizeof(int64_t)) != sizeof(int64_t))
+
+	if (!putAppend(block, nbytes))
 	{
 		m_stream = nullptr;
 		return -1;
 	}
+
+	return nbytes;
+}
+
+void ClientPutStream::flush()
+{
+}
+
+bool ClientPutStream::putAppend(const void* block, int64_t nbytes)
+{
+	const uint8_t cmd = c_subCommandPutAppend;
+	if (m_stream->write(&cmd, sizeof(uint8_t)) != sizeof(uint8_t))
+		return false;
+	if (m_stream->write(&nbytes, sizeof(int64_t)) != sizeof(int64_t))
+		return false;
 	if (m_stream->write(block, nbytes) != nbytes)
+		return false;
+	return true;
+}
+
+bool ClientPutStream::putChunks(bool final)
+{
+	// Split buffered data into chunks, data after last boundary is kept until more data is written.
+	AlignedVector< int64_t > offsets;
+	offsets.push_back(0);
+	for (;;)
 	{
-		m_stream = nullptr;
-		return -1;
+		const int64_t offset = offsets.back();
+		const int64_t remaining = (int64_t)m_buffer.size() - offset;
+		const int64_t size = remaining > 0 ? Chunker::boundary(m_buffer.c_ptr() + offset, remaining, final) : 0;
+		if (size > 0)
+			offsets.push_back(offset + size);
+
+		if (offsets.size() > c_maxPutChunks || (size <= 0 && offsets.size() > 1))
+		{
+			if (!putChunkBatch(offsets))
+				return false;
+
+			offsets.resize(0);
+			offsets.push_back(offset + size);
+		}
+
+		if (size <= 0)
+			break;
 	}
 
-	return nbytes;
+	m_buffer.erase(m_buffer.begin(), m_buffer.begin() + (size_t)offsets.back());
+	return true;
 }
 
-void ClientPutStream::flush()
+bool ClientPutStream::putChunkBatch(const AlignedVector< int64_t >& offsets)
 {
+	const uint32_t nchunks = (uint32_t)offsets.size() - 1;
+
+	// Write list of chunks at once, not to send each chunk separately.
+	AlignedVector< uint8_t > request;
+	DynamicMemoryStream dms(request, false, true);
+	const uint8_t cmd = c_subCommandPutChunks;
+	dms.write(&cmd, sizeof(uint8_t));
+	dms.write(&nchunks, sizeof(uint32_t));
+	for (uint32_t i = 0; i < nchunks; ++i)
+	{
+		const uint32_t chunkSize = (uint32_t)(offsets[i + 1] - offsets[i]);
+		Chunker::hash(m_buffer.c_ptr() + offsets[i], chunkSize).write(&dms);
+		dms.write(&chunkSize, sizeof(uint32_t));
+	}
+	if (m_stream->write(request.c_ptr(), (int64_t)request.size()) != (int64_t)request.size())
+		return false;
+
+	// Server reply which chunks it need.
+	uint8_t replies[c_maxPutChunks];
+	if (m_stream->read(replies, nchunks) != (int64_t)nchunks)
+	{
+		log::error << L"Unable to read reply from server (put chunks)." << Endl;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < nchunks; ++i)
+	{
+		if (replies[i] == c_replyContinue)
+		{
+			const int64_t chunkSize = offsets[i + 1] - offsets[i];
+			if (m_stream->write(m_buffer.c_ptr() + offsets[i], chunkSize) != chunkSize)
+				return false;
+		}
+		else if (replies[i] != c_replyOk)
+			return false;
+	}
+
+	return true;
 }
 
 }
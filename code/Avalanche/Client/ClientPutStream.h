@@ -9,6 +9,7 @@
 #pragma once
 
 #include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
 #include "Core/Io/IStream.h"
 
 namespace traktor::net
@@ -28,7 +29,7 @@ class ClientPutStream : public IStream
 	T_RTTI_CLASS;
 
 public:
-	explicit ClientPutStream(Client* client, net::SocketStream* stream);
+	explicit ClientPutStream(Client* client, net::SocketStream* stream, bool chunked);
 
 	virtual void close() override final;
 
@@ -53,6 +54,14 @@ public:
 private:
 	Ref< Client > m_client;
 	Ref< net::SocketStream > m_stream;
+	bool m_chunked;
+	AlignedVector< uint8_t > m_buffer;
+
+	bool putAppend(const void* block, int64_t nbytes);
+
+	bool putChunks(bool final);
+
+	bool putChunkBatch(const AlignedVector< int64_t >& offsets);
 };
 
 }
@@ -7,19 +7,110 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include <algorithm>
+#include <unordered_map>
+#include "Avalanche/BlobChunked.h"
 #include "Avalanche/BlobFile.h"
 #include "Avalanche/BlobMemory.h"
+#include "Avalanche/ChunkStore.h"
 #include "Avalanche/Dictionary.h"
+#include "Core/Containers/IntrusiveList.h"
 #include "Core/Io/FileSystem.h"
+#include "Core/Io/IStream.h"
+#include "Core/Io/StreamCopy.h"
 #include "Core/Log/Log.h"
 #include "Core/Thread/Acquire.h"
 
 namespace traktor::avalanche
 {
+	namespace
+	{
+
+const uint32_t c_candidatesPerShard = 8;		//!< Number of least recently used blobs, from each shard, considered when evicting or demoting.
+const uint64_t c_promoteFraction = 16;			//!< Only blobs smaller than this fraction of memory budget are promoted.
+const uint64_t c_promoteWindow = 60 * 60;		//!< Blob is promoted when accessed again within this window, in seconds.
+const double c_lowWatermark = 0.9;				//!< Evict, or demote, until usage is below this fraction of budget.
+
+struct KeyHash
+{
+	size_t operator () (const Key& key) const
+	{
+		return (size_t)key.hash();
+	}
+};
+
+uint64_t now()
+{
+	return DateTime::now().getSecondsSinceEpoch();
+}
+
+	}
+
+struct Dictionary::Entry
+{
+	Key key;
+	Ref< IBlob > memory;	//!< Blob in memory tier, null if not in memory.
+	Ref< IBlob > file;		//!< Blob in disk tier, null if dictionary has no path.
+	int64_t size = 0;
+	uint64_t lastAccessed = 0;	//!< Seconds since epoch.
+	uint64_t sequence = 0;		//!< Order of access, break ties when last accessed at same time.
+
+	// Link in LRU of all blobs.
+	Entry* m_prev = nullptr;
+	Entry* m_next = nullptr;
+
+	// Link in LRU of blobs in memory tier.
+	Entry* m_memoryPrev = nullptr;
+	Entry* m_memoryNext = nullptr;
+};
+
+struct Dictionary::MemoryLink
+{
+	Entry* m_item;
+
+	MemoryLink(Entry* item)
+	:	m_item(item)
+	{
+	}
+
+	Entry*& prev()
+	{
+		return m_item->m_memoryPrev;
+	}
+
+	Entry*& next()
+	{
+		return m_item->m_memoryNext;
+	}
+};
+
+struct Dictionary::Shard
+{
+	Semaphore lock;
+	std::unordered_map< Key, Entry*, KeyHash > entries;
+	IntrusiveList< Entry > lru;
+	IntrusiveList< Entry, MemoryLink > memoryLru;
+};
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.avalanche.Dictionary", Dictionary, Object)
 
-bool Dictionary::create(const Path& blobsPath)
+Dictionary::Dictionary()
+{
+	for (uint32_t i = 0; i < c_shardCount; ++i)
+		m_shards.push_back(new Shard());
+}
+
+Dictionary::~Dictionary()
+{
+	for (auto shard : m_shards)
+	{
+		for (auto it : shard->entries)
+			delete it.second;
+		delete shard;
+	}
+	m_shards.clear();
+}
+
+bool Dictionary::create(const Path& blobsPath, uint64_t memoryBudget, uint64_t diskQuota)
 {
 	if (!blobsPath.empty())
 	{
@@ -28,25 +119,85 @@ bool Dictionary::create(const Path& blobsPath)
 		if (!FileSystem::getInstance().makeAllDirectories(blobsPath))
 			return false;
 
+		m_chunkStore = new ChunkStore();
+		if (!m_chunkStore->create(blobsPath.getPathName() + L"/chunks"))
+			return false;
+
+		// Blobs stored as chunks, and blobs stored as single files by previous versions.
+		RefArray< File > manifestFiles = FileSystem::getInstance().find(blobsPath.getPathName() + L"/*.manifest");
 		RefArray< File > blobFiles = FileSystem::getInstance().find(blobsPath.getPathName() + L"/*.blob");
 
-		log::info << L"Loading " << blobFiles.size() << L" blobs..." << Endl;
-		for (auto blobFile : blobFiles)
+		// All blobs start in disk tier, promoted to memory tier when accessed.
+		auto insert = [&](const Key& blobKey, IBlob* blob, const DateTime& lastAccessed) {
+			Shard& s = shard(blobKey);
+			if (s.entries.find(blobKey) != s.entries.end())
+				return;
+
+			Entry* entry = new Entry();
+			entry->key = blobKey;
+			entry->file = blob;
+			entry->size = blob->size();
+			entry->lastAccessed = lastAccessed.getSecondsSinceEpoch();
+			entry->sequence = m_sequence++;
+
+			s.entries[blobKey] = entry;
+			s.lru.push_back(entry);
+			account(entry, true);
+		};
+
+		log::info << L"Loading " << (manifestFiles.size() + blobFiles.size()) << L" blobs..." << Endl;
+		for (auto file : manifestFiles)
 		{
-			const std::wstring blobFileName = blobFile->getPath().getFileNameNoExtension();
+			const Key blobKey = Key::parse(file->getPath().getFileNameNoExtension());
+			if (!blobKey.valid())
+				continue;
+
+			Ref< BlobChunked > blob = new BlobChunked(m_chunkStore, file->getPath(), file->getLastAccessTime());
+			if (!blob->load())
+			{
+				log::warning << L"Unable to load blob " << blobKey.format() << L"; manifest corrupt or chunk(s) missing." << Endl;
+				FileSystem::getInstance().remove(file->getPath());
+				continue;
+			}
 
-			const Key blobKey = Key::parse(blobFileName);
+			insert(blobKey, blob, file->getLastAccessTime());
+		}
+		for (auto file : blobFiles)
+		{
+			const Key blobKey = Key::parse(file->getPath().getFileNameNoExtension());
 			if (!blobKey.valid())
 				continue;
 
-			Ref< BlobFile > blob = new BlobFile(blobFile->getPath(), blobFile->getSize(), blobFile->getLastAccessTime());
-			m_blobs[blobKey] = blob;
-			m_stats.blobCount++;
-			m_stats.memoryUsage += blob->size();
+			Ref< BlobFile > blob = new BlobFile(file->getPath(), file->getSize(), file->getLastAccessTime());
+			insert(blobKey, blob, file->getLastAccessTime());
+		}
+
+		// Remove chunks no longer referenced by any blob, ie. from an interrupted put.
+		const uint32_t purged = m_chunkStore->purge();
+		if (purged > 0)
+			log::info << L"Removed " << purged << L" unreferenced chunk(s)." << Endl;
+
+		// Loaded unordered; sort each shard's LRU on last access.
+		for (auto shard : m_shards)
+		{
+			AlignedVector< Entry* > entries;
+			entries.reserve(shard->entries.size());
+			while (!shard->lru.empty())
+			{
+				entries.push_back(shard->lru.front());
+				shard->lru.pop_front();
+			}
+			std::sort(entries.begin(), entries.end(), [](const Entry* lh, const Entry* rh) {
+				return lh->lastAccessed > rh->lastAccessed;
+			});
+			for (auto entry : entries)
+				shard->lru.push_back(entry);
 		}
 	}
 
 	m_blobsPath = blobsPath;
+	m_memoryBudget = memoryBudget;
+	m_diskQuota = diskQuota;
 	return true;
 }
 
@@ -58,12 +209,56 @@ Ref< IBlob > Dictionary::create() const
 Ref< IBlob > Dictionary::get(const Key& key, bool raw) const
 {
 	Ref< IBlob > blob;
+	bool promoteBlob = false;
 	{
-		T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lockBlobs);
-		auto it = m_blobs.find(key);
-		if (it == m_blobs.end())
+		Shard& s = shard(key);
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+		auto it = s.entries.find(key);
+		if (it == s.entries.end())
+		{
+			if (!raw)
+				m_misses++;
 			return nullptr;
-		blob = it->second;
+		}
+
+		Entry* entry = it->second;
+		if (!raw)
+		{
+			const uint64_t accessed = now();
+
+			// Promote blobs from disk when accessed again within window, to prevent scans
+			// of the dictionary from thrashing the memory tier.
+			promoteBlob =
+				!entry->memory &&
+				entry->size <= (int64_t)(m_memoryBudget / c_promoteFraction) &&
+				accessed >= entry->lastAccessed &&
+				accessed - entry->lastAccessed <= c_promoteWindow;
+
+			entry->lastAccessed = accessed;
+			entry->sequence = m_sequence++;
+
+			s.lru.remove(entry);
+			s.lru.push_front(entry);
+
+			if (entry->memory)
+			{
+				s.memoryLru.remove(entry);
+				s.memoryLru.push_front(entry);
+				m_memoryHits++;
+			}
+			else
+				m_diskHits++;
+
+			// Keep file's access time current, it's restored from file when loaded.
+			if (entry->file)
+				entry->file->touch();
+		}
+
+		if (entry->memory)
+			blob = entry->memory;
+		else
+			blob = entry->file;
 	}
 	if (!raw)
 	{
@@ -71,31 +266,77 @@ Ref< IBlob > Dictionary::get(const Key& key, bool raw) const
 		for (auto listener : m_listeners)
 			listener->dictionaryGet(key);
 	}
+	if (promoteBlob)
+	{
+		Ref< IBlob > memory = promote(key);
+		if (memory)
+			blob = memory;
+	}
 	return blob;
 }
 
 bool Dictionary::put(const Key& key, IBlob* blob, bool raw)
 {
-	Ref< IBlob > dictionaryBlob;
+	Ref< IBlob > file;
+	Ref< IBlob > memory;
+	Ref< IBlob > replaced;
 
-	// Create dictionary blob.
+	// Write blob through to disk tier, as chunks shared with other blobs.
 	if (!m_blobsPath.empty())
 	{
-		const Path blobPath = m_blobsPath.getPathName() + L"/" + key.format() + L".blob";
-		Ref< BlobFile > bf = new BlobFile(blobPath, blob->size(), DateTime::now());
-		if (!bf->create(blob->read()))
+		const Path manifestPath = m_blobsPath.getPathName() + L"/" + key.format() + L".manifest";
+		Ref< BlobChunked > bc = new BlobChunked(m_chunkStore, manifestPath, DateTime::now());
+		if (!bc->create(blob->read()))
 			return false;
-		dictionaryBlob = bf;
+		file = bc;
 	}
-	else
-		dictionaryBlob = blob;
+
+	// New blobs are hot; keep in memory tier.
+	if (!file || (is_a< BlobMemory >(blob) && (uint64_t)blob->size() <= m_memoryBudget))
+		memory = blob;
 
 	// Store blob into dictionary.
 	{
-		T_ANONYMOUS_VAR(ReaderWriterLock::AcquireWriter)(m_lockBlobs);
-		m_blobs[key] = dictionaryBlob;
-		m_stats.blobCount++;
-		m_stats.memoryUsage += dictionaryBlob->size();
+		Shard& s = shard(key);
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+		Entry* entry = nullptr;
+
+		auto it = s.entries.find(key);
+		if (it != s.entries.end())
+		{
+			entry = it->second;
+			replaced = entry->file;
+			account(entry, false);
+			s.lru.remove(entry);
+			if (entry->memory)
+				s.memoryLru.remove(entry);
+		}
+		else
+		{
+			entry = new Entry();
+			entry->key = key;
+			s.entries[key] = entry;
+		}
+
+		entry->memory = memory;
+		entry->file = file;
+		entry->size = blob->size();
+		entry->lastAccessed = now();
+		entry->sequence = m_sequence++;
+
+		s.lru.push_front(entry);
+		if (entry->memory)
+			s.memoryLru.push_front(entry);
+		account(entry, true);
+
+		// Manifest of replaced blob has already been overwritten, only release it's chunks;
+		// blobs from previous versions are stored in separate files. Chunks are kept until
+		// open streams of replaced blob are closed.
+		if (BlobChunked* rc = dynamic_type_cast< BlobChunked* >(replaced))
+			rc->release();
+		else if (replaced)
+			replaced->remove();
 	}
 
 	// Invoke listeners.
@@ -103,7 +344,7 @@ bool Dictionary::put(const Key& key, IBlob* blob, bool raw)
 	{
 		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lockListeners);
 		for (auto listener : m_listeners)
-			listener->dictionaryPut(key, dictionaryBlob);
+			listener->dictionaryPut(key, file ? (IBlob*)file : memory.ptr());
 	}
 	return true;
 }
@@ -111,21 +352,25 @@ bool Dictionary::put(const Key& key, IBlob* blob, bool raw)
 bool Dictionary::remove(const Key& key)
 {
 	{
-		T_ANONYMOUS_VAR(ReaderWriterLock::AcquireWriter)(m_lockBlobs);
+		Shard& s = shard(key);
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
 
-		auto it = m_blobs.find(key);
-		if (it == m_blobs.end())
+		auto it = s.entries.find(key);
+		if (it == s.entries.end())
 			return false;
 
-		const uint64_t size = it->second->size();
-
-		if (!it->second->remove())
+		Entry* entry = it->second;
+		if (entry->file && !entry->file->remove())
 			return false;
 
-		m_stats.blobCount--;
-		m_stats.memoryUsage -= size;
+		account(entry, false);
 
-		m_blobs.erase(it);
+		s.lru.remove(entry);
+		if (entry->memory)
+			s.memoryLru.remove(entry);
+
+		s.entries.erase(it);
+		delete entry;
 	}
 	{
 		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lockListeners);
@@ -137,10 +382,13 @@ bool Dictionary::remove(const Key& key)
 
 void Dictionary::snapshotKeys(AlignedVector< Key >& outKeys) const
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lockBlobs);
-	outKeys.reserve(m_blobs.size());
-	for (auto it : m_blobs)
-		outKeys.push_back(it.first);
+	outKeys.reserve(m_blobCount);
+	for (auto shard : m_shards)
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(shard->lock);
+		for (auto it : shard->entries)
+			outKeys.push_back(it.first);
+	}
 }
 
 void Dictionary::addListener(IListener* listener)
@@ -158,9 +406,214 @@ void Dictionary::removeListener(IListener* listener)
 
 bool Dictionary::getStats(Stats& outStats) const
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lockBlobs);
-	outStats = m_stats;
+	outStats.blobCount = m_blobCount;
+	outStats.memoryUsage = m_size;
+	outStats.memoryTier.blobCount = m_memoryCount;
+	outStats.memoryTier.size = m_memorySize;
+	outStats.memoryTier.hits = m_memoryHits;
+	outStats.diskTier.blobCount = m_diskCount;
+	outStats.diskTier.size = m_diskSize;
+	outStats.diskTier.hits = m_diskHits;
+	outStats.misses = m_misses;
+	outStats.promotions = m_promotions;
+	outStats.demotions = m_demotions;
+	outStats.evictions = m_evictions;
+	outStats.chunkCount = m_chunkStore ? m_chunkStore->getChunkCount() : 0;
+	outStats.chunkSize = m_chunkStore ? m_chunkStore->getSize() : 0;
+	outStats.chunkedSize = m_chunkedSize;
 	return true;
 }
 
+Ref< IStream > Dictionary::readChunk(const Key& chunkKey) const
+{
+	return m_chunkStore ? m_chunkStore->read(chunkKey) : nullptr;
+}
+
+void Dictionary::balance(bool evict)
+{
+	// Demote cold blobs from memory tier; they're already on disk.
+	if (!m_blobsPath.empty() && m_memorySize > m_memoryBudget)
+	{
+		const uint64_t target = (uint64_t)(m_memoryBudget * c_lowWatermark);
+		while (m_memorySize > target && evictOrDemote(false, target))
+			;
+	}
+
+	// Evict blobs when quota is exceeded; memory budget is quota if memory is the only tier.
+	if (evict)
+	{
+		const uint64_t quota = !m_blobsPath.empty() ? m_diskQuota : m_memoryBudget;
+		if (usage(true) > quota)
+		{
+			const uint64_t target = (uint64_t)(quota * c_lowWatermark);
+			while (usage(true) > target && evictOrDemote(true, target))
+				;
+		}
+	}
+}
+
+Dictionary::Shard& Dictionary::shard(const Key& key) const
+{
+	return *m_shards[(key.hash() >> 16) % c_shardCount];
+}
+
+void Dictionary::account(const Entry* entry, bool add) const
+{
+	const int64_t sign = add ? 1 : -1;
+	m_blobCount += (uint32_t)sign;
+	m_size += (uint64_t)(sign * entry->size);
+	if (entry->memory)
+	{
+		m_memoryCount += (uint32_t)sign;
+		m_memorySize += (uint64_t)(sign * entry->size);
+	}
+	if (entry->file)
+	{
+		m_diskCount += (uint32_t)sign;
+		m_diskSize += (uint64_t)(sign * entry->size);
+		if (is_a< BlobChunked >(entry->file))
+			m_chunkedSize += (uint64_t)(sign * entry->size);
+		else
+			m_unchunkedSize += (uint64_t)(sign * entry->size);
+	}
+}
+
+uint64_t Dictionary::usage(bool evict) const
+{
+	// Chunks shared between blobs are only stored once on disk.
+	if (evict && !m_blobsPath.empty())
+		return m_unchunkedSize + m_chunkStore->getSize();
+	else
+		return m_memorySize;
+}
+
+Ref< IBlob > Dictionary::promote(const Key& key) const
+{
+	Ref< IBlob > file;
+	{
+		Shard& s = shard(key);
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+		auto it = s.entries.find(key);
+		if (it == s.entries.end() || it->second->memory || !it->second->file)
+			return nullptr;
+
+		file = it->second->file;
+	}
+
+	// Read blob into memory without holding lock.
+	Ref< IStream > source = file->read();
+	if (!source)
+		return nullptr;
+
+	Ref< IBlob > memory = new BlobMemory();
+	Ref< IStream > target = memory->append();
+	if (!target || !StreamCopy(target, source).execute())
+		return nullptr;
+
+	target->close();
+	source->close();
+
+	if (memory->size() != file->size())
+		return nullptr;
+
+	{
+		Shard& s = shard(key);
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+		// Ensure blob hasn't been replaced, removed or promoted while reading.
+		auto it = s.entries.find(key);
+		if (it == s.entries.end() || it->second->memory || it->second->file != file)
+			return nullptr;
+
+		Entry* entry = it->second;
+		entry->memory = memory;
+		s.memoryLru.push_front(entry);
+
+		m_memoryCount++;
+		m_memorySize += entry->size;
+		m_promotions++;
+	}
+
+	return memory;
+}
+
+bool Dictionary::evictOrDemote(bool evict, uint64_t target)
+{
+	struct Candidate
+	{
+		Key key;
+		double score;
+		uint64_t sequence;
+	};
+
+	// Gather least recently used blobs from each shard, weighted by size
+	// so a large blob is evicted before several small of same age.
+	AlignedVector< Candidate > candidates;
+	const uint64_t accessed = now();
+	for (auto shard : m_shards)
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(shard->lock);
+
+		uint32_t count = 0;
+		if (evict)
+		{
+			for (Entry* entry = shard->lru.back(); entry != nullptr && count < c_candidatesPerShard; entry = entry->m_prev, ++count)
+			{
+				const double age = (double)(accessed > entry->lastAccessed ? accessed - entry->lastAccessed : 0) + 1.0;
+				candidates.push_back({ entry->key, age * (double)entry->size, entry->sequence });
+			}
+		}
+		else
+		{
+			for (Entry* entry = shard->memoryLru.back(); entry != nullptr && count < c_candidatesPerShard; entry = entry->m_memoryPrev, ++count)
+			{
+				const double age = (double)(accessed > entry->lastAccessed ? accessed - entry->lastAccessed : 0) + 1.0;
+				candidates.push_back({ entry->key, age * (double)entry->size, entry->sequence });
+			}
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& lh, const Candidate& rh) {
+		return lh.score > rh.score || (lh.score == rh.score && lh.sequence < rh.sequence);
+	});
+
+	bool progress = false;
+	for (const auto& candidate : candidates)
+	{
+		if (usage(evict) <= target)
+			break;
+
+		if (evict)
+		{
+			if (remove(candidate.key))
+			{
+				m_evictions++;
+				progress = true;
+			}
+		}
+		else
+		{
+			Shard& s = shard(candidate.key);
+			T_ANONYMOUS_VAR(Acquire< Semaphore >)(s.lock);
+
+			auto it = s.entries.find(candidate.key);
+			if (it == s.entries.end() || !it->second->memory || !it->second->file)
+				continue;
+
+			// Readers still holding on to memory blob keep it alive until they're done.
+			Entry* entry = it->second;
+			entry->memory = nullptr;
+			s.memoryLru.remove(entry);
+
+			m_memoryCount--;
+			m_memorySize -= entry->size;
+			m_demotions++;
+			progress = true;
+		}
+	}
+
+	return progress;
+}
+
 }
@@ -8,12 +8,12 @@
  */
 #pragma once
 
+#include <atomic>
 #include "Core/Object.h"
 #include "Core/Ref.h"
-#include "Core/Containers/SmallMap.h"
+#include "Core/Containers/AlignedVector.h"
 #include "Core/Io/Path.h"
 #include "Core/Misc/Key.h"
-#include "Core/Thread/ReaderWriterLock.h"
 #include "Core/Thread/Semaphore.h"
 
 // import/export mechanism.
@@ -24,11 +24,33 @@
 #	define T_DLLCLASS T_DLLIMPORT
 #endif
 
+namespace traktor
+{
+
+class IStream;
+
+}
+
 namespace traktor::avalanche
 {
 
+class ChunkStore;
 class IBlob;
 
+/*! Tiered blob dictionary.
+ * \ingroup Avalanche
+ *
+ * Blobs are written through to disk, if a path is given, and recently
+ * used blobs are also kept in memory within a memory budget. Cold blobs
+ * are demoted to the disk tier, and when disk quota is exceeded blobs are
+ * evicted using a size weighted LRU policy, i.e. large and old blobs first.
+ *
+ * Blobs on disk are stored as lists of content defined chunks,
+ * each chunk stored once no matter how many blobs contain it.
+ *
+ * Without a path the memory tier is the only tier, and the memory budget
+ * is used as quota for eviction instead.
+ */
 class T_DLLCLASS Dictionary : public Object
 {
 	T_RTTI_CLASS;
@@ -36,8 +58,27 @@ class T_DLLCLASS Dictionary : public Object
 public:
 	struct Stats
 	{
+		struct Tier
+		{
+			uint32_t blobCount = 0;
+			uint64_t size = 0;
+			uint64_t hits = 0;
+		};
+
 		uint32_t blobCount = 0;
-		uint64_t memoryUsage = 0;
+		uint64_t memoryUsage = 0;	//!< Total size of all blobs.
+		Tier memoryTier;
+		Tier diskTier;
+		uint64_t misses = 0;
+		uint64_t promotions = 0;
+		uint64_t demotions = 0;
+		uint64_t evictions = 0;
+		uint32_t chunkCount = 0;
+		uint64_t chunkSize = 0;		//!< Size of unique chunks on disk.
+		uint64_t chunkedSize = 0;	//!< Size of blobs stored as chunks.
+
+		/*! Ratio between size of chunked blobs and size of their unique chunks. */
+		double dedupRatio() const { return chunkSize > 0 ? (double)chunkedSize / chunkSize : 1.0; }
 	};
 
 	struct IListener
@@ -49,7 +90,17 @@ public:
 		virtual void dictionaryRemove(const Key& key) = 0;
 	};
 
-	bool create(const Path& blobsPath);
+	Dictionary();
+
+	virtual ~Dictionary();
+
+	/*! Create dictionary.
+	 *
+	 * \param blobsPath Path to blob files, empty if only kept in memory.
+	 * \param memoryBudget Maximum size, in bytes, of blobs kept in memory.
+	 * \param diskQuota Maximum size, in bytes, of blobs on disk.
+	 */
+	bool create(const Path& blobsPath, uint64_t memoryBudget, uint64_t diskQuota);
 
 	Ref< IBlob > create() const;
 
@@ -67,13 +118,56 @@ public:
 
 	bool getStats(Stats& outStats) const;
 
+	/*! Open chunk, of any blob, for reading.
+	 *
+	 * \return Chunk data stream, null if no such chunk.
+	 */
+	Ref< IStream > readChunk(const Key& chunkKey) const;
+
+	/*! Demote cold blobs, and evict if permitted, until within budget and quota. */
+	void balance(bool evict);
+
 private:
-	mutable ReaderWriterLock m_lockBlobs;
+	struct Entry;
+	struct MemoryLink;
+	struct Shard;
+
+	constexpr static uint32_t c_shardCount = 32;
+
 	mutable Semaphore m_lockListeners;
 	Path m_blobsPath;
-	SmallMap< Key, Ref< IBlob > > m_blobs;
+	uint64_t m_memoryBudget = 0;
+	uint64_t m_diskQuota = 0;
+	Ref< ChunkStore > m_chunkStore;
+	AlignedVector< Shard* > m_shards;
 	AlignedVector< IListener* > m_listeners;
-	Stats m_stats;
+
+	// Counters, read without acquiring shard locks.
+	mutable std::atomic< uint32_t > m_blobCount = 0;
+	mutable std::atomic< uint64_t > m_size = 0;
+	mutable std::atomic< uint32_t > m_memoryCount = 0;
+	mutable std::atomic< uint64_t > m_memorySize = 0;
+	mutable std::atomic< uint32_t > m_diskCount = 0;
+	mutable std::atomic< uint64_t > m_diskSize = 0;
+	mutable std::atomic< uint64_t > m_chunkedSize = 0;
+	mutable std::atomic< uint64_t > m_unchunkedSize = 0;
+	mutable std::atomic< uint64_t > m_memoryHits = 0;
+	mutable std::atomic< uint64_t > m_diskHits = 0;
+	mutable std::atomic< uint64_t > m_misses = 0;
+	mutable std::atomic< uint64_t > m_promotions = 0;
+	mutable std::atomic< uint64_t > m_demotions = 0;
+	mutable std::atomic< uint64_t > m_evictions = 0;
+	mutable std::atomic< uint64_t > m_sequence = 0;
+
+	Shard& shard(const Key& key) const;
+
+	void account(const Entry* entry, bool add) const;
+
+	uint64_t usage(bool evict) const;
+
+	Ref< IBlob > promote(const Key& key) const;
+
+	bool evictOrDemote(bool evict, uint64_t target);
 };
 
 }
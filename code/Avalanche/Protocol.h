@@ -25,9 +25,16 @@ constexpr static uint8_t c_commandStats			= 0x05;
 constexpr static uint8_t c_commandKeys			= 0x06;
 constexpr static uint8_t c_commandTouch			= 0x07;
 constexpr static uint8_t c_commandEvict			= 0x08;
+constexpr static uint8_t c_commandStatMany		= 0x09;		//!< Since 7.1
+constexpr static uint8_t c_commandGetMany		= 0x0a;		//!< Since 7.1
+constexpr static uint8_t c_commandStatsTiers	= 0x0b;		//!< Since 7.2
+constexpr static uint8_t c_commandVersion		= 0x0c;		//!< Since 7.3
 
 constexpr static uint8_t c_subCommandPutAppend	= 0x41;
 constexpr static uint8_t c_subCommandPutCommit	= 0x42;
 constexpr static uint8_t c_subCommandPutDiscard	= 0x43;
+constexpr static uint8_t c_subCommandPutChunks	= 0x44;		//!< Since 7.3
+
+constexpr static uint32_t c_maxPutChunks		= 64;		//!< Maximum number of chunks in a single PUT CHUNKS.
 
 }
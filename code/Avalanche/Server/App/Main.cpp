@@ -104,7 +104,13 @@ void WINAPI serviceMain(DWORD argc, TCHAR* argv[])
 		settings->setProperty< PropertyInteger >(L"Avalanche.Port", port);
 		settings->setProperty< PropertyBoolean >(L"Avalanche.Master", cmdLine.hasOption('m', L"master"));
 		settings->setProperty< PropertyString >(L"Avalanche.Path", cmdLine.getOption('d', L"dictionary-path").getString());
-		settings->setProperty< PropertyInteger >(L"Avalanche.MemoryBudget", cmdLine.getOption('b', L"memory-budget").getInteger());
+		if (cmdLine.hasOption('b', L"memory-budget"))
+			settings->setProperty< PropertyInteger >(L"Avalanche.MemoryBudget", cmdLine.getOption('b', L"memory-budget").getInteger());
+		if (cmdLine.hasOption('q', L"disk-quota"))
+			settings->setProperty< PropertyInteger >(L"Avalanche.DiskQuota", cmdLine.getOption('q', L"disk-quota").getInteger());
+		settings->setProperty< PropertyBoolean >(L"Avalanche.Reactor", cmdLine.hasOption('r', L"reactor"));
+		if (cmdLine.hasOption(L"reactor-threads"))
+			settings->setProperty< PropertyInteger >(L"Avalanche.ReactorThreads", cmdLine.getOption(L"reactor-threads").getInteger());
 
 		if (!net::Network::initialize())
 		{
@@ -276,6 +282,9 @@ int main(int argc, const char** argv)
 		log::info << L"    -p, -port             Port number (default 40001)." << Endl;
 		log::info << L"    -d, -dictionary-path  Path to dictionary blobs." << Endl;
 		log::info << L"    -b, -memory-budget    Memory budget in GiB (default 8)." << Endl;
+		log::info << L"    -q, -disk-quota       Disk quota in GiB (default 64)." << Endl;
+		log::info << L"    -r, -reactor          Serve connections from a few event driven worker threads (Linux only)." << Endl;
+		log::info << L"    -reactor-threads      Number of reactor worker threads (default 4)." << Endl;
 #if defined(_WIN32)
 		log::info << L"    -install-service      Install as NT service." << Endl;
 		log::info << L"    -uninstall-service    Uninstall as NT service." << Endl;
@@ -292,6 +301,8 @@ int main(int argc, const char** argv)
 		std::wstring arguments = str(L"-run-service -p=%d", port);
 		if (cmdLine.hasOption('m', L"master"))
 			arguments += L" -m";
+		if (cmdLine.hasOption('r', L"reactor"))
+			arguments += L" -r";
 
 		if (installService(arguments))
 		{
@@ -367,7 +378,13 @@ int main(int argc, const char** argv)
 	settings->setProperty< PropertyInteger >(L"Avalanche.Port", port);
 	settings->setProperty< PropertyBoolean >(L"Avalanche.Master", cmdLine.hasOption('m', L"master"));
 	settings->setProperty< PropertyString >(L"Avalanche.Path", cmdLine.getOption('d', L"dictionary-path").getString());
-	settings->setProperty< PropertyInteger >(L"Avalanche.MemoryBudget", cmdLine.getOption('b', L"memory-budget").getInteger());
+	if (cmdLine.hasOption('b', L"memory-budget"))
+		settings->setProperty< PropertyInteger >(L"Avalanche.MemoryBudget", cmdLine.getOption('b', L"memory-budget").getInteger());
+	if (cmdLine.hasOption('q', L"disk-quota"))
+		settings->setProperty< PropertyInteger >(L"Avalanche.DiskQuota", cmdLine.getOption('q', L"disk-quota").getInteger());
+	settings->setProperty< PropertyBoolean >(L"Avalanche.Reactor", cmdLine.hasOption('r', L"reactor"));
+	if (cmdLine.hasOption(L"reactor-threads"))
+		settings->setProperty< PropertyInteger >(L"Avalanche.ReactorThreads", cmdLine.getOption(L"reactor-threads").getInteger());
 	if (!net::Network::initialize())
 	{
 		log::error << L"Unable to initialize networking." << Endl;
@@ -6,10 +6,14 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include "Avalanche/Chunker.h"
 #include "Avalanche/Dictionary.h"
 #include "Avalanche/IBlob.h"
 #include "Avalanche/Protocol.h"
 #include "Avalanche/Server/Connection.h"
+#include "Avalanche/Server/Server.h"
+#include "Core/RefArray.h"
+#include "Core/Io/MemoryStream.h"
 #include "Core/Io/StreamCopy.h"
 #include "Core/Log/Log.h"
 #include "Core/Thread/ThreadPool.h"
@@ -48,6 +52,7 @@ bool Connection::create(net::TcpSocket* clientSocket)
 	if (remoteAddress)
 		name = remoteAddress->getHostName();
 
+	clientSocket->setNoDelay(true);
 	clientSocket->setQuickAck(true);
 
 	auto fn = [=]()
@@ -215,6 +220,96 @@ bool Connection::process()
 							return false;
 						}
 					}
+					else if (subcmd == c_subCommandPutChunks)
+					{
+						uint32_t nchunks;
+						if (m_clientStream->read(&nchunks, sizeof(uint32_t)) != sizeof(uint32_t))
+							return false;
+						if (nchunks > c_maxPutChunks)
+						{
+							log::error << L"[PUT " << key.format() << L"] Too many chunks from client; terminating connection." << Endl;
+							return false;
+						}
+
+						// Reply which chunks we need, chunks we already have are read from dictionary.
+						// Stored chunks are keyed by hash computed by the server, thus a chunk we have
+						// is always the content of the key; chunks sent by client are verified below.
+						RefArray< IStream > chunkStreams;
+						AlignedVector< Key > chunkKeys;
+						AlignedVector< int64_t > chunkSizes;
+						uint8_t replies[c_maxPutChunks];
+						for (uint32_t i = 0; i < nchunks; ++i)
+						{
+							const Key chunkKey = Key::read(m_clientStream);
+							uint32_t chunkSize;
+							if (!chunkKey.valid() || m_clientStream->read(&chunkSize, sizeof(uint32_t)) != sizeof(uint32_t))
+							{
+								log::warning << L"Failed to read chunk; terminating connection." << Endl;
+								return false;
+							}
+							if (chunkSize > Chunker::c_maxSize)
+							{
+								log::error << L"[PUT " << key.format() << L"] Chunk of " << chunkSize << L" byte(s) too large; terminating connection." << Endl;
+								return false;
+							}
+
+							Ref< IStream > chunkStream = m_dictionary->readChunk(chunkKey);
+							if (chunkStream && chunkStream->available() != chunkSize)
+							{
+								chunkStream->close();
+								chunkStream = nullptr;
+							}
+
+							chunkStreams.push_back(chunkStream);
+							chunkKeys.push_back(chunkKey);
+							chunkSizes.push_back(chunkSize);
+							replies[i] = chunkStream ? c_replyOk : c_replyContinue;
+						}
+						if (m_clientStream->write(replies, nchunks) != (int64_t)nchunks)
+							return false;
+
+						Ref< IStream > appendStream = blob->append();
+						if (!appendStream)
+						{
+							log::error << L"[PUT " << key.format() << L"] Failed to append data to blob." << Endl;
+							return false;
+						}
+
+						// Assemble chunks in order, missing chunks are sent by client.
+						AlignedVector< uint8_t > received;
+						for (uint32_t i = 0; i < nchunks; ++i)
+						{
+							if (chunkStreams[i])
+							{
+								const bool copied = StreamCopy(appendStream, chunkStreams[i]).execute(chunkSizes[i]);
+								chunkStreams[i]->close();
+								if (!copied)
+								{
+									log::error << L"[PUT " << key.format() << L"] Unable to append chunk of " << chunkSizes[i] << L" byte(s); terminating connection." << Endl;
+									return false;
+								}
+								continue;
+							}
+
+							received.resize((size_t)chunkSizes[i]);
+							MemoryStream ms(received.ptr(), chunkSizes[i], false, true);
+							if (!StreamCopy(&ms, m_clientStream).execute(chunkSizes[i]))
+							{
+								log::error << L"[PUT " << key.format() << L"] Unable to receive chunk of " << chunkSizes[i] << L" byte(s) from client; terminating connection." << Endl;
+								return false;
+							}
+							if (!(Chunker::hash(received.c_ptr(), chunkSizes[i]) == chunkKeys[i]))
+							{
+								log::error << L"[PUT " << key.format() << L"] Chunk content doesn't match key; terminating connection." << Endl;
+								return false;
+							}
+							if (appendStream->write(received.c_ptr(), chunkSizes[i]) != chunkSizes[i])
+							{
+								log::error << L"[PUT " << key.format() << L"] Unable to append chunk of " << chunkSizes[i] << L" byte(s); terminating connection." << Endl;
+								return false;
+							}
+						}
+					}
 					else if (subcmd == c_subCommandPutCommit)
 					{
 						if (m_dictionary->put(key, blob, false))
@@ -265,6 +360,32 @@ bool Connection::process()
 		}
 		break;
 
+	case c_commandStatsTiers:
+		{
+			Dictionary::Stats stats;
+			m_dictionary->getStats(stats);
+			const uint64_t tiers[] =
+			{
+				stats.memoryTier.blobCount, stats.memoryTier.size, stats.memoryTier.hits,
+				stats.diskTier.blobCount, stats.diskTier.size, stats.diskTier.hits,
+				stats.misses, stats.promotions, stats.demotions, stats.evictions,
+				stats.chunkCount, stats.chunkSize, stats.chunkedSize
+			};
+			if (m_clientStream->write(tiers, sizeof(tiers)) != sizeof(tiers))
+				return false;
+		}
+		break;
+
+	case c_commandVersion:
+		{
+			const int32_t version[] = { Server::c_majorVersion, Server::c_minorVersion };
+			if (m_clientStream->write(&c_replyOk, sizeof(uint8_t)) != sizeof(uint8_t))
+				return false;
+			if (m_clientStream->write(version, sizeof(version)) != sizeof(version))
+				return false;
+		}
+		break;
+
 	case c_commandKeys:
 		{
 			AlignedVector< Key > keys;
@@ -363,6 +484,87 @@ bool Connection::process()
 		}
 		break;
 
+	case c_commandStatMany:
+		{
+			uint32_t nkeys;
+			if (m_clientStream->read(&nkeys, sizeof(uint32_t)) != sizeof(uint32_t))
+				return false;
+
+			// Reply to each key as soon as it's read; client is reading replies while we're processing.
+			for (uint32_t i = 0; i < nkeys; ++i)
+			{
+				const Key key = Key::read(m_clientStream);
+				if (!key.valid())
+				{
+					log::warning << L"Failed to read key; terminating connection." << Endl;
+					return false;
+				}
+
+				Ref< const IBlob > blob = m_dictionary->get(key, true);
+				if (blob)
+				{
+					if (m_clientStream->write(&c_replyOk, sizeof(uint8_t)) != sizeof(uint8_t))
+						return false;
+
+					const int64_t blobSize = blob->size();
+					if (m_clientStream->write(&blobSize, sizeof(int64_t)) != sizeof(int64_t))
+						return false;
+				}
+				else
+				{
+					if (m_clientStream->write(&c_replyFailure, sizeof(uint8_t)) != sizeof(uint8_t))
+						return false;
+				}
+			}
+		}
+		break;
+
+	case c_commandGetMany:
+		{
+			uint32_t nkeys;
+			if (m_clientStream->read(&nkeys, sizeof(uint32_t)) != sizeof(uint32_t))
+				return false;
+
+			uint32_t nsent = 0;
+			for (uint32_t i = 0; i < nkeys; ++i)
+			{
+				const Key key = Key::read(m_clientStream);
+				if (!key.valid())
+				{
+					log::warning << L"Failed to read key; terminating connection." << Endl;
+					return false;
+				}
+
+				Ref< const IBlob > blob = m_dictionary->get(key, false);
+				Ref< IStream > readStream = blob ? blob->read() : nullptr;
+				if (readStream)
+				{
+					if (m_clientStream->write(&c_replyOk, sizeof(uint8_t)) != sizeof(uint8_t))
+						return false;
+
+					const int64_t blobSize = blob->size();
+					if (m_clientStream->write(&blobSize, sizeof(int64_t)) != sizeof(int64_t))
+						return false;
+
+					if (!StreamCopy(m_clientStream, readStream).execute(blobSize))
+					{
+						log::error << L"[GET " << key.format() << L"] Unable to send " << blobSize << L" byte(s) to client; terminating connection." << Endl;
+						return false;
+					}
+
+					++nsent;
+				}
+				else
+				{
+					if (m_clientStream->write(&c_replyFailure, sizeof(uint8_t)) != sizeof(uint8_t))
+						return false;
+				}
+			}
+
+			log::info << L"[GET MANY] Sent " << nsent << L" of " << nkeys << L" blobs." << Endl;
+		}
+		break;
+
 	default:
 		log::error << L"Invalid command from client; terminating connection." << Endl;
 		return false;
@@ -0,0 +1,340 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#if defined(__LINUX__) || defined(__RPI__)
+#	include <errno.h>
+#	include <sys/epoll.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#	define T_REACTOR_EPOLL
+#endif
+#include "Avalanche/Dictionary.h"
+#include "Avalanche/Server/Reactor.h"
+#include "Avalanche/Server/ReactorConnection.h"
+#include "Core/Containers/SmallSet.h"
+#include "Core/Log/Log.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
+#include "Net/SocketAddressIPv4.h"
+#include "Net/TcpSocket.h"
+
+namespace traktor::avalanche
+{
+	namespace
+	{
+
+const int32_t c_maxEvents = 64;
+const int32_t c_waitTimeout = 100;
+const int32_t c_receiveBufferSize = 64 * 1024;
+
+	}
+
+struct Reactor::Client
+{
+	Ref< net::TcpSocket > socket;
+	Ref< ReactorConnection > connection;
+	std::wstring name;
+	uint32_t events = 0;
+};
+
+struct Reactor::Worker
+{
+	Thread* thread = nullptr;
+	int32_t epoll = -1;
+	SmallSet< Client* > clients;
+	AlignedVector< uint8_t > buffer;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.avalanche.Reactor", Reactor, Object)
+
+Reactor::~Reactor()
+{
+	destroy();
+}
+
+bool Reactor::supported()
+{
+#if defined(T_REACTOR_EPOLL)
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Reactor::create(net::TcpSocket* serverSocket, Dictionary* dictionary, int32_t workerCount)
+{
+#if defined(T_REACTOR_EPOLL)
+	m_serverSocket = serverSocket;
+	m_dictionary = dictionary;
+
+	// Workers accept connections themselves thus listening socket cannot block.
+	unsigned long nonBlocking = 1;
+	if (!m_serverSocket->ioctl(net::IccNonBlockingIo, &nonBlocking))
+	{
+		log::error << L"Unable to create reactor; failed to set non-blocking server socket." << Endl;
+		return false;
+	}
+
+	for (int32_t i = 0; i < std::max(workerCount, 1); ++i)
+	{
+		Worker* worker = new Worker();
+		worker->buffer.resize(c_receiveBufferSize);
+		m_workers.push_back(worker);
+
+		worker->epoll = ::epoll_create1(0);
+		if (worker->epoll < 0)
+		{
+			log::error << L"Unable to create reactor; failed to create epoll instance." << Endl;
+			return false;
+		}
+
+		// Each worker is waiting on listening socket, exclusive so only one worker is woken per connection.
+		epoll_event ev = {};
+		ev.events = EPOLLIN;
+#if defined(EPOLLEXCLUSIVE)
+		ev.events |= EPOLLEXCLUSIVE;
+#endif
+		ev.data.ptr = nullptr;
+		if (::epoll_ctl(worker->epoll, EPOLL_CTL_ADD, (int)m_serverSocket->handle(), &ev) < 0)
+		{
+			log::error << L"Unable to create reactor; failed to add server socket." << Endl;
+			return false;
+		}
+
+		worker->thread = ThreadManager::getInstance().create(
+			[=, this]() { threadWorker(worker); },
+			L"Avalanche reactor"
+		);
+		if (!worker->thread || !worker->thread->start())
+		{
+			log::error << L"Unable to create reactor; failed to create worker thread." << Endl;
+			return false;
+		}
+	}
+
+	log::info << L"Reactor created with " << (int32_t)m_workers.size() << L" worker(s)." << Endl;
+	return true;
+#else
+	log::error << L"Reactor not supported on this platform." << Endl;
+	return false;
+#endif
+}
+
+void Reactor::destroy()
+{
+#if defined(T_REACTOR_EPOLL)
+	for (auto worker : m_workers)
+	{
+		if (worker->thread)
+			worker->thread->stop(0);
+	}
+
+	for (auto worker : m_workers)
+	{
+		if (worker->thread)
+		{
+			worker->thread->stop();
+			ThreadManager::getInstance().destroy(worker->thread);
+			worker->thread = nullptr;
+		}
+
+		while (!worker->clients.empty())
+			close(worker, *worker->clients.begin());
+
+		if (worker->epoll >= 0)
+			::close(worker->epoll);
+
+		delete worker;
+	}
+	m_workers.clear();
+#endif
+
+	m_serverSocket = nullptr;
+	m_dictionary = nullptr;
+}
+
+void Reactor::threadWorker(Worker* worker)
+{
+#if defined(T_REACTOR_EPOLL)
+	Thread* thread = ThreadManager::getInstance().getCurrentThread();
+	epoll_event events[c_maxEvents];
+
+	while (!thread->stopped())
+	{
+		const int32_t nevents = ::epoll_wait(worker->epoll, events, c_maxEvents, c_waitTimeout);
+		for (int32_t i = 0; i < nevents; ++i)
+		{
+			Client* client = (Client*)events[i].data.ptr;
+			if (!client)
+			{
+				accept(worker);
+				continue;
+			}
+
+			bool alive = (events[i].events & EPOLLERR) == 0;
+			if (alive && (events[i].events & (EPOLLIN | EPOLLHUP)) != 0)
+				alive = receive(worker, client);
+			if (alive)
+				alive = send(client);
+			if (alive)
+				alive = updateEvents(worker, client);
+			if (!alive)
+				close(worker, client);
+		}
+	}
+#endif
+}
+
+void Reactor::accept(Worker* worker)
+{
+#if defined(T_REACTOR_EPOLL)
+	for (;;)
+	{
+		Ref< net::TcpSocket > clientSocket = m_serverSocket->accept();
+		if (!clientSocket)
+			break;
+
+		unsigned long nonBlocking = 1;
+		if (!clientSocket->ioctl(net::IccNonBlockingIo, &nonBlocking))
+		{
+			log::error << L"Unable to set non-blocking client socket; connection refused." << Endl;
+			continue;
+		}
+
+		clientSocket->setNoDelay(true);
+		clientSocket->setQuickAck(true);
+
+		Client* client = new Client();
+		client->socket = clientSocket;
+		client->connection = new ReactorConnection(m_dictionary);
+		client->name = L"<unknown>";
+		client->events = EPOLLIN;
+
+		auto remoteAddress = dynamic_type_cast< const net::SocketAddressIPv4* >(clientSocket->getRemoteAddress());
+		if (remoteAddress)
+			client->name = remoteAddress->getHostName();
+
+		epoll_event ev = {};
+		ev.events = client->events;
+		ev.data.ptr = client;
+		if (::epoll_ctl(worker->epoll, EPOLL_CTL_ADD, (int)clientSocket->handle(), &ev) < 0)
+		{
+			log::error << L"Unable to add client socket to reactor; connection refused." << Endl;
+			delete client;
+			continue;
+		}
+
+		worker->clients.insert(client);
+		m_connectionCount++;
+
+		log::info << L"Connection with " << client->name << L" established, ready to process requests." << Endl;
+	}
+#endif
+}
+
+bool Reactor::receive(Worker* worker, Client* client)
+{
+#if defined(T_REACTOR_EPOLL)
+	while (client->connection->wantReceive())
+	{
+		const ssize_t nrecv = ::recv((int)client->socket->handle(), worker->buffer.ptr(), worker->buffer.size(), 0);
+		if (nrecv > 0)
+		{
+			if (!client->connection->receive(worker->buffer.c_ptr(), (int64_t)nrecv))
+				return false;
+
+			// Send replies as soon as possible, reduce latency of pipelined requests.
+			if (!send(client))
+				return false;
+		}
+		else if (nrecv == 0)
+			return false;
+		else if (errno == EAGAIN || errno == EWOULDBLOCK)
+			break;
+		else if (errno != EINTR)
+			return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Reactor::send(Client* client)
+{
+#if defined(T_REACTOR_EPOLL)
+	ReactorConnection* connection = client->connection;
+	for (;;)
+	{
+		// Continue with pending requests, or blob data, when replies has been sent.
+		if (connection->getOutputSize() <= 0)
+		{
+			if (!connection->process())
+				return false;
+			if (connection->getOutputSize() <= 0)
+				break;
+		}
+
+		const ssize_t nsent = ::send((int)client->socket->handle(), connection->getOutput(), (size_t)connection->getOutputSize(), MSG_NOSIGNAL);
+		if (nsent > 0)
+			connection->sent((int64_t)nsent);
+		else if (nsent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		else if (nsent < 0 && errno == EINTR)
+			continue;
+		else
+			return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Reactor::updateEvents(Worker* worker, Client* client)
+{
+#if defined(T_REACTOR_EPOLL)
+	// Level triggered; only wait for writable while there are replies queued
+	// and stop receiving when client isn't reading it's replies.
+	uint32_t events = 0;
+	if (client->connection->wantReceive() || client->connection->getOutputSize() <= 0)
+		events |= EPOLLIN;
+	if (client->connection->getOutputSize() > 0)
+		events |= EPOLLOUT;
+
+	if (events == client->events)
+		return true;
+
+	epoll_event ev = {};
+	ev.events = events;
+	ev.data.ptr = client;
+	if (::epoll_ctl(worker->epoll, EPOLL_CTL_MOD, (int)client->socket->handle(), &ev) < 0)
+		return false;
+
+	client->events = events;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Reactor::close(Worker* worker, Client* client)
+{
+#if defined(T_REACTOR_EPOLL)
+	::epoll_ctl(worker->epoll, EPOLL_CTL_DEL, (int)client->socket->handle(), nullptr);
+	client->socket->close();
+
+	log::info << L"Connection with " << client->name << L" terminated." << Endl;
+
+	worker->clients.erase(client);
+	delete client;
+	m_connectionCount--;
+#endif
+}
+
+}
@@ -0,0 +1,81 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <atomic>
+#include "Core/Object.h"
+#include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_AVALANCHE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::net
+{
+
+class TcpSocket;
+
+}
+
+namespace traktor::avalanche
+{
+
+class Dictionary;
+
+/*! Event driven connection multiplexer.
+ * \ingroup Avalanche
+ *
+ * A small, fixed, set of worker threads accept and serve all
+ * connections using non-blocking sockets, instead of one
+ * thread per connection. Only supported on Linux (epoll).
+ */
+class T_DLLCLASS Reactor : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	virtual ~Reactor();
+
+	/*! Check if reactor is supported on this platform. */
+	static bool supported();
+
+	bool create(net::TcpSocket* serverSocket, Dictionary* dictionary, int32_t workerCount);
+
+	void destroy();
+
+	uint32_t getConnectionCount() const { return (uint32_t)m_connectionCount; }
+
+private:
+	struct Worker;
+	struct Client;
+
+	Ref< net::TcpSocket > m_serverSocket;
+	Ref< Dictionary > m_dictionary;
+	AlignedVector< Worker* > m_workers;
+	std::atomic< int32_t > m_connectionCount = 0;
+
+	void threadWorker(Worker* worker);
+
+	void accept(Worker* worker);
+
+	bool receive(Worker* worker, Client* client);
+
+	bool send(Client* client);
+
+	bool updateEvents(Worker* worker, Client* client);
+
+	void close(Worker* worker, Client* client);
+};
+
+}
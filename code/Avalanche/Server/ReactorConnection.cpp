@@ -0,0 +1,652 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Avalanche/Chunker.h"
+#include "Avalanche/Dictionary.h"
+#include "Avalanche/IBlob.h"
+#include "Avalanche/Protocol.h"
+#include "Avalanche/Server/ReactorConnection.h"
+#include "Avalanche/Server/Server.h"
+#include "Core/Io/IStream.h"
+#include "Core/Io/MemoryStream.h"
+#include "Core/Io/StreamCopy.h"
+#include "Core/Log/Log.h"
+
+namespace traktor::avalanche
+{
+	namespace
+	{
+
+const int64_t c_keySize = 4 * sizeof(uint32_t);
+const int64_t c_maxQueuedInput = 1024 * 1024;		//!< Stop receiving when this much unprocessed data is queued.
+const int64_t c_maxQueuedOutput = 1024 * 1024;		//!< Stop processing requests when this much reply data is queued.
+const int64_t c_blobChunkSize = 64 * 1024;
+const uint32_t c_continueInterval = 100;
+
+	}
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.avalanche.ReactorConnection", ReactorConnection, Object)
+
+ReactorConnection::ReactorConnection(Dictionary* dictionary)
+:	m_dictionary(dictionary)
+{
+}
+
+ReactorConnection::~ReactorConnection()
+{
+	if (m_getStream)
+		m_getStream->close();
+	for (auto& chunk : m_putChunks)
+	{
+		if (chunk.have)
+			chunk.have->close();
+	}
+}
+
+bool ReactorConnection::receive(const void* data, int64_t size)
+{
+	// Discard processed data before growing buffer.
+	if (m_inputOffset > 0 && m_inputOffset >= (int64_t)m_input.size() / 2)
+	{
+		m_input.erase(m_input.begin(), m_input.begin() + (size_t)m_inputOffset);
+		m_inputOffset = 0;
+	}
+
+	m_input.insert(m_input.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+	return process();
+}
+
+bool ReactorConnection::process()
+{
+	for (;;)
+	{
+		// Blob data must be sent before reply of next request.
+		if (m_getStream)
+		{
+			if (!processGet())
+				return false;
+			if (m_getStream)
+				break;
+		}
+
+		if (getOutputSize() >= c_maxQueuedOutput)
+			break;
+
+		bool waiting = false;
+		if (!processCommand(waiting))
+			return false;
+		if (waiting)
+			break;
+	}
+
+	if (m_inputOffset >= (int64_t)m_input.size())
+	{
+		m_input.resize(0);
+		m_inputOffset = 0;
+	}
+
+	return true;
+}
+
+void ReactorConnection::sent(int64_t size)
+{
+	m_outputOffset += size;
+	T_ASSERT(m_outputOffset <= (int64_t)m_output.size());
+
+	if (m_outputOffset >= (int64_t)m_output.size())
+	{
+		m_output.resize(0);
+		m_outputOffset = 0;
+	}
+	else if (m_outputOffset >= c_maxQueuedOutput)
+	{
+		m_output.erase(m_output.begin(), m_output.begin() + (size_t)m_outputOffset);
+		m_outputOffset = 0;
+	}
+}
+
+bool ReactorConnection::wantReceive() const
+{
+	return available() < c_maxQueuedInput && getOutputSize() < c_maxQueuedOutput;
+}
+
+Key ReactorConnection::readKey()
+{
+	uint32_t kv[4];
+	std::memcpy(kv, peek(), sizeof(kv));
+	m_inputOffset += sizeof(kv);
+	return Key(kv[0], kv[1], kv[2], kv[3]);
+}
+
+void ReactorConnection::reply(const void* data, int64_t size)
+{
+	m_output.insert(m_output.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+void ReactorConnection::replyKey(const Key& key)
+{
+	uint8_t kv[c_keySize];
+	MemoryStream ms(kv, sizeof(kv), false, true);
+	key.write(&ms);
+	reply(kv, sizeof(kv));
+}
+
+bool ReactorConnection::processCommand(bool& outWaiting)
+{
+	switch (m_state)
+	{
+	case State::Command:
+		{
+			if (available() < 1)
+			{
+				outWaiting = true;
+				return true;
+			}
+
+			// Ensure entire request header has been received before consuming anything.
+			const uint8_t cmd = peek()[0];
+			int64_t requestSize = 1;
+			if (cmd == c_commandStat || cmd == c_commandGet || cmd == c_commandPut)
+				requestSize += c_keySize;
+			else if (cmd == c_commandTouch || cmd == c_commandEvict || cmd == c_commandStatMany || cmd == c_commandGetMany)
+				requestSize += sizeof(uint32_t);
+
+			if (available() < requestSize)
+			{
+				outWaiting = true;
+				return true;
+			}
+			m_inputOffset++;
+
+			switch (cmd)
+			{
+			case c_commandPing:
+				reply(c_replyOk);
+				break;
+
+			case c_commandStat:
+				{
+					const Key key = readKey();
+					if (!key.valid())
+					{
+						log::warning << L"Failed to read key; terminating connection." << Endl;
+						return false;
+					}
+
+					Ref< const IBlob > blob = m_dictionary->get(key, true);
+					if (blob)
+					{
+						const int64_t blobSize = blob->size();
+						reply(c_replyOk);
+						reply(&blobSize, sizeof(int64_t));
+					}
+					else
+						reply(c_replyFailure);
+				}
+				break;
+
+			case c_commandGet:
+				{
+					const Key key = readKey();
+					if (!key.valid())
+					{
+						log::warning << L"Failed to read key; terminating connection." << Endl;
+						return false;
+					}
+
+					Ref< const IBlob > blob = m_dictionary->get(key, false);
+					if (blob)
+					{
+						Ref< IStream > readStream = blob->read();
+						if (readStream)
+						{
+							const int64_t blobSize = blob->size();
+							reply(c_replyOk);
+							reply(&blobSize, sizeof(int64_t));
+
+							m_getStream = readStream;
+							m_getRemaining = blobSize;
+						}
+						else
+						{
+							log::error <<  L"[GET " << key.format() << L"] Unable to acquire read stream from blob." << Endl;
+							reply(c_replyFailure);
+						}
+					}
+					else
+						reply(c_replyFailure);
+				}
+				break;
+
+			case c_commandPut:
+				{
+					const Key key = readKey();
+					if (!key.valid())
+					{
+						log::warning << L"Failed to read key; terminating connection." << Endl;
+						return false;
+					}
+
+					if (m_dictionary->get(key, true) != nullptr)
+					{
+						log::error << L"[PUT " << key.format() << L"] Cannot replace existing blob." << Endl;
+						reply(c_replyFailure);
+						break;
+					}
+
+					m_putBlob = m_dictionary->create();
+					if (m_putBlob)
+					{
+						m_putKey = key;
+						m_state = State::PutSubCommand;
+						reply(c_replyOk);
+					}
+					else
+					{
+						log::error << L"[PUT " << key.format() << L"] Failed to create blob." << Endl;
+						reply(c_replyFailure);
+					}
+				}
+				break;
+
+			case c_commandStats:
+				{
+					Dictionary::Stats stats;
+					m_dictionary->getStats(stats);
+					reply(&stats.blobCount, sizeof(uint32_t));
+					reply(&stats.memoryUsage, sizeof(uint64_t));
+				}
+				break;
+
+			case c_commandStatsTiers:
+				{
+					Dictionary::Stats stats;
+					m_dictionary->getStats(stats);
+					const uint64_t tiers[] =
+					{
+						stats.memoryTier.blobCount, stats.memoryTier.size, stats.memoryTier.hits,
+						stats.diskTier.blobCount, stats.diskTier.size, stats.diskTier.hits,
+						stats.misses, stats.promotions, stats.demotions, stats.evictions,
+						stats.chunkCount, stats.chunkSize, stats.chunkedSize
+					};
+					reply(tiers, sizeof(tiers));
+				}
+				break;
+
+			case c_commandVersion:
+				{
+					const int32_t version[] = { Server::c_majorVersion, Server::c_minorVersion };
+					reply(c_replyOk);
+					reply(version, sizeof(version));
+				}
+				break;
+
+			case c_commandKeys:
+				{
+					AlignedVector< Key > keys;
+					m_dictionary->snapshotKeys(keys);
+
+					const uint64_t nkeys = (uint64_t)keys.size();
+					reply(&nkeys, sizeof(uint64_t));
+					for (const auto& key : keys)
+						replyKey(key);
+				}
+				break;
+
+			case c_commandTouch:
+			case c_commandEvict:
+				m_keysRemaining = read< uint32_t >();
+				m_keysProcessed = 0;
+				m_state = (cmd == c_commandTouch) ? State::Touch : State::Evict;
+				break;
+
+			case c_commandStatMany:
+			case c_commandGetMany:
+				m_keysRemaining = read< uint32_t >();
+				m_state = (cmd == c_commandStatMany) ? State::StatMany : State::GetMany;
+				break;
+
+			default:
+				log::error << L"Invalid command from client; terminating connection." << Endl;
+				return false;
+			}
+		}
+		break;
+
+	case State::PutSubCommand:
+		{
+			if (available() < 1)
+			{
+				outWaiting = true;
+				return true;
+			}
+
+			const uint8_t subcmd = peek()[0];
+			if (subcmd == c_subCommandPutAppend)
+			{
+				if (available() < 1 + (int64_t)sizeof(int64_t))
+				{
+					outWaiting = true;
+					return true;
+				}
+				m_inputOffset++;
+
+				m_putRemaining = read< int64_t >();
+				m_putStream = m_putBlob->append();
+				if (!m_putStream)
+				{
+					log::error << L"[PUT " << m_putKey.format() << L"] Failed to append data to blob." << Endl;
+					return false;
+				}
+				m_state = State::PutAppend;
+			}
+			else if (subcmd == c_subCommandPutChunks)
+			{
+				if (available() < 1 + (int64_t)sizeof(uint32_t))
+				{
+					outWaiting = true;
+					return true;
+				}
+
+				uint32_t nchunks;
+				std::memcpy(&nchunks, peek() + 1, sizeof(uint32_t));
+				if (nchunks > c_maxPutChunks)
+				{
+					log::error << L"[PUT " << m_putKey.format() << L"] Too many chunks from client; terminating connection." << Endl;
+					return false;
+				}
+
+				// Ensure entire list of chunks has been received before consuming anything.
+				if (available() < 1 + (int64_t)sizeof(uint32_t) + nchunks * (c_keySize + (int64_t)sizeof(uint32_t)))
+				{
+					outWaiting = true;
+					return true;
+				}
+				m_inputOffset += 1 + sizeof(uint32_t);
+
+				m_putChunks.resize(0);
+				for (uint32_t i = 0; i < nchunks; ++i)
+				{
+					const Key chunkKey = readKey();
+					const uint32_t chunkSize = read< uint32_t >();
+					if (!chunkKey.valid())
+					{
+						log::warning << L"Failed to read chunk; terminating connection." << Endl;
+						return false;
+					}
+					if (chunkSize > Chunker::c_maxSize)
+					{
+						log::error << L"[PUT " << m_putKey.format() << L"] Chunk of " << chunkSize << L" byte(s) too large; terminating connection." << Endl;
+						return false;
+					}
+
+					// Stored chunks are keyed by hash computed by the server, thus a chunk we have
+					// is always the content of the key; chunks received from client are verified.
+
+					Ref< IStream > chunkStream = m_dictionary->readChunk(chunkKey);
+					if (chunkStream && chunkStream->available() != chunkSize)
+					{
+						chunkStream->close();
+						chunkStream = nullptr;
+					}
+
+					m_putChunks.push_back({ chunkKey, chunkStream, chunkSize });
+					reply(chunkStream ? c_replyOk : c_replyContinue);
+				}
+
+				m_putStream = m_putBlob->append();
+				if (!m_putStream)
+				{
+					log::error << L"[PUT " << m_putKey.format() << L"] Failed to append data to blob." << Endl;
+					return false;
+				}
+				m_putChunkIndex = 0;
+				m_putChunkHash.begin();
+				m_state = State::PutChunks;
+			}
+			else if (subcmd == c_subCommandPutCommit)
+			{
+				m_inputOffset++;
+				if (m_dictionary->put(m_putKey, m_putBlob, false))
+					reply(c_replyOk);
+				else
+					reply(c_replyFailure);
+				m_putBlob = nullptr;
+				m_state = State::Command;
+			}
+			else if (subcmd == c_subCommandPutDiscard)
+			{
+				m_inputOffset++;
+				reply(c_replyOk);
+				m_putBlob = nullptr;
+				m_state = State::Command;
+			}
+			else
+			{
+				log::error << L"[PUT " << m_putKey.format() << L"] Invalid sub-command from client; terminating connection." << Endl;
+				return false;
+			}
+		}
+		break;
+
+	case State::PutAppend:
+		{
+			if (!appendReceived(m_putRemaining))
+				return false;
+
+			if (m_putRemaining > 0)
+			{
+				outWaiting = true;
+				return true;
+			}
+
+			m_putStream = nullptr;
+			m_state = State::PutSubCommand;
+		}
+		break;
+
+	case State::PutChunks:
+		{
+			// Assemble chunks in order, missing chunks are sent by client.
+			while (m_putChunkIndex < (uint32_t)m_putChunks.size())
+			{
+				PutChunk& chunk = m_putChunks[m_putChunkIndex];
+				if (chunk.have)
+				{
+					if (!StreamCopy(m_putStream, chunk.have).execute(chunk.remaining))
+					{
+						log::error << L"[PUT " << m_putKey.format() << L"] Unable to append chunk of " << chunk.remaining << L" byte(s); terminating connection." << Endl;
+						return false;
+					}
+					chunk.have->close();
+					chunk.have = nullptr;
+					chunk.remaining = 0;
+				}
+				else
+				{
+					if (!appendReceived(chunk.remaining, &m_putChunkHash))
+						return false;
+					if (chunk.remaining > 0)
+					{
+						outWaiting = true;
+						return true;
+					}
+
+					m_putChunkHash.end();
+					const uint32_t* kv = m_putChunkHash.get();
+					if (!(Key(kv[0], kv[1], kv[2], kv[3]) == chunk.key))
+					{
+						log::error << L"[PUT " << m_putKey.format() << L"] Chunk content doesn't match key; terminating connection." << Endl;
+						return false;
+					}
+					m_putChunkHash.begin();
+				}
+				m_putChunkIndex++;
+			}
+
+			m_putChunks.resize(0);
+			m_putStream = nullptr;
+			m_state = State::PutSubCommand;
+		}
+		break;
+
+	case State::Touch:
+	case State::Evict:
+		{
+			if (m_keysRemaining == 0)
+			{
+				if (m_state == State::Touch)
+					log::info << L"[TOUCH] Touched " << m_keysProcessed << L" blobs." << Endl;
+				else
+					log::info << L"[EVICT] Removed " << m_keysProcessed << L" blobs." << Endl;
+				reply(c_replyOk);
+				m_state = State::Command;
+				break;
+			}
+
+			if (available() < c_keySize)
+			{
+				outWaiting = true;
+				return true;
+			}
+
+			const Key key = readKey();
+			if (!key.valid())
+			{
+				log::warning << L"Failed to read key; terminating connection." << Endl;
+				return false;
+			}
+			m_keysRemaining--;
+
+			if (m_state == State::Touch)
+			{
+				Ref< IBlob > blob = m_dictionary->get(key, false);
+				if (blob == nullptr)
+				{
+					log::error << L"[TOUCH " << key.format() << L"] No such blob." << Endl;
+					break;
+				}
+				if (!blob->touch())
+				{
+					log::error << L"[TOUCH " << key.format() << L"] Unable to touch blob." << Endl;
+					break;
+				}
+			}
+			else
+			{
+				if (!m_dictionary->remove(key))
+				{
+					log::info << L"[EVICT " << key.format() << L"] No such blob." << Endl;
+					break;
+				}
+			}
+
+			// Reply periodically that we're still working, to prevent
+			// timeout on client in case we're processing a large set.
+			if (++m_keysProcessed % c_continueInterval == 0)
+				reply(c_replyContinue);
+		}
+		break;
+
+	case State::StatMany:
+	case State::GetMany:
+		{
+			// Each key is replied separately, blob data is streamed as usual before next key is processed.
+			if (m_keysRemaining == 0)
+			{
+				m_state = State::Command;
+				break;
+			}
+
+			if (available() < c_keySize)
+			{
+				outWaiting = true;
+				return true;
+			}
+
+			const Key key = readKey();
+			if (!key.valid())
+			{
+				log::warning << L"Failed to read key; terminating connection." << Endl;
+				return false;
+			}
+			m_keysRemaining--;
+
+			Ref< const IBlob > blob = m_dictionary->get(key, m_state == State::StatMany);
+			Ref< IStream > readStream = (blob && m_state == State::GetMany) ? blob->read() : nullptr;
+			if (blob && (m_state == State::StatMany || readStream))
+			{
+				const int64_t blobSize = blob->size();
+				reply(c_replyOk);
+				reply(&blobSize, sizeof(int64_t));
+
+				if (readStream)
+				{
+					m_getStream = readStream;
+					m_getRemaining = blobSize;
+				}
+			}
+			else
+				reply(c_replyFailure);
+		}
+		break;
+	}
+
+	return true;
+}
+
+bool ReactorConnection::processGet()
+{
+	while (m_getRemaining > 0 && getOutputSize() < c_maxQueuedOutput)
+	{
+		const int64_t nread = std::min(m_getRemaining, c_blobChunkSize);
+		const size_t offset = m_output.size();
+		m_output.resize(offset + (size_t)nread);
+
+		const int64_t ngot = m_getStream->read(m_output.ptr() + offset, nread);
+		if (ngot <= 0)
+		{
+			// Blob size has already been sent thus we cannot recover.
+			log::error << L"[GET] Unable to read blob; terminating connection." << Endl;
+			return false;
+		}
+
+		m_output.resize(offset + (size_t)ngot);
+		m_getRemaining -= ngot;
+	}
+
+	if (m_getRemaining <= 0)
+	{
+		m_getStream->close();
+		m_getStream = nullptr;
+	}
+
+	return true;
+}
+
+bool ReactorConnection::appendReceived(int64_t& remaining, MD5* hash)
+{
+	// Received data is appended directly to blob; chunks are never buffered in full.
+	const int64_t nappend = std::min(available(), remaining);
+	if (nappend > 0)
+	{
+		if (m_putStream->write(peek(), nappend) != nappend)
+		{
+			log::error << L"[PUT " << m_putKey.format() << L"] Unable to append " << nappend << L" byte(s) to blob; terminating connection." << Endl;
+			return false;
+		}
+		if (hash)
+			hash->feedBuffer(peek(), (uint64_t)nappend);
+		m_inputOffset += nappend;
+		remaining -= nappend;
+	}
+	return true;
+}
+
+}
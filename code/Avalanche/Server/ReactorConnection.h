@@ -0,0 +1,155 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <cstring>
+#include "Core/Object.h"
+#include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Misc/Key.h"
+#include "Core/Misc/MD5.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_AVALANCHE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor
+{
+
+class IStream;
+
+}
+
+namespace traktor::avalanche
+{
+
+class Dictionary;
+class IBlob;
+
+/*! Non-blocking connection state.
+ * \ingroup Avalanche
+ *
+ * Requests are parsed from received data as soon as they
+ * are complete, thus a client can pipeline several requests
+ * without waiting for each reply. Replies are queued in
+ * request order and sent when socket is writable.
+ */
+class T_DLLCLASS ReactorConnection : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	explicit ReactorConnection(Dictionary* dictionary);
+
+	virtual ~ReactorConnection();
+
+	/*! Append received data and process all complete requests.
+	 *
+	 * \return False if connection should be terminated.
+	 */
+	bool receive(const void* data, int64_t size);
+
+	/*! Process pending requests, ie. after queued replies has been sent. */
+	bool process();
+
+	/*! Get queued reply data. */
+	const uint8_t* getOutput() const { return m_output.c_ptr() + m_outputOffset; }
+
+	/*! Get size of queued reply data. */
+	int64_t getOutputSize() const { return (int64_t)m_output.size() - m_outputOffset; }
+
+	/*! Remove sent data from reply queue. */
+	void sent(int64_t size);
+
+	/*! Check if connection is ready to receive more data.
+	 *
+	 * Reception is stopped while too much data is queued,
+	 * for example if client doesn't read replies.
+	 */
+	bool wantReceive() const;
+
+private:
+	enum class State
+	{
+		Command,
+		PutSubCommand,
+		PutAppend,
+		PutChunks,
+		Touch,
+		Evict,
+		StatMany,
+		GetMany
+	};
+
+	Dictionary* m_dictionary;
+	AlignedVector< uint8_t > m_input;
+	int64_t m_inputOffset = 0;
+	AlignedVector< uint8_t > m_output;
+	int64_t m_outputOffset = 0;
+	State m_state = State::Command;
+
+	// Current GET; blob data is read when there is room in reply queue.
+	Ref< IStream > m_getStream;
+	int64_t m_getRemaining = 0;
+
+	// Current PUT.
+	Key m_putKey;
+	Ref< IBlob > m_putBlob;
+	Ref< IStream > m_putStream;
+	int64_t m_putRemaining = 0;
+
+	// Current PUT CHUNKS; chunks we already have are read from dictionary, others are received.
+	struct PutChunk
+	{
+		Key key;
+		Ref< IStream > have;
+		int64_t remaining;
+	};
+
+	AlignedVector< PutChunk > m_putChunks;
+	uint32_t m_putChunkIndex = 0;
+	MD5 m_putChunkHash;		//!< Hash of received chunk, must match key of chunk.
+
+	// Current TOUCH, EVICT, STAT MANY or GET MANY.
+	uint32_t m_keysRemaining = 0;
+	uint32_t m_keysProcessed = 0;
+
+	int64_t available() const { return (int64_t)m_input.size() - m_inputOffset; }
+
+	const uint8_t* peek() const { return m_input.c_ptr() + m_inputOffset; }
+
+	template < typename T >
+	T read()
+	{
+		T value;
+		std::memcpy(&value, peek(), sizeof(T));
+		m_inputOffset += sizeof(T);
+		return value;
+	}
+
+	Key readKey();
+
+	void reply(const void* data, int64_t size);
+
+	void reply(uint8_t value) { reply(&value, sizeof(value)); }
+
+	void replyKey(const Key& key);
+
+	bool processCommand(bool& outWaiting);
+
+	bool processGet();
+
+	bool appendReceived(int64_t& remaining, MD5* hash = nullptr);
+};
+
+}
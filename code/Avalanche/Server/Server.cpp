@@ -7,10 +7,10 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Avalanche/Dictionary.h"
-#include "Avalanche/IBlob.h"
 #include "Avalanche/Server/Connection.h"
-#include "Avalanche/Server/Server.h"
 #include "Avalanche/Server/Peer.h"
+#include "Avalanche/Server/Reactor.h"
+#include "Avalanche/Server/Server.h"
 #include "Core/Log/Log.h"
 #include "Core/Misc/SafeDestroy.h"
 #include "Core/Misc/String.h"
@@ -20,6 +20,8 @@
 #include "Core/Settings/PropertyInteger.h"
 #include "Core/Settings/PropertyString.h"
 #include "Core/System/OS.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
 #include "Net/SocketAddressIPv4.h"
 #include "Net/TcpSocket.h"
 #include "Net/Discovery/DiscoveryManager.h"
@@ -59,18 +61,38 @@ bool Server::create(const PropertyGroup* settings)
 		return false;
 	}
 
-	// Create our dictionary.
+	// Create our dictionary; budget and quota are specified in GiB.
+	const uint64_t memoryBudget = (uint64_t)settings->getProperty< int32_t >(L"Avalanche.MemoryBudget", 8) * 1024ULL * 1024ULL * 1024ULL;
+	const uint64_t diskQuota = (uint64_t)settings->getProperty< int32_t >(L"Avalanche.DiskQuota", 64) * 1024ULL * 1024ULL * 1024ULL;
+
 	m_dictionary = new Dictionary();
 	if (!m_dictionary->create(
-		settings->getProperty< std::wstring >(L"Avalanche.Path", L"")
+		settings->getProperty< std::wstring >(L"Avalanche.Path", L""),
+		memoryBudget,
+		diskQuota
 	))
 	{
 		log::error << L"Unable to create dictionary." << Endl;
 		return false;		
 	}
 
+	// Serve connections from a few reactor workers instead of one thread per connection.
+	if (settings->getProperty< bool >(L"Avalanche.Reactor", false))
+	{
+		if (Reactor::supported())
+		{
+			m_reactor = new Reactor();
+			if (!m_reactor->create(m_serverSocket, m_dictionary, settings->getProperty< int32_t >(L"Avalanche.ReactorThreads", 4)))
+			{
+				log::error << L"Unable to create reactor." << Endl;
+				return false;
+			}
+		}
+		else
+			log::warning << L"Reactor not supported on this platform; using one thread per connection." << Endl;
+	}
+
 	m_master = settings->getProperty< bool >(L"Avalanche.Master", false);
-	m_memoryBudget = settings->getProperty< int32_t >(L"Avalanche.MemoryBudget", 8);
 
 	// Broadcast our self on the network.
 	Ref< PropertyGroup > publishSettings = DeepClone(settings).create< PropertyGroup >();
@@ -95,6 +117,7 @@ bool Server::create(const PropertyGroup* settings)
 
 void Server::destroy()
 {
+	safeDestroy(m_reactor);
 	m_connections.clear();
 	m_peers.clear();
 	safeClose(m_serverSocket);
@@ -102,10 +125,17 @@ void Server::destroy()
 	m_dictionary = nullptr;
 }
 
+size_t Server::getConnectionCount() const
+{
+	return m_reactor ? (size_t)m_reactor->getConnectionCount() : m_connections.size();
+}
+
 bool Server::update()
 {
-	// Accept new connections.
-	if (m_serverSocket->select(true, false, false, 500) > 0)
+	// Accept new connections; reactor accept connections itself.
+	if (m_reactor)
+		ThreadManager::getInstance().getCurrentThread()->sleep(500);
+	else if (m_serverSocket->select(true, false, false, 500) > 0)
 	{
 		Ref< net::TcpSocket > clientSocket = m_serverSocket->accept();
 		if (clientSocket)
@@ -201,53 +231,8 @@ bool Server::update()
 	}
 	m_peers = peers;
 
-	// Execute eviction policy.
-	if (m_master)
-	{
-		const uint64_t maxMemoryUsage = (uint64_t)m_memoryBudget * 1024UL * 1024UL * 1024UL;
-
-		Dictionary::Stats stats;
-		if (m_dictionary->getStats(stats))
-		{
-			if (stats.memoryUsage >= maxMemoryUsage)
-			{
-				AlignedVector< std::pair< Key, DateTime > > queue;
-
-				// Get snapshot of keys and last access time stamps.
-				AlignedVector< Key > keys;
-				m_dictionary->snapshotKeys(keys);
-				for (const auto& key : keys)
-				{
-					Ref< IBlob > blob = m_dictionary->get(key, true);
-					if (!blob)
-						continue;
-					queue.push_back({
-						key,
-						blob->lastAccessed()
-					});
-				}
-
-				// Sort eviction candidates on longest since access first.
-				std::sort(queue.begin(), queue.end(), [](const std::pair< Key, DateTime >& lh, const std::pair< Key, DateTime >& rh) {
-					return lh.second < rh.second;
-				});
-
-				// Evict blobs until memory budget is meet.
-				auto it = queue.begin();
-				while (it != queue.end() && stats.memoryUsage >= maxMemoryUsage)
-				{
-					Ref< IBlob > blob = m_dictionary->get(it->first, true);
-					if (!blob)
-						continue;
-
-					stats.memoryUsage -= blob->size();
-					m_dictionary->remove(it->first);
-
-					++it;
-				}
-			}
-		}
-	}
+	// Keep dictionary within budget and quota; only master evict blobs, slaves evict when told by master.
+	m_dictionary->balance(m_master);
 
 	return true;
 }
@@ -42,6 +42,7 @@ namespace traktor::avalanche
 class Connection;
 class Dictionary;
 class Peer;
+class Reactor;
 
 class T_DLLCLASS Server : public Object
 {
@@ -49,7 +50,7 @@ class T_DLLCLASS Server : public Object
 
 public:
 	constexpr static int32_t c_majorVersion = 7;
-	constexpr static int32_t c_minorVersion = 0;
+	constexpr static int32_t c_minorVersion = 3;
 
 	bool create(const PropertyGroup* settings);
 
@@ -57,17 +58,17 @@ public:
 
 	bool update();
 
-	size_t getConnectionCount() const { return m_connections.size(); }
+	size_t getConnectionCount() const;
 
 private:
 	Ref< net::TcpSocket > m_serverSocket;
 	RefArray< Connection > m_connections;
+	Ref< Reactor > m_reactor;
 	Ref< net::DiscoveryManager > m_discoveryManager;
 	RefArray< Peer > m_peers;
 	Ref< Dictionary > m_dictionary;
 	Guid m_instanceId;
 	bool m_master = false;
-	int32_t m_memoryBudget = 8;
 };
 
 }
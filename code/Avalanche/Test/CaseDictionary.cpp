@@ -0,0 +1,262 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cstring>
+#include "Avalanche/Dictionary.h"
+#include "Avalanche/IBlob.h"
+#include "Avalanche/Test/CaseDictionary.h"
+#include "Core/Io/FileSystem.h"
+#include "Core/Io/IStream.h"
+
+namespace traktor::avalanche::test
+{
+	namespace
+	{
+
+const wchar_t* c_blobsPath = L"CaseDictionary.blobs";
+const int32_t c_blobCount = 64;
+const int32_t c_blobSize = 8 * 1024;
+const uint64_t c_memoryBudget = 256 * 1024;
+const uint64_t c_diskQuota = 384 * 1024;
+
+void clearDirectory(const std::wstring& path)
+{
+	RefArray< File > files = FileSystem::getInstance().find(path + L"/*.*");
+	for (auto file : files)
+	{
+		const Path filePath = file->getPath();
+		if (filePath.getFileName() == L"." || filePath.getFileName() == L"..")
+			continue;
+		if (file->isDirectory())
+		{
+			clearDirectory(filePath.getPathName());
+			FileSystem::getInstance().removeDirectory(filePath);
+		}
+		else
+			FileSystem::getInstance().remove(filePath);
+	}
+}
+
+void removeBlobs()
+{
+	clearDirectory(c_blobsPath);
+	FileSystem::getInstance().removeDirectory(c_blobsPath);
+}
+
+bool putBlob(Dictionary* dictionary, const Key& key, uint8_t value)
+{
+	Ref< IBlob > blob = dictionary->create();
+	Ref< IStream > stream = blob->append();
+	uint8_t data[c_blobSize];
+	for (int32_t i = 0; i < c_blobSize; ++i)
+		data[i] = value;
+	if (stream->write(data, c_blobSize) != c_blobSize)
+		return false;
+	stream->close();
+	return dictionary->put(key, blob, true);
+}
+
+bool checkBlob(const IBlob* blob, uint8_t value)
+{
+	if (!blob || blob->size() != c_blobSize)
+		return false;
+
+	Ref< IStream > stream = blob->read();
+	uint8_t data[c_blobSize];
+	if (!stream || stream->read(data, c_blobSize) != c_blobSize)
+		return false;
+
+	for (int32_t i = 0; i < c_blobSize; ++i)
+	{
+		if (data[i] != value)
+			return false;
+	}
+	return true;
+}
+
+bool putData(Dictionary* dictionary, const Key& key, const AlignedVector< uint8_t >& data)
+{
+	Ref< IBlob > blob = dictionary->create();
+	Ref< IStream > stream = blob->append();
+	if (stream->write(data.c_ptr(), (int64_t)data.size()) != (int64_t)data.size())
+		return false;
+	stream->close();
+	return dictionary->put(key, blob, true);
+}
+
+bool checkStream(IStream* stream, const AlignedVector< uint8_t >& data)
+{
+	if (!stream)
+		return false;
+
+	AlignedVector< uint8_t > read(data.size());
+	for (int64_t offset = 0; offset < (int64_t)read.size(); )
+	{
+		const int64_t nread = stream->read(read.ptr() + offset, (int64_t)read.size() - offset);
+		if (nread <= 0)
+			return false;
+		offset += nread;
+	}
+	return std::memcmp(read.c_ptr(), data.c_ptr(), data.size()) == 0;
+}
+
+bool checkData(const IBlob* blob, const AlignedVector< uint8_t >& data)
+{
+	if (!blob || blob->size() != (int64_t)data.size())
+		return false;
+
+	Ref< IStream > stream = blob->read();
+	return checkStream(stream, data);
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.avalanche.test.CaseDictionary", 0, CaseDictionary, traktor::test::Case)
+
+void CaseDictionary::run()
+{
+	removeBlobs();
+
+	uint32_t remaining = 0;
+	{
+		Ref< Dictionary > dictionary = new Dictionary();
+		CASE_ASSERT(dictionary->create(c_blobsPath, c_memoryBudget, c_diskQuota));
+
+		for (int32_t i = 0; i < c_blobCount; ++i)
+			CASE_ASSERT(putBlob(dictionary, Key(1, 2, 3, i + 1), (uint8_t)i));
+
+		// New blobs are in both tiers.
+		Dictionary::Stats stats;
+		dictionary->getStats(stats);
+		CASE_ASSERT_EQUAL(stats.blobCount, (uint32_t)c_blobCount);
+		CASE_ASSERT_EQUAL(stats.memoryTier.blobCount, (uint32_t)c_blobCount);
+		CASE_ASSERT_EQUAL(stats.diskTier.blobCount, (uint32_t)c_blobCount);
+
+		// Demote until memory tier is within budget, without evicting anything.
+		dictionary->balance(false);
+		dictionary->getStats(stats);
+		CASE_ASSERT(stats.memoryTier.size <= c_memoryBudget);
+		CASE_ASSERT(stats.demotions > 0);
+		CASE_ASSERT_EQUAL(stats.blobCount, (uint32_t)c_blobCount);
+		CASE_ASSERT_EQUAL(stats.diskTier.blobCount, (uint32_t)c_blobCount);
+
+		// First blob was least recently used; it should have been demoted, and promoted when accessed again.
+		const Key firstKey(1, 2, 3, 1);
+		CASE_ASSERT(checkBlob(dictionary->get(firstKey, false), 0));
+		CASE_ASSERT(checkBlob(dictionary->get(firstKey, false), 0));
+		CASE_ASSERT(dictionary->get(Key(4, 3, 2, 1), false) == nullptr);
+
+		dictionary->getStats(stats);
+		CASE_ASSERT_EQUAL(stats.diskTier.hits, (uint64_t)1);
+		CASE_ASSERT_EQUAL(stats.memoryTier.hits, (uint64_t)1);
+		CASE_ASSERT_EQUAL(stats.misses, (uint64_t)1);
+		CASE_ASSERT_EQUAL(stats.promotions, (uint64_t)1);
+
+		// Evict until disk tier is within quota; recently used blob should remain.
+		dictionary->balance(true);
+		dictionary->getStats(stats);
+		CASE_ASSERT(stats.diskTier.size <= c_diskQuota);
+		CASE_ASSERT(stats.evictions > 0);
+		CASE_ASSERT_EQUAL(stats.blobCount + (uint32_t)stats.evictions, (uint32_t)c_blobCount);
+		CASE_ASSERT(checkBlob(dictionary->get(firstKey, true), 0));
+		CASE_ASSERT(checkBlob(dictionary->get(Key(1, 2, 3, c_blobCount), true), (uint8_t)(c_blobCount - 1)));
+
+		remaining = stats.blobCount;
+	}
+
+	// Reopen; all remaining blobs should be loaded into disk tier.
+	{
+		Ref< Dictionary > dictionary = new Dictionary();
+		CASE_ASSERT(dictionary->create(c_blobsPath, c_memoryBudget, c_diskQuota));
+
+		Dictionary::Stats stats;
+		dictionary->getStats(stats);
+		CASE_ASSERT_EQUAL(stats.blobCount, remaining);
+		CASE_ASSERT_EQUAL(stats.diskTier.blobCount, remaining);
+		CASE_ASSERT_EQUAL(stats.memoryTier.blobCount, (uint32_t)0);
+		CASE_ASSERT(checkBlob(dictionary->get(Key(1, 2, 3, 1), false), 0));
+	}
+
+	// Memory only; memory budget is quota.
+	{
+		Ref< Dictionary > dictionary = new Dictionary();
+		CASE_ASSERT(dictionary->create(L"", c_memoryBudget, c_diskQuota));
+
+		for (int32_t i = 0; i < c_blobCount; ++i)
+			CASE_ASSERT(putBlob(dictionary, Key(1, 2, 3, i + 1), (uint8_t)i));
+
+		dictionary->balance(true);
+
+		Dictionary::Stats stats;
+		dictionary->getStats(stats);
+		CASE_ASSERT(stats.memoryTier.size <= c_memoryBudget);
+		CASE_ASSERT_EQUAL(stats.diskTier.blobCount, (uint32_t)0);
+		CASE_ASSERT_EQUAL(stats.blobCount + (uint32_t)stats.evictions, (uint32_t)c_blobCount);
+		CASE_ASSERT(checkBlob(dictionary->get(Key(1, 2, 3, c_blobCount), true), (uint8_t)(c_blobCount - 1)));
+	}
+
+	// Similar blobs share chunks on disk.
+	removeBlobs();
+	{
+		AlignedVector< uint8_t > first(512 * 1024);
+		uint32_t seed = 1234;
+		for (auto& v : first)
+		{
+			seed = seed * 1664525 + 1013904223;
+			v = (uint8_t)(seed >> 24);
+		}
+
+		// Insertion only affect chunk(s) near insertion.
+		AlignedVector< uint8_t > second = first;
+		const uint8_t inserted[100] = { 0x55 };
+		second.insert(second.begin() + 200 * 1024, inserted, inserted + sizeof(inserted));
+
+		Ref< Dictionary > dictionary = new Dictionary();
+		CASE_ASSERT(dictionary->create(c_blobsPath, 1024 * 1024 * 1024, 1024 * 1024 * 1024));
+		CASE_ASSERT(putData(dictionary, Key(2, 0, 0, 1), first));
+		CASE_ASSERT(putData(dictionary, Key(2, 0, 0, 2), second));
+
+		Dictionary::Stats stats;
+		dictionary->getStats(stats);
+		CASE_ASSERT_EQUAL(stats.chunkedSize, (uint64_t)(first.size() + second.size()));
+		CASE_ASSERT(stats.dedupRatio() > 1.5);
+		const uint32_t chunkCount = stats.chunkCount;
+
+		// Removing a blob only remove chunks not shared with other blob.
+		CASE_ASSERT(dictionary->remove(Key(2, 0, 0, 1)));
+		dictionary->getStats(stats);
+		CASE_ASSERT(stats.chunkCount < chunkCount);
+		CASE_ASSERT(stats.chunkCount > chunkCount / 2);
+		CASE_ASSERT(checkData(dictionary->get(Key(2, 0, 0, 2), true), second));
+
+		// Reopen; chunks are referenced by loaded blob.
+		dictionary = new Dictionary();
+		CASE_ASSERT(dictionary->create(c_blobsPath, 1024 * 1024 * 1024, 1024 * 1024 * 1024));
+		Dictionary::Stats reopenedStats;
+		dictionary->getStats(reopenedStats);
+		CASE_ASSERT_EQUAL(reopenedStats.blobCount, (uint32_t)1);
+		CASE_ASSERT_EQUAL(reopenedStats.chunkCount, stats.chunkCount);
+
+		// Chunks of a removed blob are kept until open stream of blob is closed.
+		Ref< IBlob > removed = dictionary->get(Key(2, 0, 0, 2), true);
+		CASE_ASSERT(removed != nullptr);
+		Ref< IStream > removedStream = removed->read();
+		CASE_ASSERT(checkData(dictionary->get(Key(2, 0, 0, 2), false), second));
+		CASE_ASSERT(dictionary->remove(Key(2, 0, 0, 2)));
+		dictionary->getStats(reopenedStats);
+		CASE_ASSERT_EQUAL(reopenedStats.chunkCount, stats.chunkCount);
+		CASE_ASSERT(checkStream(removedStream, second));
+		removedStream->close();
+		dictionary->getStats(reopenedStats);
+		CASE_ASSERT_EQUAL(reopenedStats.chunkCount, (uint32_t)0);
+	}
+
+	removeBlobs();
+}
+
+}
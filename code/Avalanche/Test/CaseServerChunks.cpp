@@ -0,0 +1,207 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cstring>
+#include "Avalanche/Dictionary.h"
+#include "Avalanche/Protocol.h"
+#include "Avalanche/Client/Client.h"
+#include "Avalanche/Server/Server.h"
+#include "Avalanche/Test/CaseServerChunks.h"
+#include "Core/Io/FileSystem.h"
+#include "Core/Io/IStream.h"
+#include "Core/Settings/PropertyBoolean.h"
+#include "Core/Settings/PropertyGroup.h"
+#include "Core/Settings/PropertyInteger.h"
+#include "Core/Settings/PropertyString.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
+#include "Net/SocketAddressIPv4.h"
+#include "Net/SocketStream.h"
+#include "Net/TcpSocket.h"
+
+namespace traktor::avalanche::test
+{
+	namespace
+	{
+
+const wchar_t* c_blobsPath = L"CaseServerChunks.blobs";
+const int32_t c_blobSize = 1024 * 1024;
+const int32_t c_insertOffset = 300 * 1024;
+const int32_t c_insertSize = 100;
+
+void clearDirectory(const std::wstring& path)
+{
+	RefArray< File > files = FileSystem::getInstance().find(path + L"/*.*");
+	for (auto file : files)
+	{
+		const Path filePath = file->getPath();
+		if (filePath.getFileName() == L"." || filePath.getFileName() == L"..")
+			continue;
+		if (file->isDirectory())
+		{
+			clearDirectory(filePath.getPathName());
+			FileSystem::getInstance().removeDirectory(filePath);
+		}
+		else
+			FileSystem::getInstance().remove(filePath);
+	}
+}
+
+bool putBlob(Client* client, const Key& key, const AlignedVector< uint8_t >& data)
+{
+	Ref< IStream > s = client->put(key);
+	if (!s)
+		return false;
+
+	// Write in pieces not aligned to chunks.
+	for (int32_t offset = 0; offset < (int32_t)data.size(); )
+	{
+		const int32_t nwrite = std::min< int32_t >(10000, (int32_t)data.size() - offset);
+		if (s->write(data.c_ptr() + offset, nwrite) != nwrite)
+			return false;
+		offset += nwrite;
+	}
+
+	s->close();
+	return true;
+}
+
+bool checkBlob(Client* client, const Key& key, const AlignedVector< uint8_t >& data)
+{
+	Ref< IStream > s = client->get(key);
+	if (!s || s->available() != (int64_t)data.size())
+		return false;
+
+	AlignedVector< uint8_t > blob(data.size());
+	for (int64_t offset = 0; offset < (int64_t)blob.size(); )
+	{
+		const int64_t nread = s->read(blob.ptr() + offset, (int64_t)blob.size() - offset);
+		if (nread <= 0)
+			return false;
+		offset += nread;
+	}
+
+	s->close();
+	return std::memcmp(blob.c_ptr(), data.c_ptr(), data.size()) == 0;
+}
+
+/*! Put a chunk which content doesn't match key, true if server reject it. */
+bool putMismatchRejected(int32_t port, const Key& key, const AlignedVector< uint8_t >& data)
+{
+	Ref< net::TcpSocket > socket = new net::TcpSocket();
+	if (!socket->connect(net::SocketAddressIPv4(L"localhost", port)))
+		return false;
+
+	Ref< net::SocketStream > stream = new net::SocketStream(socket, true, true, 5000);
+	uint8_t reply = 0;
+	if (
+		stream->write(&c_commandPut, sizeof(uint8_t)) != sizeof(uint8_t) ||
+		!key.write(stream) ||
+		stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t) ||
+		reply != c_replyOk
+	)
+		return false;
+
+	const uint32_t nchunks = 1;
+	const uint32_t chunkSize = 1000;
+	if (
+		stream->write(&c_subCommandPutChunks, sizeof(uint8_t)) != sizeof(uint8_t) ||
+		stream->write(&nchunks, sizeof(uint32_t)) != sizeof(uint32_t) ||
+		!Key(9, 9, 9, 9).write(stream) ||
+		stream->write(&chunkSize, sizeof(uint32_t)) != sizeof(uint32_t) ||
+		stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t) ||
+		reply != c_replyContinue ||
+		stream->write(data.c_ptr(), chunkSize) != chunkSize
+	)
+		return false;
+
+	// Server should have terminated connection, thus no reply to commit.
+	stream->write(&c_subCommandPutCommit, sizeof(uint8_t));
+	return stream->read(&reply, sizeof(uint8_t)) != sizeof(uint8_t);
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.avalanche.test.CaseServerChunks", 0, CaseServerChunks, traktor::test::Case)
+
+void CaseServerChunks::run()
+{
+	const bool modes[] = { false, true };
+	int32_t port = 20020;
+
+	// Second blob is same as first but with a few bytes inserted.
+	AlignedVector< uint8_t > first(c_blobSize);
+	uint32_t seed = 1234;
+	for (int32_t i = 0; i < c_blobSize; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		first[i] = (uint8_t)(seed >> 24);
+	}
+
+	AlignedVector< uint8_t > second = first;
+	const uint8_t inserted[c_insertSize] = { 0x55 };
+	second.insert(second.begin() + c_insertOffset, inserted, inserted + c_insertSize);
+
+	for (auto reactor : modes)
+	{
+		clearDirectory(c_blobsPath);
+
+		Ref< PropertyGroup > settings = new PropertyGroup();
+		settings->setProperty< PropertyInteger >(L"Avalanche.Port", port);
+		settings->setProperty< PropertyBoolean >(L"Avalanche.Reactor", reactor);
+		settings->setProperty< PropertyString >(L"Avalanche.Path", c_blobsPath);
+
+		Ref< Server > server = new Server();
+		CASE_ASSERT(server->create(settings));
+
+		Thread* serverThread = ThreadManager::getInstance().create([&](){
+			while (!serverThread->stopped())
+				server->update();
+		});
+		CASE_ASSERT(serverThread != nullptr);
+		if (serverThread == nullptr)
+			return;
+
+		serverThread->start();
+
+		Ref< Client > client = new Client(net::SocketAddressIPv4(L"localhost", port));
+
+		CASE_ASSERT(putBlob(client, Key(1, 0, 0, 1), first));
+		CASE_ASSERT(putBlob(client, Key(1, 0, 0, 2), second));
+
+		CASE_ASSERT(checkBlob(client, Key(1, 0, 0, 1), first));
+		CASE_ASSERT(checkBlob(client, Key(1, 0, 0, 2), second));
+
+		// Only chunks around inserted bytes differ, thus stored once.
+		Dictionary::Stats stats;
+		CASE_ASSERT(client->tierStats(stats));
+		CASE_ASSERT_EQUAL(stats.blobCount, (uint32_t)2);
+		CASE_ASSERT_EQUAL(stats.chunkedSize, (uint64_t)(first.size() + second.size()));
+		CASE_ASSERT(stats.chunkSize < (uint64_t)(first.size() + first.size() / 2));
+		CASE_ASSERT(stats.dedupRatio() > 1.5);
+
+		// Chunks received from client must match their keys.
+		CASE_ASSERT(putMismatchRejected(port, Key(1, 0, 0, 3), first));
+		CASE_ASSERT(!client->have(Key(1, 0, 0, 3)));
+
+		client->destroy();
+
+		serverThread->stop();
+		ThreadManager::getInstance().destroy(serverThread);
+
+		server->destroy();
+		server = nullptr;
+
+		++port;
+	}
+
+	clearDirectory(c_blobsPath);
+	FileSystem::getInstance().removeDirectory(c_blobsPath);
+}
+
+}
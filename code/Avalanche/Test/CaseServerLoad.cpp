@@ -0,0 +1,251 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include "Avalanche/Protocol.h"
+#include "Avalanche/Client/Client.h"
+#include "Avalanche/Server/Server.h"
+#include "Avalanche/Test/CaseServerLoad.h"
+#include "Core/Io/IStream.h"
+#include "Core/Log/Log.h"
+#include "Core/Settings/PropertyBoolean.h"
+#include "Core/Settings/PropertyGroup.h"
+#include "Core/Settings/PropertyInteger.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
+#include "Core/Timer/Timer.h"
+#include "Net/SocketAddressIPv4.h"
+#include "Net/SocketStream.h"
+#include "Net/TcpSocket.h"
+
+namespace traktor::avalanche::test
+{
+	namespace
+	{
+
+const int32_t c_clientCounts[] = { 1, 8, 32, 128 };
+const int32_t c_operationsPerClient = 100;
+const int32_t c_blobSize = 16 * 1024;
+const int32_t c_pipelinedRequests = 64;
+
+struct Measurement
+{
+	double throughput = 0.0;
+	double p99 = 0.0;
+};
+
+Measurement measure(AlignedVector< double >& latencies, double duration)
+{
+	Measurement m;
+	if (latencies.empty() || duration <= 0.0)
+		return m;
+
+	std::sort(latencies.begin(), latencies.end());
+	m.throughput = latencies.size() / duration;
+	m.p99 = latencies[std::min< size_t >((size_t)(latencies.size() * 0.99), latencies.size() - 1)];
+	return m;
+}
+
+/*! Run operation from each client concurrently, return wall time of all operations. */
+double runClients(int32_t clientCount, const std::function< void (int32_t, AlignedVector< double >&) >& fn, AlignedVector< double >& outLatencies)
+{
+	AlignedVector< AlignedVector< double > > latencies(clientCount);
+	AlignedVector< Thread* > threads;
+
+	Timer timer;
+	for (int32_t i = 0; i < clientCount; ++i)
+	{
+		Thread* thread = ThreadManager::getInstance().create([&, i]() { fn(i, latencies[i]); }, L"Avalanche load client");
+		if (thread)
+		{
+			thread->start();
+			threads.push_back(thread);
+		}
+	}
+	for (auto thread : threads)
+	{
+		thread->stop();
+		ThreadManager::getInstance().destroy(thread);
+	}
+	const double duration = timer.getElapsedTime();
+
+	for (const auto& l : latencies)
+		outLatencies.insert(outLatencies.end(), l.begin(), l.end());
+
+	return duration;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.avalanche.test.CaseServerLoad", 0, CaseServerLoad, traktor::test::Case)
+
+void CaseServerLoad::run()
+{
+	const bool modes[] = { false, true };
+	int32_t port = 20010;
+
+	AlignedVector< uint8_t > blob(c_blobSize);
+	for (int32_t i = 0; i < c_blobSize; ++i)
+		blob[i] = (uint8_t)i;
+
+	for (auto reactor : modes)
+	{
+		const wchar_t* modeName = reactor ? L"reactor" : L"thread per connection";
+
+		Ref< PropertyGroup > settings = new PropertyGroup();
+		settings->setProperty< PropertyInteger >(L"Avalanche.Port", port);
+		settings->setProperty< PropertyBoolean >(L"Avalanche.Reactor", reactor);
+
+		Ref< Server > server = new Server();
+		CASE_ASSERT(server->create(settings));
+
+		Thread* serverThread = ThreadManager::getInstance().create([&](){
+			while (!serverThread->stopped())
+				server->update();
+		});
+		CASE_ASSERT(serverThread != nullptr);
+		if (serverThread == nullptr)
+			return;
+
+		serverThread->start();
+
+		const net::SocketAddressIPv4 serverAddress(L"localhost", port);
+		std::atomic< int32_t > failures = 0;
+		uint32_t keyBase = 1;
+
+		for (auto clientCount : c_clientCounts)
+		{
+			RefArray< Client > clients;
+			for (int32_t i = 0; i < clientCount; ++i)
+				clients.push_back(new Client(serverAddress));
+
+			AlignedVector< double > putLatencies;
+			const double putDuration = runClients(clientCount, [&](int32_t client, AlignedVector< double >& outLatencies) {
+				for (int32_t i = 0; i < c_operationsPerClient; ++i)
+				{
+					Timer timer;
+					Ref< IStream > s = clients[client]->put(Key(keyBase, client, i, 1));
+					if (!s || s->write(blob.c_ptr(), c_blobSize) != c_blobSize)
+					{
+						failures++;
+						continue;
+					}
+					s->close();
+					outLatencies.push_back(timer.getElapsedTime());
+				}
+			}, putLatencies);
+
+			AlignedVector< double > getLatencies;
+			const double getDuration = runClients(clientCount, [&](int32_t client, AlignedVector< double >& outLatencies) {
+				AlignedVector< uint8_t > data(c_blobSize);
+				for (int32_t i = 0; i < c_operationsPerClient; ++i)
+				{
+					Timer timer;
+					Ref< IStream > s = clients[client]->get(Key(keyBase, client, i, 1));
+					if (!s || s->read(data.ptr(), c_blobSize) != c_blobSize || data[c_blobSize - 1] != blob[c_blobSize - 1])
+					{
+						failures++;
+						continue;
+					}
+					s->close();
+					outLatencies.push_back(timer.getElapsedTime());
+				}
+			}, getLatencies);
+
+			const Measurement put = measure(putLatencies, putDuration);
+			const Measurement get = measure(getLatencies, getDuration);
+			log::info << L"Avalanche (" << modeName << L"), " << clientCount << L" client(s): PUT " << int32_t(put.throughput) << L" op/s, p99 " << int32_t(put.p99 * 1e6) << L" us; GET " << int32_t(get.throughput) << L" op/s, p99 " << int32_t(get.p99 * 1e6) << L" us" << Endl;
+
+			for (auto client : clients)
+				client->destroy();
+
+			keyBase++;
+		}
+
+		CASE_ASSERT_EQUAL((int32_t)failures, 0);
+
+		// Send several requests at once without waiting for replies.
+		{
+			Ref< net::TcpSocket > socket = new net::TcpSocket();
+			CASE_ASSERT(socket->connect(serverAddress));
+
+			AlignedVector< uint8_t > requests;
+			for (int32_t i = 0; i < c_pipelinedRequests; ++i)
+			{
+				const uint32_t kv[] = { 2, (uint32_t)i % 8, (uint32_t)i, 1 };
+				requests.push_back(c_commandPing);
+				requests.push_back(c_commandStat);
+				requests.insert(requests.end(), (const uint8_t*)kv, (const uint8_t*)kv + sizeof(kv));
+			}
+
+			net::SocketStream stream(socket, true, true, 5000);
+			CASE_ASSERT_EQUAL(stream.write(requests.c_ptr(), requests.size()), (int64_t)requests.size());
+
+			int32_t replies = 0;
+			for (int32_t i = 0; i < c_pipelinedRequests; ++i)
+			{
+				uint8_t pingReply = 0, statReply = 0;
+				int64_t blobSize = 0;
+				if (
+					stream.read(&pingReply, sizeof(uint8_t)) == sizeof(uint8_t) &&
+					stream.read(&statReply, sizeof(uint8_t)) == sizeof(uint8_t) &&
+					stream.read(&blobSize, sizeof(int64_t)) == sizeof(int64_t) &&
+					pingReply == c_replyOk &&
+					statReply == c_replyOk &&
+					blobSize == c_blobSize
+				)
+					++replies;
+			}
+			CASE_ASSERT_EQUAL(replies, c_pipelinedRequests);
+
+			socket->close();
+		}
+
+		// Stat and get several blobs in single requests, last key is missing.
+		{
+			Ref< Client > client = new Client(serverAddress);
+
+			AlignedVector< Key > keys;
+			for (int32_t i = 0; i < c_pipelinedRequests; ++i)
+				keys.push_back(Key(2, (uint32_t)i % 8, (uint32_t)i, 1));
+			keys.push_back(Key(100, 0, 0, 1));
+
+			AlignedVector< int64_t > blobSizes;
+			CASE_ASSERT(client->statMany(keys, blobSizes));
+			CASE_ASSERT_EQUAL((int32_t)blobSizes.size(), (int32_t)keys.size());
+			CASE_ASSERT_EQUAL(std::count(blobSizes.begin(), blobSizes.end(), (int64_t)c_blobSize), c_pipelinedRequests);
+			CASE_ASSERT_EQUAL(blobSizes.back(), (int64_t)-1);
+
+			int32_t received = 0;
+			int32_t missing = 0;
+			AlignedVector< uint8_t > data(c_blobSize);
+			CASE_ASSERT(client->getMany(keys, [&](uint32_t index, IStream* stream) {
+				if (!stream)
+					++missing;
+				else if (stream->read(data.ptr(), c_blobSize) == c_blobSize && data[c_blobSize - 1] == blob[c_blobSize - 1])
+					++received;
+			}));
+			CASE_ASSERT_EQUAL(received, c_pipelinedRequests);
+			CASE_ASSERT_EQUAL(missing, 1);
+
+			client->destroy();
+		}
+
+		serverThread->stop();
+		ThreadManager::getInstance().destroy(serverThread);
+
+		server->destroy();
+		server = nullptr;
+
+		++port;
+	}
+}
+
+}
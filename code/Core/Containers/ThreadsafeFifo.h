@@ -40,6 +40,24 @@ public:
 			return false;
 	}
 
+	/*! Get newest item matching predicate, other items are kept in place. */
+	template < typename PredicateType >
+	bool get(T& item, const PredicateType& predicate)
+	{
+		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
+		for (auto it = m_fifo.end(); it != m_fifo.begin(); )
+		{
+			--it;
+			if (predicate(*it))
+			{
+				item = *it;
+				m_fifo.erase(it);
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void clear()
 	{
 		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
@@ -108,6 +108,8 @@ void* TrackAllocator::alloc(size_t size, size_t align, const char* const tag)
 	stats.count++;
 	stats.memory += size;
 
+	m_allocationCount++;
+	m_allocatedBytes += (int64_t)size;
 	return ptr;
 }
 
@@ -119,6 +121,8 @@ void TrackAllocator::free(void* ptr)
 	if (i != m_aliveBlocks.end())
 	{
 		Block toBeFreed = i->second; (void)toBeFreed;
+		m_freeCount++;
+		m_allocatedBytes -= (int64_t)toBeFreed.size;
 		m_aliveBlocks.erase(i);
 	}
 	else
@@ -8,10 +8,19 @@
  */
 #pragma once
 
+#include <atomic>
 #include <map>
 #include "Core/Memory/IAllocator.h"
 #include "Core/Thread/Semaphore.h"
 
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_CORE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
 namespace traktor
 {
 
@@ -22,7 +31,7 @@ namespace traktor
  * allocator. It will keep a "live"-list to track
  * memory leaks.
  */
-class TrackAllocator : public IAllocator
+class T_DLLCLASS TrackAllocator : public IAllocator
 {
 public:
 	explicit TrackAllocator(IAllocator* systemAllocator);
@@ -33,6 +42,15 @@ public:
 
 	virtual void free(void* ptr) override final;
 
+	/*! Get total number of allocations made. */
+	int64_t getAllocationCount() const { return m_allocationCount; }
+
+	/*! Get total number of allocations freed. */
+	int64_t getFreeCount() const { return m_freeCount; }
+
+	/*! Get number of bytes currently allocated. */
+	int64_t getAllocatedBytes() const { return m_allocatedBytes; }
+
 private:
 	struct Block
 	{
@@ -54,6 +72,9 @@ private:
 	IAllocator* m_systemAllocator;
 	std::map< void*, Block > m_aliveBlocks;
 	std::map< void*, Stats > m_allocStats;
+	std::atomic< int64_t > m_allocationCount = 0;
+	std::atomic< int64_t > m_freeCount = 0;
+	std::atomic< int64_t > m_allocatedBytes = 0;
 };
 
 }
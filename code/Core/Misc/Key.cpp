@@ -60,6 +60,16 @@ bool Key::write(IStream* stream) const
 	return stream->write(kv, sizeof(kv)) == sizeof(kv);
 }
 
+uint32_t Key::hash() const
+{
+	const auto [k0, k1, k2, k3] = m_kv;
+	uint32_t h = k0;
+	h = (h ^ k1) * 0x9e3779b1;
+	h = (h ^ k2) * 0x85ebca6b;
+	h = (h ^ k3) * 0xc2b2ae35;
+	return h ^ (h >> 16);
+}
+
 bool Key::operator == (const Key& rh) const
 {
 	return m_kv == rh.m_kv;
@@ -45,6 +45,9 @@ public:
 
 	bool write(IStream* stream) const;
 
+	/*! Get hash of key, suitable for hash tables. */
+	uint32_t hash() const;
+
 	bool operator == (const Key& rh) const;
 
 	bool operator < (const Key& rh) const;
@@ -50,9 +50,24 @@ void Murmur3::feedBuffer(const void* buffer, uint64_t bufferSize)
     if (!buffer)
         return;
 
-    while (key < &start[bufferSize])
+    const uint8_t* end = &start[bufferSize];
+    while (key < end)
     {
-        while (m_ndata < 4 && key < &start[bufferSize])
+        // Scramble whole words directly from buffer when no bytes are pending.
+        if (m_ndata == 0)
+        {
+            for (; key + 4 <= end; key += 4)
+            {
+                std::memcpy(&k, key, sizeof(uint32_t));
+                m_h ^= murmur_32_scramble(k);
+                m_h = (m_h << 13) | (m_h >> 19);
+                m_h = m_h * 5 + 0xe6546b64;
+            }
+            if (key >= end)
+                break;
+        }
+
+        while (m_ndata < 4 && key < end)
         {
             m_data[m_ndata] = *key++;
             m_ndata++;
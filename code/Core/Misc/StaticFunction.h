@@ -0,0 +1,190 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Core/Config.h"
+
+namespace traktor
+{
+
+template < typename Signature, size_t Size >
+class StaticFunction;
+
+/*! Fixed size function wrapper.
+ * \ingroup Core
+ *
+ * Similar to std::function but captured state is always
+ * stored inline, thus never allocates any memory.
+ * Functors which doesn't fit are rejected at compile time.
+ */
+template < typename ReturnType, typename ... ArgumentTypes, size_t Size >
+class StaticFunction< ReturnType(ArgumentTypes...), Size >
+{
+public:
+	static constexpr size_t Alignment = 16;
+
+	template < typename FunctorType >
+	static constexpr bool fits = (sizeof(FunctorType) <= Size && alignof(FunctorType) <= Alignment);
+
+	StaticFunction() = default;
+
+	StaticFunction(std::nullptr_t)
+	{
+	}
+
+	template < typename FunctorType, typename = std::enable_if_t< !std::is_same_v< std::decay_t< FunctorType >, StaticFunction > > >
+	StaticFunction(FunctorType&& functor)
+	{
+		assign(std::forward< FunctorType >(functor));
+	}
+
+	StaticFunction(const StaticFunction& src)
+	{
+		if (src.m_manage)
+			src.m_manage(m_storage, const_cast< uint8_t* >(src.m_storage), Operation::Copy);
+		m_invoke = src.m_invoke;
+		m_manage = src.m_manage;
+	}
+
+	StaticFunction(StaticFunction&& src) noexcept
+	{
+		if (src.m_manage)
+			src.m_manage(m_storage, src.m_storage, Operation::Move);
+		m_invoke = src.m_invoke;
+		m_manage = src.m_manage;
+		src.reset();
+	}
+
+	~StaticFunction()
+	{
+		reset();
+	}
+
+	/*! Release captured state. */
+	void reset()
+	{
+		if (m_manage)
+			m_manage(m_storage, nullptr, Operation::Destroy);
+		m_invoke = nullptr;
+		m_manage = nullptr;
+	}
+
+	ReturnType operator () (ArgumentTypes ... args) const
+	{
+		T_ASSERT(m_invoke != nullptr);
+		return m_invoke(const_cast< uint8_t* >(m_storage), std::forward< ArgumentTypes >(args) ...);
+	}
+
+	explicit operator bool () const
+	{
+		return m_invoke != nullptr;
+	}
+
+	StaticFunction& operator = (std::nullptr_t)
+	{
+		reset();
+		return *this;
+	}
+
+	template < typename FunctorType, typename = std::enable_if_t< !std::is_same_v< std::decay_t< FunctorType >, StaticFunction > > >
+	StaticFunction& operator = (FunctorType&& functor)
+	{
+		reset();
+		assign(std::forward< FunctorType >(functor));
+		return *this;
+	}
+
+	StaticFunction& operator = (const StaticFunction& src)
+	{
+		if (this != &src)
+		{
+			reset();
+			if (src.m_manage)
+				src.m_manage(m_storage, const_cast< uint8_t* >(src.m_storage), Operation::Copy);
+			m_invoke = src.m_invoke;
+			m_manage = src.m_manage;
+		}
+		return *this;
+	}
+
+	StaticFunction& operator = (StaticFunction&& src) noexcept
+	{
+		if (this != &src)
+		{
+			reset();
+			if (src.m_manage)
+				src.m_manage(m_storage, src.m_storage, Operation::Move);
+			m_invoke = src.m_invoke;
+			m_manage = src.m_manage;
+			src.reset();
+		}
+		return *this;
+	}
+
+private:
+	enum class Operation
+	{
+		Copy,
+		Move,
+		Destroy
+	};
+
+	typedef ReturnType (*invoke_fn_t)(void* storage, ArgumentTypes&& ... args);
+	typedef void (*manage_fn_t)(void* storage, void* source, Operation operation);
+
+	alignas(Alignment) uint8_t m_storage[Size];
+	invoke_fn_t m_invoke = nullptr;
+	manage_fn_t m_manage = nullptr;
+
+	template < typename FunctorType >
+	void assign(FunctorType&& functor)
+	{
+		typedef std::decay_t< FunctorType > functor_t;
+		static_assert(fits< functor_t >, "Functor too large for StaticFunction");
+
+		if constexpr (std::is_pointer_v< functor_t > || std::is_member_pointer_v< functor_t >)
+		{
+			if (!functor)
+				return;
+		}
+		else if constexpr (std::is_constructible_v< bool, const functor_t& >)
+		{
+			// Empty std::function etc.
+			if (!static_cast< bool >(functor))
+				return;
+		}
+
+		new (m_storage) functor_t(std::forward< FunctorType >(functor));
+
+		m_invoke = [](void* storage, ArgumentTypes&& ... args) -> ReturnType {
+			return (*static_cast< functor_t* >(storage))(std::forward< ArgumentTypes >(args) ...);
+		};
+
+		m_manage = [](void* storage, void* source, Operation operation) {
+			switch (operation)
+			{
+			case Operation::Copy:
+				new (storage) functor_t(*static_cast< const functor_t* >(source));
+				break;
+			case Operation::Move:
+				new (storage) functor_t(std::move(*static_cast< functor_t* >(source)));
+				break;
+			case Operation::Destroy:
+				static_cast< functor_t* >(storage)->~functor_t();
+				break;
+			}
+		};
+	}
+};
+
+}
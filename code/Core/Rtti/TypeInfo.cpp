@@ -104,6 +104,8 @@ void __registerTypeInfo(const TypeInfo* typeInfo)
 #endif
 }
 
+void __evictTypePlan(const TypeInfo* typeInfo);
+
 void __unregisterTypeInfo(const TypeInfo* typeInfo)
 {
 	const wchar_t* typeName = typeInfo->getName();
@@ -152,6 +154,7 @@ TypeInfo::TypeInfo(
 TypeInfo::~TypeInfo()
 {
 	__unregisterTypeInfo(this);
+	__evictTypePlan(this);
 	if (m_factory)
 		delete m_factory;
 }
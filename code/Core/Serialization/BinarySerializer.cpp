@@ -11,6 +11,7 @@
 #include <cstring>
 #include <limits>
 #include <sstream>
+#include <type_traits>
 #include "Core/Guid.h"
 #include "Core/Io/IStream.h"
 #include "Core/Io/Path.h"
@@ -32,97 +33,236 @@
 
 namespace traktor
 {
+
+/*! Stream access through a block buffer.
+ *
+ * While serializing objects primitives are read ahead, or
+ * combined when written, in blocks instead of through one
+ * virtual stream call each. Surplus read ahead is returned
+ * to stream, by seeking back, when outer most object has
+ * been read; thus stream is read ahead only if seekable.
+ */
+class BinarySerializer::BlockStream
+{
+public:
+	explicit BlockStream(IStream* stream)
+	:	m_stream(stream)
+	,	m_reading(stream->canRead())
+	,	m_canSeek(stream->canSeek())
+	{
+	}
+
+	void beginObject()
+	{
+		++m_depth;
+	}
+
+	bool endObject()
+	{
+		return --m_depth > 0 || flush();
+	}
+
+	int64_t read(void* block, int64_t nbytes)
+	{
+		if (m_position + nbytes <= m_size)
+		{
+			std::memcpy(block, &m_data[m_position], (size_t)nbytes);
+			m_position += nbytes;
+			return nbytes;
+		}
+		else
+			return readBlock(static_cast< uint8_t* >(block), nbytes);
+	}
+
+	int64_t write(const void* block, int64_t nbytes)
+	{
+		if (m_depth > 0 && m_size + nbytes <= c_blockSize)
+		{
+			std::memcpy(&m_data[m_size], block, (size_t)nbytes);
+			m_size += nbytes;
+			return nbytes;
+		}
+		else
+			return writeBlock(block, nbytes);
+	}
+
+private:
+	constexpr static int64_t c_blockSize = 4096;
+
+	Ref< IStream > m_stream;
+	bool m_reading;
+	bool m_canSeek;
+	int32_t m_depth = 0;
+	int64_t m_position = 0;
+	int64_t m_size = 0;
+	uint8_t m_data[c_blockSize];
+
+	int64_t readBlock(uint8_t* block, int64_t nbytes)
+	{
+		const int64_t nbuffered = m_size - m_position;
+		if (nbuffered > 0)
+			std::memcpy(block, &m_data[m_position], (size_t)nbuffered);
+
+		m_position = m_size = 0;
+
+		const int64_t nremaining = nbytes - nbuffered;
+		if (m_depth > 0 && m_canSeek && nremaining < c_blockSize)
+		{
+			const int64_t nread = m_stream->read(m_data, c_blockSize);
+			if (nread <= 0)
+				return nbuffered;
+
+			m_size = nread;
+			m_position = std::min(nremaining, nread);
+			std::memcpy(block + nbuffered, m_data, (size_t)m_position);
+			return nbuffered + m_position;
+		}
+		else
+		{
+			const int64_t nread = m_stream->read(block + nbuffered, nremaining);
+			return nbuffered + std::max< int64_t >(nread, 0);
+		}
+	}
+
+	int64_t writeBlock(const void* block, int64_t nbytes)
+	{
+		if (!flush())
+			return 0;
+
+		if (m_depth > 0 && nbytes < c_blockSize)
+		{
+			std::memcpy(m_data, block, (size_t)nbytes);
+			m_size = nbytes;
+			return nbytes;
+		}
+		else
+			return m_stream->write(block, nbytes);
+	}
+
+	bool flush()
+	{
+		bool result = true;
+		if (m_reading)
+		{
+			if (m_position < m_size)
+				result = m_stream->seek(IStream::SeekCurrent, m_position - m_size) >= 0;
+		}
+		else
+		{
+			if (m_size > 0)
+				result = m_stream->write(m_data, m_size) == m_size;
+		}
+		m_position = m_size = 0;
+		return result;
+	}
+};
+
 	namespace
 	{
 
 #if defined(T_LITTLE_ENDIAN)
 
-template < typename T >
-bool read_primitive(const Ref< IStream >& stream, T& value)
+template < typename T, typename StreamType >
+bool read_primitive(StreamType* stream, T& value)
 {
-	return stream->read(&value, sizeof(T)) == sizeof(T);
+	if constexpr (std::is_same_v< T, bool >)
+	{
+		uint8_t tmp;
+		if (stream->read(&tmp, 1) != 1)
+			return false;
+
+		value = bool(tmp != 0);
+		return true;
+	}
+	else
+		return stream->read(&value, sizeof(T)) == sizeof(T);
 }
 
-template < typename T >
-bool write_primitive(const Ref< IStream >& stream, T v)
+template < typename T, typename StreamType >
+bool write_primitive(StreamType* stream, T v)
 {
-	return stream->write(&v, sizeof(T)) == sizeof(T);
+	if constexpr (std::is_same_v< T, bool >)
+	{
+		uint8_t tmp = v ? 0xff : 0x00;
+		return stream->write(&tmp, 1) == 1;
+	}
+	else
+		return stream->write(&v, sizeof(T)) == sizeof(T);
 }
 
-template < typename T >
-bool read_primitives(const Ref< IStream >& stream, T* value, int count)
+template < typename T, typename StreamType >
+bool read_primitives(StreamType* stream, T* value, int count)
 {
 	return stream->read(value, sizeof(T) * count) == sizeof(T) * count;
 }
 
-template < typename T >
-bool write_primitives(const Ref< IStream >& stream, const T* value, int count)
+template < typename T, typename StreamType >
+bool write_primitives(StreamType* stream, const T* value, int count)
 {
 	return stream->write(value, sizeof(T) * count) == sizeof(T) * count;
 }
 
-inline bool read_block(const Ref< IStream >& stream, void* block, int count, int size)
+template < typename StreamType >
+inline bool read_block(StreamType* stream, void* block, int count, int size)
 {
 	return stream->read(block, count * size) == count * size;
 }
 
-inline bool write_block(const Ref< IStream >& stream, const void* block, int count, int size)
+template < typename StreamType >
+inline bool write_block(StreamType* stream, const void* block, int count, int size)
 {
 	return stream->write(block, count * size) == count * size;
 }
 
 #elif defined(T_BIG_ENDIAN)
 
-template < typename T, int Size >
-struct ReadPrimitive
+template < typename T, typename StreamType >
+bool read_primitive(StreamType* stream, T& value)
 {
-	static bool read(IStream* stream, T& t)
+	if constexpr (std::is_same_v< T, bool >)
+	{
+		uint8_t tmp;
+		if (stream->read(&tmp, 1) != 1)
+			return false;
+
+		value = bool(tmp != 0);
+		return true;
+	}
+	else if constexpr (sizeof(T) == 1)
+		return bool(stream->read(&value, 1) == 1);
+	else
 	{
-		if (stream->read(&t, sizeof(t)) == sizeof(t))
+		if (stream->read(&value, sizeof(value)) == sizeof(value))
 		{
-			swap8in64(t);
+			swap8in64(value);
 			return true;
 		}
 		else
 			return false;
 	}
-};
+}
 
-template < typename T >
-struct ReadPrimitive < T, 1 >
+template < typename T, typename StreamType >
+bool write_primitive(StreamType* stream, T v)
 {
-	static bool read(IStream* stream, T& t)
+	if constexpr (std::is_same_v< T, bool >)
 	{
-		return bool(stream->read(&t, 1) == 1);
+		uint8_t tmp = v ? 0xff : 0x00;
+		return stream->write(&tmp, 1) == 1;
 	}
-};
-
-template < typename T >
-bool read_primitive(const Ref< IStream >& stream, T& value)
-{
-	return ReadPrimitive< T, sizeof(T) >::read(stream, value);
-}
-
-template < typename T >
-bool write_primitive(const Ref< IStream >& stream, T v)
-{
-	switch (sizeof(T))
+	else if constexpr (sizeof(T) == 1)
+		return stream->write(&v, sizeof(v)) == sizeof(v);
+	else
 	{
-	case 1:
-		if (stream->write(&v, sizeof(v)) == sizeof(v))
-			return true;
-	default:
 		std::vector< uint8_t > tmp(sizeof(T));
 		std::memcpy(&tmp.front(), &v, sizeof(T));
 		std::reverse(tmp.begin(), tmp.end());
-		if (stream->write(&tmp.front(), sizeof(T)) == sizeof(T))
-			return true;
+		return stream->write(&tmp.front(), sizeof(T)) == sizeof(T);
 	}
-	return false;
 }
 
-template < typename T >
-bool read_primitives(const Ref< IStream >& stream, T* value, int count)
+template < typename T, typename StreamType >
+bool read_primitives(StreamType* stream, T* value, int count)
 {
 	for (int i = 0; i < count; ++i)
 	{
@@ -132,8 +272,8 @@ bool read_primitives(const Ref< IStream >& stream, T* value, int count)
 	return true;
 }
 
-template < typename T >
-bool write_primitives(const Ref< IStream >& stream, const T* value, int count)
+template < typename T, typename StreamType >
+bool write_primitives(StreamType* stream, const T* value, int count)
 {
 	for (int i = 0; i < count; ++i)
 	{
@@ -143,9 +283,10 @@ bool write_primitives(const Ref< IStream >& stream, const T* value, int count)
 	return true;
 }
 
-bool read_block(const Ref< IStream >& stream, void* block, int count, int size)
+template < typename StreamType >
+bool read_block(StreamType* stream, void* block, int count, int size)
 {
-	int result = stream->read(block, count * size);
+	int result = (int)stream->read(block, count * size);
 	if (result > 0 && size > 1)
 	{
 		uint8_t* p = static_cast< uint8_t* >(block);
@@ -159,7 +300,8 @@ bool read_block(const Ref< IStream >& stream, void* block, int count, int size)
 	return result == count * size;
 }
 
-bool write_block(const Ref< IStream >& stream, const void* block, int count, int size)
+template < typename StreamType >
+bool write_block(StreamType* stream, const void* block, int count, int size)
 {
 	if (size > 1)
 	{
@@ -184,27 +326,8 @@ bool write_block(const Ref< IStream >& stream, const void* block, int count, int
 
 #endif
 
-template < >
-bool read_primitive(const Ref< IStream >& stream, bool& value)
-{
-	uint8_t tmp;
-	if (stream->read(&tmp, 1) != 1)
-		return false;
-
-	value = bool(tmp != 0);
-	return true;
-}
-
-template < >
-bool write_primitive(const Ref< IStream >& stream, bool v)
-{
-	uint8_t tmp = v ? 0xff : 0x00;
-	if (stream->write(&tmp, 1) == 1)
-		return true;
-	return false;
-}
-
-bool read_string(const Ref< IStream >& stream, uint32_t u8len, std::wstring& outString)
+template < typename StreamType >
+bool read_string(StreamType* stream, uint32_t u8len, std::wstring& outString)
 {
 	if (u8len > 0)
 	{
@@ -236,7 +359,8 @@ bool read_string(const Ref< IStream >& stream, uint32_t u8len, std::wstring& out
 	return true;
 }
 
-bool read_string(const Ref< IStream >& stream, std::wstring& outString)
+template < typename StreamType >
+bool read_string(StreamType* stream, std::wstring& outString)
 {
     uint32_t u8len = 0;
 
@@ -246,7 +370,8 @@ bool read_string(const Ref< IStream >& stream, std::wstring& outString)
 	return read_string(stream, u8len, outString);
 }
 
-bool write_string(const Ref< IStream >& stream, const std::wstring& str)
+template < typename StreamType >
+bool write_string(StreamType* stream, const std::wstring& str)
 {
 	T_ASSERT(str.length() <= std::numeric_limits< uint16_t >::max());
 
@@ -280,26 +405,17 @@ bool write_string(const Ref< IStream >& stream, const std::wstring& str)
 	}
 }
 
-bool read_string(const Ref< IStream >& stream, uint32_t u8len, std::string& outString)
+template < typename StreamType >
+bool read_string(StreamType* stream, uint32_t u8len, std::string& outString)
 {
-	outString.clear();
+	outString.resize(u8len);
 	if (u8len > 0)
-	{
-		outString.reserve(u8len);
-		for (uint32_t i = 0; i < u8len; ++i)
-		{
-			uint8_t ch;
-			if (!read_primitive< uint8_t >(stream, ch))
-				return false;
-			outString += ch;
-		}
-	}
-	else
-		outString.clear();
+		return read_block(stream, &outString[0], u8len, sizeof(uint8_t));
 	return true;
 }
 
-bool read_string(const Ref< IStream >& stream, std::string& outString)
+template < typename StreamType >
+bool read_string(StreamType* stream, std::string& outString)
 {
 	uint32_t u8len;
 	if (!read_primitive< uint32_t >(stream, u8len))
@@ -307,7 +423,8 @@ bool read_string(const Ref< IStream >& stream, std::string& outString)
 	return read_string(stream, u8len, outString);
 }
 
-bool write_string(const Ref< IStream >& stream, const std::string& str)
+template < typename StreamType >
+bool write_string(StreamType* stream, const std::string& str)
 {
 	T_ASSERT(str.length() <= std::numeric_limits< uint16_t >::max());
 
@@ -337,13 +454,18 @@ T_IMPLEMENT_RTTI_CLASS(L"traktor.BinarySerializer", BinarySerializer, Serializer
 	if (failed()) return;
 
 BinarySerializer::BinarySerializer(IStream* stream)
-:	m_stream(stream)
-,	m_direction(m_stream->canRead() ? Direction::Read : Direction::Write)
+:	m_stream(new BlockStream(stream))
+,	m_direction(stream->canRead() ? Direction::Read : Direction::Write)
 ,	m_nextCacheId(1)
 ,	m_nextTypeCacheId(0)
 {
 }
 
+BinarySerializer::~BinarySerializer()
+{
+	delete m_stream;
+}
+
 Serializer::Direction BinarySerializer::getDirection() const
 {
 	return m_direction;
@@ -644,6 +766,18 @@ void BinarySerializer::operator >> (const Member< ISerializable* >& m)
 {
 	T_CHECK_STATUS;
 
+	// Objects are serialized through block buffer, which is
+	// flushed when outer most object has been serialized.
+	struct BlockScope
+	{
+		BinarySerializer& s;
+
+		explicit BlockScope(BinarySerializer& s_) : s(s_) { s.m_stream->beginObject(); }
+
+		~BlockScope() { s.ensure(s.m_stream->endObject()); }
+	}
+	blockScope(*this);
+
 	if (m_direction == Direction::Read)
 	{
 		bool reference = false;
@@ -815,38 +949,31 @@ void BinarySerializer::operator >> (const Member< ISerializable* >& m)
 				if (!write_primitive< int16_t >(m_stream, version))
 					return;
 
-				uint16_t baseVersionCount = 0;
-				for (const TypeInfo* ti = type.getSuper(); ti != 0; ti = ti->getSuper())
-				{
-					if (ti->getVersion() > 0)
-						++baseVersionCount;
-				}
+				const TypePlan& plan = getTypePlan(type);
 
+				const uint16_t baseVersionCount = (uint16_t)plan.versionedBases.size();
 				if (!write_primitive< uint16_t >(m_stream, baseVersionCount))
 					return;
 
-				for (const TypeInfo* ti = type.getSuper(); ti != 0; ti = ti->getSuper())
+				for (const TypeInfo* ti : plan.versionedBases)
 				{
-					if (ti->getVersion() > 0)
+					const auto it = m_typeWriteCache.find(ti);
+					if (it != m_typeWriteCache.end())
+						write_primitive< uint32_t >(m_stream, 0x80000000 | it->second);
+					else
 					{
-						const auto it = m_typeWriteCache.find(ti);
-						if (it != m_typeWriteCache.end())
-							write_primitive< uint32_t >(m_stream, 0x80000000 | it->second);
-						else
-						{
-							if (!write_string(m_stream, ti->getName()))
-								return;
-
-							m_typeWriteCache.insert(std::make_pair(ti, m_nextTypeCacheId++));
-						}
-
-						if (!write_primitive< int16_t >(m_stream, ti->getVersion()))
+						if (!write_string(m_stream, ti->getName()))
 							return;
+
+						m_typeWriteCache.insert(std::make_pair(ti, m_nextTypeCacheId++));
 					}
+
+					if (!write_primitive< int16_t >(m_stream, ti->getVersion()))
+						return;
 				}
 
 				m_writeCache[object] = hash;
-				serialize(object);
+				serialize(object, plan.dataVersions);
 			}
 		}
 		else
@@ -898,6 +1025,16 @@ void BinarySerializer::operator >> (const MemberArray& m)
 			return;
 
 		m.reserve(size, size);
+
+		// Plain elements are read as a single block.
+		MemberArray::Plain plain;
+		if (m.getPlain(plain) && m.size() == size)
+		{
+			if (size > 0)
+				ensure(read_block(m_stream, plain.data, size, plain.elementSize));
+			return;
+		}
+
 		for (uint32_t i = 0; i < size; ++i)
 		{
 			T_CHECK_STATUS;
@@ -911,6 +1048,14 @@ void BinarySerializer::operator >> (const MemberArray& m)
 		if (!ensure(write_primitive< uint32_t >(m_stream, size)))
 			return;
 
+		MemberArray::Plain plain;
+		if (m.getPlain(plain))
+		{
+			if (size > 0)
+				ensure(write_block(m_stream, plain.data, size, plain.elementSize));
+			return;
+		}
+
 		for (uint32_t i = 0; i < size; ++i)
 		{
 			T_CHECK_STATUS;
@@ -35,6 +35,8 @@ class T_DLLCLASS BinarySerializer : public Serializer
 public:
 	explicit BinarySerializer(IStream* stream);
 
+	virtual ~BinarySerializer();
+
 	virtual Direction getDirection() const override final;
 
 	virtual void operator>>(const Member< bool >& m) override final;
@@ -94,7 +96,9 @@ public:
 	virtual void operator>>(const MemberEnumBase& m) override final;
 
 private:
-	Ref< IStream > m_stream;
+	class BlockStream;
+
+	BlockStream* m_stream;
 	Direction m_direction;
 	SmallMap< uint64_t, Ref< ISerializable > > m_readCache;
 	SmallMap< ISerializable*, uint64_t > m_writeCache;
@@ -6,33 +6,371 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <cstring>
+#include <unordered_map>
+#include "Core/Guid.h"
+#include "Core/RefArray.h"
+#include "Core/Math/Color4f.h"
+#include "Core/Math/Color4ub.h"
+#include "Core/Math/Matrix33.h"
+#include "Core/Math/Matrix44.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector2.h"
 #include "Core/Serialization/DeepClone.h"
-#include "Core/Serialization/BinarySerializer.h"
-#include "Core/Io/DynamicMemoryStream.h"
-#include "Core/Io/MemoryStream.h"
+#include "Core/Serialization/Serializer.h"
+#include "Core/Serialization/MemberArray.h"
+#include "Core/Serialization/MemberComplex.h"
+#include "Core/Serialization/MemberEnum.h"
 
 namespace traktor
 {
 	namespace
 	{
 
-const uint32_t c_initialCapacity = 4096;	//!< Estimated initial size of clone; used to reduce number of allocation of m_copy array.
+const uint32_t c_initialCapacity = 4096;	//!< Estimated initial size of clone; used to reduce number of allocation of m_data array.
 
 	}
 
+/*! Record members of source object graph into clone storage. */
+class DeepClone::Writer : public Serializer
+{
+public:
+	explicit Writer(DeepClone& clone)
+	:	m_clone(clone)
+	{
+	}
+
+	virtual Direction getDirection() const override final
+	{
+		return Direction::Write;
+	}
+
+	virtual void operator >> (const Member< bool >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< int8_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< uint8_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< int16_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< uint16_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< int32_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< uint32_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< int64_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< uint64_t >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< float >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< double >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< std::string >& m) override final
+	{
+		m_clone.m_strings.push_back(*m);
+	}
+
+	virtual void operator >> (const Member< std::wstring >& m) override final
+	{
+		m_clone.m_wideStrings.push_back(*m);
+	}
+
+	virtual void operator >> (const Member< Guid >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Path >& m) override final
+	{
+		m_clone.m_paths.push_back(*m);
+	}
+
+	virtual void operator >> (const Member< Color4ub >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Color4f >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Scalar >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Vector2 >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Vector4 >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Matrix33 >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Matrix44 >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< Quaternion >& m) override final { write(*m); }
+
+	virtual void operator >> (const Member< ISerializable* >& m) override final
+	{
+		ISerializable* object = *m;
+		if (!object)
+		{
+			write< uint32_t >(0);
+			return;
+		}
+
+		// Already recorded objects are written as references.
+		const auto it = m_objects.find(object);
+		if (it != m_objects.end())
+		{
+			write< uint32_t >(it->second);
+			return;
+		}
+
+		const TypeInfo& type = type_of(object);
+		if (!ensure(type.isInstantiable()))
+			return;
+
+		const uint32_t id = (uint32_t)m_clone.m_types.size() + 1;
+		m_clone.m_types.push_back(&type);
+		m_objects.insert(std::make_pair(object, id));
+
+		write< uint32_t >(id);
+		serialize(object);
+	}
+
+	virtual void operator >> (const Member< void* >& m) override final
+	{
+		const uint32_t size = (uint32_t)m.getBlobSize();
+		write< uint32_t >(size);
+		writeBlock(m.getBlob(), size);
+	}
+
+	virtual void operator >> (const MemberArray& m) override final
+	{
+		const uint32_t size = (uint32_t)m.size();
+		write< uint32_t >(size);
+
+		// Plain elements are copied as a single block.
+		MemberArray::Plain plain;
+		if (m.getPlain(plain))
+		{
+			writeBlock(plain.data, size * plain.elementSize);
+			return;
+		}
+
+		for (uint32_t i = 0; i < size && !failed(); ++i)
+			m.write(*this);
+	}
+
+	virtual void operator >> (const MemberComplex& m) override final
+	{
+		m.serialize(*this);
+	}
+
+	virtual void operator >> (const MemberEnumBase& m) override final
+	{
+		m.serialize(*this);
+	}
+
+private:
+	DeepClone& m_clone;
+	std::unordered_map< const ISerializable*, uint32_t > m_objects;	//!< Hashed as graphs can have many thousands of objects.
+
+	void writeBlock(const void* block, size_t size)
+	{
+		if (size > 0)
+		{
+			const size_t offset = m_clone.m_data.size();
+			m_clone.m_data.resize(offset + size);
+			std::memcpy(&m_clone.m_data[offset], block, size);
+		}
+	}
+
+	template < typename T >
+	void write(const T& value)
+	{
+		writeBlock((const void*)&value, sizeof(T));
+	}
+};
+
+/*! Copy recorded members into new object graph. */
+class DeepClone::Reader : public Serializer
+{
+public:
+	explicit Reader(const DeepClone& clone)
+	:	m_clone(clone)
+	{
+	}
+
+	virtual Direction getDirection() const override final
+	{
+		return Direction::Read;
+	}
+
+	virtual void operator >> (const Member< bool >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< int8_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< uint8_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< int16_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< uint16_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< int32_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< uint32_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< int64_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< uint64_t >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< float >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< double >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< std::string >& m) override final
+	{
+		if (ensure(m_string < m_clone.m_strings.size()))
+			m = m_clone.m_strings[m_string++];
+	}
+
+	virtual void operator >> (const Member< std::wstring >& m) override final
+	{
+		if (ensure(m_wideString < m_clone.m_wideStrings.size()))
+			m = m_clone.m_wideStrings[m_wideString++];
+	}
+
+	virtual void operator >> (const Member< Guid >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Path >& m) override final
+	{
+		if (ensure(m_path < m_clone.m_paths.size()))
+			m = m_clone.m_paths[m_path++];
+	}
+
+	virtual void operator >> (const Member< Color4ub >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Color4f >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Scalar >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Vector2 >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Vector4 >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Matrix33 >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Matrix44 >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< Quaternion >& m) override final { read(*m); }
+
+	virtual void operator >> (const Member< ISerializable* >& m) override final
+	{
+		uint32_t id = 0;
+		if (!read(id))
+			return;
+
+		if (id == 0)
+		{
+			m = nullptr;
+			return;
+		}
+
+		// Reference to an object already created, or currently being created.
+		if (id <= m_objects.size())
+		{
+			m = m_objects[id - 1];
+			return;
+		}
+
+		if (!ensure(id == m_objects.size() + 1 && id <= m_clone.m_types.size()))
+			return;
+
+		Ref< ISerializable > object = checked_type_cast< ISerializable* >(m_clone.m_types[id - 1]->createInstance());
+		if (!ensure(object != nullptr))
+			return;
+
+		// Register before members are read so cyclic references resolve to this object.
+		m_objects.push_back(object);
+		serialize(object);
+
+		m = object;
+	}
+
+	virtual void operator >> (const Member< void* >& m) override final
+	{
+		uint32_t size = 0;
+		if (!read(size))
+			return;
+
+		if (!ensure(m.setBlobSize(size)))
+			return;
+
+		readBlock(m.getBlob(), size);
+	}
+
+	virtual void operator >> (const MemberArray& m) override final
+	{
+		uint32_t size = 0;
+		if (!read(size))
+			return;
+
+		m.reserve(size, size);
+
+		MemberArray::Plain plain;
+		if (m.getPlain(plain) && m.size() == size)
+		{
+			readBlock(plain.data, size * plain.elementSize);
+			return;
+		}
+
+		for (uint32_t i = 0; i < size && !failed(); ++i)
+			m.read(*this);
+	}
+
+	virtual void operator >> (const MemberComplex& m) override final
+	{
+		m.serialize(*this);
+	}
+
+	virtual void operator >> (const MemberEnumBase& m) override final
+	{
+		m.serialize(*this);
+	}
+
+private:
+	const DeepClone& m_clone;
+	RefArray< ISerializable > m_objects;
+	size_t m_offset = 0;
+	size_t m_string = 0;
+	size_t m_wideString = 0;
+	size_t m_path = 0;
+
+	bool readBlock(void* block, size_t size)
+	{
+		if (!ensure(m_offset + size <= m_clone.m_data.size()))
+			return false;
+
+		if (size > 0)
+			std::memcpy(block, &m_clone.m_data[m_offset], size);
+
+		m_offset += size;
+		return true;
+	}
+
+	template < typename T >
+	bool read(T& value)
+	{
+		return readBlock((void*)&value, sizeof(T));
+	}
+};
+
 T_IMPLEMENT_RTTI_CLASS(L"traktor.DeepClone", DeepClone, Object)
 
 DeepClone::DeepClone(const ISerializable* source)
 {
-	m_copy.reserve(c_initialCapacity);
-	DynamicMemoryStream stream(m_copy, false, true);
-	BinarySerializer(&stream).writeObject(source);
+	m_data.reserve(c_initialCapacity);
+	m_failed = !Writer(*this).writeObject(source);
 }
 
 Ref< ISerializable > DeepClone::create() const
 {
-	MemoryStream stream(m_copy.c_ptr(), m_copy.size());
-	return BinarySerializer(&stream).readObject();
+	if (m_failed)
+		return nullptr;
+
+	return Reader(*this).readObject();
 }
 
 }
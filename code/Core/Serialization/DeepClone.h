@@ -8,9 +8,11 @@
  */
 #pragma once
 
+#include <string>
 #include "Core/Ref.h"
 #include "Core/Object.h"
 #include "Core/Containers/AlignedVector.h"
+#include "Core/Io/Path.h"
 
 // import/export mechanism.
 #undef T_DLLCLASS
@@ -24,12 +26,19 @@ namespace traktor
 {
 
 class ISerializable;
+class TypeInfo;
 
 /*! Clone object.
  * \ingroup Core
  *
  * Creates a clone of an object through
  * serialization.
+ *
+ * Members of source object graph are copied into
+ * typed in-memory storage, without encoding, and then
+ * copied directly into members of each clone.
+ * Objects referenced from several members are
+ * also shared in clone.
  */
 class T_DLLCLASS DeepClone : public Object
 {
@@ -49,7 +58,15 @@ public:
 	}
 
 private:
-	AlignedVector< uint8_t > m_copy;
+	class Reader;
+	class Writer;
+
+	AlignedVector< uint8_t > m_data;			//!< Values of plain members.
+	AlignedVector< std::string > m_strings;
+	AlignedVector< std::wstring > m_wideStrings;
+	AlignedVector< Path > m_paths;
+	AlignedVector< const TypeInfo* > m_types;	//!< Type of each object in graph, in order of first reference.
+	bool m_failed = false;
 };
 
 }
@@ -6,8 +6,9 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <cstring>
+#include <unordered_map>
 #include "Core/Guid.h"
-#include "Core/Containers/SmallMap.h"
 #include "Core/Io/IStream.h"
 #include "Core/Io/Path.h"
 #include "Core/Math/Color4f.h"
@@ -53,67 +54,67 @@ public:
 	virtual void operator >> (const Member< bool >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< uint8_t >(m ? 0xff : 0x00);
+			feed< uint8_t >(m ? 0xff : 0x00);
 	}
 
 	virtual void operator >> (const Member< int8_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< int8_t >(m);
+			feed< int8_t >(m);
 	}
 
 	virtual void operator >> (const Member< uint8_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< uint8_t >(m);
+			feed< uint8_t >(m);
 	}
 
 	virtual void operator >> (const Member< int16_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< int64_t >(m);
+			feed< int64_t >(m);
 	}
 
 	virtual void operator >> (const Member< uint16_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< uint16_t >(m);
+			feed< uint16_t >(m);
 	}
 
 	virtual void operator >> (const Member< int32_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< int32_t >(m);
+			feed< int32_t >(m);
 	}
 
 	virtual void operator >> (const Member< uint32_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< uint32_t >(m);
+			feed< uint32_t >(m);
 	}
 
 	virtual void operator >> (const Member< int64_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< int64_t >(m);
+			feed< int64_t >(m);
 	}
 
 	virtual void operator >> (const Member< uint64_t >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< uint64_t >(m);
+			feed< uint64_t >(m);
 	}
 
 	virtual void operator >> (const Member< float >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< float >(m);
+			feed< float >(m);
 	}
 
 	virtual void operator >> (const Member< double >& m) override final
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
-			m_hasher.feed< double >(m);
+			feed< double >(m);
 	}
 
 	virtual void operator >> (const Member< std::string >& m) override final
@@ -121,7 +122,7 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			const std::string& str = m;
-			m_hasher.feedBuffer(str.data(), str.size());
+			feedBuffer(str.data(), str.size());
 		}
 	}
 
@@ -130,7 +131,7 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			const std::wstring& str = m;
-			m_hasher.feed(str);
+			feed(str);
 		}
 	}
 
@@ -139,7 +140,7 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			const Guid& guid = m;
-			m_hasher.feedBuffer((const uint8_t*)guid, 16);
+			feedBuffer((const uint8_t*)guid, 16);
 		}
 	}
 
@@ -148,7 +149,7 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			const std::wstring path = m->getOriginal();
-			m_hasher.feed(path);
+			feed(path);
 		}
 	}
 
@@ -156,10 +157,10 @@ public:
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
-			m_hasher.feed< uint8_t >(m->r);
-			m_hasher.feed< uint8_t >(m->g);
-			m_hasher.feed< uint8_t >(m->b);
-			m_hasher.feed< uint8_t >(m->a);
+			feed< uint8_t >(m->r);
+			feed< uint8_t >(m->g);
+			feed< uint8_t >(m->b);
+			feed< uint8_t >(m->a);
 		}
 	}
 
@@ -169,7 +170,7 @@ public:
 		{
 			float T_MATH_ALIGN16 e[4];
 			m->storeAligned(e);
-			m_hasher.feedBuffer(e, sizeof(e));
+			feedBuffer(e, sizeof(e));
 		}
 	}
 
@@ -178,7 +179,7 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			const float v = (float)(const Scalar&)m;
-			m_hasher.feed< float >(v);
+			feed< float >(v);
 		}
 	}
 
@@ -186,8 +187,8 @@ public:
 	{
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
-			m_hasher.feed< float >(m->x);
-			m_hasher.feed< float >(m->y);
+			feed< float >(m->x);
+			feed< float >(m->y);
 		}
 	}
 
@@ -197,7 +198,7 @@ public:
 		{
 			float T_MATH_ALIGN16 e[4];
 			m->storeAligned(e);
-			m_hasher.feedBuffer(e, sizeof(e));
+			feedBuffer(e, sizeof(e));
 		}
 	}
 
@@ -206,7 +207,7 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			for (int i = 0; i < 3 * 3; ++i)
-				m_hasher.feed< float >(m->m[i]);
+				feed< float >(m->m[i]);
 		}
 	}
 
@@ -216,7 +217,7 @@ public:
 		{
 			float T_MATH_ALIGN16 e[16];
 			m->storeAligned(e);
-			m_hasher.feedBuffer(e, sizeof(e));
+			feedBuffer(e, sizeof(e));
 		}
 	}
 
@@ -226,7 +227,7 @@ public:
 		{
 			float T_MATH_ALIGN16 e[4];
 			m->e.storeAligned(e);
-			m_hasher.feedBuffer(e, sizeof(e));
+			feedBuffer(e, sizeof(e));
 		}
 	}
 
@@ -242,26 +243,22 @@ public:
 				{
 					m_written.insert(std::make_pair(object, ++m_writtenCount));
 
-					const wchar_t* const typeName = type_of(object).getName();
-					for (size_t i = 0; typeName[i]; ++i)
-					{
-						uint32_t ch = (uint32_t)typeName[i];
-						m_hasher.feed(ch);
-					}
+					const TypePlan& plan = getTypePlan(type_of(object));
+					feedBuffer(plan.name.c_ptr(), plan.name.size() * sizeof(uint32_t));
 
-					serialize(object);
+					serialize(object, plan.dataVersions);
 				}
 				else
-					m_hasher.feed< uint32_t >(it->second);
+					feed< uint32_t >(it->second);
 			}
 			else
-				m_hasher.feed< uint32_t >(0);
+				feed< uint32_t >(0);
 		}
 	}
 
 	virtual void operator >> (const Member< void* >& m) override final
 	{
-		m_hasher.feedBuffer(m.getBlob(), m.getBlobSize());
+		feedBuffer(m.getBlob(), m.getBlobSize());
 	}
 
 	virtual void operator >> (const MemberArray& m) override final
@@ -269,6 +266,15 @@ public:
 		if (findAttribute< AttributeNoHash >(m) == nullptr)
 		{
 			const size_t size = m.size();
+
+			// Plain elements are hashed as a block, except int16 since those are hashed widened.
+			MemberArray::Plain plain;
+			if (m.getPlain(plain) && !(plain.elementSize == sizeof(int16_t) && plain.isSigned))
+			{
+				feedBuffer(plain.data, size * plain.elementSize);
+				return;
+			}
+
 			for (size_t i = 0; i < size; ++i)
 				m.write(*this);
 		}
@@ -286,10 +292,48 @@ public:
 			m.serialize(*this);
 	}
 
+	/*! Feed remaining staged data into hasher. */
+	void flush()
+	{
+		if (m_stagedSize > 0)
+		{
+			m_hasher.feedBuffer(m_staged, m_stagedSize);
+			m_stagedSize = 0;
+		}
+	}
+
 private:
 	Murmur3& m_hasher;
-	SmallMap< ISerializable*, uint32_t > m_written;
+	std::unordered_map< ISerializable*, uint32_t > m_written;
 	uint32_t m_writtenCount;
+	uint8_t m_staged[1024];
+	uint32_t m_stagedSize = 0;
+
+	/*! Stage data so hasher is fed in blocks; hash is same as if fed directly. */
+	void feedBuffer(const void* buffer, size_t bufferSize)
+	{
+		if (m_stagedSize + bufferSize <= sizeof(m_staged))
+		{
+			std::memcpy(&m_staged[m_stagedSize], buffer, bufferSize);
+			m_stagedSize += (uint32_t)bufferSize;
+		}
+		else
+		{
+			flush();
+			m_hasher.feedBuffer(buffer, bufferSize);
+		}
+	}
+
+	template < typename T >
+	void feed(const T& value)
+	{
+		feedBuffer(&value, sizeof(value));
+	}
+
+	void feed(const std::wstring& value)
+	{
+		feedBuffer(value.c_str(), value.length() * sizeof(wchar_t));
+	}
 };
 
 	}
@@ -303,7 +347,9 @@ DeepHash::DeepHash(const ISerializable* object)
 	{
 		Murmur3 a;
 		a.begin();
-		HashSerializer(a).writeObject(object);
+		HashSerializer hs(a);
+		hs.writeObject(object);
+		hs.flush();
 		a.end();
 		m_hash = a.get();
 	}
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include "Core/Config.h"
 
 // import/export mechanism.
@@ -26,12 +27,23 @@ class Attribute;
 class TypeInfo;
 class ISerializer;
 
+template < typename ValueType >
+class Member;
+
 /*! Array member base.
  * \ingroup Core
  */
 class T_DLLCLASS MemberArray
 {
 public:
+	/*! Plain elements, stored contiguously as native values. */
+	struct Plain
+	{
+		void* data = nullptr;
+		uint32_t elementSize = 0;
+		bool isSigned = false;
+	};
+
 	explicit MemberArray(const wchar_t* const name, const Attribute* attributes);
 
 	virtual ~MemberArray() {}
@@ -69,6 +81,28 @@ public:
 	/*! Insert default element, used by property list to add new elements. */
 	virtual bool insert() const = 0;
 
+	/*! Get plain elements.
+	 *
+	 * Arrays of arithmetic elements, except bool, without
+	 * custom element member can expose their storage so
+	 * serializers can copy or hash all elements as a block
+	 * instead of one member at a time.
+	 *
+	 * \param outPlain Storage of elements.
+	 * \return True if elements are plain.
+	 */
+	virtual bool getPlain(Plain& outPlain) const { return false; }
+
+	/*! Check if elements, serialized through member, are plain. */
+	template < typename ValueType, typename ValueMember >
+	constexpr static bool isPlain()
+	{
+		return
+			std::is_same_v< ValueMember, Member< ValueType > > &&
+			std::is_arithmetic_v< ValueType > &&
+			!std::is_same_v< ValueType, bool >;
+	}
+
 protected:
 	/*! Set attributes member. */
 	void setAttributes(const Attribute* attributes);
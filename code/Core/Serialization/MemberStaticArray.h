@@ -68,6 +68,19 @@ public:
 		return false;
 	}
 
+	virtual bool getPlain(Plain& outPlain) const override final
+	{
+		if constexpr (isPlain< ValueType, ValueMember >())
+		{
+			outPlain.data = m_arr;
+			outPlain.elementSize = sizeof(ValueType);
+			outPlain.isSigned = std::is_signed_v< ValueType >;
+			return true;
+		}
+		else
+			return false;
+	}
+
 private:
 	ValueType* m_arr;
 	const wchar_t** m_elementNames;
@@ -97,6 +97,19 @@ public:
 		return true;
 	}
 
+	virtual bool getPlain(Plain& outPlain) const override final
+	{
+		if constexpr (isPlain< ValueType, ValueMember >())
+		{
+			outPlain.data = m_ref.data();
+			outPlain.elementSize = sizeof(ValueType);
+			outPlain.isSigned = std::is_signed_v< ValueType >;
+			return true;
+		}
+		else
+			return false;
+	}
+
 private:
 	value_type& m_ref;
 	mutable size_t m_index;
@@ -6,10 +6,60 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <atomic>
+#include "Core/Containers/SmallMap.h"
 #include "Core/Serialization/Serializer.h"
+#include "Core/Thread/ReaderWriterLock.h"
 
 namespace traktor
 {
+	namespace
+	{
+
+/*! Plans of all types, plan is evicted when it's type is unregistered. */
+struct TypePlans
+{
+	ReaderWriterLock lock;
+	SmallMap< const TypeInfo*, Serializer::TypePlan* > plans;
+};
+
+/*! Never destroyed, types in other modules might be unregistered after static destruction of this module. */
+std::atomic< TypePlans* > s_typePlans = nullptr;
+
+TypePlans& getTypePlans()
+{
+	TypePlans* typePlans = s_typePlans;
+	if (!typePlans)
+	{
+		TypePlans* created = new TypePlans();
+		if (s_typePlans.compare_exchange_strong(typePlans, created))
+			typePlans = created;
+		else
+			delete created;
+	}
+	return *typePlans;
+}
+
+	}
+
+/*! Evict serialization plan of type; called when type is unregistered. */
+void __evictTypePlan(const TypeInfo* typeInfo)
+{
+	TypePlans* typePlans = s_typePlans;
+	if (!typePlans)
+		return;
+
+	Serializer::TypePlan* plan = nullptr;
+	{
+		ReaderWriterLock::AcquireWriter lock(typePlans->lock);
+		const auto it = typePlans->plans.find(typeInfo);
+		if (it == typePlans->plans.end())
+			return;
+		plan = it->second;
+		typePlans->plans.erase(it);
+	}
+	delete plan;
+}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.Serializer", Serializer, ISerializer);
 
@@ -33,6 +83,35 @@ bool Serializer::writeObject(const ISerializable* o)
 	return !m_failure;
 }
 
+const Serializer::TypePlan& Serializer::getTypePlan(const TypeInfo& type)
+{
+	TypePlans& typePlans = getTypePlans();
+	{
+		ReaderWriterLock::AcquireReader lock(typePlans.lock);
+		const auto it = typePlans.plans.find(&type);
+		if (it != typePlans.plans.end())
+			return *it->second;
+	}
+
+	ReaderWriterLock::AcquireWriter lock(typePlans.lock);
+
+	TypePlan*& plan = typePlans.plans[&type];
+	if (plan)
+		return *plan;
+
+	plan = new TypePlan();
+	for (const TypeInfo* ti = &type; ti != nullptr; ti = ti->getSuper())
+	{
+		plan->dataVersions.insert(std::make_pair(ti, ti->getVersion()));
+		if (ti != &type && ti->getVersion() > 0)
+			plan->versionedBases.push_back(ti);
+	}
+	for (const wchar_t* ch = type.getName(); *ch; ++ch)
+		plan->name.push_back((uint32_t)*ch);
+
+	return *plan;
+}
+
 int32_t Serializer::getVersion() const
 {
 	T_ASSERT(m_versionPointer > 0);
@@ -62,14 +141,7 @@ void Serializer::serialize(ISerializable* inner)
 	if (!inner || m_failure)
 		return;
 
-	dataVersionMap_t dataVersions;
-	for (const TypeInfo* ti = &type_of(inner); ti != nullptr; ti = ti->getSuper())
-		dataVersions.insert(std::make_pair(
-			ti,
-			ti->getVersion()
-		));
-
-	serialize(inner, dataVersions);
+	serialize(inner, getTypePlan(type_of(inner)).dataVersions);
 }
 
 void Serializer::serialize(ISerializable* inner, const dataVersionMap_t& dataVersions)
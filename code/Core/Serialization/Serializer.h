@@ -34,6 +34,23 @@ class T_DLLCLASS Serializer : public ISerializer
 public:
 	typedef StaticMap< const TypeInfo*, int32_t, 16 > dataVersionMap_t;
 
+	/*! Serialization plan of a type.
+	 *
+	 * Everything about a type which serializers otherwise
+	 * need to rediscover for each serialized object; plan
+	 * only depend on the type, not on data versions, and is
+	 * created once per type.
+	 */
+	struct TypePlan
+	{
+		dataVersionMap_t dataVersions;			//!< Versions of type and all it's base types.
+		AlignedVector< const TypeInfo* > versionedBases;	//!< Base types with non-zero version, most derived first.
+		AlignedVector< uint32_t > name;			//!< Characters of type name.
+	};
+
+	/*! Get plan of type, created on first call. */
+	static const TypePlan& getTypePlan(const TypeInfo& type);
+
 	Ref< ISerializable > readObject();
 
 	bool writeObject(const ISerializable* o);
@@ -7,11 +7,21 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Core/Io/DynamicMemoryStream.h"
+#include "Core/Io/MemoryStream.h"
+#include "Core/Log/Log.h"
+#include "Core/Math/Vector4.h"
 #include "Core/Serialization/BinarySerializer.h"
 #include "Core/Serialization/DeepClone.h"
+#include "Core/Serialization/DeepHash.h"
+#include "Core/Serialization/ISerializer.h"
+#include "Core/Serialization/Member.h"
+#include "Core/Serialization/MemberAlignedVector.h"
+#include "Core/Serialization/MemberRef.h"
+#include "Core/Serialization/MemberRefArray.h"
 #include "Core/Settings/PropertyBoolean.h"
 #include "Core/Settings/PropertyGroup.h"
 #include "Core/Test/CaseClone.h"
+#include "Core/Timer/Timer.h"
 
 namespace traktor::test
 {
@@ -39,6 +49,53 @@ public:
 	}
 };
 
+class Clone_Node : public ISerializable
+{
+	T_RTTI_CLASS;
+
+public:
+	std::wstring name;
+	int32_t value = 0;
+	float weight = 0.0f;
+	Vector4 position = Vector4::zero();
+	AlignedVector< int32_t > values;
+	Ref< Clone_Node > shared;
+	Ref< Clone_Node > parent;
+	RefArray< Clone_Node > children;
+
+	virtual void serialize(ISerializer& s) override
+	{
+		s >> Member< std::wstring >(L"name", name);
+		s >> Member< int32_t >(L"value", value);
+		s >> Member< float >(L"weight", weight);
+		s >> Member< Vector4 >(L"position", position);
+		s >> MemberAlignedVector< int32_t >(L"values", values);
+		s >> MemberRef< Clone_Node >(L"shared", shared);
+		s >> MemberRef< Clone_Node >(L"parent", parent);
+		s >> MemberRefArray< Clone_Node >(L"children", children);
+	}
+};
+
+Ref< Clone_Node > createGraph(int32_t depth, int32_t breadth, Clone_Node* parent, Clone_Node* shared, bool linkParent)
+{
+	Ref< Clone_Node > node = new Clone_Node();
+	node->name = L"Node " + std::to_wstring(depth);
+	node->value = depth;
+	node->weight = depth * 0.5f;
+	node->position = Vector4(1.0f, 2.0f, 3.0f, 1.0f) * Scalar(float(depth));
+	node->values.resize(16, depth);
+	node->shared = shared;
+	node->parent = linkParent ? parent : nullptr;
+	if (depth > 0)
+	{
+		for (int32_t i = 0; i < breadth; ++i)
+			node->children.push_back(createGraph(depth - 1, breadth, node, shared, linkParent));
+	}
+	return node;
+}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseClone.Clone_Node", 0, Clone_Node, ISerializable)
+
 T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseClone.Clone_Base", 1, Clone_Base, ISerializable)
 
 T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseClone.Clone_Derived", 2, Clone_Derived, Clone_Base)
@@ -82,6 +139,63 @@ void CaseClone::run()
 		CASE_ASSERT_NOT_EQUAL(copy->getProperty(L"Test"), sourceChild);
 		CASE_ASSERT_EQUAL(copy->getProperty(L"Test")->getReferenceCount(), 1);
 	}
+
+	// Deep clone versions.
+	{
+		Ref< Clone_Derived > copy = DeepClone(new Clone_Derived()).create< Clone_Derived >();
+		CASE_ASSERT_NOT_EQUAL (copy, nullptr);
+	}
+
+	// Deep clone graph, shared and cyclic references.
+	{
+		Ref< Clone_Node > shared = new Clone_Node();
+		shared->name = L"Shared";
+		shared->shared = shared;
+
+		Ref< Clone_Node > source = createGraph(3, 3, nullptr, shared, true);
+		Ref< Clone_Node > copy = DeepClone(source).create< Clone_Node >();
+
+		CASE_ASSERT_NOT_EQUAL (copy, nullptr);
+		if (copy)
+		{
+			CASE_ASSERT_EQUAL (DeepHash(copy).get(), DeepHash(source).get());
+			CASE_ASSERT (copy->shared != shared);
+			CASE_ASSERT (copy->shared->shared == copy->shared);
+			CASE_ASSERT_EQUAL (copy->children.size(), 3u);
+			CASE_ASSERT (copy->children[0]->parent == copy);
+			CASE_ASSERT (copy->children[2]->children[1]->shared == copy->shared);
+			CASE_ASSERT_EQUAL (copy->children[1]->values.size(), 16u);
+			CASE_ASSERT_EQUAL (copy->children[1]->values[15], 2);
+			CASE_ASSERT (copy->children[1]->name == L"Node 2");
+		}
+	}
+
+	// Deep clone performance, compared to a serializer round trip.
+	{
+		// Serializer cannot resolve references to objects still being read, so no parent links.
+		Ref< Clone_Node > source = createGraph(7, 4, nullptr, new Clone_Node(), false);
+		const int32_t count = 10;
+
+		Timer timer;
+
+		const double startStream = timer.getElapsedTime();
+		for (int32_t i = 0; i < count; ++i)
+		{
+			AlignedVector< uint8_t > buffer;
+			DynamicMemoryStream wms(buffer, false, true);
+			BinarySerializer(&wms).writeObject(source);
+			MemoryStream rms(buffer.c_ptr(), buffer.size());
+			BinarySerializer(&rms).readObject();
+		}
+		const double stream = (timer.getElapsedTime() - startStream) / count;
+
+		const double startClone = timer.getElapsedTime();
+		for (int32_t i = 0; i < count; ++i)
+			DeepClone(source).create();
+		const double clone = (timer.getElapsedTime() - startClone) / count;
+
+		log::info << L"Clone graph; serializer " << int32_t(stream * 1000000.0) << L" us, deep clone " << int32_t(clone * 1000000.0) << L" us" << Endl;
+	}
 }
 
 }
@@ -7,6 +7,9 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include <cmath>
+#include "Core/Log/Log.h"
+#include "Core/Memory/MemoryConfig.h"
+#include "Core/Memory/TrackAllocator.h"
 #include "Core/Thread/JobManager.h"
 #include "Core/Test/CaseJob.h"
 
@@ -78,6 +81,72 @@ void CaseJob::run()
 			correct &= (g_counts[i] == 1);
 		CASE_ASSERT(correct);
 	}
+
+	// Parallel for.
+	{
+		g_job = 0;
+		g_active = 0;
+
+		for (int32_t i = 0; i < 1000; ++i)
+			g_counts[i] = 0;
+
+		JobManager::getInstance().parallelFor(1000, 7, [](int32_t from, int32_t to) {
+			for (int32_t i = from; i < to; ++i)
+				jobTask(i);
+		});
+
+		CASE_ASSERT_EQUAL((int32_t)g_active, 0);
+		CASE_ASSERT_EQUAL((int32_t)g_job, 1000);
+
+		bool correct = true;
+		for (int32_t i = 0; i < 1000; ++i)
+			correct &= (g_counts[i] == 1);
+		CASE_ASSERT(correct);
+	}
+
+	// Steady state fork, parallel for and add shouldn't allocate any memory.
+	{
+		const TrackAllocator* tracker = dynamic_cast< const TrackAllocator* >(getAllocator());
+		if (tracker)
+		{
+			// Captures more than std::function can store without allocation.
+			struct Task
+			{
+				int32_t a, b, c, d, e, f;
+
+				void operator () () const { jobTask((a + b + c + d + e + f) % 1000); }
+			};
+
+			const int32_t a = 1, b = 2, c = 3, d = 4, e = 5, f = 6;
+			const Task task = { a, b, c, d, e, f };
+
+			Task tasks[64];
+			for (int32_t i = 0; i < 64; ++i)
+				tasks[i] = task;
+
+			auto iteration = [&]() {
+				JobManager::getInstance().fork(tasks, sizeof_array(tasks));
+				JobManager::getInstance().parallelFor(1000, 16, [=](int32_t from, int32_t to) {
+					for (int32_t i = from; i < to; ++i)
+						jobTask((i + a + b + c + d + e + f) % 1000);
+				});
+				JobManager::getInstance().add(task);
+				JobManager::getInstance().wait();
+			};
+
+			// Warm up, let queues reach their capacity.
+			for (int32_t i = 0; i < 10; ++i)
+				iteration();
+
+			const int64_t allocationCount = tracker->getAllocationCount();
+			for (int32_t i = 0; i < 100; ++i)
+				iteration();
+
+			CASE_ASSERT_EQUAL(tracker->getAllocationCount() - allocationCount, (int64_t)0);
+		}
+		else
+			log::info << L"Allocation tracking not available; zero allocation test skipped." << Endl;
+	}
 }
 
 }
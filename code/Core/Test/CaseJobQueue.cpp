@@ -0,0 +1,120 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Log/Log.h"
+#include "Core/System/OS.h"
+#include "Core/Test/CaseJobQueue.h"
+#include "Core/Thread/JobQueue.h"
+#include "Core/Timer/Timer.h"
+
+namespace traktor::test
+{
+	namespace
+	{
+
+const int32_t c_fanOuts[] = { 4, 16, 64, 256, 1024, 4096 };
+const int32_t c_tasksPerFanOut = 64 * 1024;
+
+std::atomic< int32_t > g_executed;
+
+void work()
+{
+	// Small amount of work, similar to a culling or particle batch.
+	volatile float v = 0.0f;
+	for (int32_t i = 0; i < 256; ++i)
+		v = v + float(i) * 0.5f;
+	g_executed++;
+}
+
+const wchar_t* getSchedulerName(JobQueue::Scheduler scheduler)
+{
+	return scheduler == JobQueue::Scheduler::WorkStealing ? L"work stealing" : L"shared";
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseJobQueue", 0, CaseJobQueue, Case)
+
+void CaseJobQueue::run()
+{
+	const uint32_t workerCount = std::max< uint32_t >(OS::getInstance().getCPUCoreCount(), 2) - 1;
+	const JobQueue::Scheduler schedulers[] = { JobQueue::Scheduler::Shared, JobQueue::Scheduler::WorkStealing };
+
+	for (auto scheduler : schedulers)
+	{
+		JobQueue queue;
+		const bool created = queue.create(workerCount, Thread::Normal, scheduler);
+		CASE_ASSERT(created);
+		if (!created)
+			continue;
+
+		// Flat fork fan-outs.
+		for (auto fanOut : c_fanOuts)
+		{
+			AlignedVector< Job::task_t > tasks(fanOut, [](){ work(); });
+			const int32_t iterations = std::max(c_tasksPerFanOut / fanOut, 16);
+
+			g_executed = 0;
+
+			Timer timer;
+			for (int32_t i = 0; i < iterations; ++i)
+				queue.fork(tasks.c_ptr(), tasks.size());
+			const double duration = timer.getElapsedTime();
+
+			CASE_ASSERT_EQUAL((int32_t)g_executed, iterations * fanOut);
+			log::info << L"JobQueue (" << getSchedulerName(scheduler) << L"), fan-out " << fanOut << L": " << int32_t(duration * 1e6 / iterations) << L" us/fork, " << int32_t(iterations * fanOut / duration) << L" tasks/s" << Endl;
+		}
+
+		// Nested forks, each forked task fork again; shared queue
+		// cannot run these since waiting workers do not help.
+		if (scheduler == JobQueue::Scheduler::WorkStealing)
+		{
+			AlignedVector< Job::task_t > inner(16, [](){ work(); });
+			AlignedVector< Job::task_t > outer(16, [&](){ queue.fork(inner.c_ptr(), inner.size()); });
+
+			g_executed = 0;
+			for (int32_t i = 0; i < 64; ++i)
+				queue.fork(outer.c_ptr(), outer.size());
+
+			CASE_ASSERT_EQUAL((int32_t)g_executed, 64 * 16 * 16);
+		}
+
+		// Forks interleaved with added jobs; forking thread only execute it's own
+		// jobs and leave added jobs in queue.
+		{
+			AlignedVector< Job::task_t > tasks(16, [](){ work(); });
+
+			g_executed = 0;
+			for (int32_t i = 0; i < 256; ++i)
+			{
+				queue.add([](){ work(); });
+				queue.fork(tasks.c_ptr(), tasks.size());
+			}
+
+			const bool result = queue.wait();
+			CASE_ASSERT(result);
+			CASE_ASSERT_EQUAL((int32_t)g_executed, 256 * 17);
+		}
+
+		// Added jobs.
+		{
+			g_executed = 0;
+			for (int32_t i = 0; i < 1000; ++i)
+				queue.add([](){ work(); });
+
+			const bool result = queue.wait();
+			CASE_ASSERT(result);
+			CASE_ASSERT_EQUAL((int32_t)g_executed, 1000);
+		}
+
+		queue.destroy();
+	}
+}
+
+}
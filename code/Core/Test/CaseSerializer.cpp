@@ -0,0 +1,253 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <new>
+#include <vector>
+#include "Core/Io/DynamicMemoryStream.h"
+#include "Core/Io/MemoryStream.h"
+#include "Core/Log/Log.h"
+#include "Core/Misc/Murmur3.h"
+#include "Core/Math/Vector4.h"
+#include "Core/Serialization/BinarySerializer.h"
+#include "Core/Serialization/DeepHash.h"
+#include "Core/Serialization/ISerializer.h"
+#include "Core/Serialization/Member.h"
+#include "Core/Serialization/MemberAlignedVector.h"
+#include "Core/Serialization/MemberRefArray.h"
+#include "Core/Serialization/MemberStaticArray.h"
+#include "Core/Serialization/MemberStl.h"
+#include "Core/Serialization/Serializer.h"
+#include "Core/Test/CaseSerializer.h"
+#include "Core/Timer/Timer.h"
+
+namespace traktor::test
+{
+	namespace
+	{
+
+class Serializer_Base : public ISerializable
+{
+	T_RTTI_CLASS;
+
+public:
+	int32_t id = 0;
+	uint16_t flags = 0;
+	int16_t delta = 0;
+	float weight = 0.0f;
+
+	virtual void serialize(ISerializer& s) override
+	{
+		s >> Member< int32_t >(L"id", id);
+		s >> Member< uint16_t >(L"flags", flags);
+		if (s.getVersion< Serializer_Base >() >= 1)
+			s >> Member< int16_t >(L"delta", delta);
+		s >> Member< float >(L"weight", weight);
+	}
+};
+
+class Serializer_Node : public Serializer_Base
+{
+	T_RTTI_CLASS;
+
+public:
+	std::wstring name;
+	bool enable = false;
+	double time = 0.0;
+	Vector4 position = Vector4::zero();
+	int32_t counts[4] = { 0, 0, 0, 0 };
+	AlignedVector< float > samples;
+	AlignedVector< int16_t > offsets;
+	std::vector< uint8_t > bytes;
+	RefArray< Serializer_Node > children;
+
+	virtual void serialize(ISerializer& s) override
+	{
+		Serializer_Base::serialize(s);
+		s >> Member< std::wstring >(L"name", name);
+		s >> Member< bool >(L"enable", enable);
+		s >> Member< double >(L"time", time);
+		s >> Member< Vector4 >(L"position", position);
+		s >> MemberStaticArray< int32_t, 4 >(L"counts", counts);
+		s >> MemberAlignedVector< float >(L"samples", samples);
+		s >> MemberAlignedVector< int16_t >(L"offsets", offsets);
+		s >> MemberStlVector< uint8_t >(L"bytes", bytes);
+		s >> MemberRefArray< Serializer_Node >(L"children", children);
+	}
+};
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseSerializer.Serializer_Base", 1, Serializer_Base, ISerializable)
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseSerializer.Serializer_Node", 0, Serializer_Node, Serializer_Base)
+
+Ref< Serializer_Node > createNode(int32_t depth, int32_t breadth, int32_t& inoutId)
+{
+	Ref< Serializer_Node > node = new Serializer_Node();
+	node->id = inoutId++;
+	node->flags = (uint16_t)(node->id * 7);
+	node->delta = (int16_t)(-node->id);
+	node->weight = node->id * 0.25f;
+	node->name = L"Node " + std::to_wstring(node->id);
+	node->enable = (node->id & 1) != 0;
+	node->time = node->id * 0.125;
+	node->position = Vector4(1.0f, 2.0f, 3.0f, 1.0f) * Scalar(float(node->id));
+	for (int32_t i = 0; i < 4; ++i)
+		node->counts[i] = node->id + i;
+	for (int32_t i = 0; i < 64; ++i)
+	{
+		node->samples.push_back(i * 0.5f + node->id);
+		node->offsets.push_back((int16_t)(i - 32));
+		node->bytes.push_back((uint8_t)(i + node->id));
+	}
+	if (depth > 0)
+	{
+		for (int32_t i = 0; i < breadth; ++i)
+			node->children.push_back(createNode(depth - 1, breadth, inoutId));
+	}
+	return node;
+}
+
+bool equal(const Serializer_Node* a, const Serializer_Node* b)
+{
+	if (a->id != b->id || a->flags != b->flags || a->delta != b->delta || a->weight != b->weight)
+		return false;
+	if (a->name != b->name || a->enable != b->enable || a->time != b->time || a->position != b->position)
+		return false;
+	for (int32_t i = 0; i < 4; ++i)
+	{
+		if (a->counts[i] != b->counts[i])
+			return false;
+	}
+	if (a->samples.size() != b->samples.size() || a->offsets.size() != b->offsets.size() || a->bytes != b->bytes)
+		return false;
+	for (size_t i = 0; i < a->samples.size(); ++i)
+	{
+		if (a->samples[i] != b->samples[i] || a->offsets[i] != b->offsets[i])
+			return false;
+	}
+	if (a->children.size() != b->children.size())
+		return false;
+	for (size_t i = 0; i < a->children.size(); ++i)
+	{
+		if (!equal(a->children[i], b->children[i]))
+			return false;
+	}
+	return true;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.test.CaseSerializer", 0, CaseSerializer, Case)
+
+void CaseSerializer::run()
+{
+	// Round trip and hash of small graph.
+	{
+		int32_t id = 1;
+		Ref< Serializer_Node > source = createNode(2, 2, id);
+
+		AlignedVector< uint8_t > buffer;
+		DynamicMemoryStream wms(buffer, false, true);
+		const bool written = BinarySerializer(&wms).writeObject(source);
+		CASE_ASSERT(written);
+
+		MemoryStream rms(buffer.c_ptr(), buffer.size());
+		Ref< Serializer_Node > copy = BinarySerializer(&rms).readObject< Serializer_Node >();
+		CASE_ASSERT(copy != nullptr);
+		if (copy)
+			CASE_ASSERT(equal(source, copy));
+
+		const uint32_t hash = DeepHash(source).get();
+		CASE_ASSERT_EQUAL(DeepHash(copy).get(), hash);
+		CASE_ASSERT_EQUAL(hash, 355819806u);
+
+		// Serialized data must not change.
+		Murmur3 checksum;
+		checksum.begin();
+		checksum.feedBuffer(buffer.c_ptr(), buffer.size());
+		checksum.end();
+		CASE_ASSERT_EQUAL(buffer.size(), 3964u);
+		CASE_ASSERT_EQUAL(checksum.get(), 149015508u);
+	}
+
+	// Consecutive objects in same stream; object read must not consume following data.
+	{
+		int32_t id = 1;
+		Ref< Serializer_Node > first = createNode(1, 2, id);
+		Ref< Serializer_Node > second = createNode(1, 3, id);
+
+		AlignedVector< uint8_t > buffer;
+		DynamicMemoryStream wms(buffer, false, true);
+		BinarySerializer(&wms).writeObject(first);
+		const uint32_t tail = 0x12345678;
+		wms.write(&tail, sizeof(tail));
+		BinarySerializer(&wms).writeObject(second);
+
+		MemoryStream rms(buffer.c_ptr(), buffer.size());
+		Ref< Serializer_Node > firstCopy = BinarySerializer(&rms).readObject< Serializer_Node >();
+		uint32_t tailCopy = 0;
+		rms.read(&tailCopy, sizeof(tailCopy));
+		Ref< Serializer_Node > secondCopy = BinarySerializer(&rms).readObject< Serializer_Node >();
+
+		CASE_ASSERT(firstCopy != nullptr && equal(first, firstCopy));
+		CASE_ASSERT_EQUAL(tailCopy, tail);
+		CASE_ASSERT(secondCopy != nullptr && equal(second, secondCopy));
+		CASE_ASSERT_EQUAL(rms.tell(), (int64_t)buffer.size());
+	}
+
+	// Throughput, in MB/s of serialized data.
+	{
+		int32_t id = 1;
+		Ref< Serializer_Node > source = createNode(5, 5, id);
+		const int32_t count = 4;
+
+		AlignedVector< uint8_t > buffer;
+		Timer timer;
+
+		double start = timer.getElapsedTime();
+		for (int32_t i = 0; i < count; ++i)
+		{
+			buffer.resize(0);
+			DynamicMemoryStream wms(buffer, false, true);
+			BinarySerializer(&wms).writeObject(source);
+		}
+		const double write = (timer.getElapsedTime() - start) / count;
+
+		start = timer.getElapsedTime();
+		for (int32_t i = 0; i < count; ++i)
+		{
+			MemoryStream rms(buffer.c_ptr(), buffer.size());
+			BinarySerializer(&rms).readObject();
+		}
+		const double read = (timer.getElapsedTime() - start) / count;
+
+		start = timer.getElapsedTime();
+		for (int32_t i = 0; i < count; ++i)
+			DeepHash(source).get();
+		const double hash = (timer.getElapsedTime() - start) / count;
+
+		const double mb = buffer.size() / (1024.0 * 1024.0);
+		log::info << L"Serializer " << int32_t(mb) << L" MB; write " << int32_t(mb / write) << L" MB/s, read " << int32_t(mb / read) << L" MB/s, hash " << int32_t(mb / hash) << L" MB/s" << Endl;
+	}
+
+	// Plan is evicted when type is unregistered; another type at same address get a new plan.
+	{
+		alignas(TypeInfo) uint8_t storage[sizeof(TypeInfo)];
+
+		TypeInfo* type = new (storage) TypeInfo(L"traktor.test.Serializer_Unloaded", sizeof(Serializer_Node), 1, false, nullptr, nullptr);
+		CASE_ASSERT_EQUAL(Serializer::getTypePlan(*type).dataVersions.find(type)->second, 1);
+		type->~TypeInfo();
+
+		type = new (storage) TypeInfo(L"traktor.test.Serializer_Reloaded", sizeof(Serializer_Node), 2, false, nullptr, nullptr);
+		const Serializer::TypePlan& plan = Serializer::getTypePlan(*type);
+		CASE_ASSERT_EQUAL(plan.dataVersions.find(type)->second, 2);
+		CASE_ASSERT_EQUAL((uint32_t)plan.name.size(), (uint32_t)wcslen(L"traktor.test.Serializer_Reloaded"));
+		type->~TypeInfo();
+	}
+}
+
+}
@@ -6,8 +6,7 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
-#include "Core/Memory/Alloc.h"
-#include "Core/Memory/BlockAllocator.h"
+#include "Core/Class/BoxedAllocator.h"
 #include "Core/Singleton/SingletonManager.h"
 #include "Core/Thread/Acquire.h"
 #include "Core/Thread/Event.h"
@@ -39,7 +38,7 @@ public:
 	{
 		T_ASSERT_M (size <= MaxJobSize, L"Allocation size too big");
 		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_allocatorLock);
-		void* ptr = m_blockAllocator.alloc();
+		void* ptr = m_allocator.alloc();
 		if (!ptr)
 			T_FATAL_ERROR;
 		m_count++;
@@ -52,8 +51,7 @@ public:
 			return;
 
 		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_allocatorLock);
-		bool result = m_blockAllocator.free(ptr);
-        T_ASSERT_M (result, L"Invalid pointer"); (void)result;
+		m_allocator.free(ptr);
 		m_count--;
 	}
 
@@ -61,25 +59,21 @@ protected:
 	virtual void destroy() { delete this; }
 
 private:
-	static constexpr size_t MaxJobCount = 512 * 1024;
+	static constexpr int JobsPerBlock = 1024;	//!< Heap grows by this many jobs when all are in use.
 	static constexpr size_t MaxJobSize = sizeof(Job);
 
-	void* m_block;
-	BlockAllocator m_blockAllocator;
+	BoxedAllocator< Job, JobsPerBlock > m_allocator;
 	SpinLock m_allocatorLock;
 	int32_t m_count;
 
 	JobHeap()
-	:	m_block(Alloc::acquireAlign(MaxJobCount * MaxJobSize, 16, T_FILE_LINE))
-	,	m_blockAllocator(m_block, MaxJobCount, MaxJobSize)
-	,	m_count(0)
+	:	m_count(0)
 	{
 	}
 
 	virtual ~JobHeap()
 	{
 		T_ASSERT_M (m_count == 0, L"There are still jobs allocated, memory leak?");
-		Alloc::freeAlign(m_block);
 	}
 };
 
@@ -100,7 +94,7 @@ bool Job::wait(int32_t timeout)
 
 void Job::cancel()
 {
-	m_task = nullptr;
+	m_cancelled = true;
 }
 
 void Job::stop()
@@ -123,9 +117,9 @@ void Job::operator delete (void* ptr)
 	JobHeap::getInstance().free(ptr);
 }
 
-Job::Job(Event& jobFinishedEvent, const std::function< void() >& task)
+Job::Job(Event& jobFinishedEvent)
 :	m_jobFinishedEvent(jobFinishedEvent)
-,	m_task(task)
+,	m_cancelled(false)
 ,	m_finished(false)
 {
 }
@@ -10,6 +10,7 @@
 
 #include <functional>
 #include "Core/Ref.h"
+#include "Core/Misc/StaticFunction.h"
 #include "Core/Thread/IWaitable.h"
 
 // import/export mechanism.
@@ -35,6 +36,11 @@ class T_DLLCLASS Job
 public:
 	typedef std::function< void() > task_t;
 
+	/*! Size of task storage inside job; larger functors are wrapped in a task_t. */
+	static constexpr size_t InlineTaskSize = 64;
+
+	typedef StaticFunction< void(), InlineTaskSize > inline_task_t;
+
 	virtual bool wait(int32_t timeout = -1) override final;
 
 	void cancel();
@@ -51,10 +57,22 @@ private:
 	friend class JobQueue;
 
 	Event& m_jobFinishedEvent;
-	task_t m_task;
+	inline_task_t m_task;
+	std::atomic< bool > m_cancelled;
 	std::atomic< bool > m_finished;
-
-	explicit Job(Event& jobFinishedEvent, const task_t& task);
+	std::atomic< int32_t >* m_joinCount = nullptr;
+	Event* m_joinEvent = nullptr;
+
+	explicit Job(Event& jobFinishedEvent);
+
+	template < typename FunctorType >
+	void setTask(FunctorType&& functor)
+	{
+		if constexpr (inline_task_t::fits< std::decay_t< FunctorType > >)
+			m_task = std::forward< FunctorType >(functor);
+		else
+			m_task = task_t(std::forward< FunctorType >(functor));
+	}
 
 	Job() = delete;
 
@@ -31,7 +31,8 @@ JobManager& JobManager::getInstance()
 
 		s_instance->m_queue.create(
 			coreCount,
-			Thread::Normal
+			Thread::Normal,
+			JobQueue::Scheduler::WorkStealing
 		);
 	}
 	return *s_instance;
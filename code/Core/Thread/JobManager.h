@@ -42,7 +42,8 @@ public:
 	 * a worker thread is idle the scheduler assigns
 	 * a new job to that thread from this queue.
 	 */
-	Ref< Job > add(const Job::task_t& functor) { return m_queue.add(functor); }
+	template < typename FunctorType >
+	Ref< Job > add(FunctorType&& functor) { return m_queue.add(std::forward< FunctorType >(functor)); }
 
 	/*! Enqueue jobs and wait for all to finish.
 	 *
@@ -50,7 +51,17 @@ public:
 	 * is always run on the caller thread to reduce
 	 * work for kernel scheduler.
 	 */
-	void fork(const Job::task_t* tasks, size_t ntasks) { return m_queue.fork(tasks, ntasks); }
+	template < typename FunctorType >
+	void fork(const FunctorType* functors, size_t nfunctors) { m_queue.fork(functors, nfunctors); }
+
+	/*! Process range in parallel and wait for all to finish.
+	 *
+	 * \param count Number of items in range.
+	 * \param grain Number of items in each batch.
+	 * \param body Functor called as body(from, to) for each batch.
+	 */
+	template < typename BodyType >
+	void parallelFor(int32_t count, int32_t grain, const BodyType& body) { m_queue.parallelFor(count, grain, body); }
 
 	/*! Wait until all jobs are finished.
 	 *
@@ -1,22 +1,82 @@
 /*
  * TRAKTOR
- * Copyright (c) 2022-2023 Anders Pistol.
+ * Copyright (c) 2022-2024 Anders Pistol.
  *
  * This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
-#include "Core/RefArray.h"
+#include "Core/Containers/WorkStealingDeque.h"
 #include "Core/Thread/JobQueue.h"
 #include "Core/Thread/ThreadManager.h"
 
 namespace traktor
 {
+	namespace
+	{
+
+/*! Number of failed attempts to find work before an idle worker goes to sleep. */
+const int32_t c_idleSpinCount = 64;
+
+/*! Capacity of each worker's deque; overflowing jobs are put in the shared queue. */
+const int64_t c_dequeCapacity = 8192;
+
+/*! Scheduling context of current thread, only set for work stealing worker threads. */
+struct ThreadContext
+{
+	const JobQueue* queue = nullptr;
+	int32_t workerIndex = -1;
+};
+
+thread_local ThreadContext t_context;
+
+/*! Events used to wake current thread when all it's forked jobs has finished.
+ *
+ * Each nested fork on a thread use a separate event, and every fork
+ * consume the single pulse of it's last job before returning thus no
+ * pulse is left to wake a later fork.
+ */
+struct JoinEvents
+{
+	AlignedVector< Event* > events;
+	int32_t depth = 0;
+
+	~JoinEvents()
+	{
+		for (auto event : events)
+			delete event;
+	}
+
+	Event& enter()
+	{
+		if (depth >= (int32_t)events.size())
+			events.push_back(new Event());
+		return *events[depth++];
+	}
+
+	void leave()
+	{
+		depth--;
+	}
+};
+
+thread_local JoinEvents t_joinEvents;
+
+	}
+
+struct JobQueue::Worker
+{
+	WorkStealingDeque< Job*, c_dequeCapacity > deque;
+	Event wakeEvent;
+	std::atomic< bool > sleeping = false;
+};
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.JobQueue", JobQueue, Object)
 
 JobQueue::JobQueue()
 :	m_pending(0)
+,	m_sleeping(0)
+,	m_wakeIndex(0)
 {
 }
 
@@ -25,15 +85,34 @@ JobQueue::~JobQueue()
 	destroy();
 }
 
-bool JobQueue::create(uint32_t workerThreads, Thread::Priority priority)
+bool JobQueue::create(uint32_t workerThreads, Thread::Priority priority, Scheduler scheduler)
 {
+	m_scheduler = scheduler;
+
+	if (m_scheduler == Scheduler::WorkStealing)
+	{
+		m_workers.resize(workerThreads);
+		for (uint32_t i = 0; i < uint32_t(m_workers.size()); ++i)
+			m_workers[i] = new Worker();
+	}
+
 	m_workerThreads.resize(workerThreads);
 	for (uint32_t i = 0; i < uint32_t(m_workerThreads.size()); ++i)
 	{
-		m_workerThreads[i] = ThreadManager::getInstance().create(
-			[=, this]() { threadWorker(); },
-			L"Job queue, worker thread"
-		);
+		if (m_scheduler == Scheduler::WorkStealing)
+		{
+			m_workerThreads[i] = ThreadManager::getInstance().create(
+				[=, this]() { threadWorkerStealing((int32_t)i); },
+				L"Job queue, worker thread"
+			);
+		}
+		else
+		{
+			m_workerThreads[i] = ThreadManager::getInstance().create(
+				[=, this]() { threadWorker(); },
+				L"Job queue, worker thread"
+			);
+		}
 		if (m_workerThreads[i])
 			m_workerThreads[i]->start(priority);
 		else
@@ -53,50 +132,75 @@ void JobQueue::destroy()
 		ThreadManager::getInstance().destroy(m_workerThreads[i]);
 
 	m_workerThreads.clear();
-}
 
-Ref< Job > JobQueue::add(const Job::task_t& task)
-{
-	Ref< Job > job = new Job(m_jobFinishedEvent, task);
-	T_SAFE_ADDREF(job);
-	m_jobQueue.put(job);
-	m_pending++;
-	m_jobQueuedEvent.pulse();
-	return job;
+	for (uint32_t i = 0; i < uint32_t(m_workers.size()); ++i)
+		delete m_workers[i];
+
+	m_workers.clear();
 }
 
-void JobQueue::fork(const Job::task_t* tasks, size_t ntasks)
+void JobQueue::forkIndexed(size_t ntasks, const indexed_task_t& task)
 {
-	RefArray< Job > jobs;
-
 	if (ntasks == 0)
 		return;
+	else if (ntasks == 1)
+	{
+		task(0);
+		return;
+	}
 
-	// Create jobs for given functors.
-	if (ntasks > 1)
+	Event& joinEvent = t_joinEvents.enter();
+	std::atomic< int32_t > joinCount((int32_t)(ntasks - 1));
+
+	// Create jobs for all but first task; jobs only reference the
+	// task thus no memory is allocated except for pooled jobs.
+	m_pending += (int32_t)(ntasks - 1);
+	for (size_t i = 1; i < ntasks; ++i)
 	{
-		jobs.resize(ntasks);
-		{
-			for (size_t i = 1; i < ntasks; ++i)
-			{
-				jobs[i] = new Job(m_jobFinishedEvent, tasks[i]);
-				T_SAFE_ADDREF(jobs[i]);
-				m_jobQueue.put(jobs[i]);
-			}
-		}
-		m_pending += (int32_t)(ntasks - 1);
-		m_jobQueuedEvent.pulse((int32_t)(ntasks - 1));
+		Job* job = new Job(m_jobFinishedEvent);
+		job->m_task = [&task, i]() { task(i); };
+		job->m_joinCount = &joinCount;
+		job->m_joinEvent = &joinEvent;
+		T_SAFE_ADDREF(job);
+
+		// Push jobs onto our own deque, or the shared queue if called
+		// from a foreign thread.
+		if (m_scheduler == Scheduler::WorkStealing)
+			enqueue(job);
+		else
+			m_jobQueue.put(job);
 	}
 
-	// Execute first functor on caller thread.
-	tasks[0]();
+	if (m_scheduler == Scheduler::WorkStealing)
+		wake((int32_t)(ntasks - 1));
+	else
+		m_jobQueuedEvent.pulse((int32_t)(ntasks - 1));
+
+	// Execute first task on caller thread.
+	task(0);
 
-	// Wait until all jobs has finished.
-	for (uint32_t i = 1; i < jobs.size(); )
+	// Help executing jobs until all of our jobs has been started.
+	if (m_scheduler == Scheduler::WorkStealing)
 	{
-		if (jobs[i]->wait())
-			++i;
+		const int32_t workerIndex = (t_context.queue == this) ? t_context.workerIndex : -1;
+		Job* job = nullptr;
+		if (workerIndex >= 0)
+		{
+			while (joinCount > 0 && dequeue(workerIndex, job))
+				execute(job);
+		}
+		else
+		{
+			// Foreign threads only execute their own jobs, not to get stuck on any long
+			// running job; other jobs are kept in place in the shared queue.
+			while (joinCount > 0 && m_jobQueue.get(job, [&](const Job* queued) { return queued->m_joinCount == &joinCount; }))
+				execute(job);
+		}
 	}
+
+	// Wait until last job has finished; last job always pulse once.
+	joinEvent.wait();
+	t_joinEvents.leave();
 }
 
 bool JobQueue::wait(int32_t timeout)
@@ -118,10 +222,111 @@ void JobQueue::stop()
 {
 	for (uint32_t i = 0; i < (uint32_t)m_workerThreads.size(); ++i)
 		m_workerThreads[i]->stop(0);
+	for (uint32_t i = 0; i < (uint32_t)m_workers.size(); ++i)
+		m_workers[i]->wakeEvent.pulse();
 	for (uint32_t i = 0; i < (uint32_t)m_workerThreads.size(); ++i)
 		m_workerThreads[i]->stop();
 }
 
+Ref< Job > JobQueue::submit(Job* job)
+{
+	Ref< Job > result = job;
+	T_SAFE_ADDREF(job);
+	m_pending++;
+
+	if (m_scheduler == Scheduler::WorkStealing)
+	{
+		enqueue(job);
+		wake(1);
+	}
+	else
+	{
+		m_jobQueue.put(job);
+		m_jobQueuedEvent.pulse();
+	}
+
+	return result;
+}
+
+void JobQueue::enqueue(Job* job)
+{
+	if (t_context.queue == this && m_workers[t_context.workerIndex]->deque.push(job))
+		return;
+	m_jobQueue.put(job);
+}
+
+bool JobQueue::dequeue(int32_t workerIndex, Job*& outJob)
+{
+	// Newest job from our own deque first, best cache locality.
+	if (workerIndex >= 0 && m_workers[workerIndex]->deque.pop(outJob))
+		return true;
+
+	// Jobs added from foreign threads.
+	if (m_jobQueue.get(outJob))
+		return true;
+
+	// Steal oldest job from any other worker.
+	const int32_t nworkers = (int32_t)m_workers.size();
+	const int32_t start = workerIndex + 1;
+	for (int32_t i = 0; i < nworkers; ++i)
+	{
+		const int32_t victim = (start + i) % nworkers;
+		if (victim != workerIndex && m_workers[victim]->deque.steal(outJob))
+			return true;
+	}
+
+	return false;
+}
+
+void JobQueue::execute(Job* job)
+{
+	if (job->m_task && !job->m_cancelled)
+		job->m_task();
+
+	// Fetch join event before signalling; the forking thread might return as soon as count reach zero.
+	std::atomic< int32_t >* joinCount = job->m_joinCount;
+	Event* joinEvent = job->m_joinEvent;
+
+	job->m_finished = true;
+	T_SAFE_RELEASE(job);
+
+	if (joinCount != nullptr)
+	{
+		if (--(*joinCount) == 0)
+			joinEvent->pulse();
+
+		// Forked jobs are waited on by the join event; only
+		// notify general waiters when queue become empty.
+		if (--m_pending == 0)
+			m_jobFinishedEvent.broadcast();
+	}
+	else
+	{
+		m_pending--;
+		m_jobFinishedEvent.broadcast();
+	}
+}
+
+void JobQueue::wake(int32_t count)
+{
+	// Ensure queued jobs are visible before checking for sleeping workers;
+	// pairs with the sleeping announcement in threadWorkerStealing.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	const int32_t nworkers = (int32_t)m_workers.size();
+	for (int32_t i = 0; i < nworkers && count > 0 && m_sleeping > 0; ++i)
+	{
+		Worker* worker = m_workers[(m_wakeIndex++) % nworkers];
+		bool expected = true;
+		if (worker->sleeping.compare_exchange_strong(expected, false))
+		{
+			m_sleeping--;
+			worker->wakeEvent.pulse();
+			--count;
+		}
+	}
+}
+
 void JobQueue::threadWorker()
 {
 	Thread* thread = ThreadManager::getInstance().getCurrentThread();
@@ -133,20 +338,61 @@ void JobQueue::threadWorker()
 		if (!m_jobQueue.get(job))
 		{
 			m_jobQueuedEvent.wait(100);
-			continue;			
+			continue;
 		}
 
-		// Execute job.
-		auto task = job->m_task;
-		if (task)
-			task();
-		job->m_finished = true;
-		T_SAFE_RELEASE(job);
+		execute(job);
+	}
+}
 
-		// Decrement number of pending jobs and signal anyone waiting for jobs to finish.
-		m_pending--;
-		m_jobFinishedEvent.broadcast();
+void JobQueue::threadWorkerStealing(int32_t workerIndex)
+{
+	Thread* thread = ThreadManager::getInstance().getCurrentThread();
+	Worker* worker = m_workers[workerIndex];
+	Job* job = nullptr;
+	int32_t idle = 0;
+
+	t_context.queue = this;
+	t_context.workerIndex = workerIndex;
+
+	while (!thread->stopped())
+	{
+		if (dequeue(workerIndex, job))
+		{
+			execute(job);
+			idle = 0;
+			continue;
+		}
+
+		// Spin a while before going to sleep, new jobs are often
+		// forked shortly after previous has finished.
+		if (++idle < c_idleSpinCount)
+		{
+			thread->yield();
+			continue;
+		}
+		idle = 0;
+
+		// Announce we're sleeping and check again, to not miss
+		// a job enqueued before the announcement was visible.
+		worker->sleeping = true;
+		m_sleeping++;
+		if (dequeue(workerIndex, job))
+		{
+			if (worker->sleeping.exchange(false))
+				m_sleeping--;
+			execute(job);
+			continue;
+		}
+
+		worker->wakeEvent.wait();
+
+		// Woken by stop, not by any enqueued job.
+		if (worker->sleeping.exchange(false))
+			m_sleeping--;
 	}
+
+	t_context = ThreadContext();
 }
 
 }
@@ -8,10 +8,12 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include "Core/Object.h"
 #include "Core/Containers/AlignedVector.h"
 #include "Core/Containers/ThreadsafeFifo.h"
+#include "Core/Misc/StaticFunction.h"
 #include "Core/Thread/Event.h"
 #include "Core/Thread/Job.h"
 #include "Core/Thread/Semaphore.h"
@@ -37,6 +39,13 @@ class T_DLLCLASS JobQueue : public Object
 	T_RTTI_CLASS;
 
 public:
+	/*! Job scheduling backend. */
+	enum class Scheduler
+	{
+		Shared,			//!< All jobs are placed in one shared queue.
+		WorkStealing	//!< Each worker owns a lock-free deque; idle workers steal from others.
+	};
+
 	JobQueue();
 
 	virtual ~JobQueue();
@@ -44,9 +53,11 @@ public:
 	/*! Create queue.
 	 *
 	 * \param workerThreads Number of worker threads.
+	 * \param priority Priority of worker threads.
+	 * \param scheduler Job scheduling backend.
 	 * \return True if successfully created.
 	 */
-	bool create(uint32_t workerThreads, Thread::Priority priority);
+	bool create(uint32_t workerThreads, Thread::Priority priority, Scheduler scheduler = Scheduler::Shared);
 
 	/*! Destroy queue. */
 	void destroy();
@@ -56,16 +67,62 @@ public:
 	 * Add job to internal worker queue, as soon as
 	 * a worker thread is idle the scheduler assigns
 	 * a new job to that thread from this queue.
+	 *
+	 * Functor is stored inside the pooled job if it's
+	 * small enough thus no memory is allocated.
 	 */
-	Ref< Job > add(const Job::task_t& task);
+	template < typename FunctorType >
+	Ref< Job > add(FunctorType&& functor)
+	{
+		Job* job = new Job(m_jobFinishedEvent);
+		job->setTask(std::forward< FunctorType >(functor));
+		return submit(job);
+	}
 
 	/*! Enqueue jobs and wait for all to finish.
 	 *
 	 * Add jobs to internal worker queue, one job
 	 * is always run on the caller thread to reduce
 	 * work for kernel scheduler.
+	 *
+	 * With work stealing the caller thread also
+	 * executes it's own forked jobs while waiting
+	 * for the remaining jobs to be stolen and finished.
+	 *
+	 * Functors are referenced, not copied, thus must
+	 * be kept alive by caller; no memory is allocated.
+	 */
+	template < typename FunctorType >
+	void fork(const FunctorType* functors, size_t nfunctors)
+	{
+		forkIndexed(nfunctors, [functors](size_t index) { functors[index](); });
+	}
+
+	/*! Process range in parallel and wait for all to finish.
+	 *
+	 * Range is split into batches of "grain" items, body
+	 * is called as body(from, to) for each batch.
+	 * No memory is allocated.
+	 *
+	 * \param count Number of items in range.
+	 * \param grain Number of items in each batch.
+	 * \param body Functor called for each batch.
 	 */
-	void fork(const Job::task_t* tasks, size_t ntasks);
+	template < typename BodyType >
+	void parallelFor(int32_t count, int32_t grain, const BodyType& body)
+	{
+		if (count <= 0)
+			return;
+
+		grain = std::max< int32_t >(grain, 1);
+		const int32_t nbatches = (count + grain - 1) / grain;
+
+		forkIndexed((size_t)nbatches, [&body, count, grain](size_t index) {
+			const int32_t from = (int32_t)index * grain;
+			const int32_t to = std::min< int32_t >(from + grain, count);
+			body(from, to);
+		});
+	}
 
 	/*! Wait until all jobs are finished.
 	 *
@@ -84,14 +141,42 @@ public:
 	/*! Stop all worker threads. */
 	void stop();
 
+	/*! Get job scheduling backend. */
+	Scheduler getScheduler() const { return m_scheduler; }
+
+	/*! Get number of worker threads. */
+	uint32_t getWorkerCount() const { return (uint32_t)m_workerThreads.size(); }
+
 private:
+	struct Worker;
+
+	typedef StaticFunction< void(size_t), 32 > indexed_task_t;
+
+	Scheduler m_scheduler = Scheduler::Shared;
 	AlignedVector< Thread* > m_workerThreads;
+	AlignedVector< Worker* > m_workers;
 	ThreadsafeFifo< Job* > m_jobQueue;
 	Event m_jobQueuedEvent;
 	Event m_jobFinishedEvent;
 	std::atomic< int32_t > m_pending;
+	std::atomic< int32_t > m_sleeping;
+	std::atomic< uint32_t > m_wakeIndex;
+
+	Ref< Job > submit(Job* job);
+
+	void forkIndexed(size_t ntasks, const indexed_task_t& task);
+
+	void enqueue(Job* job);
+
+	bool dequeue(int32_t workerIndex, Job*& outJob);
+
+	void execute(Job* job);
+
+	void wake(int32_t count);
 
 	void threadWorker();
+
+	void threadWorkerStealing(int32_t workerIndex);
 };
 
 }
@@ -11,11 +11,209 @@
 #include <limits>
 #include "Core/Containers/AlignedVector.h"
 #include "Core/Math/Const.h"
+#include "Core/Thread/JobManager.h"
 #include "Drawing/Image.h"
 #include "Drawing/Filters/ScaleFilter.h"
 
 namespace traktor::drawing
 {
+	namespace
+	{
+
+const int32_t c_rowsPerJob = 16;	//!< Number of destination rows resampled by each job.
+const float c_kaiserAlpha = 4.0f;
+
+enum class Kernel
+{
+	Point,
+	Box,
+	Triangle,
+	Lanczos,
+	Mitchell,
+	Kaiser
+};
+
+/*! Precomputed weights of each destination pixel along one axis. */
+struct WeightTable
+{
+	int32_t taps = 0;					//!< Number of source pixels contributing to each destination pixel.
+	AlignedVector< int32_t > first;		//!< First contributing source pixel of each destination pixel.
+	AlignedVector< Scalar > weights;	//!< Weight of each contributing source pixel, taps per destination pixel.
+};
+
+float sinc(float x)
+{
+	if (std::abs(x) <= FUZZY_EPSILON)
+		return 1.0f;
+	x *= PI;
+	return std::sin(x) / x;
+}
+
+float besselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (int32_t k = 1; k < 16; ++k)
+	{
+		const float f = x / (2.0f * k);
+		term *= f * f;
+		sum += term;
+	}
+	return sum;
+}
+
+float kernelSupport(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Box:
+		return 0.5f;
+	case Kernel::Triangle:
+		return 1.0f;
+	case Kernel::Mitchell:
+		return 2.0f;
+	case Kernel::Lanczos:
+	case Kernel::Kaiser:
+		return 3.0f;
+	default:
+		return 0.0f;
+	}
+}
+
+float kernelWeight(Kernel kernel, float x)
+{
+	const float ax = std::abs(x);
+	switch (kernel)
+	{
+	case Kernel::Box:
+		return (x >= -0.5f && x < 0.5f) ? 1.0f : 0.0f;
+
+	case Kernel::Triangle:
+		return std::max(1.0f - ax, 0.0f);
+
+	case Kernel::Lanczos:
+		return ax < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+
+	case Kernel::Mitchell:
+		{
+			const float B = 1.0f / 3.0f;
+			const float C = 1.0f / 3.0f;
+			if (ax < 1.0f)
+				return ((12.0f - 9.0f * B - 6.0f * C) * ax * ax * ax + (-18.0f + 12.0f * B + 6.0f * C) * ax * ax + (6.0f - 2.0f * B)) / 6.0f;
+			else if (ax < 2.0f)
+				return ((-B - 6.0f * C) * ax * ax * ax + (6.0f * B + 30.0f * C) * ax * ax + (-12.0f * B - 48.0f * C) * ax + (8.0f * B + 24.0f * C)) / 6.0f;
+			else
+				return 0.0f;
+		}
+
+	case Kernel::Kaiser:
+		{
+			if (ax >= 3.0f)
+				return 0.0f;
+			const float t = ax / 3.0f;
+			return sinc(x) * besselI0(c_kaiserAlpha * std::sqrt(1.0f - t * t)) / besselI0(c_kaiserAlpha);
+		}
+
+	default:
+		return 0.0f;
+	}
+}
+
+Kernel selectKernel(ScaleFilter::MinifyType minify, ScaleFilter::MagnifyType magnify, float scale)
+{
+	if (scale > 1.0f)
+	{
+		switch (minify)
+		{
+		case ScaleFilter::MnAverage:
+			return Kernel::Box;
+		case ScaleFilter::MnLanczos:
+			return Kernel::Lanczos;
+		case ScaleFilter::MnMitchell:
+			return Kernel::Mitchell;
+		case ScaleFilter::MnKaiser:
+			return Kernel::Kaiser;
+		default:
+			return Kernel::Point;
+		}
+	}
+	else if (scale < 1.0f)
+	{
+		switch (magnify)
+		{
+		case ScaleFilter::MgLinear:
+			return Kernel::Triangle;
+		case ScaleFilter::MgLanczos:
+			return Kernel::Lanczos;
+		case ScaleFilter::MgMitchell:
+			return Kernel::Mitchell;
+		case ScaleFilter::MgKaiser:
+			return Kernel::Kaiser;
+		default:
+			return Kernel::Point;
+		}
+	}
+	else
+		return Kernel::Point;
+}
+
+void buildWeightTable(Kernel kernel, int32_t sourceSize, int32_t destinationSize, WeightTable& outTable)
+{
+	const float scale = sourceSize / float(destinationSize);
+
+	// Stretch kernel when minifying, else high frequencies alias.
+	const float filterScale = std::max(scale, 1.0f);
+	const float support = kernelSupport(kernel) * filterScale;
+
+	const int32_t taps = (kernel != Kernel::Point) ? std::min((int32_t)std::ceil(support * 2.0f) + 1, sourceSize) : 1;
+	outTable.taps = taps;
+	outTable.first.resize(destinationSize);
+	outTable.weights.resize(destinationSize * taps, Scalar(0.0f));
+
+	AlignedVector< float > weights(taps);
+	for (int32_t d = 0; d < destinationSize; ++d)
+	{
+		const float center = (d + 0.5f) * scale - 0.5f;
+
+		if (kernel == Kernel::Point)
+		{
+			outTable.first[d] = clamp((int32_t)std::floor(center + 0.5f), 0, sourceSize - 1);
+			outTable.weights[d] = Scalar(1.0f);
+			continue;
+		}
+
+		// Source pixels outside of image are clamped to edge, window is moved
+		// inside image thus each pixel's weight is accumulated into same tap.
+		const int32_t start = (int32_t)std::ceil(center - support);
+		const int32_t end = (int32_t)std::floor(center + support);
+		const int32_t first = clamp(start, 0, std::max(sourceSize - taps, 0));
+
+		for (int32_t i = 0; i < taps; ++i)
+			weights[i] = 0.0f;
+
+		float sum = 0.0f;
+		for (int32_t i = start; i <= end; ++i)
+		{
+			const float w = kernelWeight(kernel, (i - center) / filterScale);
+			const int32_t tap = clamp(i, 0, sourceSize - 1) - first;
+			T_ASSERT(tap >= 0 && tap < taps);
+			weights[tap] += w;
+			sum += w;
+		}
+
+		if (std::abs(sum) <= FUZZY_EPSILON)
+		{
+			weights[clamp((int32_t)std::floor(center + 0.5f), 0, sourceSize - 1) - first] = 1.0f;
+			sum = 1.0f;
+		}
+
+		outTable.first[d] = first;
+		for (int32_t i = 0; i < taps; ++i)
+			outTable.weights[d * taps + i] = Scalar(weights[i] / sum);
+	}
+}
+
+	}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.drawing.ScaleFilter", ScaleFilter, IImageFilter)
 
@@ -37,163 +235,277 @@ ScaleFilter::ScaleFilter(
 void ScaleFilter::apply(Image* image) const
 {
 	Ref< Image > final = new Image(image->getPixelFormat(), m_width, m_height, image->getPalette());
-	Color4f in, out;
-	Color4f c1, c2;
 
+	const bool kernel =
+		m_minify == MnLanczos || m_minify == MnMitchell || m_minify == MnKaiser ||
+		m_magnify == MgLanczos || m_magnify == MgMitchell || m_magnify == MgKaiser;
+
+	if (kernel)
+		applyKernel(image, final);
+	else
+		applyFixed(image, final);
+
+	image->swap(final);
+}
+
+void ScaleFilter::applyFixed(const Image* image, Image* final) const
+{
 	const int32_t imageWidth = image->getWidth();
 	const int32_t imageHeight = image->getHeight();
 
 	const float sx = imageWidth / float(m_width);
 	const float sy = imageHeight / float(m_height);
 
-	AlignedVector< Color4f > span(imageWidth + 1, Color4f(0, 0, 0, 0));
-	AlignedVector< Color4f > row(imageWidth + 1, Color4f(0, 0, 0, 0));
+	JobManager::getInstance().parallelFor(m_height, c_rowsPerJob, [&](int32_t from, int32_t to) {
+		AlignedVector< Color4f > span(imageWidth + 1, Color4f(0, 0, 0, 0));
+		AlignedVector< Color4f > row(imageWidth + 1, Color4f(0, 0, 0, 0));
+		AlignedVector< Color4f > out(m_width, Color4f(0, 0, 0, 0));
 
-	for (int32_t y = 0; y < m_height; ++y)
-	{
-		if (sy < 1.0f)		// Magnify
+		for (int32_t y = from; y < to; ++y)
 		{
-			if (m_magnify == MgNearest)
-			{
-				int32_t yy = int32_t(std::floor(y * sy));
-				image->getSpanUnsafe(yy, &row[0]);
-			}
-			else	// MgLinear
+			if (sy < 1.0f)		// Magnify
 			{
-				int32_t yy = int32_t(std::floor(y * sy));
-				int32_t yn = std::min(yy + 1, imageHeight - 1);
+				if (m_magnify == MgNearest)
+				{
+					int32_t yy = int32_t(std::floor(y * sy));
+					image->getSpanUnsafe(yy, &row[0]);
+				}
+				else	// MgLinear
+				{
+					int32_t yy = int32_t(std::floor(y * sy));
+					int32_t yn = std::min(yy + 1, imageHeight - 1);
 
-				image->getSpanUnsafe(yy, &row[0]);
-				image->getSpanUnsafe(yn, &span[0]);
+					image->getSpanUnsafe(yy, &row[0]);
+					image->getSpanUnsafe(yn, &span[0]);
 
-				Scalar k(y * sy - yy);
-				for (int32_t x = 0; x < imageWidth; ++x)
-					row[x] = row[x] + (span[x] - row[x]) * k;
-			}
-		}
-		else if (sy > 1.0f)	// Minify
-		{
-			if (m_minify == MnCenter)
-			{
-				int32_t yy = int32_t(std::floor(y + sy * 0.5f));
-				image->getSpanUnsafe(yy, &row[0]);
+					Scalar k(y * sy - yy);
+					for (int32_t x = 0; x < imageWidth; ++x)
+						row[x] = row[x] + (span[x] - row[x]) * k;
+				}
 			}
-			else	// MnAverage
+			else if (sy > 1.0f)	// Minify
 			{
-				int32_t y1 = int32_t(std::floor(y * sy));
-				int32_t y2 = int32_t(std::floor(y * sy + sy));
-
-				image->getSpanUnsafe(y1, &row[0]);
-
-				if (m_keepZeroAlpha)
+				if (m_minify == MnCenter)
 				{
-					for (int32_t x = 0; x < imageWidth; ++x)
-					{
-						if (row[x].getAlpha() <= FUZZY_EPSILON)
-							row[x].setAlpha(Scalar(-std::numeric_limits< float >::max()));
-					}
+					int32_t yy = int32_t(std::floor(y + sy * 0.5f));
+					image->getSpanUnsafe(yy, &row[0]);
 				}
-
-				for (int32_t yy = y1 + 1; yy < y2; ++yy)
+				else	// MnAverage
 				{
-					image->getSpanUnsafe(yy, &span[0]);
-					if (!m_keepZeroAlpha)
-					{
-						for (int32_t x = 0; x < imageWidth; ++x)
-							row[x] += span[x];
-					}
-					else
+					int32_t y1 = int32_t(std::floor(y * sy));
+					int32_t y2 = int32_t(std::floor(y * sy + sy));
+
+					image->getSpanUnsafe(y1, &row[0]);
+
+					if (m_keepZeroAlpha)
 					{
 						for (int32_t x = 0; x < imageWidth; ++x)
 						{
-							row[x] += span[x];
-							if (span[x].getAlpha() <= FUZZY_EPSILON)
+							if (row[x].getAlpha() <= FUZZY_EPSILON)
 								row[x].setAlpha(Scalar(-std::numeric_limits< float >::max()));
 						}
 					}
-				}
 
-				Scalar denom = Scalar(1.0f / float(y2 - y1));
-				for (int32_t x = 0; x < imageWidth; ++x)
-					row[x] *= denom;
+					for (int32_t yy = y1 + 1; yy < y2; ++yy)
+					{
+						image->getSpanUnsafe(yy, &span[0]);
+						if (!m_keepZeroAlpha)
+						{
+							for (int32_t x = 0; x < imageWidth; ++x)
+								row[x] += span[x];
+						}
+						else
+						{
+							for (int32_t x = 0; x < imageWidth; ++x)
+							{
+								row[x] += span[x];
+								if (span[x].getAlpha() <= FUZZY_EPSILON)
+									row[x].setAlpha(Scalar(-std::numeric_limits< float >::max()));
+							}
+						}
+					}
 
-				if (m_keepZeroAlpha)
-				{
+					Scalar denom = Scalar(1.0f / float(y2 - y1));
 					for (int32_t x = 0; x < imageWidth; ++x)
+						row[x] *= denom;
+
+					if (m_keepZeroAlpha)
 					{
-						if (row[x].getAlpha() < 0.0f)
-							row[x].setAlpha(Scalar(0.0f));
+						for (int32_t x = 0; x < imageWidth; ++x)
+						{
+							if (row[x].getAlpha() < 0.0f)
+								row[x].setAlpha(Scalar(0.0f));
+						}
 					}
 				}
 			}
-		}
-		else	// Keep
-		{
-			image->getSpanUnsafe(y, &row[0]);
-		}
-
-		for (int32_t x = 0; x < m_width; ++x)
-		{
-			if (sx < 1.0f)		// Magnify
+			else	// Keep
 			{
-				if (m_magnify == MgNearest)
-				{
-					int32_t xx = int32_t(std::floor(x * sx));
-					final->setPixelUnsafe(x, y, row[xx]);
-				}
-				else	// MgLinear
-				{
-					int32_t xx = int32_t(std::floor(x * sx));
-					int32_t xn = std::min(xx + 1, imageWidth - 1);
-					final->setPixelUnsafe(x, y, row[xx] + (row[xn] - row[xx]) * Scalar(x * sx - xx));
-				}
+				image->getSpanUnsafe(y, &row[0]);
 			}
-			else if (sx > 1.0f)	// Minify
+
+			for (int32_t x = 0; x < m_width; ++x)
 			{
-				if (m_minify == MnCenter)
+				if (sx < 1.0f)		// Magnify
 				{
-					int32_t xx = int32_t(std::floor(x * sx + sx * 0.5f));
-					final->setPixelUnsafe(x, y, row[xx]);
+					if (m_magnify == MgNearest)
+					{
+						int32_t xx = int32_t(std::floor(x * sx));
+						out[x] = row[xx];
+					}
+					else	// MgLinear
+					{
+						int32_t xx = int32_t(std::floor(x * sx));
+						int32_t xn = std::min(xx + 1, imageWidth - 1);
+						out[x] = row[xx] + (row[xn] - row[xx]) * Scalar(x * sx - xx);
+					}
 				}
-				else	// MnAverage
+				else if (sx > 1.0f)	// Minify
 				{
-					int32_t x1 = int32_t(std::floor(x * sx));
-					int32_t x2 = std::min< int32_t >(int32_t(std::floor(x * sx + sx)), imageWidth);
-
-					bool zeroAlpha = false;
-
-					Color4f c(0, 0, 0, 0);
-					if (!m_keepZeroAlpha)
+					if (m_minify == MnCenter)
 					{
-						for (int32_t xx = x1; xx < x2; ++xx)
-							c += row[xx];
+						int32_t xx = int32_t(std::floor(x * sx + sx * 0.5f));
+						out[x] = row[xx];
 					}
-					else
+					else	// MnAverage
 					{
-						for (int32_t xx = x1; xx < x2; ++xx)
+						int32_t x1 = int32_t(std::floor(x * sx));
+						int32_t x2 = std::min< int32_t >(int32_t(std::floor(x * sx + sx)), imageWidth);
+
+						bool zeroAlpha = false;
+
+						Color4f c(0, 0, 0, 0);
+						if (!m_keepZeroAlpha)
 						{
-							c += row[xx];
-							if (row[xx].getAlpha() <= FUZZY_EPSILON)
-								zeroAlpha = true;
+							for (int32_t xx = x1; xx < x2; ++xx)
+								c += row[xx];
+						}
+						else
+						{
+							for (int32_t xx = x1; xx < x2; ++xx)
+							{
+								c += row[xx];
+								if (row[xx].getAlpha() <= FUZZY_EPSILON)
+									zeroAlpha = true;
+							}
 						}
-					}
 
-					c /= Scalar(float(x2 - x1));
+						c /= Scalar(float(x2 - x1));
 
-					if (zeroAlpha)
-						c.setAlpha(Scalar(0.0f));
+						if (zeroAlpha)
+							c.setAlpha(Scalar(0.0f));
 
-					final->setPixelUnsafe(x, y, c);
+						out[x] = c;
+					}
+				}
+				else	// Keep
+				{
+					out[x] = row[x];
 				}
 			}
-			else	// Keep
+
+			final->setSpanUnsafe(y, out.c_ptr());
+		}
+	});
+}
+
+void ScaleFilter::applyKernel(const Image* image, Image* final) const
+{
+	const int32_t imageWidth = image->getWidth();
+	const int32_t imageHeight = image->getHeight();
+
+	const float sx = imageWidth / float(m_width);
+	const float sy = imageHeight / float(m_height);
+
+	WeightTable wx, wy;
+	buildWeightTable(selectKernel(m_minify, m_magnify, sx), imageWidth, m_width, wx);
+	buildWeightTable(selectKernel(m_minify, m_magnify, sy), imageHeight, m_height, wy);
+
+	// Each job resample a band of rows; horizontal pass of all source rows contributing to
+	// band is kept, thus only rows shared with neighbour bands are resampled twice.
+	JobManager::getInstance().parallelFor(m_height, c_rowsPerJob, [&](int32_t from, int32_t to) {
+		const int32_t sourceFrom = wy.first[from];
+		const int32_t sourceTo = wy.first[to - 1] + wy.taps;
+
+		AlignedVector< Color4f > span(imageWidth);
+		AlignedVector< Vector4 > rows(m_width * (sourceTo - sourceFrom));
+		AlignedVector< uint8_t > zeroRows;
+		AlignedVector< Color4f > out(m_width);
+
+		if (m_keepZeroAlpha)
+			zeroRows.resize(m_width * (sourceTo - sourceFrom), 0);
+
+		// Horizontal pass.
+		for (int32_t yy = sourceFrom; yy < sourceTo; ++yy)
+		{
+			image->getSpanUnsafe(yy, span.ptr());
+
+			Vector4* row = &rows[(yy - sourceFrom) * m_width];
+			for (int32_t x = 0; x < m_width; ++x)
 			{
-				final->setPixelUnsafe(x, y, row[x]);
+				const Color4f* s = &span[wx.first[x]];
+				const Scalar* w = &wx.weights[x * wx.taps];
+
+				Vector4 acc = Vector4::zero();
+				for (int32_t i = 0; i < wx.taps; ++i)
+					acc += (const Vector4&)s[i] * w[i];
+				row[x] = acc;
+			}
+
+			// Destination pixel is transparent if any contributing source pixel is transparent.
+			if (m_keepZeroAlpha)
+			{
+				uint8_t* zeroRow = &zeroRows[(yy - sourceFrom) * m_width];
+				for (int32_t x = 0; x < m_width; ++x)
+				{
+					const Color4f* s = &span[wx.first[x]];
+					const Scalar* w = &wx.weights[x * wx.taps];
+					for (int32_t i = 0; i < wx.taps; ++i)
+					{
+						if (s[i].getAlpha() <= FUZZY_EPSILON && abs(w[i]) > FUZZY_EPSILON)
+							zeroRow[x] = 1;
+					}
+				}
 			}
 		}
-	}
 
-	image->swap(final);
+		// Vertical pass.
+		for (int32_t y = from; y < to; ++y)
+		{
+			const int32_t first = wy.first[y] - sourceFrom;
+			const Scalar* w = &wy.weights[y * wy.taps];
+
+			Vector4* o = (Vector4*)out.ptr();
+			for (int32_t x = 0; x < m_width; ++x)
+				o[x] = rows[first * m_width + x] * w[0];
+
+			for (int32_t i = 1; i < wy.taps; ++i)
+			{
+				const Vector4* row = &rows[(first + i) * m_width];
+				const Scalar wi = w[i];
+				for (int32_t x = 0; x < m_width; ++x)
+					o[x] += row[x] * wi;
+			}
+
+			if (m_keepZeroAlpha)
+			{
+				for (int32_t i = 0; i < wy.taps; ++i)
+				{
+					if (abs(w[i]) <= FUZZY_EPSILON)
+						continue;
+
+					const uint8_t* zeroRow = &zeroRows[(first + i) * m_width];
+					for (int32_t x = 0; x < m_width; ++x)
+					{
+						if (zeroRow[x])
+							out[x].setAlpha(Scalar(0.0f));
+					}
+				}
+			}
+
+			final->setSpanUnsafe(y, out.c_ptr());
+		}
+	});
 }
 
 }
@@ -24,8 +24,11 @@ namespace traktor::drawing
 /*! Scale image filter.
  * \ingroup Drawing
  *
- * Magnify or minify image, either using point sampling or
- * linear filtering.
+ * Magnify or minify image, either using point sampling,
+ * linear filtering or a separable resampling kernel.
+ *
+ * Rows are resampled in parallel; resampling kernels use
+ * weight tables precomputed for each axis.
  */
 class T_DLLCLASS ScaleFilter : public IImageFilter
 {
@@ -36,14 +39,20 @@ public:
 	enum MinifyType
 	{
 		MnCenter,	// Center source pixel.
-		MnAverage	// Average pixels from source rectangle.
+		MnAverage,	// Average pixels from source rectangle.
+		MnLanczos,	// Lanczos windowed sinc, 3 lobes.
+		MnMitchell,	// Mitchell-Netravali cubic, B = C = 1/3.
+		MnKaiser	// Kaiser windowed sinc, 3 lobes.
 	};
 
 	// Scale method when image is scaled up.
 	enum MagnifyType
 	{
 		MgNearest,	// Nearest source pixel.
-		MgLinear	// Linear interpolate source pixels.
+		MgLinear,	// Linear interpolate source pixels.
+		MgLanczos,	// Lanczos windowed sinc, 3 lobes.
+		MgMitchell,	// Mitchell-Netravali cubic, B = C = 1/3.
+		MgKaiser	// Kaiser windowed sinc, 3 lobes.
 	};
 
 	explicit ScaleFilter(
@@ -63,6 +72,10 @@ private:
 	MinifyType m_minify;
 	MagnifyType m_magnify;
 	bool m_keepZeroAlpha;
+
+	void applyFixed(const Image* image, Image* final) const;
+
+	void applyKernel(const Image* image, Image* final) const;
 };
 
 }
@@ -0,0 +1,162 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cmath>
+#include "Core/Log/Log.h"
+#include "Core/Math/Color4f.h"
+#include "Core/System/OS.h"
+#include "Core/Timer/Timer.h"
+#include "Drawing/Image.h"
+#include "Drawing/PixelFormat.h"
+#include "Drawing/Filters/ScaleFilter.h"
+#include "Drawing/Test/CaseScaleFilter.h"
+
+namespace traktor::drawing::test
+{
+	namespace
+	{
+
+struct Mode
+{
+	const wchar_t* name;
+	ScaleFilter::MinifyType minify;
+	ScaleFilter::MagnifyType magnify;
+};
+
+const Mode c_modes[] =
+{
+	{ L"Center/Nearest", ScaleFilter::MnCenter, ScaleFilter::MgNearest },
+	{ L"Average/Linear", ScaleFilter::MnAverage, ScaleFilter::MgLinear },
+	{ L"Lanczos", ScaleFilter::MnLanczos, ScaleFilter::MgLanczos },
+	{ L"Mitchell", ScaleFilter::MnMitchell, ScaleFilter::MgMitchell },
+	{ L"Kaiser", ScaleFilter::MnKaiser, ScaleFilter::MgKaiser }
+};
+
+Ref< Image > createImage(int32_t width, int32_t height)
+{
+	Ref< Image > image = new Image(PixelFormat::getR8G8B8A8(), width, height);
+	uint32_t seed = 1234;
+	for (int32_t y = 0; y < height; ++y)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			seed = seed * 1664525 + 1013904223;
+			const float noise = (seed >> 24) / 255.0f;
+			image->setPixelUnsafe(x, y, Color4f(x / float(width), y / float(height), noise, 1.0f));
+		}
+	}
+	return image;
+}
+
+bool isUniform(const Image* image, const Color4f& color)
+{
+	for (int32_t y = 0; y < image->getHeight(); ++y)
+	{
+		for (int32_t x = 0; x < image->getWidth(); ++x)
+		{
+			Color4f c;
+			image->getPixelUnsafe(x, y, c);
+			for (int32_t i = 0; i < 4; ++i)
+			{
+				if (std::abs(c.get(i) - color.get(i)) > 1e-4f)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.drawing.test.CaseScaleFilter", 0, CaseScaleFilter, traktor::test::Case)
+
+void CaseScaleFilter::run()
+{
+	// Kernel weights are normalized; uniform image remain uniform when minified and magnified.
+	const Color4f color(0.25f, 0.5f, 0.75f, 1.0f);
+	for (const auto& mode : c_modes)
+	{
+		const int32_t sizes[][2] = { { 37, 19 }, { 256, 128 }, { 300, 500 } };
+		for (const auto& size : sizes)
+		{
+			Ref< Image > image = new Image(PixelFormat::getRGBAF32(), 128, 128);
+			image->clear(color);
+
+			ScaleFilter scaleFilter(size[0], size[1], mode.minify, mode.magnify);
+			image->apply(&scaleFilter);
+
+			CASE_ASSERT_EQUAL(image->getWidth(), size[0]);
+			CASE_ASSERT_EQUAL(image->getHeight(), size[1]);
+			CASE_ASSERT(isUniform(image, color));
+		}
+	}
+
+	// Pixels covering a transparent source pixel remain transparent.
+	{
+		Ref< Image > image = new Image(PixelFormat::getRGBAF32(), 64, 64);
+		image->clear(color);
+		image->setPixelUnsafe(10, 20, Color4f(0.0f, 0.0f, 0.0f, 0.0f));
+
+		ScaleFilter scaleFilter(32, 32, ScaleFilter::MnLanczos, ScaleFilter::MgLanczos, true);
+		image->apply(&scaleFilter);
+
+		Color4f c;
+		image->getPixelUnsafe(5, 10, c);
+		CASE_ASSERT(c.getAlpha() <= FUZZY_EPSILON);
+		image->getPixelUnsafe(20, 20, c);
+		CASE_ASSERT(c.getAlpha() > 0.5f);
+	}
+
+	// Each filter create first mip level of a non-uniform image.
+	{
+		Ref< Image > source = createImage(256, 256);
+		for (const auto& mode : c_modes)
+		{
+			Ref< Image > image = source->clone();
+
+			ScaleFilter scaleFilter(128, 128, mode.minify, mode.magnify);
+			image->apply(&scaleFilter);
+
+			CASE_ASSERT_EQUAL(image->getWidth(), 128);
+			CASE_ASSERT_EQUAL(image->getHeight(), 128);
+
+			// Gradient is preserved by all filters.
+			Color4f first, last;
+			image->getPixelUnsafe(8, 8, first);
+			image->getPixelUnsafe(119, 119, last);
+			CASE_ASSERT(first.getRed() < last.getRed());
+			CASE_ASSERT(first.getGreen() < last.getGreen());
+		}
+	}
+
+	// Time each filter creating first mip level of 4k and 8k images; only when
+	// benchmarks are requested as it takes considerable time.
+	std::wstring benchmark;
+	if (!OS::getInstance().getEnvironment(L"TRAKTOR_TEST_BENCHMARK", benchmark) || benchmark.empty())
+		return;
+
+	const int32_t benchmarkSizes[] = { 4096, 8192 };
+	for (auto size : benchmarkSizes)
+	{
+		Ref< Image > source = createImage(size, size);
+		for (const auto& mode : c_modes)
+		{
+			Ref< Image > image = source->clone();
+
+			Timer timer;
+			ScaleFilter scaleFilter(size / 2, size / 2, mode.minify, mode.magnify);
+			image->apply(&scaleFilter);
+			const double duration = timer.getElapsedTime();
+
+			CASE_ASSERT_EQUAL(image->getWidth(), size / 2);
+			log::info << L"ScaleFilter " << mode.name << L", " << size << L" -> " << (size / 2) << L": " << int32_t(duration * 1000.0) << L" ms" << Endl;
+		}
+	}
+}
+
+}
@@ -1824,7 +1824,8 @@ void EditorForm::buildAssetsThread(AlignedVector< Guid > assetGuids, bool rebuil
 			log::info << L"Collected " << dependencySet.size() << L" dependencies from " << assetGuids.size() << L" root(s) in " << formatDuration(elapsedDependencies) << L"." << Endl;
 		}
 
-		// Build output.
+		// Build output; zero build threads means one build per core.
+		const int32_t buildThreads = m_mergedSettings->getProperty< bool >(L"Pipeline.BuildThreads", true) ? m_mergedSettings->getProperty< int32_t >(L"Pipeline.BuildThreads.Count", 0) : 1;
 		Ref< IPipelineBuilder > pipelineBuilder = new PipelineBuilder(
 			&pipelineFactory,
 			m_sourceDatabase,
@@ -1833,7 +1834,8 @@ void EditorForm::buildAssetsThread(AlignedVector< Guid > assetGuids, bool rebuil
 			m_pipelineDb,
 			&instanceCache,
 			this,
-			verbose);
+			verbose,
+			buildThreads);
 
 		if (rebuild)
 			log::info << L"Rebuilding " << dependencySet.size() << L" asset(s)..." << Endl;
@@ -45,6 +45,17 @@ bool PipelineSettingsPage::create(ui::Container* parent, const PropertyGroup* or
 	m_checkDependsThreads->create(container, i18n::Text(L"EDITOR_SETTINGS_PIPELINE_DEPENDS_THREADS"));
 	m_checkDependsThreads->setChecked(dependsThreads);
 
+	bool buildThreads = settings->getProperty< bool >(L"Pipeline.BuildThreads", true);
+
+	m_checkBuildThreads = new ui::CheckBox();
+	m_checkBuildThreads->create(container, i18n::Text(L"EDITOR_SETTINGS_PIPELINE_BUILD_THREADS"));
+	m_checkBuildThreads->setChecked(buildThreads);
+	m_checkBuildThreads->addEventHandler< ui::ButtonClickEvent >(this, &PipelineSettingsPage::eventUseCacheClick);
+
+	m_editBuildThreadsCount = new ui::Edit();
+	m_editBuildThreadsCount->create(container, toString(settings->getProperty< int32_t >(L"Pipeline.BuildThreads.Count", 0)), ui::WsNone, new ui::NumericEditValidator(false, 0, 256));
+	m_editBuildThreadsCount->setEnable(buildThreads);
+
 	// Avalanche
 	bool avalancheEnable = settings->getProperty< bool >(L"Pipeline.AvalancheCache", false);
 
@@ -116,6 +127,9 @@ bool PipelineSettingsPage::apply(PropertyGroup* settings)
 
 	settings->setProperty< PropertyBoolean >(L"Pipeline.DependsThreads", m_checkDependsThreads->isChecked());
 
+	settings->setProperty< PropertyBoolean >(L"Pipeline.BuildThreads", m_checkBuildThreads->isChecked());
+	settings->setProperty< PropertyInteger >(L"Pipeline.BuildThreads.Count", parseString< int32_t >(m_editBuildThreadsCount->getText()));
+
 	settings->setProperty< PropertyBoolean >(L"Pipeline.AvalancheCache", m_checkUseAvalanche->isChecked());
 	settings->setProperty< PropertyString >(L"Pipeline.AvalancheCache.Host", m_editAvalancheHost->getText());
 	settings->setProperty< PropertyInteger >(L"Pipeline.AvalancheCache.Port", parseString< int32_t >(m_editAvalanchePort->getText()));
@@ -135,6 +149,8 @@ bool PipelineSettingsPage::apply(PropertyGroup* settings)
 
 void PipelineSettingsPage::eventUseCacheClick(ui::ButtonClickEvent* event)
 {
+	m_editBuildThreadsCount->setEnable(m_checkBuildThreads->isChecked());
+
 	bool avalancheEnable = m_checkUseAvalanche->isChecked();
 	m_editAvalancheHost->setEnable(avalancheEnable);
 	m_editAvalanchePort->setEnable(avalancheEnable);
@@ -42,6 +42,11 @@ bool AssetsPipeline::shouldCache() const
 	return false;
 }
 
+bool AssetsPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t AssetsPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
@@ -41,6 +41,12 @@ bool DefaultPipeline::shouldCache() const
 	return false;
 }
 
+bool DefaultPipeline::isThreadSafe() const
+{
+	// Derived pipelines must opt in by themselves.
+	return &type_of(this) == &type_of< DefaultPipeline >();
+}
+
 uint32_t DefaultPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
@@ -46,6 +46,8 @@ public:
 
 	virtual bool shouldCache() const override;
 
+	virtual bool isThreadSafe() const override;
+
 	virtual uint32_t hashAsset(const ISerializable* sourceAsset) const override;
 
 	virtual bool buildDependencies(
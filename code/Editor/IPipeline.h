@@ -70,6 +70,13 @@ public:
 	/*! Return true if this pipeline benefit from being cached. */
 	virtual bool shouldCache() const = 0;
 
+	/*! Return true if this pipeline can build multiple outputs concurrently.
+	 *
+	 * Pipelines must opt in after being audited; outputs of
+	 * other pipelines are built exclusively by the pipeline builder.
+	 */
+	virtual bool isThreadSafe() const { return false; }
+
 	/*! Calculate hash of asset. */
 	virtual uint32_t hashAsset(const ISerializable* sourceAsset) const = 0;
 
@@ -11,6 +11,7 @@
 #include "Core/Guid.h"
 #include "Core/Object.h"
 #include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
 #include "Core/Misc/Key.h"
 #include "Editor/PipelineTypes.h"
 
@@ -59,6 +60,20 @@ public:
 	 */
 	virtual bool commit(const Guid& guid, const PipelineDependencyHash& hash) = 0;
 
+	/*! Hint that items are about to be requested.
+	 *
+	 * Cache may fetch items in advance, in fewer requests,
+	 * instead of fetching each item when requested.
+	 */
+	virtual void prefetch(const AlignedVector< std::pair< Guid, PipelineDependencyHash > >& items) {}
+
+	/*! Build which issued prefetch has finished.
+	 *
+	 * Cache should stop fetching and release items
+	 * which never got requested.
+	 */
+	virtual void endPrefetch() {}
+
 	/*!
 	 */
 	virtual Ref< IStream > get(const Key& key) = 0;
@@ -10,19 +10,39 @@
 #include "Compress/Lzf/DeflateStreamLzf.h"
 #include "Compress/Lzf/InflateStreamLzf.h"
 #include "Core/Io/BufferedStream.h"
+#include "Core/Io/ChunkMemory.h"
+#include "Core/Io/ChunkMemoryStream.h"
 #include "Core/Io/OutputStream.h"
+#include "Core/Io/StreamCopy.h"
 #include "Core/Misc/SafeDestroy.h"
 #include "Core/Misc/String.h"
 #include "Core/Settings/PropertyBoolean.h"
 #include "Core/Settings/PropertyGroup.h"
 #include "Core/Settings/PropertyInteger.h"
 #include "Core/Settings/PropertyString.h"
+#include "Core/Thread/Acquire.h"
 #include "Core/Thread/JobManager.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
 #include "Editor/Pipeline/Avalanche/AvalanchePipelineCache.h"
 #include "Net/Network.h"
 
 namespace traktor::editor
 {
+	namespace
+	{
+
+const uint32_t c_prefetchBatchSize = 64;
+
+/*! Combine guid and hash to generate 128-bit storage key. */
+Key createKey(const Guid& guid, const PipelineDependencyHash& hash)
+{
+	const Guid gk = guid.permutation(Guid((const uint8_t*)&hash));
+	const uint32_t* kv = (const uint32_t*)(const uint8_t*)gk;
+	return Key(kv[0], kv[1], kv[2], kv[3]);
+}
+
+	}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.editor.AvalanchePipelineCache", AvalanchePipelineCache, IPipelineCache)
 
@@ -36,6 +56,7 @@ bool AvalanchePipelineCache::create(const PropertyGroup* settings)
 
 	m_accessRead = settings->getProperty< bool >(L"Pipeline.AvalancheCache.Read", true);
 	m_accessWrite = settings->getProperty< bool >(L"Pipeline.AvalancheCache.Write", true);
+	m_prefetchBudget = settings->getProperty< int32_t >(L"Pipeline.AvalancheCache.PrefetchBudget", 256) * 1024LL * 1024LL;
 
 	m_client = new avalanche::Client(net::SocketAddressIPv4(host, port));
 	if (!m_client->ping())
@@ -55,6 +76,7 @@ AvalanchePipelineCache::~AvalanchePipelineCache()
 
 void AvalanchePipelineCache::destroy()
 {
+	cancelPrefetch();
 	if (m_statsJob)
 	{
 		m_statsJob->wait();
@@ -68,10 +90,27 @@ Ref< IStream > AvalanchePipelineCache::get(const Guid& guid, const PipelineDepen
 	if (!m_accessRead)
 		return nullptr;
 
-	// Combine guid and hash to generate 128-bit storage key.
-	const Guid gk = guid.permutation(Guid((const uint8_t*)&hash));
-	const uint32_t* kv = (const uint32_t*)(const uint8_t*)gk;
-	const Key key(kv[0], kv[1], kv[2], kv[3]);
+	const Key key = createKey(guid, hash);
+
+	// Use prefetched blob, or known miss, if available.
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_prefetchLock);
+
+		auto it = m_prefetched.find(key);
+		if (it != m_prefetched.end())
+		{
+			Ref< ChunkMemory > memory = it->second;
+			m_prefetched.erase(it);
+			m_hits++;
+			return new compress::InflateStreamLzf(new ChunkMemoryStream(memory, true, false));
+		}
+
+		if (m_prefetchMissing.erase(key))
+		{
+			m_misses++;
+			return nullptr;
+		}
+	}
 
 	Ref< IStream > stream = m_client->get(key);
 	if (!stream)
@@ -89,10 +128,7 @@ Ref< IStream > AvalanchePipelineCache::put(const Guid& guid, const PipelineDepen
 	if (!m_accessWrite)
 		return nullptr;
 
-	// Combine guid and hash to generate 128-bit storage key.
-	const Guid gk = guid.permutation(Guid((const uint8_t*)&hash));
-	const uint32_t* kv = (const uint32_t*)(const uint8_t*)gk;
-	const Key key(kv[0], kv[1], kv[2], kv[3]);
+	const Key key = createKey(guid, hash);
 
 	Ref< IStream > stream = m_client->put(key);
 	if (!stream)
@@ -157,4 +193,91 @@ bool AvalanchePipelineCache::commit(const Guid& guid, const PipelineDependencyHa
 	return true;
 }
 
+void AvalanchePipelineCache::prefetch(const AlignedVector< std::pair< Guid, PipelineDependencyHash > >& items)
+{
+	if (!m_accessRead || items.empty())
+		return;
+
+	cancelPrefetch();
+
+	AlignedVector< Key > keys;
+	keys.reserve(items.size());
+	for (const auto& item : items)
+		keys.push_back(createKey(item.first, item.second));
+
+	// Fetch on a dedicated thread, since transfer is long running it would otherwise
+	// occupy a job worker; builds requesting blobs not yet prefetched use single requests.
+	m_prefetchThread = ThreadManager::getInstance().create([=, this]() {
+		AlignedVector< Key > fetchKeys;
+		int64_t budget = m_prefetchBudget;
+
+		// Stat in batches; client send all keys of a request before reading any reply
+		// thus a too large request would block both client and server on write.
+		for (uint32_t offset = 0; offset < (uint32_t)keys.size() && !m_prefetchThread->stopped(); offset += c_prefetchBatchSize)
+		{
+			const uint32_t count = std::min< uint32_t >((uint32_t)keys.size() - offset, c_prefetchBatchSize);
+			const AlignedVector< Key > batchKeys(keys.begin() + offset, keys.begin() + offset + count);
+
+			AlignedVector< int64_t > blobSizes;
+			if (!m_client->statMany(batchKeys, blobSizes))
+				return;
+
+			T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_prefetchLock);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (blobSizes[i] < 0)
+					m_prefetchMissing.insert(batchKeys[i]);
+				else if (blobSizes[i] <= budget)
+				{
+					fetchKeys.push_back(batchKeys[i]);
+					budget -= blobSizes[i];
+				}
+			}
+		}
+
+		// Fetch in batches, first blobs are available before entire set is fetched.
+		for (uint32_t offset = 0; offset < (uint32_t)fetchKeys.size() && !m_prefetchThread->stopped(); offset += c_prefetchBatchSize)
+		{
+			const uint32_t count = std::min< uint32_t >((uint32_t)fetchKeys.size() - offset, c_prefetchBatchSize);
+			const AlignedVector< Key > batchKeys(fetchKeys.begin() + offset, fetchKeys.begin() + offset + count);
+
+			const bool result = m_client->getMany(batchKeys, [&](uint32_t index, IStream* stream) {
+				if (!stream)
+					return;
+
+				Ref< ChunkMemory > memory = new ChunkMemory();
+				ChunkMemoryStream memoryStream(memory, false, true);
+				if (!StreamCopy(&memoryStream, stream).execute())
+					return;
+
+				T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_prefetchLock);
+				m_prefetched.insert(batchKeys[index], memory);
+			});
+			if (!result)
+				break;
+		}
+	}, L"Avalanche prefetch");
+	if (m_prefetchThread)
+		m_prefetchThread->start();
+}
+
+void AvalanchePipelineCache::endPrefetch()
+{
+	cancelPrefetch();
+}
+
+void AvalanchePipelineCache::cancelPrefetch()
+{
+	if (m_prefetchThread)
+	{
+		m_prefetchThread->stop();
+		ThreadManager::getInstance().destroy(m_prefetchThread);
+		m_prefetchThread = nullptr;
+	}
+
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_prefetchLock);
+	m_prefetched.clear();
+	m_prefetchMissing.clear();
+}
+
 }
@@ -8,7 +8,11 @@
  */
 #pragma once
 
+#include <atomic>
 #include "Avalanche/Dictionary.h"
+#include "Core/Containers/SmallMap.h"
+#include "Core/Containers/SmallSet.h"
+#include "Core/Thread/Semaphore.h"
 #include "Editor/IPipelineCache.h"
 
 // import/export mechanism.
@@ -22,7 +26,9 @@
 namespace traktor
 {
 
+class ChunkMemory;
 class Job;
+class Thread;
 
 }
 
@@ -53,6 +59,10 @@ public:
 
 	virtual bool commit(const Guid& guid, const PipelineDependencyHash& hash) override final;
 
+	virtual void prefetch(const AlignedVector< std::pair< Guid, PipelineDependencyHash > >& items) override final;
+
+	virtual void endPrefetch() override final;
+
 	virtual Ref< IStream > get(const Key& key) override final;
 
 	virtual Ref< IStream > put(const Key& key) override final;
@@ -63,10 +73,19 @@ private:
 	Ref< avalanche::Client > m_client;
 	bool m_accessRead = true;
 	bool m_accessWrite = true;
-	uint32_t m_hits = 0;
-	uint32_t m_misses = 0;
+	std::atomic< uint32_t > m_hits = 0;
+	std::atomic< uint32_t > m_misses = 0;
 	Ref< Job > m_statsJob;
 	avalanche::Dictionary::Stats m_stats;
+
+	// Prefetched blobs, and keys known to be missing, are consumed when requested.
+	Semaphore m_prefetchLock;
+	SmallMap< Key, Ref< ChunkMemory > > m_prefetched;
+	SmallSet< Key > m_prefetchMissing;
+	Thread* m_prefetchThread = nullptr;
+	int64_t m_prefetchBudget = 0;
+
+	void cancelPrefetch();
 };
 
 }
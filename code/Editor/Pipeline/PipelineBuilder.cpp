@@ -16,6 +16,9 @@
 #include "Core/Settings/PropertyGroup.h"
 #include "Core/Settings/PropertyInteger.h"
 #include "Core/System/OS.h"
+#include "Core/Thread/Acquire.h"
+#include "Core/Thread/Event.h"
+#include "Core/Thread/JobQueue.h"
 #include "Core/Thread/Thread.h"
 #include "Core/Thread/ThreadManager.h"
 #include "Core/Timer/Timer.h"
@@ -30,6 +33,7 @@
 #include "Editor/PipelineDependency.h"
 #include "Editor/PipelineDependencySet.h"
 #include "Editor/Pipeline/PipelineBuilder.h"
+#include "Editor/Pipeline/PipelineDependencyGraph.h"
 #include "Editor/Pipeline/PipelineDependsIncremental.h"
 #include "Editor/Pipeline/PipelineDependsParallel.h"
 #include "Editor/Pipeline/PipelineFactory.h"
@@ -116,7 +120,8 @@ PipelineBuilder::PipelineBuilder(
 	IPipelineDb* pipelineDb,
 	IPipelineInstanceCache* instanceCache,
 	IListener* listener,
-	bool verbose
+	bool verbose,
+	int32_t buildThreads
 )
 :	m_pipelineFactory(pipelineFactory)
 ,	m_sourceDatabase(sourceDatabase)
@@ -126,10 +131,10 @@ PipelineBuilder::PipelineBuilder(
 ,	m_instanceCache(instanceCache)
 ,	m_listener(listener)
 ,	m_verbose(verbose)
+,	m_buildThreads(buildThreads)
 ,	m_rebuild(false)
 ,	m_profiler(new PipelineProfiler())
 ,	m_dependencySet(nullptr)
-,	m_adHocDepth(0)
 ,	m_progressEnd(0)
 ,	m_progress(0)
 ,	m_succeeded(0)
@@ -159,8 +164,10 @@ bool PipelineBuilder::build(const PipelineDependencySet* dependencySet, bool reb
 		Ref< const PipelineDependency > dependency;
 		Ref< const Object > buildParams;
 		uint32_t reason;
+		PipelineDependencyHash hash;
 	};
 	AlignedVector< Work > workSet;
+	AlignedVector< int32_t > workIndices(dependencySet->size(), -1);
 	Timer timer;
 
 	const uint32_t dependencyCount = dependencySet->size();
@@ -169,6 +176,11 @@ bool PipelineBuilder::build(const PipelineDependencySet* dependencySet, bool reb
 	if (m_verbose && !rebuild)
 		log::info << L"Analyzing conditions of " << dependencyCount << L" build item(s)..." << Endl;
 
+	// Calculate global hashes of all dependencies in a single pass.
+	const PipelineDependencyGraph dependencyGraph(dependencySet);
+	AlignedVector< PipelineDependencyHash > hashes;
+	dependencyGraph.calculateGlobalHashes(hashes);
+
 	// Determine build reasons.
 	AlignedVector< uint32_t > reasons(dependencyCount, 0);
 	for (uint32_t i = 0; i < dependencyCount; ++i)
@@ -182,19 +194,10 @@ bool PipelineBuilder::build(const PipelineDependencySet* dependencySet, bool reb
 		// Have source asset been modified?
 		if (!rebuild)
 		{
-			uint32_t pipelineHash = 0;
-			uint32_t sourceAssetHash = 0;
-			uint32_t sourceDataHash = 0;
-			uint32_t filesHash = 0;
-
-			calculateGlobalHash(
-				dependencySet,
-				dependency,
-				pipelineHash,
-				sourceAssetHash,
-				sourceDataHash,
-				filesHash
-			);
+			const uint32_t pipelineHash = hashes[i].pipelineHash;
+			const uint32_t sourceAssetHash = hashes[i].sourceAssetHash;
+			const uint32_t sourceDataHash = hashes[i].sourceDataHash;
+			const uint32_t filesHash = hashes[i].filesHash;
 
 			// Get hash entry from database.
 			PipelineDependencyHash previousDependencyHash;
@@ -265,50 +268,37 @@ bool PipelineBuilder::build(const PipelineDependencySet* dependencySet, bool reb
 			reasons[i] |= PbrForced;
 	}
 
+	// Propagate modifications to all dependencies using modified dependencies.
+	dependencyGraph.propagateModified(reasons);
+
 	// Collect work set.
 	for (uint32_t i = 0; i < dependencyCount; ++i)
 	{
-		const PipelineDependency* dependency = dependencySet->get(i);
-		T_ASSERT(dependency);
-
-		SmallSet< uint32_t > visited;
-		visited.insert(i);
-
-		AlignedVector< uint32_t > children;
-		children.insert(children.end(), dependency->children.begin(), dependency->children.end());
-
-		while (!children.empty())
+		if (reasons[i] != 0)
 		{
-			if (visited.find(children.back()) != visited.end())
-			{
-				children.pop_back();
-				continue;
-			}
+			workIndices[i] = (int32_t)workSet.size();
+			workSet.push_back({ dependencySet->get(i), nullptr, reasons[i], hashes[i] });
+		}
+	}
 
-			const PipelineDependency* childDependency = dependencySet->get(children.back());
-			T_ASSERT(childDependency);
+	T_DEBUG(L"Pipeline build; analyzed build reasons in " << formatDuration(timer.getDeltaTime()) << L".");
 
-			if ((childDependency->flags & PdfUse) == 0)
-			{
-				children.pop_back();
+	// Let cache fetch entire work set in advance, in as few requests as possible.
+	if (m_cache)
+	{
+		AlignedVector< std::pair< Guid, PipelineDependencyHash > > prefetchItems;
+		for (const auto& w : workSet)
+		{
+			if (!w.dependency->pipelineType || (w.dependency->flags & PdfBuild) == 0)
 				continue;
-			}
-
-			if ((reasons[children.back()] & PbrSourceModified) != 0)
-				reasons[i] |= PbrDependencyModified;
 
-			visited.insert(children.back());
-
-			children.pop_back();
-			children.insert(children.end(), childDependency->children.begin(), childDependency->children.end());
+			const IPipeline* pipeline = m_pipelineFactory->findPipeline(*w.dependency->pipelineType);
+			if (pipeline && pipeline->shouldCache())
+				prefetchItems.push_back({ w.dependency->outputGuid, w.hash });
 		}
-
-		if (reasons[i] != 0)
-			workSet.push_back({ dependency, nullptr, reasons[i] });
+		m_cache->prefetch(prefetchItems);
 	}
 
-	T_DEBUG(L"Pipeline build; analyzed build reasons in " << formatDuration(timer.getDeltaTime()) << L".");
-
 	if (m_verbose && !workSet.empty())
 		log::info << L"Dispatching " << (int32_t)workSet.size() << L" build(s)..." << Endl;
 
@@ -323,41 +313,228 @@ bool PipelineBuilder::build(const PipelineDependencySet* dependencySet, bool reb
 	m_cacheVoid = 0;	// No hash on source asset will result in a void.
 	m_dependencySet = dependencySet;
 
-	for (const auto& w : workSet)
+	Thread* buildThread = ThreadManager::getInstance().getCurrentThread();
+	const int32_t buildThreads = (m_buildThreads > 0) ? m_buildThreads : (int32_t)OS::getInstance().getCPUCoreCount();
+
+	if (buildThreads <= 1 || workSet.size() <= 1)
 	{
-		if (ThreadManager::getInstance().getCurrentThread()->stopped())
-			break;
-
-		if (m_listener)
-			m_listener->beginBuild(
-				m_progress,
-				m_progressEnd,
-				w.dependency
-			);
+		for (const auto& w : workSet)
+		{
+			if (buildThread->stopped())
+				break;
 
-		const BuildResult result = performBuild(dependencySet, w.dependency, w.buildParams, w.reason);
-		if (result == BuildResult::Succeeded || result == BuildResult::SucceededWithWarnings)
-			m_succeeded++;
-		else
-			m_failed++;
-
-		if (m_listener)
-			m_listener->endBuild(
-				m_progress,
-				m_progressEnd,
-				w.dependency,
-				result
-			);
+			if (m_listener)
+				m_listener->beginBuild(
+					m_progress,
+					m_progressEnd,
+					w.dependency
+				);
+
+			const BuildResult result = performBuild(dependencySet, w.dependency, w.buildParams, w.reason, w.hash);
+			if (result == BuildResult::Succeeded || result == BuildResult::SucceededWithWarnings)
+				m_succeeded++;
+			else
+				m_failed++;
 
-		m_progress++;
+			if (m_listener)
+				m_listener->endBuild(
+					m_progress,
+					m_progressEnd,
+					w.dependency,
+					result
+				);
+
+			m_progress++;
+		}
 	}
+	else
+	{
+		const uint32_t workCount = (uint32_t)workSet.size();
+
+		// Each work waits for it's children in the work set to be built first;
+		// thus pipelines can safely access output of their dependencies.
+		AlignedVector< int32_t > pending(workCount, 0);
+		AlignedVector< AlignedVector< uint32_t > > parents(workCount);
+		for (uint32_t i = 0; i < workCount; ++i)
+		{
+			SmallSet< uint32_t > children;
+			for (auto child : workSet[i].dependency->children)
+			{
+				const int32_t childWorkIndex = workIndices[child];
+				if (childWorkIndex >= 0 && childWorkIndex != (int32_t)i && children.insert((uint32_t)childWorkIndex))
+				{
+					parents[childWorkIndex].push_back(i);
+					pending[i]++;
+				}
+			}
+		}
+
+		std::list< uint32_t > ready;
+		for (uint32_t i = 0; i < workCount; ++i)
+		{
+			if (pending[i] == 0)
+				ready.push_back(i);
+		}
+
+		AlignedVector< bool > dispatched(workCount, false);
+		AlignedVector< std::pair< uint32_t, BuildResult > > finished;
+		Semaphore finishedLock;
+		Event finishedEvent;
+		int32_t running = 0;
+		uint32_t dispatchedCount = 0;
+		uint32_t cycleSearch = 0;
+
+		// Release parents of finished work, called from build thread only.
+		auto finish = [&](uint32_t workIndex, BuildResult result) {
+			const Work& w = workSet[workIndex];
+
+			if (result == BuildResult::Succeeded || result == BuildResult::SucceededWithWarnings)
+				m_succeeded++;
+			else
+				m_failed++;
+
+			if (m_listener)
+				m_listener->endBuild(
+					m_progress,
+					m_progressEnd,
+					w.dependency,
+					result
+				);
+
+			m_progress++;
+
+			for (auto parent : parents[workIndex])
+			{
+				if (--pending[parent] == 0 && !dispatched[parent])
+					ready.push_back(parent);
+			}
+		};
+
+		// Builds run on a dedicated queue; jobs of the global job manager are forked by pipelines
+		// and threads helping to finish those must not pick up, and nest, another build.
+		Ref< JobQueue > buildQueue = new JobQueue();
+		if (!buildQueue->create(buildThreads, Thread::Normal))
+		{
+			log::error << L"Unable to create build queue." << Endl;
+			buildQueue->destroy();
+			if (m_cache)
+				m_cache->endPrefetch();
+			return false;
+		}
+
+		while (!buildThread->stopped())
+		{
+			// Dispatch as many ready builds as permitted.
+			for (auto it = ready.begin(); it != ready.end() && running < buildThreads && !buildThread->stopped(); )
+			{
+				const uint32_t workIndex = *it;
+				const Work& w = workSet[workIndex];
+
+				if (dispatched[workIndex])
+				{
+					it = ready.erase(it);
+					continue;
+				}
+
+				// Pipelines which are not thread safe are built exclusively on the build thread;
+				// skip until no build is running but keep dispatching other ready builds.
+				Ref< IPipeline > pipeline = w.dependency->pipelineType ? m_pipelineFactory->findPipeline(*w.dependency->pipelineType) : nullptr;
+				const bool exclusive = (pipeline != nullptr && !pipeline->isThreadSafe());
+				if (exclusive && running > 0)
+				{
+					++it;
+					continue;
+				}
+
+				it = ready.erase(it);
+				dispatched[workIndex] = true;
+				dispatchedCount++;
+
+				if (m_listener)
+					m_listener->beginBuild(
+						m_progress,
+						m_progressEnd,
+						w.dependency
+					);
+
+				if (exclusive)
+				{
+					finish(workIndex, performBuild(dependencySet, w.dependency, w.buildParams, w.reason, w.hash));
+					continue;
+				}
+
+				running++;
+				buildQueue->add([=, this, &workSet, &finished, &finishedLock, &finishedEvent]() {
+					const Work& work = workSet[workIndex];
+
+					// Restore previous context, in case build is ever nested on same thread.
+					BuildContext context;
+					void* previousContext = m_buildContext.get();
+					m_buildContext.set(&context);
+					const BuildResult result = performBuild(dependencySet, work.dependency, work.buildParams, work.reason, work.hash);
+					m_buildContext.set(previousContext);
+
+					T_ANONYMOUS_VAR(Acquire< Semaphore >)(finishedLock);
+					finished.push_back({ workIndex, result });
+					finishedEvent.pulse();
+				});
+			}
+
+			if (running == 0 && ready.empty())
+			{
+				if (dispatchedCount >= workCount)
+					break;
+
+				// Nothing ready and nothing running, remaining work must be in a dependency cycle;
+				// break cycle by releasing first remaining work.
+				while (dispatched[cycleSearch])
+					++cycleSearch;
+				ready.push_back(cycleSearch);
+				continue;
+			}
+
+			if (running == 0)
+				continue;
+
+			// Wait until any build has finished.
+			if (!finishedEvent.wait(100))
+				continue;
+
+			AlignedVector< std::pair< uint32_t, BuildResult > > finishedNow;
+			{
+				T_ANONYMOUS_VAR(Acquire< Semaphore >)(finishedLock);
+				finishedNow.swap(finished);
+			}
+			for (const auto& f : finishedNow)
+			{
+				running--;
+				finish(f.first, f.second);
+			}
+		}
+
+		// Wait for all dispatched builds, even if aborted, as they reference local state.
+		while (running > 0)
+		{
+			finishedEvent.wait(100);
+
+			T_ANONYMOUS_VAR(Acquire< Semaphore >)(finishedLock);
+			running -= (int32_t)finished.size();
+			finished.resize(0);
+		}
+
+		buildQueue->destroy();
+	}
+
+	// Release prefetched items which no build requested.
+	if (m_cache)
+		m_cache->endPrefetch();
 
 	// Log cache performance.
 	if (m_cache && m_verbose)
 		log::info << L"Pipeline cache; " << m_cacheHit << L" hit(s), " << m_cacheMiss << L" miss(es), " << m_cacheVoid << L" uncachable(s)." << Endl;
 
 	// Log results.
-	if (!ThreadManager::getInstance().getCurrentThread()->stopped())
+	if (!buildThread->stopped())
 	{
 		if (m_verbose)
 		{
@@ -401,17 +578,20 @@ Ref< ISerializable > PipelineBuilder::buildProduct(const db::Instance* sourceIns
 	if (const ISerializable* sbp = dynamic_type_cast< const ISerializable* >(buildParams))
 		sourceHash += DeepHash(sbp).get();
 
-	auto it = m_builtCache.find(sourceHash);
-	if (it != m_builtCache.end())
 	{
-		built_cache_list_t& bcl = it->second;
-		T_ASSERT(!bcl.empty());
-
-		// Return same instance as before if pointer and hash match.
-		for (built_cache_list_t::const_iterator j = bcl.begin(); j != bcl.end(); ++j)
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		auto it = m_builtCache.find(sourceHash);
+		if (it != m_builtCache.end())
 		{
-			if (j->sourceAsset == sourceAsset)
-				return j->product;
+			built_cache_list_t& bcl = it->second;
+			T_ASSERT(!bcl.empty());
+
+			// Return same instance as before if pointer and hash match.
+			for (built_cache_list_t::const_iterator j = bcl.begin(); j != bcl.end(); ++j)
+			{
+				if (j->sourceAsset == sourceAsset)
+					return j->product;
+			}
 		}
 	}
 
@@ -421,13 +601,20 @@ Ref< ISerializable > PipelineBuilder::buildProduct(const db::Instance* sourceIns
 	if (!product)
 		return nullptr;
 
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	m_builtCache[sourceHash].push_back({ sourceAsset, product });
 	return product;
 }
 
 bool PipelineBuilder::buildAdHocOutput(const Guid& outputGuid)
 {
-	m_adHocBuilds.insert(outputGuid);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	AdHocOutput& output = m_adHocBuilds[outputGuid];
+	if (!output.owner)
+	{
+		output.finished = true;
+		output.succeeded = true;
+	}
 	return true;
 }
 
@@ -441,12 +628,17 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 {
 	PipelineDependencySet dependencySet;
 
-	// Exclude filtering; already added dependencies and built ad-hocs should be excluded from further ad-hoc builds.
+	BuildContext* context = getBuildContext();
+
+	// Exclude filtering; already added dependencies and built ad-hocs should be excluded from further ad-hoc builds,
+	// ad-hocs being built by other builds are included so we can wait for them.
 	auto dependencyFilter = [&](const Guid& id) -> bool {
 		if (m_dependencySet->get(id) != PipelineDependencySet::DiInvalid)
 			return false;
 
-		if (m_adHocBuilds.find(id) != m_adHocBuilds.end())
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		const auto it = m_adHocBuilds.find(id);
+		if (it != m_adHocBuilds.end() && (it->second.finished || it->second.owner == context))
 			return false;
 
 		return true;
@@ -487,8 +679,14 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 		if ((dependency->flags & PdfBuild) == 0)
 			continue;
 
-		if (m_adHocBuilds.find(dependency->outputGuid) != m_adHocBuilds.end())
+		// Claim output before building; if another build has claimed same output then
+		// we need to wait until it's built as our output might depend on it.
+		AdHocOutput* adHocOutput = nullptr;
+		if (!claimAdHocOutput(dependency->outputGuid, adHocOutput))
+		{
+			result &= waitAdHocOutput(adHocOutput);
 			continue;
+		}
 
 		// Calculate hash entry.
 		PipelineDependencyHash dependencyHash;
@@ -518,9 +716,9 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 		// Build output instances; keep an array of written instances as we
 		// need them to update the cache for this specific build.
 		RefArray< db::Instance > previousBuiltInstances;
-		m_builtInstances.swap(previousBuiltInstances);
+		context->builtInstances.swap(previousBuiltInstances);
 		AlignedVector< CacheKey > previousBuiltAdHocKeys;
-		m_builtAdHocKeys.swap(previousBuiltAdHocKeys);
+		context->builtAdHocKeys.swap(previousBuiltAdHocKeys);
 
 		// Get output instances from memory cache.
 		if (m_cache && pipeline->shouldCache() && cachePermitted)
@@ -528,11 +726,11 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 			if (getInstancesFromCache(
 				m_cache,
 				{ dependency->outputGuid, dependencyHash },
-				&m_builtInstances,
-				&m_builtAdHocKeys
+				&context->builtInstances,
+				&context->builtAdHocKeys
 			))
 			{
-				for (const auto& child : m_builtAdHocKeys)
+				for (const auto& child : context->builtAdHocKeys)
 				{
 					if (!getInstancesFromCache(
 						m_cache,
@@ -540,18 +738,22 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 						nullptr,
 						nullptr
 					))
+					{
+						context->builtInstances.swap(previousBuiltInstances);
+						context->builtAdHocKeys.swap(previousBuiltAdHocKeys);
+						finishAdHocOutput(adHocOutput, false);
 						return false;
+					}
 				}
 
 				m_pipelineDb->setDependency(dependency->outputGuid, dependencyHash);
+				finishAdHocOutput(adHocOutput, true);
 
 				previousBuiltAdHocKeys.push_back({ dependency->outputGuid, dependencyHash });
-				previousBuiltAdHocKeys.insert(previousBuiltAdHocKeys.end(), m_builtAdHocKeys.begin(), m_builtAdHocKeys.end());
+				previousBuiltAdHocKeys.insert(previousBuiltAdHocKeys.end(), context->builtAdHocKeys.begin(), context->builtAdHocKeys.end());
 
-				m_builtInstances.swap(previousBuiltInstances);
-				m_builtAdHocKeys.swap(previousBuiltAdHocKeys);
-
-				m_adHocBuilds.insert(dependency->outputGuid);
+				context->builtInstances.swap(previousBuiltInstances);
+				context->builtAdHocKeys.swap(previousBuiltAdHocKeys);
 
 				m_cacheHit++;
 				continue;
@@ -563,12 +765,12 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 			m_cacheVoid++;
 
 		if (m_verbose)
-			log::info << L"Building \"" << dependency->outputPath << L"\" (ad-hoc " << m_adHocDepth << L")..." << Endl;
+			log::info << L"Building \"" << dependency->outputPath << L"\" (ad-hoc " << context->adHocDepth << L")..." << Endl;
 		log::info << IncreaseIndent;
 
-		m_adHocDepth++;
+		context->adHocDepth++;
 		m_profiler->begin(*dependency->pipelineType);
-		result &= pipeline->buildOutput(
+		const bool built = pipeline->buildOutput(
 			this,
 			&dependencySet,
 			dependency,
@@ -580,19 +782,20 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 			PbrSourceModified
 		);
 		m_profiler->end();
-		m_adHocDepth--;
+		context->adHocDepth--;
+		result &= built;
 
 		if (result && m_cache && pipeline->shouldCache() && cachePermitted)
 		{
 			putInstancesInCache(
 				m_cache,
 				{ dependency->outputGuid, dependencyHash },
-				m_builtInstances,
-				m_builtAdHocKeys
+				context->builtInstances,
+				context->builtAdHocKeys
 			);
 			
 			previousBuiltAdHocKeys.push_back({ dependency->outputGuid, dependencyHash });
-			previousBuiltAdHocKeys.insert(previousBuiltAdHocKeys.end(), m_builtAdHocKeys.begin(), m_builtAdHocKeys.end());
+			previousBuiltAdHocKeys.insert(previousBuiltAdHocKeys.end(), context->builtAdHocKeys.begin(), context->builtAdHocKeys.end());
 		}
 
 		// Store dependency hash in database so getInstancesFromCache only touches
@@ -600,12 +803,12 @@ bool PipelineBuilder::buildAdHocOutput(const ISerializable* sourceAsset, const s
 		if (result)
 			m_pipelineDb->setDependency(dependency->outputGuid, dependencyHash);
 
+		finishAdHocOutput(adHocOutput, built);
+
 		// Restore previous set but also insert built instances from synthesized build;
 		// when caching is enabled then synthesized built instances should be included in parent build as well.
-		m_builtInstances.swap(previousBuiltInstances);
-		m_builtAdHocKeys.swap(previousBuiltAdHocKeys);
-
-		m_adHocBuilds.insert(dependency->outputGuid);
+		context->builtInstances.swap(previousBuiltInstances);
+		context->builtAdHocKeys.swap(previousBuiltAdHocKeys);
 
 		log::info << DecreaseIndent;
 		if (m_verbose)
@@ -651,6 +854,7 @@ Ref< ISerializable > PipelineBuilder::getBuildProduct(const ISerializable* sourc
 
 	const uint32_t sourceHash = DeepHash(sourceAsset).get();
 
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	const auto it = m_builtCache.find(sourceHash);
 	if (it == m_builtCache.end())
 		return nullptr;
@@ -698,7 +902,7 @@ Ref< db::Instance > PipelineBuilder::createOutputInstance(const std::wstring& in
 	);
 	if (instance)
 	{
-		m_builtInstances.push_back(instance);
+		getBuildContext()->builtInstances.push_back(instance);
 		return instance;
 	}
 	else
@@ -740,27 +944,74 @@ PipelineProfiler* PipelineBuilder::getProfiler() const
 	return m_profiler;
 }
 
+PipelineBuilder::BuildContext* PipelineBuilder::getBuildContext()
+{
+	BuildContext* context = (BuildContext*)m_buildContext.get();
+	return context != nullptr ? context : &m_serialContext;
+}
+
+bool PipelineBuilder::claimAdHocOutput(const Guid& outputGuid, AdHocOutput*& outOutput)
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	const auto [it, inserted] = m_adHocBuilds.try_emplace(outputGuid);
+	if (inserted)
+		it->second.owner = getBuildContext();
+	outOutput = &it->second;
+	return inserted;
+}
+
+bool PipelineBuilder::waitAdHocOutput(const AdHocOutput* output)
+{
+	BuildContext* context = getBuildContext();
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+
+		// Do not wait if output is being built by this build, or by a build which
+		// is waiting for this build; cyclic ad-hoc outputs would otherwise dead-lock.
+		for (const AdHocOutput* o = output; o != nullptr && !o->finished; o = o->owner->waitingOn)
+		{
+			if (o->owner == context)
+				return true;
+		}
+
+		if (output->finished)
+			return output->succeeded;
+
+		context->waitingOn = output;
+	}
+
+	for (;;)
+	{
+		output->finishedEvent.wait(100);
+
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		if (output->finished)
+		{
+			context->waitingOn = nullptr;
+			return output->succeeded;
+		}
+	}
+}
+
+void PipelineBuilder::finishAdHocOutput(AdHocOutput* output, bool succeeded)
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	output->finished = true;
+	output->succeeded = succeeded;
+	output->finishedEvent.broadcast();
+}
+
 IPipelineBuilder::BuildResult PipelineBuilder::performBuild(
 	const PipelineDependencySet* dependencySet,
 	const PipelineDependency* dependency,
 	const Object* buildParams,
-	uint32_t reason
+	uint32_t reason,
+	const PipelineDependencyHash& currentDependencyHash
 )
 {
 	if (!dependency->pipelineType)
 		return BuildResult::Failed;
 
-	// Calculate recursive hash entry.
-	PipelineDependencyHash currentDependencyHash;
-	calculateGlobalHash(
-		dependencySet,
-		dependency,
-		currentDependencyHash.pipelineHash,
-		currentDependencyHash.sourceAssetHash,
-		currentDependencyHash.sourceDataHash,
-		currentDependencyHash.filesHash
-	);
-
 	// Skip no-build asset; just update hash.
 	if ((dependency->flags & PdfBuild) == 0)
 	{
@@ -776,8 +1027,9 @@ IPipelineBuilder::BuildResult PipelineBuilder::performBuild(
 	Ref< IPipeline > pipeline = m_pipelineFactory->findPipeline(*dependency->pipelineType);
 	T_ASSERT(pipeline);
 
-	m_builtInstances.resize(0);
-	m_builtAdHocKeys.resize(0);
+	BuildContext* context = getBuildContext();
+	context->builtInstances.resize(0);
+	context->builtAdHocKeys.resize(0);
 
 	// Get output instances from cache.
 	if (m_cache && pipeline->shouldCache())
@@ -785,11 +1037,11 @@ IPipelineBuilder::BuildResult PipelineBuilder::performBuild(
 		if (getInstancesFromCache(
 			m_cache,
 			{ dependency->outputGuid, currentDependencyHash },
-			&m_builtInstances,
-			&m_builtAdHocKeys
+			&context->builtInstances,
+			&context->builtAdHocKeys
 		))
 		{
-			for (const auto& child : m_builtAdHocKeys)
+			for (const auto& child : context->builtAdHocKeys)
 			{
 				if (!getInstancesFromCache(
 					m_cache,
@@ -854,8 +1106,8 @@ IPipelineBuilder::BuildResult PipelineBuilder::performBuild(
 		putInstancesInCache(
 			m_cache,
 			{ dependency->outputGuid, currentDependencyHash },
-			m_builtInstances,
-			m_builtAdHocKeys
+			context->builtInstances,
+			context->builtAdHocKeys
 		);
 	}
 
@@ -872,8 +1124,8 @@ IPipelineBuilder::BuildResult PipelineBuilder::performBuild(
 			log::info << L"Build \"" << dependency->outputPath << L"\" failed (" << type_name(pipeline) << L")." << Endl;
 	}
 
-	m_builtInstances.resize(0);
-	m_builtAdHocKeys.resize(0);
+	context->builtInstances.resize(0);
+	context->builtAdHocKeys.resize(0);
 
 	if (result)
 		return (warningTarget.getCount() + errorTarget.getCount()) > 0 ? BuildResult::SucceededWithWarnings : BuildResult::Succeeded;
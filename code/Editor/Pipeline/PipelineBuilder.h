@@ -8,10 +8,13 @@
  */
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <map>
-#include <set>
 #include "Core/Io/Path.h"
+#include "Core/Thread/Event.h"
+#include "Core/Thread/Semaphore.h"
+#include "Core/Thread/ThreadLocal.h"
 #include "Editor/IPipelineBuilder.h"
 #include "Editor/PipelineTypes.h"
 
@@ -62,7 +65,8 @@ public:
 		IPipelineDb* db,
 		IPipelineInstanceCache* instanceCache,
 		IListener* listener,
-		bool verbose
+		bool verbose,
+		int32_t buildThreads
 	);
 
 	virtual bool build(const PipelineDependencySet* dependencySet, bool rebuild) override final;
@@ -106,6 +110,26 @@ private:
 
 	typedef std::list< BuiltCacheEntry > built_cache_list_t;
 
+	struct AdHocOutput;
+
+	/*! Per build state, each concurrent build has it's own context. */
+	struct BuildContext
+	{
+		RefArray< db::Instance > builtInstances;
+		AlignedVector< CacheKey > builtAdHocKeys;
+		int32_t adHocDepth = 0;
+		const AdHocOutput* waitingOn = nullptr;
+	};
+
+	/*! Ad-hoc output claimed by a build; other builds referencing same output wait until it's finished. */
+	struct AdHocOutput
+	{
+		const BuildContext* owner = nullptr;
+		mutable Event finishedEvent;
+		bool finished = false;
+		bool succeeded = false;
+	};
+
 	Ref< PipelineFactory > m_pipelineFactory;
 	Ref< db::Database > m_sourceDatabase;
 	Ref< db::Database > m_outputDatabase;
@@ -115,26 +139,43 @@ private:
 	Ref< DataAccessCache > m_dataAccessCache;
 	IListener* m_listener;
 	bool m_verbose;
+	int32_t m_buildThreads;
 	bool m_rebuild;
 	Ref< PipelineProfiler > m_profiler;
 	const PipelineDependencySet* m_dependencySet;
-	std::map< Guid, Ref< ISerializable > > m_readCache;
+	Semaphore m_lock;
 	std::map< uint32_t, built_cache_list_t > m_builtCache;
-	std::set< Guid > m_adHocBuilds;
-	RefArray< db::Instance > m_builtInstances;
-	AlignedVector< CacheKey > m_builtAdHocKeys;
-	int32_t m_adHocDepth;
+	std::map< Guid, AdHocOutput > m_adHocBuilds;
+	BuildContext m_serialContext;
+	ThreadLocal m_buildContext;
 	int32_t m_progressEnd;
 	int32_t m_progress;
-	int32_t m_succeeded;
-	int32_t m_succeededBuilt;
-	int32_t m_failed;
-	int32_t m_cacheHit;
-	int32_t m_cacheMiss;
-	int32_t m_cacheVoid;
+	std::atomic< int32_t > m_succeeded;
+	std::atomic< int32_t > m_succeededBuilt;
+	std::atomic< int32_t > m_failed;
+	std::atomic< int32_t > m_cacheHit;
+	std::atomic< int32_t > m_cacheMiss;
+	std::atomic< int32_t > m_cacheVoid;
+
+	/*! Get build context of calling thread. */
+	BuildContext* getBuildContext();
+
+	/*! Claim ad-hoc output.
+	 *
+	 * \param outputGuid Output guid.
+	 * \param outOutput Claimed output, or output already claimed by another build.
+	 * \return True if output was claimed by calling build.
+	 */
+	bool claimAdHocOutput(const Guid& outputGuid, AdHocOutput*& outOutput);
+
+	/*! Wait until ad-hoc output claimed by another build has finished; return false if that build failed. */
+	bool waitAdHocOutput(const AdHocOutput* output);
+
+	/*! Release builds waiting for claimed ad-hoc output. */
+	void finishAdHocOutput(AdHocOutput* output, bool succeeded);
 
 	/*! Perform build. */
-	BuildResult performBuild(const PipelineDependencySet* dependencySet, const PipelineDependency* dependency, const Object* buildParams, uint32_t reason);
+	BuildResult performBuild(const PipelineDependencySet* dependencySet, const PipelineDependency* dependency, const Object* buildParams, uint32_t reason, const PipelineDependencyHash& currentDependencyHash);
 
 	/*! Isolate instance in cache. */
 	bool putInstancesInCache(
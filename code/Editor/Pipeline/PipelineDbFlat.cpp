@@ -6,15 +6,21 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <algorithm>
+#include <cstring>
 #include "Core/Io/FileSystem.h"
 #include "Core/Io/BufferedStream.h"
+#include "Core/Io/IMappedFile.h"
 #include "Core/Log/Log.h"
 #include "Core/Misc/Split.h"
 #include "Core/Misc/String.h"
+#include "Core/Misc/TString.h"
 #include "Core/Serialization/BinarySerializer.h"
 #include "Core/Serialization/MemberComposite.h"
 #include "Core/Serialization/MemberSmallMap.h"
 #include "Core/Thread/Acquire.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
 #include "Editor/Pipeline/PipelineDbFlat.h"
 
 namespace traktor::editor
@@ -22,8 +28,69 @@ namespace traktor::editor
 	namespace
 	{
 
-const uint32_t c_version = 3;
-const uint32_t c_flushAfterChanges = 100;	//!< Flush pipeline after N changes.
+const uint32_t c_magic = 0x42445054;			//!< "TPDB"
+const uint32_t c_journalMagic = 0x4a445054;		//!< "TPDJ"
+const uint32_t c_version = 4;
+const uint32_t c_legacyVersion = 3;				//!< Serialized database, converted on open.
+const uint32_t c_flushAfterChanges = 100;		//!< Flush journal after N changes.
+const uint32_t c_compactAfterRecords = 16384;	//!< Fold journal into database after N records, or more if database is larger.
+const uint32_t c_dependencyBuckets = 65536;
+const uint32_t c_fileBuckets = 16384;
+
+const uint8_t c_recordDependency = 1;
+const uint8_t c_recordFile = 2;
+
+struct Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t dependencyCount;
+	uint32_t fileCount;
+	uint32_t stringsSize;
+	uint32_t reserved;
+};
+
+struct DependencyRecord
+{
+	uint8_t guid[16];
+	PipelineDependencyHash hash;
+};
+
+struct FileRecord
+{
+	uint32_t pathHash;
+	uint32_t pathOffset;
+	uint32_t pathLength;
+	uint32_t hash;
+	uint64_t size;
+	uint64_t lastWriteTime;
+};
+
+static_assert(sizeof(Header) == 24, "Invalid header size");
+static_assert(sizeof(DependencyRecord) == 32, "Invalid dependency record size");
+static_assert(sizeof(FileRecord) == 32, "Invalid file record size");
+
+/*! FNV-1a hash. */
+uint32_t hashBytes(const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	uint32_t h = 2166136261U;
+	for (size_t i = 0; i < size; ++i)
+		h = (h ^ p[i]) * 16777619U;
+	return h;
+}
+
+int32_t compareFile(uint32_t lhHash, const std::string_view& lhKey, uint32_t rhHash, const std::string_view& rhKey)
+{
+	if (lhHash != rhHash)
+		return lhHash < rhHash ? -1 : 1;
+	return lhKey.compare(rhKey);
+}
+
+void appendBytes(AlignedVector< uint8_t >& out, const void* data, size_t size)
+{
+	out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
 
 class MemberPipelineDependencyHash : public MemberComplex
 {
@@ -68,8 +135,126 @@ private:
 
 	}
 
+/*! Immutable mapped records with changes on top.
+ *
+ * Changes are pushed, never removed, onto lock-free bucket
+ * lists; newest change of a record is thus found first.
+ */
+struct PipelineDbFlat::Snapshot
+{
+	struct DependencyNode
+	{
+		Guid guid;
+		PipelineDependencyHash hash;
+		uint32_t sequence;
+		DependencyNode* next;
+	};
+
+	struct FileNode
+	{
+		std::string key;
+		uint32_t keyHash;
+		PipelineFileHash file;
+		uint32_t sequence;
+		FileNode* next;
+	};
+
+	Ref< IMappedFile > mappedFile;
+	const DependencyRecord* dependencies = nullptr;
+	uint32_t dependencyCount = 0;
+	const FileRecord* files = nullptr;
+	uint32_t fileCount = 0;
+	const char* strings = nullptr;
+	std::atomic< DependencyNode* > dependencyBuckets[c_dependencyBuckets] = {};
+	std::atomic< FileNode* > fileBuckets[c_fileBuckets] = {};
+
+	~Snapshot()
+	{
+		for (auto& bucket : dependencyBuckets)
+		{
+			for (DependencyNode* node = bucket.load(); node != nullptr; )
+			{
+				DependencyNode* next = node->next;
+				delete node;
+				node = next;
+			}
+		}
+		for (auto& bucket : fileBuckets)
+		{
+			for (FileNode* node = bucket.load(); node != nullptr; )
+			{
+				FileNode* next = node->next;
+				delete node;
+				node = next;
+			}
+		}
+	}
+
+	bool findDependency(const Guid& guid, PipelineDependencyHash& outHash) const
+	{
+		const uint8_t* key = (const uint8_t*)guid;
+
+		for (const DependencyNode* node = dependencyBuckets[hashBytes(key, 16) & (c_dependencyBuckets - 1)].load(std::memory_order_acquire); node != nullptr; node = node->next)
+		{
+			if (node->guid == guid)
+			{
+				outHash = node->hash;
+				return true;
+			}
+		}
+
+		const DependencyRecord* end = dependencies + dependencyCount;
+		const DependencyRecord* it = std::lower_bound(dependencies, end, key, [](const DependencyRecord& record, const uint8_t* key) {
+			return std::memcmp(record.guid, key, 16) < 0;
+		});
+		if (it == end || std::memcmp(it->guid, key, 16) != 0)
+			return false;
+
+		outHash = it->hash;
+		return true;
+	}
+
+	bool findFile(const std::string& key, uint32_t keyHash, PipelineFileHash& outFile) const
+	{
+		for (const FileNode* node = fileBuckets[keyHash & (c_fileBuckets - 1)].load(std::memory_order_acquire); node != nullptr; node = node->next)
+		{
+			if (node->keyHash == keyHash && node->key == key)
+			{
+				outFile = node->file;
+				return true;
+			}
+		}
+
+		const FileRecord* end = files + fileCount;
+		const FileRecord* it = std::lower_bound(files, end, keyHash, [](const FileRecord& record, uint32_t keyHash) {
+			return record.pathHash < keyHash;
+		});
+		for (; it != end && it->pathHash == keyHash; ++it)
+		{
+			if (getKey(*it) == key)
+			{
+				outFile.size = it->size;
+				outFile.lastWriteTime = DateTime(it->lastWriteTime);
+				outFile.hash = it->hash;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::string_view getKey(const FileRecord& record) const
+	{
+		return std::string_view(strings + record.pathOffset, record.pathLength);
+	}
+};
+
 T_IMPLEMENT_RTTI_CLASS(L"traktor.editor.PipelineDbFlat", PipelineDbFlat, IPipelineDb)
 
+PipelineDbFlat::~PipelineDbFlat()
+{
+	close();
+}
+
 bool PipelineDbFlat::open(const std::wstring& connectionString)
 {
 	std::vector< std::wstring > pairs;
@@ -93,60 +278,111 @@ bool PipelineDbFlat::open(const std::wstring& connectionString)
 		cs[trim(pair.substr(0, p))] = pair.substr(p + 1);
 	}
 
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+
 	m_file = cs[L"fileName"];
+	m_sequence = 0;
+	m_journalRecords = 0;
 
 	// If flat database file doesn't exist we assume this is the first run; ie. don't fail.
-	if (!FileSystem::getInstance().exist(m_file))
+	bool converted = false;
+	if (FileSystem::getInstance().exist(m_file))
 	{
-		// But ensure full path is created first.
-		return FileSystem::getInstance().makeAllDirectories(Path(m_file).getPathOnly());
+		Snapshot* snapshot = mapSnapshot();
+		if (!snapshot)
+		{
+			// Not a mapped database; convert from previous serialized format.
+			snapshot = new Snapshot();
+			m_snapshot = snapshot;
+			if (!readLegacy())
+				log::warning << L"Pipeline database version mismatch; database purged and rebuild is required." << Endl;
+			converted = true;
+		}
+		else
+			m_snapshot = snapshot;
 	}
-
-	Ref< IStream > f = FileSystem::getInstance().open(m_file, File::FmRead);
-	if (!f)
+	else
 	{
-		log::error << L"Unable to open pipeline db; failed to open file." << Endl;
-		return false;
+		// But ensure full path is created first.
+		if (!FileSystem::getInstance().makeAllDirectories(Path(m_file).getPathOnly()))
+			return false;
+		m_snapshot = new Snapshot();
 	}
 
-	BinarySerializer s(f);
-
-	uint32_t version = 0;
-	s >> Member< uint32_t >(L"version", version);
-
-	if (version == c_version)
-	{
-		s >> MemberSmallMap<
-			Guid,
-			PipelineDependencyHash,
-			Member< Guid >,
-			MemberPipelineDependencyHash
-		>(L"dependencies", m_dependencies);
-
-		s >> MemberSmallMap<
-			std::wstring,
-			PipelineFileHash,
-			Member< std::wstring >,
-			MemberPipelineFileHash
-		>(L"files", m_files);
-	}
-	else
-		log::warning << L"Pipeline database version mismatch; database purged and rebuild is required." << Endl;
+	// Apply changes not yet folded into database, such as when previous session crashed.
+	replayJournal();
 
-	f->close();
-	f = nullptr;
+	if ((converted || m_journalRecords > 0) && compact())
+		return true;
 
-	return true;
+	return createJournal();
 }
 
 void PipelineDbFlat::close()
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+
 	if (m_transaction)
 		endTransaction();
+
+	Snapshot* snapshot = m_snapshot.exchange(nullptr);
+	if (!snapshot)
+		return;
+
+	waitReaders();
+
+	// Fold journal into database so next open only need to map database.
+	if (m_journalRecords > 0)
+	{
+		AlignedVector< std::pair< Guid, PipelineDependencyHash > > dependencies;
+		AlignedVector< std::pair< std::string, PipelineFileHash > > files;
+		merge(snapshot, dependencies, files);
+
+		// Release all mappings first, some platforms cannot replace a mapped file.
+		delete snapshot;
+		for (auto retired : m_retired)
+			delete retired;
+		m_retired.clear();
+
+		if (writeDatabase(dependencies, files))
+		{
+			if (replaceDatabase())
+			{
+				m_journal->close();
+				m_journal = nullptr;
+				FileSystem::getInstance().remove(getJournalFileName());
+			}
+			else
+			{
+				log::warning << L"Unable to write pipeline db; failed to replace database, journal kept." << Endl;
+				FileSystem::getInstance().remove(m_file + L"~");
+			}
+		}
+	}
+	else
+	{
+		delete snapshot;
+		for (auto retired : m_retired)
+			delete retired;
+		m_retired.clear();
+	}
+
+	if (m_journal)
+	{
+		m_journal->close();
+		m_journal = nullptr;
+	}
+
+	m_journalRecords = 0;
+	m_compactFailed = false;
+	m_inspectDependencies.clear();
+	m_inspectFiles.clear();
+	m_inspectSequence = ~0U;
 }
 
 void PipelineDbFlat::beginTransaction()
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	T_FATAL_ASSERT(!m_transaction);
 	T_FATAL_ASSERT(m_changes == 0);
 	m_transaction = true;
@@ -154,129 +390,634 @@ void PipelineDbFlat::beginTransaction()
 
 void PipelineDbFlat::endTransaction()
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	T_FATAL_ASSERT(m_transaction);
-	if (m_changes > 0)
-	{
-		Ref< IStream > f = FileSystem::getInstance().open(m_file, File::FmWrite);
-		if (f)
-		{
-			BufferedStream bs(f);
-			BinarySerializer s(&bs);
-
-			uint32_t version = c_version;
-			s >> Member< uint32_t >(L"version", version);
-
-			s >> MemberSmallMap<
-				Guid,
-				PipelineDependencyHash,
-				Member< Guid >,
-				MemberPipelineDependencyHash
-			>(L"dependencies", m_dependencies);
-
-			s >> MemberSmallMap<
-				std::wstring,
-				PipelineFileHash,
-				Member< std::wstring >,
-				MemberPipelineFileHash
-			>(L"files", m_files);
-
-			bs.close();
-			f = nullptr;
-
-			m_changes = 0;
-		}
-		else
-			log::error << L"Unable to flush pipeline db; failed to write latest changes." << Endl;
-	}
+	flushJournal();
 	m_transaction = false;
 }
 
 void PipelineDbFlat::setDependency(const Guid& guid, const PipelineDependencyHash& hash)
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireWriter)(m_lock);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	T_FATAL_ASSERT(m_transaction);
-	m_dependencies[guid] = hash;
-	if (++m_changes >= c_flushAfterChanges)
-	{
-		endTransaction();
-		beginTransaction();
-	}
+
+	insertDependency(guid, hash);
+
+	AlignedVector< uint8_t > record;
+	record.push_back(c_recordDependency);
+	appendBytes(record, (const uint8_t*)guid, 16);
+	appendBytes(record, &hash, sizeof(hash));
+	writeJournal(record);
 }
 
 bool PipelineDbFlat::getDependency(const Guid& guid, PipelineDependencyHash& outHash) const
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lock);
-	auto it = m_dependencies.find(guid);
-	if (it == m_dependencies.end())
-		return false;
-	outHash = it->second;
-	return true;
+	const Snapshot* snapshot = acquireSnapshot();
+	const bool found = snapshot != nullptr ? snapshot->findDependency(guid, outHash) : false;
+	releaseSnapshot();
+	return found;
 }
 
 void PipelineDbFlat::setFile(const Path& path, const PipelineFileHash& file)
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireWriter)(m_lock);
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	T_FATAL_ASSERT(m_transaction);
-	m_files[path.getPathName()] = file;
-	if (++m_changes >= c_flushAfterChanges)
+
+	const std::string key = wstombs(Utf8Encoding(), path.getPathName());
+	insertFile(key, file);
+
+	const uint64_t lastWriteTime = file.lastWriteTime.getSecondsSinceEpoch();
+	const uint32_t keyLength = (uint32_t)key.length();
+
+	AlignedVector< uint8_t > record;
+	record.push_back(c_recordFile);
+	appendBytes(record, &file.size, sizeof(file.size));
+	appendBytes(record, &lastWriteTime, sizeof(lastWriteTime));
+	appendBytes(record, &file.hash, sizeof(file.hash));
+	appendBytes(record, &keyLength, sizeof(keyLength));
+	appendBytes(record, key.c_str(), keyLength);
+	writeJournal(record);
+}
+
+bool PipelineDbFlat::getFile(const Path& path, PipelineFileHash& outFile) const
+{
+	const std::string key = wstombs(Utf8Encoding(), path.getPathName());
+	const uint32_t keyHash = hashBytes(key.c_str(), key.length());
+
+	const Snapshot* snapshot = acquireSnapshot();
+	const bool found = snapshot != nullptr ? snapshot->findFile(key, keyHash, outFile) : false;
+	releaseSnapshot();
+	return found;
+}
+
+uint32_t PipelineDbFlat::getDependencyCount() const
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	updateInspection();
+	return (uint32_t)m_inspectDependencies.size();
+}
+
+bool PipelineDbFlat::getDependencyByIndex(uint32_t index, Guid& outGuid, PipelineDependencyHash& outHash) const
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	updateInspection();
+
+	if (index >= m_inspectDependencies.size())
+		return false;
+
+	outGuid = m_inspectDependencies[index].first;
+	outHash = m_inspectDependencies[index].second;
+	return true;
+}
+
+uint32_t PipelineDbFlat::getFileCount() const
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	updateInspection();
+	return (uint32_t)m_inspectFiles.size();
+}
+
+bool PipelineDbFlat::getFileByIndex(uint32_t index, Path& outPath, PipelineFileHash& outFile) const
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	updateInspection();
+
+	if (index >= m_inspectFiles.size())
+		return false;
+
+	outPath = Path(mbstows(Utf8Encoding(), m_inspectFiles[index].first));
+	outFile = m_inspectFiles[index].second;
+	return true;
+}
+
+std::wstring PipelineDbFlat::getJournalFileName() const
+{
+	return m_file + L".journal";
+}
+
+const PipelineDbFlat::Snapshot* PipelineDbFlat::acquireSnapshot() const
+{
+	// Reader is registered before snapshot is loaded; thus a writer which has
+	// unpublished a snapshot and then see no readers can safely release it.
+	m_readers++;
+	const Snapshot* snapshot = m_snapshot.load();
+	if (snapshot)
+		return snapshot;
+	m_readers--;
+
+	// No snapshot published, database is being remapped or closed; wait for writer.
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_readers++;
+	return m_snapshot.load();
+}
+
+void PipelineDbFlat::releaseSnapshot() const
+{
+	m_readers--;
+}
+
+void PipelineDbFlat::waitReaders() const
+{
+	while (m_readers.load() > 0)
+		ThreadManager::getInstance().getCurrentThread()->yield();
+}
+
+void PipelineDbFlat::reclaimRetired()
+{
+	if (m_retired.empty() || m_readers.load() > 0)
+		return;
+
+	for (auto retired : m_retired)
+		delete retired;
+	m_retired.clear();
+}
+
+PipelineDbFlat::Snapshot* PipelineDbFlat::mapSnapshot() const
+{
+	Ref< File > file = FileSystem::getInstance().get(m_file);
+	if (!file || file->getSize() < sizeof(Header))
+		return nullptr;
+
+	Ref< IMappedFile > mappedFile = FileSystem::getInstance().map(m_file);
+	if (!mappedFile || mappedFile->getSize() < (int64_t)sizeof(Header))
+		return nullptr;
+
+	const uint8_t* base = (const uint8_t*)mappedFile->getBase();
+	const Header* header = (const Header*)base;
+	if (header->magic != c_magic || header->version != c_version)
+		return nullptr;
+
+	const int64_t size = sizeof(Header) + (int64_t)header->dependencyCount * sizeof(DependencyRecord) + (int64_t)header->fileCount * sizeof(FileRecord) + header->stringsSize;
+	if (mappedFile->getSize() < size)
 	{
-		endTransaction();
-		beginTransaction();
+		log::warning << L"Pipeline database truncated; database purged and rebuild is required." << Endl;
+		return new Snapshot();
 	}
+
+	Snapshot* snapshot = new Snapshot();
+	snapshot->mappedFile = mappedFile;
+	snapshot->dependencies = (const DependencyRecord*)(base + sizeof(Header));
+	snapshot->dependencyCount = header->dependencyCount;
+	snapshot->files = (const FileRecord*)(snapshot->dependencies + header->dependencyCount);
+	snapshot->fileCount = header->fileCount;
+	snapshot->strings = (const char*)(snapshot->files + header->fileCount);
+	return snapshot;
 }
 
-bool PipelineDbFlat::getFile(const Path& path, PipelineFileHash& outFile) const
+bool PipelineDbFlat::readLegacy()
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lock);
+	Ref< IStream > f = FileSystem::getInstance().open(m_file, File::FmRead);
+	if (!f)
+		return false;
+
+	BinarySerializer s(f);
 
-	auto it = m_files.find(path.getPathName());
-	if (it == m_files.end())
+	uint32_t version = 0;
+	s >> Member< uint32_t >(L"version", version);
+	if (version != c_legacyVersion)
+	{
+		f->close();
 		return false;
+	}
+
+	SmallMap< Guid, PipelineDependencyHash > dependencies;
+	SmallMap< std::wstring, PipelineFileHash > files;
+
+	s >> MemberSmallMap<
+		Guid,
+		PipelineDependencyHash,
+		Member< Guid >,
+		MemberPipelineDependencyHash
+	>(L"dependencies", dependencies);
+
+	s >> MemberSmallMap<
+		std::wstring,
+		PipelineFileHash,
+		Member< std::wstring >,
+		MemberPipelineFileHash
+	>(L"files", files);
+
+	f->close();
+
+	for (const auto& it : dependencies)
+		insertDependency(it.first, it.second);
+	for (const auto& it : files)
+		insertFile(wstombs(Utf8Encoding(), it.first), it.second);
 
-	outFile = it->second;
 	return true;
 }
 
-uint32_t PipelineDbFlat::getDependencyCount() const
+void PipelineDbFlat::replayJournal()
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lock);
-	return (uint32_t)m_dependencies.size();
+	const std::wstring journalFileName = getJournalFileName();
+
+	Ref< File > file = FileSystem::getInstance().get(journalFileName);
+	if (!file || file->getSize() < 2 * sizeof(uint32_t))
+		return;
+
+	Ref< IMappedFile > mappedFile = FileSystem::getInstance().map(journalFileName);
+	if (!mappedFile)
+		return;
+
+	const uint8_t* ptr = (const uint8_t*)mappedFile->getBase();
+	const uint8_t* end = ptr + mappedFile->getSize();
+
+	uint32_t header[2];
+	std::memcpy(header, ptr, sizeof(header));
+	if (header[0] != c_journalMagic || header[1] != c_version)
+		return;
+	ptr += sizeof(header);
+
+	// Each record is prefixed with size and suffixed with checksum; stop at
+	// first incomplete record since it was probably cut short by a crash.
+	while ((uint64_t)(end - ptr) >= 2 * sizeof(uint32_t))
+	{
+		uint32_t recordSize;
+		std::memcpy(&recordSize, ptr, sizeof(uint32_t));
+		if (recordSize == 0 || (uint64_t)(end - ptr) < 2 * sizeof(uint32_t) + (uint64_t)recordSize)
+			break;
+
+		const uint8_t* record = ptr + sizeof(uint32_t);
+		uint32_t checksum;
+		std::memcpy(&checksum, record + recordSize, sizeof(uint32_t));
+		if (checksum != hashBytes(record, recordSize))
+			break;
+
+		if (record[0] == c_recordDependency && recordSize == 1 + 16 + sizeof(PipelineDependencyHash))
+		{
+			PipelineDependencyHash hash;
+			std::memcpy(&hash, record + 1 + 16, sizeof(hash));
+			insertDependency(Guid(record + 1), hash);
+		}
+		else if (record[0] == c_recordFile && recordSize >= 1 + 8 + 8 + 4 + 4)
+		{
+			PipelineFileHash file;
+			uint64_t lastWriteTime;
+			uint32_t keyLength;
+			std::memcpy(&file.size, record + 1, 8);
+			std::memcpy(&lastWriteTime, record + 1 + 8, 8);
+			std::memcpy(&file.hash, record + 1 + 8 + 8, 4);
+			std::memcpy(&keyLength, record + 1 + 8 + 8 + 4, 4);
+			if (recordSize != 1 + 8 + 8 + 4 + 4 + keyLength)
+				break;
+			file.lastWriteTime = DateTime(lastWriteTime);
+			insertFile(std::string((const char*)record + 1 + 8 + 8 + 4 + 4, keyLength), file);
+		}
+		else
+			break;
+
+		ptr += 2 * sizeof(uint32_t) + recordSize;
+		m_journalRecords++;
+	}
 }
 
-bool PipelineDbFlat::getDependencyByIndex(uint32_t index, Guid& outGuid, PipelineDependencyHash& outHash) const
+bool PipelineDbFlat::createJournal()
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lock);
+	if (m_journal)
+	{
+		m_journal->close();
+		m_journal = nullptr;
+	}
 
-	if (index >= m_dependencies.size())
+	Ref< IStream > f = FileSystem::getInstance().open(getJournalFileName(), File::FmWrite);
+	if (!f)
+	{
+		log::error << L"Unable to open pipeline db; failed to create journal." << Endl;
 		return false;
+	}
+
+	m_journal = new BufferedStream(f);
+	m_journalRecords = 0;
+
+	const uint32_t header[] = { c_journalMagic, c_version };
+	m_journal->write(header, sizeof(header));
 
-	auto it = m_dependencies.begin();
-	std::advance(it, index);
+	// Re-append changes which hasn't been folded into database; only newest change
+	// of each record, which is first in bucket.
+	const Snapshot* snapshot = m_snapshot.load();
+	for (const auto& bucket : snapshot->dependencyBuckets)
+	{
+		for (const Snapshot::DependencyNode* node = bucket.load(); node != nullptr; node = node->next)
+		{
+			const Snapshot::DependencyNode* newer = bucket.load();
+			for (; newer != node && newer->guid != node->guid; newer = newer->next)
+				;
+			if (newer != node)
+				continue;
+
+			AlignedVector< uint8_t > record;
+			record.push_back(c_recordDependency);
+			appendBytes(record, (const uint8_t*)node->guid, 16);
+			appendBytes(record, &node->hash, sizeof(node->hash));
+			writeJournal(record);
+		}
+	}
+	for (const auto& bucket : snapshot->fileBuckets)
+	{
+		for (const Snapshot::FileNode* node = bucket.load(); node != nullptr; node = node->next)
+		{
+			const Snapshot::FileNode* newer = bucket.load();
+			for (; newer != node && (newer->keyHash != node->keyHash || newer->key != node->key); newer = newer->next)
+				;
+			if (newer != node)
+				continue;
+
+			const uint64_t lastWriteTime = node->file.lastWriteTime.getSecondsSinceEpoch();
+			const uint32_t keyLength = (uint32_t)node->key.length();
+
+			AlignedVector< uint8_t > record;
+			record.push_back(c_recordFile);
+			appendBytes(record, &node->file.size, sizeof(node->file.size));
+			appendBytes(record, &lastWriteTime, sizeof(lastWriteTime));
+			appendBytes(record, &node->file.hash, sizeof(node->file.hash));
+			appendBytes(record, &keyLength, sizeof(keyLength));
+			appendBytes(record, node->key.c_str(), keyLength);
+			writeJournal(record);
+		}
+	}
 
-	outGuid = it->first;
-	outHash = it->second;
+	m_journal->flush();
+	m_changes = 0;
 	return true;
 }
 
-uint32_t PipelineDbFlat::getFileCount() const
+void PipelineDbFlat::writeJournal(const AlignedVector< uint8_t >& record)
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lock);
-	return (uint32_t)m_files.size();
+	if (!m_journal)
+		return;
+
+	const uint32_t recordSize = (uint32_t)record.size();
+	const uint32_t checksum = hashBytes(record.c_ptr(), record.size());
+	m_journal->write(&recordSize, sizeof(recordSize));
+	m_journal->write(record.c_ptr(), record.size());
+	m_journal->write(&checksum, sizeof(checksum));
+	m_journalRecords++;
+
+	if (++m_changes >= c_flushAfterChanges)
+		flushJournal();
 }
 
-bool PipelineDbFlat::getFileByIndex(uint32_t index, Path& outPath, PipelineFileHash& outFile) const
+void PipelineDbFlat::flushJournal()
+{
+	if (m_journal)
+		m_journal->flush();
+	m_changes = 0;
+
+	reclaimRetired();
+
+	// Fold journal into database when it has grown large; stop trying
+	// if database cannot be written, it's instead folded when closed.
+	const Snapshot* snapshot = m_snapshot.load();
+	if (snapshot && !m_compactFailed && m_journalRecords >= std::max(c_compactAfterRecords, snapshot->dependencyCount + snapshot->fileCount))
+		m_compactFailed = !compact();
+}
+
+bool PipelineDbFlat::compact()
 {
-	T_ANONYMOUS_VAR(ReaderWriterLock::AcquireReader)(m_lock);
+	Snapshot* snapshot = m_snapshot.load();
 
-	if (index >= m_dependencies.size())
+	AlignedVector< std::pair< Guid, PipelineDependencyHash > > dependencies;
+	AlignedVector< std::pair< std::string, PipelineFileHash > > files;
+	merge(snapshot, dependencies, files);
+
+	if (!writeDatabase(dependencies, files))
 		return false;
 
-	auto it = m_files.begin();
-	std::advance(it, index);
+	if (replaceDatabase())
+	{
+		Snapshot* compacted = mapSnapshot();
+		if (!compacted)
+		{
+			log::error << L"Unable to compact pipeline db; failed to map database." << Endl;
+			return false;
+		}
+
+		// Previous snapshot might still be read, it's released when no reader is active.
+		m_snapshot = compacted;
+		m_retired.push_back(snapshot);
+		reclaimRetired();
+		return createJournal();
+	}
+
+	// Database cannot be replaced while mapped on some platforms; unpublish and unmap
+	// all snapshots, readers wait until database has been replaced and remapped.
+	m_snapshot = nullptr;
+	waitReaders();
+
+	delete snapshot;
+	for (auto retired : m_retired)
+		delete retired;
+	m_retired.clear();
+
+	Snapshot* compacted = replaceDatabase() ? mapSnapshot() : nullptr;
+	if (!compacted)
+	{
+		log::warning << L"Unable to compact pipeline db; failed to replace or map database, journal kept." << Endl;
+		FileSystem::getInstance().remove(m_file + L"~");
+
+		// Restore records as changes, journal still contain all changes not in database file.
+		m_snapshot = new Snapshot();
+		for (const auto& dependency : dependencies)
+			insertDependency(dependency.first, dependency.second);
+		for (const auto& file : files)
+			insertFile(file.first, file.second);
+		return false;
+	}
+
+	m_snapshot = compacted;
+	return createJournal();
+}
+
+bool PipelineDbFlat::writeDatabase(
+	const AlignedVector< std::pair< Guid, PipelineDependencyHash > >& dependencies,
+	const AlignedVector< std::pair< std::string, PipelineFileHash > >& files
+) const
+{
+	const std::wstring tempFileName = m_file + L"~";
+
+	Ref< IStream > f = FileSystem::getInstance().open(tempFileName, File::FmWrite);
+	if (!f)
+	{
+		log::error << L"Unable to write pipeline db; failed to create file." << Endl;
+		return false;
+	}
+
+	uint32_t stringsSize = 0;
+	for (const auto& file : files)
+		stringsSize += (uint32_t)file.first.length();
+
+	BufferedStream bs(f);
+
+	const Header header = { c_magic, c_version, (uint32_t)dependencies.size(), (uint32_t)files.size(), stringsSize, 0 };
+	bs.write(&header, sizeof(header));
+
+	for (const auto& dependency : dependencies)
+	{
+		DependencyRecord record;
+		std::memcpy(record.guid, (const uint8_t*)dependency.first, 16);
+		record.hash = dependency.second;
+		bs.write(&record, sizeof(record));
+	}
+
+	uint32_t pathOffset = 0;
+	for (const auto& file : files)
+	{
+		FileRecord record;
+		record.pathHash = hashBytes(file.first.c_str(), file.first.length());
+		record.pathOffset = pathOffset;
+		record.pathLength = (uint32_t)file.first.length();
+		record.hash = file.second.hash;
+		record.size = file.second.size;
+		record.lastWriteTime = file.second.lastWriteTime.getSecondsSinceEpoch();
+		bs.write(&record, sizeof(record));
+		pathOffset += record.pathLength;
+	}
+
+	for (const auto& file : files)
+		bs.write(file.first.c_str(), file.first.length());
+
+	bs.close();
+	f = nullptr;
 
-	outPath = it->first;
-	outFile = it->second;
 	return true;
 }
 
+bool PipelineDbFlat::replaceDatabase() const
+{
+	const std::wstring tempFileName = m_file + L"~";
+	return FileSystem::getInstance().move(m_file, tempFileName, true);
+}
+
+void PipelineDbFlat::merge(
+	const Snapshot* snapshot,
+	AlignedVector< std::pair< Guid, PipelineDependencyHash > >& outDependencies,
+	AlignedVector< std::pair< std::string, PipelineFileHash > >& outFiles
+) const
+{
+	// Dependencies; sort changes by guid and newest first.
+	AlignedVector< const Snapshot::DependencyNode* > dependencyNodes;
+	for (const auto& bucket : snapshot->dependencyBuckets)
+	{
+		for (const Snapshot::DependencyNode* node = bucket.load(); node != nullptr; node = node->next)
+			dependencyNodes.push_back(node);
+	}
+	std::sort(dependencyNodes.begin(), dependencyNodes.end(), [](const Snapshot::DependencyNode* lh, const Snapshot::DependencyNode* rh) {
+		if (lh->guid != rh->guid)
+			return lh->guid < rh->guid;
+		return lh->sequence > rh->sequence;
+	});
+
+	outDependencies.resize(0);
+	outDependencies.reserve(snapshot->dependencyCount + dependencyNodes.size());
+
+	uint32_t i = 0;
+	for (uint32_t j = 0; j < (uint32_t)dependencyNodes.size(); )
+	{
+		const Snapshot::DependencyNode* node = dependencyNodes[j];
+		const uint8_t* key = (const uint8_t*)node->guid;
+
+		for (; i < snapshot->dependencyCount && std::memcmp(snapshot->dependencies[i].guid, key, 16) < 0; ++i)
+			outDependencies.push_back({ Guid(snapshot->dependencies[i].guid), snapshot->dependencies[i].hash });
+		if (i < snapshot->dependencyCount && std::memcmp(snapshot->dependencies[i].guid, key, 16) == 0)
+			++i;
+
+		outDependencies.push_back({ node->guid, node->hash });
+
+		// Skip older changes of same record.
+		for (++j; j < (uint32_t)dependencyNodes.size() && dependencyNodes[j]->guid == node->guid; ++j)
+			;
+	}
+	for (; i < snapshot->dependencyCount; ++i)
+		outDependencies.push_back({ Guid(snapshot->dependencies[i].guid), snapshot->dependencies[i].hash });
+
+	// Files; sorted by hash of path, as records in database.
+	AlignedVector< const Snapshot::FileNode* > fileNodes;
+	for (const auto& bucket : snapshot->fileBuckets)
+	{
+		for (const Snapshot::FileNode* node = bucket.load(); node != nullptr; node = node->next)
+			fileNodes.push_back(node);
+	}
+	std::sort(fileNodes.begin(), fileNodes.end(), [](const Snapshot::FileNode* lh, const Snapshot::FileNode* rh) {
+		const int32_t c = compareFile(lh->keyHash, lh->key, rh->keyHash, rh->key);
+		if (c != 0)
+			return c < 0;
+		return lh->sequence > rh->sequence;
+	});
+
+	outFiles.resize(0);
+	outFiles.reserve(snapshot->fileCount + fileNodes.size());
+
+	auto pushRecord = [&](const FileRecord& record) {
+		PipelineFileHash file;
+		file.size = record.size;
+		file.lastWriteTime = DateTime(record.lastWriteTime);
+		file.hash = record.hash;
+		outFiles.push_back({ std::string(snapshot->getKey(record)), file });
+	};
+
+	i = 0;
+	for (uint32_t j = 0; j < (uint32_t)fileNodes.size(); )
+	{
+		const Snapshot::FileNode* node = fileNodes[j];
+
+		for (; i < snapshot->fileCount && compareFile(snapshot->files[i].pathHash, snapshot->getKey(snapshot->files[i]), node->keyHash, node->key) < 0; ++i)
+			pushRecord(snapshot->files[i]);
+		if (i < snapshot->fileCount && compareFile(snapshot->files[i].pathHash, snapshot->getKey(snapshot->files[i]), node->keyHash, node->key) == 0)
+			++i;
+
+		outFiles.push_back({ node->key, node->file });
+
+		for (++j; j < (uint32_t)fileNodes.size() && fileNodes[j]->keyHash == node->keyHash && fileNodes[j]->key == node->key; ++j)
+			;
+	}
+	for (; i < snapshot->fileCount; ++i)
+		pushRecord(snapshot->files[i]);
+}
+
+void PipelineDbFlat::updateInspection() const
+{
+	if (m_inspectSequence == m_sequence)
+		return;
+
+	const Snapshot* snapshot = m_snapshot.load();
+	if (snapshot)
+		merge(snapshot, m_inspectDependencies, m_inspectFiles);
+	else
+	{
+		m_inspectDependencies.clear();
+		m_inspectFiles.clear();
+	}
+
+	m_inspectSequence = m_sequence;
+}
+
+void PipelineDbFlat::insertDependency(const Guid& guid, const PipelineDependencyHash& hash)
+{
+	Snapshot* snapshot = m_snapshot.load();
+	std::atomic< Snapshot::DependencyNode* >& bucket = snapshot->dependencyBuckets[hashBytes((const uint8_t*)guid, 16) & (c_dependencyBuckets - 1)];
+
+	// Publish node after it's been initialized; readers can walk bucket at any time.
+	Snapshot::DependencyNode* node = new Snapshot::DependencyNode();
+	node->guid = guid;
+	node->hash = hash;
+	node->sequence = ++m_sequence;
+	node->next = bucket.load(std::memory_order_relaxed);
+	bucket.store(node, std::memory_order_release);
+}
+
+void PipelineDbFlat::insertFile(const std::string& key, const PipelineFileHash& file)
+{
+	Snapshot* snapshot = m_snapshot.load();
+	const uint32_t keyHash = hashBytes(key.c_str(), key.length());
+	std::atomic< Snapshot::FileNode* >& bucket = snapshot->fileBuckets[keyHash & (c_fileBuckets - 1)];
+
+	Snapshot::FileNode* node = new Snapshot::FileNode();
+	node->key = key;
+	node->keyHash = keyHash;
+	node->file = file;
+	node->sequence = ++m_sequence;
+	node->next = bucket.load(std::memory_order_relaxed);
+	bucket.store(node, std::memory_order_release);
+}
+
 }
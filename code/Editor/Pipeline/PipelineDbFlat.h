@@ -8,9 +8,10 @@
  */
 #pragma once
 
-#include "Core/Containers/SmallMap.h"
-#include "Core/Io/StringOutputStream.h"
-#include "Core/Thread/ReaderWriterLock.h"
+#include <atomic>
+#include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Thread/Semaphore.h"
 #include "Editor/IPipelineDb.h"
 
 // import/export mechanism.
@@ -21,14 +22,36 @@
 #	define T_DLLCLASS T_DLLIMPORT
 #endif
 
+namespace traktor
+{
+
+class IMappedFile;
+class IStream;
+
+}
+
 namespace traktor::editor
 {
 
+/*! Flat file pipeline database.
+ * \ingroup Editor
+ *
+ * Records are stored in a compact, sorted, binary file which
+ * is memory mapped when opened. Changes are kept in memory and
+ * appended to a journal file, the journal is periodically
+ * folded back into the database file.
+ *
+ * Readers never lock; a snapshot of mapped records and changes
+ * is published atomically, while writers are serialized. Superseded
+ * snapshots are released as soon as no reader is active.
+ */
 class T_DLLCLASS PipelineDbFlat : public IPipelineDb
 {
 	T_RTTI_CLASS;
 
 public:
+	virtual ~PipelineDbFlat();
+
 	virtual bool open(const std::wstring& connectionString) override final;
 
 	virtual void close() override final;
@@ -54,12 +77,77 @@ public:
 	virtual bool getFileByIndex(uint32_t index, Path& outPath, PipelineFileHash& outFile) const override final;
 
 private:
-	mutable ReaderWriterLock m_lock;
+	struct Snapshot;
+
+	mutable Semaphore m_lock;
 	std::wstring m_file;
-	SmallMap< Guid, PipelineDependencyHash > m_dependencies;
-	SmallMap< std::wstring, PipelineFileHash > m_files;
+	std::atomic< Snapshot* > m_snapshot = nullptr;
+	mutable std::atomic< int32_t > m_readers = 0;
+	AlignedVector< Snapshot* > m_retired;
+	Ref< IStream > m_journal;
+	uint32_t m_journalRecords = 0;
+	uint32_t m_sequence = 0;
 	uint32_t m_changes = 0;
 	bool m_transaction = false;
+	bool m_compactFailed = false;
+
+	mutable AlignedVector< std::pair< Guid, PipelineDependencyHash > > m_inspectDependencies;
+	mutable AlignedVector< std::pair< std::string, PipelineFileHash > > m_inspectFiles;
+	mutable uint32_t m_inspectSequence = ~0U;
+
+	std::wstring getJournalFileName() const;
+
+	/*! Get current snapshot for reading, must be released when done. */
+	const Snapshot* acquireSnapshot() const;
+
+	void releaseSnapshot() const;
+
+	/*! Wait until no reader use any snapshot, snapshot must be unpublished first. */
+	void waitReaders() const;
+
+	/*! Release retired snapshots if no reader is active. */
+	void reclaimRetired();
+
+	/*! Map database file, null if file isn't a mapped database. */
+	Snapshot* mapSnapshot() const;
+
+	/*! Read previous, serialized, database format into current snapshot. */
+	bool readLegacy();
+
+	/*! Read journal and apply changes onto current snapshot. */
+	void replayJournal();
+
+	/*! Create journal, containing changes not yet in database file. */
+	bool createJournal();
+
+	void writeJournal(const AlignedVector< uint8_t >& record);
+
+	void flushJournal();
+
+	/*! Fold journal into database file. */
+	bool compact();
+
+	/*! Write sorted records into temporary database file. */
+	bool writeDatabase(
+		const AlignedVector< std::pair< Guid, PipelineDependencyHash > >& dependencies,
+		const AlignedVector< std::pair< std::string, PipelineFileHash > >& files
+	) const;
+
+	/*! Replace database file with temporary database file. */
+	bool replaceDatabase() const;
+
+	/*! Merge records from mapped file and changes of snapshot. */
+	void merge(
+		const Snapshot* snapshot,
+		AlignedVector< std::pair< Guid, PipelineDependencyHash > >& outDependencies,
+		AlignedVector< std::pair< std::string, PipelineFileHash > >& outFiles
+	) const;
+
+	void updateInspection() const;
+
+	void insertDependency(const Guid& guid, const PipelineDependencyHash& hash);
+
+	void insertFile(const std::string& key, const PipelineFileHash& file);
 };
 
 }
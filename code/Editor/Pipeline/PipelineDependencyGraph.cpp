@@ -0,0 +1,209 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Editor/Pipeline/PipelineDependencyGraph.h"
+#include "Editor/PipelineDependency.h"
+#include "Editor/PipelineDependencySet.h"
+
+namespace traktor::editor
+{
+	namespace
+	{
+
+const uint32_t c_unvisited = ~0U;
+
+bool isUseEdge(const PipelineDependencySet* dependencySet, uint32_t parent, uint32_t child)
+{
+	if (child == parent)
+		return false;
+
+	const PipelineDependency* childDependency = dependencySet->get(child);
+	T_ASSERT(childDependency);
+
+	return (childDependency->flags & PdfUse) != 0;
+}
+
+	}
+
+PipelineDependencyGraph::PipelineDependencyGraph(const PipelineDependencySet* dependencySet)
+:	m_dependencySet(dependencySet)
+{
+	struct Frame
+	{
+		uint32_t index;
+		uint32_t child;
+	};
+
+	const size_t count = dependencySet->size();
+
+	AlignedVector< uint32_t > visitIndices(count, c_unvisited);
+	AlignedVector< uint32_t > lowLinks(count, 0);
+	AlignedVector< bool > onStack(count, false);
+	AlignedVector< uint32_t > stack;
+	AlignedVector< Frame > frames;
+	uint32_t visitCount = 0;
+
+	m_order.reserve(count);
+	m_componentOffsets.reserve(count + 1);
+	m_componentOffsets.push_back(0);
+	m_components.resize(count, c_unvisited);
+
+	// Tarjan's strongly connected components, iterative since dependency
+	// chains can be deep. Components are found in reverse topological order,
+	// i.e. a component is complete only after all components it use.
+	for (uint32_t root = 0; root < (uint32_t)count; ++root)
+	{
+		if (visitIndices[root] != c_unvisited)
+			continue;
+
+		visitIndices[root] = lowLinks[root] = visitCount++;
+		stack.push_back(root);
+		onStack[root] = true;
+		frames.push_back({ root, 0 });
+
+		while (!frames.empty())
+		{
+			Frame& frame = frames.back();
+			const PipelineDependency* dependency = dependencySet->get(frame.index);
+			T_ASSERT(dependency);
+
+			if (frame.child < (uint32_t)dependency->children.size())
+			{
+				const uint32_t parent = frame.index;
+				const uint32_t child = *(dependency->children.begin() + frame.child++);
+
+				if (!isUseEdge(dependencySet, parent, child))
+					continue;
+
+				if (visitIndices[child] == c_unvisited)
+				{
+					visitIndices[child] = lowLinks[child] = visitCount++;
+					stack.push_back(child);
+					onStack[child] = true;
+					frames.push_back({ child, 0 });
+				}
+				else if (onStack[child])
+					lowLinks[parent] = std::min(lowLinks[parent], visitIndices[child]);
+
+				continue;
+			}
+
+			const uint32_t index = frame.index;
+			frames.pop_back();
+
+			if (!frames.empty())
+			{
+				const uint32_t parent = frames.back().index;
+				lowLinks[parent] = std::min(lowLinks[parent], lowLinks[index]);
+			}
+
+			// Pop component if this is the root of it.
+			if (lowLinks[index] == visitIndices[index])
+			{
+				const uint32_t component = (uint32_t)m_componentOffsets.size() - 1;
+				uint32_t member;
+				do
+				{
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = false;
+					m_components[member] = component;
+					m_order.push_back(member);
+				}
+				while (member != index);
+				m_componentOffsets.push_back((uint32_t)m_order.size());
+			}
+		}
+	}
+}
+
+void PipelineDependencyGraph::calculateGlobalHashes(AlignedVector< PipelineDependencyHash >& outHashes) const
+{
+	outHashes.resize(m_dependencySet->size());
+
+	const uint32_t componentCount = getComponentCount();
+	for (uint32_t component = 0; component < componentCount; ++component)
+	{
+		for (uint32_t i = m_componentOffsets[component]; i < m_componentOffsets[component + 1]; ++i)
+		{
+			const uint32_t index = m_order[i];
+			const PipelineDependency* dependency = m_dependencySet->get(index);
+
+			PipelineDependencyHash& hash = outHashes[index];
+			hash.pipelineHash = dependency->pipelineHash;
+			hash.sourceAssetHash = dependency->sourceAssetHash;
+			hash.sourceDataHash = dependency->sourceDataHash;
+			hash.filesHash = dependency->filesHash;
+
+			// Children in other components are already calculated.
+			for (auto child : dependency->children)
+			{
+				if (!isUseEdge(m_dependencySet, index, child) || m_components[child] == component)
+					continue;
+
+				const PipelineDependencyHash& childHash = outHashes[child];
+				hash.pipelineHash += childHash.pipelineHash;
+				hash.sourceAssetHash += childHash.sourceAssetHash;
+				hash.sourceDataHash += childHash.sourceDataHash;
+				hash.filesHash += childHash.filesHash;
+			}
+		}
+	}
+}
+
+void PipelineDependencyGraph::propagateModified(AlignedVector< uint32_t >& inoutReasons) const
+{
+	const uint32_t componentCount = getComponentCount();
+
+	// Number of modified dependencies in each component, and if
+	// any component used, direct or indirect, contain a modified dependency.
+	AlignedVector< uint32_t > modifiedCounts(componentCount, 0);
+	AlignedVector< bool > modifiedBelow(componentCount, false);
+
+	for (uint32_t component = 0; component < componentCount; ++component)
+	{
+		const uint32_t from = m_componentOffsets[component];
+		const uint32_t to = m_componentOffsets[component + 1];
+
+		for (uint32_t i = from; i < to; ++i)
+		{
+			if ((inoutReasons[m_order[i]] & PbrSourceModified) != 0)
+				modifiedCounts[component]++;
+		}
+
+		for (uint32_t i = from; i < to && !modifiedBelow[component]; ++i)
+		{
+			const uint32_t index = m_order[i];
+			for (auto child : m_dependencySet->get(index)->children)
+			{
+				if (!isUseEdge(m_dependencySet, index, child))
+					continue;
+
+				const uint32_t childComponent = m_components[child];
+				if (childComponent != component && (modifiedCounts[childComponent] > 0 || modifiedBelow[childComponent]))
+				{
+					modifiedBelow[component] = true;
+					break;
+				}
+			}
+		}
+
+		// All other members of a component are reachable, thus a
+		// dependency is also affected by modified members other than itself.
+		for (uint32_t i = from; i < to; ++i)
+		{
+			const uint32_t index = m_order[i];
+			const uint32_t self = (inoutReasons[index] & PbrSourceModified) != 0 ? 1 : 0;
+			if (modifiedBelow[component] || modifiedCounts[component] > self)
+				inoutReasons[index] |= PbrDependencyModified;
+		}
+	}
+}
+
+}
@@ -0,0 +1,60 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/Containers/AlignedVector.h"
+#include "Editor/PipelineTypes.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_EDITOR_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::editor
+{
+
+class PipelineDependencySet;
+
+/*! Topologically sorted view of a dependency set.
+ * \ingroup Editor
+ *
+ * Only "use" edges are considered, i.e. edges to children
+ * with the PdfUse flag. Dependency cycles are collapsed into
+ * components so each dependency is visited once, thus
+ * analysis is linear in the size of the dependency set.
+ */
+class T_DLLCLASS PipelineDependencyGraph
+{
+public:
+	explicit PipelineDependencyGraph(const PipelineDependencySet* dependencySet);
+
+	/*! Calculate global hash of each dependency.
+	 *
+	 * Global hash is the sum of the dependency's own hashes and
+	 * global hashes of all used children; edges within a cycle are ignored.
+	 */
+	void calculateGlobalHashes(AlignedVector< PipelineDependencyHash >& outHashes) const;
+
+	/*! Add PbrDependencyModified to dependencies which use any PbrSourceModified dependency, direct or indirect. */
+	void propagateModified(AlignedVector< uint32_t >& inoutReasons) const;
+
+	/*! Number of components, equal to number of dependencies if there are no cycles. */
+	uint32_t getComponentCount() const { return (uint32_t)m_componentOffsets.size() - 1; }
+
+private:
+	const PipelineDependencySet* m_dependencySet;
+	AlignedVector< uint32_t > m_order;				/*!< Dependencies grouped by component, children first. */
+	AlignedVector< uint32_t > m_componentOffsets;	/*!< Offset into order of each component. */
+	AlignedVector< uint32_t > m_components;			/*!< Component of each dependency. */
+};
+
+}
@@ -10,6 +10,7 @@
 
 #include <list>
 #include "Core/Guid.h"
+#include "Core/Ref.h"
 #include "Core/RefArray.h"
 #include "Core/Containers/SmallSet.h"
 #include "Core/Date/DateTime.h"
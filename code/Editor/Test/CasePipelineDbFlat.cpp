@@ -0,0 +1,161 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "Core/Guid.h"
+#include "Core/Io/FileSystem.h"
+#include "Core/Log/Log.h"
+#include "Core/Misc/String.h"
+#include "Core/Timer/Timer.h"
+#include "Editor/Pipeline/PipelineDbFlat.h"
+#include "Editor/Test/CasePipelineDbFlat.h"
+
+namespace traktor::editor::test
+{
+	namespace
+	{
+
+const wchar_t* c_fileName = L"PipelineDbFlatTest.db";
+const uint32_t c_count = 50000;
+
+PipelineDependencyHash createHash(uint32_t i)
+{
+	PipelineDependencyHash hash;
+	hash.pipelineHash = i;
+	hash.sourceAssetHash = i * 3;
+	hash.sourceDataHash = i * 5;
+	hash.filesHash = i * 7;
+	return hash;
+}
+
+PipelineFileHash createFile(uint32_t i)
+{
+	PipelineFileHash file;
+	file.size = i * 11;
+	file.lastWriteTime = DateTime(uint64_t(1700000000 + i));
+	file.hash = i * 13;
+	return file;
+}
+
+Path createPath(uint32_t i)
+{
+	return Path(L"C:/Source/Assets/Folder_" + toString(i % 97) + L"/File_" + toString(i) + L".png");
+}
+
+void removeFiles()
+{
+	FileSystem::getInstance().remove(c_fileName);
+	FileSystem::getInstance().remove(std::wstring(c_fileName) + L".journal");
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.editor.test.CasePipelineDbFlat", 0, CasePipelineDbFlat, traktor::test::Case)
+
+void CasePipelineDbFlat::run()
+{
+	const std::wstring connectionString = std::wstring(L"fileName=") + c_fileName;
+
+	AlignedVector< Guid > guids;
+	for (uint32_t i = 0; i < c_count; ++i)
+		guids.push_back(Guid::create());
+
+	removeFiles();
+
+	// Populate new database.
+	{
+		PipelineDbFlat db;
+		CASE_ASSERT(db.open(connectionString));
+
+		Timer timer;
+		db.beginTransaction();
+		for (uint32_t i = 0; i < c_count; ++i)
+		{
+			db.setDependency(guids[i], createHash(i));
+			db.setFile(createPath(i), createFile(i));
+		}
+		db.endTransaction();
+		log::info << L"PipelineDbFlat, " << c_count << L" records written in " << int32_t(timer.getElapsedTime() * 1e3) << L" ms" << Endl;
+
+		PipelineDependencyHash hash;
+		CASE_ASSERT(db.getDependency(guids[123], hash));
+		CASE_ASSERT_EQUAL(hash.sourceDataHash, 123 * 5);
+		CASE_ASSERT_EQUAL(db.getDependencyCount(), c_count);
+		CASE_ASSERT_EQUAL(db.getFileCount(), c_count);
+
+		db.close();
+	}
+
+	// Reopen and update some records, don't close to leave changes in journal only.
+	{
+		Timer timer;
+		PipelineDbFlat db;
+		CASE_ASSERT(db.open(connectionString));
+		log::info << L"PipelineDbFlat, opened in " << int32_t(timer.getElapsedTime() * 1e6) << L" us" << Endl;
+
+		timer.reset();
+		int32_t found = 0;
+		for (uint32_t i = 0; i < c_count; ++i)
+		{
+			PipelineDependencyHash hash;
+			PipelineFileHash file;
+			if (
+				db.getDependency(guids[i], hash) && hash.filesHash == i * 7 &&
+				db.getFile(createPath(i), file) && file.hash == i * 13 && file.lastWriteTime.getSecondsSinceEpoch() == 1700000000 + i
+			)
+				++found;
+		}
+		CASE_ASSERT_EQUAL(found, (int32_t)c_count);
+		log::info << L"PipelineDbFlat, " << c_count << L" records read in " << int32_t(timer.getElapsedTime() * 1e3) << L" ms" << Endl;
+
+		PipelineDependencyHash hash;
+		CASE_ASSERT(!db.getDependency(Guid::create(), hash));
+
+		db.beginTransaction();
+		db.setDependency(guids[7], createHash(1000000));
+		db.setFile(createPath(7), createFile(1000000));
+		db.setFile(Path(L"C:/Source/Assets/New.png"), createFile(1));
+		db.endTransaction();
+
+		CASE_ASSERT_EQUAL(db.getDependencyCount(), c_count);
+		CASE_ASSERT_EQUAL(db.getFileCount(), c_count + 1);
+
+		// Keep files as if session was interrupted before closing.
+		const std::wstring journalFileName = std::wstring(c_fileName) + L".journal";
+		CASE_ASSERT(FileSystem::getInstance().copy(L"Interrupted.db", c_fileName, true));
+		CASE_ASSERT(FileSystem::getInstance().copy(L"Interrupted.journal", journalFileName, true));
+		db.close();
+		CASE_ASSERT(FileSystem::getInstance().move(c_fileName, L"Interrupted.db", true));
+		CASE_ASSERT(FileSystem::getInstance().move(journalFileName, L"Interrupted.journal", true));
+	}
+
+	// Reopen, changes should be restored from journal.
+	CASE_ASSERT(FileSystem::getInstance().exist(std::wstring(c_fileName) + L".journal"));
+	{
+		PipelineDbFlat db;
+		CASE_ASSERT(db.open(connectionString));
+
+		PipelineDependencyHash hash;
+		CASE_ASSERT(db.getDependency(guids[7], hash));
+		CASE_ASSERT_EQUAL(hash.pipelineHash, 1000000);
+
+		PipelineFileHash file;
+		CASE_ASSERT(db.getFile(createPath(7), file));
+		CASE_ASSERT_EQUAL(file.hash, 13000000);
+		CASE_ASSERT(db.getFile(Path(L"C:/Source/Assets/New.png"), file));
+		CASE_ASSERT(db.getFile(createPath(8), file));
+		CASE_ASSERT_EQUAL(file.hash, 8 * 13);
+
+		CASE_ASSERT_EQUAL(db.getFileCount(), c_count + 1);
+
+		db.close();
+	}
+
+	removeFiles();
+}
+
+}
@@ -0,0 +1,190 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Log/Log.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "Editor/PipelineDependency.h"
+#include "Editor/PipelineDependencySet.h"
+#include "Editor/Pipeline/PipelineDependencyGraph.h"
+#include "Editor/Test/CasePipelineDependencyGraph.h"
+
+namespace traktor::editor::test
+{
+	namespace
+	{
+
+const uint32_t c_benchmarkCounts[] = { 10000, 50000, 200000 };
+
+PipelineDependency* addDependency(PipelineDependencySet& dependencySet, uint32_t hash, uint32_t flags)
+{
+	Ref< PipelineDependency > dependency = new PipelineDependency();
+	dependency->pipelineHash = hash;
+	dependency->sourceAssetHash = hash * 3;
+	dependency->sourceDataHash = hash * 5;
+	dependency->filesHash = hash * 7;
+	dependency->flags = flags;
+	dependencySet.add(dependency);
+	return dependency;
+}
+
+/*! Create synthetic dependency set; children are mostly added after parents, as when scanning dependencies, with a few edges back to create cycles. */
+void createSyntheticSet(PipelineDependencySet& outDependencySet, uint32_t count, Random& random)
+{
+	for (uint32_t i = 0; i < count; ++i)
+		addDependency(outDependencySet, random.next(), PdfBuild | PdfUse);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		PipelineDependency* dependency = outDependencySet.get(i);
+		for (uint32_t j = 0; j < 4 && i + 1 < count; ++j)
+			dependency->children.insert(i + 1 + random.next() % std::min< uint32_t >(count - i - 1, 64));
+		if (i > 0 && random.next() % 100 == 0)
+			dependency->children.insert(random.next() % i);
+	}
+}
+
+/*! Reference propagation, depth first search from each dependency. */
+void referencePropagateModified(const PipelineDependencySet& dependencySet, AlignedVector< uint32_t >& inoutReasons)
+{
+	for (uint32_t i = 0; i < dependencySet.size(); ++i)
+	{
+		SmallSet< uint32_t > visited;
+		visited.insert(i);
+
+		AlignedVector< uint32_t > children;
+		children.insert(children.end(), dependencySet.get(i)->children.begin(), dependencySet.get(i)->children.end());
+
+		while (!children.empty())
+		{
+			const uint32_t child = children.back();
+			children.pop_back();
+
+			if (visited.find(child) != visited.end())
+				continue;
+
+			const PipelineDependency* childDependency = dependencySet.get(child);
+			if ((childDependency->flags & PdfUse) == 0)
+				continue;
+
+			if ((inoutReasons[child] & PbrSourceModified) != 0)
+				inoutReasons[i] |= PbrDependencyModified;
+
+			visited.insert(child);
+			children.insert(children.end(), childDependency->children.begin(), childDependency->children.end());
+		}
+	}
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.editor.test.CasePipelineDependencyGraph", 0, CasePipelineDependencyGraph, traktor::test::Case)
+
+void CasePipelineDependencyGraph::run()
+{
+	// Diamond; shared child is included once through each path.
+	{
+		PipelineDependencySet dependencySet;
+		PipelineDependency* a = addDependency(dependencySet, 1, PdfBuild);
+		PipelineDependency* b = addDependency(dependencySet, 10, PdfUse);
+		PipelineDependency* c = addDependency(dependencySet, 100, PdfUse);
+		addDependency(dependencySet, 1000, PdfUse);
+		a->children.insert(1);
+		a->children.insert(2);
+		b->children.insert(3);
+		c->children.insert(3);
+
+		AlignedVector< PipelineDependencyHash > hashes;
+		PipelineDependencyGraph(&dependencySet).calculateGlobalHashes(hashes);
+		CASE_ASSERT_EQUAL(hashes[0].pipelineHash, 1 + 10 + 100 + 2 * 1000);
+		CASE_ASSERT_EQUAL(hashes[1].pipelineHash, 10 + 1000);
+		CASE_ASSERT_EQUAL(hashes[3].filesHash, 7 * 1000);
+	}
+
+	// Cycle; a -> b -> c -> b, children without use flag are ignored.
+	{
+		PipelineDependencySet dependencySet;
+		PipelineDependency* a = addDependency(dependencySet, 1, PdfBuild);
+		PipelineDependency* b = addDependency(dependencySet, 2, PdfBuild | PdfUse);
+		PipelineDependency* c = addDependency(dependencySet, 3, PdfBuild | PdfUse);
+		addDependency(dependencySet, 4, PdfBuild);
+		a->children.insert(1);
+		b->children.insert(2);
+		c->children.insert(1);
+		c->children.insert(3);
+
+		const PipelineDependencyGraph graph(&dependencySet);
+		CASE_ASSERT_EQUAL(graph.getComponentCount(), 3);
+
+		AlignedVector< uint32_t > reasons = { 0, 0, PbrSourceModified, PbrSourceModified };
+		graph.propagateModified(reasons);
+		CASE_ASSERT_EQUAL(reasons[0], (uint32_t)PbrDependencyModified);
+		CASE_ASSERT_EQUAL(reasons[1], (uint32_t)PbrDependencyModified);
+		CASE_ASSERT_EQUAL(reasons[2], (uint32_t)PbrSourceModified);
+		CASE_ASSERT_EQUAL(reasons[3], (uint32_t)PbrSourceModified);
+	}
+
+	// Compare against reference on a random set with cycles.
+	{
+		Random random;
+		PipelineDependencySet dependencySet;
+		createSyntheticSet(dependencySet, 2000, random);
+
+		AlignedVector< uint32_t > reasons(dependencySet.size(), 0);
+		for (uint32_t i = 0; i < dependencySet.size(); i += 97)
+			reasons[i] = PbrSourceModified;
+
+		AlignedVector< uint32_t > expected = reasons;
+		Timer timer;
+		referencePropagateModified(dependencySet, expected);
+		const double referenceDuration = timer.getElapsedTime();
+
+		AlignedVector< uint32_t > result = reasons;
+		timer.reset();
+		PipelineDependencyGraph(&dependencySet).propagateModified(result);
+		const double duration = timer.getElapsedTime();
+
+		int32_t mismatches = 0;
+		for (uint32_t i = 0; i < dependencySet.size(); ++i)
+		{
+			if (result[i] != expected[i])
+				++mismatches;
+		}
+		CASE_ASSERT_EQUAL(mismatches, 0);
+
+		log::info << L"PipelineDependencyGraph, 2000 dependencies: " << int32_t(duration * 1e6) << L" us, reference " << int32_t(referenceDuration * 1e6) << L" us" << Endl;
+	}
+
+	// Benchmark analysis of large sets.
+	for (auto count : c_benchmarkCounts)
+	{
+		Random random;
+		PipelineDependencySet dependencySet;
+		createSyntheticSet(dependencySet, count, random);
+
+		AlignedVector< uint32_t > reasons(dependencySet.size(), 0);
+		for (uint32_t i = 0; i < dependencySet.size(); i += 97)
+			reasons[i] = PbrSourceModified;
+
+		Timer timer;
+		const PipelineDependencyGraph graph(&dependencySet);
+		AlignedVector< PipelineDependencyHash > hashes;
+		graph.calculateGlobalHashes(hashes);
+		graph.propagateModified(reasons);
+		const double duration = timer.getElapsedTime();
+
+		const int32_t modified = (int32_t)std::count_if(reasons.begin(), reasons.end(), [](uint32_t reason) { return reason != 0; });
+		CASE_ASSERT(modified > 0);
+
+		log::info << L"PipelineDependencyGraph, " << count << L" dependencies: " << int32_t(duration * 1e3) << L" ms (" << graph.getComponentCount() << L" components, " << modified << L" modified)" << Endl;
+	}
+}
+
+}
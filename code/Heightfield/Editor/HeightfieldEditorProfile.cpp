@@ -39,7 +39,7 @@ void HeightfieldEditorProfile::createResourceFactories(
 	RefArray< const resource::IResourceFactory >& outResourceFactories
 ) const
 {
-	outResourceFactories.push_back(new HeightfieldFactory());
+	outResourceFactories.push_back(new HeightfieldFactory(true));
 }
 
 void HeightfieldEditorProfile::createEntityFactories(
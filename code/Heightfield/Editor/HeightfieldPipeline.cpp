@@ -25,7 +25,7 @@
 namespace traktor::hf
 {
 
-T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.hf.HeightfieldPipeline", 2, HeightfieldPipeline, editor::IPipeline)
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.hf.HeightfieldPipeline", 3, HeightfieldPipeline, editor::IPipeline)
 
 bool HeightfieldPipeline::create(const editor::IPipelineSettings* settings, db::Database* database)
 {
@@ -123,7 +123,7 @@ bool HeightfieldPipeline::buildOutput(
 		return false;
 	}
 
-	HeightfieldFormat().write(outputData, heightfield);
+	HeightfieldFormat().writeTiled(outputData, heightfield);
 
 	outputData->close();
 	outputData = nullptr;
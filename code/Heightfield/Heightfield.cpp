@@ -9,12 +9,49 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
-#include "Core/Math/Aabb3.h"
-#include "Core/Math/Winding3.h"
+#include "Core/Thread/Acquire.h"
+#include "Core/Thread/JobManager.h"
 #include "Heightfield/Heightfield.h"
+#include "Heightfield/HeightfieldTile.h"
+#include "Heightfield/HeightfieldTileCache.h"
 
 namespace traktor::hf
 {
+	namespace
+	{
+
+const int32_t c_tileSize = Heightfield::BoundsTileSize;
+const int32_t c_maxStack = 128;		//!< Max number of pending nodes when traversing pyramid.
+const int32_t c_batchGrain = 64;	//!< Number of batched queries in each job.
+
+/*! Intersect ray with triangle, return distance along ray. */
+bool rayTriangle(const Vector4& origin, const Vector4& direction, const Vector4& v0, const Vector4& v1, const Vector4& v2, Scalar& outK)
+{
+	const Vector4 e1 = v1 - v0;
+	const Vector4 e2 = v2 - v0;
+
+	const Vector4 p = cross(direction, e2);
+	const float det = dot3(e1, p);
+	if (std::abs(det) <= std::numeric_limits< float >::min())
+		return false;
+
+	const Scalar invDet(1.0f / det);
+
+	const Vector4 t = origin - v0;
+	const float u = dot3(t, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	const Vector4 q = cross(t, e1);
+	const float v = dot3(direction, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	outK = dot3(e2, q) * invDet;
+	return outK > 0.0_simd;
+}
+
+	}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.hf.Heightfield", Heightfield, Object)
 
@@ -24,24 +61,80 @@ Heightfield::Heightfield(
 )
 :	m_size(size)
 ,	m_worldExtent(worldExtent)
+,	m_boundsDirty(true)
+,	m_allTilesDirty(true)
 {
+	const int32_t tileCount = (m_size + c_tileSize - 1) / c_tileSize;
+
 	m_heights.reset(new height_t [m_size * m_size]);
 	m_cuts.reset(new uint8_t [(m_size * m_size) / 8]);
 	m_attributes.reset(new uint8_t [m_size * m_size]);
 	m_worldExtent.storeUnaligned(m_worldExtentFloats);
+	m_dirtyTiles.resize(tileCount * tileCount, 0);
+}
+
+Heightfield::Heightfield(
+	int32_t size,
+	const Vector4& worldExtent,
+	HeightfieldTileCache* tileCache,
+	const AlignedVector< height_t >& leafBounds
+)
+:	m_size(size)
+,	m_worldExtent(worldExtent)
+,	m_tileCache(tileCache)
+,	m_boundsDirty(true)
+,	m_allTilesDirty(true)
+{
+	const int32_t tileCount = (m_size + c_tileSize - 1) / c_tileSize;
+
+	m_worldExtent.storeUnaligned(m_worldExtentFloats);
+	m_dirtyTiles.resize(tileCount * tileCount, 0);
+
+	// Seed pyramid leaves so queries doesn't need to decode every tile; upper levels are built by first query.
+	if (leafBounds.size() == tileCount * tileCount * 2)
+	{
+		allocateBounds();
+		Level& level0 = m_levels[0];
+		for (int32_t i = 0; i < tileCount * tileCount; ++i)
+			level0.bounds[i] = { leafBounds[i * 2], leafBounds[i * 2 + 1] };
+		m_allTilesDirty = false;
+	}
+}
+
+void Heightfield::prefetch(const Vector4& worldCenter, float worldRadius) const
+{
+	if (!m_tileCache)
+		return;
+
+	float gx0, gz0, gx1, gz1;
+	worldToGrid(worldCenter.x() - worldRadius, worldCenter.z() - worldRadius, gx0, gz0);
+	worldToGrid(worldCenter.x() + worldRadius, worldCenter.z() + worldRadius, gx1, gz1);
+
+	const int32_t tileSize = m_tileCache->getTileSize();
+	m_tileCache->prefetch(
+		(int32_t)std::floor(gx0) / tileSize,
+		(int32_t)std::floor(gz0) / tileSize,
+		(int32_t)std::floor(gx1) / tileSize,
+		(int32_t)std::floor(gz1) / tileSize
+	);
 }
 
 void Heightfield::setGridHeight(int32_t gridX, int32_t gridZ, float unitY)
 {
+	if (m_tileCache)
+		return;
 	if (gridX < 0 || gridX >= (int32_t)m_size)
 		return;
 	if (gridZ < 0 || gridZ >= (int32_t)m_size)
 		return;
 	m_heights[gridX + gridZ * m_size] = height_t(clamp(unitY, 0.0f, 1.0f) * 65535.0f);
+	invalidateBounds(gridX, gridZ);
 }
 
 void Heightfield::setGridCut(int32_t gridX, int32_t gridZ, bool cut)
 {
+	if (m_tileCache)
+		return;
 	if (gridX < 0 || gridX >= (int32_t)m_size)
 		return;
 	if (gridZ < 0 || gridZ >= (int32_t)m_size)
@@ -56,6 +149,8 @@ void Heightfield::setGridCut(int32_t gridX, int32_t gridZ, bool cut)
 
 void Heightfield::setGridAttribute(int32_t gridX, int32_t gridZ, uint8_t attribute)
 {
+	if (m_tileCache)
+		return;
 	if (gridX < 0 || gridX >= (int32_t)m_size)
 		return;
 	if (gridZ < 0 || gridZ >= (int32_t)m_size)
@@ -77,7 +172,7 @@ float Heightfield::getGridHeightNearest(int32_t gridX, int32_t gridZ) const
 	else if (gridZ >= (int32_t)m_size)
 		gridZ = (int32_t)m_size - 1;
 
-	return m_heights[gridX + gridZ * m_size] / 65535.0f;
+	return getHeight(gridX, gridZ) / 65535.0f;
 }
 
 float Heightfield::getGridHeightBilinear(float gridX, float gridZ) const
@@ -95,15 +190,17 @@ float Heightfield::getGridHeightBilinear(float gridX, float gridZ) const
 	else if (igridZ >= (int32_t)m_size - 1)
 		igridZ = (int32_t)m_size - 2;
 
-	const int32_t offset = igridX + igridZ * m_size;
-
-	height_t hts[] =
+	height_t hts[4];
+	if (!m_tileCache)
 	{
-		m_heights[offset],
-		m_heights[offset + 1],
-		m_heights[offset + m_size],
-		m_heights[offset + 1 + m_size]
-	};
+		const int32_t offset = igridX + igridZ * m_size;
+		hts[0] = m_heights[offset];
+		hts[1] = m_heights[offset + 1];
+		hts[2] = m_heights[offset + m_size];
+		hts[3] = m_heights[offset + 1 + m_size];
+	}
+	else
+		getHeights(igridX, igridZ, 2, 2, hts);
 
 	const float fgridX = gridX - igridX;
 	const float fgridZ = gridZ - igridZ;
@@ -180,6 +277,13 @@ bool Heightfield::getGridCut(int32_t gridX, int32_t gridZ) const
 	else if (gridZ >= (int32_t)m_size)
 		gridZ = (int32_t)m_size - 1;
 
+	if (m_tileCache)
+	{
+		const int32_t tileSize = m_tileCache->getTileSize();
+		Ref< const HeightfieldTile > tile = m_tileCache->getTile(gridX / tileSize, gridZ / tileSize);
+		return tile ? tile->getGridCut(gridX % tileSize, gridZ % tileSize) : false;
+	}
+
 	const int32_t offset = gridX + gridZ * m_size;
 	return (m_cuts[offset / 8] & (1 << (offset & 7))) != 0;
 }
@@ -203,6 +307,13 @@ uint8_t Heightfield::getGridAttribute(int32_t gridX, int32_t gridZ) const
 	else if (gridZ >= (int32_t)m_size)
 		gridZ = (int32_t)m_size - 1;
 
+	if (m_tileCache)
+	{
+		const int32_t tileSize = m_tileCache->getTileSize();
+		Ref< const HeightfieldTile > tile = m_tileCache->getTile(gridX / tileSize, gridZ / tileSize);
+		return tile ? tile->getGridAttribute(gridX % tileSize, gridZ % tileSize) : 0;
+	}
+
 	const int32_t offset = gridX + gridZ * m_size;
 	return m_attributes[offset];
 }
@@ -316,97 +427,452 @@ Vector4 Heightfield::normalAt(float gridX, float gridZ) const
 
 bool Heightfield::queryRay(const Vector4& worldRayOrigin, const Vector4& worldRayDirection, Scalar& outDistance) const
 {
-	const int32_t c_cellSize = 64;
-	const int32_t c_skip = 1;
+	struct Node
+	{
+		int32_t level;
+		int32_t x;
+		int32_t z;
+		float k;
+	};
 
-	Scalar k;
-	Scalar kIn, kOut;
+	updateBounds();
+
+	Node stack[c_maxStack];
+	int32_t depth = 0;
 
-	const Aabb3 boundingBox(-m_worldExtent * 0.5_simd, m_worldExtent * 0.5_simd);
-	if (!boundingBox.intersectRay(worldRayOrigin, worldRayDirection, kIn, kOut))
+	outDistance = Scalar(std::numeric_limits< float >::max());
+
+	Scalar kIn, kOut;
+	const int32_t top = (int32_t)m_levels.size() - 1;
+	if (!getNodeBoundingBox(top, 0, 0).intersectRay(worldRayOrigin, worldRayDirection, kIn, kOut) || kOut < 0.0_simd)
 		return false;
 
+	stack[depth++] = { top, 0, 0, std::max< float >(kIn, 0.0f) };
+
 	bool foundIntersection = false;
+	while (depth > 0)
+	{
+		const Node node = stack[--depth];
+		if (node.k >= outDistance)
+			continue;
 
-	outDistance = Scalar(std::numeric_limits< float >::max());
+		// Trace triangles of tile.
+		if (node.level == 0)
+		{
+			foundIntersection |= traceTile(node.x, node.z, worldRayOrigin, worldRayDirection, outDistance);
+			continue;
+		}
 
-	for (int32_t cz = 0; cz < m_size; cz += c_cellSize)
-	{
-		for (int32_t cx = 0; cx < m_size; cx += c_cellSize)
+		// Push intersecting child nodes, farthest first, so closest child is traced first.
+		const int32_t childLevel = node.level - 1;
+		const int32_t childSize = m_levels[childLevel].size;
+
+		Node children[4];
+		int32_t childCount = 0;
+
+		for (int32_t i = 0; i < 4; ++i)
 		{
-			// Calculate bounding box of cell.
-			float cx1w, cz1w;
-			float cx2w, cz2w;
+			const int32_t cx = node.x * 2 + (i & 1);
+			const int32_t cz = node.z * 2 + (i >> 1);
+			if (cx >= childSize || cz >= childSize)
+				continue;
+
+			if (!getNodeBoundingBox(childLevel, cx, cz).intersectRay(worldRayOrigin, worldRayDirection, kIn, kOut) || kOut < 0.0_simd || kIn >= outDistance)
+				continue;
+
+			children[childCount++] = { childLevel, cx, cz, std::max< float >(kIn, 0.0f) };
+		}
+
+		std::sort(children, children + childCount, [](const Node& lh, const Node& rh) {
+			return lh.k > rh.k;
+		});
 
-			gridToWorld(float(cx), float(cz), cx1w, cz1w);
-			gridToWorld(float(cx + c_cellSize), float(cz + c_cellSize), cx2w, cz2w);
+		for (int32_t i = 0; i < childCount; ++i)
+			stack[depth++] = children[i];
+	}
 
-			float cy1w = std::numeric_limits< float >::max();
-			float cy2w = -std::numeric_limits< float >::max();
+	return foundIntersection;
+}
 
-			for (int32_t iz = cz; iz <= cz + c_cellSize; iz += c_skip)
+void Heightfield::queryRays(const AlignedVector< Ray3 >& worldRays, AlignedVector< float >& outDistances) const
+{
+	updateBounds();
+
+	outDistances.resize(worldRays.size());
+	JobManager::getInstance().parallelFor((int32_t)worldRays.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			Scalar distance;
+			queryRay(worldRays[i].origin, worldRays[i].direction, distance);
+			outDistances[i] = distance;
+		}
+	});
+}
+
+bool Heightfield::queryOverlap(const Aabb3& worldBox) const
+{
+	struct Node
+	{
+		int32_t level;
+		int32_t x;
+		int32_t z;
+	};
+
+	updateBounds();
+
+	// Range of grid quads within box footprint.
+	float gx0, gz0, gx1, gz1;
+	worldToGrid(worldBox.mn.x(), worldBox.mn.z(), gx0, gz0);
+	worldToGrid(worldBox.mx.x(), worldBox.mx.z(), gx1, gz1);
+
+	const int32_t qx0 = std::max((int32_t)std::floor(gx0), 0);
+	const int32_t qz0 = std::max((int32_t)std::floor(gz0), 0);
+	const int32_t qx1 = std::min((int32_t)std::floor(gx1), m_size - 1);
+	const int32_t qz1 = std::min((int32_t)std::floor(gz1), m_size - 1);
+	if (qx0 > qx1 || qz0 > qz1)
+		return false;
+
+	// Box intersect if it's bottom is below highest corner of any quad.
+	const float threshold = worldToUnit(worldBox.mn.y()) * 65535.0f;
+
+	Node stack[c_maxStack];
+	int32_t depth = 0;
+
+	stack[depth++] = { (int32_t)m_levels.size() - 1, 0, 0 };
+	while (depth > 0)
+	{
+		const Node node = stack[--depth];
+
+		const int32_t span = c_tileSize << node.level;
+		const int32_t nx0 = node.x * span;
+		const int32_t nz0 = node.z * span;
+		const int32_t nx1 = std::min(nx0 + span, m_size) - 1;
+		const int32_t nz1 = std::min(nz0 + span, m_size) - 1;
+		if (nx1 < qx0 || nx0 > qx1 || nz1 < qz0 || nz0 > qz1)
+			continue;
+
+		const Level& level = m_levels[node.level];
+		const Bounds& bounds = level.bounds[node.x + node.z * level.size];
+		if (float(bounds.mx) < threshold)
+			continue;
+
+		// All quads of node reach above box bottom.
+		if (float(bounds.mn) >= threshold && nx0 >= qx0 && nx1 <= qx1 && nz0 >= qz0 && nz1 <= qz1)
+			return true;
+
+		if (node.level == 0)
+		{
+			// Read quads within box, including far corners.
+			const int32_t ax0 = std::max(nx0, qx0);
+			const int32_t az0 = std::max(nz0, qz0);
+			const int32_t ax1 = std::min(nx1, qx1);
+			const int32_t az1 = std::min(nz1, qz1);
+			const int32_t w = std::min(ax1 + 1, m_size - 1) - ax0 + 1;
+			const int32_t h = std::min(az1 + 1, m_size - 1) - az0 + 1;
+
+			height_t heights[(c_tileSize + 1) * (c_tileSize + 1)];
+			getHeights(ax0, az0, w, h, heights);
+
+			for (int32_t iz = 0; iz <= az1 - az0; ++iz)
 			{
-				for (int32_t ix = cx; ix <= cx + c_cellSize; ix += c_skip)
+				for (int32_t ix = 0; ix <= ax1 - ax0; ++ix)
 				{
-					const float wy = unitToWorld(getGridHeightNearest(ix, iz));
-					cy1w = std::min(cy1w, wy);
-					cy2w = std::max(cy2w, wy);
+					const int32_t ix1 = std::min(ix + 1, w - 1);
+					const int32_t iz1 = std::min(iz + 1, h - 1);
+					const height_t mx = std::max(
+						std::max(heights[ix + iz * w], heights[ix1 + iz * w]),
+						std::max(heights[ix + iz1 * w], heights[ix1 + iz1 * w])
+					);
+					if (float(mx) >= threshold)
+						return true;
 				}
 			}
+			continue;
+		}
+
+		const int32_t childLevel = node.level - 1;
+		const int32_t childSize = m_levels[childLevel].size;
+		for (int32_t i = 0; i < 4; ++i)
+		{
+			const int32_t cx = node.x * 2 + (i & 1);
+			const int32_t cz = node.z * 2 + (i >> 1);
+			if (cx < childSize && cz < childSize)
+				stack[depth++] = { childLevel, cx, cz };
+		}
+	}
+
+	return false;
+}
+
+void Heightfield::queryOverlaps(const AlignedVector< Aabb3 >& worldBoxes, AlignedVector< bool >& outOverlaps) const
+{
+	updateBounds();
+
+	outOverlaps.resize(worldBoxes.size());
+	JobManager::getInstance().parallelFor((int32_t)worldBoxes.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+			outOverlaps[i] = queryOverlap(worldBoxes[i]);
+	});
+}
+
+void Heightfield::getLeafBounds(AlignedVector< height_t >& outLeafBounds) const
+{
+	updateBounds();
+
+	const Level& level0 = m_levels[0];
+	outLeafBounds.resize(level0.bounds.size() * 2);
+	for (size_t i = 0; i < level0.bounds.size(); ++i)
+	{
+		outLeafBounds[i * 2] = level0.bounds[i].mn;
+		outLeafBounds[i * 2 + 1] = level0.bounds[i].mx;
+	}
+}
+
+height_t Heightfield::getHeight(int32_t gridX, int32_t gridZ) const
+{
+	if (!m_tileCache)
+		return m_heights[gridX + gridZ * m_size];
+
+	const int32_t tileSize = m_tileCache->getTileSize();
+	Ref< const HeightfieldTile > tile = m_tileCache->getTile(gridX / tileSize, gridZ / tileSize);
+	return tile ? tile->getGridHeight(gridX % tileSize, gridZ % tileSize) : 0;
+}
+
+void Heightfield::getHeights(int32_t gridX, int32_t gridZ, int32_t width, int32_t height, height_t* outHeights) const
+{
+	if (!m_tileCache)
+	{
+		for (int32_t z = 0; z < height; ++z)
+		{
+			const height_t* row = &m_heights[gridX + (gridZ + z) * m_size];
+			std::copy(row, row + width, outHeights + z * width);
+		}
+		return;
+	}
+
+	// Block span at most a few tiles; copy overlapping part of each tile.
+	const int32_t tileSize = m_tileCache->getTileSize();
+	for (int32_t tz = gridZ / tileSize; tz <= (gridZ + height - 1) / tileSize; ++tz)
+	{
+		for (int32_t tx = gridX / tileSize; tx <= (gridX + width - 1) / tileSize; ++tx)
+		{
+			Ref< const HeightfieldTile > tile = m_tileCache->getTile(tx, tz);
+
+			const int32_t x0 = std::max(gridX, tx * tileSize);
+			const int32_t z0 = std::max(gridZ, tz * tileSize);
+			const int32_t x1 = std::min(gridX + width, (tx + 1) * tileSize);
+			const int32_t z1 = std::min(gridZ + height, (tz + 1) * tileSize);
+
+			for (int32_t z = z0; z < z1; ++z)
+			{
+				for (int32_t x = x0; x < x1; ++x)
+					outHeights[(x - gridX) + (z - gridZ) * width] = tile ? tile->getGridHeight(x - tx * tileSize, z - tz * tileSize) : 0;
+			}
+		}
+	}
+}
 
-			Aabb3 bb;
-			bb.mn = Vector4(cx1w, cy1w, cz1w, 1.0f);
-			bb.mx = Vector4(cx2w, cy2w, cz2w, 1.0f);
+void Heightfield::invalidateBounds()
+{
+	// Paged heightfields are read-only, keep seeded leaves.
+	if (m_tileCache)
+		return;
+
+	m_allTilesDirty = true;
+	m_boundsDirty = true;
+}
 
-			// Check if ray intersect bounding box; skip tracing triangles if not.
-			if (!bb.intersectRay(worldRayOrigin, worldRayDirection, kIn, kOut))
+void Heightfield::invalidateBounds(int32_t gridX, int32_t gridZ)
+{
+	// Grid point is corner of quads on both sides.
+	const int32_t tileCount = (m_size + c_tileSize - 1) / c_tileSize;
+	const int32_t tx0 = std::max(gridX - 1, 0) / c_tileSize;
+	const int32_t tz0 = std::max(gridZ - 1, 0) / c_tileSize;
+	const int32_t tx1 = std::min(gridX / c_tileSize, tileCount - 1);
+	const int32_t tz1 = std::min(gridZ / c_tileSize, tileCount - 1);
+
+	for (int32_t tz = tz0; tz <= tz1; ++tz)
+	{
+		for (int32_t tx = tx0; tx <= tx1; ++tx)
+			m_dirtyTiles[tx + tz * tileCount] = 1;
+	}
+
+	m_boundsDirty = true;
+}
+
+void Heightfield::allocateBounds() const
+{
+	// Level 0 tiles cover c_tileSize grid quads.
+	int32_t size = (m_size + c_tileSize - 1) / c_tileSize;
+	for (;;)
+	{
+		Level& level = m_levels.push_back();
+		level.size = size;
+		level.bounds.resize(size * size);
+		if (size <= 1)
+			break;
+		size = (size + 1) / 2;
+	}
+}
+
+void Heightfield::updateBounds() const
+{
+	if (!m_boundsDirty)
+		return;
+
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_boundsLock);
+	if (!m_boundsDirty)
+		return;
+
+	if (m_levels.empty())
+	{
+		allocateBounds();
+		m_allTilesDirty = true;
+	}
+
+	// Update edited tiles from grid heights; tiles share corner points with neighbours.
+	Level& level0 = m_levels[0];
+	for (int32_t tz = 0; tz < level0.size; ++tz)
+	{
+		for (int32_t tx = 0; tx < level0.size; ++tx)
+		{
+			const int32_t tile = tx + tz * level0.size;
+			if (!m_allTilesDirty && !m_dirtyTiles[tile])
 				continue;
 
-			// Construct and trace triangles.
-			for (int32_t iz = cz; iz <= cz + c_cellSize; iz += c_skip)
+			const int32_t gx0 = tx * c_tileSize;
+			const int32_t gz0 = tz * c_tileSize;
+			const int32_t gx1 = std::min(gx0 + c_tileSize, m_size - 1);
+			const int32_t gz1 = std::min(gz0 + c_tileSize, m_size - 1);
+			const int32_t count = (gx1 - gx0 + 1) * (gz1 - gz0 + 1);
+
+			height_t heights[(c_tileSize + 1) * (c_tileSize + 1)];
+			getHeights(gx0, gz0, gx1 - gx0 + 1, gz1 - gz0 + 1, heights);
+
+			height_t mn = std::numeric_limits< height_t >::max();
+			height_t mx = 0;
+
+			for (int32_t i = 0; i < count; ++i)
 			{
-				for (int32_t ix = cx; ix <= cx + c_cellSize; ix += c_skip)
+				mn = std::min(mn, heights[i]);
+				mx = std::max(mx, heights[i]);
+			}
+
+			level0.bounds[tile] = { mn, mx };
+			m_dirtyTiles[tile] = 0;
+		}
+	}
+
+	// Update upper levels from levels below.
+	for (size_t i = 1; i < m_levels.size(); ++i)
+	{
+		const Level& child = m_levels[i - 1];
+		Level& level = m_levels[i];
+
+		for (int32_t z = 0; z < level.size; ++z)
+		{
+			for (int32_t x = 0; x < level.size; ++x)
+			{
+				Bounds bounds = child.bounds[x * 2 + z * 2 * child.size];
+				for (int32_t j = 1; j < 4; ++j)
 				{
-					float x1w, z1w;
-					float x2w, z2w;
-
-					gridToWorld(float(ix), float(iz), x1w, z1w);
-					gridToWorld(float(ix + c_skip), float(iz + c_skip), x2w, z2w);
-
-					float yw[] =
-					{
-						unitToWorld(getGridHeightNearest(ix, iz)),
-						unitToWorld(getGridHeightNearest(ix + c_skip, iz)),
-						unitToWorld(getGridHeightNearest(ix, iz + c_skip)),
-						unitToWorld(getGridHeightNearest(ix + c_skip, iz + c_skip))
-					};
-
-					const Vector4 vw[] =
-					{
-						Vector4(x1w, yw[0], z1w, 1.0f),
-						Vector4(x2w, yw[1], z1w, 1.0f),
-						Vector4(x1w, yw[2], z2w, 1.0f),
-						Vector4(x2w, yw[3], z2w, 1.0f)
-					};
-
-					if (Winding3(vw[0], vw[1], vw[2]).rayIntersection(worldRayOrigin, worldRayDirection, k))
-					{
-						if (k < outDistance)
-						{
-							outDistance = k;
-							foundIntersection = true;
-						}
-					}
-
-					if (Winding3(vw[1], vw[3], vw[2]).rayIntersection(worldRayOrigin, worldRayDirection, k))
-					{
-						if (k < outDistance)
-						{
-							outDistance = k;
-							foundIntersection = true;
-						}
-					}
+					const int32_t cx = x * 2 + (j & 1);
+					const int32_t cz = z * 2 + (j >> 1);
+					if (cx >= child.size || cz >= child.size)
+						continue;
+
+					const Bounds& cb = child.bounds[cx + cz * child.size];
+					bounds.mn = std::min(bounds.mn, cb.mn);
+					bounds.mx = std::max(bounds.mx, cb.mx);
 				}
+				level.bounds[x + z * level.size] = bounds;
+			}
+		}
+	}
+
+	m_allTilesDirty = false;
+	m_boundsDirty = false;
+}
+
+Aabb3 Heightfield::getNodeBoundingBox(int32_t level, int32_t x, int32_t z) const
+{
+	const int32_t span = c_tileSize << level;
+	const int32_t gx0 = x * span;
+	const int32_t gz0 = z * span;
+	const int32_t gx1 = std::min(gx0 + span, m_size);
+	const int32_t gz1 = std::min(gz0 + span, m_size);
+
+	float x0w, z0w, x1w, z1w;
+	gridToWorld(gx0, gz0, x0w, z0w);
+	gridToWorld(gx1, gz1, x1w, z1w);
+
+	// Pad height range with one unit as flat boxes might be missed by rays.
+	const Bounds& bounds = m_levels[level].bounds[x + z * m_levels[level].size];
+	const float pad = m_worldExtentFloats[1] / 65535.0f;
+
+	return Aabb3(
+		Vector4(x0w, unitToWorld(bounds.mn / 65535.0f) - pad, z0w, 1.0f),
+		Vector4(x1w, unitToWorld(bounds.mx / 65535.0f) + pad, z1w, 1.0f)
+	);
+}
+
+bool Heightfield::traceTile(int32_t x, int32_t z, const Vector4& worldRayOrigin, const Vector4& worldRayDirection, Scalar& inOutDistance) const
+{
+	const int32_t gx0 = x * c_tileSize;
+	const int32_t gz0 = z * c_tileSize;
+	const int32_t gx1 = std::min(gx0 + c_tileSize, m_size);
+	const int32_t gz1 = std::min(gz0 + c_tileSize, m_size);
+
+	// Read corners of all quads in tile at once; corners past last grid point are clamped.
+	const int32_t w = std::min(gx1, m_size - 1) - gx0 + 1;
+	const int32_t h = std::min(gz1, m_size - 1) - gz0 + 1;
+
+	height_t heights[(c_tileSize + 1) * (c_tileSize + 1)];
+	getHeights(gx0, gz0, w, h, heights);
+
+	const auto unitHeight = [&](int32_t ix, int32_t iz) {
+		return heights[std::min(ix - gx0, w - 1) + std::min(iz - gz0, h - 1) * w] / 65535.0f;
+	};
+
+	bool foundIntersection = false;
+	Scalar k;
+
+	for (int32_t iz = gz0; iz < gz1; ++iz)
+	{
+		for (int32_t ix = gx0; ix < gx1; ++ix)
+		{
+			float x1w, z1w;
+			float x2w, z2w;
+
+			gridToWorld(ix, iz, x1w, z1w);
+			gridToWorld(ix + 1, iz + 1, x2w, z2w);
+
+			const float yw[] =
+			{
+				unitToWorld(unitHeight(ix, iz)),
+				unitToWorld(unitHeight(ix + 1, iz)),
+				unitToWorld(unitHeight(ix, iz + 1)),
+				unitToWorld(unitHeight(ix + 1, iz + 1))
+			};
+
+			const Vector4 vw[] =
+			{
+				Vector4(x1w, yw[0], z1w, 1.0f),
+				Vector4(x2w, yw[1], z1w, 1.0f),
+				Vector4(x1w, yw[2], z2w, 1.0f),
+				Vector4(x2w, yw[3], z2w, 1.0f)
+			};
+
+			if (rayTriangle(worldRayOrigin, worldRayDirection, vw[0], vw[1], vw[2], k) && k < inOutDistance)
+			{
+				inOutDistance = k;
+				foundIntersection = true;
+			}
+
+			if (rayTriangle(worldRayOrigin, worldRayDirection, vw[1], vw[3], vw[2], k) && k < inOutDistance)
+			{
+				inOutDistance = k;
+				foundIntersection = true;
 			}
 		}
 	}
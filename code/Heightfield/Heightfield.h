@@ -8,9 +8,15 @@
  */
 #pragma once
 
+#include <atomic>
 #include "Core/Object.h"
+#include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Math/Aabb3.h"
+#include "Core/Math/Ray3.h"
 #include "Core/Math/Vector4.h"
 #include "Core/Misc/AutoPtr.h"
+#include "Core/Thread/Semaphore.h"
 #include "Heightfield/HeightfieldTypes.h"
 
 // import/export mechanism.
@@ -24,19 +30,54 @@
 namespace traktor::hf
 {
 
+class HeightfieldTileCache;
+
 /*!
  * \ingroup Heightfield
+ *
+ * Spatial queries are accelerated by a min/max height
+ * pyramid; the pyramid is built lazily by first query after
+ * heightfield has been created or edited and only edited
+ * tiles are rebuilt.
+ *
+ * A paged heightfield reads heights, cuts and attributes
+ * through a tile cache instead of keeping the entire grid
+ * resident; paged heightfields are read-only.
  */
 class T_DLLCLASS Heightfield : public Object
 {
 	T_RTTI_CLASS;
 
 public:
+	/*! Number of grid quads along each side of a pyramid leaf. */
+	static constexpr int32_t BoundsTileSize = 8;
+
 	explicit Heightfield(
 		int32_t size,
 		const Vector4& worldExtent
 	);
 
+	/*! Create paged heightfield.
+	 *
+	 * \param size Size of heightfield.
+	 * \param worldExtent Heightfield world extent.
+	 * \param tileCache Cache of tiles.
+	 * \param leafBounds Min and max height of each pyramid leaf, if empty then leaves are calculated from tiles on first query.
+	 */
+	explicit Heightfield(
+		int32_t size,
+		const Vector4& worldExtent,
+		HeightfieldTileCache* tileCache,
+		const AlignedVector< height_t >& leafBounds
+	);
+
+	/*! Stream in tiles around a point, no-op if heightfield is resident.
+	 *
+	 * \param worldCenter Center in world space.
+	 * \param worldRadius Radius in world units.
+	 */
+	void prefetch(const Vector4& worldCenter, float worldRadius) const;
+
 	void setGridHeight(int32_t gridX, int32_t gridZ, float unitY);
 
 	void setGridCut(int32_t gridX, int32_t gridZ, bool cut);
@@ -47,6 +88,12 @@ public:
 
 	float getGridHeightBilinear(float gridX, float gridZ) const;
 
+	/*! Read block of heights, each tile of a paged heightfield is only fetched once.
+	 *
+	 * \param outHeights Heights of block, row by row, must be at least width * height.
+	 */
+	void getHeights(int32_t gridX, int32_t gridZ, int32_t width, int32_t height, height_t* outHeights) const;
+
 	float getWorldHeight(float worldX, float worldZ) const;
 
 	bool getGridCut(int32_t gridX, int32_t gridZ) const;
@@ -75,11 +122,44 @@ public:
 
 	bool queryRay(const Vector4& worldRayOrigin, const Vector4& worldRayDirection, Scalar& outDistance) const;
 
+	/*! Cast batch of rays.
+	 *
+	 * \param worldRays Rays in world space.
+	 * \param outDistances Distance to closest intersection of each ray, max float if ray didn't intersect.
+	 */
+	void queryRays(const AlignedVector< Ray3 >& worldRays, AlignedVector< float >& outDistances) const;
+
+	/*! Check if box intersect volume below heightfield surface.
+	 *
+	 * Each grid quad is considered solid up to it's highest corner.
+	 *
+	 * \param worldBox Box in world space.
+	 * \return True if box intersect.
+	 */
+	bool queryOverlap(const Aabb3& worldBox) const;
+
+	/*! Check if batch of boxes intersect volume below heightfield surface.
+	 *
+	 * \param worldBoxes Boxes in world space.
+	 * \param outOverlaps True for each box which intersect.
+	 */
+	void queryOverlaps(const AlignedVector< Aabb3 >& worldBoxes, AlignedVector< bool >& outOverlaps) const;
+
+	/*! Get min and max height of each pyramid leaf.
+	 *
+	 * \param outLeafBounds Min and max height pairs, row by row, leaves cover BoundsTileSize grid quads.
+	 */
+	void getLeafBounds(AlignedVector< height_t >& outLeafBounds) const;
+
 	int32_t getSize() const { return m_size; }
 
 	const Vector4& getWorldExtent() const { return m_worldExtent; }
 
-	height_t* getHeights() { return m_heights.ptr(); }
+	/*! Get tile cache, null if heightfield is resident. */
+	HeightfieldTileCache* getTileCache() const { return m_tileCache; }
+
+	/*! Resident heights, null if heightfield is paged. */
+	height_t* getHeights() { invalidateBounds(); return m_heights.ptr(); }
 
 	const height_t* getHeights() const { return m_heights.c_ptr(); }
 
@@ -98,6 +178,41 @@ private:
 	AutoArrayPtr< height_t > m_heights;
 	AutoArrayPtr< uint8_t > m_cuts;
 	AutoArrayPtr< uint8_t > m_attributes;
+	Ref< HeightfieldTileCache > m_tileCache;
+
+	/*! Height bounds of a pyramid node. */
+	struct Bounds
+	{
+		height_t mn;
+		height_t mx;
+	};
+
+	/*! Pyramid level, each node cover 2x2 nodes of level below. */
+	struct Level
+	{
+		int32_t size;
+		AlignedVector< Bounds > bounds;
+	};
+
+	mutable AlignedVector< Level > m_levels;
+	mutable AlignedVector< uint8_t > m_dirtyTiles;
+	mutable std::atomic< bool > m_boundsDirty;
+	mutable bool m_allTilesDirty;
+	mutable Semaphore m_boundsLock;
+
+	height_t getHeight(int32_t gridX, int32_t gridZ) const;
+
+	void invalidateBounds();
+
+	void invalidateBounds(int32_t gridX, int32_t gridZ);
+
+	void allocateBounds() const;
+
+	void updateBounds() const;
+
+	Aabb3 getNodeBoundingBox(int32_t level, int32_t x, int32_t z) const;
+
+	bool traceTile(int32_t x, int32_t z, const Vector4& worldRayOrigin, const Vector4& worldRayDirection, Scalar& inOutDistance) const;
 };
 
 }
@@ -15,9 +15,20 @@
 
 namespace traktor::hf
 {
+	namespace
+	{
+
+const int32_t c_maxResidentTiles = 1024;	//!< About 16 MiB of 64x64 tiles.
+
+	}
 
 T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.hf.HeightfieldFactory", 0, HeightfieldFactory, resource::IResourceFactory)
 
+HeightfieldFactory::HeightfieldFactory(bool editable)
+:	m_editable(editable)
+{
+}
+
 bool HeightfieldFactory::initialize(const ObjectStore& objectStore)
 {
 	return true;
@@ -48,9 +59,17 @@ Ref< Object > HeightfieldFactory::create(resource::IResourceManager* resourceMan
 	if (!stream)
 		return nullptr;
 
-	Ref< Heightfield > heightfield = HeightfieldFormat().read(stream, resource->getWorldExtent());
+	// Editable heightfields must be resident.
+	Ref< Heightfield > heightfield;
+	if (m_editable)
+		heightfield = HeightfieldFormat().read(stream, resource->getWorldExtent());
+	else
+		heightfield = HeightfieldFormat().readPaged(stream, resource->getWorldExtent(), c_maxResidentTiles);
+
+	// Paged heightfield keep reading tiles from stream.
+	if (!heightfield || !heightfield->getTileCache())
+		stream->close();
 
-	stream->close();
 	return heightfield;
 }
 
@@ -23,12 +23,19 @@ namespace traktor::hf
 
 /*!
  * \ingroup Heightfield
+ *
+ * Tiled heightfields are paged unless factory is
+ * created for editing.
  */
 class T_DLLCLASS HeightfieldFactory : public resource::IResourceFactory
 {
 	T_RTTI_CLASS;
 
 public:
+	HeightfieldFactory() = default;
+
+	explicit HeightfieldFactory(bool editable);
+
 	virtual bool initialize(const ObjectStore& objectStore) override final;
 
 	virtual const TypeInfoSet getResourceTypes() const override final;
@@ -38,6 +45,9 @@ public:
 	virtual bool isCacheable(const TypeInfo& productType) const override final;
 
 	virtual Ref< Object > create(resource::IResourceManager* resourceManager, const db::Database* database, const db::Instance* instance, const TypeInfo& productType, const Object* current) const override final;
+
+private:
+	bool m_editable = false;
 };
 
 }
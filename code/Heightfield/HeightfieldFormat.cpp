@@ -10,8 +10,11 @@
 #include "Core/Io/IStream.h"
 #include "Core/Io/Reader.h"
 #include "Core/Io/Writer.h"
+#include "Core/Thread/JobManager.h"
 #include "Heightfield/Heightfield.h"
 #include "Heightfield/HeightfieldFormat.h"
+#include "Heightfield/HeightfieldTile.h"
+#include "Heightfield/HeightfieldTileCache.h"
 
 namespace traktor::hf
 {
@@ -19,6 +22,104 @@ namespace traktor::hf
 	{
 
 const int32_t c_version = 2;
+const int32_t c_versionTiled = 3;
+const int32_t c_versionTiledBounds = 4;	//!< Tiled with height range of each pyramid leaf.
+
+/*! Read tile table of tiled data, return stream offset of each tile and leaf bounds if available. */
+bool readTileOffsets(IStream* stream, int32_t version, int32_t& outSize, int32_t& outTileSize, AlignedVector< int64_t >& outTileOffsets, AlignedVector< height_t >& outLeafBounds)
+{
+	int32_t boundsTileSize = 0;
+
+	Reader(stream) >> outSize;
+	Reader(stream) >> outTileSize;
+	if (version >= c_versionTiledBounds)
+		Reader(stream) >> boundsTileSize;
+	if (outSize <= 0 || outTileSize <= 0)
+		return false;
+
+	const int32_t tileCount = (outSize + outTileSize - 1) / outTileSize;
+
+	AlignedVector< uint32_t > offsets(tileCount * tileCount + 1);
+	if (Reader(stream).read(offsets.ptr(), offsets.size(), sizeof(uint32_t)) != (int64_t)(offsets.size() * sizeof(uint32_t)))
+		return false;
+
+	if (boundsTileSize > 0)
+	{
+		const int32_t leafCount = (outSize + boundsTileSize - 1) / boundsTileSize;
+		outLeafBounds.resize(leafCount * leafCount * 2);
+		if (Reader(stream).read(outLeafBounds.ptr(), outLeafBounds.size(), sizeof(height_t)) != (int64_t)(outLeafBounds.size() * sizeof(height_t)))
+			return false;
+
+		// Leaves written with another size cannot seed pyramid.
+		if (boundsTileSize != Heightfield::BoundsTileSize)
+			outLeafBounds.resize(0);
+	}
+
+	const int64_t base = stream->tell();
+	outTileOffsets.resize(offsets.size());
+	for (size_t i = 0; i < offsets.size(); ++i)
+		outTileOffsets[i] = base + offsets[i];
+
+	return true;
+}
+
+/*! Read and decode all tiles of tiled data into a resident heightfield. */
+Ref< Heightfield > readTiled(IStream* stream, int32_t version, const Vector4& worldExtent)
+{
+	int32_t size, tileSize;
+	AlignedVector< int64_t > tileOffsets;
+	AlignedVector< height_t > leafBounds;
+	if (!readTileOffsets(stream, version, size, tileSize, tileOffsets, leafBounds))
+		return nullptr;
+
+	Ref< Heightfield > heightfield = new Heightfield(
+		size,
+		worldExtent
+	);
+
+	height_t* heights = heightfield->getHeights();
+	uint8_t* cuts = heightfield->getCuts();
+	uint8_t* attributes = heightfield->getAttributes();
+
+	std::memset(cuts, 0, size * size / 8);
+
+	// Tiles are stored in order so no need to seek.
+	const int32_t tileCount = (size + tileSize - 1) / tileSize;
+	AlignedVector< uint8_t > data;
+	for (int32_t tz = 0; tz < tileCount; ++tz)
+	{
+		for (int32_t tx = 0; tx < tileCount; ++tx)
+		{
+			const int32_t tile = tx + tz * tileCount;
+			const int64_t dataSize = tileOffsets[tile + 1] - tileOffsets[tile];
+
+			data.resize(dataSize);
+			if (Reader(stream).read(data.ptr(), dataSize) != dataSize)
+				return nullptr;
+
+			HeightfieldTile decoded(
+				std::min(tileSize, size - tx * tileSize),
+				std::min(tileSize, size - tz * tileSize)
+			);
+			if (!decoded.decode(data.c_ptr(), (uint32_t)dataSize))
+				return nullptr;
+
+			for (int32_t z = 0; z < decoded.getHeight(); ++z)
+			{
+				for (int32_t x = 0; x < decoded.getWidth(); ++x)
+				{
+					const int32_t offset = (tx * tileSize + x) + (tz * tileSize + z) * size;
+					heights[offset] = decoded.getGridHeight(x, z);
+					attributes[offset] = decoded.getGridAttribute(x, z);
+					if (decoded.getGridCut(x, z))
+						cuts[offset / 8] |= (1 << (offset & 7));
+				}
+			}
+		}
+	}
+
+	return heightfield;
+}
 
 	}
 
@@ -29,6 +130,13 @@ Ref< Heightfield > HeightfieldFormat::read(IStream* stream, const Vector4& world
 	int32_t version;
 	Reader(stream) >> version;
 
+	if (version == c_versionTiled || version == c_versionTiledBounds)
+	{
+		Ref< Heightfield > heightfield = readTiled(stream, version, worldExtent);
+		stream->close();
+		return heightfield;
+	}
+
 	if (version != 1 && version != 2)
 		return 0;
 
@@ -59,6 +167,36 @@ Ref< Heightfield > HeightfieldFormat::read(IStream* stream, const Vector4& world
 	return heightfield;
 }
 
+Ref< Heightfield > HeightfieldFormat::readPaged(IStream* stream, const Vector4& worldExtent, int32_t maxResidentTiles) const
+{
+	if (!stream->canSeek())
+		return read(stream, worldExtent);
+
+	const int64_t start = stream->tell();
+
+	int32_t version;
+	Reader(stream) >> version;
+
+	if (version != c_versionTiled && version != c_versionTiledBounds)
+	{
+		stream->seek(IStream::SeekSet, start);
+		return read(stream, worldExtent);
+	}
+
+	int32_t size, tileSize;
+	AlignedVector< int64_t > tileOffsets;
+	AlignedVector< height_t > leafBounds;
+	if (!readTileOffsets(stream, version, size, tileSize, tileOffsets, leafBounds))
+		return nullptr;
+
+	return new Heightfield(
+		size,
+		worldExtent,
+		new HeightfieldTileCache(stream, size, tileSize, tileOffsets, maxResidentTiles),
+		leafBounds
+	);
+}
+
 bool HeightfieldFormat::write(IStream* stream, const Heightfield* heightfield) const
 {
 	Writer(stream) << int32_t(c_version);
@@ -85,4 +223,53 @@ bool HeightfieldFormat::write(IStream* stream, const Heightfield* heightfield) c
 	return true;
 }
 
+bool HeightfieldFormat::writeTiled(IStream* stream, const Heightfield* heightfield, int32_t tileSize) const
+{
+	const int32_t size = heightfield->getSize();
+	const int32_t tileCount = (size + tileSize - 1) / tileSize;
+
+	// Encode tiles in parallel.
+	AlignedVector< AlignedVector< uint8_t > > tiles(tileCount * tileCount);
+	JobManager::getInstance().parallelFor(tileCount * tileCount, 1, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const int32_t tx = i % tileCount;
+			const int32_t tz = i / tileCount;
+			HeightfieldTile::encode(
+				heightfield,
+				tx * tileSize,
+				tz * tileSize,
+				std::min(tileSize, size - tx * tileSize),
+				std::min(tileSize, size - tz * tileSize),
+				tiles[i]
+			);
+		}
+	});
+
+	// Offset of each tile from end of tile table.
+	AlignedVector< uint32_t > offsets(tiles.size() + 1);
+	offsets[0] = 0;
+	for (size_t i = 0; i < tiles.size(); ++i)
+		offsets[i + 1] = offsets[i] + (uint32_t)tiles[i].size();
+
+	// Height range of pyramid leaves so paged heightfield can be queried without decoding all tiles.
+	AlignedVector< height_t > leafBounds;
+	heightfield->getLeafBounds(leafBounds);
+
+	Writer(stream) << int32_t(c_versionTiledBounds);
+	Writer(stream) << int32_t(size);
+	Writer(stream) << int32_t(tileSize);
+	Writer(stream) << int32_t(Heightfield::BoundsTileSize);
+	Writer(stream).write(offsets.c_ptr(), offsets.size(), sizeof(uint32_t));
+	Writer(stream).write(leafBounds.c_ptr(), leafBounds.size(), sizeof(height_t));
+
+	for (const auto& tile : tiles)
+	{
+		if (Writer(stream).write(tile.c_ptr(), tile.size()) != (int64_t)tile.size())
+			return false;
+	}
+
+	return true;
+}
+
 }
@@ -20,6 +20,13 @@
 #	define T_DLLCLASS T_DLLIMPORT
 #endif
 
+namespace traktor
+{
+
+class IStream;
+
+}
+
 namespace traktor::hf
 {
 
@@ -27,15 +34,41 @@ class Heightfield;
 
 /*!
  * \ingroup Heightfield
+ *
+ * Heightfields are either written as a single resident
+ * grid or as compressed tiles which can be paged in
+ * on demand.
  */
 class T_DLLCLASS HeightfieldFormat : public Object
 {
 	T_RTTI_CLASS;
 
 public:
+	/*! Read entire heightfield, tiled data is decoded into a resident heightfield. */
 	Ref< Heightfield > read(IStream* stream, const Vector4& worldExtent) const;
 
+	/*! Read paged heightfield.
+	 *
+	 * Stream is kept open by paged heightfield; if data isn't
+	 * tiled or stream isn't seekable then entire heightfield
+	 * is read into memory.
+	 *
+	 * \param stream Heightfield data stream.
+	 * \param worldExtent Heightfield world extent.
+	 * \param maxResidentTiles Maximum number of decoded tiles in memory.
+	 * \return Heightfield.
+	 */
+	Ref< Heightfield > readPaged(IStream* stream, const Vector4& worldExtent, int32_t maxResidentTiles) const;
+
 	bool write(IStream* stream, const Heightfield* heightfield) const;
+
+	/*! Write heightfield as compressed tiles.
+	 *
+	 * Height range of each pyramid leaf is written as well so
+	 * spatial queries on a paged heightfield only decode tiles
+	 * which are traced.
+	 */
+	bool writeTiled(IStream* stream, const Heightfield* heightfield, int32_t tileSize = 64) const;
 };
 
 }
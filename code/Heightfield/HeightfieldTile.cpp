@@ -0,0 +1,296 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cstring>
+#include "Heightfield/Heightfield.h"
+#include "Heightfield/HeightfieldTile.h"
+
+namespace traktor::hf
+{
+	namespace
+	{
+
+const uint32_t c_maxUnary = 24;		//!< Quotients this large are escaped and written raw.
+const uint32_t c_rawBits = 17;		//!< Bits of zig-zag encoded residual.
+const uint32_t c_resetCount = 64;	//!< Halve adaptive statistics after this many samples.
+
+class BitWriter
+{
+public:
+	explicit BitWriter(AlignedVector< uint8_t >& data)
+	:	m_data(data)
+	{
+	}
+
+	void write(uint32_t value, uint32_t bits)
+	{
+		for (int32_t i = int32_t(bits) - 1; i >= 0; --i)
+			writeBit((value >> i) & 1);
+	}
+
+	void writeBit(uint32_t bit)
+	{
+		m_current = (m_current << 1) | bit;
+		if (++m_count >= 8)
+		{
+			m_data.push_back((uint8_t)m_current);
+			m_current = 0;
+			m_count = 0;
+		}
+	}
+
+	void flush()
+	{
+		while (m_count > 0)
+			writeBit(0);
+	}
+
+private:
+	AlignedVector< uint8_t >& m_data;
+	uint32_t m_current = 0;
+	uint32_t m_count = 0;
+};
+
+class BitReader
+{
+public:
+	explicit BitReader(const uint8_t* data, uint32_t dataSize)
+	:	m_data(data)
+	,	m_dataSize(dataSize)
+	{
+	}
+
+	uint32_t read(uint32_t bits)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < bits; ++i)
+			value = (value << 1) | readBit();
+		return value;
+	}
+
+	uint32_t readBit()
+	{
+		const uint32_t byte = m_position >> 3;
+		if (byte >= m_dataSize)
+		{
+			m_overrun = true;
+			return 0;
+		}
+		const uint32_t bit = (m_data[byte] >> (7 - (m_position & 7))) & 1;
+		++m_position;
+		return bit;
+	}
+
+	bool overrun() const { return m_overrun; }
+
+private:
+	const uint8_t* m_data;
+	uint32_t m_dataSize;
+	uint32_t m_position = 0;
+	bool m_overrun = false;
+};
+
+/*! Adaptive Rice parameter from mean of previous residuals. */
+class RiceContext
+{
+public:
+	uint32_t k() const
+	{
+		uint32_t k = 0;
+		while ((m_count << k) < m_sum && k < c_rawBits)
+			++k;
+		return k;
+	}
+
+	void update(uint32_t value)
+	{
+		m_sum += value;
+		if (++m_count >= c_resetCount)
+		{
+			m_sum >>= 1;
+			m_count >>= 1;
+		}
+	}
+
+private:
+	uint32_t m_sum = 4;
+	uint32_t m_count = 1;
+};
+
+/*! Median edge predictor, picks left or top neighbour at edges else plane through neighbours. */
+int32_t predict(const height_t* heights, int32_t width, int32_t x, int32_t z)
+{
+	if (x == 0 && z == 0)
+		return 32768;
+	else if (z == 0)
+		return heights[x - 1];
+	else if (x == 0)
+		return heights[(z - 1) * width];
+
+	const int32_t a = heights[x - 1 + z * width];
+	const int32_t b = heights[x + (z - 1) * width];
+	const int32_t c = heights[x - 1 + (z - 1) * width];
+
+	if (c >= std::max(a, b))
+		return std::min(a, b);
+	else if (c <= std::min(a, b))
+		return std::max(a, b);
+	else
+		return a + b - c;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.hf.HeightfieldTile", HeightfieldTile, Object)
+
+HeightfieldTile::HeightfieldTile(int32_t width, int32_t height)
+:	m_width(width)
+,	m_height(height)
+{
+	m_heights.resize(width * height, 0);
+	m_cuts.resize((width * height + 7) / 8, 0);
+	m_attributes.resize(width * height, 0);
+}
+
+void HeightfieldTile::encode(const Heightfield* heightfield, int32_t gridX, int32_t gridZ, int32_t width, int32_t height, AlignedVector< uint8_t >& outData)
+{
+	HeightfieldTile tile(width, height);
+	bool uniformCut = true;
+	bool uniformAttribute = true;
+
+	for (int32_t z = 0; z < height; ++z)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			const int32_t offset = x + z * width;
+			tile.m_heights[offset] = heightfield->getHeights()[(gridX + x) + (gridZ + z) * heightfield->getSize()];
+			tile.m_attributes[offset] = heightfield->getGridAttribute(gridX + x, gridZ + z);
+			if (heightfield->getGridCut(gridX + x, gridZ + z))
+				tile.m_cuts[offset / 8] |= (1 << (offset & 7));
+			uniformCut &= (tile.getGridCut(x, z) == tile.getGridCut(0, 0));
+			uniformAttribute &= (tile.m_attributes[offset] == tile.m_attributes[0]);
+		}
+	}
+
+	outData.resize(0);
+
+	// Cuts, single bit if uniform.
+	outData.push_back(uniformCut ? 0 : 1);
+	if (uniformCut)
+		outData.push_back(tile.getGridCut(0, 0) ? 0xff : 0x00);
+	else
+		outData.insert(outData.end(), tile.m_cuts.begin(), tile.m_cuts.end());
+
+	// Attributes, single value if uniform.
+	outData.push_back(uniformAttribute ? 0 : 1);
+	if (uniformAttribute)
+		outData.push_back(tile.m_attributes[0]);
+	else
+		outData.insert(outData.end(), tile.m_attributes.begin(), tile.m_attributes.end());
+
+	// Heights, zig-zag encoded prediction residuals as Rice codes.
+	BitWriter bw(outData);
+	RiceContext context;
+
+	for (int32_t z = 0; z < height; ++z)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			const int32_t residual = int32_t(tile.m_heights[x + z * width]) - predict(tile.m_heights.c_ptr(), width, x, z);
+			const uint32_t value = residual >= 0 ? uint32_t(residual) << 1 : (uint32_t(-residual) << 1) - 1;
+
+			const uint32_t k = context.k();
+			const uint32_t q = value >> k;
+
+			if (q < c_maxUnary)
+			{
+				for (uint32_t i = 0; i < q; ++i)
+					bw.writeBit(1);
+				bw.writeBit(0);
+				bw.write(value & ((1 << k) - 1), k);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < c_maxUnary; ++i)
+					bw.writeBit(1);
+				bw.write(value, c_rawBits);
+			}
+
+			context.update(value);
+		}
+	}
+
+	bw.flush();
+}
+
+bool HeightfieldTile::decode(const uint8_t* data, uint32_t dataSize)
+{
+	const uint32_t cutsSize = (uint32_t)m_cuts.size();
+	const uint32_t attributesSize = (uint32_t)m_attributes.size();
+	uint32_t offset = 0;
+
+	// Cuts.
+	if (offset >= dataSize)
+		return false;
+	if (data[offset++] != 0)
+	{
+		if (offset + cutsSize > dataSize)
+			return false;
+		std::memcpy(m_cuts.ptr(), data + offset, cutsSize);
+		offset += cutsSize;
+	}
+	else
+	{
+		if (offset >= dataSize)
+			return false;
+		std::memset(m_cuts.ptr(), data[offset++], cutsSize);
+	}
+
+	// Attributes.
+	if (offset >= dataSize)
+		return false;
+	if (data[offset++] != 0)
+	{
+		if (offset + attributesSize > dataSize)
+			return false;
+		std::memcpy(m_attributes.ptr(), data + offset, attributesSize);
+		offset += attributesSize;
+	}
+	else
+	{
+		if (offset >= dataSize)
+			return false;
+		std::memset(m_attributes.ptr(), data[offset++], attributesSize);
+	}
+
+	// Heights.
+	BitReader br(data + offset, dataSize - offset);
+	RiceContext context;
+
+	for (int32_t z = 0; z < m_height; ++z)
+	{
+		for (int32_t x = 0; x < m_width; ++x)
+		{
+			const uint32_t k = context.k();
+
+			uint32_t q = 0;
+			while (q < c_maxUnary && br.readBit() != 0)
+				++q;
+
+			const uint32_t value = (q < c_maxUnary) ? (q << k) | br.read(k) : br.read(c_rawBits);
+			const int32_t residual = (value & 1) ? -int32_t((value + 1) >> 1) : int32_t(value >> 1);
+
+			m_heights[x + z * m_width] = height_t(predict(m_heights.c_ptr(), m_width, x, z) + residual);
+			context.update(value);
+		}
+	}
+
+	return !br.overrun();
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/Object.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Heightfield/HeightfieldTypes.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_HEIGHTFIELD_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::hf
+{
+
+class Heightfield;
+
+/*! Decoded rectangular region of a tiled heightfield.
+ * \ingroup Heightfield
+ *
+ * Heights are stored as residuals of a median edge
+ * predictor, entropy coded with adaptive Rice codes.
+ * Cuts and attributes are stored raw unless uniform
+ * over entire tile.
+ */
+class T_DLLCLASS HeightfieldTile : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	explicit HeightfieldTile(int32_t width, int32_t height);
+
+	/*! Encode region of heightfield.
+	 *
+	 * \param heightfield Resident heightfield.
+	 * \param gridX Left grid coordinate of region.
+	 * \param gridZ Top grid coordinate of region.
+	 * \param width Width of region.
+	 * \param height Height of region.
+	 * \param outData Encoded region.
+	 */
+	static void encode(const Heightfield* heightfield, int32_t gridX, int32_t gridZ, int32_t width, int32_t height, AlignedVector< uint8_t >& outData);
+
+	/*! Decode tile from encoded data. */
+	bool decode(const uint8_t* data, uint32_t dataSize);
+
+	int32_t getWidth() const { return m_width; }
+
+	int32_t getHeight() const { return m_height; }
+
+	height_t getGridHeight(int32_t x, int32_t z) const { return m_heights[x + z * m_width]; }
+
+	bool getGridCut(int32_t x, int32_t z) const { const int32_t offset = x + z * m_width; return (m_cuts[offset / 8] & (1 << (offset & 7))) != 0; }
+
+	uint8_t getGridAttribute(int32_t x, int32_t z) const { return m_attributes[x + z * m_width]; }
+
+private:
+	int32_t m_width;
+	int32_t m_height;
+	AlignedVector< height_t > m_heights;
+	AlignedVector< uint8_t > m_cuts;
+	AlignedVector< uint8_t > m_attributes;
+};
+
+}
@@ -0,0 +1,173 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Io/IStream.h"
+#include "Core/Log/Log.h"
+#include "Core/Thread/Acquire.h"
+#include "Core/Thread/JobManager.h"
+#include "Heightfield/HeightfieldTile.h"
+#include "Heightfield/HeightfieldTileCache.h"
+
+namespace traktor::hf
+{
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.hf.HeightfieldTileCache", HeightfieldTileCache, Object)
+
+HeightfieldTileCache::HeightfieldTileCache(IStream* stream, int32_t size, int32_t tileSize, const AlignedVector< int64_t >& tileOffsets, int32_t maxResidentTiles)
+:	m_stream(stream)
+,	m_size(size)
+,	m_tileSize(tileSize)
+,	m_tileCount((size + tileSize - 1) / tileSize)
+,	m_maxResidentTiles(std::max(maxResidentTiles, 1))
+,	m_tileOffsets(tileOffsets)
+,	m_decodeCount(0)
+{
+	T_FATAL_ASSERT(m_tileOffsets.size() == (size_t)(m_tileCount * m_tileCount + 1));
+	m_tiles.resize(m_tileCount * m_tileCount);
+	m_lastUsed.resize(m_tileCount * m_tileCount, 0);
+}
+
+HeightfieldTileCache::~HeightfieldTileCache()
+{
+	if (m_prefetchJob)
+	{
+		m_prefetchJob->wait();
+		m_prefetchJob = nullptr;
+	}
+	if (m_stream)
+	{
+		m_stream->close();
+		m_stream = nullptr;
+	}
+}
+
+Ref< const HeightfieldTile > HeightfieldTileCache::getTile(int32_t tileX, int32_t tileZ)
+{
+	const int32_t tile = tileX + tileZ * m_tileCount;
+
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		if (m_tiles[tile])
+		{
+			m_lastUsed[tile] = ++m_time;
+			return m_tiles[tile];
+		}
+	}
+
+	// Decode outside of cache lock so other threads can
+	// access resident tiles meanwhile.
+	Ref< HeightfieldTile > decoded = decodeTile(tile);
+	if (!decoded)
+		return nullptr;
+
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+
+	// Another thread might have decoded same tile.
+	if (m_tiles[tile])
+	{
+		m_lastUsed[tile] = ++m_time;
+		return m_tiles[tile];
+	}
+
+	// Evict least recently used tile.
+	if ((int32_t)m_resident.size() >= m_maxResidentTiles)
+	{
+		auto it = std::min_element(m_resident.begin(), m_resident.end(), [&](int32_t lh, int32_t rh) {
+			return m_lastUsed[lh] < m_lastUsed[rh];
+		});
+		m_tiles[*it] = nullptr;
+		*it = m_resident.back();
+		m_resident.pop_back();
+	}
+
+	m_tiles[tile] = decoded;
+	m_lastUsed[tile] = ++m_time;
+	m_resident.push_back(tile);
+	return decoded;
+}
+
+void HeightfieldTileCache::prefetch(int32_t tileX0, int32_t tileZ0, int32_t tileX1, int32_t tileZ1)
+{
+	if (m_prefetchJob)
+	{
+		if (!m_prefetchJob->wait(0))
+			return;
+		m_prefetchJob = nullptr;
+	}
+
+	tileX0 = std::max(tileX0, 0);
+	tileZ0 = std::max(tileZ0, 0);
+	tileX1 = std::min(tileX1, m_tileCount - 1);
+	tileZ1 = std::min(tileZ1, m_tileCount - 1);
+
+	// Collect tiles which need to be decoded; region is clamped
+	// to half of cache so prefetch cannot evict it's own tiles.
+	AlignedVector< int32_t > tiles;
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		for (int32_t tz = tileZ0; tz <= tileZ1; ++tz)
+		{
+			for (int32_t tx = tileX0; tx <= tileX1; ++tx)
+			{
+				const int32_t tile = tx + tz * m_tileCount;
+				if (!m_tiles[tile] && (int32_t)tiles.size() < m_maxResidentTiles / 2)
+					tiles.push_back(tile);
+			}
+		}
+	}
+	if (tiles.empty())
+		return;
+
+	m_prefetchJob = JobManager::getInstance().add([=, this]() {
+		for (auto tile : tiles)
+			getTile(tile % m_tileCount, tile / m_tileCount);
+	});
+}
+
+int32_t HeightfieldTileCache::getResidentCount() const
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	return (int32_t)m_resident.size();
+}
+
+Ref< HeightfieldTile > HeightfieldTileCache::decodeTile(int32_t tile)
+{
+	const int32_t tileX = tile % m_tileCount;
+	const int32_t tileZ = tile / m_tileCount;
+	const int32_t width = std::min(m_tileSize, m_size - tileX * m_tileSize);
+	const int32_t height = std::min(m_tileSize, m_size - tileZ * m_tileSize);
+
+	const int64_t offset = m_tileOffsets[tile];
+	const int64_t dataSize = m_tileOffsets[tile + 1] - offset;
+
+	AlignedVector< uint8_t > data(dataSize);
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_streamLock);
+		if (
+			m_stream->seek(IStream::SeekSet, offset) < 0 ||
+			m_stream->read(data.ptr(), dataSize) != dataSize
+		)
+		{
+			log::error << L"Unable to read heightfield tile " << tileX << L", " << tileZ << L"." << Endl;
+			return nullptr;
+		}
+	}
+
+	Ref< HeightfieldTile > decoded = new HeightfieldTile(width, height);
+	if (!decoded->decode(data.c_ptr(), (uint32_t)dataSize))
+	{
+		log::error << L"Unable to decode heightfield tile " << tileX << L", " << tileZ << L"." << Endl;
+		return nullptr;
+	}
+
+	m_decodeCount++;
+	return decoded;
+}
+
+}
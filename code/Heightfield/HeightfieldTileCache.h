@@ -0,0 +1,101 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <atomic>
+#include "Core/Object.h"
+#include "Core/Ref.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Thread/Semaphore.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_HEIGHTFIELD_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor
+{
+
+class IStream;
+class Job;
+
+}
+
+namespace traktor::hf
+{
+
+class HeightfieldTile;
+
+/*! Bounded cache of tiles decoded on demand from tiled heightfield data.
+ * \ingroup Heightfield
+ *
+ * Least recently used tiles are evicted when more than
+ * maximum number of tiles are resident. Stream is kept
+ * open for the lifetime of the cache.
+ */
+class T_DLLCLASS HeightfieldTileCache : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	/*!
+	 * \param stream Seekable stream of tiled heightfield data.
+	 * \param size Size of heightfield.
+	 * \param tileSize Size of each tile.
+	 * \param tileOffsets Stream offset of each tile, with an additional offset to end of last tile.
+	 * \param maxResidentTiles Maximum number of decoded tiles kept in memory.
+	 */
+	explicit HeightfieldTileCache(IStream* stream, int32_t size, int32_t tileSize, const AlignedVector< int64_t >& tileOffsets, int32_t maxResidentTiles);
+
+	virtual ~HeightfieldTileCache();
+
+	/*! Get tile, decoded from stream if not resident. */
+	Ref< const HeightfieldTile > getTile(int32_t tileX, int32_t tileZ);
+
+	/*! Decode tiles in region in background.
+	 *
+	 * Ignored if previous prefetch is still running.
+	 */
+	void prefetch(int32_t tileX0, int32_t tileZ0, int32_t tileX1, int32_t tileZ1);
+
+	int32_t getTileSize() const { return m_tileSize; }
+
+	int32_t getTileCount() const { return m_tileCount; }
+
+	int32_t getMaxResidentTiles() const { return m_maxResidentTiles; }
+
+	/*! Number of tiles currently in memory. */
+	int32_t getResidentCount() const;
+
+	/*! Number of tiles decoded since cache was created. */
+	uint32_t getDecodeCount() const { return m_decodeCount; }
+
+private:
+	Ref< IStream > m_stream;
+	int32_t m_size;
+	int32_t m_tileSize;
+	int32_t m_tileCount;
+	int32_t m_maxResidentTiles;
+	AlignedVector< int64_t > m_tileOffsets;
+	AlignedVector< Ref< const HeightfieldTile > > m_tiles;
+	AlignedVector< uint64_t > m_lastUsed;
+	AlignedVector< int32_t > m_resident;
+	uint64_t m_time = 0;
+	std::atomic< uint32_t > m_decodeCount;
+	mutable Semaphore m_lock;
+	Semaphore m_streamLock;
+	Ref< Job > m_prefetchJob;
+
+	Ref< HeightfieldTile > decodeTile(int32_t tile);
+};
+
+}
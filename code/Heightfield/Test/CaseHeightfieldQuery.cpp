@@ -0,0 +1,254 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cmath>
+#include <limits>
+#include "Core/Log/Log.h"
+#include "Core/Math/Random.h"
+#include "Core/Math/Winding3.h"
+#include "Core/Timer/Timer.h"
+#include "Heightfield/Heightfield.h"
+#include "Heightfield/Test/CaseHeightfieldQuery.h"
+
+namespace traktor::hf::test
+{
+	namespace
+	{
+
+const int32_t c_referenceSize = 128;
+const int32_t c_referenceQueries = 200;
+const int32_t c_benchmarkRays = 10000;
+const Vector4 c_worldExtent(1024.0f, 128.0f, 1024.0f, 0.0f);
+
+Ref< Heightfield > createHeightfield(int32_t size)
+{
+	Ref< Heightfield > heightfield = new Heightfield(size, c_worldExtent);
+
+	// Separable hills so large heightfields are quick to create.
+	AlignedVector< float > wx(size), wz(size);
+	for (int32_t i = 0; i < size; ++i)
+	{
+		const float f = float(i) / size;
+		wx[i] = std::sin(f * 31.0f) * 0.5f + std::sin(f * 97.0f) * 0.1f;
+		wz[i] = std::cos(f * 23.0f) * 0.5f + std::sin(f * 131.0f) * 0.1f;
+	}
+
+	height_t* heights = heightfield->getHeights();
+	for (int32_t z = 0; z < size; ++z)
+	{
+		for (int32_t x = 0; x < size; ++x)
+			heights[x + z * size] = height_t((wx[x] * wz[z] * 0.5f + 0.5f) * 65535.0f);
+	}
+
+	return heightfield;
+}
+
+Ray3 randomRay(Random& random)
+{
+	const Vector4 origin(
+		(random.nextFloat() - 0.5f) * c_worldExtent.x(),
+		c_worldExtent.y() * 0.5f + random.nextFloat() * 10.0f,
+		(random.nextFloat() - 0.5f) * c_worldExtent.z(),
+		1.0f
+	);
+	const Vector4 direction = Vector4(
+		random.nextFloat() - 0.5f,
+		-random.nextFloat() * 0.5f,
+		random.nextFloat() - 0.5f,
+		0.0f
+	).normalized();
+	return Ray3(origin, direction);
+}
+
+/*! Trace every triangle of heightfield. */
+bool referenceRay(const Heightfield* heightfield, const Ray3& ray, float& outDistance)
+{
+	const int32_t size = heightfield->getSize();
+	Scalar k;
+
+	outDistance = std::numeric_limits< float >::max();
+
+	for (int32_t iz = 0; iz < size; ++iz)
+	{
+		for (int32_t ix = 0; ix < size; ++ix)
+		{
+			float x1w, z1w;
+			float x2w, z2w;
+
+			heightfield->gridToWorld(ix, iz, x1w, z1w);
+			heightfield->gridToWorld(ix + 1, iz + 1, x2w, z2w);
+
+			const Vector4 vw[] =
+			{
+				Vector4(x1w, heightfield->unitToWorld(heightfield->getGridHeightNearest(ix, iz)), z1w, 1.0f),
+				Vector4(x2w, heightfield->unitToWorld(heightfield->getGridHeightNearest(ix + 1, iz)), z1w, 1.0f),
+				Vector4(x1w, heightfield->unitToWorld(heightfield->getGridHeightNearest(ix, iz + 1)), z2w, 1.0f),
+				Vector4(x2w, heightfield->unitToWorld(heightfield->getGridHeightNearest(ix + 1, iz + 1)), z2w, 1.0f)
+			};
+
+			if (Winding3(vw[0], vw[1], vw[2]).rayIntersection(ray.origin, ray.direction, k) && k < outDistance)
+				outDistance = k;
+			if (Winding3(vw[1], vw[3], vw[2]).rayIntersection(ray.origin, ray.direction, k) && k < outDistance)
+				outDistance = k;
+		}
+	}
+
+	return outDistance < std::numeric_limits< float >::max();
+}
+
+/*! Check highest corner of every quad within box footprint. */
+bool referenceOverlap(const Heightfield* heightfield, const Aabb3& box)
+{
+	const int32_t size = heightfield->getSize();
+	const float unitY = heightfield->worldToUnit(box.mn.y());
+
+	for (int32_t iz = 0; iz < size; ++iz)
+	{
+		for (int32_t ix = 0; ix < size; ++ix)
+		{
+			float x1w, z1w;
+			float x2w, z2w;
+
+			heightfield->gridToWorld(ix, iz, x1w, z1w);
+			heightfield->gridToWorld(ix + 1, iz + 1, x2w, z2w);
+
+			if (x2w <= box.mn.x() || x1w > box.mx.x() || z2w <= box.mn.z() || z1w > box.mx.z())
+				continue;
+
+			const float h = std::max(
+				std::max(heightfield->getGridHeightNearest(ix, iz), heightfield->getGridHeightNearest(ix + 1, iz)),
+				std::max(heightfield->getGridHeightNearest(ix, iz + 1), heightfield->getGridHeightNearest(ix + 1, iz + 1))
+			);
+			if (h >= unitY)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.hf.test.CaseHeightfieldQuery", 0, CaseHeightfieldQuery, traktor::test::Case)
+
+void CaseHeightfieldQuery::run()
+{
+	Random random(1234);
+
+	// Compare with brute force reference.
+	{
+		Ref< Heightfield > heightfield = createHeightfield(c_referenceSize);
+
+		AlignedVector< Ray3 > rays;
+		for (int32_t i = 0; i < c_referenceQueries; ++i)
+			rays.push_back(randomRay(random));
+
+		AlignedVector< float > distances;
+		heightfield->queryRays(rays, distances);
+
+		int32_t rayMismatches = 0;
+		for (int32_t i = 0; i < c_referenceQueries; ++i)
+		{
+			float expected;
+			const bool expectedHit = referenceRay(heightfield, rays[i], expected);
+			const bool hit = distances[i] < std::numeric_limits< float >::max();
+			if (hit != expectedHit || (hit && std::abs(distances[i] - expected) > 1e-2f))
+				++rayMismatches;
+		}
+		CASE_ASSERT_EQUAL(rayMismatches, 0);
+
+		AlignedVector< Aabb3 > boxes;
+		for (int32_t i = 0; i < c_referenceQueries; ++i)
+		{
+			const Vector4 center(
+				(random.nextFloat() - 0.5f) * c_worldExtent.x(),
+				(random.nextFloat() - 0.5f) * c_worldExtent.y(),
+				(random.nextFloat() - 0.5f) * c_worldExtent.z(),
+				1.0f
+			);
+			const Vector4 extent(
+				random.nextFloat() * 100.0f,
+				random.nextFloat() * 10.0f,
+				random.nextFloat() * 100.0f,
+				0.0f
+			);
+			boxes.push_back(Aabb3(center - extent, center + extent));
+		}
+
+		AlignedVector< bool > overlaps;
+		heightfield->queryOverlaps(boxes, overlaps);
+
+		int32_t overlapMismatches = 0;
+		for (int32_t i = 0; i < c_referenceQueries; ++i)
+		{
+			if (overlaps[i] != referenceOverlap(heightfield, boxes[i]))
+				++overlapMismatches;
+		}
+		CASE_ASSERT_EQUAL(overlapMismatches, 0);
+
+		// Edit heightfield, raise a peak in front of first ray.
+		const Vector4 peak = rays[0].origin + rays[0].direction * Scalar(distances[0] * 0.5f);
+		int32_t gridX, gridZ;
+		heightfield->worldToGrid(peak.x(), peak.z(), gridX, gridZ);
+		for (int32_t z = gridZ - 1; z <= gridZ + 2; ++z)
+		{
+			for (int32_t x = gridX - 1; x <= gridX + 2; ++x)
+				heightfield->setGridHeight(x, z, 1.0f);
+		}
+
+		Scalar distance;
+		float expected;
+		const bool hit = heightfield->queryRay(rays[0].origin, rays[0].direction, distance);
+		const bool expectedHit = referenceRay(heightfield, rays[0], expected);
+		CASE_ASSERT(hit && expectedHit);
+		CASE_ASSERT(distance < Scalar(distances[0]));
+		CASE_ASSERT(std::abs(distance - expected) <= 1e-2f);
+	}
+
+	// Benchmark random rays.
+	for (int32_t size : { 1024, 4096, 8192 })
+	{
+		Ref< Heightfield > heightfield = createHeightfield(size);
+
+		AlignedVector< Ray3 > rays;
+		for (int32_t i = 0; i < c_benchmarkRays; ++i)
+			rays.push_back(randomRay(random));
+
+		Timer timer;
+		Scalar distance;
+		heightfield->queryRay(rays[0].origin, rays[0].direction, distance);
+		const double buildTime = timer.getElapsedTime();
+
+		AlignedVector< float > singleDistances(c_benchmarkRays);
+		int32_t hits = 0;
+
+		timer.reset();
+		for (int32_t i = 0; i < c_benchmarkRays; ++i)
+		{
+			heightfield->queryRay(rays[i].origin, rays[i].direction, distance);
+			singleDistances[i] = distance;
+			hits += (distance < Scalar(std::numeric_limits< float >::max())) ? 1 : 0;
+		}
+		const double singleTime = timer.getElapsedTime();
+
+		AlignedVector< float > batchDistances;
+
+		timer.reset();
+		heightfield->queryRays(rays, batchDistances);
+		const double batchTime = timer.getElapsedTime();
+
+		bool allEqual = (batchDistances.size() == singleDistances.size());
+		for (int32_t i = 0; allEqual && i < c_benchmarkRays; ++i)
+			allEqual &= (batchDistances[i] == singleDistances[i]);
+		CASE_ASSERT(allEqual);
+
+		log::info << size << L"x" << size << L"; pyramid " << int32_t(buildTime * 1000.0) << L" ms, " << c_benchmarkRays << L" rays (" << hits << L" hits), " << int32_t(singleTime * 1000.0) << L" ms single, " << int32_t(batchTime * 1000.0) << L" ms batched." << Endl;
+	}
+}
+
+}
@@ -0,0 +1,172 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cmath>
+#include <cstring>
+#include "Core/Io/DynamicMemoryStream.h"
+#include "Core/Io/MemoryStream.h"
+#include "Core/Log/Log.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "Heightfield/Heightfield.h"
+#include "Heightfield/HeightfieldFormat.h"
+#include "Heightfield/HeightfieldTileCache.h"
+#include "Heightfield/Test/CaseHeightfieldTiled.h"
+
+namespace traktor::hf::test
+{
+	namespace
+	{
+
+const int32_t c_size = 1000;			//!< Not a multiple of tile size to cover partial tiles.
+const int32_t c_maxResidentTiles = 16;
+const int32_t c_sampleCount = 20000;
+const Vector4 c_worldExtent(1024.0f, 128.0f, 1024.0f, 0.0f);
+
+Ref< Heightfield > createHeightfield()
+{
+	Ref< Heightfield > heightfield = new Heightfield(c_size, c_worldExtent);
+	Random random(4321);
+
+	std::memset(heightfield->getCuts(), 0xff, c_size * c_size / 8);
+
+	for (int32_t z = 0; z < c_size; ++z)
+	{
+		for (int32_t x = 0; x < c_size; ++x)
+		{
+			const float fx = float(x) / c_size;
+			const float fz = float(z) / c_size;
+			const float h = std::sin(fx * 13.0f) * std::cos(fz * 17.0f) * 0.4f + 0.5f + (random.nextFloat() - 0.5f) * 0.002f;
+			heightfield->setGridHeight(x, z, h);
+			heightfield->setGridAttribute(x, z, (x > 300 && x < 420 && z > 500) ? uint8_t((x ^ z) & 3) : 1);
+			if (x > 600 && x < 650 && z > 100 && z < 130)
+				heightfield->setGridCut(x, z, false);
+		}
+	}
+
+	// Extreme steps to exercise escaped residuals.
+	for (int32_t x = 0; x < c_size; x += 37)
+		heightfield->setGridHeight(x, x, (x & 1) ? 1.0f : 0.0f);
+
+	return heightfield;
+}
+
+bool sameGrid(const Heightfield* a, const Heightfield* b, int32_t x, int32_t z)
+{
+	return
+		a->getGridHeightNearest(x, z) == b->getGridHeightNearest(x, z) &&
+		a->getGridCut(x, z) == b->getGridCut(x, z) &&
+		a->getGridAttribute(x, z) == b->getGridAttribute(x, z);
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.hf.test.CaseHeightfieldTiled", 0, CaseHeightfieldTiled, traktor::test::Case)
+
+void CaseHeightfieldTiled::run()
+{
+	Ref< Heightfield > heightfield = createHeightfield();
+
+	AlignedVector< uint8_t > flatData, tiledData;
+	{
+		DynamicMemoryStream flatStream(flatData, false, true);
+		CASE_ASSERT(HeightfieldFormat().write(&flatStream, heightfield));
+
+		DynamicMemoryStream tiledStream(tiledData, false, true);
+		CASE_ASSERT(HeightfieldFormat().writeTiled(&tiledStream, heightfield));
+	}
+
+	// Tiled data decoded into resident heightfield must be identical.
+	{
+		Ref< IStream > stream = new MemoryStream(tiledData.c_ptr(), tiledData.size());
+
+		Timer timer;
+		Ref< Heightfield > resident = HeightfieldFormat().read(stream, c_worldExtent);
+		const double decodeTime = timer.getElapsedTime();
+
+		CASE_ASSERT(resident != nullptr);
+		if (!resident)
+			return;
+
+		CASE_ASSERT(resident->getTileCache() == nullptr);
+		CASE_ASSERT(std::memcmp(resident->getHeights(), heightfield->getHeights(), c_size * c_size * sizeof(height_t)) == 0);
+		CASE_ASSERT(std::memcmp(resident->getCuts(), heightfield->getCuts(), c_size * c_size / 8) == 0);
+		CASE_ASSERT(std::memcmp(resident->getAttributes(), heightfield->getAttributes(), c_size * c_size) == 0);
+
+		log::info << c_size << L"x" << c_size << L"; " << int32_t(flatData.size() / 1024) << L" KiB flat, " << int32_t(tiledData.size() / 1024) << L" KiB tiled, decoded in " << int32_t(decodeTime * 1000.0) << L" ms." << Endl;
+	}
+
+	// Paged heightfield sampled through cache.
+	{
+		Ref< IStream > stream = new MemoryStream(tiledData.c_ptr(), tiledData.size());
+		Ref< Heightfield > paged = HeightfieldFormat().readPaged(stream, c_worldExtent, c_maxResidentTiles);
+		CASE_ASSERT(paged != nullptr);
+		if (!paged)
+			return;
+
+		HeightfieldTileCache* tileCache = paged->getTileCache();
+		CASE_ASSERT(tileCache != nullptr);
+		CASE_ASSERT(paged->getHeights() == nullptr);
+		if (!tileCache)
+			return;
+
+		CASE_ASSERT_EQUAL(tileCache->getResidentCount(), 0);
+
+		// Pyramid is seeded from tiled data; queries only decode tiles which are traced.
+		const Aabb3 box(Vector4(-10.0f, 0.0f, -10.0f, 1.0f), Vector4(10.0f, 10.0f, 10.0f, 1.0f));
+		CASE_ASSERT_EQUAL(paged->queryOverlap(box), heightfield->queryOverlap(box));
+		CASE_ASSERT_COMPARE(tileCache->getDecodeCount(), 4u, std::less_equal< uint32_t >());
+
+		Random random(1234);
+		int32_t mismatches = 0;
+
+		for (int32_t i = 0; i < c_sampleCount; ++i)
+		{
+			const int32_t x = random.next() % c_size;
+			const int32_t z = random.next() % c_size;
+			if (!sameGrid(paged, heightfield, x, z))
+				++mismatches;
+
+			const float worldX = (random.nextFloat() - 0.5f) * c_worldExtent.x();
+			const float worldZ = (random.nextFloat() - 0.5f) * c_worldExtent.z();
+			if (paged->getWorldHeight(worldX, worldZ) != heightfield->getWorldHeight(worldX, worldZ))
+				++mismatches;
+		}
+
+		// Edges of partial tiles.
+		for (int32_t i = 0; i < c_size; ++i)
+		{
+			if (!sameGrid(paged, heightfield, c_size - 1, i) || !sameGrid(paged, heightfield, i, c_size - 1))
+				++mismatches;
+		}
+
+		CASE_ASSERT_EQUAL(mismatches, 0);
+		CASE_ASSERT_COMPARE(tileCache->getResidentCount(), c_maxResidentTiles, std::less_equal< int32_t >());
+
+		// Spatial queries work through cache as well.
+		const Vector4 origin(-400.0f, 100.0f, -300.0f, 1.0f);
+		const Vector4 direction = Vector4(1.0f, -0.3f, 0.8f, 0.0f).normalized();
+
+		Scalar pagedDistance, distance;
+		CASE_ASSERT(paged->queryRay(origin, direction, pagedDistance));
+		CASE_ASSERT(heightfield->queryRay(origin, direction, distance));
+		CASE_ASSERT(std::abs(pagedDistance - distance) <= 1e-4f);
+
+		AlignedVector< height_t > pagedLeafBounds, leafBounds;
+		paged->getLeafBounds(pagedLeafBounds);
+		heightfield->getLeafBounds(leafBounds);
+		CASE_ASSERT(pagedLeafBounds.size() == leafBounds.size() && std::memcmp(pagedLeafBounds.c_ptr(), leafBounds.c_ptr(), leafBounds.size() * sizeof(height_t)) == 0);
+
+		// Prefetch decode tiles in background; cache wait for prefetch when destroyed.
+		paged->prefetch(Vector4(0.0f, 0.0f, 0.0f, 1.0f), 100.0f);
+
+		log::info << c_sampleCount * 2 << L" samples from paged heightfield; " << tileCache->getDecodeCount() << L" tiles decoded, " << tileCache->getResidentCount() << L" resident." << Endl;
+	}
+}
+
+}
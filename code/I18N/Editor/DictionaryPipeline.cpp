@@ -35,6 +35,11 @@ TypeInfoSet DictionaryPipeline::getAssetTypes() const
 	return makeTypeInfoSet< DictionaryAsset >();
 }
 
+bool DictionaryPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 bool DictionaryPipeline::buildDependencies(
 	editor::IPipelineDepends* pipelineDepends,
 	const db::Instance* sourceInstance,
@@ -33,6 +33,8 @@ public:
 
 	virtual TypeInfoSet getAssetTypes() const override final;
 
+	virtual bool isThreadSafe() const override final;
+
 	virtual bool buildDependencies(
 		editor::IPipelineDepends* pipelineDepends,
 		const db::Instance* sourceInstance,
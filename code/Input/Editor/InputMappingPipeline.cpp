@@ -41,6 +41,11 @@ bool InputMappingPipeline::shouldCache() const
 	return false;
 }
 
+bool InputMappingPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t InputMappingPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
@@ -34,6 +34,8 @@ public:
 
 	virtual bool shouldCache() const override final;
 
+	virtual bool isThreadSafe() const override final;
+
 	virtual uint32_t hashAsset(const ISerializable* sourceAsset) const override final;
 	
 	virtual bool buildDependencies(
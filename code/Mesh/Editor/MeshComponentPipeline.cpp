@@ -36,6 +36,11 @@ bool MeshComponentPipeline::shouldCache() const
 	return false;
 }
 
+bool MeshComponentPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t MeshComponentPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
@@ -39,4 +39,9 @@ void MeshComponent::update(const world::UpdateParams& update)
 	m_transform.step();
 }
 
+bool MeshComponent::getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const
+{
+	return true;
+}
+
 }
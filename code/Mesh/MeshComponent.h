@@ -51,6 +51,8 @@ public:
 
 	virtual void update(const world::UpdateParams& update) override;
 
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const override;
+
 	virtual void build(const world::WorldBuildContext& context, const world::WorldRenderView& worldRenderView, const world::IWorldRenderPass& worldRenderPass) = 0;
 
 	/*! Set parameter callback.
@@ -58,6 +58,11 @@ void MeshParameterComponent::update(const world::UpdateParams& update)
 {
 }
 
+bool MeshParameterComponent::getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const
+{
+	return true;
+}
+
 void MeshParameterComponent::setVectorParameter(const render::handle_t parameter, const Vector4& value)
 {
 	m_values[parameter] = value;
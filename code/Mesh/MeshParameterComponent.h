@@ -55,6 +55,8 @@ public:
 
 	virtual void update(const world::UpdateParams& update) override;
 
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const override;
+
 	void setVectorParameter(const render::handle_t parameter, const Vector4& value);
 
 	void setTextureParameter(const render::handle_t parameter, render::ITexture* texture);
@@ -125,6 +125,10 @@ bool Socket::ioctl(IoctlCommand cmd, unsigned long* argp)
 	int ret = 0;
 	switch (cmd)
 	{
+	case IccNonBlockingIo:
+		ret = (int)*argp;
+		return ::ioctl(m_socket, FIONBIO, &ret) >= 0;
+
 	case IccReadPending:
 		if (::ioctl(m_socket, FIONREAD, &ret) >= 0)
 		{
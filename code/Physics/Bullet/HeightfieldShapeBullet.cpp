@@ -42,8 +42,10 @@ HeightfieldShapeBullet::HeightfieldShapeBullet(const resource::Proxy< hf::Height
 
 	// Check if we need to account for cuts in the heightfield;
 	// heightfields with no cuts are slightly faster to check.
+	// Paged heightfields have no resident cuts so assume they have cuts.
 	const uint8_t* cuts = m_heightfield->getCuts();
-	for (int32_t i = 0; i < m_heightfield->getSize() * m_heightfield->getSize() / 8; ++i)
+	m_haveCuts = (cuts == nullptr);
+	for (int32_t i = 0; cuts && i < m_heightfield->getSize() * m_heightfield->getSize() / 8; ++i)
 	{
 		if (cuts[i] != 0xff)
 		{
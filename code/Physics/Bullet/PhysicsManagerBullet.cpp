@@ -15,6 +15,8 @@
 #include "Core/Math/Format.h"
 #include "Core/Misc/Save.h"
 #include "Core/Thread/Acquire.h"
+#include "Core/Thread/JobManager.h"
+#include "Core/Timer/Timer.h"
 #include "Heightfield/Heightfield.h"
 #include "Physics/AxisJointDesc.h"
 #include "Physics/BallJointDesc.h"
@@ -530,6 +532,184 @@ private:
 	AlignedVector< TriangleResult >& m_outTriangles;
 };
 
+const int32_t c_batchGrain = 16;	//!< Number of batched queries in each job.
+
+/*! Ray test each collision object of visited broadphase tree leaves.
+ *
+ * btDbvtBroadphase::rayTest share it's traversal stack between
+ * calls so batched queries traverse the broadphase trees
+ * directly which use a local stack instead.
+ *
+ * \note Process isn't marked override as ICollide is a
+ * template policy when Bullet is built with MSVC.
+ */
+struct RayTestLeafCallback : public btDbvt::ICollide
+{
+	btTransform m_rayFromTrans;
+	btTransform m_rayToTrans;
+	btCollisionWorld::RayResultCallback& m_resultCallback;
+
+	RayTestLeafCallback(const btVector3& rayFromWorld, const btVector3& rayToWorld, btCollisionWorld::RayResultCallback& resultCallback)
+	:	m_resultCallback(resultCallback)
+	{
+		m_rayFromTrans.setIdentity();
+		m_rayFromTrans.setOrigin(rayFromWorld);
+		m_rayToTrans.setIdentity();
+		m_rayToTrans.setOrigin(rayToWorld);
+	}
+
+	void Process(const btDbvtNode* leaf)
+	{
+		const btBroadphaseProxy* proxy = static_cast< const btBroadphaseProxy* >(leaf->data);
+		btCollisionObject* collisionObject = static_cast< btCollisionObject* >(proxy->m_clientObject);
+		if (m_resultCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+		{
+			btCollisionWorld::rayTestSingle(
+				m_rayFromTrans,
+				m_rayToTrans,
+				collisionObject,
+				collisionObject->getCollisionShape(),
+				collisionObject->getWorldTransform(),
+				m_resultCallback
+			);
+		}
+	}
+};
+
+/*! Sweep test each collision object of visited broadphase tree leaves. */
+struct SweepTestLeafCallback : public btDbvt::ICollide
+{
+	const btConvexShape* m_castShape;
+	const btTransform& m_convexFromTrans;
+	const btTransform& m_convexToTrans;
+	btScalar m_allowedCcdPenetration;
+	btCollisionWorld::ConvexResultCallback& m_resultCallback;
+
+	SweepTestLeafCallback(const btConvexShape* castShape, const btTransform& convexFromTrans, const btTransform& convexToTrans, btScalar allowedCcdPenetration, btCollisionWorld::ConvexResultCallback& resultCallback)
+	:	m_castShape(castShape)
+	,	m_convexFromTrans(convexFromTrans)
+	,	m_convexToTrans(convexToTrans)
+	,	m_allowedCcdPenetration(allowedCcdPenetration)
+	,	m_resultCallback(resultCallback)
+	{
+	}
+
+	void Process(const btDbvtNode* leaf)
+	{
+		const btBroadphaseProxy* proxy = static_cast< const btBroadphaseProxy* >(leaf->data);
+		btCollisionObject* collisionObject = static_cast< btCollisionObject* >(proxy->m_clientObject);
+		if (m_resultCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+		{
+			btCollisionWorld::objectQuerySingle(
+				m_castShape,
+				m_convexFromTrans,
+				m_convexToTrans,
+				collisionObject,
+				collisionObject->getCollisionShape(),
+				collisionObject->getWorldTransform(),
+				m_resultCallback,
+				m_allowedCcdPenetration
+			);
+		}
+	}
+};
+
+/*! Thread safe equivalent of btCollisionWorld::rayTest. */
+void rayTestConcurrent(const btDbvtBroadphase* broadphase, const btVector3& from, const btVector3& to, btCollisionWorld::RayResultCallback& resultCallback)
+{
+	RayTestLeafCallback leafCallback(from, to, resultCallback);
+	for (int32_t i = 0; i < 2; ++i)
+		btDbvt::rayTest(broadphase->m_sets[i].m_root, from, to, leafCallback);
+}
+
+/*! Thread safe equivalent of btCollisionWorld::convexSweepTest. */
+void sweepTestConcurrent(const btDbvtBroadphase* broadphase, const btConvexShape* castShape, const btTransform& from, const btTransform& to, btScalar allowedCcdPenetration, btCollisionWorld::ConvexResultCallback& resultCallback)
+{
+	btVector3 fromMin, fromMax, toMin, toMax;
+	castShape->getAabb(from, fromMin, fromMax);
+	castShape->getAabb(to, toMin, toMax);
+	fromMin.setMin(toMin);
+	fromMax.setMax(toMax);
+
+	const btDbvtVolume volume = btDbvtVolume::FromMM(fromMin, fromMax);
+
+	SweepTestLeafCallback leafCallback(castShape, from, to, allowedCcdPenetration, resultCallback);
+	for (int32_t i = 0; i < 2; ++i)
+		broadphase->m_sets[i].collideTV(broadphase->m_sets[i].m_root, volume, leafCallback);
+}
+
+/*! Get query result from closest ray callback. */
+template < typename CallbackType >
+void getRayResult(const CallbackType& callback, const Vector4& at, const Vector4& direction, QueryResult& outResult)
+{
+	BodyBullet* body = reinterpret_cast< BodyBullet* >(callback.m_collisionObject->getUserPointer());
+	T_ASSERT(body);
+
+	outResult.body = body;
+	outResult.position = fromBtVector3(callback.m_hitPointWorld, 1.0f);
+	outResult.normal = fromBtVector3(callback.m_hitNormalWorld, 0.0).normalized();
+	outResult.distance = dot3(direction, outResult.position - at);
+	outResult.material = body->getMaterial();
+
+	if (callback.m_triangleIndex >= 0)
+	{
+		const btCollisionShape* collisionShape = callback.m_collisionObject->getCollisionShape();
+		if (collisionShape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
+		{
+			const btTriangleMeshShape* meshShape = reinterpret_cast< const btTriangleMeshShape* >(collisionShape);
+			const MeshProxyIndexVertexArray* meshInterface = reinterpret_cast< const MeshProxyIndexVertexArray* >(meshShape->getMeshInterface());
+
+			Vector4 triangleNormal = outResult.normal;
+			meshInterface->getTriangleNormal(callback.m_triangleIndex, triangleNormal);
+			outResult.normal = body->getTransform() * triangleNormal.xyz0();
+		}
+	}
+}
+
+/*! Get query result from closest sweep callback. */
+void getSweepResult(const ClosestConvexExcludeResultCallback& callback, const Vector4& at, const Vector4& direction, QueryResult& outResult)
+{
+	BodyBullet* body = reinterpret_cast< BodyBullet* >(callback.m_hitCollisionObject->getUserPointer());
+	T_ASSERT(body);
+
+	outResult.body = body;
+	outResult.position = fromBtVector3(callback.m_hitPointWorld, 1.0f);
+	outResult.normal = fromBtVector3(callback.m_hitNormalWorld, 0.0).normalized();
+	outResult.distance = dot3(direction, outResult.position - at);
+	outResult.fraction = callback.m_closestHitFraction;
+	outResult.material = body->getMaterial();
+}
+
+/*! Filter bodies found in sphere's bounding box. */
+void filterSphereBodies(const RefArray< BodyBullet >& bodies, const Vector4& at, float radius, const QueryFilter& queryFilter, uint32_t queryTypes, RefArray< Body >& outBodies)
+{
+	for (auto body : bodies)
+	{
+		const uint32_t group = body->getCollisionGroup();
+
+		if ((group & queryFilter.includeGroup) == 0 || (group & queryFilter.ignoreGroup) != 0)
+			continue;
+
+		const bool st = body->isStatic();
+		if ((queryTypes & PhysicsManager::QtStatic) == 0 && st)
+			continue;
+		if ((queryTypes & PhysicsManager::QtDynamic) == 0 && !st)
+			continue;
+
+		btRigidBody* rigidBody = body->getBtRigidBody();
+		T_ASSERT(rigidBody);
+
+		btVector3 aabbMin, aabbMax;
+		rigidBody->getAabb(aabbMin, aabbMax);
+
+		const float bodyRadius = (aabbMax - aabbMin).length() * 0.5f;
+		const Vector4 bodyCenter = fromBtVector3((aabbMin + aabbMax) * 0.5f, 1.0f);
+
+		if ((bodyCenter - at).length() - radius - bodyRadius <= 0.0f)
+			outBodies.push_back(body);
+	}
+}
+
 void deleteShape(btCollisionShape* shape)
 {
 	if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
@@ -1064,8 +1244,10 @@ void PhysicsManagerBullet::update(float simulationDeltaTime, bool issueCollision
 	T_ANONYMOUS_VAR(Save< PhysicsManagerBullet* >)(ms_this, this);
 
 	// Step simulation.
+	Timer timer;
 	const float dT = simulationDeltaTime * m_timeScale;
 	m_dynamicsWorld->stepSimulation(dT, 10, 1.0f / m_simulationFrequency);
+	m_stepTime = timer.getElapsedTime();
 
 	// Issue collision events.
 	if (issueCollisionEvents)
@@ -1237,28 +1419,7 @@ bool PhysicsManagerBullet::queryRay(
 		if (!callback.hasHit())
 			return false;
 
-		BodyBullet* body = reinterpret_cast< BodyBullet* >(callback.m_collisionObject->getUserPointer());
-		T_ASSERT(body);
-
-		outResult.body = body;
-		outResult.position = fromBtVector3(callback.m_hitPointWorld, 1.0f);
-		outResult.normal = fromBtVector3(callback.m_hitNormalWorld, 0.0).normalized();
-		outResult.distance = dot3(direction, outResult.position - at);
-		outResult.material = body->getMaterial();
-
-		if (callback.m_triangleIndex >= 0)
-		{
-			const btCollisionShape* collisionShape = callback.m_collisionObject->getCollisionShape();
-			if (collisionShape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
-			{
-				const btTriangleMeshShape* meshShape = reinterpret_cast< const btTriangleMeshShape* >(collisionShape);
-				const MeshProxyIndexVertexArray* meshInterface = reinterpret_cast< const MeshProxyIndexVertexArray* >(meshShape->getMeshInterface());
-
-				Vector4 triangleNormal = outResult.normal;
-				meshInterface->getTriangleNormal(callback.m_triangleIndex, triangleNormal);
-				outResult.normal = body->getTransform() * triangleNormal.xyz0();
-			}
-		}
+		getRayResult(callback, at, direction, outResult);
 	}
 	else
 	{
@@ -1267,28 +1428,7 @@ bool PhysicsManagerBullet::queryRay(
 		if (!callback.hasHit())
 			return false;
 
-		BodyBullet* body = reinterpret_cast< BodyBullet* >(callback.m_collisionObject->getUserPointer());
-		T_ASSERT(body);
-
-		outResult.body = body;
-		outResult.position = fromBtVector3(callback.m_hitPointWorld, 1.0f);
-		outResult.normal = fromBtVector3(callback.m_hitNormalWorld, 0.0).normalized();
-		outResult.distance = dot3(direction, outResult.position - at);
-		outResult.material = body->getMaterial();
-
-		if (callback.m_triangleIndex >= 0)
-		{
-			const btCollisionShape* collisionShape = callback.m_collisionObject->getCollisionShape();
-			if (collisionShape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
-			{
-				const btTriangleMeshShape* meshShape = reinterpret_cast< const btTriangleMeshShape* >(collisionShape);
-				const MeshProxyIndexVertexArray* meshInterface = reinterpret_cast< const MeshProxyIndexVertexArray* >(meshShape->getMeshInterface());
-
-				Vector4 triangleNormal = outResult.normal;
-				meshInterface->getTriangleNormal(callback.m_triangleIndex, triangleNormal);
-				outResult.normal = body->getTransform() * triangleNormal.xyz0();
-			}
-		}
+		getRayResult(callback, at, direction, outResult);
 	}
 
 	return true;
@@ -1335,31 +1475,7 @@ uint32_t PhysicsManagerBullet::querySphere(
 
 	QuerySphereCallback callback;
 	m_broadphase->aabbTest(aabbMin, aabbMax, callback);
-	for (auto body : callback.bodies)
-	{
-		const uint32_t group = body->getCollisionGroup();
-
-		if ((group & queryFilter.includeGroup) == 0 || (group & queryFilter.ignoreGroup) != 0)
-			continue;
-
-		const bool st = body->isStatic();
-		if ((queryTypes & QtStatic) == 0 && st)
-			continue;
-		if ((queryTypes & QtDynamic) == 0 && !st)
-			continue;
-
-		btRigidBody* rigidBody = body->getBtRigidBody();
-		T_ASSERT(rigidBody);
-
-		btVector3 aabbMin, aabbMax;
-		rigidBody->getAabb(aabbMin, aabbMax);
-
-		const float bodyRadius = (aabbMax - aabbMin).length() * 0.5f;
-		const Vector4 bodyCenter = fromBtVector3((aabbMin + aabbMax) * 0.5f, 1.0f);
-
-		if ((bodyCenter - at).length() - radius - bodyRadius <= 0.0f)
-			outBodies.push_back(body);
-	}
+	filterSphereBodies(callback.bodies, at, radius, queryFilter, queryTypes, outBodies);
 
 	return uint32_t(outBodies.size());
 }
@@ -1394,16 +1510,7 @@ bool PhysicsManagerBullet::querySweep(
 	if (!callback.hasHit())
 		return false;
 
-	BodyBullet* body = reinterpret_cast< BodyBullet* >(callback.m_hitCollisionObject->getUserPointer());
-	T_ASSERT(body);
-
-	outResult.body = body;
-	outResult.position = fromBtVector3(callback.m_hitPointWorld, 1.0f);
-	outResult.normal = fromBtVector3(callback.m_hitNormalWorld, 0.0).normalized();
-	outResult.distance = dot3(direction, outResult.position - at);
-	outResult.fraction = callback.m_closestHitFraction;
-	outResult.material = body->getMaterial();
-
+	getSweepResult(callback, at, direction, outResult);
 	return true;
 }
 
@@ -1567,12 +1674,150 @@ void PhysicsManagerBullet::queryTriangles(const Vector4& center, float radius, A
 	}
 }
 
+void PhysicsManagerBullet::queryRays(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	bool ignoreBackFace,
+	AlignedVector< QueryResult >& outResults
+) const
+{
+	m_queryCount += (uint32_t)queries.size();
+
+	outResults.resize(queries.size());
+
+	const btDbvtBroadphase* broadphase = static_cast< const btDbvtBroadphase* >(m_broadphase);
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			QueryResult& outResult = outResults[i];
+
+			const btVector3 rayFrom = toBtVector3(query.at);
+			const btVector3 rayTo = toBtVector3(query.at + query.direction * Scalar(query.maxLength));
+
+			outResult = QueryResult();
+			if (!ignoreBackFace)
+			{
+				ClosestRayExcludeResultCallback callback(queryFilter, QtAll, rayFrom, rayTo);
+				rayTestConcurrent(broadphase, rayFrom, rayTo, callback);
+				if (callback.hasHit())
+					getRayResult(callback, query.at, query.direction, outResult);
+			}
+			else
+			{
+				ClosestRayExcludeAndCullResultCallback callback(queryFilter, rayFrom, rayTo);
+				rayTestConcurrent(broadphase, rayFrom, rayTo, callback);
+				if (callback.hasHit())
+					getRayResult(callback, query.at, query.direction, outResult);
+			}
+		}
+	});
+}
+
+void PhysicsManagerBullet::queryShadowRays(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	uint32_t queryTypes,
+	AlignedVector< bool >& outHits
+) const
+{
+	m_queryCount += (uint32_t)queries.size();
+
+	outHits.resize(queries.size());
+
+	const btDbvtBroadphase* broadphase = static_cast< const btDbvtBroadphase* >(m_broadphase);
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+
+			const btVector3 rayFrom = toBtVector3(query.at);
+			const btVector3 rayTo = toBtVector3(query.at + query.direction * Scalar(query.maxLength));
+
+			ClosestRayExcludeResultCallback callback(queryFilter, queryTypes, rayFrom, rayTo);
+			rayTestConcurrent(broadphase, rayFrom, rayTo, callback);
+			outHits[i] = callback.hasHit();
+		}
+	});
+}
+
+void PhysicsManagerBullet::querySpheres(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	uint32_t queryTypes,
+	AlignedVector< RefArray< Body > >& outBodies
+) const
+{
+	m_queryCount += (uint32_t)queries.size();
+
+	outBodies.resize(queries.size());
+
+	// Broadphase aabb test use a local traversal stack thus safe to call concurrently.
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		QuerySphereCallback callback;
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+
+			const btVector3 center = toBtVector3(query.at);
+			const btVector3 radii = btVector3(query.radius, query.radius, query.radius);
+
+			callback.bodies.resize(0);
+			m_broadphase->aabbTest(center - radii, center + radii, callback);
+
+			outBodies[i].resize(0);
+			filterSphereBodies(callback.bodies, query.at, query.radius, queryFilter, queryTypes, outBodies[i]);
+		}
+	});
+}
+
+void PhysicsManagerBullet::querySweeps(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	AlignedVector< QueryResult >& outResults
+) const
+{
+	m_queryCount += (uint32_t)queries.size();
+
+	outResults.resize(queries.size());
+
+	const btDbvtBroadphase* broadphase = static_cast< const btDbvtBroadphase* >(m_broadphase);
+	const btScalar allowedCcdPenetration = m_dynamicsWorld->getDispatchInfo().m_allowedCcdPenetration;
+
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			QueryResult& outResult = outResults[i];
+
+			const btSphereShape sphereShape(query.radius);
+			btTransform sweepFrom, sweepTo;
+
+			sweepFrom.setIdentity();
+			sweepFrom.setOrigin(toBtVector3(query.at));
+
+			sweepTo.setIdentity();
+			sweepTo.setOrigin(toBtVector3(query.at + query.direction * Scalar(query.maxLength)));
+
+			ClosestConvexExcludeResultCallback callback(0, queryFilter, sweepFrom.getOrigin(), sweepTo.getOrigin());
+			sweepTestConcurrent(broadphase, &sphereShape, sweepFrom, sweepTo, allowedCcdPenetration, callback);
+
+			outResult = QueryResult();
+			if (callback.hasHit())
+				getSweepResult(callback, query.at, query.direction, outResult);
+		}
+	});
+}
+
 void PhysicsManagerBullet::getStatistics(PhysicsStatistics& outStatistics) const
 {
 	outStatistics.bodyCount = 0;
 	outStatistics.activeCount = 0;
 	outStatistics.manifoldCount = 0;
 	outStatistics.queryCount = m_queryCountLast;
+	outStatistics.jobCount = 0;
+	outStatistics.jobTime = 0.0;
+	outStatistics.stepTime = m_stepTime;
 
 	const btCollisionObjectArray& collisionObjects = m_dynamicsWorld->getCollisionObjectArray();
 	for (int i = 0; i < collisionObjects.size(); ++i)
@@ -143,6 +143,33 @@ public:
 		AlignedVector< TriangleResult >& outTriangles
 	) const override final;
 
+	virtual void queryRays(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		bool ignoreBackFace,
+		AlignedVector< QueryResult >& outResults
+	) const override final;
+
+	virtual void queryShadowRays(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		uint32_t queryTypes,
+		AlignedVector< bool >& outHits
+	) const override final;
+
+	virtual void querySpheres(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		uint32_t queryTypes,
+		AlignedVector< RefArray< Body > >& outBodies
+	) const override final;
+
+	virtual void querySweeps(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		AlignedVector< QueryResult >& outResults
+	) const override final;
+
 	virtual void getStatistics(PhysicsStatistics& outStatistics) const override final;
 
 private:
@@ -158,6 +185,7 @@ private:
 	RefArray< Joint > m_joints;
 	uint32_t m_queryCountLast;
 	mutable uint32_t m_queryCount;
+	double m_stepTime = 0.0;
 
 	static PhysicsManagerBullet* ms_this;
 
@@ -0,0 +1,100 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "Core/Thread/JobManager.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
+#include "Core/Timer/Timer.h"
+#include "Physics/Jolt/JobSystemJolt.h"
+
+namespace traktor::physics
+{
+
+JobSystemJolt::JobSystemJolt(uint32_t maxJobs, uint32_t maxBarriers)
+:	JPH::JobSystemWithBarrier(maxBarriers)
+,	m_jobCount(0)
+,	m_jobTime(0)
+,	m_queued(0)
+{
+	m_jobs.Init(maxJobs, maxJobs);
+
+	// Calling thread also execute jobs while waiting on barriers.
+	m_maxConcurrency = (int32_t)JobManager::getInstance().getQueue().getWorkerCount() + 1;
+}
+
+JobSystemJolt::~JobSystemJolt()
+{
+	// Queued jobs reference this job system even if they've
+	// already been executed by a thread waiting on a barrier.
+	while (m_queued > 0)
+		ThreadManager::getInstance().getCurrentThread()->yield();
+}
+
+int JobSystemJolt::GetMaxConcurrency() const
+{
+	return m_maxConcurrency;
+}
+
+JPH::JobHandle JobSystemJolt::CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies)
+{
+	// Wait until a job is available in the free list; only happens if
+	// more jobs are in flight than the physics system is configured for.
+	uint32_t index;
+	for (;;)
+	{
+		index = m_jobs.ConstructObject(inName, inColor, this, inJobFunction, inNumDependencies);
+		if (index != JPH::FixedSizeFreeList< Job >::cInvalidObjectIndex)
+			break;
+		ThreadManager::getInstance().getCurrentThread()->yield();
+	}
+
+	Job* job = &m_jobs.Get(index);
+
+	// Handle keep a reference as job might finish immediately when queued.
+	JPH::JobHandle handle(job);
+	if (inNumDependencies == 0)
+		QueueJob(job);
+
+	return handle;
+}
+
+void JobSystemJolt::resetCounters()
+{
+	m_jobCount = 0;
+	m_jobTime = 0;
+}
+
+void JobSystemJolt::QueueJob(Job* inJob)
+{
+	inJob->AddRef();
+	m_queued++;
+	JobManager::getInstance().add([this, inJob]() {
+		if (!inJob->IsDone())
+		{
+			Timer timer;
+			inJob->Execute();
+			m_jobTime += (int64_t)(timer.getElapsedTime() * 1000000.0);
+			m_jobCount++;
+		}
+		inJob->Release();
+		m_queued--;
+	});
+}
+
+void JobSystemJolt::QueueJobs(Job** inJobs, JPH::uint inNumJobs)
+{
+	for (JPH::uint i = 0; i < inNumJobs; ++i)
+		QueueJob(inJobs[i]);
+}
+
+void JobSystemJolt::FreeJob(Job* inJob)
+{
+	m_jobs.DestructObject(inJob);
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <atomic>
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/FixedSizeFreeList.h>
+#include <Jolt/Core/JobSystemWithBarrier.h>
+
+namespace traktor::physics
+{
+
+/*! Jolt job system which execute jobs on Traktor's job manager.
+ * \ingroup Jolt
+ *
+ * Physics jobs share worker threads with the rest of the
+ * engine instead of having a private thread pool competing
+ * with job manager's workers.
+ */
+class JobSystemJolt : public JPH::JobSystemWithBarrier
+{
+public:
+	explicit JobSystemJolt(uint32_t maxJobs, uint32_t maxBarriers);
+
+	virtual ~JobSystemJolt();
+
+	virtual int GetMaxConcurrency() const override final;
+
+	virtual JPH::JobHandle CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies = 0) override final;
+
+	/*! Reset job counters, called before each physics step. */
+	void resetCounters();
+
+	/*! Number of jobs executed on job manager since counters were reset. */
+	uint32_t getJobCount() const { return m_jobCount; }
+
+	/*! Accumulated time, in seconds, spent executing jobs since counters were reset. */
+	double getJobTime() const { return double(m_jobTime) / 1000000.0; }
+
+protected:
+	virtual void QueueJob(Job* inJob) override final;
+
+	virtual void QueueJobs(Job** inJobs, JPH::uint inNumJobs) override final;
+
+	virtual void FreeJob(Job* inJob) override final;
+
+private:
+	JPH::FixedSizeFreeList< Job > m_jobs;
+	std::atomic< uint32_t > m_jobCount;
+	std::atomic< int64_t > m_jobTime;	//!< Microseconds.
+	std::atomic< int32_t > m_queued;
+	int32_t m_maxConcurrency;
+};
+
+}
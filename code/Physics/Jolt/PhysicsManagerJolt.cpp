@@ -8,13 +8,14 @@
  */
 #include <algorithm>
 #include <cstring>
-#include <thread>
 #include "Core/Log/Log.h"
 #include "Core/Math/Const.h"
 #include "Core/Math/Aabb3.h"
 #include "Core/Math/Format.h"
 #include "Core/Misc/Save.h"
 #include "Core/Thread/Acquire.h"
+#include "Core/Thread/JobManager.h"
+#include "Core/Timer/Timer.h"
 #include "Heightfield/Heightfield.h"
 #include "Physics/AxisJointDesc.h"
 #include "Physics/BallJointDesc.h"
@@ -36,6 +37,7 @@
 #include "Physics/StaticBodyDesc.h"
 #include "Physics/Jolt/Conversion.h"
 #include "Physics/Jolt/BodyJolt.h"
+#include "Physics/Jolt/JobSystemJolt.h"
 #include "Physics/Jolt/PhysicsManagerJolt.h"
 #include "Resource/IResourceManager.h"
 
@@ -44,9 +46,9 @@
 #include <Jolt/RegisterTypes.h>
 #include <Jolt/Core/Factory.h>
 #include <Jolt/Core/TempAllocator.h>
-#include <Jolt/Core/JobSystemThreadPool.h>
 #include <Jolt/Physics/PhysicsSettings.h>
 #include <Jolt/Physics/PhysicsSystem.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
 #include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
 #include <Jolt/Physics/Collision/PhysicsMaterialSimple.h>
 #include <Jolt/Physics/Collision/RayCast.h>
@@ -67,6 +69,8 @@ namespace traktor::physics
 	namespace
 	{
 
+const int32_t c_batchGrain = 16;	//!< Number of batched queries in each job.
+
 namespace Layers
 {
 	static constexpr JPH::ObjectLayer NON_MOVING = 0;
@@ -194,8 +198,8 @@ bool PhysicsManagerJolt::create(const PhysicsCreateDesc& desc)
 	JPH::Factory::sInstance = new JPH::Factory();
 	JPH::RegisterTypes();
 
-	m_tempAllocator.reset(new JPH::TempAllocatorImpl(10 * 1024 * 1024));
-	m_jobSystem.reset(new JPH::JobSystemThreadPool(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, std::thread::hardware_concurrency() - 1));
+	m_tempAllocator.reset(new JPH::TempAllocatorImpl(desc.tempArenaSize));
+	m_jobSystem.reset(new JobSystemJolt(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers));
 
 	const JPH::uint cMaxBodies = 1024;
 	const JPH::uint cNumBodyMutexes = 0;
@@ -313,16 +317,15 @@ Ref< Body > PhysicsManagerJolt::createBody(resource::IResourceManager* resourceM
 			return nullptr;
 		}
 
-		AlignedVector< float > samples;
-		samples.resize(heightfield->getSize() * heightfield->getSize());
+		// Read all heights in one block; paged heightfield then only decode each tile once.
+		AlignedVector< hf::height_t > heights;
+		heights.resize(heightfield->getSize() * heightfield->getSize());
+		heightfield->getHeights(0, 0, heightfield->getSize(), heightfield->getSize(), heights.ptr());
 
-		for (int32_t y = 0; y < heightfield->getSize(); ++y)
-		{
-			for (int32_t x = 0; x < heightfield->getSize(); ++x)
-			{
-				samples[x + y * heightfield->getSize()] = heightfield->getGridHeightNearest(x, y);
-			}
-		}
+		AlignedVector< float > samples;
+		samples.resize(heights.size());
+		for (size_t i = 0; i < heights.size(); ++i)
+			samples[i] = heights[i] / 65535.0f;
 
 		const Vector4 s(
 			1.0f / heightfield->getSize(),
@@ -428,7 +431,14 @@ Ref< Joint > PhysicsManagerJolt::createJoint(const JointDesc* desc, const Transf
 void PhysicsManagerJolt::update(float simulationDeltaTime, bool issueCollisionEvents)
 {
 	const int cCollisionSteps = 2;
+
+	Timer timer;
+	m_jobSystem->resetCounters();
 	m_physicsSystem->Update(simulationDeltaTime * m_timeScale, cCollisionSteps, m_tempAllocator.ptr(), m_jobSystem.ptr());
+
+	m_jobCount = m_jobSystem->getJobCount();
+	m_jobTime = m_jobSystem->getJobTime();
+	m_stepTime = timer.getElapsedTime();
 }
 
 void PhysicsManagerJolt::solveConstraints(const RefArray< Body >& bodies, const RefArray< Joint >& joints)
@@ -540,7 +550,67 @@ bool PhysicsManagerJolt::queryShadowRay(
 	uint32_t queryTypes
 ) const
 {
-	return false;
+	const JPH::NarrowPhaseQuery& narrowPhaseQuery = m_physicsSystem->GetNarrowPhaseQuery();
+
+	class ShadowRayCollector : public JPH::CastRayCollector
+	{
+	public:
+		explicit ShadowRayCollector(const PhysicsManagerJolt* outer, const QueryFilter& queryFilter, uint32_t queryTypes)
+		:	m_outer(outer)
+		,	m_queryFilter(queryFilter)
+		,	m_queryTypes(queryTypes)
+		{
+		}
+
+		virtual void AddHit(const JPH::RayCastResult& result) override
+		{
+			JPH::BodyLockRead lock(m_outer->m_physicsSystem->GetBodyLockInterface(), result.mBodyID);
+			if (!lock.Succeeded())
+				return;
+
+			const JPH::Body& hitBody = lock.GetBody();
+
+			BodyJolt* unwrappedBody = (BodyJolt*)hitBody.GetUserData();
+			if (!unwrappedBody)
+				return;
+
+			if (m_queryFilter.ignoreClusterId != 0 && unwrappedBody->getClusterId() == m_queryFilter.ignoreClusterId)
+				return;
+
+			const uint32_t group = unwrappedBody->getCollisionGroup();
+			if ((group & m_queryFilter.includeGroup) == 0 || (group & m_queryFilter.ignoreGroup) != 0)
+				return;
+
+			const bool isStatic = !hitBody.IsDynamic();
+			if ((m_queryTypes & PhysicsManager::QtStatic) == 0 && isStatic)
+				return;
+			if ((m_queryTypes & PhysicsManager::QtDynamic) == 0 && !isStatic)
+				return;
+
+			// Any hit occludes, no need to find closest.
+			m_anyHit = true;
+			ForceEarlyOut();
+		}
+
+		bool AnyHit() const { return m_anyHit; }
+
+	private:
+		const PhysicsManagerJolt* m_outer;
+		const QueryFilter& m_queryFilter;
+		uint32_t m_queryTypes;
+		bool m_anyHit = false;
+	};
+
+	const JPH::RRayCast ray { convertToJolt(at), convertToJolt(direction * Scalar(maxLength)) };
+
+	JPH::RayCastSettings settings;
+	settings.mBackFaceModeTriangles = JPH::EBackFaceMode::IgnoreBackFaces;
+	settings.mBackFaceModeConvex = JPH::EBackFaceMode::IgnoreBackFaces;
+	settings.mTreatConvexAsSolid = true;
+
+	ShadowRayCollector collector(this, queryFilter, queryTypes);
+	narrowPhaseQuery.CastRay(ray, settings, collector);
+	return collector.AnyHit();
 }
 
 uint32_t PhysicsManagerJolt::querySphere(
@@ -551,7 +621,75 @@ uint32_t PhysicsManagerJolt::querySphere(
 	RefArray< Body >& outBodies
 ) const
 {
-	return false;
+	const JPH::NarrowPhaseQuery& narrowPhaseQuery = m_physicsSystem->GetNarrowPhaseQuery();
+
+	class SphereCollector : public JPH::CollideShapeCollector
+	{
+	public:
+		explicit SphereCollector(const PhysicsManagerJolt* outer, const QueryFilter& queryFilter, uint32_t queryTypes, RefArray< Body >& outBodies)
+		:	m_outer(outer)
+		,	m_queryFilter(queryFilter)
+		,	m_queryTypes(queryTypes)
+		,	m_outBodies(outBodies)
+		{
+		}
+
+		virtual void AddHit(const JPH::CollideShapeResult& result) override
+		{
+			JPH::BodyLockRead lock(m_outer->m_physicsSystem->GetBodyLockInterface(), result.mBodyID2);
+			if (!lock.Succeeded())
+				return;
+
+			const JPH::Body& hitBody = lock.GetBody();
+
+			BodyJolt* unwrappedBody = (BodyJolt*)hitBody.GetUserData();
+			if (!unwrappedBody)
+				return;
+
+			if (m_queryFilter.ignoreClusterId != 0 && unwrappedBody->getClusterId() == m_queryFilter.ignoreClusterId)
+				return;
+
+			const uint32_t group = unwrappedBody->getCollisionGroup();
+			if ((group & m_queryFilter.includeGroup) == 0 || (group & m_queryFilter.ignoreGroup) != 0)
+				return;
+
+			const bool isStatic = !hitBody.IsDynamic();
+			if ((m_queryTypes & PhysicsManager::QtStatic) == 0 && isStatic)
+				return;
+			if ((m_queryTypes & PhysicsManager::QtDynamic) == 0 && !isStatic)
+				return;
+
+			// Compound shapes report one hit per overlapping sub shape.
+			if (std::find(m_outBodies.begin(), m_outBodies.end(), unwrappedBody) == m_outBodies.end())
+				m_outBodies.push_back(unwrappedBody);
+		}
+
+	private:
+		const PhysicsManagerJolt* m_outer;
+		const QueryFilter& m_queryFilter;
+		uint32_t m_queryTypes;
+		RefArray< Body >& m_outBodies;
+	};
+
+	outBodies.resize(0);
+
+	JPH::SphereShape sphere(radius);
+	sphere.SetEmbedded();
+
+	JPH::CollideShapeSettings settings;
+	settings.mBackFaceMode = JPH::EBackFaceMode::CollideWithBackFaces;
+
+	SphereCollector collector(this, queryFilter, queryTypes, outBodies);
+	narrowPhaseQuery.CollideShape(
+		&sphere,
+		JPH::Vec3::sReplicate(1.0f),
+		JPH::RMat44::sTranslation(convertToJolt(at)),
+		settings,
+		JPH::Vec3::sReplicate(0.0f),
+		collector
+	);
+
+	return uint32_t(outBodies.size());
 }
 
 bool PhysicsManagerJolt::querySweep(
@@ -752,12 +890,89 @@ void PhysicsManagerJolt::queryTriangles(const Vector4& center, float radius, Ali
 {
 }
 
+void PhysicsManagerJolt::queryRays(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	bool ignoreBackFace,
+	AlignedVector< QueryResult >& outResults
+) const
+{
+	outResults.resize(queries.size());
+
+	// Narrow phase queries are thread safe so each ray is cast as a single query.
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			outResults[i] = QueryResult();
+			if (!queryRay(query.at, query.direction, query.maxLength, queryFilter, ignoreBackFace, outResults[i]))
+				outResults[i] = QueryResult();
+		}
+	});
+}
+
+void PhysicsManagerJolt::queryShadowRays(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	uint32_t queryTypes,
+	AlignedVector< bool >& outHits
+) const
+{
+	outHits.resize(queries.size());
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			outHits[i] = queryShadowRay(query.at, query.direction, query.maxLength, queryFilter, queryTypes);
+		}
+	});
+}
+
+void PhysicsManagerJolt::querySpheres(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	uint32_t queryTypes,
+	AlignedVector< RefArray< Body > >& outBodies
+) const
+{
+	outBodies.resize(queries.size());
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			outBodies[i].resize(0);
+			querySphere(query.at, query.radius, queryFilter, queryTypes, outBodies[i]);
+		}
+	});
+}
+
+void PhysicsManagerJolt::querySweeps(
+	const AlignedVector< BatchQuery >& queries,
+	const QueryFilter& queryFilter,
+	AlignedVector< QueryResult >& outResults
+) const
+{
+	outResults.resize(queries.size());
+	JobManager::getInstance().parallelFor((int32_t)queries.size(), c_batchGrain, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			outResults[i] = QueryResult();
+			if (!querySweep(query.at, query.direction, query.maxLength, query.radius, queryFilter, outResults[i]))
+				outResults[i] = QueryResult();
+		}
+	});
+}
+
 void PhysicsManagerJolt::getStatistics(PhysicsStatistics& outStatistics) const
 {
 	outStatistics.bodyCount = (uint32_t)m_bodies.size();
 	outStatistics.activeCount = 0;
 	outStatistics.manifoldCount = 0;
 	outStatistics.queryCount = 0;
+	outStatistics.jobCount = m_jobCount;
+	outStatistics.jobTime = m_jobTime;
+	outStatistics.stepTime = m_stepTime;
 }
 
 Ref< Body > PhysicsManagerJolt::createBody(resource::IResourceManager* resourceManager, const BodyDesc* desc, const Mesh* mesh, uint32_t collisionGroup, uint32_t collisionMask, const wchar_t* const tag)
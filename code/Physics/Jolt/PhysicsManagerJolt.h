@@ -25,7 +25,6 @@ namespace JPH
 
 class BroadPhaseLayerInterface;
 class ContactListener;
-class JobSystemThreadPool;
 class ObjectLayerPairFilter;
 class ObjectVsBroadPhaseLayerFilter;
 class PhysicsSystem;
@@ -37,6 +36,7 @@ namespace traktor::physics
 {
 
 class BodyJolt;
+class JobSystemJolt;
 class Joint;
 class ShapeDesc;
 
@@ -142,11 +142,38 @@ public:
 		AlignedVector< TriangleResult >& outTriangles
 	) const override final;
 
+	virtual void queryRays(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		bool ignoreBackFace,
+		AlignedVector< QueryResult >& outResults
+	) const override final;
+
+	virtual void queryShadowRays(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		uint32_t queryTypes,
+		AlignedVector< bool >& outHits
+	) const override final;
+
+	virtual void querySpheres(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		uint32_t queryTypes,
+		AlignedVector< RefArray< Body > >& outBodies
+	) const override final;
+
+	virtual void querySweeps(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		AlignedVector< QueryResult >& outResults
+	) const override final;
+
 	virtual void getStatistics(PhysicsStatistics& outStatistics) const override final;
 
 private:
 	AutoPtr< JPH::TempAllocatorImpl > m_tempAllocator;
-	AutoPtr< JPH::JobSystemThreadPool > m_jobSystem;
+	AutoPtr< JobSystemJolt > m_jobSystem;
 	AutoPtr< JPH::BroadPhaseLayerInterface > m_broadPhaseLayerInterface;
 	AutoPtr< JPH::ObjectVsBroadPhaseLayerFilter > m_objectVsBroadPhaseLayerFilter;
 	AutoPtr< JPH::ObjectLayerPairFilter > m_objectVsObjectLayerFilter;
@@ -154,6 +181,9 @@ private:
 	AutoPtr< JPH::PhysicsSystem > m_physicsSystem;
 	RefArray< BodyJolt > m_bodies;
 	float m_timeScale = 1.0f;
+	uint32_t m_jobCount = 0;
+	double m_jobTime = 0.0;
+	double m_stepTime = 0.0;
 
 	Ref< Body > createBody(resource::IResourceManager* resourceManager, const BodyDesc* desc, const Mesh* mesh, uint32_t collisionGroup, uint32_t collisionMask, const wchar_t* const tag);
 
@@ -6,11 +6,14 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <algorithm>
 #include "Core/Class/AutoRuntimeClass.h"
+#include "Core/Class/Boxes/BoxedAlignedVector.h"
 #include "Core/Class/Boxes/BoxedQuaternion.h"
 #include "Core/Class/Boxes/BoxedRefArray.h"
 #include "Core/Class/Boxes/BoxedTransform.h"
 #include "Core/Class/Boxes/BoxedVector4.h"
+#include "Core/Class/Boxes/BoxedVector4Array.h"
 #include "Core/Class/IRuntimeClassRegistrar.h"
 #include "Core/Class/IRuntimeDelegate.h"
 #include "Physics/BallJoint.h"
@@ -260,6 +263,90 @@ Ref< QueryResultWrapper > PhysicsManager_querySweep_2(
 		return nullptr;
 }
 
+void makeBatchQueries(
+	const AlignedVector< Vector4 >& ats,
+	const AlignedVector< Vector4 >& directions,
+	float maxLength,
+	float radius,
+	AlignedVector< BatchQuery >& outQueries
+)
+{
+	const size_t count = std::min(ats.size(), directions.size());
+	outQueries.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		outQueries[i].at = ats[i];
+		outQueries[i].direction = directions[i];
+		outQueries[i].maxLength = maxLength;
+		outQueries[i].radius = radius;
+	}
+}
+
+RefArray< QueryResultWrapper > PhysicsManager_queryRays(
+	PhysicsManager* self,
+	const AlignedVector< Vector4 >& ats,
+	const AlignedVector< Vector4 >& directions,
+	float maxLength,
+	const QueryFilterWrapper* queryFilter,
+	bool ignoreBackFace
+)
+{
+	AlignedVector< BatchQuery > queries;
+	makeBatchQueries(ats, directions, maxLength, 0.0f, queries);
+
+	AlignedVector< QueryResult > results;
+	self->queryRays(queries, *queryFilter, ignoreBackFace, results);
+
+	RefArray< QueryResultWrapper > wrappers(results.size());
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (results[i].body)
+			wrappers[i] = new QueryResultWrapper(results[i]);
+	}
+	return wrappers;
+}
+
+AlignedVector< bool > PhysicsManager_queryShadowRays(
+	PhysicsManager* self,
+	const AlignedVector< Vector4 >& ats,
+	const AlignedVector< Vector4 >& directions,
+	float maxLength,
+	const QueryFilterWrapper* queryFilter,
+	uint32_t queryTypes
+)
+{
+	AlignedVector< BatchQuery > queries;
+	makeBatchQueries(ats, directions, maxLength, 0.0f, queries);
+
+	AlignedVector< bool > hits;
+	self->queryShadowRays(queries, *queryFilter, queryTypes, hits);
+	return hits;
+}
+
+RefArray< QueryResultWrapper > PhysicsManager_querySweeps(
+	PhysicsManager* self,
+	const AlignedVector< Vector4 >& ats,
+	const AlignedVector< Vector4 >& directions,
+	float maxLength,
+	float radius,
+	const QueryFilterWrapper* queryFilter
+)
+{
+	AlignedVector< BatchQuery > queries;
+	makeBatchQueries(ats, directions, maxLength, radius, queries);
+
+	AlignedVector< QueryResult > results;
+	self->querySweeps(queries, *queryFilter, results);
+
+	RefArray< QueryResultWrapper > wrappers(results.size());
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (results[i].body)
+			wrappers[i] = new QueryResultWrapper(results[i]);
+	}
+	return wrappers;
+}
+
 	}
 
 T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.physics.PhysicsClassFactory", 0, PhysicsClassFactory, IRuntimeClassFactory)
@@ -294,6 +381,9 @@ void PhysicsClassFactory::createClasses(IRuntimeClassRegistrar* registrar) const
 	classPhysicsManager->addMethod("querySphere", &PhysicsManager_querySphere);
 	classPhysicsManager->addMethod("querySweep", &PhysicsManager_querySweep_1);
 	classPhysicsManager->addMethod("querySweep", &PhysicsManager_querySweep_2);
+	classPhysicsManager->addMethod("queryRays", &PhysicsManager_queryRays);
+	classPhysicsManager->addMethod("queryShadowRays", &PhysicsManager_queryShadowRays);
+	classPhysicsManager->addMethod("querySweeps", &PhysicsManager_querySweeps);
 	registrar->registerClass(classPhysicsManager);
 
 	auto classBody = new AutoRuntimeClass< Body >();
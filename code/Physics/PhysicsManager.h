@@ -56,6 +56,20 @@ struct QueryResult
 	int32_t material = 0;
 };
 
+/*! Batched ray, sweep or sphere query.
+ * \ingroup Physics
+ *
+ * Rays use at, direction and maxLength; sweeps
+ * also use radius and sphere queries only at and radius.
+ */
+struct BatchQuery
+{
+	Vector4 at = Vector4::origo();
+	Vector4 direction = Vector4::zero();
+	float maxLength = 0.0f;
+	float radius = 0.0f;
+};
+
 /*! Triangle result-
  * \ingroup Physics
  */
@@ -81,6 +95,7 @@ struct PhysicsCreateDesc
 	float timeScale = 1.0;
 	float simulationFrequency = 120.0f;	//!< Simulation frequency, default 120 Hz which is twice per default game update.
 	int32_t solverIterations = 8;		//!< Collision solver iterations.
+	uint32_t tempArenaSize = 10 * 1024 * 1024;	//!< Size of per-step temporary memory arena, in bytes, for backends which use one.
 };
 
 /*! Runtime statistics.
@@ -92,6 +107,9 @@ struct PhysicsStatistics
 	uint32_t activeCount;
 	uint32_t manifoldCount;
 	uint32_t queryCount;
+	uint32_t jobCount;	//!< Number of jobs executed during last step.
+	double jobTime;		//!< Accumulated time, in seconds, spent executing jobs during last step.
+	double stepTime;	//!< Time, in seconds, of last step.
 };
 
 /*! Query filter.
@@ -432,6 +450,63 @@ public:
 		AlignedVector< TriangleResult >& outTriangles
 	) const = 0;
 
+	/*! Ray cast world with a batch of rays.
+	 *
+	 * Rays are distributed across job manager's threads;
+	 * result of each ray is the same as if queryRay had been called.
+	 *
+	 * \param queries Rays.
+	 * \param queryFilter Query group and cluster filter.
+	 * \param ignoreBackFace Ignore intersection with back-facing surfaces.
+	 * \param outResults Intersection result of each ray, body is null if ray didn't intersect anything.
+	 */
+	virtual void queryRays(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		bool ignoreBackFace,
+		AlignedVector< QueryResult >& outResults
+	) const = 0;
+
+	/*! "Shadow" ray cast world with a batch of rays.
+	 *
+	 * \param queries Rays.
+	 * \param queryFilter Query group and cluster filter.
+	 * \param queryTypes Type of bodies, @sa QueryTypes
+	 * \param outHits True for each ray which intersect anything.
+	 */
+	virtual void queryShadowRays(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		uint32_t queryTypes,
+		AlignedVector< bool >& outHits
+	) const = 0;
+
+	/*! Get all bodies within each sphere of a batch.
+	 *
+	 * \param queries Spheres.
+	 * \param queryFilter Query group and cluster filter.
+	 * \param queryTypes Type of bodies, @sa QueryTypes
+	 * \param outBodies Array of intersecting bodies for each sphere.
+	 */
+	virtual void querySpheres(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		uint32_t queryTypes,
+		AlignedVector< RefArray< Body > >& outBodies
+	) const = 0;
+
+	/*! Get closest contact from each swept sphere of a batch.
+	 *
+	 * \param queries Swept spheres.
+	 * \param queryFilter Query group and cluster filter.
+	 * \param outResults Closest contact of each sweep, body is null if sweep didn't hit anything.
+	 */
+	virtual void querySweeps(
+		const AlignedVector< BatchQuery >& queries,
+		const QueryFilter& queryFilter,
+		AlignedVector< QueryResult >& outResults
+	) const = 0;
+
 	/*! Get runtime statistics.
 	 *
 	 * This method is mostly used for debugging
@@ -0,0 +1,300 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cmath>
+#include "Core/Guid.h"
+#include "Core/Log/Log.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "Physics/Body.h"
+#include "Physics/CollisionSpecification.h"
+#include "Physics/PhysicsManager.h"
+#include "Physics/SphereShapeDesc.h"
+#include "Physics/StaticBodyDesc.h"
+#include "Physics/Test/CaseBatchQuery.h"
+#include "Resource/IResourceManager.h"
+#include "Resource/ResourceBundleLoad.h"
+#include "Resource/ResourceHandle.h"
+
+namespace traktor::physics::test
+{
+	namespace
+	{
+
+const int32_t c_gridSize = 40;		//!< Bodies are placed in a grid of c_gridSize * c_gridSize.
+const int32_t c_queryCount = 8192;
+const Guid c_collisionGroup(L"{6F4AA1F5-9B5D-4E73-8C0C-3A1B2E5D7F10}");
+
+/*! Resource manager which bind every collision specification to first group. */
+class BatchQuery_ResourceManager : public resource::IResourceManager
+{
+public:
+	virtual void destroy() override final {}
+
+	virtual void addFactory(const resource::IResourceFactory* factory) override final {}
+
+	virtual void removeFactory(const resource::IResourceFactory* factory) override final {}
+
+	virtual void removeAllFactories() override final {}
+
+	virtual bool load(const resource::ResourceBundle* bundle) override final { return false; }
+
+	virtual Ref< resource::ResourceBundleLoad > loadAsync(const resource::ResourceBundle* bundle) override final { return nullptr; }
+
+	virtual Ref< resource::ResourceHandle > bind(const TypeInfo& productType, const Guid& guid) override final
+	{
+		if (&productType != &type_of< CollisionSpecification >())
+			return nullptr;
+
+		Ref< resource::ResourceHandle > handle = new resource::ResourceHandle();
+		handle->replace(new CollisionSpecification(1));
+		return handle;
+	}
+
+	virtual bool reload(const Guid& guid, bool flushedOnly) override final { return false; }
+
+	virtual void reload(const TypeInfo& productType, bool flushedOnly) override final {}
+
+	virtual void unload(const TypeInfo& productType) override final {}
+
+	virtual void unloadUnusedResident() override final {}
+
+	virtual void getStatistics(resource::ResourceManagerStatistics& outStatistics) const override final {}
+};
+
+bool sameResult(const QueryResult& a, const QueryResult& b)
+{
+	if (a.body != b.body)
+		return false;
+	if (!a.body)
+		return true;
+	return std::abs(a.distance - b.distance) <= 1e-3f;
+}
+
+void benchmark(PhysicsManager* physicsManager, bool& outAllEqual, uint32_t& outHits, double& outSingleTime, double& outBatchTime)
+{
+	Random random(1234);
+	const QueryFilter queryFilter(1);
+
+	AlignedVector< BatchQuery > queries(c_queryCount);
+	for (auto& query : queries)
+	{
+		query.at = Vector4(
+			(random.nextFloat() - 0.5f) * c_gridSize * 4.0f,
+			10.0f,
+			(random.nextFloat() - 0.5f) * c_gridSize * 4.0f,
+			1.0f
+		);
+		query.direction = Vector4(
+			random.nextFloat() - 0.5f,
+			-1.0f,
+			random.nextFloat() - 0.5f,
+			0.0f
+		).normalized();
+		query.maxLength = 40.0f;
+		query.radius = 0.25f;
+	}
+
+	AlignedVector< QueryResult > singleResults(c_queryCount);
+	AlignedVector< QueryResult > batchResults;
+
+	outAllEqual = true;
+	outHits = 0;
+	outSingleTime = 0.0;
+	outBatchTime = 0.0;
+
+	// Rays.
+	{
+		Timer timer;
+		for (int32_t i = 0; i < c_queryCount; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			singleResults[i] = QueryResult();
+			if (!physicsManager->queryRay(query.at, query.direction, query.maxLength, queryFilter, false, singleResults[i]))
+				singleResults[i] = QueryResult();
+		}
+		outSingleTime += timer.getElapsedTime();
+
+		timer.reset();
+		physicsManager->queryRays(queries, queryFilter, false, batchResults);
+		outBatchTime += timer.getElapsedTime();
+
+		outAllEqual &= (batchResults.size() == singleResults.size());
+		for (int32_t i = 0; outAllEqual && i < c_queryCount; ++i)
+		{
+			outAllEqual &= sameResult(singleResults[i], batchResults[i]);
+			outHits += singleResults[i].body ? 1 : 0;
+		}
+	}
+
+	// Sweeps.
+	{
+		Timer timer;
+		for (int32_t i = 0; i < c_queryCount; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			singleResults[i] = QueryResult();
+			if (!physicsManager->querySweep(query.at, query.direction, query.maxLength, query.radius, queryFilter, singleResults[i]))
+				singleResults[i] = QueryResult();
+		}
+		outSingleTime += timer.getElapsedTime();
+
+		timer.reset();
+		physicsManager->querySweeps(queries, queryFilter, batchResults);
+		outBatchTime += timer.getElapsedTime();
+
+		outAllEqual &= (batchResults.size() == singleResults.size());
+		for (int32_t i = 0; outAllEqual && i < c_queryCount; ++i)
+		{
+			outAllEqual &= sameResult(singleResults[i], batchResults[i]);
+			outHits += singleResults[i].body ? 1 : 0;
+		}
+	}
+
+	// Shadow rays.
+	{
+		AlignedVector< bool > singleHits(c_queryCount);
+		AlignedVector< bool > batchHits;
+
+		Timer timer;
+		for (int32_t i = 0; i < c_queryCount; ++i)
+		{
+			const BatchQuery& query = queries[i];
+			singleHits[i] = physicsManager->queryShadowRay(query.at, query.direction, query.maxLength, queryFilter, PhysicsManager::QtAll);
+		}
+		outSingleTime += timer.getElapsedTime();
+
+		timer.reset();
+		physicsManager->queryShadowRays(queries, queryFilter, PhysicsManager::QtAll, batchHits);
+		outBatchTime += timer.getElapsedTime();
+
+		outAllEqual &= (batchHits.size() == singleHits.size());
+		for (int32_t i = 0; outAllEqual && i < c_queryCount; ++i)
+		{
+			outAllEqual &= (singleHits[i] == batchHits[i]);
+			outHits += singleHits[i] ? 1 : 0;
+		}
+	}
+
+	// Spheres, placed at same height as bodies.
+	{
+		AlignedVector< BatchQuery > sphereQueries = queries;
+		for (auto& query : sphereQueries)
+		{
+			query.at.set(1, Scalar(0.0f));
+			query.radius = 2.0f;
+		}
+
+		AlignedVector< RefArray< Body > > singleBodies(c_queryCount);
+		AlignedVector< RefArray< Body > > batchBodies;
+
+		Timer timer;
+		for (int32_t i = 0; i < c_queryCount; ++i)
+		{
+			const BatchQuery& query = sphereQueries[i];
+			physicsManager->querySphere(query.at, query.radius, queryFilter, PhysicsManager::QtAll, singleBodies[i]);
+		}
+		outSingleTime += timer.getElapsedTime();
+
+		timer.reset();
+		physicsManager->querySpheres(sphereQueries, queryFilter, PhysicsManager::QtAll, batchBodies);
+		outBatchTime += timer.getElapsedTime();
+
+		outAllEqual &= (batchBodies.size() == singleBodies.size());
+		for (int32_t i = 0; outAllEqual && i < c_queryCount; ++i)
+		{
+			outAllEqual &= (singleBodies[i].size() == batchBodies[i].size());
+			for (uint32_t j = 0; outAllEqual && j < singleBodies[i].size(); ++j)
+				outAllEqual &= (singleBodies[i][j] == batchBodies[i][j]);
+			outHits += singleBodies[i].empty() ? 0 : 1;
+		}
+	}
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.physics.test.CaseBatchQuery", 0, CaseBatchQuery, traktor::test::Case)
+
+void CaseBatchQuery::run()
+{
+	BatchQuery_ResourceManager resourceManager;
+
+	// Benchmark each backend which is linked into the test runner.
+	int32_t backendCount = 0;
+	for (auto physicsManagerType : type_of< PhysicsManager >().findAllOf(false))
+	{
+		if (!physicsManagerType->isInstantiable())
+			continue;
+
+		Ref< PhysicsManager > physicsManager = dynamic_type_cast< PhysicsManager* >(physicsManagerType->createInstance());
+		if (!physicsManager)
+			continue;
+
+		PhysicsCreateDesc desc;
+		CASE_ASSERT(physicsManager->create(desc));
+
+		Ref< SphereShapeDesc > shapeDesc = new SphereShapeDesc();
+		shapeDesc->setRadius(1.0f);
+		shapeDesc->setCollisionGroup({ resource::Id< CollisionSpecification >(c_collisionGroup) });
+		shapeDesc->setCollisionMask({ resource::Id< CollisionSpecification >(c_collisionGroup) });
+
+		Ref< StaticBodyDesc > bodyDesc = new StaticBodyDesc();
+		bodyDesc->setShape(shapeDesc);
+
+		for (int32_t z = 0; z < c_gridSize; ++z)
+		{
+			for (int32_t x = 0; x < c_gridSize; ++x)
+			{
+				Ref< Body > body = physicsManager->createBody(&resourceManager, bodyDesc, L"BatchQuery");
+				CASE_ASSERT(body != nullptr);
+				if (!body)
+					continue;
+
+				body->setTransform(Transform(Vector4(
+					(x - c_gridSize / 2) * 4.0f,
+					0.0f,
+					(z - c_gridSize / 2) * 4.0f,
+					1.0f
+				)));
+				body->setEnable(true);
+			}
+		}
+
+		const QueryFilter queryFilter(1);
+
+		// Shadow ray straight down onto body at origin must hit, between bodies it must not.
+		CASE_ASSERT(physicsManager->queryShadowRay(Vector4(0.0f, 10.0f, 0.0f, 1.0f), Vector4(0.0f, -1.0f, 0.0f, 0.0f), 20.0f, queryFilter, PhysicsManager::QtAll));
+		CASE_ASSERT(!physicsManager->queryShadowRay(Vector4(2.0f, 10.0f, 2.0f, 1.0f), Vector4(0.0f, -1.0f, 0.0f, 0.0f), 20.0f, queryFilter, PhysicsManager::QtAll));
+		CASE_ASSERT(!physicsManager->queryShadowRay(Vector4(0.0f, 10.0f, 0.0f, 1.0f), Vector4(0.0f, -1.0f, 0.0f, 0.0f), 20.0f, queryFilter, PhysicsManager::QtDynamic));
+
+		// Small sphere at origin only touch body at origin, larger sphere in between touch four closest bodies.
+		RefArray< Body > sphereBodies;
+		CASE_ASSERT_EQUAL(physicsManager->querySphere(Vector4(0.0f, 0.0f, 0.0f, 1.0f), 0.5f, queryFilter, PhysicsManager::QtAll, sphereBodies), 1u);
+		CASE_ASSERT_EQUAL(physicsManager->querySphere(Vector4(2.0f, 0.0f, 2.0f, 1.0f), 3.5f, queryFilter, PhysicsManager::QtAll, sphereBodies), 4u);
+		CASE_ASSERT_EQUAL(physicsManager->querySphere(Vector4(2.0f, 0.0f, 2.0f, 1.0f), 3.5f, queryFilter, PhysicsManager::QtDynamic, sphereBodies), 0u);
+
+		bool allEqual;
+		uint32_t hits;
+		double singleTime, batchTime;
+		benchmark(physicsManager, allEqual, hits, singleTime, batchTime);
+
+		// Batched queries must return same results as single queries.
+		CASE_ASSERT(allEqual);
+
+		log::info << type_name(physicsManager) << L"; " << c_queryCount * 4 << L" queries (" << hits << L" hits), " << int32_t(singleTime * 1000000.0) << L" us single, " << int32_t(batchTime * 1000000.0) << L" us batched." << Endl;
+
+		physicsManager->destroy();
+		physicsManager = nullptr;
+		++backendCount;
+	}
+
+	if (backendCount == 0)
+		log::info << L"No physics backend available; batch query benchmark skipped." << Endl;
+}
+
+}
@@ -472,7 +472,8 @@ bool perform(const PipelineParameters& params)
 	if (params.getProgress())
 		statusListener.reset(new StatusListener());
 
-	// Build output.
+	// Build output; zero build threads means one build per core.
+	const int32_t buildThreads = settings->getProperty< bool >(L"Pipeline.BuildThreads", true) ? settings->getProperty< int32_t >(L"Pipeline.BuildThreads.Count", 0) : 1;
 	editor::PipelineBuilder pipelineBuilder(
 		&pipelineFactory,
 		sourceDatabaseAndCache.database,
@@ -481,7 +482,8 @@ bool perform(const PipelineParameters& params)
 		pipelineDb,
 		sourceDatabaseAndCache.cache,
 		statusListener.ptr(),
-		params.getVerbose()
+		params.getVerbose(),
+		buildThreads
 	);
 
 	if (params.getRebuild())
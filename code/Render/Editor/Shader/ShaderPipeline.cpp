@@ -187,6 +187,11 @@ bool ShaderPipeline::shouldCache() const
 	return true;
 }
 
+bool ShaderPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t ShaderPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	Ref< const ShaderGraph > shaderGraph = mandatory_non_null_type_cast< const ShaderGraph* >(sourceAsset);
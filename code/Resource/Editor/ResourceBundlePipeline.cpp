@@ -75,6 +75,11 @@ bool ResourceBundlePipeline::shouldCache() const
 	return false;
 }
 
+bool ResourceBundlePipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t ResourceBundlePipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
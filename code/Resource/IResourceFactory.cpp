@@ -13,4 +13,14 @@ namespace traktor::resource
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.resource.IResourceFactory", IResourceFactory, Object)
 
+bool IResourceFactory::isThreadSafe() const
+{
+	return false;
+}
+
+const TypeInfoSet IResourceFactory::getDependencyTypes(const TypeInfo& productType) const
+{
+	return TypeInfoSet();
+}
+
 }
@@ -87,6 +87,28 @@ public:
 	 */
 	virtual bool isCacheable(const TypeInfo& productType) const = 0;
 
+	/*! Check if factory can create resources concurrently.
+	 *
+	 * Resources from thread safe factories are created in
+	 * parallel when loading bundles; other factories are
+	 * only called with the resource manager locked so they
+	 * are never called concurrently.
+	 *
+	 * \return True if create is thread safe.
+	 */
+	virtual bool isThreadSafe() const;
+
+	/*! Get product types which must be created before given product type.
+	 *
+	 * When loading bundles, all resources of the returned
+	 * product types are created before any resource of
+	 * given product type.
+	 *
+	 * \param productType Type of product.
+	 * \return Set of product types.
+	 */
+	virtual const TypeInfoSet getDependencyTypes(const TypeInfo& productType) const;
+
 	/*! Create resource from guid.
 	 *
 	 * Create a specified resource from a guid.
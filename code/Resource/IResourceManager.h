@@ -27,6 +27,7 @@ namespace traktor::resource
 
 class IResourceFactory;
 class ResourceBundle;
+class ResourceBundleLoad;
 class ResourceHandle;
 
 /*! Resource manager statistics.
@@ -64,12 +65,25 @@ public:
 	virtual void removeAllFactories() = 0;
 
 	/*! Load all resources in bundle.
+	 *
+	 * Resources which fail to be created are skipped.
 	 *
 	 * \param bundle Resource bundle.
-	 * \return True if all resources loaded successfully.
+	 * \return False if any resource in bundle couldn't be found or has no factory.
 	 */
 	virtual bool load(const ResourceBundle* bundle) = 0;
 
+	/*! Load all resources in bundle asynchronously.
+	 *
+	 * Resources are loaded in parallel by the job manager,
+	 * and handles are returned immediately and filled in as
+	 * resources are created.
+	 *
+	 * \param bundle Resource bundle.
+	 * \return Pending bundle load.
+	 */
+	virtual Ref< ResourceBundleLoad > loadAsync(const ResourceBundle* bundle) = 0;
+
 	/*! Bind handle to resource identifier.
 	 *
 	 * \param productType Type of product.
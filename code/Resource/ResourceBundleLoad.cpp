@@ -0,0 +1,31 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "Resource/ResourceBundleLoad.h"
+#include "Resource/ResourceHandle.h"
+
+namespace traktor::resource
+{
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.resource.ResourceBundleLoad", ResourceBundleLoad, Object)
+
+float ResourceBundleLoad::getProgress() const
+{
+	if (m_handles.empty())
+		return m_completed ? 1.0f : 0.0f;
+	return (float)m_loaded / m_handles.size();
+}
+
+bool ResourceBundleLoad::wait(int32_t timeout)
+{
+	if (m_completed)
+		return true;
+	return m_eventCompleted.wait(timeout);
+}
+
+}
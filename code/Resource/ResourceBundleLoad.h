@@ -0,0 +1,80 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <atomic>
+#include "Core/Object.h"
+#include "Core/RefArray.h"
+#include "Core/Thread/Event.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_RESOURCE_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::resource
+{
+
+class ResourceHandle;
+
+/*! Pending load of a resource bundle.
+ * \ingroup Resource
+ *
+ * Handles are available immediately, in bundle order, and
+ * are filled in as resources are created by the loader.
+ * Handles of resources which cannot be preloaded, or fail
+ * to be created, are never filled in.
+ */
+class T_DLLCLASS ResourceBundleLoad : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	/*! Get handles of resources in bundle, one handle for each resource. */
+	const RefArray< ResourceHandle >& getHandles() const { return m_handles; }
+
+	/*! Number of resources in bundle. */
+	uint32_t getCount() const { return (uint32_t)m_handles.size(); }
+
+	/*! Number of resources processed, including failed and skipped resources. */
+	uint32_t getLoadedCount() const { return m_loaded; }
+
+	/*! Number of resources which failed to load. */
+	uint32_t getFailedCount() const { return m_failed; }
+
+	/*! Get progress, 0 to 1. */
+	float getProgress() const;
+
+	/*! Check if load has completed. */
+	bool completed() const { return m_completed; }
+
+	/*! Check if load has completed and all resources loaded successfully. */
+	bool succeeded() const { return m_completed && m_failed == 0; }
+
+	/*! Wait until load has completed.
+	 *
+	 * \param timeout Timeout in milliseconds; -1 if infinite timeout.
+	 * \return True if load has completed.
+	 */
+	bool wait(int32_t timeout = -1);
+
+private:
+	friend class ResourceManager;
+
+	RefArray< ResourceHandle > m_handles;
+	std::atomic< uint32_t > m_loaded = 0;
+	std::atomic< uint32_t > m_failed = 0;
+	std::atomic< bool > m_completed = false;
+	Event m_eventCompleted;
+};
+
+}
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include "Core/Log/Log.h"
 #include "Core/Thread/Acquire.h"
+#include "Core/Thread/JobManager.h"
 #include "Core/Thread/Thread.h"
 #include "Core/Thread/ThreadManager.h"
 #include "Database/Database.h"
@@ -16,6 +17,7 @@
 #include "Resource/ExclusiveResourceHandle.h"
 #include "Resource/IResourceFactory.h"
 #include "Resource/ResourceBundle.h"
+#include "Resource/ResourceBundleLoad.h"
 #include "Resource/ResourceManager.h"
 #include "Resource/ResidentResourceHandle.h"
 
@@ -37,6 +39,8 @@ ResourceManager::~ResourceManager()
 
 void ResourceManager::destroy()
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+
 	for (auto& residentHandle : m_residentHandles)
 		residentHandle.second->replace(nullptr);
 
@@ -74,70 +78,22 @@ void ResourceManager::removeAllFactories()
 
 bool ResourceManager::load(const ResourceBundle* bundle)
 {
-	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
-	for (const auto& resource : bundle->get())
-	{
-		// Get resource instance from database.
-		Ref< db::Instance > instance = m_database->getInstance(resource.second);
-		if (!instance)
-		{
-			log::error << L"Unable to preload resource " << resource.second.format() << L"; no such instance." << Endl;
-			return false;
-		}
-
-		// Get type of resource.
-		const TypeInfo* resourceType = instance->getPrimaryType();
-		if (!resourceType)
-		{
-			log::error << L"Unable to preload resource " << resource.second.format() << L"; unable to read resource type." << Endl;
-			return false;
-		}
-
-		// Find factory which can create products from resource.
-		const IResourceFactory* factory = findFactory(*resourceType);
-		if (!factory)
-		{
-			log::error << L"Unable to preload resource " << resource.second.format() << L"; no factory for specified resource type \"" << resourceType->getName() << L"\"." << Endl;
-			return false;
-		}
-
-		// Determine product type; must be explicitly determined if we can safely preload the resource.
-		const TypeInfoSet productTypes = factory->getProductTypes(*resourceType);
-		if (productTypes.size() != 1)
-		{
-			log::warning << L"Unable to preload resource " << resource.second.format() << L"; unable to determine product type, skipped." << Endl;
-			continue;
-		}
-
-		const bool cacheable = factory->isCacheable(*resource.first);
-		if (!cacheable)
-		{
-			log::warning << L"Unable to preload resource " << resource.second.format() << L"; resource non cacheable, skipped." << Endl;
-			continue;
-		}
-
-		Ref< ResidentResourceHandle > residentHandle = m_residentHandles[resource.second];
-		if (residentHandle == nullptr || residentHandle->get() == nullptr)
-		{
-			const TypeInfo& productType = *(*productTypes.begin());
+	// Resources which fail to be created are skipped, as reported by bundle load.
+	Ref< ResourceBundleLoad > bundleLoad = beginLoad(bundle);
+	return loadBundle(bundle, bundleLoad);
+}
 
-			if (!residentHandle)
-			{
-				residentHandle = new ResidentResourceHandle(productType, bundle->persistent());
-				m_residentHandles[resource.second] = residentHandle;
-			}
+Ref< ResourceBundleLoad > ResourceManager::loadAsync(const ResourceBundle* bundle)
+{
+	Ref< ResourceBundleLoad > bundleLoad = beginLoad(bundle);
 
-			load(instance, factory, productType, residentHandle);
+	Ref< ResourceManager > self = this;
+	Ref< const ResourceBundle > bundleRef = bundle;
+	JobManager::getInstance().add([=]() {
+		self->loadBundle(bundleRef, bundleLoad);
+	});
 
-			if (!residentHandle->get())
-			{
-				log::error << L"Unable to preload resource " << resource.second.format() << L"; skipped." << Endl;
-				continue;
-			}
-		}
-	}
-
-	return true;
+	return bundleLoad;
 }
 
 Ref< ResourceHandle > ResourceManager::bind(const TypeInfo& productType, const Guid& guid)
@@ -168,7 +124,7 @@ Ref< ResourceHandle > ResourceManager::bind(const TypeInfo& productType, const G
 	}
 
 	// Find factory which can create products from resource.
-	const IResourceFactory* factory = findFactory(*resourceType);
+	Ref< const IResourceFactory > factory = findFactory(*resourceType);
 	if (!factory)
 	{
 		log::error << L"Unable to bind a " << productType.getName() << L" resource; no factory for instance type \"" << resourceType->getName() << L"\" (" << guid.format() << L")." << Endl;
@@ -239,7 +195,7 @@ bool ResourceManager::reload(const Guid& guid, bool flushedOnly)
 		return false;
 
 	// Find factory which can create products from resource.
-	const IResourceFactory* factory = findFactory(*resourceType);
+	Ref< const IResourceFactory > factory = findFactory(*resourceType);
 	if (!factory)
 		return false;
 
@@ -290,7 +246,7 @@ void ResourceManager::reload(const TypeInfo& productType, bool flushedOnly)
 			continue;
 
 		// Find factory which can create products from resource.
-		const IResourceFactory* factory = findFactory(*resourceType);
+		Ref< const IResourceFactory > factory = findFactory(*resourceType);
 		if (!factory)
 			continue;
 
@@ -324,7 +280,7 @@ void ResourceManager::reload(const TypeInfo& productType, bool flushedOnly)
 				continue;
 
 			// Find factory which can create products from resource.
-			const IResourceFactory* factory = findFactory(*resourceType);
+			Ref< const IResourceFactory > factory = findFactory(*resourceType);
 			if (!factory)
 				continue;
 
@@ -397,8 +353,9 @@ void ResourceManager::getStatistics(ResourceManagerStatistics& outStatistics) co
 	m_lock.release();
 }
 
-const IResourceFactory* ResourceManager::findFactory(const TypeInfo& resourceType) const
+Ref< const IResourceFactory > ResourceManager::findFactory(const TypeInfo& resourceType) const
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	for (auto i = m_resourceFactories.begin(); i != m_resourceFactories.end(); ++i)
 	{
 		if (is_type_of(*i->first, resourceType))
@@ -407,6 +364,240 @@ const IResourceFactory* ResourceManager::findFactory(const TypeInfo& resourceTyp
 	return nullptr;
 }
 
+Ref< ResourceBundleLoad > ResourceManager::beginLoad(const ResourceBundle* bundle)
+{
+	Ref< ResourceBundleLoad > bundleLoad = new ResourceBundleLoad();
+	bundleLoad->m_handles.reserve(bundle->get().size());
+
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	for (const auto& resource : bundle->get())
+	{
+		Ref< ResidentResourceHandle >& residentHandle = m_residentHandles[resource.second];
+		if (!residentHandle)
+			residentHandle = new ResidentResourceHandle(*resource.first, bundle->persistent());
+		bundleLoad->m_handles.push_back(residentHandle);
+	}
+
+	return bundleLoad;
+}
+
+bool ResourceManager::loadBundle(const ResourceBundle* bundle, ResourceBundleLoad* bundleLoad)
+{
+	struct Entry
+	{
+		Ref< db::Instance > instance;
+		Ref< const IResourceFactory > factory;
+		const TypeInfo* productType = nullptr;
+		int32_t phase = 0;
+		bool unresolved = false;
+	};
+
+	const auto& resources = bundle->get();
+	const int32_t count = (int32_t)resources.size();
+	AlignedVector< Entry > entries(count);
+
+	// Keep factories referenced while loading, factories might be removed meanwhile.
+	AlignedVector< std::pair< const TypeInfo*, Ref< const IResourceFactory > > > resourceFactories;
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		resourceFactories = m_resourceFactories;
+	}
+
+	// Resolve instances and factories; entries without a factory are either already loaded or skipped.
+	JobManager::getInstance().parallelFor(count, 64, [&](int32_t from, int32_t to) {
+		for (int32_t i = from; i < to; ++i)
+		{
+			const auto& resource = resources[i];
+			Entry& entry = entries[i];
+
+			if (bundleLoad->m_handles[i]->get() != nullptr)
+			{
+				bundleLoad->m_loaded++;
+				continue;
+			}
+
+			// Get resource instance from database.
+			entry.instance = m_database->getInstance(resource.second);
+			if (!entry.instance)
+			{
+				log::error << L"Unable to preload resource " << resource.second.format() << L"; no such instance." << Endl;
+				entry.unresolved = true;
+				bundleLoad->m_failed++;
+				bundleLoad->m_loaded++;
+				continue;
+			}
+
+			// Get type of resource.
+			const TypeInfo* resourceType = entry.instance->getPrimaryType();
+			if (!resourceType)
+			{
+				log::error << L"Unable to preload resource " << resource.second.format() << L"; unable to read resource type." << Endl;
+				entry.unresolved = true;
+				bundleLoad->m_failed++;
+				bundleLoad->m_loaded++;
+				continue;
+			}
+
+			// Find factory which can create products from resource.
+			const IResourceFactory* factory = nullptr;
+			for (const auto& resourceFactory : resourceFactories)
+			{
+				if (is_type_of(*resourceFactory.first, *resourceType))
+				{
+					factory = resourceFactory.second;
+					break;
+				}
+			}
+			if (!factory)
+			{
+				log::error << L"Unable to preload resource " << resource.second.format() << L"; no factory for specified resource type \"" << resourceType->getName() << L"\"." << Endl;
+				entry.unresolved = true;
+				bundleLoad->m_failed++;
+				bundleLoad->m_loaded++;
+				continue;
+			}
+
+			// Determine product type; must be explicitly determined if we can safely preload the resource.
+			const TypeInfoSet productTypes = factory->getProductTypes(*resourceType);
+			if (productTypes.size() != 1)
+			{
+				log::warning << L"Unable to preload resource " << resource.second.format() << L"; unable to determine product type, skipped." << Endl;
+				bundleLoad->m_loaded++;
+				continue;
+			}
+
+			const bool cacheable = factory->isCacheable(*resource.first);
+			if (!cacheable)
+			{
+				log::warning << L"Unable to preload resource " << resource.second.format() << L"; resource non cacheable, skipped." << Endl;
+				bundleLoad->m_loaded++;
+				continue;
+			}
+
+			entry.factory = factory;
+			entry.productType = *productTypes.begin();
+		}
+	});
+
+	// Resources which cannot be preloaded must not be resident; handles
+	// are kept in bundle load but are never loaded.
+	bool resolved = true;
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		for (int32_t i = 0; i < count; ++i)
+		{
+			const Entry& entry = entries[i];
+			if (entry.unresolved)
+				resolved = false;
+
+			ResourceHandle* handle = bundleLoad->m_handles[i];
+			if (entry.factory != nullptr || handle->get() != nullptr)
+				continue;
+
+			auto it = m_residentHandles.find(resources[i].second);
+			if (it != m_residentHandles.end() && it->second == handle)
+				m_residentHandles.erase(it);
+		}
+	}
+
+	// Gather dependency types of each product type in bundle.
+	SmallMap< const TypeInfo*, TypeInfoSet > dependencyTypes;
+	for (const auto& entry : entries)
+	{
+		if (entry.factory != nullptr && dependencyTypes.find(entry.productType) == dependencyTypes.end())
+			dependencyTypes[entry.productType] = entry.factory->getDependencyTypes(*entry.productType);
+	}
+
+	// Assign phases to product types so dependencies are created in earlier phases;
+	// phases are bounded by number of types to break any cyclic dependencies.
+	SmallMap< const TypeInfo*, int32_t > phases;
+	for (const auto& it : dependencyTypes)
+		phases[it.first] = 0;
+
+	const int32_t maxPhase = (int32_t)phases.size();
+	for (bool changed = true; changed; )
+	{
+		changed = false;
+		for (const auto& it : dependencyTypes)
+		{
+			int32_t& phase = phases[it.first];
+			for (const auto dependencyType : it.second)
+			{
+				for (const auto& other : phases)
+				{
+					if (other.first != it.first && is_type_of(*dependencyType, *other.first) && phase <= other.second && other.second < maxPhase)
+					{
+						phase = other.second + 1;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	int32_t lastPhase = 0;
+	for (auto& entry : entries)
+	{
+		if (entry.factory != nullptr)
+		{
+			entry.phase = phases[entry.productType];
+			lastPhase = std::max(lastPhase, entry.phase);
+		}
+	}
+
+	auto create = [&](int32_t index) {
+		const Entry& entry = entries[index];
+		ResourceHandle* handle = bundleLoad->m_handles[index];
+		if (handle->get() == nullptr)
+		{
+			load(entry.instance, entry.factory, *entry.productType, handle);
+			if (!handle->get())
+			{
+				log::error << L"Unable to preload resource " << resources[index].second.format() << L"; skipped." << Endl;
+				bundleLoad->m_failed++;
+			}
+		}
+		bundleLoad->m_loaded++;
+	};
+
+	// Create resources phase by phase; thread safe factories create in parallel, then
+	// resources from other factories are created sequentially on this thread.
+	AlignedVector< int32_t > parallel;
+	AlignedVector< int32_t > sequential;
+	for (int32_t phase = 0; phase <= lastPhase; ++phase)
+	{
+		parallel.resize(0);
+		sequential.resize(0);
+
+		for (int32_t i = 0; i < count; ++i)
+		{
+			const Entry& entry = entries[i];
+			if (entry.factory == nullptr || entry.phase != phase)
+				continue;
+
+			if (entry.factory->isThreadSafe())
+				parallel.push_back(i);
+			else
+				sequential.push_back(i);
+		}
+
+		if (!parallel.empty())
+		{
+			JobManager::getInstance().parallelFor((int32_t)parallel.size(), 4, [&](int32_t from, int32_t to) {
+				for (int32_t i = from; i < to; ++i)
+					create(parallel[i]);
+			});
+		}
+
+		for (auto index : sequential)
+			create(index);
+	}
+
+	bundleLoad->m_completed = true;
+	bundleLoad->m_eventCompleted.broadcast();
+	return resolved;
+}
+
 void ResourceManager::load(const db::Instance* instance, const IResourceFactory* factory, const TypeInfo& productType, ResourceHandle* handle)
 {
 	Thread* currentThread = ThreadManager::getInstance().getCurrentThread();
@@ -420,7 +611,15 @@ void ResourceManager::load(const db::Instance* instance, const IResourceFactory*
 		return;
 	}
 
-	Ref< Object > object = factory->create(this, m_database, instance, productType, handle->get());
+	// Factories which aren't thread safe are only called with manager locked.
+	Ref< Object > object;
+	if (factory->isThreadSafe())
+		object = factory->create(this, m_database, instance, productType, handle->get());
+	else
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		object = factory->create(this, m_database, instance, productType, handle->get());
+	}
 	if (object)
 	{
 		if (m_verbose)
@@ -59,6 +59,8 @@ public:
 
 	virtual bool load(const ResourceBundle* bundle) override final;
 
+	virtual Ref< ResourceBundleLoad > loadAsync(const ResourceBundle* bundle) override final;
+
 	virtual Ref< ResourceHandle > bind(const TypeInfo& productType, const Guid& guid) override final;
 
 	virtual bool reload(const Guid& guid, bool flushedOnly) override final;
@@ -79,7 +81,15 @@ private:
 	mutable Semaphore m_lock;
 	bool m_verbose;
 
-	const IResourceFactory* findFactory(const TypeInfo& resourceType) const;
+	Ref< const IResourceFactory > findFactory(const TypeInfo& resourceType) const;
+
+	Ref< ResourceBundleLoad > beginLoad(const ResourceBundle* bundle);
+
+	/*! Load resources of bundle.
+	 *
+	 * \return False if any resource couldn't be resolved; resources which fail to be created are skipped.
+	 */
+	bool loadBundle(const ResourceBundle* bundle, ResourceBundleLoad* bundleLoad);
 
 	void load(const db::Instance* instance, const IResourceFactory* factory, const TypeInfo& productType, ResourceHandle* handle);
 };
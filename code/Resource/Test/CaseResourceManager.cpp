@@ -0,0 +1,402 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include "Core/Log/Log.h"
+#include "Core/Misc/String.h"
+#include "Core/Thread/ThreadManager.h"
+#include "Core/Timer/Timer.h"
+#include "Database/Database.h"
+#include "Database/Instance.h"
+#include "Database/Provider/IProviderDatabase.h"
+#include "Database/Provider/IProviderGroup.h"
+#include "Database/Provider/IProviderInstance.h"
+#include "Resource/IResourceFactory.h"
+#include "Resource/ResourceBundle.h"
+#include "Resource/ResourceBundleLoad.h"
+#include "Resource/ResourceHandle.h"
+#include "Resource/ResourceManager.h"
+#include "Resource/Test/CaseResourceManager.h"
+
+namespace traktor::resource::test
+{
+	namespace
+	{
+
+const int32_t c_resourceCount = 10000;
+const int32_t c_dependentCount = 1000;
+
+class ResourceManager_ResourceA : public Object
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.resource.test.ResourceManager_ResourceA", ResourceManager_ResourceA, Object)
+
+class ResourceManager_ResourceB : public Object
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.resource.test.ResourceManager_ResourceB", ResourceManager_ResourceB, Object)
+
+class ResourceManager_Product : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	int32_t m_sequence = 0;
+	uint32_t m_value = 0;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.resource.test.ResourceManager_Product", ResourceManager_Product, Object)
+
+class ResourceManager_ProductA : public ResourceManager_Product
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.resource.test.ResourceManager_ProductA", 0, ResourceManager_ProductA, ResourceManager_Product)
+
+class ResourceManager_ProductB : public ResourceManager_Product
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.resource.test.ResourceManager_ProductB", 0, ResourceManager_ProductB, ResourceManager_Product)
+
+/*! Read-only, in memory, database provider. */
+class TestProviderInstance : public db::IProviderInstance
+{
+public:
+	explicit TestProviderInstance(const Guid& guid, const std::wstring& primaryTypeName)
+	:	m_guid(guid)
+	,	m_primaryTypeName(primaryTypeName)
+	{
+	}
+
+	virtual std::wstring getPrimaryTypeName() const override final { return m_primaryTypeName; }
+
+	virtual bool openTransaction() override final { return false; }
+
+	virtual bool commitTransaction() override final { return false; }
+
+	virtual bool closeTransaction() override final { return false; }
+
+	virtual std::wstring getName() const override final { return m_guid.format(); }
+
+	virtual bool setName(const std::wstring& name) override final { return false; }
+
+	virtual Guid getGuid() const override final { return m_guid; }
+
+	virtual bool setGuid(const Guid& guid) override final { return false; }
+
+	virtual bool getLastModifyDate(DateTime& outModifyDate) const override final { return false; }
+
+	virtual uint32_t getFlags() const override final { return 0; }
+
+	virtual bool remove() override final { return false; }
+
+	virtual Ref< IStream > readObject(const TypeInfo*& outSerializerType) const override final { return nullptr; }
+
+	virtual Ref< IStream > writeObject(const std::wstring& primaryTypeName, const TypeInfo*& outSerializerType) override final { return nullptr; }
+
+	virtual uint32_t getDataNames(AlignedVector< std::wstring >& outDataNames) const override final { return 0; }
+
+	virtual bool getDataLastWriteTime(const std::wstring& dataName, DateTime& outLastWriteTime) const override final { return false; }
+
+	virtual bool removeAllData() override final { return false; }
+
+	virtual Ref< IStream > readData(const std::wstring& dataName) const override final { return nullptr; }
+
+	virtual Ref< IStream > writeData(const std::wstring& dataName) override final { return nullptr; }
+
+private:
+	Guid m_guid;
+	std::wstring m_primaryTypeName;
+};
+
+class TestProviderGroup : public db::IProviderGroup
+{
+public:
+	RefArray< db::IProviderInstance > m_instances;
+
+	virtual std::wstring getName() const override final { return L""; }
+
+	virtual uint32_t getFlags() const override final { return 0; }
+
+	virtual bool rename(const std::wstring& name) override final { return false; }
+
+	virtual bool remove() override final { return false; }
+
+	virtual Ref< db::IProviderGroup > createGroup(const std::wstring& groupName) override final { return nullptr; }
+
+	virtual Ref< db::IProviderInstance > createInstance(const std::wstring& instanceName, const Guid& instanceGuid) override final { return nullptr; }
+
+	virtual bool getChildren(RefArray< db::IProviderGroup >& outChildGroups, RefArray< db::IProviderInstance >& outChildInstances) override final
+	{
+		outChildInstances = m_instances;
+		return true;
+	}
+};
+
+class TestProviderDatabase : public db::IProviderDatabase
+{
+public:
+	Ref< TestProviderGroup > m_rootGroup = new TestProviderGroup();
+
+	virtual bool create(const db::ConnectionString& connectionString) override final { return false; }
+
+	virtual bool open(const db::ConnectionString& connectionString) override final { return false; }
+
+	virtual void close() override final {}
+
+	virtual db::IProviderBus* getBus() override final { return nullptr; }
+
+	virtual db::IProviderGroup* getRootGroup() override final { return m_rootGroup; }
+};
+
+/*! Factory doing a fixed amount of work per resource, and tracking creation order. */
+class TestFactory : public IResourceFactory
+{
+public:
+	mutable std::atomic< int32_t > m_active = 0;
+	mutable std::atomic< int32_t > m_maxActive = 0;
+	mutable std::atomic< int32_t > m_otherThreadCount = 0;
+	Thread* m_thread = nullptr;
+
+	explicit TestFactory(const TypeInfo& resourceType, const TypeInfo& productType, const TypeInfo* dependencyType, bool threadSafe, std::atomic< int32_t >& sequence)
+	:	m_resourceType(resourceType)
+	,	m_productType(productType)
+	,	m_dependencyType(dependencyType)
+	,	m_threadSafe(threadSafe)
+	,	m_sequence(sequence)
+	{
+	}
+
+	virtual bool initialize(const ObjectStore& objectStore) override final { return true; }
+
+	virtual const TypeInfoSet getResourceTypes() const override final { return makeTypeInfoSet(m_resourceType); }
+
+	virtual const TypeInfoSet getProductTypes(const TypeInfo& resourceType) const override final { return makeTypeInfoSet(m_productType); }
+
+	virtual bool isCacheable(const TypeInfo& productType) const override final { return true; }
+
+	virtual bool isThreadSafe() const override final { return m_threadSafe; }
+
+	virtual const TypeInfoSet getDependencyTypes(const TypeInfo& productType) const override final
+	{
+		return m_dependencyType ? makeTypeInfoSet(*m_dependencyType) : TypeInfoSet();
+	}
+
+	virtual Ref< Object > create(IResourceManager* resourceManager, const db::Database* database, const db::Instance* instance, const TypeInfo& productType, const Object* current) const override final
+	{
+		const int32_t active = ++m_active;
+		for (int32_t maxActive = m_maxActive; active > maxActive && !m_maxActive.compare_exchange_weak(maxActive, active); )
+			;
+
+		if (m_thread != nullptr && ThreadManager::getInstance().getCurrentThread() != m_thread)
+			++m_otherThreadCount;
+
+		// Simulate decoding of resource data.
+		const Guid guid = instance->getGuid();
+		uint32_t value = 2166136261u;
+		for (int32_t i = 0; i < 20000; ++i)
+			value = (value ^ guid[i & 15]) * 16777619u;
+
+		Ref< ResourceManager_Product > product = checked_type_cast< ResourceManager_Product* >(m_productType.createInstance());
+		product->m_sequence = m_sequence++;
+		product->m_value = value;
+
+		--m_active;
+		return product;
+	}
+
+private:
+	const TypeInfo& m_resourceType;
+	const TypeInfo& m_productType;
+	const TypeInfo* m_dependencyType;
+	bool m_threadSafe;
+	std::atomic< int32_t >& m_sequence;
+};
+
+Ref< db::Database > createDatabase(AlignedVector< Guid >& outResourcesA, AlignedVector< Guid >& outResourcesB)
+{
+	Ref< TestProviderDatabase > providerDatabase = new TestProviderDatabase();
+
+	for (int32_t i = 0; i < c_resourceCount; ++i)
+	{
+		const Guid guid = Guid::create();
+		providerDatabase->m_rootGroup->m_instances.push_back(new TestProviderInstance(guid, type_name< ResourceManager_ResourceA >()));
+		outResourcesA.push_back(guid);
+	}
+
+	for (int32_t i = 0; i < c_dependentCount; ++i)
+	{
+		const Guid guid = Guid::create();
+		providerDatabase->m_rootGroup->m_instances.push_back(new TestProviderInstance(guid, type_name< ResourceManager_ResourceB >()));
+		outResourcesB.push_back(guid);
+	}
+
+	Ref< db::Database > database = new db::Database();
+	if (!database->open(providerDatabase))
+		return nullptr;
+
+	return database;
+}
+
+template < typename ProductType >
+bool allLoaded(const ResourceBundleLoad* bundleLoad)
+{
+	for (auto handle : bundleLoad->getHandles())
+	{
+		if (!handle || !is_a< ProductType >(handle->get()))
+			return false;
+	}
+	return true;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.resource.test.CaseResourceManager", 0, CaseResourceManager, traktor::test::Case)
+
+void CaseResourceManager::run()
+{
+	AlignedVector< Guid > resourcesA, resourcesB;
+	Ref< db::Database > database = createDatabase(resourcesA, resourcesB);
+	CASE_ASSERT(database != nullptr);
+	if (!database)
+		return;
+
+	AlignedVector< std::pair< const TypeInfo*, Guid > > entriesA;
+	for (const auto& guid : resourcesA)
+		entriesA.push_back(std::make_pair(&type_of< ResourceManager_ProductA >(), guid));
+	Ref< ResourceBundle > bundleA = new ResourceBundle(entriesA, false);
+
+	double durations[2] = { 0.0, 0.0 };
+
+	// Load same bundle with non thread safe factory, then with a thread safe factory.
+	for (int32_t i = 0; i < 2; ++i)
+	{
+		const bool threadSafe = (i == 1);
+		std::atomic< int32_t > sequence = 0;
+
+		Ref< TestFactory > factory = new TestFactory(type_of< ResourceManager_ResourceA >(), type_of< ResourceManager_ProductA >(), nullptr, threadSafe, sequence);
+		Ref< ResourceManager > resourceManager = new ResourceManager(database, false);
+		resourceManager->addFactory(factory);
+
+		Timer timer;
+		Ref< ResourceBundleLoad > bundleLoad = resourceManager->loadAsync(bundleA);
+		CASE_ASSERT(bundleLoad != nullptr);
+		CASE_ASSERT_EQUAL(bundleLoad->getCount(), (uint32_t)c_resourceCount);
+		CASE_ASSERT(bundleLoad->getHandles().size() == c_resourceCount);
+
+		CASE_ASSERT(bundleLoad->wait());
+		durations[i] = timer.getElapsedTime();
+
+		CASE_ASSERT(bundleLoad->completed());
+		CASE_ASSERT(bundleLoad->succeeded());
+		CASE_ASSERT_EQUAL(bundleLoad->getLoadedCount(), (uint32_t)c_resourceCount);
+		CASE_ASSERT_EQUAL(bundleLoad->getFailedCount(), 0u);
+		CASE_ASSERT_EQUAL(bundleLoad->getProgress(), 1.0f);
+		CASE_ASSERT(allLoaded< ResourceManager_ProductA >(bundleLoad));
+		CASE_ASSERT_EQUAL((int32_t)sequence, c_resourceCount);
+
+		// Non thread safe factories must never be called concurrently.
+		if (!threadSafe)
+			CASE_ASSERT_EQUAL((int32_t)factory->m_maxActive, 1);
+
+		// Handles from bind are same as handles from bundle.
+		Ref< ResourceHandle > handle = resourceManager->bind(type_of< ResourceManager_ProductA >(), resourcesA[0]);
+		CASE_ASSERT(handle == bundleLoad->getHandles()[0]);
+
+		// Loading bundle again should not create any resources.
+		CASE_ASSERT(resourceManager->load(bundleA));
+		CASE_ASSERT_EQUAL((int32_t)sequence, c_resourceCount);
+
+		resourceManager->destroy();
+	}
+
+	// Synchronous load must create resources of non thread safe factories on calling thread.
+	{
+		std::atomic< int32_t > sequence = 0;
+
+		Ref< TestFactory > factory = new TestFactory(type_of< ResourceManager_ResourceA >(), type_of< ResourceManager_ProductA >(), nullptr, false, sequence);
+		factory->m_thread = ThreadManager::getInstance().getCurrentThread();
+
+		Ref< ResourceManager > resourceManager = new ResourceManager(database, false);
+		resourceManager->addFactory(factory);
+
+		CASE_ASSERT(resourceManager->load(bundleA));
+		CASE_ASSERT_EQUAL((int32_t)sequence, c_resourceCount);
+		CASE_ASSERT_EQUAL((int32_t)factory->m_otherThreadCount, 0);
+		CASE_ASSERT_EQUAL((int32_t)factory->m_maxActive, 1);
+
+		resourceManager->destroy();
+	}
+
+	log::info << L"Loaded " << c_resourceCount << L" resources in " << int32_t(durations[0] * 1000.0) << L" ms sequentially, " << int32_t(durations[1] * 1000.0) << L" ms in parallel." << Endl;
+
+	// Interleave dependent resources into bundle; all dependencies must be created before dependent resources.
+	{
+		std::atomic< int32_t > sequence = 0;
+
+		Ref< TestFactory > factoryA = new TestFactory(type_of< ResourceManager_ResourceA >(), type_of< ResourceManager_ProductA >(), nullptr, true, sequence);
+		Ref< TestFactory > factoryB = new TestFactory(type_of< ResourceManager_ResourceB >(), type_of< ResourceManager_ProductB >(), &type_of< ResourceManager_ProductA >(), false, sequence);
+
+		Ref< ResourceManager > resourceManager = new ResourceManager(database, false);
+		resourceManager->addFactory(factoryA);
+		resourceManager->addFactory(factoryB);
+
+		AlignedVector< std::pair< const TypeInfo*, Guid > > entries;
+		for (int32_t i = 0; i < c_resourceCount; ++i)
+		{
+			if (i < c_dependentCount)
+				entries.push_back(std::make_pair(&type_of< ResourceManager_ProductB >(), resourcesB[i]));
+			entries.push_back(std::make_pair(&type_of< ResourceManager_ProductA >(), resourcesA[i]));
+		}
+
+		// Unknown resource fails but doesn't prevent other resources from loading.
+		entries.push_back(std::make_pair(&type_of< ResourceManager_ProductA >(), Guid::create()));
+
+		Ref< ResourceBundle > bundle = new ResourceBundle(entries, false);
+		Ref< ResourceBundleLoad > bundleLoad = resourceManager->loadAsync(bundle);
+		CASE_ASSERT(bundleLoad->wait());
+		CASE_ASSERT(!bundleLoad->succeeded());
+		CASE_ASSERT_EQUAL(bundleLoad->getFailedCount(), 1u);
+		CASE_ASSERT_EQUAL(bundleLoad->getLoadedCount(), (uint32_t)entries.size());
+
+		int32_t lastA = std::numeric_limits< int32_t >::min();
+		int32_t firstB = std::numeric_limits< int32_t >::max();
+		int32_t loadedCount = 0;
+		for (auto handle : bundleLoad->getHandles())
+		{
+			if (auto productA = dynamic_type_cast< ResourceManager_ProductA* >(handle->get()))
+				lastA = std::max(lastA, productA->m_sequence);
+			else if (auto productB = dynamic_type_cast< ResourceManager_ProductB* >(handle->get()))
+				firstB = std::min(firstB, productB->m_sequence);
+			else
+				continue;
+			++loadedCount;
+		}
+
+		CASE_ASSERT_EQUAL(loadedCount, c_resourceCount + c_dependentCount);
+		CASE_ASSERT(lastA < firstB);
+
+		// Synchronous load report unknown resource.
+		CASE_ASSERT(!resourceManager->load(bundle));
+
+		resourceManager->destroy();
+	}
+
+	database->close();
+}
+
+}
@@ -25,6 +25,7 @@ namespace traktor::sound
 	{
 
 const uint32_t c_outputSamplesBlockCount = 16;
+const uint32_t c_maxSkipBlocks = 32;	//!< Maximum number of blocks skipped each frame when starting at an offset.
 
 inline void moveSamples(float* destSamples, const float* sourceSamples, int32_t samplesCount)
 {
@@ -62,6 +63,7 @@ AudioChannel::AudioChannel(uint32_t id, uint32_t hwSampleRate, uint32_t hwFrameS
 ,	m_playing(false)
 ,	m_allowRepeat(false)
 ,	m_outputSamplesIn(0)
+,	m_stateSequence(0)
 {
 	const uint32_t outputSamplesCount = hwFrameSamples * c_outputSamplesBlockCount;
 	const uint32_t outputSamplesSize = SbcMaxChannelCount * outputSamplesCount * sizeof(float);
@@ -121,7 +123,9 @@ bool AudioChannel::isPlaying() const
 
 void AudioChannel::stop()
 {
-	m_stateSoundFifo.put({});
+	StateSound ss;
+	ss.sequence = ++m_stateSequence;
+	m_stateSoundFifo.put(ss);
 	m_playing = false;
 	m_allowRepeat = false;
 }
@@ -148,7 +152,8 @@ bool AudioChannel::play(
 	handle_t category,
 	float gain,
 	bool repeat,
-	uint32_t repeatFrom
+	uint32_t repeatFrom,
+	float startTime
 )
 {
 	if (!buffer)
@@ -158,6 +163,11 @@ bool AudioChannel::play(
 	if (!cursor)
 		return false;
 
+	// Seek cursor to start time; buffers which cannot seek are skipped by the mixer instead.
+	float skipTime = 0.0f;
+	if (startTime > 0.0f && !buffer->seek(cursor, startTime))
+		skipTime = startTime;
+
 	StateSound ss;
 	ss.buffer = buffer;
 	ss.cursor = cursor;
@@ -165,6 +175,8 @@ bool AudioChannel::play(
 	ss.volume = decibelToLinear(gain);
 	ss.repeat = repeat;
 	ss.repeatFrom = repeatFrom;
+	ss.skipTime = skipTime;
+	ss.sequence = ++m_stateSequence;
 
 	m_allowRepeat = true;
 	m_playing = true;
@@ -177,11 +189,15 @@ bool AudioChannel::getBlock(const IAudioMixer* mixer, AudioBlock& outBlock)
 {
 	StateSound& ss = m_stateSound;
 
-	// Read pending sound state from fifo.
+	// Read pending sound states from fifo; fifo doesn't guarantee
+	// order so only the most recent state is used.
 	{
 		StateSound next;
-		if (m_stateSoundFifo.get(next))
-			ss = next;
+		while (m_stateSoundFifo.get(next))
+		{
+			if (next.sequence > ss.sequence)
+				ss = next;
+		}
 	}
 
 	if (!ss.buffer || !ss.cursor)
@@ -199,6 +215,29 @@ bool AudioChannel::getBlock(const IAudioMixer* mixer, AudioBlock& outBlock)
 	const IAudioBuffer* soundBuffer = ss.buffer;
 	T_ASSERT(soundBuffer);
 
+	// Skip blocks until start time is reached, only if buffer cannot seek; skipped blocks
+	// are neither filtered nor mixed and skipping is spread over several frames to bound the cost.
+	if (ss.skipTime > 0.0f)
+	{
+		for (uint32_t i = 0; i < c_maxSkipBlocks && ss.skipTime > 0.0f; ++i)
+		{
+			AudioBlock skipBlock = { { 0 }, m_hwFrameSamples, 0, 0 };
+			if (!soundBuffer->getBlock(ss.cursor, mixer, skipBlock))
+			{
+				ss.buffer = nullptr;
+				ss.cursor = nullptr;
+				m_playing = false;
+				return false;
+			}
+			if (skipBlock.samplesCount > 0 && skipBlock.sampleRate > 0)
+				ss.skipTime -= float(skipBlock.samplesCount) / skipBlock.sampleRate;
+			else
+				ss.skipTime -= float(m_hwFrameSamples) / m_hwSampleRate;
+		}
+		if (ss.skipTime > 0.0f)
+			return false;
+	}
+
 	// Remove old output samples.
 	if (m_outputSamplesIn >= m_hwFrameSamples)
 	{
@@ -77,6 +77,7 @@ public:
 	 * \param gain Sound gain in dB.
 	 * \param repeat If sound is repeating.
 	 * \param repeatFrom Skip number of samples before repeat.
+	 * \param startTime Start time, in seconds, of sound; used when resuming virtual sounds.
 	 * \return True if sound is playing successfully.
 	 */
 	bool play(
@@ -84,7 +85,8 @@ public:
 		handle_t category,
 		float gain,
 		bool repeat,
-		uint32_t repeatFrom
+		uint32_t repeatFrom,
+		float startTime = 0.0f
 	);
 
 	/*! Check if there are a sound playing in this channel. */
@@ -116,6 +118,8 @@ private:
 		float volume = 1.0f;
 		bool repeat = false;
 		uint32_t repeatFrom = 0;
+		float skipTime = 0.0f;
+		uint32_t sequence = 0;
 	};
 
 	struct StateParameter
@@ -138,6 +142,7 @@ private:
 
 	float* m_outputSamples[SbcMaxChannelCount];
 	uint32_t m_outputSamplesIn;
+	uint32_t m_stateSequence;
 };
 
 }
@@ -166,6 +166,7 @@ void AudioClassFactory::createClasses(IRuntimeClassRegistrar* registrar) const
 	classSoundHandle->addMethod("stop", &SoundHandle::stop);
 	classSoundHandle->addMethod("fadeOff", &SoundHandle::fadeOff);
 	classSoundHandle->addMethod("isPlaying", &SoundHandle::isPlaying);
+	classSoundHandle->addMethod("isVirtual", &SoundHandle::isVirtual);
 	classSoundHandle->addMethod("setVolume", &SoundHandle::setVolume);
 	classSoundHandle->addMethod("setPitch", &SoundHandle::setPitch);
 	classSoundHandle->addMethod("setPosition", &SoundHandle::setPosition);
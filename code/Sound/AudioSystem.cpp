@@ -6,6 +6,7 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <algorithm>
 #include <cstring>
 #include <limits>
 #include "Core/Log/Log.h"
@@ -38,6 +39,8 @@ AudioSystem::AudioSystem(IAudioDriver* driver)
 ,	m_suspended(false)
 ,	m_volume(1.0f)
 ,	m_threadMixer(0)
+,	m_workNext(0)
+,	m_workCount(0)
 ,	m_samplesData(0)
 ,	m_time(0.0)
 ,	m_mixerThreadTime(0.0)
@@ -104,8 +107,19 @@ bool AudioSystem::create(const AudioSystemCreateDesc& desc)
 
 	// Set play parameters.
 	m_requestBlocks.resize(desc.channels);
+	m_channelTimes.resize(desc.channels, 0.0);
 	m_time = 0.0;
 
+	// Create channel block workers.
+	for (uint32_t i = 0; i < m_desc.mixerThreads; ++i)
+	{
+		Thread* worker = ThreadManager::getInstance().create([=, this](){ threadWorker(); }, L"Sound mixer worker");
+		if (!worker)
+			break;
+		worker->start(Thread::Above);
+		m_threadWorkers.push_back(worker);
+	}
+
 	// Start thread.
 	m_threadMixer->start(Thread::Above);
 	return true;
@@ -113,14 +127,7 @@ bool AudioSystem::create(const AudioSystemCreateDesc& desc)
 
 void AudioSystem::destroy()
 {
-	// Release all channels to ensure submission thread no longer tries to request blocks from channels.
-	{
-		m_channelsLock.wait();
-		m_channels.clear();
-		m_channelsLock.release();
-	}
-
-	// Terminate mixer thread.
+	// Terminate mixer thread first as it reference samples of channels while mixing.
 	if (m_threadMixer)
 	{
 		m_threadMixer->stop();
@@ -128,6 +135,24 @@ void AudioSystem::destroy()
 		m_threadMixer = nullptr;
 	}
 
+	// Terminate channel block workers, wake them up so they notice promptly.
+	for (auto worker : m_threadWorkers)
+		worker->stop(0);
+	m_eventWork.pulse((int32_t)m_threadWorkers.size());
+	for (auto worker : m_threadWorkers)
+	{
+		worker->stop();
+		ThreadManager::getInstance().destroy(worker);
+	}
+	m_threadWorkers.resize(0);
+
+	// Release all channels.
+	{
+		m_channelsLock.wait();
+		m_channels.clear();
+		m_channelsLock.release();
+	}
+
 	// Free mixer and memory resources.
 	m_mixer = nullptr;
 	safeDestroy(m_driver);
@@ -263,6 +288,12 @@ void AudioSystem::getThreadPerformances(double& outMixerTime) const
 	outMixerTime = m_mixerThreadTime;
 }
 
+void AudioSystem::getThreadPerformances(double& outMixerTime, AlignedVector< double >& outChannelTimes) const
+{
+	outMixerTime = m_mixerThreadTime;
+	outChannelTimes = m_channelTimes;
+}
+
 void AudioSystem::threadMixer()
 {
 	AudioBlock frameBlock;
@@ -274,17 +305,22 @@ void AudioSystem::threadMixer()
 	{
 		const double startTime = timerMixer.getElapsedTime();
 
-		// Read blocks from channels.
+		// Read blocks from channels, workers help generating blocks.
 		m_channelsLock.wait();
 		{
 			channelsCount = (uint32_t)m_channels.size();
-			for (uint32_t i = 0; i < channelsCount; ++i)
-			{
-				m_requestBlocks[i].samplesCount = m_desc.driverDesc.frameSamples;
-				m_requestBlocks[i].maxChannel = 0;
-				m_requestBlocks[i].category = 0;
-				m_channels[i]->getBlock(m_mixer, m_requestBlocks[i]);
-			}
+
+			m_workNext = 0;
+			m_workCount = channelsCount;
+
+			const int32_t workersCount = (int32_t)std::min< size_t >(m_threadWorkers.size(), channelsCount > 0 ? channelsCount - 1 : 0);
+			if (workersCount > 0)
+				m_eventWork.pulse(workersCount);
+
+			generateBlocks();
+
+			for (int32_t i = 0; i < workersCount; ++i)
+				m_eventWorkDone.wait();
 		}
 		m_channelsLock.release();
 
@@ -354,4 +390,39 @@ void AudioSystem::threadMixer()
 	}
 }
 
+void AudioSystem::threadWorker()
+{
+	Thread* thread = ThreadManager::getInstance().getCurrentThread();
+	while (!thread->stopped())
+	{
+		if (!m_eventWork.wait(100))
+			continue;
+
+		generateBlocks();
+		m_eventWorkDone.pulse();
+	}
+}
+
+void AudioSystem::generateBlocks()
+{
+	Timer timer;
+	for (;;)
+	{
+		// Grab next channel; each channel is only accessed by a single thread each frame.
+		const uint32_t i = m_workNext++;
+		if (i >= m_workCount)
+			break;
+
+		const double startTime = timer.getElapsedTime();
+
+		m_requestBlocks[i].samplesCount = m_desc.driverDesc.frameSamples;
+		m_requestBlocks[i].maxChannel = 0;
+		m_requestBlocks[i].category = 0;
+		m_channels[i]->getBlock(m_mixer, m_requestBlocks[i]);
+
+		const double endTime = timer.getElapsedTime();
+		m_channelTimes[i] = (endTime - startTime) * 0.1 + m_channelTimes[i] * 0.9;
+	}
+}
+
 }
@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include "Core/Object.h"
 #include "Core/RefArray.h"
 #include "Core/Containers/AlignedVector.h"
@@ -40,6 +41,11 @@ class Sound;
  * The AudioSystem class manages mixing sounds
  * from virtual channels and feeding them through the
  * submission thread into the audio driver for playback.
+ *
+ * Blocks of virtual channels can be generated in parallel
+ * by a pool of worker threads; channels are always combined
+ * into the final frame in order by the mixer thread so
+ * output is the same regardless of number of workers.
  */
 class T_DLLCLASS AudioSystem : public Object
 {
@@ -125,6 +131,13 @@ public:
 	 */
 	void getThreadPerformances(double& outMixerTime) const;
 
+	/*! Query performance of each thread and channel.
+	 *
+	 * \param outMixerTime Last mixer thread duration in seconds.
+	 * \param outChannelTimes Last block generation duration of each channel in seconds.
+	 */
+	void getThreadPerformances(double& outMixerTime, AlignedVector< double >& outChannelTimes) const;
+
 private:
 	Ref< IAudioDriver > m_driver;
 	Ref< IAudioMixer > m_mixer;
@@ -136,6 +149,18 @@ private:
 	RefArray< AudioChannel > m_channels;
 	AlignedVector< AudioBlock > m_requestBlocks;
 
+	// \name Channel block workers
+	// \{
+
+	AlignedVector< Thread* > m_threadWorkers;
+	Event m_eventWork;
+	Event m_eventWorkDone;
+	std::atomic< uint32_t > m_workNext;
+	uint32_t m_workCount;
+	AlignedVector< double > m_channelTimes;
+
+	// \}
+
 	// \name Submission queue
 	// \{
 
@@ -155,6 +180,10 @@ private:
 	double m_mixerThreadTime;
 
 	void threadMixer();
+
+	void threadWorker();
+
+	void generateBlocks();
 };
 
 }
@@ -13,4 +13,14 @@ namespace traktor::sound
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.sound.IAudioBuffer", IAudioBuffer, Object)
 
+float IAudioBuffer::getDuration() const
+{
+	return 0.0f;
+}
+
+bool IAudioBuffer::seek(IAudioBufferCursor* cursor, float time) const
+{
+	return false;
+}
+
 }
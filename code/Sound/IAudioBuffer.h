@@ -49,6 +49,20 @@ public:
 	virtual Ref< IAudioBufferCursor > createCursor() const = 0;
 
 	virtual bool getBlock(IAudioBufferCursor* cursor, const IAudioMixer* mixer, AudioBlock& outBlock) const = 0;
+
+	/*! Get duration of buffer.
+	 *
+	 * \return Duration in seconds, zero if unknown or endless.
+	 */
+	virtual float getDuration() const;
+
+	/*! Move cursor to playback position.
+	 *
+	 * \param cursor Cursor created by this buffer.
+	 * \param time Playback position in seconds.
+	 * \return True if cursor was moved, false if buffer cannot seek.
+	 */
+	virtual bool seek(IAudioBufferCursor* cursor, float time) const;
 };
 
 }
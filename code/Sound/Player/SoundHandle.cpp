@@ -7,7 +7,10 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Core/Math/Vector4.h"
+#include "Core/Thread/Acquire.h"
 #include "Sound/AudioChannel.h"
+#include "Sound/IAudioBuffer.h"
+#include "Sound/Sound.h"
 #include "Sound/Player/SoundHandle.h"
 
 namespace traktor::sound
@@ -17,66 +20,97 @@ T_IMPLEMENT_RTTI_CLASS(L"traktor.sound.SoundHandle", SoundHandle, Object)
 
 void SoundHandle::stop()
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	if (m_channel)
 		m_channel->stop();
 
-	detach();
+	m_playing = false;
 }
 
 void SoundHandle::fadeOff()
 {
-	if (m_fadeOff)
-		*m_fadeOff = 1.0f;
-
-	detach();
+	if (m_fadeOff <= 0.0f)
+		m_fadeOff = 1.0f;
 }
 
 bool SoundHandle::isPlaying()
 {
-	return m_channel ? m_channel->isPlaying() : false;
+	if (!m_playing)
+		return false;
+
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	return m_channel ? m_channel->isPlaying() : true;
+}
+
+bool SoundHandle::isVirtual() const
+{
+	return m_playing && m_channel == nullptr;
 }
 
 void SoundHandle::setVolume(float volume)
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_volume = volume;
 	if (m_channel)
-		m_channel->setVolume(volume);
+		m_channel->setVolume(getEffectiveVolume());
 }
 
 void SoundHandle::setPitch(float pitch)
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_pitch = pitch;
 	if (m_channel)
 		m_channel->setPitch(pitch);
 }
 
 void SoundHandle::setPosition(const Vector4& position)
 {
-	if (m_position)
-		*m_position = position.xyz1();
+	m_position = position.xyz1();
 }
 
 void SoundHandle::setParameter(int32_t id, float parameter)
 {
+	// Keep parameters so they can be restored when a virtual sound become real.
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_parameters[id] = parameter;
 	if (m_channel)
 		m_channel->setParameter(id, parameter);
 }
 
 IAudioBufferCursor* SoundHandle::getCursor()
 {
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 	return m_channel ? m_channel->getCursor() : nullptr;
 }
 
-SoundHandle::SoundHandle(AudioChannel* channel, Vector4& position, float& fadeOff)
-:	m_channel(channel)
-,	m_position(&position)
-,	m_fadeOff(&fadeOff)
+SoundHandle::SoundHandle(const Sound* sound, const Vector4& position, uint32_t priority, bool autoStopFar, float startTime)
+:	m_position(position)
+,	m_sound(sound)
+,	m_channel(nullptr)
+,	m_priority(priority)
+,	m_volume(1.0f)
+,	m_pitch(1.0f)
+,	m_fadeOff(-1.0f)
+,	m_time(0.0f)
+,	m_duration(sound->getBuffer() ? sound->getBuffer()->getDuration() : 0.0f)
+,	m_startTime(startTime)
+,	m_distance(0.0f)
+,	m_audibility(0.0f)
+,	m_autoStopFar(autoStopFar)
+,	m_playing(true)
+,	m_selected(false)
+{
+}
+
+float SoundHandle::getEffectiveVolume() const
 {
+	return m_fadeOff > 0.0f ? m_volume * m_fadeOff : m_volume;
 }
 
-void SoundHandle::detach()
+void SoundHandle::setChannel(AudioChannel* channel)
 {
-	m_channel = nullptr;
-	m_position = 0;
-	m_fadeOff = 0;
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_channel = channel;
 }
 
 }
@@ -9,7 +9,10 @@
 #pragma once
 
 #include "Core/Object.h"
+#include "Core/Ref.h"
+#include "Core/Containers/SmallMap.h"
 #include "Core/Math/Vector4.h"
+#include "Core/Thread/Semaphore.h"
 
 // import/export mechanism.
 #undef T_DLLCLASS
@@ -24,7 +27,15 @@ namespace traktor::sound
 
 class AudioChannel;
 class IAudioBufferCursor;
+class Sound;
 
+/*! Handle to sound played by sound player.
+ * \ingroup Sound
+ *
+ * A playing sound is either real, ie mixed through an audio
+ * channel, or virtual in which case only it's playback position
+ * is tracked until it's audible enough to become real again.
+ */
 class T_DLLCLASS SoundHandle : public Object
 {
 	T_RTTI_CLASS;
@@ -36,6 +47,9 @@ public:
 
 	bool isPlaying();
 
+	/*! Check if sound is currently virtual, ie not being mixed. */
+	bool isVirtual() const;
+
 	void setVolume(float volume);
 
 	void setPitch(float pitch);
@@ -44,18 +58,35 @@ public:
 
 	void setParameter(int32_t id, float parameter);
 
+	/*! Get cursor of sound, null if sound is virtual. */
 	IAudioBufferCursor* getCursor();
 
 private:
 	friend class SoundPlayer;
 
-	AudioChannel* m_channel;
-	Vector4* m_position;
-	float* m_fadeOff;
-
-	SoundHandle(AudioChannel* channel, Vector4& position, float& fadeOff);
-
-	void detach();
+	mutable Semaphore m_lock;		//!< Guard channel and parameters since handle is controlled from other threads than player.
+	Vector4 m_position;				//!< Position of sound, w is zero if non-positional.
+	Ref< const Sound > m_sound;
+	AudioChannel* m_channel;		//!< Audio channel when real, null when virtual.
+	SmallMap< int32_t, float > m_parameters;
+	uint32_t m_priority;
+	float m_volume;
+	float m_pitch;
+	float m_fadeOff;
+	float m_time;					//!< Playback position in seconds.
+	float m_duration;				//!< Duration of sound in seconds, zero if unknown or endless.
+	float m_startTime;
+	float m_distance;				//!< Normalized distance to nearest listener.
+	float m_audibility;
+	bool m_autoStopFar;
+	bool m_playing;
+	bool m_selected;				//!< Transient, used by player when selecting real voices.
+
+	SoundHandle(const Sound* sound, const Vector4& position, uint32_t priority, bool autoStopFar, float startTime);
+
+	float getEffectiveVolume() const;
+
+	void setChannel(AudioChannel* channel);
 };
 
 }
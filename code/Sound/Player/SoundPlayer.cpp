@@ -6,6 +6,7 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <algorithm>
 #include "Core/Math/Const.h"
 #include "Core/Math/Float.h"
 #include "Core/Thread/Acquire.h"
@@ -28,10 +29,21 @@ namespace traktor::sound
 const float c_nearCutOff = 25000.0f;
 const float c_farCutOff = 0.1f;
 const float c_recentTimeOffset = 1.0f / 30.0f;
+const float c_audibleThreshold = 0.005f;	//!< Voices less audible than this are virtual.
+const float c_realHysteresis = 0.5f;		//!< Real voices are kept real until audibility drop below threshold scaled by this.
+const float c_realBias = 1.2f;				//!< Bias real voices to prevent voices from flip-flopping between real and virtual.
 
 handle_t s_handleDistance = 0;
 handle_t s_handleVelocity = 0;
 
+float getMaxDistance(const SurroundEnvironment* surroundEnvironment, const Sound* sound)
+{
+	float maxDistance = sound->getRange();
+	if (maxDistance <= surroundEnvironment->getInnerRadius())
+		maxDistance = surroundEnvironment->getMaxDistance();
+	return maxDistance;
+}
+
 	}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.sound.SoundPlayer", SoundPlayer, Object)
@@ -49,12 +61,17 @@ bool SoundPlayer::create(AudioSystem* audioSystem, SurroundEnvironment* surround
 
 	for (uint32_t i = 0; m_audioSystem->getChannel(i); ++i)
 	{
-		Channel ch;
+		Channel& ch = m_channels.push_back();
 		ch.audioChannel = m_audioSystem->getChannel(i);
-		ch.priority = ~0U;
-		m_channels.push_back(ch);
+		if (m_surroundEnvironment)
+		{
+			ch.surroundFilter = new SurroundFilter(m_surroundEnvironment, Vector4::zero(), m_surroundEnvironment->getMaxDistance());
+			ch.lowPassFilter = new LowPassFilter(c_nearCutOff);
+			ch.groupFilter = new GroupFilter(ch.lowPassFilter, ch.surroundFilter);
+		}
 	}
 
+	m_statistics = SoundPlayerStatistics();
 	m_timer.reset();
 	return true;
 }
@@ -63,15 +80,13 @@ void SoundPlayer::destroy()
 {
 	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 
-	for (auto& channel : m_channels)
+	for (auto voice : m_voices)
 	{
-		if (channel.handle)
-		{
-			channel.handle->stop();
-			channel.handle = nullptr;
-		}
+		voice->stop();
+		voice->setChannel(nullptr);
 	}
 
+	m_voices.clear();
 	m_channels.clear();
 	m_surroundEnvironment = nullptr;
 	m_audioSystem = nullptr;
@@ -82,82 +97,8 @@ Ref< SoundHandle > SoundPlayer::play(const Sound* sound, uint32_t priority)
 	if (!sound)
 		return nullptr;
 
-	{
-		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
-
-		const float time = float(m_timer.getElapsedTime());
-
-		// First check if this sound already has been recently played.
-		for (const auto& channel : m_channels)
-		{
-			if (channel.sound == sound && channel.time + c_recentTimeOffset >= time)
-				return nullptr;
-		}
-
-		// First try to associate sound with non-playing channel.
-		for (auto& channel : m_channels)
-		{
-			if (!channel.audioChannel->isPlaying())
-			{
-				if (channel.handle)
-					channel.handle->detach();
-
-				channel.position = Vector4::zero();
-				channel.surroundFilter = nullptr;
-				channel.lowPassFilter = nullptr;
-				channel.sound = sound;
-				channel.audioChannel->play(
-					sound->getBuffer(),
-					sound->getCategory(),
-					sound->getGain(),
-					false,
-					0
-				);
-				channel.audioChannel->setFilter(nullptr);
-				channel.audioChannel->setVolume(1.0f);
-				channel.priority = priority;
-				channel.fadeOff = -1.0f;
-				channel.time = time;
-				channel.autoStopFar = false;
-				channel.handle = new SoundHandle(channel.audioChannel, channel.position, channel.fadeOff);
-
-				return channel.handle;
-			}
-		}
-
-		// Then try to associate sound with lesser priority channel.
-		for (auto& channel : m_channels)
-		{
-			if (priority >= channel.priority)
-			{
-				if (channel.handle)
-					channel.handle->detach();
-
-				channel.position = Vector4::zero();
-				channel.surroundFilter = nullptr;
-				channel.lowPassFilter = nullptr;
-				channel.sound = sound;
-				channel.audioChannel->play(
-					sound->getBuffer(),
-					sound->getCategory(),
-					sound->getGain(),
-					false,
-					0
-				);
-				channel.audioChannel->setFilter(nullptr);
-				channel.audioChannel->setVolume(1.0f);
-				channel.priority = priority;
-				channel.fadeOff = -1.0f;
-				channel.time = time;
-				channel.autoStopFar = false;
-				channel.handle = new SoundHandle(channel.audioChannel, channel.position, channel.fadeOff);
-
-				return channel.handle;
-			}
-		}
-	}
-
-	return nullptr;
+	const float time = float(m_timer.getElapsedTime());
+	return start(new SoundHandle(sound, Vector4::zero(), priority, false, time));
 }
 
 Ref< SoundHandle > SoundPlayer::play(const Sound* sound, const Vector4& position, uint32_t priority, bool autoStopFar)
@@ -169,234 +110,340 @@ Ref< SoundHandle > SoundPlayer::play(const Sound* sound, const Vector4& position
 		return play(sound, priority);
 
 	const float time = float(m_timer.getElapsedTime());
+	return start(new SoundHandle(sound, position.xyz1(), priority, autoStopFar, time));
+}
 
-	float maxDistance = sound->getRange();
-	if (maxDistance <= m_surroundEnvironment->getInnerRadius())
-		maxDistance = m_surroundEnvironment->getMaxDistance();
+void SoundPlayer::addListener(const SoundListener* listener)
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_listeners.push_back(listener);
+}
+
+void SoundPlayer::removeListener(const SoundListener* listener)
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	m_listeners.remove(listener);
+}
+
+void SoundPlayer::update(float dT)
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
 
-	Scalar distance = Scalar(std::numeric_limits< float >::max());
-	for (const auto& listenerTransform : m_surroundEnvironment->getListenerTransforms())
+	// Update listener transforms.
+	if (m_surroundEnvironment)
 	{
-		const Vector4 listenerPosition = listenerTransform.translation().xyz1();
-		const Scalar listenerDistance = (position - listenerPosition).xyz0().length();
-		distance = std::min(distance, listenerDistance);
+		SurroundEnvironment::listenerTransformVector_t listenerTransforms;
+		for (auto listener : m_listeners)
+			listenerTransforms.push_back(listener->getTransform());
+		m_surroundEnvironment->setListenerTransforms(listenerTransforms);
 	}
-	if (autoStopFar && distance > maxDistance)
-		return nullptr;
 
-	const float k0 = distance / maxDistance;
-	const float k1 = (distance - m_surroundEnvironment->getInnerRadius()) / (maxDistance - m_surroundEnvironment->getInnerRadius());
-
-	// Surround filter.
-	Ref< SurroundFilter > surroundFilter = new SurroundFilter(m_surroundEnvironment, position.xyz1(), maxDistance);
+	// Release channels of voices which has finished or been stopped.
+	for (auto& channel : m_channels)
+	{
+		if (channel.voice && (!channel.voice->m_playing || !channel.audioChannel->isPlaying()))
+		{
+			channel.voice->setChannel(nullptr);
+			channel.voice->m_playing = false;
+			channel.voice = nullptr;
+		}
+	}
 
-	// Calculate initial cut-off frequency.
-	const float cutOff = lerp(c_nearCutOff, c_farCutOff, clamp(std::sqrt(k0), 0.0f, 1.0f));
-	Ref< LowPassFilter > lowPassFilter = new LowPassFilter(cutOff);
+	// Update voices, remove voices which are no longer playing and
+	// collect voices which are audible enough to be real.
+	const float fadeOffDelta = std::min(dT, 1.0f / 60.0f);
+	uint32_t count = 0;
 
-	Ref< GroupFilter > groupFilter = new GroupFilter(lowPassFilter, surroundFilter);
+	for (uint32_t i = 0; i < m_voices.size(); ++i)
 	{
-		T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+		SoundHandle* voice = m_voices[i];
 
-		// First check if this sound already has been recently played.
-		//for (const auto& channel : m_channels)
-		//{
-		//	if (channel.sound == sound && channel.time + c_recentTimeOffset >= time)
-		//		return nullptr;
-		//}
-
-		// First try to associate sound with non-playing channel.
-		for (auto& channel : m_channels)
+		if (voice->m_playing && voice->m_fadeOff > 0.0f)
 		{
-			const Scalar channelDistance = (channel.position - distance).xyz0().length();
-			if (!channel.audioChannel->isPlaying())
+			voice->m_fadeOff -= fadeOffDelta;
+			if (voice->m_fadeOff > 0.0f)
 			{
-				if (channel.handle)
-					channel.handle->detach();
-
-				channel.position = position.xyz1();
-				channel.surroundFilter = surroundFilter;
-				channel.lowPassFilter = lowPassFilter;
-				channel.sound = sound;
-				channel.audioChannel->play(
-					sound->getBuffer(),
-					sound->getCategory(),
-					sound->getGain(),
-					false,
-					0
-				);
-				channel.audioChannel->setFilter(groupFilter);
-				channel.audioChannel->setVolume(1.0f);
-				channel.priority = priority;
-				channel.fadeOff = -1.0f;
-				channel.time = time;
-				channel.autoStopFar = autoStopFar;
-				channel.handle = new SoundHandle(channel.audioChannel, channel.position, channel.fadeOff);
-
-				return channel.handle;
+				if (voice->m_channel)
+					voice->m_channel->setVolume(voice->getEffectiveVolume());
 			}
+			else
+				voice->stop();
 		}
 
-		// Then try to associate sound with lesser priority channel.
-		for (auto& channel : m_channels)
+		bool keep = voice->m_playing;
+		if (keep)
 		{
-			if (priority > channel.priority)
+			// Stop voices which have moved too far away, or virtual voices
+			// which cannot be controlled since only we reference the handle.
+			if (!evaluate(voice) || (!voice->m_channel && voice->getReferenceCount() <= 1))
 			{
-				if (channel.handle)
-					channel.handle->detach();
-
-				channel.position = position.xyz1();
-				channel.surroundFilter = surroundFilter;
-				channel.lowPassFilter = lowPassFilter;
-				channel.sound = sound;
-				channel.audioChannel->play(
-					sound->getBuffer(),
-					sound->getCategory(),
-					sound->getGain(),
-					false,
-					0
-				);
-				channel.audioChannel->setFilter(groupFilter);
-				channel.audioChannel->setVolume(1.0f);
-				channel.priority = priority;
-				channel.fadeOff = -1.0f;
-				channel.time = time;
-				channel.autoStopFar = autoStopFar;
-				channel.handle = new SoundHandle(channel.audioChannel, channel.position, channel.fadeOff);
-
-				return channel.handle;
+				voice->stop();
+				m_statistics.culled++;
+				keep = false;
 			}
 		}
 
-		// Then try to associate sound with similar priority channel but further away.
-		for (auto& channel : m_channels)
+		if (!keep)
 		{
-			const Scalar channelDistance = (channel.position - distance).xyz0().length();
-			if (
-				priority == channel.priority &&
-				channel.position.w() > 0.5_simd &&
-				distance < channelDistance
-			)
+			if (voice->m_channel)
 			{
-				if (channel.handle)
-					channel.handle->detach();
-
-				channel.position = position.xyz1();
-				channel.surroundFilter = surroundFilter;
-				channel.lowPassFilter = lowPassFilter;
-				channel.sound = sound;
-				channel.audioChannel->play(
-					sound->getBuffer(),
-					sound->getCategory(),
-					sound->getGain(),
-					false,
-					0
-				);
-				channel.audioChannel->setFilter(groupFilter);
-				channel.audioChannel->setVolume(1.0f);
-				channel.priority = priority;
-				channel.fadeOff = -1.0f;
-				channel.time = time;
-				channel.autoStopFar = autoStopFar;
-				channel.handle = new SoundHandle(channel.audioChannel, channel.position, channel.fadeOff);
-
-				return channel.handle;
+				for (auto& channel : m_channels)
+				{
+					if (channel.voice == voice)
+						channel.voice = nullptr;
+				}
+				voice->setChannel(nullptr);
 			}
+			continue;
+		}
+
+		voice->m_time += dT * voice->m_pitch;
+
+		// Retire virtual voices which has reached end of sound, same as
+		// real voices are when their channel has finished playing.
+		if (!voice->m_channel && voice->m_duration > 0.0f && voice->m_time >= voice->m_duration)
+		{
+			voice->stop();
+			continue;
 		}
+
+		const float threshold = voice->m_channel ? c_audibleThreshold * c_realHysteresis : c_audibleThreshold;
+		if (voice->m_audibility >= threshold)
+			m_candidates.push_back(voice);
+
+		if (i != count)
+			m_voices[count] = voice;
+		++count;
 	}
 
-	return nullptr;
-}
+	m_voices.resize(count);
 
-void SoundPlayer::addListener(const SoundListener* listener)
-{
-	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
-	m_listeners.push_back(listener);
-}
+	// Select most important voices; priority first then audibility.
+	if (m_candidates.size() > m_channels.size())
+	{
+		SoundHandle** candidates = &m_candidates[0];
+		std::nth_element(candidates, candidates + m_channels.size(), candidates + m_candidates.size(), [](const SoundHandle* lh, const SoundHandle* rh) {
+			if (lh->m_priority != rh->m_priority)
+				return lh->m_priority > rh->m_priority;
+			const float lhs = lh->m_channel ? lh->m_audibility * c_realBias : lh->m_audibility;
+			const float rhs = rh->m_channel ? rh->m_audibility * c_realBias : rh->m_audibility;
+			return lhs > rhs;
+		});
+		m_candidates.resize(m_channels.size());
+	}
 
-void SoundPlayer::removeListener(const SoundListener* listener)
-{
-	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
-	m_listeners.remove(listener);
-}
+	for (auto voice : m_candidates)
+		voice->m_selected = true;
 
-void SoundPlayer::update(float dT)
-{
-	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	// Virtualize real voices which wasn't selected.
+	for (auto& channel : m_channels)
+	{
+		if (channel.voice && !channel.voice->m_selected)
+			virtualize(channel);
+	}
 
-	if (m_surroundEnvironment)
+	// Realize selected virtual voices, at their current position, on free channels.
+	auto it = m_channels.begin();
+	for (auto voice : m_candidates)
 	{
-		// Update listener transforms.
-		SurroundEnvironment::listenerTransformVector_t listenerTransforms;
-		for (auto listener : m_listeners)
-			listenerTransforms.push_back(listener->getTransform());
-		m_surroundEnvironment->setListenerTransforms(listenerTransforms);
+		voice->m_selected = false;
+		if (voice->m_channel)
+			continue;
 
-		// Update surround and low pass filters on playing 3d sounds.
-		for (auto& channel : m_channels)
-		{
-			// Skip non-playing or non-positional sounds.
-			if (!channel.audioChannel->isPlaying() || channel.position.w() < 0.5f)
-				continue;
+		while (it != m_channels.end() && (it->voice != nullptr || it->audioChannel->isPlaying()))
+			++it;
+		if (it == m_channels.end())
+			continue;
 
-			float maxDistance = channel.sound->getRange();
-			if (maxDistance <= m_surroundEnvironment->getInnerRadius())
-				maxDistance = m_surroundEnvironment->getMaxDistance();
+		realize(*it, voice);
+		m_statistics.realized++;
+	}
 
-			// Calculate distance from listener; automatically stop sounds which has moved outside max listener distance.
-			Scalar distance = Scalar(std::numeric_limits< float >::max());
-			for (const auto& listenerTransform : listenerTransforms)
-			{
-				const Vector4 listenerPosition = listenerTransform.translation().xyz1();
-				const Scalar listenerDistance = (channel.position - listenerPosition).xyz0().length();
-				distance = std::min(distance, listenerDistance);
-			}
-			if (channel.autoStopFar && distance > maxDistance)
-			{
-				if (channel.handle)
-					channel.handle->detach();
+	m_candidates.resize(0);
 
-				channel.position = Vector4::zero();
-				channel.sound = nullptr;
-				channel.audioChannel->setFilter(0);
-				channel.audioChannel->stop();
+	// Update surround and low pass filters on real 3d voices.
+	if (m_surroundEnvironment)
+	{
+		for (auto& channel : m_channels)
+		{
+			const SoundHandle* voice = channel.voice;
+			if (!voice || voice->m_position.w() < 0.5f)
 				continue;
-			}
-
-			// Calculate cut-off frequency.
-			const float k0 = clamp< float >(distance / maxDistance, 0.0f, 1.0f);
 
 			// Set filter parameters.
 			if (channel.surroundFilter)
-				channel.surroundFilter->setSpeakerPosition(channel.position);
+				channel.surroundFilter->setSpeakerPosition(voice->m_position);
 			if (channel.lowPassFilter)
 			{
-				const float cutOff = lerp(c_nearCutOff, c_farCutOff, std::sqrt(k0));
+				const float cutOff = lerp(c_nearCutOff, c_farCutOff, std::sqrt(voice->m_distance));
 				channel.lowPassFilter->setCutOff(cutOff);
 			}
 
 			// Set automatic sound parameters.
-			channel.audioChannel->setParameter(s_handleDistance, k0);
+			channel.audioChannel->setParameter(s_handleDistance, voice->m_distance);
 			channel.audioChannel->setParameter(s_handleVelocity, 0.0f);
 
 			// Disable repeat if no-one else then me have a reference to the handle.
-			if (!channel.handle || channel.handle->getReferenceCount() <= 1)
+			if (voice->getReferenceCount() <= 1)
 				channel.audioChannel->disableRepeat();
 		}
 	}
 
-	// Update fade-off channels.
-	for (auto& channel : m_channels)
+	// Count real and virtual voices.
+	m_statistics.realVoices = 0;
+	for (const auto& channel : m_channels)
 	{
-		if (!channel.audioChannel->isPlaying() || channel.fadeOff <= 0.0f)
-			continue;
+		if (channel.voice)
+			m_statistics.realVoices++;
+	}
+	m_statistics.virtualVoices = (uint32_t)m_voices.size() - m_statistics.realVoices;
+}
 
-		channel.fadeOff -= std::min(dT, 1.0f / 60.0f);
-		if (channel.fadeOff > 0.0f)
-			channel.audioChannel->setVolume(channel.fadeOff);
-		else
-			channel.audioChannel->stop();
+void SoundPlayer::getStatistics(SoundPlayerStatistics& outStatistics) const
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+	outStatistics = m_statistics;
+}
+
+Ref< SoundHandle > SoundPlayer::start(SoundHandle* voice)
+{
+	T_ANONYMOUS_VAR(Acquire< Semaphore >)(m_lock);
+
+	// Check if this non-positional sound already has been recently played.
+	if (voice->m_position.w() < 0.5f)
+	{
+		for (auto playing : m_voices)
+		{
+			if (playing->m_sound == voice->m_sound && playing->m_playing && playing->m_startTime + c_recentTimeOffset >= voice->m_startTime)
+				return nullptr;
+		}
 	}
+
+	if (!evaluate(voice))
+		return nullptr;
+
+	// Try to make voice real immediately; either on a free channel or
+	// by virtualizing least important voice if it's less important.
+	if (voice->m_audibility >= c_audibleThreshold)
+	{
+		Channel* target = nullptr;
+		for (auto& channel : m_channels)
+		{
+			if (!channel.audioChannel->isPlaying())
+			{
+				if (channel.voice)
+				{
+					channel.voice->setChannel(nullptr);
+					channel.voice->m_playing = false;
+					channel.voice = nullptr;
+				}
+				target = &channel;
+				break;
+			}
+		}
+
+		if (!target)
+		{
+			for (auto& channel : m_channels)
+			{
+				const SoundHandle* current = channel.voice;
+				if (!current)
+					continue;
+
+				const SoundHandle* least = target ? target->voice : voice;
+				if (
+					current->m_priority < least->m_priority ||
+					(current->m_priority == least->m_priority && current->m_audibility < least->m_audibility)
+				)
+					target = &channel;
+			}
+			if (target)
+				virtualize(*target);
+		}
+
+		if (target)
+			realize(*target, voice);
+	}
+
+	m_voices.push_back(voice);
+	return voice;
+}
+
+bool SoundPlayer::evaluate(SoundHandle* voice) const
+{
+	float audibility = decibelToLinear(voice->m_sound->getGain()) * voice->getEffectiveVolume();
+
+	if (m_surroundEnvironment && voice->m_position.w() > 0.5f)
+	{
+		const float innerRadius = m_surroundEnvironment->getInnerRadius();
+		const float maxDistance = getMaxDistance(m_surroundEnvironment, voice->m_sound);
+
+		// Calculate distance from nearest listener.
+		float distance = std::numeric_limits< float >::max();
+		for (const auto& listenerTransform : m_surroundEnvironment->getListenerTransforms())
+		{
+			const Vector4 listenerPosition = listenerTransform.translation().xyz1();
+			const float listenerDistance = (voice->m_position - listenerPosition).xyz0().length();
+			distance = std::min(distance, listenerDistance);
+		}
+		if (voice->m_autoStopFar && distance > maxDistance)
+			return false;
+
+		voice->m_distance = clamp< float >(distance / maxDistance, 0.0f, 1.0f);
+
+		// Attenuate by distance, same as surround filter.
+		audibility *= clamp< float >(1.0f - (distance - innerRadius) / maxDistance, 0.0f, 1.0f);
+	}
+
+	voice->m_audibility = audibility;
+	return true;
+}
+
+void SoundPlayer::realize(Channel& channel, SoundHandle* voice)
+{
+	const Sound* sound = voice->m_sound;
+
+	channel.audioChannel->play(
+		sound->getBuffer(),
+		sound->getCategory(),
+		sound->getGain(),
+		false,
+		0,
+		voice->m_time
+	);
+
+	if (channel.groupFilter && voice->m_position.w() > 0.5f)
+	{
+		channel.surroundFilter->setMaxDistance(getMaxDistance(m_surroundEnvironment, sound));
+		channel.surroundFilter->setSpeakerPosition(voice->m_position);
+		channel.lowPassFilter->setCutOff(lerp(c_nearCutOff, c_farCutOff, std::sqrt(voice->m_distance)));
+		channel.audioChannel->setFilter(channel.groupFilter);
+	}
+	else
+		channel.audioChannel->setFilter(nullptr);
+
+	channel.audioChannel->setVolume(voice->getEffectiveVolume());
+	channel.audioChannel->setPitch(voice->m_pitch);
+
+	// Restore parameters and attach channel atomically so no parameter set
+	// from another thread is lost in between.
+	{
+		T_ANONYMOUS_VAR(Acquire< Semaphore >)(voice->m_lock);
+		for (const auto& parameter : voice->m_parameters)
+			channel.audioChannel->setParameter(parameter.first, parameter.second);
+		voice->m_channel = channel.audioChannel;
+	}
+
+	channel.voice = voice;
+}
+
+void SoundPlayer::virtualize(Channel& channel)
+{
+	channel.audioChannel->stop();
+	channel.audioChannel->setFilter(nullptr);
+	channel.voice->setChannel(nullptr);
+	channel.voice = nullptr;
+	m_statistics.virtualized++;
 }
 
 }
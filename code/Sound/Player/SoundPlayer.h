@@ -29,6 +29,7 @@ namespace traktor::sound
 
 class AudioChannel;
 class AudioSystem;
+class GroupFilter;
 class LowPassFilter;
 class Sound;
 class SoundHandle;
@@ -36,8 +37,30 @@ class SoundListener;
 class SurroundEnvironment;
 class SurroundFilter;
 
+/*! Sound player statistics.
+ * \ingroup Sound
+ */
+struct SoundPlayerStatistics
+{
+	uint32_t realVoices = 0;		//!< Number of sounds currently mixed through an audio channel.
+	uint32_t virtualVoices = 0;		//!< Number of sounds currently only tracked by playback position.
+	uint32_t realized = 0;			//!< Total number of times a virtual sound has become real.
+	uint32_t virtualized = 0;		//!< Total number of times a real sound has become virtual.
+	uint32_t culled = 0;			//!< Total number of sounds stopped by player, either too far away or virtual without handle reference.
+};
+
 /*! High-level sound player implementation.
  * \ingroup Sound
+ *
+ * Each played sound is a voice; the most important and audible
+ * voices are mixed through the audio system's channels while the
+ * rest are virtual, ie only their playback position is tracked
+ * without any decoding or mixing. Virtual voices become real again,
+ * at their current position, as soon as they are audible enough
+ * and there is a channel available.
+ *
+ * Virtual voices which no-one, except the player, reference are
+ * stopped as they cannot be controlled anymore.
  */
 class T_DLLCLASS SoundPlayer : public Object
 {
@@ -60,19 +83,16 @@ public:
 
 	void update(float dT);
 
+	void getStatistics(SoundPlayerStatistics& outStatistics) const;
+
 private:
 	struct Channel
 	{
-		Vector4 position;
 		Ref< SurroundFilter > surroundFilter;
 		Ref< LowPassFilter > lowPassFilter;
-		Ref< const Sound > sound;
-		AudioChannel* audioChannel;
-		uint32_t priority;
-		float fadeOff;
-		float time;
-		bool autoStopFar;
-		Ref< SoundHandle > handle;
+		Ref< GroupFilter > groupFilter;
+		AudioChannel* audioChannel = nullptr;
+		SoundHandle* voice = nullptr;
 	};
 
 	mutable Semaphore m_lock;
@@ -80,8 +100,18 @@ private:
 	Ref< SurroundEnvironment > m_surroundEnvironment;
 	RefArray< const SoundListener > m_listeners;
 	AlignedVector< Channel > m_channels;
+	RefArray< SoundHandle > m_voices;
+	AlignedVector< SoundHandle* > m_candidates;
+	SoundPlayerStatistics m_statistics;
 	Timer m_timer;
+
+	Ref< SoundHandle > start(SoundHandle* voice);
+
+	bool evaluate(SoundHandle* voice) const;
+
+	void realize(Channel& channel, SoundHandle* voice);
+
+	void virtualize(Channel& channel);
 };
 
 }
-
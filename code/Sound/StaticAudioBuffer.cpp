@@ -225,4 +225,19 @@ bool StaticAudioBuffer::getBlock(IAudioBufferCursor* cursor, const IAudioMixer*
 	return true;
 }
 
+float StaticAudioBuffer::getDuration() const
+{
+	return m_sampleRate > 0 ? float(m_samplesCount) / m_sampleRate : 0.0f;
+}
+
+bool StaticAudioBuffer::seek(IAudioBufferCursor* cursor, float time) const
+{
+	StaticAudioBufferCursor* ssbc = static_cast< StaticAudioBufferCursor* >(cursor);
+
+	// Keep position aligned since samples are converted in groups of eight.
+	const int32_t position = int32_t(std::max(time, 0.0f) * m_sampleRate);
+	ssbc->m_position = uint32_t(alignDown(std::min(position, m_samplesCount), 8));
+	return true;
+}
+
 }
@@ -42,6 +42,10 @@ public:
 
 	virtual bool getBlock(IAudioBufferCursor* cursor, const IAudioMixer* mixer, AudioBlock& outBlock) const override final;
 
+	virtual float getDuration() const override final;
+
+	virtual bool seek(IAudioBufferCursor* cursor, float time) const override final;
+
 private:
 	int32_t m_sampleRate = 0;
 	int32_t m_samplesCount = 0;
@@ -87,4 +87,9 @@ bool StreamAudioBuffer::getBlock(IAudioBufferCursor* cursor, const IAudioMixer*
 	return true;
 }
 
+float StreamAudioBuffer::getDuration() const
+{
+	return float(m_streamDecoder->getDuration());
+}
+
 }
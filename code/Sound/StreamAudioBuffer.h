@@ -41,6 +41,8 @@ public:
 
 	virtual bool getBlock(IAudioBufferCursor* cursor, const IAudioMixer* mixer, AudioBlock& outBlock) const override final;
 
+	virtual float getDuration() const override final;
+
 private:
 	Ref< IStreamDecoder > m_streamDecoder;
 	mutable uint64_t m_position = 0;
@@ -0,0 +1,204 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cmath>
+#include <cstring>
+#include "Core/Log/Log.h"
+#include "Core/Thread/Signal.h"
+#include "Core/Timer/Timer.h"
+#include "Sound/AudioChannel.h"
+#include "Sound/AudioDriverNull.h"
+#include "Sound/AudioSystem.h"
+#include "Sound/IAudioBuffer.h"
+#include "Sound/Test/CaseAudioSystem.h"
+
+namespace traktor::sound::test
+{
+	namespace
+	{
+
+const uint32_t c_channels = 16;
+const uint32_t c_hwChannels = 2;
+const uint32_t c_frameSamples = 512;
+const uint32_t c_frameCount = 8;
+const uint32_t c_skipFrames = 2;	//!< First frames are skipped as channels might start in different frames.
+
+/*! Capture frames, paced by null driver. */
+class CaptureAudioDriver : public RefCountImpl< IAudioDriver >
+{
+public:
+	AlignedVector< float > m_samples;
+	uint32_t m_frames = 0;
+	Signal m_started;
+	Signal m_finished;
+
+	CaptureAudioDriver()
+	:	m_driver(new AudioDriverNull())
+	{
+	}
+
+	virtual bool create(const SystemApplication& sysapp, const AudioDriverCreateDesc& desc, Ref< IAudioMixer >& outMixer) override final
+	{
+		return m_driver->create(sysapp, desc, outMixer);
+	}
+
+	virtual void destroy() override final
+	{
+		m_driver->destroy();
+	}
+
+	virtual void wait() override final
+	{
+		// Hold mixer until all channels have been started.
+		m_started.wait();
+		m_driver->wait();
+	}
+
+	virtual void submit(const AudioBlock& block) override final
+	{
+		if (m_frames < c_frameCount)
+		{
+			if (m_frames >= c_skipFrames)
+			{
+				for (uint32_t i = 0; i < c_hwChannels; ++i)
+					m_samples.insert(m_samples.end(), block.samples[i], block.samples[i] + block.samplesCount);
+			}
+			if (++m_frames >= c_frameCount)
+				m_finished.set();
+		}
+	}
+
+private:
+	Ref< IAudioDriver > m_driver;
+};
+
+class TestAudioBufferCursor : public RefCountImpl< IAudioBufferCursor >
+{
+public:
+	virtual void setParameter(handle_t id, float parameter) override final {}
+
+	virtual void disableRepeat() override final {}
+
+	virtual void reset() override final {}
+};
+
+/*! Repeat same block; optionally burn time to simulate heavy filters. */
+class TestAudioBuffer : public IAudioBuffer
+{
+public:
+	explicit TestAudioBuffer(uint32_t channel, double work)
+	:	m_work(work)
+	{
+		for (uint32_t i = 0; i < c_hwChannels; ++i)
+		{
+			for (uint32_t j = 0; j < c_frameSamples; ++j)
+				m_block[i][j] = std::sin(float(j * (channel + 1) + i) * 0.01f) * (0.01f + channel * 0.003f);
+		}
+	}
+
+	virtual Ref< IAudioBufferCursor > createCursor() const override final
+	{
+		return new TestAudioBufferCursor();
+	}
+
+	virtual bool getBlock(IAudioBufferCursor* cursor, const IAudioMixer* mixer, AudioBlock& outBlock) const override final
+	{
+		if (m_work > 0.0)
+		{
+			Timer timer;
+			while (timer.getElapsedTime() < m_work)
+				;
+		}
+
+		for (uint32_t i = 0; i < c_hwChannels; ++i)
+			outBlock.samples[i] = m_block[i];
+		outBlock.samplesCount = c_frameSamples;
+		outBlock.sampleRate = 44100;
+		outBlock.maxChannel = c_hwChannels;
+		return true;
+	}
+
+private:
+	alignas(16) mutable float m_block[c_hwChannels][c_frameSamples];
+	double m_work;
+};
+
+bool mix(uint32_t mixerThreads, double work, AlignedVector< float >& outSamples, double& outMixerTime, AlignedVector< double >& outChannelTimes)
+{
+	Ref< CaptureAudioDriver > audioDriver = new CaptureAudioDriver();
+	Ref< AudioSystem > audioSystem = new AudioSystem(audioDriver);
+
+	AudioSystemCreateDesc desc;
+	desc.channels = c_channels;
+	desc.mixerThreads = mixerThreads;
+	desc.driverDesc.sampleRate = 44100;
+	desc.driverDesc.bitsPerSample = 16;
+	desc.driverDesc.hwChannels = c_hwChannels;
+	desc.driverDesc.frameSamples = c_frameSamples;
+
+	if (!audioSystem->create(desc))
+		return false;
+
+	RefArray< TestAudioBuffer > buffers;
+	for (uint32_t i = 0; i < c_channels; ++i)
+	{
+		buffers.push_back(new TestAudioBuffer(i, work));
+		audioSystem->getChannel(i)->play(buffers.back(), 0, 0.0f, true, 0);
+	}
+
+	audioDriver->m_started.set();
+	audioDriver->m_finished.wait();
+
+	audioSystem->getThreadPerformances(outMixerTime, outChannelTimes);
+
+	audioSystem->destroy();
+
+	outSamples = audioDriver->m_samples;
+	return true;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.sound.test.CaseAudioSystem", 0, CaseAudioSystem, traktor::test::Case)
+
+void CaseAudioSystem::run()
+{
+	AlignedVector< float > serialSamples, parallelSamples;
+	AlignedVector< double > serialTimes, parallelTimes;
+	double serialMixerTime, parallelMixerTime;
+
+	const bool serialResult = mix(0, 0.0005, serialSamples, serialMixerTime, serialTimes);
+	CASE_ASSERT(serialResult);
+
+	const bool parallelResult = mix(3, 0.0005, parallelSamples, parallelMixerTime, parallelTimes);
+	CASE_ASSERT(parallelResult);
+
+	if (!serialResult || !parallelResult)
+		return;
+
+	// Channels are combined in same order so output should be identical.
+	CASE_ASSERT_EQUAL(serialSamples.size(), size_t((c_frameCount - c_skipFrames) * c_frameSamples * c_hwChannels));
+	CASE_ASSERT_EQUAL(parallelSamples.size(), serialSamples.size());
+	CASE_ASSERT(std::memcmp(serialSamples.c_ptr(), parallelSamples.c_ptr(), serialSamples.size() * sizeof(float)) == 0);
+
+	bool haveSignal = false;
+	for (auto sample : serialSamples)
+		haveSignal |= (std::abs(sample) > 0.01f);
+	CASE_ASSERT(haveSignal);
+
+	// Each channel should report time spent generating it's blocks.
+	CASE_ASSERT_EQUAL(parallelTimes.size(), size_t(c_channels));
+	bool allTimed = true;
+	for (uint32_t i = 0; i < c_channels; ++i)
+		allTimed &= (parallelTimes[i] > 0.0);
+	CASE_ASSERT(allTimed);
+
+	log::info << c_channels << L" channels; mixer thread " << int32_t(serialMixerTime * 1000000.0) << L" us serial, " << int32_t(parallelMixerTime * 1000000.0) << L" us with 3 workers." << Endl;
+}
+
+}
@@ -0,0 +1,309 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <atomic>
+#include <functional>
+#include "Core/Log/Log.h"
+#include "Core/Math/Random.h"
+#include "Core/Math/Transform.h"
+#include "Core/Thread/Thread.h"
+#include "Core/Thread/ThreadManager.h"
+#include "Core/Timer/Timer.h"
+#include "Sound/AudioDriverNull.h"
+#include "Sound/AudioSystem.h"
+#include "Sound/IAudioBuffer.h"
+#include "Sound/Sound.h"
+#include "Sound/Filters/SurroundEnvironment.h"
+#include "Sound/Player/SoundHandle.h"
+#include "Sound/Player/SoundListener.h"
+#include "Sound/Player/SoundPlayer.h"
+#include "Sound/Test/CaseSoundPlayer.h"
+
+namespace traktor::sound::test
+{
+	namespace
+	{
+
+const uint32_t c_channels = 32;
+const uint32_t c_sounds = 4000;
+const uint32_t c_frameSamples = 512;
+const uint32_t c_sampleRate = 44100;
+const float c_worldSize = 400.0f;
+const float c_range = 30.0f;
+const float c_innerRadius = 1.0f;
+const float c_dT = 1.0f / 60.0f;
+
+class TestAudioBufferCursor : public RefCountImpl< IAudioBufferCursor >
+{
+public:
+	uint32_t m_position = 0;
+
+	virtual void setParameter(handle_t id, float parameter) override final {}
+
+	virtual void disableRepeat() override final {}
+
+	virtual void reset() override final { m_position = 0; }
+};
+
+/*! Silence, endless unless duration is given; count number of samples read from buffer. */
+class TestAudioBuffer : public IAudioBuffer
+{
+public:
+	float m_duration = 0.0f;
+	mutable std::atomic< uint32_t > m_samples = 0;
+	mutable std::atomic< float > m_seekTime = 0.0f;
+
+	virtual Ref< IAudioBufferCursor > createCursor() const override final
+	{
+		return new TestAudioBufferCursor();
+	}
+
+	virtual bool getBlock(IAudioBufferCursor* cursor, const IAudioMixer* mixer, AudioBlock& outBlock) const override final
+	{
+		static float s_silence[c_frameSamples] = { 0.0f };
+
+		TestAudioBufferCursor* tabc = static_cast< TestAudioBufferCursor* >(cursor);
+		if (m_duration > 0.0f && tabc->m_position >= uint32_t(m_duration * c_sampleRate))
+			return false;
+
+		for (uint32_t i = 0; i < 2; ++i)
+			outBlock.samples[i] = s_silence;
+		outBlock.samplesCount = c_frameSamples;
+		outBlock.sampleRate = c_sampleRate;
+		outBlock.maxChannel = 2;
+		tabc->m_position += c_frameSamples;
+		m_samples += c_frameSamples;
+		return true;
+	}
+
+	virtual float getDuration() const override final
+	{
+		return m_duration;
+	}
+
+	virtual bool seek(IAudioBufferCursor* cursor, float time) const override final
+	{
+		static_cast< TestAudioBufferCursor* >(cursor)->m_position = uint32_t(time * c_sampleRate);
+		m_seekTime = time;
+		return true;
+	}
+};
+
+struct Emitter
+{
+	Ref< TestAudioBuffer > buffer;
+	Ref< SoundHandle > handle;
+	Vector4 position;
+};
+
+float distanceTo(const Emitter& emitter, const Vector4& listener)
+{
+	return (emitter.position - listener).xyz0().length();
+}
+
+void sleep(int32_t ms)
+{
+	ThreadManager::getInstance().getCurrentThread()->sleep(ms);
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.sound.test.CaseSoundPlayer", 0, CaseSoundPlayer, traktor::test::Case)
+
+void CaseSoundPlayer::run()
+{
+	Ref< AudioSystem > audioSystem = new AudioSystem(new AudioDriverNull());
+
+	AudioSystemCreateDesc desc;
+	desc.channels = c_channels;
+	desc.driverDesc.sampleRate = c_sampleRate;
+	desc.driverDesc.bitsPerSample = 16;
+	desc.driverDesc.hwChannels = 2;
+	desc.driverDesc.frameSamples = c_frameSamples;
+	if (!audioSystem->create(desc))
+	{
+		CASE_ASSERT(false);
+		return;
+	}
+
+	Ref< SurroundEnvironment > surroundEnvironment = new SurroundEnvironment(c_range, c_innerRadius, 1.0f, false);
+	Ref< SoundListener > listener = new SoundListener();
+
+	Ref< SoundPlayer > soundPlayer = new SoundPlayer();
+	soundPlayer->create(audioSystem, surroundEnvironment);
+	soundPlayer->addListener(listener);
+	soundPlayer->update(c_dT);
+
+	// Scatter sounds across world; only a few are within range of listener.
+	Random random(1234);
+	AlignedVector< Emitter > emitters(c_sounds);
+	uint32_t inRange = 0;
+	for (auto& emitter : emitters)
+	{
+		emitter.buffer = new TestAudioBuffer();
+		emitter.position = Vector4((random.nextFloat() - 0.5f) * c_worldSize, 0.0f, (random.nextFloat() - 0.5f) * c_worldSize, 1.0f);
+		emitter.handle = soundPlayer->play(new Sound(emitter.buffer, 0, 0.0f, c_range), emitter.position, 0, false);
+		if (distanceTo(emitter, Vector4::origo()) < c_range * 0.9f)
+			++inRange;
+	}
+
+	bool allPlaying = true;
+	for (const auto& emitter : emitters)
+		allPlaying &= (emitter.handle && emitter.handle->isPlaying());
+	CASE_ASSERT(allPlaying);
+	CASE_ASSERT(inRange > c_channels);
+
+	Timer timer;
+	for (int32_t i = 0; i < 60; ++i)
+		soundPlayer->update(c_dT);
+	const double updateTime = timer.getElapsedTime() / 60.0;
+
+	// Channel budget is fully used by audible sounds, rest are virtual.
+	SoundPlayerStatistics statistics;
+	soundPlayer->getStatistics(statistics);
+	CASE_ASSERT_EQUAL(statistics.realVoices, c_channels);
+	CASE_ASSERT_EQUAL(statistics.virtualVoices, c_sounds - c_channels);
+
+	bool realAudible = true;
+	for (const auto& emitter : emitters)
+	{
+		if (!emitter.handle->isVirtual())
+			realAudible &= (distanceTo(emitter, Vector4::origo()) < c_range + c_innerRadius);
+	}
+	CASE_ASSERT(realAudible);
+
+	// Let mixer run a few frames; inaudible sounds should never have been read.
+	sleep(100);
+
+	bool farSilent = true;
+	uint32_t mixed = 0;
+	for (const auto& emitter : emitters)
+	{
+		if (distanceTo(emitter, Vector4::origo()) >= c_range + c_innerRadius)
+			farSilent &= (emitter.buffer->m_samples == 0);
+		if (emitter.buffer->m_samples > 0)
+			++mixed;
+	}
+	CASE_ASSERT(farSilent);
+	CASE_ASSERT(mixed >= c_channels);
+
+	// Higher priority sound take a channel from an audible sound.
+	{
+		Ref< TestAudioBuffer > buffer = new TestAudioBuffer();
+		Ref< SoundHandle > handle = soundPlayer->play(new Sound(buffer, 0, 0.0f, c_range), Vector4(c_range * 0.8f, 0.0f, 0.0f, 1.0f), 1, false);
+		CASE_ASSERT(handle && !handle->isVirtual());
+		soundPlayer->update(c_dT);
+		CASE_ASSERT(handle && !handle->isVirtual());
+		handle->stop();
+		soundPlayer->update(c_dT);
+	}
+
+	// Find sound furthest away from listener; keep it virtual for a while.
+	Emitter* far = &emitters[0];
+	for (auto& emitter : emitters)
+	{
+		if (distanceTo(emitter, Vector4::origo()) > distanceTo(*far, Vector4::origo()))
+			far = &emitter;
+	}
+	CASE_ASSERT(far->handle->isVirtual());
+
+	const float virtualTime = 4.0f;
+	for (int32_t i = 0; i < int32_t(virtualTime / c_dT); ++i)
+		soundPlayer->update(c_dT);
+	CASE_ASSERT(far->handle->isVirtual());
+	CASE_ASSERT_EQUAL(far->buffer->m_samples.load(), 0u);
+
+	// Move listener to sound; it should become real and resume from it's virtual playback position.
+	listener->setTransform(Transform(far->position));
+	soundPlayer->update(c_dT);
+	CASE_ASSERT(!far->handle->isVirtual());
+
+	timer.reset();
+	while (far->buffer->m_samples == 0 && timer.getElapsedTime() < 2.0)
+		sleep(10);
+	const double resumeTime = timer.getElapsedTime();
+
+	// Cursor is moved to playback position; skipped part is never decoded.
+	CASE_ASSERT_COMPARE(far->buffer->m_seekTime.load(), virtualTime, std::greater_equal< float >());
+	CASE_ASSERT(far->buffer->m_samples > 0);
+	CASE_ASSERT_COMPARE(far->buffer->m_samples.load(), uint32_t(virtualTime * c_sampleRate * 0.5f), std::less< uint32_t >());
+
+	soundPlayer->getStatistics(statistics);
+	CASE_ASSERT(statistics.realized > 0);
+	CASE_ASSERT(statistics.virtualized > 0);
+	CASE_ASSERT_EQUAL(statistics.realVoices + statistics.virtualVoices, c_sounds);
+
+	// Finite virtual sound is retired when it reach it's end, even if referenced.
+	{
+		Ref< TestAudioBuffer > buffer = new TestAudioBuffer();
+		buffer->m_duration = 0.5f;
+		Ref< SoundHandle > handle = soundPlayer->play(new Sound(buffer, 0, 0.0f, c_range), far->position + Vector4(c_worldSize, 0.0f, 0.0f, 0.0f), 0, false);
+		CASE_ASSERT(handle && handle->isVirtual());
+		for (int32_t i = 0; i < int32_t(0.25f / c_dT); ++i)
+			soundPlayer->update(c_dT);
+		CASE_ASSERT(handle->isPlaying());
+		for (int32_t i = 0; i < int32_t(0.5f / c_dT); ++i)
+			soundPlayer->update(c_dT);
+		CASE_ASSERT(!handle->isPlaying());
+		CASE_ASSERT_EQUAL(buffer->m_samples.load(), 0u);
+	}
+
+	// Parameters can be set concurrently with player update.
+	{
+		std::atomic< bool > running = true;
+		Thread* thread = ThreadManager::getInstance().create([&]() {
+			uint32_t n = 0;
+			while (running)
+			{
+				for (auto& emitter : emitters)
+				{
+					if (emitter.handle)
+						emitter.handle->setParameter(int32_t(n++ & 15), 1.0f);
+				}
+			}
+		}, L"Sound parameters");
+		CASE_ASSERT(thread != nullptr);
+		if (thread)
+		{
+			thread->start();
+			for (int32_t i = 0; i < 30; ++i)
+			{
+				listener->setTransform(Transform(emitters[i * 37].position));
+				soundPlayer->update(c_dT);
+			}
+			running = false;
+			thread->wait();
+			ThreadManager::getInstance().destroy(thread);
+			listener->setTransform(Transform(far->position));
+			soundPlayer->update(c_dT);
+		}
+	}
+
+	// Virtual sounds without handle references are culled.
+	const uint32_t culled = statistics.culled;
+	uint32_t released = 0;
+	for (auto& emitter : emitters)
+	{
+		if (emitter.handle->isVirtual() && released < 1000)
+		{
+			emitter.handle = nullptr;
+			++released;
+		}
+	}
+	soundPlayer->update(c_dT);
+	soundPlayer->getStatistics(statistics);
+	CASE_ASSERT_EQUAL(statistics.culled, culled + released);
+	CASE_ASSERT_EQUAL(statistics.realVoices + statistics.virtualVoices, c_sounds - released);
+
+	log::info << c_sounds << L" sounds; " << statistics.realVoices << L" real, " << statistics.virtualVoices << L" virtual; update " << int32_t(updateTime * 1000000.0) << L" us, resumed " << int32_t(virtualTime * 1000.0f) << L" ms in " << int32_t(resumeTime * 1000.0) << L" ms." << Endl;
+
+	soundPlayer->destroy();
+	audioSystem->destroy();
+}
+
+}
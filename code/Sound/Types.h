@@ -82,11 +82,13 @@ struct AudioSystemCreateDesc
 {
 	SystemApplication sysapp;
 	uint32_t channels;									//!< Number of virtual channels.
+	uint32_t mixerThreads;								//!< Number of worker threads generating channel blocks in parallel with mixer thread.
 	AudioDriverCreateDesc driverDesc;					//!< Driver create description.
 	float cm[SbcMaxChannelCount][SbcMaxChannelCount];	//!< Final combine matrix.
 
 	AudioSystemCreateDesc()
 	:	channels(0)
+	,	mixerThreads(0)
 	{
 		for (int32_t i = 0; i < SbcMaxChannelCount; ++i)
 			for (int32_t j = 0; j < SbcMaxChannelCount; ++j)
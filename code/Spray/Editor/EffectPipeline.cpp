@@ -130,6 +130,11 @@ bool EffectPipeline::shouldCache() const
 	return false;
 }
 
+bool EffectPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t EffectPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
@@ -533,8 +533,11 @@ void EffectPreviewControl::eventPaint(ui::PaintEvent* event)
 					auto emitterInstance = dynamic_type_cast< const EmitterInstanceCPU* >(layerInstance->getEmitterInstance());
 					if (emitterInstance)
 					{
-						for (const auto& pnt : emitterInstance->getPoints())
+						const PointStore& points = emitterInstance->getPoints();
+						for (size_t i = 0; i < points.size(); ++i)
 						{
+							Point pnt;
+							points.get(i, pnt);
 							if (pnt.velocity.length() > FUZZY_EPSILON)
 							{
 								const Vector4 tail = pnt.position + pnt.velocity;
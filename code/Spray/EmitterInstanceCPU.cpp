@@ -42,6 +42,7 @@ const uint32_t c_maxEmitSingleShot = 400;
 #endif
 
 const uint32_t c_maxAlive = c_maxEmitSingleShot;
+const float c_incrementalSortCosAngle = 0.999f;	//!< Reuse last order if view direction differ less than ~2.5 degrees.
 
 	}
 
@@ -87,15 +88,16 @@ void EmitterInstanceCPU::update(Context& context, const Transform& transform, bo
 
 	// Erase dead particles.
 	size_t size = m_points.size();
+	float* age = m_points.getStream(PointStore::Age);
+	const float* maxAge = m_points.getStream(PointStore::MaxAge);
 	if (!m_emitter->getEffect() || m_effectInstances.size() != m_points.size())
 	{
 		for (size_t i = 0; i < size; )
 		{
-			Point& point = m_points[i];
-			if ((point.age += context.deltaTime) < point.maxAge)
+			if ((age[i] += context.deltaTime) < maxAge[i])
 				++i;
 			else if (i < --size)
-				point = m_points[size];
+				m_points.copy(i, size);
 		}
 		m_points.resize(size);
 	}
@@ -103,12 +105,11 @@ void EmitterInstanceCPU::update(Context& context, const Transform& transform, bo
 	{
 		for (size_t i = 0; i < size; )
 		{
-			Point& point = m_points[i];
-			if ((point.age += context.deltaTime) < point.maxAge)
+			if ((age[i] += context.deltaTime) < maxAge[i])
 				++i;
 			else if (i < --size)
 			{
-				point = m_points[size];
+				m_points.copy(i, size);
 				m_effectInstances[i] = m_effectInstances[size];
 			}
 		}
@@ -169,6 +170,13 @@ void EmitterInstanceCPU::update(Context& context, const Transform& transform, bo
 		}
 	}
 
+	// Move emitted points into store.
+	if (!m_emitPoints.empty())
+	{
+		m_points.append(m_emitPoints.c_ptr(), m_emitPoints.size());
+		m_emitPoints.resize(0);
+	}
+
 	m_totalTime += context.deltaTime;
 
 	// Calculate bounding box; do this before modifiers as modifiers are executed
@@ -177,10 +185,18 @@ void EmitterInstanceCPU::update(Context& context, const Transform& transform, bo
 	{
 		m_boundingBox = Aabb3();
 		const Scalar deltaTime16 = Scalar(context.deltaTime * 16.0f);
-		for (const auto& point : m_points)
+		const float* px = m_points.getStream(PointStore::PositionX);
+		const float* py = m_points.getStream(PointStore::PositionY);
+		const float* pz = m_points.getStream(PointStore::PositionZ);
+		const float* vx = m_points.getStream(PointStore::VelocityX);
+		const float* vy = m_points.getStream(PointStore::VelocityY);
+		const float* vz = m_points.getStream(PointStore::VelocityZ);
+		for (size_t i = 0; i < m_points.size(); ++i)
 		{
-			m_boundingBox.contain(point.position);
-			m_boundingBox.contain(point.position + point.velocity * deltaTime16);
+			const Vector4 position(px[i], py[i], pz[i], 1.0f);
+			const Vector4 velocity(vx[i], vy[i], vz[i], 0.0f);
+			m_boundingBox.contain(position);
+			m_boundingBox.contain(position + velocity * deltaTime16);
 		}
 		m_boundingBox = m_boundingBox.expand(1.0_simd);
 		if (!m_emitter->worldSpace())
@@ -309,8 +325,11 @@ EmitterInstanceCPU::EmitterInstanceCPU(const Emitter* emitter, float duration)
 ,	m_warm(false)
 ,	m_count(0)
 ,	m_skip(1)
+,	m_sortNormal(Vector4::zero())
+,	m_sorted(false)
 {
 	m_points.reserve(c_maxAlive);
+	m_emitPoints.reserve(c_maxEmitSingleShot);
 	m_renderPoints.reserve(c_maxAlive);
 }
 
@@ -319,21 +338,54 @@ void EmitterInstanceCPU::updateTask(float deltaTime)
 	const Transform updateTransform = m_emitter->worldSpace() ? m_transform : Transform::identity();
 	const Scalar deltaTimeScalar(deltaTime);
 
-	for (auto modifier : m_emitter->getModifiers())
-	{
-		modifier->update(
-			deltaTimeScalar,
-			updateTransform,
-			m_points,
-			0,
-			m_points.size()
-		);
-	}
+	m_points.modify(
+		m_emitter->getModifiers(),
+		deltaTimeScalar,
+		updateTransform
+	);
 
 	m_renderPoints.resize(0);
 
-	for (uint32_t i = 0; i < m_points.size(); i += m_skip)
-		m_renderPoints.push_back(m_points[i]);
+	// \note Do not sort furthest lod.
+	if (
+		!m_points.empty() &&
+		m_emitter->getSort() &&
+		m_skip < 4
+	)
+	{
+		// Sort in same space as points.
+		const Plane sortPlane = m_emitter->worldSpace() ? m_sortPlane : m_transform.inverse().toMatrix44() * m_sortPlane;
+
+		// Points are stored in last order, reuse it if view direction
+		// hasn't changed much as order only depend on plane normal.
+		const bool incremental = m_sorted && m_skip == 1 && dot3(sortPlane.normal(), m_sortNormal) >= c_incrementalSortCosAngle;
+		const AlignedVector< uint32_t >& order = m_pointSort.sort(m_points, sortPlane, m_skip, incremental);
+
+		for (auto index : order)
+			m_points.get(index, m_renderPoints.push_back());
+
+		if (m_skip == 1)
+		{
+			m_points.permute(order.c_ptr());
+			if (m_effectInstances.size() == order.size())
+			{
+				RefArray< EffectInstance > effectInstances(order.size());
+				for (uint32_t i = 0; i < order.size(); ++i)
+					effectInstances[i] = m_effectInstances[order[i]];
+				m_effectInstances.swap(effectInstances);
+			}
+			m_sortNormal = sortPlane.normal();
+			m_sorted = true;
+		}
+		else
+			m_sorted = false;
+	}
+	else
+	{
+		for (uint32_t i = 0; i < m_points.size(); i += m_skip)
+			m_points.get(i, m_renderPoints.push_back());
+		m_sorted = false;
+	}
 
 	if (!m_emitter->worldSpace())
 	{
@@ -344,18 +396,6 @@ void EmitterInstanceCPU::updateTask(float deltaTime)
 		}
 	}
 
-	// \note Do not sort furthest lod.
-	if (
-		!m_renderPoints.empty() &&
-		m_emitter->getSort() &&
-		m_skip < 4
-	)
-	{
-		std::sort(m_renderPoints.begin(), m_renderPoints.end(), [=, this](const Point& lh, const Point& rh) {
-			return (bool)(m_sortPlane.distance(lh.position) > m_sortPlane.distance(rh.position));
-		});
-	}
-
 	if (m_emitter->getEffect())
 	{
 		// Create new effect instances for each new particle point.
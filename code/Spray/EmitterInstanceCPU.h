@@ -14,6 +14,8 @@
 #include "Spray/IEmitterInstance.h"
 #include "Spray/Modifier.h"
 #include "Spray/Point.h"
+#include "Spray/PointSort.h"
+#include "Spray/PointStore.h"
 
 // import/export mechanism.
 #undef T_DLLCLASS
@@ -70,20 +72,22 @@ public:
 
 	void reservePoints(uint32_t npoints) { m_points.reserve(m_points.size() + npoints); }
 
-	const pointVector_t& getPoints() const { return m_points; }
+	const PointStore& getPoints() const { return m_points; }
 
+	/*! Add points, added points are moved into store after source has emitted. */
 	Point* addPoints(uint32_t points)
 	{
-		const uint32_t offset = uint32_t(m_points.size());
-		m_points.resize(offset + points);
-		return &m_points[offset];
+		const uint32_t offset = uint32_t(m_emitPoints.size());
+		m_emitPoints.resize(offset + points);
+		return &m_emitPoints[offset];
 	}
 
 private:
 	Ref< const Emitter > m_emitter;
 	Transform m_transform;
 	Plane m_sortPlane;
-	pointVector_t m_points;
+	PointStore m_points;
+	pointVector_t m_emitPoints;
 	pointVector_t m_renderPoints;
 	RefArray< EffectInstance > m_effectInstances;
 	float m_totalTime;
@@ -92,6 +96,9 @@ private:
 	Aabb3 m_boundingBox;
 	uint32_t m_count;
 	uint32_t m_skip;
+	PointSort m_pointSort;
+	Vector4 m_sortNormal;
+	bool m_sorted;
 	mutable Ref< Job > m_job;
 
 	explicit EmitterInstanceCPU(const Emitter* emitter, float duration);
@@ -15,6 +15,8 @@
 namespace traktor::spray
 {
 
+class PointStore;
+
 /*! Emitter modifier.
  * \ingroup Spray
  */
@@ -26,6 +28,17 @@ public:
 	virtual void writeSequence(Vector4*& inoutSequence) const {};
 
 	virtual void update(const Scalar& deltaTime, const Transform& transform, pointVector_t& points, size_t first, size_t last) const = 0;
+
+	/*! True if modifier can update points stored as structure of arrays. */
+	virtual bool haveKernel() const { return false; }
+
+	/*! Update points stored as structure of arrays.
+	 *
+	 * First is a multiple of four; lanes after last up to
+	 * next multiple of four are padding and might be updated
+	 * as well.
+	 */
+	virtual void updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const {}
 };
 
 }
@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Spray/Modifiers/BrownianModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -41,4 +42,31 @@ void BrownianModifier::update(const Scalar& deltaTime, const Transform& transfor
 	}
 }
 
+void BrownianModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Vector4 factor(m_factor * deltaTime);
+
+	float* vx = points.getStream(PointStore::VelocityX);
+	float* vy = points.getStream(PointStore::VelocityY);
+	float* vz = points.getStream(PointStore::VelocityZ);
+	const float* im = points.getStream(PointStore::InverseMass);
+
+	for (size_t i = first; i < last; i += 4)
+	{
+		// Random numbers are drawn for each point; padding lanes are left unchanged.
+		T_MATH_ALIGN16 float r[3][4] = {};
+		for (size_t j = 0; j < 4 && i + j < last; ++j)
+		{
+			r[0][j] = m_random.nextFloat() * 2.0f - 1.0f;
+			r[1][j] = m_random.nextFloat() * 2.0f - 1.0f;
+			r[2][j] = m_random.nextFloat() * 2.0f - 1.0f;
+		}
+
+		const Vector4 m = Vector4::loadAligned(&im[i]) * factor;
+		(Vector4::loadAligned(&vx[i]) + Vector4::loadAligned(r[0]) * m).storeAligned(&vx[i]);
+		(Vector4::loadAligned(&vy[i]) + Vector4::loadAligned(r[1]) * m).storeAligned(&vy[i]);
+		(Vector4::loadAligned(&vz[i]) + Vector4::loadAligned(r[2]) * m).storeAligned(&vz[i]);
+	}
+}
+
 }
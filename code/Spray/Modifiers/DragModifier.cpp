@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Spray/Modifiers/DragModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -41,4 +42,23 @@ void DragModifier::update(const Scalar& deltaTime, const Transform& transform, p
 	}
 }
 
+void DragModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Vector4 dv(1.0_simd - m_linearDrag * deltaTime);
+	const Vector4 da(Scalar(1.0f - m_angularDrag * deltaTime));
+
+	float* vx = points.getStream(PointStore::VelocityX);
+	float* vy = points.getStream(PointStore::VelocityY);
+	float* vz = points.getStream(PointStore::VelocityZ);
+	float* av = points.getStream(PointStore::AngularVelocity);
+
+	for (size_t i = first; i < last; i += 4)
+	{
+		(Vector4::loadAligned(&vx[i]) * dv).storeAligned(&vx[i]);
+		(Vector4::loadAligned(&vy[i]) * dv).storeAligned(&vy[i]);
+		(Vector4::loadAligned(&vz[i]) * dv).storeAligned(&vz[i]);
+		(Vector4::loadAligned(&av[i]) * da).storeAligned(&av[i]);
+	}
+}
+
 }
@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Spray/Modifiers/GravityModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -36,4 +37,23 @@ void GravityModifier::update(const Scalar& deltaTime, const Transform& transform
 		points[i].velocity += gravity * Scalar(points[i].inverseMass);
 }
 
+void GravityModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Vector4 gravity = (m_world ? m_gravity : transform * m_gravity) * deltaTime;
+	const Vector4 gx(gravity.x()), gy(gravity.y()), gz(gravity.z());
+
+	float* vx = points.getStream(PointStore::VelocityX);
+	float* vy = points.getStream(PointStore::VelocityY);
+	float* vz = points.getStream(PointStore::VelocityZ);
+	const float* im = points.getStream(PointStore::InverseMass);
+
+	for (size_t i = first; i < last; i += 4)
+	{
+		const Vector4 m = Vector4::loadAligned(&im[i]);
+		(Vector4::loadAligned(&vx[i]) + gx * m).storeAligned(&vx[i]);
+		(Vector4::loadAligned(&vy[i]) + gy * m).storeAligned(&vy[i]);
+		(Vector4::loadAligned(&vz[i]) + gz * m).storeAligned(&vz[i]);
+	}
+}
+
 }
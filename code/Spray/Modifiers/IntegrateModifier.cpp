@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Spray/Modifiers/IntegrateModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -53,4 +54,37 @@ void IntegrateModifier::update(const Scalar& deltaTime, const Transform& transfo
 	}
 }
 
+void IntegrateModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Vector4 scaledDeltaTime(deltaTime * m_timeScale);
+
+	if (m_linear)
+	{
+		float* px = points.getStream(PointStore::PositionX);
+		float* py = points.getStream(PointStore::PositionY);
+		float* pz = points.getStream(PointStore::PositionZ);
+		const float* vx = points.getStream(PointStore::VelocityX);
+		const float* vy = points.getStream(PointStore::VelocityY);
+		const float* vz = points.getStream(PointStore::VelocityZ);
+		const float* im = points.getStream(PointStore::InverseMass);
+
+		for (size_t i = first; i < last; i += 4)
+		{
+			const Vector4 m = Vector4::loadAligned(&im[i]);
+			(Vector4::loadAligned(&px[i]) + Vector4::loadAligned(&vx[i]) * m * scaledDeltaTime).storeAligned(&px[i]);
+			(Vector4::loadAligned(&py[i]) + Vector4::loadAligned(&vy[i]) * m * scaledDeltaTime).storeAligned(&py[i]);
+			(Vector4::loadAligned(&pz[i]) + Vector4::loadAligned(&vz[i]) * m * scaledDeltaTime).storeAligned(&pz[i]);
+		}
+	}
+
+	if (m_angular)
+	{
+		float* o = points.getStream(PointStore::Orientation);
+		const float* av = points.getStream(PointStore::AngularVelocity);
+
+		for (size_t i = first; i < last; i += 4)
+			(Vector4::loadAligned(&o[i]) + Vector4::loadAligned(&av[i]) * scaledDeltaTime).storeAligned(&o[i]);
+	}
+}
+
 }
@@ -29,6 +29,10 @@ public:
 
 	virtual void update(const Scalar& deltaTime, const Transform& transform, pointVector_t& points, size_t first, size_t last) const override final;
 
+	virtual bool haveKernel() const override final { return true; }
+
+	virtual void updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const override final;
+
 private:
 	Scalar m_timeScale;
 	bool m_linear;
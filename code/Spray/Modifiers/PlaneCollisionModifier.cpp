@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Spray/Modifiers/PlaneCollisionModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -42,4 +43,49 @@ void PlaneCollisionModifier::update(const Scalar& deltaTime, const Transform& tr
 	}
 }
 
+void PlaneCollisionModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Plane planeW = transform.toMatrix44() * m_plane;
+	const Vector4 center = transform.translation();
+	const Vector4 reflectNormal = m_plane.normal().normalized();
+
+	const Vector4 wx(planeW.normal().x()), wy(planeW.normal().y()), wz(planeW.normal().z()), wd(planeW.distance());
+	const Vector4 rx(reflectNormal.x()), ry(reflectNormal.y()), rz(reflectNormal.z());
+	const Vector4 cx(center.x()), cy(center.y()), cz(center.z());
+	const Vector4 radius(m_radius);
+	const Vector4 restitution(m_restitution);
+	const Vector4 two(2.0f, 2.0f, 2.0f, 2.0f);
+
+	const float* px = points.getStream(PointStore::PositionX);
+	const float* py = points.getStream(PointStore::PositionY);
+	const float* pz = points.getStream(PointStore::PositionZ);
+	float* vx = points.getStream(PointStore::VelocityX);
+	float* vy = points.getStream(PointStore::VelocityY);
+	float* vz = points.getStream(PointStore::VelocityZ);
+	const float* s = points.getStream(PointStore::Size);
+
+	for (size_t i = first; i < last; i += 4)
+	{
+		const Vector4 x = Vector4::loadAligned(&px[i]);
+		const Vector4 y = Vector4::loadAligned(&py[i]);
+		const Vector4 z = Vector4::loadAligned(&pz[i]);
+		const Vector4 u = Vector4::loadAligned(&vx[i]);
+		const Vector4 v = Vector4::loadAligned(&vy[i]);
+		const Vector4 w = Vector4::loadAligned(&vz[i]);
+
+		// Points collide where all are negative.
+		const Vector4 rv = wx * u + wy * v + wz * w;
+		const Vector4 rd = wx * x + wy * y + wz * z - wd - Vector4::loadAligned(&s[i]);
+		const Vector4 dx = x - cx, dy = y - cy, dz = z - cz;
+		const Vector4 rc = dx * dx + dy * dy + dz * dz - radius;
+		const Vector4 collide = max(rv, max(rd, rc));
+
+		// Reflected velocity.
+		const Vector4 k = (rx * u + ry * v + rz * w) * two;
+		select(collide, (u - rx * k) * restitution, u).storeAligned(&vx[i]);
+		select(collide, (v - ry * k) * restitution, v).storeAligned(&vy[i]);
+		select(collide, (w - rz * k) * restitution, w).storeAligned(&vz[i]);
+	}
+}
+
 }
@@ -7,6 +7,7 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 #include "Spray/Modifiers/SizeModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -35,4 +36,13 @@ void SizeModifier::update(const Scalar& deltaTime, const Transform& transform, p
 		points[i].size += deltaSize;
 }
 
+void SizeModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Vector4 deltaSize(Scalar(m_adjustRate * deltaTime));
+
+	float* s = points.getStream(PointStore::Size);
+	for (size_t i = first; i < last; i += 4)
+		(Vector4::loadAligned(&s[i]) + deltaSize).storeAligned(&s[i]);
+}
+
 }
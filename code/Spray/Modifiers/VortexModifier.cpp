@@ -6,7 +6,9 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <cmath>
 #include "Spray/Modifiers/VortexModifier.h"
+#include "Spray/PointStore.h"
 
 namespace traktor::spray
 {
@@ -56,4 +58,68 @@ void VortexModifier::update(const Scalar& deltaTime, const Transform& transform,
 	}
 }
 
+void VortexModifier::updateKernel(const Scalar& deltaTime, const Transform& transform, PointStore& points, size_t first, size_t last) const
+{
+	const Vector4 axis = m_world ? m_axis : transform * m_axis;
+	const Vector4 center = m_world ? transform.translation() : Vector4::origo();
+
+	const Vector4 ax(axis.x()), ay(axis.y()), az(axis.z());
+	const Vector4 cx(center.x()), cy(center.y()), cz(center.z());
+	const Vector4 tangentForce(m_tangentForce * deltaTime);
+	const Vector4 normalConstantForce(m_normalConstantForce);
+	const Vector4 normalDistance(m_normalDistance);
+	const Vector4 normalDistanceForce(m_normalDistanceForce);
+	const Vector4 dt(deltaTime);
+
+	const float* px = points.getStream(PointStore::PositionX);
+	const float* py = points.getStream(PointStore::PositionY);
+	const float* pz = points.getStream(PointStore::PositionZ);
+	float* vx = points.getStream(PointStore::VelocityX);
+	float* vy = points.getStream(PointStore::VelocityY);
+	float* vz = points.getStream(PointStore::VelocityZ);
+	const float* im = points.getStream(PointStore::InverseMass);
+
+	T_MATH_ALIGN16 float length[4];
+
+	for (size_t i = first; i < last; i += 4)
+	{
+		Vector4 pcx = Vector4::loadAligned(&px[i]) - cx;
+		Vector4 pcy = Vector4::loadAligned(&py[i]) - cy;
+		Vector4 pcz = Vector4::loadAligned(&pz[i]) - cz;
+
+		// Project onto plane.
+		const Vector4 d = pcx * ax + pcy * ay + pcz * az;
+		pcx -= ax * d;
+		pcy -= ay * d;
+		pcz -= az * d;
+
+		// Calculate normal and tangent vectors.
+		(pcx * pcx + pcy * pcy + pcz * pcz).storeAligned(length);
+		for (int32_t j = 0; j < 4; ++j)
+			length[j] = std::sqrt(length[j]);
+
+		const Vector4 distance = Vector4::loadAligned(length);
+		const Vector4 nx = pcx / distance;
+		const Vector4 ny = pcy / distance;
+		const Vector4 nz = pcz / distance;
+
+		Vector4 tx = ay * nz - az * ny;
+		Vector4 ty = az * nx - ax * nz;
+		Vector4 tz = ax * ny - ay * nx;
+
+		(tx * tx + ty * ty + tz * tz).storeAligned(length);
+		for (int32_t j = 0; j < 4; ++j)
+			length[j] = std::sqrt(length[j]);
+
+		const Vector4 tangentScale = tangentForce / Vector4::loadAligned(length);
+		const Vector4 normalScale = (normalConstantForce + (distance - normalDistance) * normalDistanceForce) * dt;
+
+		// Adjust velocity from this tangent.
+		const Vector4 m = Vector4::loadAligned(&im[i]);
+		(Vector4::loadAligned(&vx[i]) + (tx * tangentScale + nx * normalScale) * m).storeAligned(&vx[i]);
+		(Vector4::loadAligned(&vy[i]) + (ty * tangentScale + ny * normalScale) * m).storeAligned(&vy[i]);
+		(Vector4::loadAligned(&vz[i]) + (tz * tangentScale + nz * normalScale) * m).storeAligned(&vz[i]);
+	}
+}
+
 }
@@ -0,0 +1,188 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <limits>
+#include "Core/Thread/JobManager.h"
+#include "Spray/PointSort.h"
+#include "Spray/PointStore.h"
+
+namespace traktor::spray
+{
+	namespace
+	{
+
+const uint32_t c_parallelCount = 65536;		//!< Sort in parallel if at least this many points.
+const uint32_t c_maxChunks = 16;
+const uint32_t c_insertionMoves = 16;		//!< Average number of moves per point before insertion sort give up.
+
+uint32_t chunkCount(uint32_t count)
+{
+	if (count < c_parallelCount)
+		return 1;
+	return std::min< uint32_t >(JobManager::getInstance().getQueue().getWorkerCount() + 1, c_maxChunks);
+}
+
+/*! Run body on each chunk of range, in parallel if more than one chunk. */
+template < typename BodyType >
+void forEachChunk(uint32_t count, uint32_t chunks, const BodyType& body)
+{
+	const uint32_t chunkSize = (count + chunks - 1) / chunks;
+	if (chunks > 1)
+	{
+		JobManager::getInstance().parallelFor((int32_t)chunks, 1, [&](int32_t from, int32_t to) {
+			for (int32_t chunk = from; chunk < to; ++chunk)
+				body((uint32_t)chunk, std::min(chunk * chunkSize, count), std::min((chunk + 1) * chunkSize, count));
+		});
+	}
+	else
+		body(0, 0, count);
+}
+
+	}
+
+const AlignedVector< uint32_t >& PointSort::sort(const PointStore& points, const Plane& plane, uint32_t skip, bool incremental)
+{
+	const uint32_t count = uint32_t((points.size() + skip - 1) / skip);
+	const uint32_t chunks = chunkCount(count);
+
+	m_distances.resize(count);
+	m_items.resize(count);
+
+	// Calculate distance to plane once for each point, track range in each chunk.
+	const float nx = plane.normal().x();
+	const float ny = plane.normal().y();
+	const float nz = plane.normal().z();
+	const float d = plane.distance();
+	const float* px = points.getStream(PointStore::PositionX);
+	const float* py = points.getStream(PointStore::PositionY);
+	const float* pz = points.getStream(PointStore::PositionZ);
+
+	float ranges[c_maxChunks][2];
+	forEachChunk(count, chunks, [&](uint32_t chunk, uint32_t from, uint32_t to) {
+		float mn = std::numeric_limits< float >::max();
+		float mx = -std::numeric_limits< float >::max();
+		for (uint32_t i = from; i < to; ++i)
+		{
+			const uint32_t j = i * skip;
+			const float distance = nx * px[j] + ny * py[j] + nz * pz[j] - d;
+			m_distances[i] = distance;
+			mn = std::min(mn, distance);
+			mx = std::max(mx, distance);
+		}
+		ranges[chunk][0] = mn;
+		ranges[chunk][1] = mx;
+	});
+
+	float mn = std::numeric_limits< float >::max();
+	float mx = -std::numeric_limits< float >::max();
+	for (uint32_t i = 0; i < chunks; ++i)
+	{
+		mn = std::min(mn, ranges[i][0]);
+		mx = std::max(mx, ranges[i][1]);
+	}
+
+	// Quantize distances into keys; furthest point has key zero.
+	const float scale = (mx > mn) ? 65535.0f / (mx - mn) : 0.0f;
+	auto buildItems = [&](uint32_t chunk, uint32_t from, uint32_t to) {
+		for (uint32_t i = from; i < to; ++i)
+		{
+			const uint64_t key = (uint64_t)((mx - m_distances[i]) * scale);
+			m_items[i] = (key << 32) | (i * skip);
+		}
+	};
+	forEachChunk(count, chunks, buildItems);
+
+	m_incremental = false;
+	if (incremental)
+	{
+		m_incremental = insertionSort();
+		if (!m_incremental)
+			forEachChunk(count, chunks, buildItems);
+	}
+	if (!m_incremental)
+		radixSort();
+
+	m_order.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+		m_order[i] = (uint32_t)m_items[i];
+
+	return m_order;
+}
+
+bool PointSort::insertionSort()
+{
+	uint64_t* items = m_items.ptr();
+	const uint32_t count = (uint32_t)m_items.size();
+	const uint32_t maxMoves = count * c_insertionMoves;
+
+	uint32_t moves = 0;
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		const uint64_t item = items[i];
+		uint32_t j = i;
+		for (; j > 0 && items[j - 1] > item; --j)
+			items[j] = items[j - 1];
+		items[j] = item;
+
+		if ((moves += i - j) > maxMoves)
+			return false;
+	}
+
+	return true;
+}
+
+void PointSort::radixSort()
+{
+	const uint32_t count = (uint32_t)m_items.size();
+	const uint32_t chunks = chunkCount(count);
+
+	m_temp.resize(count);
+	m_histograms.resize(chunks * 256);
+
+	uint64_t* from = m_items.ptr();
+	uint64_t* to = m_temp.ptr();
+
+	// Two passes of eight bits each, keys are stored in upper half of items.
+	for (uint32_t shift = 32; shift < 48; shift += 8)
+	{
+		uint32_t* histograms = m_histograms.ptr();
+		std::fill(histograms, histograms + chunks * 256, 0);
+
+		forEachChunk(count, chunks, [&](uint32_t chunk, uint32_t first, uint32_t last) {
+			uint32_t* histogram = histograms + chunk * 256;
+			for (uint32_t i = first; i < last; ++i)
+				histogram[(from[i] >> shift) & 255]++;
+		});
+
+		// Offset of each digit in each chunk; chunks are kept in order so sort is stable.
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < 256; ++digit)
+		{
+			for (uint32_t chunk = 0; chunk < chunks; ++chunk)
+			{
+				const uint32_t n = histograms[chunk * 256 + digit];
+				histograms[chunk * 256 + digit] = offset;
+				offset += n;
+			}
+		}
+
+		forEachChunk(count, chunks, [&](uint32_t chunk, uint32_t first, uint32_t last) {
+			uint32_t* histogram = histograms + chunk * 256;
+			for (uint32_t i = first; i < last; ++i)
+				to[histogram[(from[i] >> shift) & 255]++] = from[i];
+		});
+
+		std::swap(from, to);
+	}
+
+	// Even number of passes; sorted items are back in first array.
+	T_ASSERT(from == m_items.ptr());
+}
+
+}
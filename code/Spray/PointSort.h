@@ -0,0 +1,70 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Math/Plane.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_SPRAY_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::spray
+{
+
+class PointStore;
+
+/*! Back to front sort of points.
+ * \ingroup Spray
+ *
+ * Distance to sort plane is calculated once for each point
+ * and quantized into a 16 bit key, keys are then sorted
+ * using a radix sort which run in parallel for large
+ * number of points.
+ *
+ * If points already are stored in previous frame's order
+ * an insertion sort can be used instead, which is faster
+ * as long as order hasn't changed much.
+ */
+class T_DLLCLASS PointSort
+{
+public:
+	/*! Sort points.
+	 *
+	 * Points with equal keys are kept in stored order.
+	 *
+	 * \param points Points to sort.
+	 * \param plane Sort plane, in same space as points.
+	 * \param skip Only sort every skip:th point.
+	 * \param incremental Try insertion sort first, falls back to radix sort if order has changed too much.
+	 * \return Point indices, back to front.
+	 */
+	const AlignedVector< uint32_t >& sort(const PointStore& points, const Plane& plane, uint32_t skip, bool incremental);
+
+	/*! True if last sort was done using insertion sort. */
+	bool wasIncremental() const { return m_incremental; }
+
+private:
+	AlignedVector< float > m_distances;
+	AlignedVector< uint64_t > m_items;
+	AlignedVector< uint64_t > m_temp;
+	AlignedVector< uint32_t > m_histograms;
+	AlignedVector< uint32_t > m_order;
+	bool m_incremental = false;
+
+	bool insertionSort();
+
+	void radixSort();
+};
+
+}
@@ -0,0 +1,136 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Misc/Align.h"
+#include "Spray/Modifier.h"
+#include "Spray/PointStore.h"
+
+namespace traktor::spray
+{
+
+void PointStore::reserve(size_t capacity)
+{
+	capacity = alignUp(capacity, 4);
+	if (capacity <= m_capacity)
+		return;
+
+	AlignedVector< float > data(StreamCount * capacity, 0.0f);
+	for (int32_t i = 0; i < StreamCount; ++i)
+		std::copy(m_data.c_ptr() + i * m_capacity, m_data.c_ptr() + i * m_capacity + m_size, data.ptr() + i * capacity);
+
+	m_data.swap(data);
+	m_capacity = capacity;
+}
+
+void PointStore::resize(size_t size)
+{
+	if (size > m_capacity)
+		reserve(std::max(size, m_capacity * 2));
+	m_size = size;
+}
+
+void PointStore::get(size_t index, Point& outPoint) const
+{
+	const float* data = m_data.c_ptr() + index;
+	outPoint.position = Vector4(data[PositionX * m_capacity], data[PositionY * m_capacity], data[PositionZ * m_capacity], 1.0f);
+	outPoint.velocity = Vector4(data[VelocityX * m_capacity], data[VelocityY * m_capacity], data[VelocityZ * m_capacity], 0.0f);
+	outPoint.orientation = data[Orientation * m_capacity];
+	outPoint.angularVelocity = data[AngularVelocity * m_capacity];
+	outPoint.inverseMass = data[InverseMass * m_capacity];
+	outPoint.age = data[Age * m_capacity];
+	outPoint.maxAge = data[MaxAge * m_capacity];
+	outPoint.size = data[Size * m_capacity];
+	outPoint.random = data[Random * m_capacity];
+	outPoint.alpha = data[Alpha * m_capacity];
+}
+
+void PointStore::set(size_t index, const Point& point)
+{
+	float* data = m_data.ptr() + index;
+	data[PositionX * m_capacity] = point.position.x();
+	data[PositionY * m_capacity] = point.position.y();
+	data[PositionZ * m_capacity] = point.position.z();
+	data[VelocityX * m_capacity] = point.velocity.x();
+	data[VelocityY * m_capacity] = point.velocity.y();
+	data[VelocityZ * m_capacity] = point.velocity.z();
+	data[Orientation * m_capacity] = point.orientation;
+	data[AngularVelocity * m_capacity] = point.angularVelocity;
+	data[InverseMass * m_capacity] = point.inverseMass;
+	data[Age * m_capacity] = point.age;
+	data[MaxAge * m_capacity] = point.maxAge;
+	data[Size * m_capacity] = point.size;
+	data[Random * m_capacity] = point.random;
+	data[Alpha * m_capacity] = point.alpha;
+}
+
+void PointStore::copy(size_t to, size_t from)
+{
+	float* data = m_data.ptr();
+	for (int32_t i = 0; i < StreamCount; ++i)
+		data[i * m_capacity + to] = data[i * m_capacity + from];
+}
+
+void PointStore::append(const Point* points, size_t count)
+{
+	const size_t offset = m_size;
+	resize(m_size + count);
+	scatter(offset, offset + count, points);
+}
+
+void PointStore::gather(size_t first, size_t last, Point* outPoints) const
+{
+	for (size_t i = first; i < last; ++i)
+		get(i, *outPoints++);
+}
+
+void PointStore::scatter(size_t first, size_t last, const Point* points)
+{
+	for (size_t i = first; i < last; ++i)
+		set(i, *points++);
+}
+
+void PointStore::permute(const uint32_t* order)
+{
+	m_permute.resize(m_size);
+	for (int32_t i = 0; i < StreamCount; ++i)
+	{
+		float* data = m_data.ptr() + i * m_capacity;
+		for (size_t j = 0; j < m_size; ++j)
+			m_permute[j] = data[order[j]];
+		std::copy(m_permute.c_ptr(), m_permute.c_ptr() + m_size, data);
+	}
+}
+
+void PointStore::modify(const RefArray< const Modifier >& modifiers, const Scalar& deltaTime, const Transform& transform)
+{
+	for (size_t first = 0; first < m_size; first += BlockSize)
+	{
+		const size_t last = std::min(first + BlockSize, m_size);
+		const size_t count = last - first;
+
+		for (size_t i = 0; i < modifiers.size(); )
+		{
+			if (modifiers[i]->haveKernel())
+			{
+				modifiers[i]->updateKernel(deltaTime, transform, *this, first, last);
+				++i;
+				continue;
+			}
+
+			// Consecutive modifiers without kernel share same copy of block.
+			m_block.resize(count);
+			gather(first, last, m_block.ptr());
+			for (; i < modifiers.size() && !modifiers[i]->haveKernel(); ++i)
+				modifiers[i]->update(deltaTime, transform, m_block, 0, count);
+			scatter(first, last, m_block.c_ptr());
+		}
+	}
+}
+
+}
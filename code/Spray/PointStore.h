@@ -0,0 +1,119 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/RefArray.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Math/Transform.h"
+#include "Spray/Point.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_SPRAY_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::spray
+{
+
+class Modifier;
+
+/*! Particle points stored as structure of arrays.
+ * \ingroup Spray
+ *
+ * Each member of a point is stored in a separate stream
+ * so modifiers can update four points at a time using
+ * Vector4 lanes. Streams are padded to a multiple of four
+ * points.
+ */
+class T_DLLCLASS PointStore
+{
+public:
+	enum Stream
+	{
+		PositionX,
+		PositionY,
+		PositionZ,
+		VelocityX,
+		VelocityY,
+		VelocityZ,
+		Orientation,
+		AngularVelocity,
+		InverseMass,
+		Age,
+		MaxAge,
+		Size,
+		Random,
+		Alpha,
+		StreamCount
+	};
+
+	/*! Number of points updated by each modifier before next modifier is run. */
+	static constexpr size_t BlockSize = 256;
+
+	void reserve(size_t capacity);
+
+	void resize(size_t size);
+
+	void clear() { m_size = 0; }
+
+	size_t size() const { return m_size; }
+
+	size_t capacity() const { return m_capacity; }
+
+	bool empty() const { return m_size == 0; }
+
+	float* getStream(Stream stream) { return m_data.ptr() + stream * m_capacity; }
+
+	const float* getStream(Stream stream) const { return m_data.c_ptr() + stream * m_capacity; }
+
+	/*! Read single point. */
+	void get(size_t index, Point& outPoint) const;
+
+	/*! Write single point. */
+	void set(size_t index, const Point& point);
+
+	/*! Copy point from one index to another. */
+	void copy(size_t to, size_t from);
+
+	/*! Append points. */
+	void append(const Point* points, size_t count);
+
+	/*! Read points [first, last) into array. */
+	void gather(size_t first, size_t last, Point* outPoints) const;
+
+	/*! Write points [first, last) from array. */
+	void scatter(size_t first, size_t last, const Point* points);
+
+	/*! Reorder points.
+	 *
+	 * \param order Index of point to move into each position, must contain all points.
+	 */
+	void permute(const uint32_t* order);
+
+	/*! Run modifiers on all points.
+	 *
+	 * Points are updated in blocks small enough to stay in
+	 * cache, all modifiers are run on a block before moving to
+	 * next block. Modifiers without a structure of arrays
+	 * kernel update a copy of the block as an array of points.
+	 */
+	void modify(const RefArray< const Modifier >& modifiers, const Scalar& deltaTime, const Transform& transform);
+
+private:
+	AlignedVector< float > m_data;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+	pointVector_t m_block;
+	AlignedVector< float > m_permute;
+};
+
+}
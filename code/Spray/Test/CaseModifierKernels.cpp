@@ -0,0 +1,190 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <cmath>
+#include "Core/Log/Log.h"
+#include "Core/Math/Plane.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "Spray/PointStore.h"
+#include "Spray/Modifiers/DragModifier.h"
+#include "Spray/Modifiers/GravityModifier.h"
+#include "Spray/Modifiers/IntegrateModifier.h"
+#include "Spray/Modifiers/PlaneCollisionModifier.h"
+#include "Spray/Modifiers/SizeModifier.h"
+#include "Spray/Modifiers/VortexModifier.h"
+#include "Spray/Test/CaseModifierKernels.h"
+
+namespace traktor::spray::test
+{
+	namespace
+	{
+
+const uint32_t c_referencePoints = 10000;
+const uint32_t c_benchmarkPoints = 1000000;
+const int32_t c_frameCount = 10;
+const float c_deltaTime = 1.0f / 60.0f;
+
+/*! Custom modifier without kernel, updated through array of points. */
+class ModifierKernels_Wind : public Modifier
+{
+	T_RTTI_CLASS;
+
+public:
+	virtual void update(const Scalar& deltaTime, const Transform& transform, pointVector_t& points, size_t first, size_t last) const override final
+	{
+		const Vector4 wind = Vector4(2.0f, 0.0f, 1.0f, 0.0f) * deltaTime;
+		for (size_t i = first; i < last; ++i)
+			points[i].velocity += wind * Scalar(points[i].inverseMass);
+	}
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.spray.test.ModifierKernels_Wind", ModifierKernels_Wind, Modifier)
+
+void createPoints(uint32_t count, pointVector_t& outPoints)
+{
+	Random random(count);
+	outPoints.resize(count);
+	for (auto& point : outPoints)
+	{
+		point.position = Vector4(
+			(random.nextFloat() - 0.5f) * 20.0f,
+			random.nextFloat() * 10.0f,
+			(random.nextFloat() - 0.5f) * 20.0f,
+			1.0f
+		);
+		point.velocity = Vector4(
+			(random.nextFloat() - 0.5f) * 5.0f,
+			(random.nextFloat() - 0.5f) * 5.0f,
+			(random.nextFloat() - 0.5f) * 5.0f,
+			0.0f
+		);
+		point.orientation = random.nextFloat() * 6.0f;
+		point.angularVelocity = random.nextFloat() - 0.5f;
+		point.inverseMass = 0.5f + random.nextFloat();
+		point.age = 0.0f;
+		point.maxAge = 10.0f;
+		point.size = 0.1f + random.nextFloat();
+		point.random = random.nextFloat();
+		point.alpha = 1.0f;
+	}
+}
+
+RefArray< const Modifier > createModifiers(bool custom)
+{
+	RefArray< const Modifier > modifiers;
+	modifiers.push_back(new GravityModifier(Vector4(0.0f, -9.8f, 0.0f, 0.0f), false));
+	modifiers.push_back(new VortexModifier(Vector4(0.0f, 1.0f, 0.0f, 0.0f), 2.0f, 0.5f, 5.0f, 0.1f, false));
+	if (custom)
+		modifiers.push_back(new ModifierKernels_Wind());
+	modifiers.push_back(new DragModifier(0.2f, 0.1f));
+	modifiers.push_back(new PlaneCollisionModifier(Plane(Vector4(0.0f, 1.0f, 0.0f, 0.0f), 0.0_simd), 1000.0f, 0.5f));
+	modifiers.push_back(new SizeModifier(0.3f));
+	modifiers.push_back(new IntegrateModifier(1.0f, true, true));
+	return modifiers;
+}
+
+bool equal(float a, float b)
+{
+	return std::abs(a - b) <= 1e-3f * std::max(1.0f, std::abs(a));
+}
+
+bool equal(const Point& a, const Point& b)
+{
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		if (!equal(a.position[i], b.position[i]) || !equal(a.velocity[i], b.velocity[i]))
+			return false;
+	}
+	for (int32_t i = 0; i < 4; ++i)
+	{
+		if (!equal(a.oaia[i], b.oaia[i]) || !equal(a.msra[i], b.msra[i]))
+			return false;
+	}
+	return true;
+}
+
+/*! Update same points using modifiers on array of points and kernels on point store. */
+void update(const RefArray< const Modifier >& modifiers, pointVector_t& inoutPoints, PointStore& inoutStore, double& outArrayTime, double& outStoreTime)
+{
+	const Scalar deltaTime(c_deltaTime);
+	const Transform transform = Transform::identity();
+
+	Timer timer;
+	for (int32_t i = 0; i < c_frameCount; ++i)
+	{
+		for (auto modifier : modifiers)
+			modifier->update(deltaTime, transform, inoutPoints, 0, inoutPoints.size());
+	}
+	outArrayTime = timer.getElapsedTime() / c_frameCount;
+
+	timer.reset();
+	for (int32_t i = 0; i < c_frameCount; ++i)
+		inoutStore.modify(modifiers, deltaTime, transform);
+	outStoreTime = timer.getElapsedTime() / c_frameCount;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.spray.test.CaseModifierKernels", 0, CaseModifierKernels, traktor::test::Case)
+
+void CaseModifierKernels::run()
+{
+	pointVector_t points;
+	PointStore store;
+	double arrayTime, storeTime;
+
+	// Store must keep points intact.
+	createPoints(c_referencePoints, points);
+	store.append(points.c_ptr(), points.size());
+	CASE_ASSERT_EQUAL(store.size(), size_t(c_referencePoints));
+	CASE_ASSERT_EQUAL(store.capacity() % 4, size_t(0));
+
+	bool allEqual = true;
+	for (uint32_t i = 0; i < c_referencePoints; ++i)
+	{
+		Point point;
+		store.get(i, point);
+		allEqual &= equal(point, points[i]);
+	}
+	CASE_ASSERT(allEqual);
+
+	// Kernels, and custom modifier between kernels, must give same result as modifiers on array.
+	for (int32_t custom = 0; custom < 2; ++custom)
+	{
+		createPoints(c_referencePoints, points);
+		store.clear();
+		store.append(points.c_ptr(), points.size());
+
+		update(createModifiers(custom != 0), points, store, arrayTime, storeTime);
+
+		allEqual = true;
+		for (uint32_t i = 0; i < c_referencePoints; ++i)
+		{
+			Point point;
+			store.get(i, point);
+			allEqual &= equal(point, points[i]);
+		}
+		CASE_ASSERT(allEqual);
+	}
+
+	// Measure both paths.
+	for (int32_t custom = 0; custom < 2; ++custom)
+	{
+		createPoints(c_benchmarkPoints, points);
+		store.clear();
+		store.append(points.c_ptr(), points.size());
+
+		const RefArray< const Modifier > modifiers = createModifiers(custom != 0);
+		update(modifiers, points, store, arrayTime, storeTime);
+
+		log::info << c_benchmarkPoints << L" points, " << int32_t(modifiers.size()) << L" modifiers" << (custom ? L" (one without kernel)" : L"") << L"; " << int32_t(arrayTime * 1000000.0) << L" us array, " << int32_t(storeTime * 1000000.0) << L" us store." << Endl;
+	}
+}
+
+}
@@ -0,0 +1,188 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <limits>
+#include "Core/Log/Log.h"
+#include "Core/Math/Const.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "Spray/PointSort.h"
+#include "Spray/PointStore.h"
+#include "Spray/Test/CasePointSort.h"
+
+namespace traktor::spray::test
+{
+	namespace
+	{
+
+const uint32_t c_referencePoints = 20000;
+
+void createPoints(uint32_t count, PointStore& outStore)
+{
+	Random random(count);
+	outStore.clear();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Point point = {};
+		point.position = Vector4(
+			(random.nextFloat() - 0.5f) * 40.0f,
+			random.nextFloat() * 20.0f,
+			(random.nextFloat() - 0.5f) * 40.0f,
+			1.0f
+		);
+		point.velocity = Vector4::zero();
+		point.maxAge = 1.0f;
+		point.size = 1.0f;
+		outStore.append(&point, 1);
+	}
+}
+
+Plane viewPlane(float angle, float distance = 60.0f)
+{
+	const Vector4 direction = Quaternion::fromEulerAngles(angle, 0.0f, 0.0f) * Vector4(0.0f, 0.0f, 1.0f, 0.0f);
+	return Plane(direction, -direction * Scalar(distance));
+}
+
+/*! Order must contain each sorted point once, back to front within quantization. */
+bool validOrder(const PointStore& store, const Plane& plane, uint32_t skip, const AlignedVector< uint32_t >& order)
+{
+	if (order.size() != (store.size() + skip - 1) / skip)
+		return false;
+
+	AlignedVector< uint32_t > sorted = order;
+	std::sort(sorted.begin(), sorted.end());
+	for (uint32_t i = 0; i < sorted.size(); ++i)
+	{
+		if (sorted[i] != i * skip)
+			return false;
+	}
+
+	float mn = std::numeric_limits< float >::max();
+	float mx = -std::numeric_limits< float >::max();
+	for (auto index : order)
+	{
+		Point point;
+		store.get(index, point);
+		const float distance = plane.distance(point.position);
+		mn = std::min(mn, distance);
+		mx = std::max(mx, distance);
+	}
+
+	const float tolerance = (mx - mn) / 65535.0f * 1.01f;
+	for (uint32_t i = 1; i < order.size(); ++i)
+	{
+		Point lh, rh;
+		store.get(order[i - 1], lh);
+		store.get(order[i], rh);
+		if (plane.distance(lh.position) < plane.distance(rh.position) - tolerance)
+			return false;
+	}
+
+	return true;
+}
+
+/*! Previous sort, array of points sorted by evaluating plane in each comparison. */
+void referenceSort(pointVector_t& points, const Plane& plane)
+{
+	std::sort(points.begin(), points.end(), [&](const Point& lh, const Point& rh) {
+		return (bool)(plane.distance(lh.position) > plane.distance(rh.position));
+	});
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.spray.test.CasePointSort", 0, CasePointSort, traktor::test::Case)
+
+void CasePointSort::run()
+{
+	PointStore store;
+	PointSort pointSort;
+
+	// Radix sort, each lod skip.
+	createPoints(c_referencePoints, store);
+	for (uint32_t skip = 1; skip <= 2; ++skip)
+	{
+		const Plane plane = viewPlane(0.3f);
+		const AlignedVector< uint32_t >& order = pointSort.sort(store, plane, skip, false);
+		CASE_ASSERT(!pointSort.wasIncremental());
+		CASE_ASSERT(validOrder(store, plane, skip, order));
+	}
+
+	// Reuse order when view move and rotate slightly; same order as radix sort.
+	{
+		float angle = 0.3f;
+		AlignedVector< uint32_t > order = pointSort.sort(store, viewPlane(angle), 1, false);
+		store.permute(order.c_ptr());
+
+		bool allIncremental = true, allEqual = true, allValid = true;
+		for (int32_t i = 0; i < 10; ++i)
+		{
+			angle += deg2rad(0.05f);
+			const Plane plane = viewPlane(angle, 60.0f - i);
+
+			const AlignedVector< uint32_t > radixOrder = pointSort.sort(store, plane, 1, false);
+			order = pointSort.sort(store, plane, 1, true);
+			allIncremental &= pointSort.wasIncremental();
+			allValid &= validOrder(store, plane, 1, order);
+			for (uint32_t j = 0; allEqual && j < order.size(); ++j)
+				allEqual &= (order[j] == radixOrder[j]);
+
+			store.permute(order.c_ptr());
+		}
+		CASE_ASSERT(allIncremental);
+		CASE_ASSERT(allEqual);
+		CASE_ASSERT(allValid);
+
+		// Large change of view must fall back to radix sort.
+		const Plane plane = viewPlane(angle + HALF_PI);
+		order = pointSort.sort(store, plane, 1, true);
+		CASE_ASSERT(!pointSort.wasIncremental());
+		CASE_ASSERT(validOrder(store, plane, 1, order));
+	}
+
+	// Measure previous sort, radix sort and reused order.
+	for (uint32_t count = 10000; count <= 1000000; count *= 10)
+	{
+		createPoints(count, store);
+
+		pointVector_t points(count);
+		store.gather(0, count, points.ptr());
+
+		const Plane plane = viewPlane(0.3f);
+		const Plane movedPlane = viewPlane(0.3f, 55.0f);
+		const Plane rotatedPlane = viewPlane(0.3f + deg2rad(0.05f));
+
+		Timer timer;
+		referenceSort(points, plane);
+		const double referenceTime = timer.getElapsedTime();
+
+		// First sort allocate buffers, measure second as buffers are kept between frames.
+		pointSort.sort(store, plane, 1, false);
+
+		timer.reset();
+		const AlignedVector< uint32_t >& order = pointSort.sort(store, plane, 1, false);
+		const double radixTime = timer.getElapsedTime();
+
+		store.permute(order.c_ptr());
+
+		timer.reset();
+		pointSort.sort(store, movedPlane, 1, true);
+		const double movedTime = timer.getElapsedTime();
+		CASE_ASSERT(pointSort.wasIncremental());
+
+		timer.reset();
+		pointSort.sort(store, rotatedPlane, 1, true);
+		const double rotatedTime = timer.getElapsedTime();
+
+		log::info << count << L" points; " << int32_t(referenceTime * 1000000.0) << L" us std::sort, " << int32_t(radixTime * 1000000.0) << L" us radix, " << int32_t(movedTime * 1000000.0) << L" us reused order after move, " << int32_t(rotatedTime * 1000000.0) << L" us " << (pointSort.wasIncremental() ? L"reused order" : L"radix fallback") << L" after 0.05 degree rotation." << Endl;
+	}
+}
+
+}
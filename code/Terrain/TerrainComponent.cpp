@@ -60,17 +60,6 @@ const render::Handle c_handleTerrain_CulledDrawBuffer(L"Terrain_CulledDrawBuffer
 const int32_t c_patchLodSteps = 3;
 const int32_t c_surfaceLodSteps = 3;
 
-struct CullPatch
-{
-	float error[4];
-	float distance;
-	float area;
-	uint32_t patchId;
-	Vector4 patchOrigin;
-};
-
-typedef std::pair< float, const TerrainComponent::Patch* > cull_patch_t;
-
 struct DrawData
 {
 	float patchOrigin[4];
@@ -147,15 +136,13 @@ void TerrainComponent::setup(
 	const Vector4& worldExtent = m_heightfield->getWorldExtent();
 
 	const Matrix44 viewInv = worldRenderView.getView().inverse();
-	const Matrix44 viewProj = worldRenderView.getProjection() * worldRenderView.getView();
 	const Vector4 eyePosition = worldRenderView.getEyePosition();
 	const Vector4 eyeDirection = worldRenderView.getEyeDirection();
 
+	// Stream in heightfield tiles around eye if heightfield is paged.
+	m_heightfield->prefetch(eyePosition, detailDistance);
+
 	const Vector4 patchExtent(worldExtent.x() / float(m_patchCount), worldExtent.y(), worldExtent.z() / float(m_patchCount), 0.0f);
-	const Vector4 patchDeltaHalf = patchExtent * Vector4(0.5f, 0.5f, 0.5f, 0.0f);
-	const Vector4 patchDeltaX = patchExtent * Vector4(1.0f, 0.0f, 0.0f, 0.0f);
-	const Vector4 patchDeltaZ = patchExtent * Vector4(0.0f, 0.0f, 1.0f, 0.0f);
-	Vector4 patchTopLeft = (-worldExtent * Scalar(0.5f)).xyz1();
 
 	// Calculate world frustum.
 	const Frustum viewCullFrustum = worldRenderView.getCullFrustum();
@@ -163,137 +150,33 @@ void TerrainComponent::setup(
 	for (uint32_t i = 0; i < worldCullFrustum.planes.size(); ++i)
 		worldCullFrustum.planes[i] = viewInv * worldCullFrustum.planes[i];
 
-	// Cull patches to world frustum.
-	AlignedVector< CullPatch >& visiblePatches = m_view[viewIndex].visiblePatches;
-	visiblePatches.resize(0);
-	for (uint32_t pz = 0; pz < m_patchCount; ++pz)
-	{
-		Vector4 patchOrigin = patchTopLeft;
-		for (uint32_t px = 0; px < m_patchCount; ++px)
-		{
-			const uint32_t patchId = px + pz * m_patchCount;
-
-			const Patch& patch = m_patches[patchId];
-			const Vector4 patchCenterWorld = (patchOrigin + patchDeltaHalf) * Vector4(1.0f, 0.0f, 1.0f, 0.0f) + Vector4(0.0f, (patch.minHeight + patch.maxHeight) * 0.5f, 0.0f, 1.0f);
-
-			const Aabb3 patchAabb(
-				patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f) + Vector4(-patchDeltaHalf.x(), patch.minHeight, -patchDeltaHalf.z(), 0.0f),
-				patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f) + Vector4( patchDeltaHalf.x(), patch.maxHeight,  patchDeltaHalf.z(), 0.0f)
-			);
-
-			if (worldCullFrustum.inside(patchAabb) != Frustum::Result::Outside)
-			{
-				const Scalar lodDistance = (patchCenterWorld - eyePosition).xyz0().length();
-				const Vector4 patchCenterWorld_x0zw = patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f);
-				const Vector4 eyePosition_0y00 = Vector4(0.0f, eyePosition.y(), 0.0f, 0.0f);
-
-				CullPatch cp;
-
-				// Calculate screen error for each lod.
-				for (int i = 0; i < LodCount; ++i)
-				{
-					const Vector4 Pworld[2] =
-					{
-						patchCenterWorld_x0zw + eyePosition_0y00,
-						patchCenterWorld_x0zw + eyePosition_0y00 + Vector4(0.0f, patch.error[i], 0.0f, 0.0f)
-					};
-
-					Vector4 Pview[2] =
-					{
-						worldRenderView.getView() * Pworld[0],
-						worldRenderView.getView() * Pworld[1]
-					};
-
-					if (Pview[0].z() < viewCullFrustum.getNearZ())
-						Pview[0].set(2, viewCullFrustum.getNearZ());
-					if (Pview[1].z() < viewCullFrustum.getNearZ())
-						Pview[1].set(2, viewCullFrustum.getNearZ());
-
-					Vector4 Pclip[] =
-					{
-						worldRenderView.getProjection() * Pview[0].xyz1(),
-						worldRenderView.getProjection() * Pview[1].xyz1()
-					};
-
-					T_ASSERT(Pclip[0].w() > 0.0f);
-					T_ASSERT(Pclip[1].w() > 0.0f);
-
-					Pclip[0] /= Pclip[0].w();
-					Pclip[1] /= Pclip[1].w();
-
-					const Vector4 d = Pclip[1] - Pclip[0];
-
-					const float dx = d.x();
-					const float dy = d.y();
+	// Select visible patches from quadtree, already sorted front to back
+	// to maximize best use of surface cache and rendering.
+	View& view = m_view[viewIndex];
+	AlignedVector< CullPatch >& visiblePatches = view.visiblePatches;
+	m_patchTree.select(worldCullFrustum, worldRenderView.getView(), worldRenderView.getProjection(), viewCullFrustum.getNearZ(), visiblePatches);
 
-					cp.error[i] = std::sqrt(dx * dx + dy * dy) * 100.0f;
-				}
-
-				// Project patch bounding box extents onto view plane and calculate screen area.
-				Vector4 extents[8];
-				patchAabb.getExtents(extents);
-
-				Vector4 mn(
-					std::numeric_limits< float >::max(),
-					std::numeric_limits< float >::max(),
-					std::numeric_limits< float >::max(),
-					std::numeric_limits< float >::max()
-				);
-				Vector4 mx(
-					-std::numeric_limits< float >::max(),
-					-std::numeric_limits< float >::max(),
-					-std::numeric_limits< float >::max(),
-					-std::numeric_limits< float >::max()
-				);
-
-				bool clipped = false;
-				for (int32_t i = 0; i < sizeof_array(extents); ++i)
-				{
-					Vector4 p = viewProj * extents[i];
-					if (p.w() <= 0.0f)
-					{
-						clipped = true;
-						break;
-					}
-
-					// Homogeneous divide.
-					p /= p.w();
-
-					// Track screen space extents.
-					mn = min(mn, p);
-					mx = max(mx, p);
-				}
-
-				const Vector4 e = mx - mn;
-
-				cp.distance = lodDistance;
-				cp.area = !clipped ? e.x() * e.y() : 1000.0_simd;
-				cp.patchId = patchId;
-				cp.patchOrigin = patchOrigin;
-				cp.patchAabb = patchAabb;
-
-				visiblePatches.push_back(cp);
-			}
-			else
-			{
-				ViewPatch& viewPatch = m_view[viewIndex].viewPatches[patchId];
+	// Reset patches which are no longer visible.
+	++view.frame;
+	for (const auto& visiblePatch : visiblePatches)
+		view.viewPatches[visiblePatch.patchId].visibleFrame = view.frame;
 
-				viewPatch.lastPatchLod = c_patchLodSteps;
-				viewPatch.lastSurfaceLod = c_surfaceLodSteps;
+	for (auto patchId : view.lastVisiblePatchIds)
+	{
+		ViewPatch& viewPatch = view.viewPatches[patchId];
+		if (viewPatch.visibleFrame == view.frame)
+			continue;
 
-				if (!snapshot)
-					m_view[viewIndex].surfaceCache->flush(patchId);
-			}
+		viewPatch.lastPatchLod = c_patchLodSteps;
+		viewPatch.lastSurfaceLod = c_surfaceLodSteps;
 
-			patchOrigin += patchDeltaX;
-		}
-		patchTopLeft += patchDeltaZ;
+		if (!snapshot)
+			view.surfaceCache->flush(patchId);
 	}
 
-	// Sort patches front to back to maximize best use of surface cache and rendering.
-	std::sort(visiblePatches.begin(), visiblePatches.end(), [](const CullPatch& lh, const CullPatch& rh) {
-		return lh.distance < rh.distance;
-	});
+	view.lastVisiblePatchIds.resize(0);
+	for (const auto& visiblePatch : visiblePatches)
+		view.lastVisiblePatchIds.push_back(visiblePatch.patchId);
 
 	for (uint32_t i = 0; i < LodCount; ++i)
 		m_view[viewIndex].patchLodInstances[i].resize(0);
@@ -319,16 +202,8 @@ void TerrainComponent::setup(
 				surfaceLod = viewPatch.lastSurfaceLod;
 		}
 
-		// Find patch lod based on screen space error.
-		int32_t patchLod = 0;
-		for (int32_t j = 3; j > 0; --j)
-		{
-			if (visiblePatch.error[j] <= 1.0f)
-			{
-				patchLod = j;
-				break;
-			}
-		}
+		// Patch lod based on screen space error.
+		const int32_t patchLod = visiblePatch.patchLod;
 
 		viewPatch.lastPatchLod = patchLod;
 		viewPatch.lastSurfaceLod = surfaceLod;
@@ -672,6 +547,9 @@ void TerrainComponent::updatePatches(const uint32_t* region, bool updateErrors,
 			}
 		}
 	}
+
+	if (updateErrors)
+		m_patchTree.update(m_patches, region);
 }
 
 void TerrainComponent::updateRayTracingPatches()
@@ -728,6 +606,10 @@ bool TerrainComponent::createPatches()
 
 	m_vertexLayout = m_renderSystem->createVertexLayout(vertexElements);
 
+	m_patchTree.create(m_patchCount, m_heightfield->getWorldExtent());
+	for (int32_t i = 0; i < sizeof_array(m_view); ++i)
+		m_view[i].lastVisiblePatchIds.resize(0);
+
 	m_patches.reserve(m_patchCount * m_patchCount);
 	for (uint32_t pz = 0; pz < m_patchCount; ++pz)
 	{
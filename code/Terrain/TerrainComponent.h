@@ -12,6 +12,7 @@
 #include "Core/Containers/AlignedVector.h"
 #include "Render/Shader.h"
 #include "Resource/Proxy.h"
+#include "Terrain/TerrainPatchTree.h"
 #include "Terrain/TerrainComponentData.h"
 #include "World/IEntityComponent.h"
 #include "World/Entity/RTWorldComponent.h"
@@ -72,7 +73,7 @@ class T_DLLCLASS TerrainComponent : public world::IEntityComponent
 	T_RTTI_CLASS;
 
 public:
-	static constexpr int32_t LodCount = 4;
+	static constexpr int32_t LodCount = TerrainPatchTree::LodCount;
 
 	enum VisualizeMode
 	{
@@ -86,12 +87,7 @@ public:
 		VmCutMap = 7
 	};
 
-	struct Patch
-	{
-		float minHeight;
-		float maxHeight;
-		float error[LodCount];
-	};
+	typedef TerrainPatchTree::Patch Patch;
 
 	explicit TerrainComponent(resource::IResourceManager* resourceManager, render::IRenderSystem* renderSystem);
 
@@ -138,21 +134,14 @@ private:
 	friend class TerrainEditModifier;
 	friend class TerrainComponentEditor;
 
-	struct CullPatch
-	{
-		float error[4];
-		float distance;
-		float area;
-		uint32_t patchId;
-		Vector4 patchOrigin;
-		Aabb3 patchAabb;
-	};
+	typedef TerrainPatchTree::VisiblePatch CullPatch;
 
 	struct ViewPatch
 	{
 		int32_t lastPatchLod = 0;
 		int32_t lastSurfaceLod = 0;
 		Vector4 surfaceOffset = Vector4::zero();
+		uint32_t visibleFrame = 0;
 	};
 
 	struct View
@@ -161,6 +150,8 @@ private:
 		AlignedVector< ViewPatch > viewPatches;
 		AlignedVector< CullPatch > visiblePatches;
 		AlignedVector< const CullPatch* > patchLodInstances[LodCount];
+		AlignedVector< uint32_t > lastVisiblePatchIds;
+		uint32_t frame = 0;
 	};
 
 	world::World* m_world = nullptr;
@@ -171,6 +162,7 @@ private:
 	resource::Proxy< hf::Heightfield > m_heightfield;
 	resource::Proxy< render::Shader > m_shaderCull;
 	AlignedVector< Patch > m_patches;
+	TerrainPatchTree m_patchTree;
 	uint32_t m_patchCount = 0;
 	uint32_t m_cacheSize = 0;
 	Ref< const render::IVertexLayout > m_vertexLayout;
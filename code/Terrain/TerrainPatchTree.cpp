@@ -0,0 +1,330 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Terrain/TerrainPatchTree.h"
+
+namespace traktor::terrain
+{
+	namespace
+	{
+
+struct Pending
+{
+	float key;			//!< Distance to node, or to patch center for patches.
+	int32_t level;
+	uint32_t x;
+	uint32_t z;
+	int32_t minLod;		//!< All patches below have at least this lod.
+	bool inside;		//!< Node entirely inside frustum.
+};
+
+struct PendingGreater
+{
+	bool operator () (const Pending& lh, const Pending& rh) const
+	{
+		return lh.key > rh.key;
+	}
+};
+
+/*! Projected error of a vertical segment at patch center, at eye height, as seen from eye. */
+float projectedError(const Matrix44& view, const Matrix44& projection, float nearZ, const Vector4& patchCenterWorld_x0zw, const Vector4& eyePosition_0y00, float error)
+{
+	const Vector4 Pworld[2] =
+	{
+		patchCenterWorld_x0zw + eyePosition_0y00,
+		patchCenterWorld_x0zw + eyePosition_0y00 + Vector4(0.0f, error, 0.0f, 0.0f)
+	};
+
+	Vector4 Pview[2] =
+	{
+		view * Pworld[0],
+		view * Pworld[1]
+	};
+
+	if (Pview[0].z() < nearZ)
+		Pview[0].set(2, Scalar(nearZ));
+	if (Pview[1].z() < nearZ)
+		Pview[1].set(2, Scalar(nearZ));
+
+	Vector4 Pclip[] =
+	{
+		projection * Pview[0].xyz1(),
+		projection * Pview[1].xyz1()
+	};
+
+	Pclip[0] /= Pclip[0].w();
+	Pclip[1] /= Pclip[1].w();
+
+	const Vector4 d = Pclip[1] - Pclip[0];
+
+	const float dx = d.x();
+	const float dy = d.y();
+
+	return std::sqrt(dx * dx + dy * dy) * 100.0f;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.terrain.TerrainPatchTree", TerrainPatchTree, Object)
+
+void TerrainPatchTree::create(uint32_t patchCount, const Vector4& worldExtent)
+{
+	m_patchCount = patchCount;
+	m_worldExtent = worldExtent;
+	m_patchExtent = Vector4(worldExtent.x() / float(patchCount), worldExtent.y(), worldExtent.z() / float(patchCount), 0.0f);
+
+	m_levels.resize(0);
+	if (patchCount == 0)
+		return;
+
+	uint32_t size = patchCount;
+	for (;;)
+	{
+		Level& level = m_levels.push_back();
+		level.size = size;
+		level.nodes.resize(size * size, { 0.0f, 0.0f, { 0.0f, 0.0f, 0.0f, 0.0f } });
+		if (size <= 1)
+			break;
+		size = (size + 1) / 2;
+	}
+}
+
+void TerrainPatchTree::update(const AlignedVector< Patch >& patches, const uint32_t* region)
+{
+	if (m_levels.empty())
+		return;
+
+	T_ASSERT(patches.size() == m_patchCount * m_patchCount);
+
+	uint32_t mnx = region ? region[0] : 0;
+	uint32_t mnz = region ? region[1] : 0;
+	uint32_t mxx = region ? std::min(region[2], m_patchCount - 1) : m_patchCount - 1;
+	uint32_t mxz = region ? std::min(region[3], m_patchCount - 1) : m_patchCount - 1;
+
+	// Leaves are copies of patches.
+	for (uint32_t z = mnz; z <= mxz; ++z)
+	{
+		for (uint32_t x = mnx; x <= mxx; ++x)
+		{
+			const Patch& patch = patches[x + z * m_patchCount];
+			Node& node = m_levels[0].nodes[x + z * m_patchCount];
+			node.minHeight = patch.minHeight;
+			node.maxHeight = patch.maxHeight;
+			for (int32_t i = 0; i < LodCount; ++i)
+				node.maxError[i] = patch.error[i];
+		}
+	}
+
+	// Merge children into parents, only nodes covering region.
+	for (size_t i = 1; i < m_levels.size(); ++i)
+	{
+		const Level& child = m_levels[i - 1];
+		Level& level = m_levels[i];
+
+		mnx /= 2;
+		mnz /= 2;
+		mxx /= 2;
+		mxz /= 2;
+
+		for (uint32_t z = mnz; z <= mxz; ++z)
+		{
+			for (uint32_t x = mnx; x <= mxx; ++x)
+			{
+				Node node = child.nodes[x * 2 + z * 2 * child.size];
+				for (uint32_t j = 1; j < 4; ++j)
+				{
+					const uint32_t cx = x * 2 + (j & 1);
+					const uint32_t cz = z * 2 + (j >> 1);
+					if (cx >= child.size || cz >= child.size)
+						continue;
+
+					const Node& cn = child.nodes[cx + cz * child.size];
+					node.minHeight = std::min(node.minHeight, cn.minHeight);
+					node.maxHeight = std::max(node.maxHeight, cn.maxHeight);
+					for (int32_t k = 0; k < LodCount; ++k)
+						node.maxError[k] = std::max(node.maxError[k], cn.maxError[k]);
+				}
+				level.nodes[x + z * level.size] = node;
+			}
+		}
+	}
+}
+
+uint32_t TerrainPatchTree::select(const Frustum& worldCullFrustum, const Matrix44& view, const Matrix44& projection, float nearZ, AlignedVector< VisiblePatch >& outVisiblePatches) const
+{
+	outVisiblePatches.resize(0);
+	if (m_levels.empty())
+		return 0;
+
+	const Vector4 eyePosition = view.inverse().translation().xyz1();
+	const Vector4 eyePosition_0y00 = Vector4(0.0f, eyePosition.y(), 0.0f, 0.0f);
+	const Vector4 patchTopLeft = (-m_worldExtent * Scalar(0.5f)).xyz1();
+	const Vector4 patchDeltaHalf = m_patchExtent * Vector4(0.5f, 0.5f, 0.5f, 0.0f);
+
+	// Clamping subtrees is only possible with a perspective projection,
+	// projected error is bound using view depth of entire node.
+	const bool perspective = (projection.get(3, 3) == 0.0f && projection.get(3, 2) > 0.0f);
+	const float sx = projection.get(0, 0) / projection.get(3, 2);
+	const float sy = projection.get(1, 1) / projection.get(3, 2);
+	const Vector4 up = view * Vector4(0.0f, 1.0f, 0.0f, 0.0f);
+	const float ux = std::abs(up.x());
+	const float uy = std::abs(up.y());
+	const float uz = std::abs(up.z());
+
+	AlignedVector< Pending > pending;
+	uint32_t visited = 0;
+
+	// Push node if inside frustum; nodes are ordered by distance to
+	// closest point in node and patches by distance to their center,
+	// which is never closer than the node containing the patch.
+	auto push = [&](int32_t level, uint32_t x, uint32_t z, int32_t minLod, bool inside) {
+		const Aabb3 box = getNodeBoundingBox(level, x, z);
+		if (!inside)
+		{
+			const Frustum::Result result = worldCullFrustum.inside(box);
+			if (result == Frustum::Result::Outside)
+				return;
+			inside = (result == Frustum::Result::Inside);
+		}
+
+		float key;
+		if (level > 0)
+		{
+			const Vector4 closest = max(min(eyePosition, box.mx), box.mn);
+			key = (closest - eyePosition).xyz0().length();
+		}
+		else
+			key = (box.getCenter() - eyePosition).xyz0().length();
+
+		pending.push_back({ key, level > 0 ? level : -1, x, z, minLod, inside });
+		std::push_heap(pending.ptr(), pending.ptr() + pending.size(), PendingGreater());
+	};
+
+	push((int32_t)m_levels.size() - 1, 0, 0, 0, false);
+
+	while (!pending.empty())
+	{
+		std::pop_heap(pending.ptr(), pending.ptr() + pending.size(), PendingGreater());
+		const Pending node = pending.back();
+		pending.pop_back();
+
+		++visited;
+
+		// Patches are popped in order of distance to center.
+		if (node.level < 0)
+		{
+			const uint32_t patchId = node.x + node.z * m_patchCount;
+			const Node& patch = m_levels[0].nodes[patchId];
+			const Vector4 patchOrigin = patchTopLeft + m_patchExtent * Vector4(float(node.x), 0.0f, float(node.z), 0.0f);
+			const Vector4 patchCenterWorld = (patchOrigin + patchDeltaHalf) * Vector4(1.0f, 0.0f, 1.0f, 0.0f) + Vector4(0.0f, (patch.minHeight + patch.maxHeight) * 0.5f, 0.0f, 1.0f);
+			const Vector4 patchCenterWorld_x0zw = patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f);
+
+			// Find coarsest lod with small enough screen space error.
+			int32_t patchLod = node.minLod;
+			for (int32_t j = LodCount - 1; j > node.minLod; --j)
+			{
+				if (projectedError(view, projection, nearZ, patchCenterWorld_x0zw, eyePosition_0y00, patch.maxError[j]) <= 1.0f)
+				{
+					patchLod = j;
+					break;
+				}
+			}
+
+			auto& vp = outVisiblePatches.push_back();
+			vp.patchId = patchId;
+			vp.patchLod = patchLod;
+			vp.distance = node.key;
+			vp.patchOrigin = patchOrigin;
+			vp.patchAabb = getNodeBoundingBox(0, node.x, node.z);
+			continue;
+		}
+
+		const Level& level = m_levels[node.level];
+		const Node& n = level.nodes[node.x + node.z * level.size];
+		int32_t minLod = node.minLod;
+
+		// Bound projected error of all patches in node; the segment
+		// measured for each patch start at eye height so view depth
+		// of node is spanned by the corners at eye height.
+		if (perspective && minLod < LodCount - 1)
+		{
+			const Aabb3 box = getNodeBoundingBox(node.level, node.x, node.z);
+			const Vector4 corners[] =
+			{
+				view * Vector4(box.mn.x(), eyePosition.y(), box.mn.z(), 1.0f),
+				view * Vector4(box.mx.x(), eyePosition.y(), box.mn.z(), 1.0f),
+				view * Vector4(box.mn.x(), eyePosition.y(), box.mx.z(), 1.0f),
+				view * Vector4(box.mx.x(), eyePosition.y(), box.mx.z(), 1.0f)
+			};
+
+			float zmn = std::numeric_limits< float >::max();
+			float zmx = -std::numeric_limits< float >::max();
+			float xmx = 0.0f, ymx = 0.0f;
+			for (const auto& corner : corners)
+			{
+				zmn = std::min< float >(zmn, corner.z());
+				zmx = std::max< float >(zmx, corner.z());
+				xmx = std::max< float >(xmx, std::abs(corner.x()));
+				ymx = std::max< float >(ymx, std::abs(corner.y()));
+			}
+
+			for (int32_t j = LodCount - 1; j > minLod; --j)
+			{
+				const float e = n.maxError[j];
+				const float z1mn = zmn - e * uz;
+				if (zmn < nearZ || z1mn < nearZ)
+					break;
+
+				const float dx = sx * e * (ux * zmx + uz * xmx) / (zmn * z1mn);
+				const float dy = sy * e * (uy * zmx + uz * ymx) / (zmn * z1mn);
+				if (std::sqrt(dx * dx + dy * dy) * 100.0f <= 1.0f)
+				{
+					minLod = j;
+					break;
+				}
+			}
+		}
+
+		// Push children which are inside frustum.
+		const int32_t childLevel = node.level - 1;
+		const uint32_t childSize = m_levels[childLevel].size;
+
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			const uint32_t cx = node.x * 2 + (i & 1);
+			const uint32_t cz = node.z * 2 + (i >> 1);
+			if (cx < childSize && cz < childSize)
+				push(childLevel, cx, cz, minLod, node.inside);
+		}
+	}
+
+	return visited;
+}
+
+Aabb3 TerrainPatchTree::getNodeBoundingBox(int32_t level, uint32_t x, uint32_t z) const
+{
+	const uint32_t span = 1 << level;
+	const uint32_t px0 = x * span;
+	const uint32_t pz0 = z * span;
+	const uint32_t px1 = std::min(px0 + span, m_patchCount);
+	const uint32_t pz1 = std::min(pz0 + span, m_patchCount);
+
+	const Level& l = m_levels[level];
+	const Node& node = l.nodes[x + z * l.size];
+
+	const Vector4 patchTopLeft = (-m_worldExtent * Scalar(0.5f)).xyz1();
+	return Aabb3(
+		patchTopLeft * Vector4(1.0f, 0.0f, 1.0f, 1.0f) + m_patchExtent * Vector4(float(px0), 0.0f, float(pz0), 0.0f) + Vector4(0.0f, node.minHeight, 0.0f, 0.0f),
+		patchTopLeft * Vector4(1.0f, 0.0f, 1.0f, 1.0f) + m_patchExtent * Vector4(float(px1), 0.0f, float(pz1), 0.0f) + Vector4(0.0f, node.maxHeight, 0.0f, 0.0f)
+	);
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/Object.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Math/Aabb3.h"
+#include "Core/Math/Frustum.h"
+#include "Core/Math/Matrix44.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_TERRAIN_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::terrain
+{
+
+/*! Quadtree over terrain patches.
+ * \ingroup Terrain
+ *
+ * Each node keep height range and largest error of
+ * each lod of all patches below, so subtrees outside
+ * of frustum are rejected and subtrees far enough away
+ * are clamped to a coarse lod without visiting each
+ * patch.
+ */
+class T_DLLCLASS TerrainPatchTree : public Object
+{
+	T_RTTI_CLASS;
+
+public:
+	static constexpr int32_t LodCount = 4;
+
+	struct Patch
+	{
+		float minHeight;
+		float maxHeight;
+		float error[LodCount];
+	};
+
+	struct VisiblePatch
+	{
+		uint32_t patchId;
+		int32_t patchLod;
+		float distance;
+		Vector4 patchOrigin;
+		Aabb3 patchAabb;
+	};
+
+	/*! Create tree.
+	 *
+	 * \param patchCount Number of patches along each side of terrain.
+	 * \param worldExtent Terrain world extent.
+	 */
+	void create(uint32_t patchCount, const Vector4& worldExtent);
+
+	/*! Update nodes covering region of patches.
+	 *
+	 * \param patches All patches.
+	 * \param region Patch region (min x, min z, max x, max z) inclusive, null for all patches.
+	 */
+	void update(const AlignedVector< Patch >& patches, const uint32_t* region);
+
+	/*! Select visible patches and their lod.
+	 *
+	 * Lod of each patch is the coarsest lod with a
+	 * projected error of at most one.
+	 *
+	 * \param worldCullFrustum Cull frustum in world space.
+	 * \param view View transform.
+	 * \param projection Projection transform.
+	 * \param nearZ View near Z.
+	 * \param outVisiblePatches Visible patches, sorted front to back.
+	 * \return Number of nodes visited.
+	 */
+	uint32_t select(const Frustum& worldCullFrustum, const Matrix44& view, const Matrix44& projection, float nearZ, AlignedVector< VisiblePatch >& outVisiblePatches) const;
+
+	uint32_t getPatchCount() const { return m_patchCount; }
+
+private:
+	struct Node
+	{
+		float minHeight;
+		float maxHeight;
+		float maxError[LodCount];
+	};
+
+	struct Level
+	{
+		uint32_t size;
+		AlignedVector< Node > nodes;
+	};
+
+	uint32_t m_patchCount = 0;
+	Vector4 m_worldExtent = Vector4::zero();
+	Vector4 m_patchExtent = Vector4::zero();
+	AlignedVector< Level > m_levels;
+
+	Aabb3 getNodeBoundingBox(int32_t level, uint32_t x, uint32_t z) const;
+};
+
+}
@@ -0,0 +1,291 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <cmath>
+#include "Core/Log/Log.h"
+#include "Core/Math/Const.h"
+#include "Core/Math/Frustum.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "Terrain/TerrainPatchTree.h"
+#include "Terrain/Test/CaseTerrainPatchTree.h"
+
+namespace traktor::terrain::test
+{
+	namespace
+	{
+
+const uint32_t c_referencePatchCount = 64;
+const int32_t c_referenceViews = 100;
+const int32_t c_benchmarkViews = 10;
+const float c_patchSize = 16.0f;
+const float c_nearZ = 0.1f;
+const float c_farZ = 4000.0f;
+
+struct Camera
+{
+	Frustum worldCullFrustum;
+	Matrix44 view;
+	Matrix44 projection;
+};
+
+void createPatches(uint32_t patchCount, AlignedVector< TerrainPatchTree::Patch >& outPatches)
+{
+	Random random(patchCount);
+	outPatches.resize(patchCount * patchCount);
+	for (uint32_t z = 0; z < patchCount; ++z)
+	{
+		for (uint32_t x = 0; x < patchCount; ++x)
+		{
+			const float fx = float(x) / patchCount;
+			const float fz = float(z) / patchCount;
+			const float height = std::sin(fx * 19.0f) * std::cos(fz * 13.0f) * 100.0f;
+
+			auto& patch = outPatches[x + z * patchCount];
+			patch.minHeight = height - random.nextFloat() * 20.0f;
+			patch.maxHeight = height + random.nextFloat() * 20.0f;
+			patch.error[0] = 0.0f;
+			for (int32_t i = 1; i < TerrainPatchTree::LodCount; ++i)
+				patch.error[i] = patch.error[i - 1] + random.nextFloat() * 2.0f * i;
+		}
+	}
+}
+
+Camera randomCamera(Random& random, float worldSize)
+{
+	const Vector4 eye(
+		(random.nextFloat() - 0.5f) * worldSize,
+		20.0f + random.nextFloat() * 400.0f,
+		(random.nextFloat() - 0.5f) * worldSize,
+		1.0f
+	);
+	const Vector4 target = eye + Vector4(
+		random.nextFloat() - 0.5f,
+		-random.nextFloat() * 0.5f,
+		random.nextFloat() - 0.5f,
+		0.0f
+	);
+
+	Camera camera;
+	camera.view = lookAt(eye, target);
+	camera.projection = perspectiveLh(deg2rad(70.0f), 16.0f / 9.0f, c_nearZ, c_farZ);
+
+	Frustum viewCullFrustum;
+	viewCullFrustum.buildPerspective(deg2rad(70.0f), 16.0f / 9.0f, c_nearZ, c_farZ);
+
+	const Matrix44 viewInv = camera.view.inverse();
+	camera.worldCullFrustum = viewCullFrustum;
+	for (uint32_t i = 0; i < camera.worldCullFrustum.planes.size(); ++i)
+		camera.worldCullFrustum.planes[i] = viewInv * camera.worldCullFrustum.planes[i];
+
+	return camera;
+}
+
+/*! Reference selection, test every patch and calculate projected error of each lod. */
+void bruteForce(uint32_t patchCount, const Vector4& worldExtent, const AlignedVector< TerrainPatchTree::Patch >& patches, const Camera& camera, AlignedVector< TerrainPatchTree::VisiblePatch >& outVisiblePatches)
+{
+	const Vector4 eyePosition = camera.view.inverse().translation().xyz1();
+	const Vector4 eyePosition_0y00 = Vector4(0.0f, eyePosition.y(), 0.0f, 0.0f);
+	const Vector4 patchExtent(worldExtent.x() / float(patchCount), worldExtent.y(), worldExtent.z() / float(patchCount), 0.0f);
+	const Vector4 patchDeltaHalf = patchExtent * Vector4(0.5f, 0.5f, 0.5f, 0.0f);
+	const Vector4 patchTopLeft = (-worldExtent * Scalar(0.5f)).xyz1();
+
+	outVisiblePatches.resize(0);
+	for (uint32_t pz = 0; pz < patchCount; ++pz)
+	{
+		for (uint32_t px = 0; px < patchCount; ++px)
+		{
+			const TerrainPatchTree::Patch& patch = patches[px + pz * patchCount];
+			const Vector4 patchOrigin = patchTopLeft + patchExtent * Vector4(float(px), 0.0f, float(pz), 0.0f);
+			const Vector4 patchCenterWorld = (patchOrigin + patchDeltaHalf) * Vector4(1.0f, 0.0f, 1.0f, 0.0f) + Vector4(0.0f, (patch.minHeight + patch.maxHeight) * 0.5f, 0.0f, 1.0f);
+
+			const Aabb3 patchAabb(
+				patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f) + Vector4(-patchDeltaHalf.x(), patch.minHeight, -patchDeltaHalf.z(), 0.0f),
+				patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f) + Vector4( patchDeltaHalf.x(), patch.maxHeight,  patchDeltaHalf.z(), 0.0f)
+			);
+
+			if (camera.worldCullFrustum.inside(patchAabb) == Frustum::Result::Outside)
+				continue;
+
+			const Vector4 patchCenterWorld_x0zw = patchCenterWorld * Vector4(1.0f, 0.0f, 1.0f, 1.0f);
+
+			float error[TerrainPatchTree::LodCount];
+			for (int32_t i = 0; i < TerrainPatchTree::LodCount; ++i)
+			{
+				Vector4 Pview[2] =
+				{
+					camera.view * (patchCenterWorld_x0zw + eyePosition_0y00),
+					camera.view * (patchCenterWorld_x0zw + eyePosition_0y00 + Vector4(0.0f, patch.error[i], 0.0f, 0.0f))
+				};
+
+				if (Pview[0].z() < c_nearZ)
+					Pview[0].set(2, Scalar(c_nearZ));
+				if (Pview[1].z() < c_nearZ)
+					Pview[1].set(2, Scalar(c_nearZ));
+
+				Vector4 Pclip[] =
+				{
+					camera.projection * Pview[0].xyz1(),
+					camera.projection * Pview[1].xyz1()
+				};
+
+				Pclip[0] /= Pclip[0].w();
+				Pclip[1] /= Pclip[1].w();
+
+				const Vector4 d = Pclip[1] - Pclip[0];
+				error[i] = std::sqrt(d.x() * d.x() + d.y() * d.y()) * 100.0f;
+			}
+
+			int32_t patchLod = 0;
+			for (int32_t j = TerrainPatchTree::LodCount - 1; j > 0; --j)
+			{
+				if (error[j] <= 1.0f)
+				{
+					patchLod = j;
+					break;
+				}
+			}
+
+			auto& vp = outVisiblePatches.push_back();
+			vp.patchId = px + pz * patchCount;
+			vp.patchLod = patchLod;
+			vp.distance = (patchCenterWorld - eyePosition).xyz0().length();
+			vp.patchOrigin = patchOrigin;
+			vp.patchAabb = patchAabb;
+		}
+	}
+
+	std::sort(outVisiblePatches.begin(), outVisiblePatches.end(), [](const TerrainPatchTree::VisiblePatch& lh, const TerrainPatchTree::VisiblePatch& rh) {
+		return lh.distance < rh.distance;
+	});
+}
+
+bool sameSelection(AlignedVector< TerrainPatchTree::VisiblePatch > a, AlignedVector< TerrainPatchTree::VisiblePatch > b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	auto byId = [](const TerrainPatchTree::VisiblePatch& lh, const TerrainPatchTree::VisiblePatch& rh) {
+		return lh.patchId < rh.patchId;
+	};
+	std::sort(a.begin(), a.end(), byId);
+	std::sort(b.begin(), b.end(), byId);
+
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (a[i].patchId != b[i].patchId || a[i].patchLod != b[i].patchLod)
+			return false;
+		if (std::abs(a[i].distance - b[i].distance) > 1e-2f)
+			return false;
+	}
+	return true;
+}
+
+bool sortedByDistance(const AlignedVector< TerrainPatchTree::VisiblePatch >& visiblePatches)
+{
+	for (size_t i = 1; i < visiblePatches.size(); ++i)
+	{
+		if (visiblePatches[i].distance < visiblePatches[i - 1].distance)
+			return false;
+	}
+	return true;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.terrain.test.CaseTerrainPatchTree", 0, CaseTerrainPatchTree, traktor::test::Case)
+
+void CaseTerrainPatchTree::run()
+{
+	AlignedVector< TerrainPatchTree::Patch > patches;
+	AlignedVector< TerrainPatchTree::VisiblePatch > referencePatches, treePatches;
+
+	// Tree must select same patches and lods as brute force.
+	{
+		const float worldSize = c_referencePatchCount * c_patchSize;
+		const Vector4 worldExtent(worldSize, 256.0f, worldSize, 0.0f);
+
+		createPatches(c_referencePatchCount, patches);
+
+		TerrainPatchTree tree;
+		tree.create(c_referencePatchCount, worldExtent);
+		tree.update(patches, nullptr);
+
+		Random random(1234);
+		bool allEqual = true, allSorted = true;
+		for (int32_t i = 0; i < c_referenceViews; ++i)
+		{
+			const Camera camera = randomCamera(random, worldSize);
+			bruteForce(c_referencePatchCount, worldExtent, patches, camera, referencePatches);
+			tree.select(camera.worldCullFrustum, camera.view, camera.projection, c_nearZ, treePatches);
+			allEqual &= sameSelection(referencePatches, treePatches);
+			allSorted &= sortedByDistance(treePatches);
+		}
+		CASE_ASSERT(allEqual);
+		CASE_ASSERT(allSorted);
+
+		// Modify a region and update only that region.
+		const uint32_t region[] = { 10, 20, 17, 33 };
+		for (uint32_t z = region[1]; z <= region[3]; ++z)
+		{
+			for (uint32_t x = region[0]; x <= region[2]; ++x)
+			{
+				auto& patch = patches[x + z * c_referencePatchCount];
+				patch.minHeight -= 50.0f;
+				patch.maxHeight += 150.0f;
+				for (int32_t j = 1; j < TerrainPatchTree::LodCount; ++j)
+					patch.error[j] *= 10.0f;
+			}
+		}
+		tree.update(patches, region);
+
+		allEqual = true;
+		for (int32_t i = 0; i < c_referenceViews; ++i)
+		{
+			const Camera camera = randomCamera(random, worldSize);
+			bruteForce(c_referencePatchCount, worldExtent, patches, camera, referencePatches);
+			tree.select(camera.worldCullFrustum, camera.view, camera.projection, c_nearZ, treePatches);
+			allEqual &= sameSelection(referencePatches, treePatches);
+		}
+		CASE_ASSERT(allEqual);
+	}
+
+	// Measure selection time compared to brute force.
+	for (uint32_t patchCount = 64; patchCount <= 1024; patchCount *= 2)
+	{
+		const float worldSize = patchCount * c_patchSize;
+		const Vector4 worldExtent(worldSize, 256.0f, worldSize, 0.0f);
+
+		createPatches(patchCount, patches);
+
+		TerrainPatchTree tree;
+		tree.create(patchCount, worldExtent);
+		tree.update(patches, nullptr);
+
+		Random random(5678);
+		AlignedVector< Camera > cameras;
+		for (int32_t i = 0; i < c_benchmarkViews; ++i)
+			cameras.push_back(randomCamera(random, worldSize));
+
+		Timer timer;
+		for (const auto& camera : cameras)
+			bruteForce(patchCount, worldExtent, patches, camera, referencePatches);
+		const double bruteForceTime = timer.getElapsedTime() / c_benchmarkViews;
+
+		uint32_t visited = 0;
+		timer.reset();
+		for (const auto& camera : cameras)
+			visited += tree.select(camera.worldCullFrustum, camera.view, camera.projection, c_nearZ, treePatches);
+		const double treeTime = timer.getElapsedTime() / c_benchmarkViews;
+
+		log::info << patchCount << L"x" << patchCount << L" patches; " << int32_t(bruteForceTime * 1000000.0) << L" us brute force, " << int32_t(treeTime * 1000000.0) << L" us tree (" << visited / c_benchmarkViews << L" nodes visited)." << Endl;
+	}
+}
+
+}
@@ -39,6 +39,11 @@ bool TheaterComponentPipeline::shouldCache() const
 	return false;
 }
 
+bool TheaterComponentPipeline::isThreadSafe() const
+{
+	return true;
+}
+
 uint32_t TheaterComponentPipeline::hashAsset(const ISerializable* sourceAsset) const
 {
 	return DeepHash(sourceAsset).get();
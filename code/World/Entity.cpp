@@ -8,6 +8,7 @@
  */
 #include "World/Entity.h"
 #include "World/IEntityComponent.h"
+#include "World/World.h"
 
 namespace traktor::world
 {
@@ -62,6 +63,9 @@ EntityState Entity::setState(const EntityState& state, const EntityState& mask)
 	if (mask.locked)
 		m_state.locked = state.locked;
 
+	if (m_world && (m_state.visible != current.visible || m_state.dynamic != current.dynamic || m_state.locked != current.locked))
+		m_world->changed(this);
+
 	for (auto component : m_components)
 	{
 		if (component != m_updating)
@@ -74,6 +78,8 @@ EntityState Entity::setState(const EntityState& state, const EntityState& mask)
 void Entity::setTransform(const Transform& transform)
 {
 	m_transform = transform;
+	if (m_world)
+		m_world->entityMoved(this);
 	for (auto component : m_components)
 	{
 		if (component != m_updating)
@@ -105,6 +111,13 @@ void Entity::update(const UpdateParams& update)
 	m_updating = nullptr;
 }
 
+void Entity::updateComponent(IEntityComponent* component, const UpdateParams& update)
+{
+	m_updating = component;
+	component->update(update);
+	m_updating = nullptr;
+}
+
 void Entity::setComponent(IEntityComponent* component)
 {
 	T_FATAL_ASSERT (component);
@@ -112,6 +125,13 @@ void Entity::setComponent(IEntityComponent* component)
 	component->setOwner(this);
 	component->setTransform(m_transform);
 
+	// Bounding box might change with new component.
+	if (m_world)
+	{
+		m_world->entityMoved(this);
+		m_world->changed(this);
+	}
+
 	// Replace existing component of same type.
 	for (auto comp : m_components)
 	{
@@ -157,6 +157,8 @@ public:
 	}
 
 private:
+	friend class World;
+
 	World* m_world = nullptr;
 	Guid m_id;
 	std::wstring m_name;
@@ -164,6 +166,11 @@ private:
 	EntityState m_state;
 	RefArray< IEntityComponent > m_components;
 	const IEntityComponent* m_updating = nullptr;
+	int32_t m_worldProxy = -1;		//!< Proxy in world's spatial tree, -1 if not in tree.
+	bool m_worldDirty = false;		//!< Proxy bounds need to be updated.
+
+	/*! Update single component; used by world when updating components in phases. */
+	void updateComponent(IEntityComponent* component, const UpdateParams& update);
 };
 
 }
@@ -55,4 +55,9 @@ void DecalComponent::update(const UpdateParams& update)
 	m_age += (float)update.deltaTime;
 }
 
+bool DecalComponent::getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const
+{
+	return true;
+}
+
 }
@@ -48,6 +48,8 @@ public:
 
 	virtual void update(const UpdateParams& update) override final;
 
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const override final;
+
 	const Vector2& getSize() const { return m_size; }
 
 	float getThickness() const { return m_thickness; }
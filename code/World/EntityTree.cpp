@@ -0,0 +1,437 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Math/Frustum.h"
+#include "World/EntityTree.h"
+
+namespace traktor::world
+{
+	namespace
+	{
+
+const Vector4 c_margin(0.5f, 0.5f, 0.5f, 0.0f);	//!< Enlargement of leaf bounding boxes.
+const int32_t c_maxStackDepth = 128;
+
+/*! Bounding box with w=1 in both corners, so all four lanes can be compared. */
+Aabb3 normalized(const Aabb3& aabb)
+{
+	return Aabb3(aabb.mn.xyz1(), aabb.mx.xyz1());
+}
+
+Aabb3 combine(const Aabb3& a, const Aabb3& b)
+{
+	return Aabb3(min(a.mn, b.mn), max(a.mx, b.mx));
+}
+
+/*! Half surface area, used as cost metric when inserting leaves. */
+float area(const Aabb3& aabb)
+{
+	const Vector4 e = aabb.mx - aabb.mn;
+	return e.x() * e.y() + e.y() * e.z() + e.z() * e.x();
+}
+
+bool contains(const Aabb3& outer, const Aabb3& inner)
+{
+	return compareAllLessEqual(outer.mn, inner.mn) && compareAllGreaterEqual(outer.mx, inner.mx);
+}
+
+bool overlaps(const Aabb3& a, const Aabb3& b)
+{
+	return compareAllLessEqual(a.mn, b.mx) && compareAllLessEqual(b.mn, a.mx);
+}
+
+	}
+
+int32_t EntityTree::insert(Entity* entity, const Aabb3& bounds)
+{
+	const int32_t leaf = allocateNode();
+	Node& node = m_nodes[leaf];
+	node.bounds = normalized(bounds);
+	node.aabb = Aabb3(node.bounds.mn - c_margin, node.bounds.mx + c_margin);
+	node.entity = entity;
+	node.height = 0;
+
+	insertLeaf(leaf);
+	m_count++;
+	return leaf;
+}
+
+void EntityTree::remove(int32_t proxy)
+{
+	T_ASSERT(m_nodes[proxy].leaf());
+	removeLeaf(proxy);
+	freeNode(proxy);
+	m_count--;
+}
+
+bool EntityTree::move(int32_t proxy, const Aabb3& bounds)
+{
+	Node& node = m_nodes[proxy];
+	T_ASSERT(node.leaf());
+
+	node.bounds = normalized(bounds);
+	if (contains(node.aabb, node.bounds))
+		return false;
+
+	removeLeaf(proxy);
+
+	Node& moved = m_nodes[proxy];
+	moved.aabb = Aabb3(moved.bounds.mn - c_margin, moved.bounds.mx + c_margin);
+
+	insertLeaf(proxy);
+	return true;
+}
+
+void EntityTree::clear()
+{
+	m_nodes.resize(0);
+	m_root = -1;
+	m_free = -1;
+	m_count = 0;
+}
+
+void EntityTree::queryBox(const Aabb3& box, AlignedVector< Entity* >& outEntities) const
+{
+	if (m_root < 0)
+		return;
+
+	const Aabb3 query = normalized(box);
+
+	int32_t stack[c_maxStackDepth];
+	int32_t depth = 0;
+
+	stack[depth++] = m_root;
+	while (depth > 0)
+	{
+		const Node& node = m_nodes[stack[--depth]];
+		if (!overlaps(node.aabb, query))
+			continue;
+
+		if (node.leaf())
+		{
+			if (overlaps(node.bounds, query))
+				outEntities.push_back(node.entity);
+		}
+		else
+		{
+			T_ASSERT(depth + 2 <= c_maxStackDepth);
+			stack[depth++] = node.left;
+			stack[depth++] = node.right;
+		}
+	}
+}
+
+void EntityTree::queryFrustum(const Frustum& frustum, AlignedVector< Entity* >& outEntities) const
+{
+	if (m_root < 0)
+		return;
+
+	int32_t stack[c_maxStackDepth];
+	int32_t depth = 0;
+
+	stack[depth++] = m_root;
+	while (depth > 0)
+	{
+		const int32_t index = stack[--depth];
+		const Node& node = m_nodes[index];
+
+		const Frustum::Result result = frustum.inside(node.aabb);
+		if (result == Frustum::Result::Outside)
+			continue;
+
+		if (node.leaf())
+		{
+			if (result == Frustum::Result::Inside || frustum.inside(node.bounds) != Frustum::Result::Outside)
+				outEntities.push_back(node.entity);
+		}
+		else if (result == Frustum::Result::Inside)
+			collect(index, outEntities);
+		else
+		{
+			T_ASSERT(depth + 2 <= c_maxStackDepth);
+			stack[depth++] = node.left;
+			stack[depth++] = node.right;
+		}
+	}
+}
+
+int32_t EntityTree::allocateNode()
+{
+	int32_t index;
+	if (m_free >= 0)
+	{
+		index = m_free;
+		m_free = m_nodes[index].parent;
+	}
+	else
+	{
+		index = (int32_t)m_nodes.size();
+		m_nodes.push_back(Node());
+	}
+
+	Node& node = m_nodes[index];
+	node.entity = nullptr;
+	node.parent = -1;
+	node.left = -1;
+	node.right = -1;
+	node.height = 0;
+	return index;
+}
+
+void EntityTree::freeNode(int32_t node)
+{
+	m_nodes[node].entity = nullptr;
+	m_nodes[node].parent = m_free;
+	m_nodes[node].height = -1;
+	m_free = node;
+}
+
+void EntityTree::insertLeaf(int32_t leaf)
+{
+	if (m_root < 0)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Find best sibling by descending into child with least increase of area.
+	const Aabb3 leafAabb = m_nodes[leaf].aabb;
+	int32_t index = m_root;
+	while (!m_nodes[index].leaf())
+	{
+		const Node& node = m_nodes[index];
+		const Node& left = m_nodes[node.left];
+		const Node& right = m_nodes[node.right];
+
+		const float nodeArea = area(node.aabb);
+		const float combinedArea = area(combine(node.aabb, leafAabb));
+
+		// Cost of creating a new parent for this node and the new leaf.
+		const float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree.
+		const float inheritanceCost = 2.0f * (combinedArea - nodeArea);
+
+		float costLeft = area(combine(leafAabb, left.aabb)) + inheritanceCost;
+		if (!left.leaf())
+			costLeft -= area(left.aabb);
+
+		float costRight = area(combine(leafAabb, right.aabb)) + inheritanceCost;
+		if (!right.leaf())
+			costRight -= area(right.aabb);
+
+		if (cost < costLeft && cost < costRight)
+			break;
+
+		index = (costLeft < costRight) ? node.left : node.right;
+	}
+
+	const int32_t sibling = index;
+	const int32_t oldParent = m_nodes[sibling].parent;
+
+	// Create new parent; allocation might move nodes so no references are kept across it.
+	const int32_t newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].aabb = combine(leafAabb, m_nodes[sibling].aabb);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].left = sibling;
+	m_nodes[newParent].right = leaf;
+
+	if (oldParent >= 0)
+	{
+		if (m_nodes[oldParent].left == sibling)
+			m_nodes[oldParent].left = newParent;
+		else
+			m_nodes[oldParent].right = newParent;
+	}
+	else
+		m_root = newParent;
+
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	// Walk back up the tree fixing heights and bounding boxes.
+	index = m_nodes[leaf].parent;
+	while (index >= 0)
+	{
+		index = balance(index);
+
+		Node& node = m_nodes[index];
+		node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+		node.aabb = combine(m_nodes[node.left].aabb, m_nodes[node.right].aabb);
+
+		index = node.parent;
+	}
+}
+
+void EntityTree::removeLeaf(int32_t leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	const int32_t parent = m_nodes[leaf].parent;
+	const int32_t grandParent = m_nodes[parent].parent;
+	const int32_t sibling = (m_nodes[parent].left == leaf) ? m_nodes[parent].right : m_nodes[parent].left;
+
+	if (grandParent >= 0)
+	{
+		// Replace parent with sibling.
+		if (m_nodes[grandParent].left == parent)
+			m_nodes[grandParent].left = sibling;
+		else
+			m_nodes[grandParent].right = sibling;
+
+		m_nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		int32_t index = grandParent;
+		while (index >= 0)
+		{
+			index = balance(index);
+
+			Node& node = m_nodes[index];
+			node.height = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+			node.aabb = combine(m_nodes[node.left].aabb, m_nodes[node.right].aabb);
+
+			index = node.parent;
+		}
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = -1;
+		freeNode(parent);
+	}
+}
+
+int32_t EntityTree::balance(int32_t iA)
+{
+	Node& A = m_nodes[iA];
+	if (A.leaf() || A.height < 2)
+		return iA;
+
+	const int32_t iB = A.left;
+	const int32_t iC = A.right;
+	Node& B = m_nodes[iB];
+	Node& C = m_nodes[iC];
+
+	const int32_t balance = C.height - B.height;
+
+	// Rotate C up.
+	if (balance > 1)
+	{
+		const int32_t iF = C.left;
+		const int32_t iG = C.right;
+		Node& F = m_nodes[iF];
+		Node& G = m_nodes[iG];
+
+		C.left = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if (C.parent >= 0)
+		{
+			if (m_nodes[C.parent].left == iA)
+				m_nodes[C.parent].left = iC;
+			else
+				m_nodes[C.parent].right = iC;
+		}
+		else
+			m_root = iC;
+
+		if (F.height > G.height)
+		{
+			C.right = iF;
+			A.right = iG;
+			G.parent = iA;
+			A.aabb = combine(B.aabb, G.aabb);
+			C.aabb = combine(A.aabb, F.aabb);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		}
+		else
+		{
+			C.right = iG;
+			A.right = iF;
+			F.parent = iA;
+			A.aabb = combine(B.aabb, F.aabb);
+			C.aabb = combine(A.aabb, G.aabb);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up.
+	if (balance < -1)
+	{
+		const int32_t iD = B.left;
+		const int32_t iE = B.right;
+		Node& D = m_nodes[iD];
+		Node& E = m_nodes[iE];
+
+		B.left = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if (B.parent >= 0)
+		{
+			if (m_nodes[B.parent].left == iA)
+				m_nodes[B.parent].left = iB;
+			else
+				m_nodes[B.parent].right = iB;
+		}
+		else
+			m_root = iB;
+
+		if (D.height > E.height)
+		{
+			B.right = iD;
+			A.left = iE;
+			E.parent = iA;
+			A.aabb = combine(C.aabb, E.aabb);
+			B.aabb = combine(A.aabb, D.aabb);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		}
+		else
+		{
+			B.right = iE;
+			A.left = iD;
+			D.parent = iA;
+			A.aabb = combine(C.aabb, D.aabb);
+			B.aabb = combine(A.aabb, E.aabb);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+void EntityTree::collect(int32_t node, AlignedVector< Entity* >& outEntities) const
+{
+	const Node& n = m_nodes[node];
+	if (n.leaf())
+		outEntities.push_back(n.entity);
+	else
+	{
+		collect(n.left, outEntities);
+		collect(n.right, outEntities);
+	}
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Math/Aabb3.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_WORLD_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor
+{
+
+class Frustum;
+
+}
+
+namespace traktor::world
+{
+
+class Entity;
+
+/*! Dynamic bounding volume tree of entities.
+ * \ingroup World
+ *
+ * Each entity is a leaf with an enlarged bounding box
+ * so small movements doesn't require the tree to be
+ * modified, and the tree is kept balanced by rotations
+ * as leaves are inserted and removed.
+ */
+class T_DLLCLASS EntityTree
+{
+public:
+	/*! Insert entity.
+	 *
+	 * \param entity Entity.
+	 * \param bounds Entity bounding box in world space.
+	 * \return Proxy of entity in tree.
+	 */
+	int32_t insert(Entity* entity, const Aabb3& bounds);
+
+	/*! Remove entity.
+	 *
+	 * \param proxy Proxy of entity in tree.
+	 */
+	void remove(int32_t proxy);
+
+	/*! Update bounding box of entity.
+	 *
+	 * \param proxy Proxy of entity in tree.
+	 * \param bounds Entity bounding box in world space.
+	 * \return True if entity leaf was reinserted.
+	 */
+	bool move(int32_t proxy, const Aabb3& bounds);
+
+	/*! Remove all entities. */
+	void clear();
+
+	/*! Get bounding box of entity. */
+	const Aabb3& getBounds(int32_t proxy) const { return m_nodes[proxy].bounds; }
+
+	/*! Get entities which bounding box overlap box. */
+	void queryBox(const Aabb3& box, AlignedVector< Entity* >& outEntities) const;
+
+	/*! Get entities which bounding box are partially or fully inside frustum. */
+	void queryFrustum(const Frustum& frustum, AlignedVector< Entity* >& outEntities) const;
+
+	/*! Get height of tree. */
+	int32_t getHeight() const { return m_root >= 0 ? m_nodes[m_root].height : 0; }
+
+	/*! Get number of entities in tree. */
+	uint32_t getCount() const { return m_count; }
+
+private:
+	struct Node
+	{
+		Aabb3 aabb;		//!< Enlarged bounding box of leaf, or union of children.
+		Aabb3 bounds;	//!< Entity bounding box; only valid for leaves.
+		Entity* entity;
+		int32_t parent;	//!< Parent node, or next free node when in free list.
+		int32_t left;
+		int32_t right;
+		int32_t height;
+
+		bool leaf() const { return left < 0; }
+	};
+
+	AlignedVector< Node > m_nodes;
+	int32_t m_root = -1;
+	int32_t m_free = -1;
+	uint32_t m_count = 0;
+
+	int32_t allocateNode();
+
+	void freeNode(int32_t node);
+
+	void insertLeaf(int32_t leaf);
+
+	void removeLeaf(int32_t leaf);
+
+	int32_t balance(int32_t node);
+
+	void collect(int32_t node, AlignedVector< Entity* >& outEntities) const;
+};
+
+}
@@ -65,6 +65,22 @@ public:
 	 * \param update Update information.
 	 */
 	virtual void update(const UpdateParams& update) = 0;
+
+	/*! Get state accessed by update.
+	 *
+	 * Components which declare their access are updated in parallel,
+	 * across entities, in phases with other components they don't
+	 * conflict with. Access is declared per component type and may
+	 * only refer to state of owner entity, such as Entity for transform
+	 * or other component types of owner; each component implicitly
+	 * writes it's own type. Components accessing state shared between
+	 * entities, or querying the world, must not declare access.
+	 *
+	 * \param outReads Types read by update.
+	 * \param outWrites Types written by update.
+	 * \return True if access is declared, false if update must be serial.
+	 */
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const { return false; }
 };
 
 }
@@ -0,0 +1,421 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Containers/StaticVector.h"
+#include "Core/Timer/Profiler.h"
+#include "World/Entity.h"
+#include "World/IEntityComponent.h"
+#include "World/IWorldComponent.h"
+#include "World/World.h"
+#include "World/WorldEntityRenderers.h"
+#include "World/Entity/FogComponent.h"
+#include "World/Entity/IrradianceGridComponent.h"
+#include "World/Entity/LightComponent.h"
+#include "World/Entity/ProbeComponent.h"
+#include "World/Entity/RTWorldComponent.h"
+#include "World/Shared/WorldGather.h"
+#include "World/Shared/Passes/LightClusterPass.h"
+
+namespace traktor::world
+{
+
+void WorldGather::gather(
+	const World* world,
+	const WorldEntityRenderers* entityRenderers,
+	const std::function< bool(const EntityState& state) >& filter,
+	bool shadowsEnable,
+	GatherView& inOutView
+)
+{
+	// Classification of component types depend on available renderers; renderables
+	// are grouped in order of renderers so groups are same each time.
+	if (entityRenderers != m_entityRenderers || entityRenderers->getRevision() != m_entityRenderersRevision)
+	{
+		m_classifications.clear();
+		m_rendererIndices.clear();
+		for (uint32_t i = 0; i < (uint32_t)entityRenderers->get().size(); ++i)
+			m_rendererIndices[entityRenderers->get()[i]] = i;
+		m_entityRenderers = entityRenderers;
+		m_entityRenderersRevision = entityRenderers->getRevision();
+		m_valid = false;
+	}
+
+	// Filter predicate cannot be tracked so filtered gathers are always rebuilt.
+	if (filter != nullptr)
+	{
+		rebuild(world, filter, inOutView);
+		m_valid = false;
+	}
+	else if (!m_valid || world != m_world)
+	{
+		rebuild(world, nullptr, inOutView);
+		m_world = world;
+		m_worldRevision = world->getRevision();
+		m_valid = true;
+	}
+	else if (world->getRevision() != m_worldRevision)
+	{
+		// Get revision first; changes made meanwhile are patched again next gather.
+		const uint32_t worldRevision = world->getRevision();
+		if (world->getChangedEntities(m_worldRevision, m_changedEntities))
+			patch(world, m_changedEntities, inOutView);
+		else
+			rebuild(world, nullptr, inOutView);
+		m_changedEntities.resize(0);
+		m_worldRevision = worldRevision;
+	}
+
+	// Properties of world components and lights might change without
+	// world being changed so these are resolved each frame.
+	inOutView.irradianceGrid = m_irradianceGridComponent ? m_irradianceGridComponent->getIrradianceGrid() : nullptr;
+	inOutView.rtWorldTopLevel = m_rtWorldComponent ? m_rtWorldComponent->getTopLevel() : nullptr;
+
+	StaticVector< const LightComponent*, LightClusterPass::c_maxLightCount > lights;
+	for (auto light : m_lights)
+	{
+		if (light->getLightType() != LightType::Disabled && !lights.full())
+			lights.push_back(light);
+	}
+
+	// Arrange lights.
+	{
+		inOutView.lights.resize(0);
+		inOutView.cascadingDirectionalLight = nullptr;
+
+		// Find cascade shadow directional light.
+		if (shadowsEnable)
+		{
+			for (int32_t i = 0; i < (int32_t)lights.size(); ++i)
+			{
+				auto& light = lights[i];
+				if (
+					light->getCastShadow() &&
+					light->getLightType() == LightType::Directional)
+				{
+					inOutView.cascadingDirectionalLight = light;
+					break;
+				}
+			}
+		}
+
+		// Add all lights, skip cascade shadow directional light.
+		for (int32_t i = 0; i < (int32_t)lights.size(); ++i)
+		{
+			auto& light = lights[i];
+			if (light != inOutView.cascadingDirectionalLight)
+				inOutView.lights.push_back(light);
+		}
+
+		// Append cascade shadow directional light last.
+		if (inOutView.cascadingDirectionalLight != nullptr)
+			inOutView.lights.push_back(inOutView.cascadingDirectionalLight);
+	}
+}
+
+void WorldGather::reset()
+{
+	m_classifications.clear();
+	m_rendererIndices.clear();
+	m_rendererOffsets.resize(0);
+	m_owners.resize(0);
+	m_entityRenderables.clear();
+	m_lights.resize(0);
+	m_lightOwners.resize(0);
+	m_probeOwners.resize(0);
+	m_fogOwner = nullptr;
+	m_irradianceGridComponent = nullptr;
+	m_rtWorldComponent = nullptr;
+	m_world = nullptr;
+	m_entityRenderers = nullptr;
+	m_valid = false;
+}
+
+const WorldGather::Classification& WorldGather::classify(const TypeInfo& componentType)
+{
+	auto it = m_classifications.find(&componentType);
+	if (it != m_classifications.end())
+		return it->second;
+
+	Classification& classification = m_classifications[&componentType];
+	classification.renderer = m_entityRenderers->find(componentType);
+	if (classification.renderer)
+		classification.rendererIndex = m_rendererIndices[classification.renderer];
+	if (is_type_of< LightComponent >(componentType))
+		classification.kind = Kind::Light;
+	else if (is_type_of< ProbeComponent >(componentType))
+		classification.kind = Kind::Probe;
+	else if (is_type_of< FogComponent >(componentType))
+		classification.kind = Kind::Fog;
+	return classification;
+}
+
+void WorldGather::rebuild(const World* world, const std::function< bool(const EntityState& state) >& filter, GatherView& inOutView)
+{
+	T_PROFILER_SCOPE(L"WorldGather rebuild");
+
+	inOutView.probes.resize(0);
+	inOutView.fog = nullptr;
+
+	m_gathered.resize(0);
+	m_entityRenderables.clear();
+	m_lights.resize(0);
+	m_lightOwners.resize(0);
+	m_probeOwners.resize(0);
+	m_fogOwner = nullptr;
+	m_irradianceGridComponent = nullptr;
+	m_rtWorldComponent = nullptr;
+
+	for (auto component : world->getComponents())
+	{
+		const Classification& classification = classify(type_of(component));
+		if (classification.renderer)
+			m_gathered.push_back({ { classification.renderer, component, EntityState::All }, classification.rendererIndex, nullptr });
+
+		// Filter out components used to setup frame's lighting etc.
+		if (auto irradianceGridComponent = dynamic_type_cast< const IrradianceGridComponent* >(component))
+			m_irradianceGridComponent = irradianceGridComponent;
+		else if (auto rtWorldComponent = dynamic_type_cast< const RTWorldComponent* >(component))
+			m_rtWorldComponent = rtWorldComponent;
+	}
+
+	// Consecutive components are often of same type so last classification is reused.
+	const TypeInfo* lastType = nullptr;
+	const Classification* last = nullptr;
+
+	for (auto entity : world->getEntities())
+	{
+		const EntityState state = entity->getState();
+
+		if (filter != nullptr && filter(state) == false)
+			continue;
+		else if (filter == nullptr && state.visible == false)
+			continue;
+
+		for (auto component : entity->getComponents())
+		{
+			const TypeInfo* componentType = &type_of(component);
+			if (componentType != lastType)
+			{
+				last = &classify(*componentType);
+				lastType = componentType;
+			}
+
+			if (last->renderer)
+				m_gathered.push_back({ { last->renderer, component, state }, last->rendererIndex, entity });
+
+			// Filter out components used to setup frame's lighting etc.
+			switch (last->kind)
+			{
+			case Kind::Light:
+				m_lights.push_back(static_cast< const LightComponent* >(component));
+				m_lightOwners.push_back(entity);
+				break;
+
+			case Kind::Probe:
+				inOutView.probes.push_back(static_cast< const ProbeComponent* >(component));
+				m_probeOwners.push_back(entity);
+				break;
+
+			case Kind::Fog:
+				inOutView.fog = static_cast< const FogComponent* >(component);
+				m_fogOwner = entity;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	// Group renderables by renderer so each renderer process it's renderables in sequence;
+	// counting sort is stable thus renderables of each renderer are in order of entities.
+	const uint32_t rendererCount = (uint32_t)m_entityRenderers->get().size();
+
+	m_rendererOffsets.resize(0);
+	m_rendererOffsets.resize(rendererCount + 1, 0);
+	for (const auto& gathered : m_gathered)
+		m_rendererOffsets[gathered.rendererIndex + 1]++;
+	for (uint32_t i = 1; i <= rendererCount; ++i)
+		m_rendererOffsets[i] += m_rendererOffsets[i - 1];
+
+	inOutView.renderables.resize(m_gathered.size());
+	m_owners.resize(m_gathered.size());
+
+	for (const auto& gathered : m_gathered)
+	{
+		const uint32_t index = m_rendererOffsets[gathered.rendererIndex]++;
+		inOutView.renderables[index] = gathered.renderable;
+		m_owners[index] = gathered.owner;
+		if (gathered.owner)
+			m_entityRenderables[gathered.owner].push_back(index);
+	}
+
+	// Offsets has been advanced to end of each renderer; shift back to first.
+	for (uint32_t i = rendererCount; i > 0; --i)
+		m_rendererOffsets[i] = m_rendererOffsets[i - 1];
+	m_rendererOffsets[0] = 0;
+
+	m_gathered.resize(0);
+	m_rebuildCount++;
+}
+
+void WorldGather::patch(const World* world, const RefArray< Entity >& changedEntities, GatherView& inOutView)
+{
+	T_PROFILER_SCOPE(L"WorldGather patch");
+
+	for (auto entity : changedEntities)
+	{
+		// Remove everything previously gathered from entity.
+		auto it = m_entityRenderables.find(entity);
+		if (it != m_entityRenderables.end())
+		{
+			auto& indices = it->second;
+			while (!indices.empty())
+			{
+				const uint32_t index = indices.back();
+				indices.pop_back();
+				removeRenderable(index, inOutView);
+			}
+			m_entityRenderables.erase(it);
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)m_lights.size(); )
+		{
+			if (m_lightOwners[i] == entity)
+			{
+				m_lights.erase(m_lights.begin() + i);
+				m_lightOwners.erase(m_lightOwners.begin() + i);
+			}
+			else
+				++i;
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)inOutView.probes.size(); )
+		{
+			if (m_probeOwners[i] == entity)
+			{
+				inOutView.probes.erase(inOutView.probes.begin() + i);
+				m_probeOwners.erase(m_probeOwners.begin() + i);
+			}
+			else
+				++i;
+		}
+
+		if (m_fogOwner == entity)
+		{
+			inOutView.fog = nullptr;
+			m_fogOwner = nullptr;
+		}
+
+		// Gather entity again if it's still visible in world.
+		const EntityState state = entity->getState();
+		if (entity->getWorld() != world || state.visible == false)
+			continue;
+
+		for (auto component : entity->getComponents())
+		{
+			const Classification& classification = classify(type_of(component));
+
+			if (classification.renderer)
+				insertRenderable({ classification.renderer, component, state }, classification.rendererIndex, entity, inOutView);
+
+			switch (classification.kind)
+			{
+			case Kind::Light:
+				m_lights.push_back(static_cast< const LightComponent* >(component));
+				m_lightOwners.push_back(entity);
+				break;
+
+			case Kind::Probe:
+				inOutView.probes.push_back(static_cast< const ProbeComponent* >(component));
+				m_probeOwners.push_back(entity);
+				break;
+
+			case Kind::Fog:
+				inOutView.fog = static_cast< const FogComponent* >(component);
+				m_fogOwner = entity;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	m_patchCount++;
+}
+
+void WorldGather::insertRenderable(const GatherView::Renderable& renderable, uint32_t rendererIndex, const Entity* owner, GatherView& inOutView)
+{
+	const uint32_t rendererCount = (uint32_t)m_rendererOffsets.size() - 1;
+
+	// Make room at end of renderer's group by moving first renderable
+	// of each following group to end of that group.
+	uint32_t hole = (uint32_t)inOutView.renderables.size();
+	inOutView.renderables.push_back(renderable);
+	m_owners.push_back(nullptr);
+	m_rendererOffsets[rendererCount]++;
+
+	for (uint32_t i = rendererCount - 1; i > rendererIndex; --i)
+	{
+		if (m_rendererOffsets[i] < hole)
+		{
+			moveRenderable(m_rendererOffsets[i], hole, inOutView);
+			hole = m_rendererOffsets[i];
+		}
+		m_rendererOffsets[i]++;
+	}
+
+	inOutView.renderables[hole] = renderable;
+	m_owners[hole] = owner;
+	m_entityRenderables[owner].push_back(hole);
+}
+
+void WorldGather::removeRenderable(uint32_t index, GatherView& inOutView)
+{
+	const uint32_t rendererCount = (uint32_t)m_rendererOffsets.size() - 1;
+	const uint32_t rendererIndex = (uint32_t)(std::upper_bound(m_rendererOffsets.begin(), m_rendererOffsets.end(), index) - m_rendererOffsets.begin()) - 1;
+
+	// Fill with last renderable of group, then fill hole at end of
+	// group with last renderable of each following group.
+	uint32_t hole = m_rendererOffsets[rendererIndex + 1] - 1;
+	if (hole != index)
+		moveRenderable(hole, index, inOutView);
+
+	for (uint32_t i = rendererIndex + 1; i < rendererCount; ++i)
+	{
+		if (m_rendererOffsets[i] < m_rendererOffsets[i + 1])
+		{
+			moveRenderable(m_rendererOffsets[i + 1] - 1, hole, inOutView);
+			hole = m_rendererOffsets[i + 1] - 1;
+		}
+		m_rendererOffsets[i]--;
+	}
+
+	T_FATAL_ASSERT(hole == inOutView.renderables.size() - 1);
+	inOutView.renderables.pop_back();
+	m_owners.pop_back();
+	m_rendererOffsets[rendererCount]--;
+}
+
+void WorldGather::moveRenderable(uint32_t from, uint32_t to, GatherView& inOutView)
+{
+	inOutView.renderables[to] = inOutView.renderables[from];
+
+	const Entity* owner = m_owners[from];
+	m_owners[to] = owner;
+
+	if (owner)
+	{
+		auto& indices = m_entityRenderables[owner];
+		*std::find(indices.begin(), indices.end(), from) = to;
+	}
+}
+
+}
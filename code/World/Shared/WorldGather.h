@@ -0,0 +1,132 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include "Core/RefArray.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Containers/SmallMap.h"
+#include "World/WorldTypes.h"
+
+// import/export mechanism.
+#undef T_DLLCLASS
+#if defined(T_WORLD_EXPORT)
+#	define T_DLLCLASS T_DLLEXPORT
+#else
+#	define T_DLLCLASS T_DLLIMPORT
+#endif
+
+namespace traktor::world
+{
+
+class Entity;
+class IEntityRenderer;
+class IrradianceGridComponent;
+class RTWorldComponent;
+class World;
+class WorldEntityRenderers;
+
+/*! Gather renderables, lights etc from world.
+ * \ingroup World
+ *
+ * Renderables are kept in a flat list grouped by renderer, in
+ * order of renderers. When entities are added, removed or their
+ * visibility has changed only renderables of those entities are
+ * patched; the list is only rebuilt when world components or
+ * renderers has changed. Frames without changes reuse the
+ * previous list.
+ */
+class T_DLLCLASS WorldGather
+{
+public:
+	/*! Gather view from world.
+	 *
+	 * \param world World to gather from.
+	 * \param entityRenderers Entity renderers.
+	 * \param filter Gather only entities which match filter predicate, if null then only visible entities are gathered.
+	 * \param shadowsEnable If cascading shadow directional light should be selected.
+	 * \param inOutView Gathered view; same view must be passed each time as it's updated incrementally.
+	 */
+	void gather(
+		const World* world,
+		const WorldEntityRenderers* entityRenderers,
+		const std::function< bool(const EntityState& state) >& filter,
+		bool shadowsEnable,
+		GatherView& inOutView
+	);
+
+	/*! Discard cached result, next gather will rebuild view. */
+	void reset();
+
+	/*! Get number of times renderables has been rebuilt. */
+	uint32_t getRebuildCount() const { return m_rebuildCount; }
+
+	/*! Get number of times renderables has been patched. */
+	uint32_t getPatchCount() const { return m_patchCount; }
+
+private:
+	enum class Kind : uint8_t
+	{
+		None,
+		Light,
+		Probe,
+		Fog
+	};
+
+	struct Classification
+	{
+		IEntityRenderer* renderer = nullptr;
+		uint32_t rendererIndex = 0;		//!< Index of renderer, renderables are grouped in order of index.
+		Kind kind = Kind::None;
+	};
+
+	struct Gathered
+	{
+		GatherView::Renderable renderable;
+		uint32_t rendererIndex;
+		const Entity* owner;
+	};
+
+	SmallMap< const TypeInfo*, Classification > m_classifications;
+	SmallMap< const IEntityRenderer*, uint32_t > m_rendererIndices;
+	AlignedVector< uint32_t > m_rendererOffsets;		//!< First renderable of each renderer, last is number of renderables.
+	AlignedVector< const Entity* > m_owners;			//!< Entity of each renderable, null if world component.
+	std::unordered_map< const Entity*, AlignedVector< uint32_t > > m_entityRenderables;
+	AlignedVector< Gathered > m_gathered;
+	AlignedVector< const LightComponent* > m_lights;
+	AlignedVector< const Entity* > m_lightOwners;
+	AlignedVector< const Entity* > m_probeOwners;
+	const Entity* m_fogOwner = nullptr;
+	RefArray< Entity > m_changedEntities;
+	const IrradianceGridComponent* m_irradianceGridComponent = nullptr;
+	const RTWorldComponent* m_rtWorldComponent = nullptr;
+	const World* m_world = nullptr;
+	const WorldEntityRenderers* m_entityRenderers = nullptr;
+	uint32_t m_worldRevision = 0;
+	uint32_t m_entityRenderersRevision = 0;
+	uint32_t m_rebuildCount = 0;
+	uint32_t m_patchCount = 0;
+	bool m_valid = false;
+
+	const Classification& classify(const TypeInfo& componentType);
+
+	void rebuild(const World* world, const std::function< bool(const EntityState& state) >& filter, GatherView& inOutView);
+
+	/*! Replace renderables, lights etc of changed entities. */
+	void patch(const World* world, const RefArray< Entity >& changedEntities, GatherView& inOutView);
+
+	void insertRenderable(const GatherView::Renderable& renderable, uint32_t rendererIndex, const Entity* owner, GatherView& inOutView);
+
+	void removeRenderable(uint32_t index, GatherView& inOutView);
+
+	void moveRenderable(uint32_t from, uint32_t to, GatherView& inOutView);
+};
+
+}
@@ -20,14 +20,9 @@
 #include "Render/ScreenRenderer.h"
 #include "Resource/IResourceManager.h"
 #include "World/Entity.h"
-#include "World/Entity/FogComponent.h"
-#include "World/Entity/IrradianceGridComponent.h"
 #include "World/Entity/LightComponent.h"
-#include "World/Entity/ProbeComponent.h"
-#include "World/Entity/RTWorldComponent.h"
 #include "World/IEntityRenderer.h"
 #include "World/IrradianceGrid.h"
-#include "World/IWorldComponent.h"
 #include "World/Packer.h"
 #include "World/Shared/Passes/AmbientOcclusionPass.h"
 #include "World/Shared/Passes/ContactShadowsPass.h"
@@ -39,6 +34,7 @@
 #include "World/Shared/Passes/PostProcessPass.h"
 #include "World/Shared/Passes/ReflectionsPass.h"
 #include "World/Shared/Passes/VelocityPass.h"
+#include "World/Shared/WorldGather.h"
 #include "World/Shared/WorldRenderPassShared.h"
 #include "World/SMProj/UniformShadowProjection.h"
 #include "World/World.h"
@@ -211,90 +207,7 @@ void WorldRendererShared::destroy()
 void WorldRendererShared::gather(const World* world, const std::function< bool(const EntityState& state) >& filter)
 {
 	T_PROFILER_SCOPE(L"WorldRendererShared::gather");
-	StaticVector< const LightComponent*, LightClusterPass::c_maxLightCount > lights;
-
-	m_gatheredView.renderables.resize(0);
-	m_gatheredView.lights.resize(0);
-	m_gatheredView.probes.resize(0);
-	m_gatheredView.fog = nullptr;
-	m_gatheredView.irradianceGrid = nullptr;
-	m_gatheredView.rtWorldTopLevel = nullptr;
-
-	for (auto component : world->getComponents())
-	{
-		IEntityRenderer* entityRenderer = m_entityRenderers->find(type_of(component));
-		if (entityRenderer)
-			m_gatheredView.renderables.push_back({ entityRenderer, component, EntityState::All });
-
-		// Filter out components used to setup frame's lighting etc.
-		if (auto irradianceGridComponent = dynamic_type_cast< const IrradianceGridComponent* >(component))
-			m_gatheredView.irradianceGrid = irradianceGridComponent->getIrradianceGrid();
-		else if (auto rtWorldComponent = dynamic_type_cast< const RTWorldComponent* >(component))
-			m_gatheredView.rtWorldTopLevel = rtWorldComponent->getTopLevel();
-	}
-
-	for (auto entity : world->getEntities())
-	{
-		const EntityState state = entity->getState();
-
-		if (filter != nullptr && filter(state) == false)
-			continue;
-		else if (filter == nullptr && state.visible == false)
-			continue;
-
-		for (auto component : entity->getComponents())
-		{
-			IEntityRenderer* entityRenderer = m_entityRenderers->find(type_of(component));
-			if (entityRenderer)
-				m_gatheredView.renderables.push_back({ entityRenderer, component, state });
-
-			// Filter out components used to setup frame's lighting etc.
-			if (auto lightComponent = dynamic_type_cast< const LightComponent* >(component))
-			{
-				if (lightComponent->getLightType() != LightType::Disabled && !lights.full())
-					lights.push_back(lightComponent);
-			}
-			else if (auto probeComponent = dynamic_type_cast< const ProbeComponent* >(component))
-				m_gatheredView.probes.push_back(probeComponent);
-			else if (auto fogComponent = dynamic_type_cast< const FogComponent* >(component))
-				m_gatheredView.fog = fogComponent;
-		}
-	}
-
-	// Arrange lights.
-	{
-		m_gatheredView.lights.resize(0);
-		m_gatheredView.cascadingDirectionalLight = nullptr;
-
-		// Find cascade shadow directional light.
-		const bool shadowsEnable = (bool)(m_shadowsQuality != Quality::Disabled);
-		if (shadowsEnable)
-		{
-			for (int32_t i = 0; i < (int32_t)lights.size(); ++i)
-			{
-				auto& light = lights[i];
-				if (
-					light->getCastShadow() &&
-					light->getLightType() == LightType::Directional)
-				{
-					m_gatheredView.cascadingDirectionalLight = light;
-					break;
-				}
-			}
-		}
-
-		// Add all lights, skip cascade shadow directional light.
-		for (int32_t i = 0; i < (int32_t)lights.size(); ++i)
-		{
-			auto& light = lights[i];
-			if (light != m_gatheredView.cascadingDirectionalLight)
-				m_gatheredView.lights.push_back(light);
-		}
-
-		// Append cascade shadow directional light last.
-		if (m_gatheredView.cascadingDirectionalLight != nullptr)
-			m_gatheredView.lights.push_back(m_gatheredView.cascadingDirectionalLight);
-	}
+	m_gather.gather(world, m_entityRenderers, filter, (bool)(m_shadowsQuality != Quality::Disabled), m_gatheredView);
 }
 
 void WorldRendererShared::setupLightPass(
@@ -12,6 +12,7 @@
 #include "Core/Math/Frustum.h"
 #include "Resource/Proxy.h"
 #include "World/IWorldRenderer.h"
+#include "World/Shared/WorldGather.h"
 #include "World/WorldRenderSettings.h"
 
 namespace traktor::render
@@ -115,6 +116,7 @@ protected:
 	Ref< render::ITexture > m_blackCubeTexture;
 	resource::Proxy< render::Shader > m_clearDepthShader;
 
+	WorldGather m_gather;
 	GatherView m_gatheredView;
 	Ref< Packer > m_shadowAtlasPacker;
 	AlignedVector< render::handle_t > m_visualAttachments;
@@ -0,0 +1,223 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include <cmath>
+#include "Core/Log/Log.h"
+#include "Core/Math/Const.h"
+#include "Core/Math/Frustum.h"
+#include "Core/Math/Random.h"
+#include "Core/Timer/Timer.h"
+#include "World/Entity.h"
+#include "World/EntityTree.h"
+#include "World/Test/CaseEntityTree.h"
+
+namespace traktor::world::test
+{
+	namespace
+	{
+
+const float c_worldSize = 1000.0f;
+
+struct Item
+{
+	Ref< Entity > entity;
+	Aabb3 bounds;
+	int32_t proxy;
+};
+
+Aabb3 randomBounds(Random& random)
+{
+	const Vector4 center(
+		(random.nextFloat() - 0.5f) * c_worldSize,
+		(random.nextFloat() - 0.5f) * c_worldSize,
+		(random.nextFloat() - 0.5f) * c_worldSize,
+		1.0f
+	);
+	const Vector4 extent(
+		0.1f + random.nextFloat() * 4.0f,
+		0.1f + random.nextFloat() * 4.0f,
+		0.1f + random.nextFloat() * 4.0f,
+		0.0f
+	);
+	return Aabb3(center - extent, center + extent);
+}
+
+bool overlap(const Aabb3& a, const Aabb3& b)
+{
+	return
+		a.mn.x() <= b.mx.x() && b.mn.x() <= a.mx.x() &&
+		a.mn.y() <= b.mx.y() && b.mn.y() <= a.mx.y() &&
+		a.mn.z() <= b.mx.z() && b.mn.z() <= a.mx.z();
+}
+
+void queryLinear(const AlignedVector< Item >& items, const Aabb3& box, AlignedVector< Entity* >& outEntities)
+{
+	for (const auto& item : items)
+	{
+		if (overlap(item.bounds, box))
+			outEntities.push_back(item.entity);
+	}
+}
+
+bool sameEntities(AlignedVector< Entity* > a, AlignedVector< Entity* > b)
+{
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+	return a == b;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.world.test.CaseEntityTree", 0, CaseEntityTree, traktor::test::Case)
+
+void CaseEntityTree::run()
+{
+	// Compare queries with linear scans while entities are inserted, moved and removed.
+	{
+		Random random(1234);
+		EntityTree tree;
+		AlignedVector< Item > items;
+
+		for (int32_t i = 0; i < 2000; ++i)
+		{
+			Item& item = items.push_back();
+			item.entity = new Entity();
+			item.bounds = randomBounds(random);
+			item.proxy = tree.insert(item.entity, item.bounds);
+		}
+		CASE_ASSERT_EQUAL(tree.getCount(), 2000u);
+
+		// Small movements stay within enlarged leaves, large movements reinsert.
+		int32_t reinserted = 0;
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			Item& item = items[random.next() % items.size()];
+			if (i & 1)
+			{
+				const Vector4 offset(0.1f, -0.1f, 0.05f, 0.0f);
+				item.bounds = Aabb3(item.bounds.mn + offset, item.bounds.mx + offset);
+			}
+			else
+				item.bounds = randomBounds(random);
+			if (tree.move(item.proxy, item.bounds))
+				++reinserted;
+		}
+		CASE_ASSERT(reinserted >= 500);
+		CASE_ASSERT(reinserted < 1000);
+
+		for (int32_t i = 0; i < 500; ++i)
+		{
+			const uint32_t index = random.next() % items.size();
+			tree.remove(items[index].proxy);
+			items.erase(items.begin() + index);
+		}
+		CASE_ASSERT_EQUAL(tree.getCount(), 1500u);
+
+		// Tree should stay balanced.
+		CASE_ASSERT(tree.getHeight() <= 2 * (int32_t)std::ceil(std::log2(1500.0)));
+
+		AlignedVector< Entity* > expected, result;
+		bool allEqual = true;
+		for (int32_t i = 0; i < 100; ++i)
+		{
+			const Vector4 center = randomBounds(random).getCenter();
+			const Vector4 extent = Vector4(1.0f, 1.0f, 1.0f, 0.0f) * Scalar(random.nextFloat() * 200.0f);
+			const Aabb3 box(center - extent, center + extent);
+
+			expected.resize(0);
+			queryLinear(items, box, expected);
+
+			result.resize(0);
+			tree.queryBox(box, result);
+
+			allEqual &= sameEntities(expected, result);
+		}
+		CASE_ASSERT(allEqual);
+
+		Frustum frustum;
+		frustum.buildPerspective(deg2rad(70.0f), 1.0f, 1.0f, c_worldSize * 0.5f);
+
+		expected.resize(0);
+		for (const auto& item : items)
+		{
+			if (frustum.inside(item.bounds) != Frustum::Result::Outside)
+				expected.push_back(item.entity);
+		}
+
+		result.resize(0);
+		tree.queryFrustum(frustum, result);
+
+		CASE_ASSERT(!expected.empty());
+		CASE_ASSERT(sameEntities(expected, result));
+	}
+
+	// Time queries with tree and linear scan in worlds of increasing size.
+	for (int32_t count : { 1000, 10000, 100000 })
+	{
+		Random random(5678);
+		EntityTree tree;
+		AlignedVector< Item > items;
+		items.reserve(count);
+
+		Timer timer;
+		for (int32_t i = 0; i < count; ++i)
+		{
+			Item& item = items.push_back();
+			item.entity = new Entity();
+			item.bounds = randomBounds(random);
+			item.proxy = tree.insert(item.entity, item.bounds);
+		}
+		const double buildTime = timer.getElapsedTime();
+
+		timer.reset();
+		for (auto& item : items)
+		{
+			const Vector4 offset(random.nextFloat() - 0.5f, random.nextFloat() - 0.5f, random.nextFloat() - 0.5f, 0.0f);
+			item.bounds = Aabb3(item.bounds.mn + offset, item.bounds.mx + offset);
+			tree.move(item.proxy, item.bounds);
+		}
+		const double moveTime = timer.getElapsedTime();
+
+		AlignedVector< Aabb3 > boxes;
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			const Vector4 center = randomBounds(random).getCenter();
+			const Vector4 extent(20.0f, 20.0f, 20.0f, 0.0f);
+			boxes.push_back(Aabb3(center - extent, center + extent));
+		}
+
+		AlignedVector< Entity* > result;
+		uint32_t linearFound = 0;
+		uint32_t treeFound = 0;
+
+		timer.reset();
+		for (const auto& box : boxes)
+		{
+			result.resize(0);
+			queryLinear(items, box, result);
+			linearFound += (uint32_t)result.size();
+		}
+		const double linearTime = timer.getElapsedTime();
+
+		timer.reset();
+		for (const auto& box : boxes)
+		{
+			result.resize(0);
+			tree.queryBox(box, result);
+			treeFound += (uint32_t)result.size();
+		}
+		const double treeTime = timer.getElapsedTime();
+
+		CASE_ASSERT_EQUAL(treeFound, linearFound);
+
+		log::info << count << L" entities; build " << int32_t(buildTime * 1000.0) << L" ms, move all " << int32_t(moveTime * 1000.0) << L" ms, 1000 box queries " << int32_t(linearTime * 1000.0) << L" ms linear, " << int32_t(treeTime * 1000.0) << L" ms tree (height " << tree.getHeight() << L")." << Endl;
+	}
+}
+
+}
@@ -0,0 +1,336 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Guid.h"
+#include "Core/Log/Log.h"
+#include "Core/Timer/Timer.h"
+#include "Render/IRenderSystem.h"
+#include "Resource/IResourceManager.h"
+#include "Resource/ResourceBundleLoad.h"
+#include "Resource/ResourceHandle.h"
+#include "World/Entity.h"
+#include "World/IEntityComponent.h"
+#include "World/IEntityRenderer.h"
+#include "World/World.h"
+#include "World/WorldEntityRenderers.h"
+#include "World/Entity/IrradianceGridComponent.h"
+#include "World/Shared/WorldGather.h"
+#include "World/Test/CaseWorldGather.h"
+
+namespace traktor::world::test
+{
+	namespace
+	{
+
+const int32_t c_entityCount = 50000;	//!< Each entity has two components.
+const int32_t c_frameCount = 100;
+
+/*! Render system which doesn't create anything. */
+class NullRenderSystem : public render::IRenderSystem
+{
+public:
+	virtual bool create(const render::RenderSystemDesc& desc) override final { return true; }
+
+	virtual void destroy() override final {}
+
+	virtual bool reset(const render::RenderSystemDesc& desc) override final { return true; }
+
+	virtual void getInformation(render::RenderSystemInformation& outInfo) const override final {}
+
+	virtual bool supportRayTracing() const override final { return false; }
+
+	virtual uint32_t getDisplayCount() const override final { return 0; }
+
+	virtual uint32_t getDisplayModeCount(uint32_t display) const override final { return 0; }
+
+	virtual render::DisplayMode getDisplayMode(uint32_t display, uint32_t index) const override final { return render::DisplayMode(); }
+
+	virtual render::DisplayMode getCurrentDisplayMode(uint32_t display) const override final { return render::DisplayMode(); }
+
+	virtual float getDisplayAspectRatio(uint32_t display) const override final { return 1.0f; }
+
+	virtual Ref< render::IRenderView > createRenderView(const render::RenderViewDefaultDesc& desc) override final { return nullptr; }
+
+	virtual Ref< render::IRenderView > createRenderView(const render::RenderViewEmbeddedDesc& desc) override final { return nullptr; }
+
+	virtual Ref< render::Buffer > createBuffer(uint32_t usage, uint32_t bufferSize, bool dynamic) override final { return nullptr; }
+
+	virtual Ref< const render::IVertexLayout > createVertexLayout(const AlignedVector< render::VertexElement >& vertexElements) override final { return nullptr; }
+
+	virtual Ref< render::ITexture > createSimpleTexture(const render::SimpleTextureCreateDesc& desc, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::ITexture > createCubeTexture(const render::CubeTextureCreateDesc& desc, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::ITexture > createVolumeTexture(const render::VolumeTextureCreateDesc& desc, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::IRenderTargetSet > createRenderTargetSet(const render::RenderTargetSetCreateDesc& desc, render::IRenderTargetSet* sharedDepthStencil, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::IAccelerationStructure > createTopLevelAccelerationStructure(uint32_t numInstances) override final { return nullptr; }
+
+	virtual Ref< render::IAccelerationStructure > createAccelerationStructure(const render::Buffer* vertexBuffer, const render::IVertexLayout* vertexLayout, const render::Buffer* indexBuffer, render::IndexType indexType, const AlignedVector< render::Primitives >& primitives) override final { return nullptr; }
+
+	virtual Ref< render::IProgram > createProgram(const render::ProgramResource* programResource, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual void purge() override final {}
+
+	virtual void getStatistics(render::RenderSystemStatistics& outStatistics) const override final {}
+
+	virtual void* getInternalHandle() const override final { return nullptr; }
+};
+
+/*! Resource manager which doesn't load anything. */
+class NullResourceManager : public resource::IResourceManager
+{
+public:
+	virtual void destroy() override final {}
+
+	virtual void addFactory(const resource::IResourceFactory* factory) override final {}
+
+	virtual void removeFactory(const resource::IResourceFactory* factory) override final {}
+
+	virtual void removeAllFactories() override final {}
+
+	virtual bool load(const resource::ResourceBundle* bundle) override final { return false; }
+
+	virtual Ref< resource::ResourceBundleLoad > loadAsync(const resource::ResourceBundle* bundle) override final { return nullptr; }
+
+	virtual Ref< resource::ResourceHandle > bind(const TypeInfo& productType, const Guid& guid) override final { return nullptr; }
+
+	virtual bool reload(const Guid& guid, bool flushedOnly) override final { return false; }
+
+	virtual void reload(const TypeInfo& productType, bool flushedOnly) override final {}
+
+	virtual void unload(const TypeInfo& productType) override final {}
+
+	virtual void unloadUnusedResident() override final {}
+
+	virtual void getStatistics(resource::ResourceManagerStatistics& outStatistics) const override final {}
+};
+
+class WorldGather_Component : public IEntityComponent
+{
+	T_RTTI_CLASS;
+
+public:
+	virtual void destroy() override final {}
+
+	virtual void setOwner(Entity* owner) override final {}
+
+	virtual void setTransform(const Transform& transform) override final {}
+
+	virtual Aabb3 getBoundingBox() const override final { return Aabb3(); }
+
+	virtual void update(const UpdateParams& update) override final {}
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldGather_Component", WorldGather_Component, IEntityComponent)
+
+class WorldGather_RenderableA : public WorldGather_Component
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldGather_RenderableA", WorldGather_RenderableA, WorldGather_Component)
+
+class WorldGather_RenderableB : public WorldGather_Component
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldGather_RenderableB", WorldGather_RenderableB, WorldGather_Component)
+
+class WorldGather_Logic : public WorldGather_Component
+{
+	T_RTTI_CLASS;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldGather_Logic", WorldGather_Logic, WorldGather_Component)
+
+class WorldGather_Renderer : public IEntityRenderer
+{
+	T_RTTI_CLASS;
+
+public:
+	explicit WorldGather_Renderer(const TypeInfo& renderableType)
+	:	m_renderableType(renderableType)
+	{
+	}
+
+	virtual bool initialize(const ObjectStore& objectStore) override final { return true; }
+
+	virtual const TypeInfoSet getRenderableTypes() const override final { return makeTypeInfoSet(m_renderableType); }
+
+	virtual void setup(const WorldSetupContext& context, const WorldRenderView& worldRenderView, Object* renderable) override final {}
+
+	virtual void setup(const WorldSetupContext& context) override final {}
+
+	virtual void build(const WorldBuildContext& context, const WorldRenderView& worldRenderView, const IWorldRenderPass& worldRenderPass, Object* renderable) override final {}
+
+	virtual void build(const WorldBuildContext& context, const WorldRenderView& worldRenderView, const IWorldRenderPass& worldRenderPass) override final {}
+
+private:
+	const TypeInfo& m_renderableType;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldGather_Renderer", WorldGather_Renderer, IEntityRenderer)
+
+Ref< Entity > createEntity(int32_t index)
+{
+	RefArray< IEntityComponent > components;
+	if (index & 1)
+		components.push_back(new WorldGather_RenderableA());
+	else
+		components.push_back(new WorldGather_RenderableB());
+	components.push_back(new WorldGather_Logic());
+	return new Entity(Guid::create(), L"", Transform::identity(), EntityState::All, components);
+}
+
+/*! Check renderables are grouped in order of renderers. */
+bool groupedByRenderer(const GatherView& view, const WorldEntityRenderers* entityRenderers)
+{
+	const auto& renderers = entityRenderers->get();
+	size_t group = 0;
+	for (const auto& renderable : view.renderables)
+	{
+		while (group < renderers.size() && renderers[group] != renderable.renderer)
+			++group;
+		if (group >= renderers.size())
+			return false;
+	}
+	return true;
+}
+
+/*! Check both views contain same renderables, order within each renderer group is ignored. */
+bool sameRenderables(const GatherView& lh, const GatherView& rh)
+{
+	if (lh.renderables.size() != rh.renderables.size())
+		return false;
+
+	auto sorted = [](const GatherView& view) {
+		AlignedVector< std::pair< IEntityRenderer*, Object* > > renderables;
+		for (const auto& renderable : view.renderables)
+			renderables.push_back({ renderable.renderer, renderable.renderable });
+		std::sort(renderables.begin(), renderables.end());
+		return renderables;
+	};
+	return sorted(lh) == sorted(rh);
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.world.test.CaseWorldGather", 0, CaseWorldGather, traktor::test::Case)
+
+void CaseWorldGather::run()
+{
+	NullRenderSystem renderSystem;
+	NullResourceManager resourceManager;
+
+	Ref< WorldEntityRenderers > entityRenderers = new WorldEntityRenderers();
+	entityRenderers->add(new WorldGather_Renderer(type_of< WorldGather_RenderableA >()));
+	entityRenderers->add(new WorldGather_Renderer(type_of< WorldGather_RenderableB >()));
+
+	Ref< World > world = new World(&resourceManager, &renderSystem);
+
+	RefArray< Entity > entities;
+	for (int32_t i = 0; i < c_entityCount; ++i)
+	{
+		Ref< Entity > entity = createEntity(i);
+		world->addEntity(entity);
+		entities.push_back(entity);
+	}
+
+	WorldGather gather;
+	GatherView view;
+
+	// First gather build list of renderables.
+	Timer timer;
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	const double firstTime = timer.getElapsedTime();
+
+	CASE_ASSERT_EQUAL(gather.getRebuildCount(), 1u);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount);
+	CASE_ASSERT(groupedByRenderer(view, entityRenderers));
+
+	// Unchanged world reuse previous list.
+	timer.reset();
+	for (int32_t i = 0; i < c_frameCount; ++i)
+		gather.gather(world, entityRenderers, nullptr, false, view);
+	const double cachedTime = timer.getElapsedTime();
+
+	CASE_ASSERT_EQUAL(gather.getRebuildCount(), 1u);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount);
+
+	// Same number of frames but with world being changed each frame.
+	timer.reset();
+	for (int32_t i = 0; i < c_frameCount; ++i)
+	{
+		entities[i]->setVisible(false);
+		gather.gather(world, entityRenderers, nullptr, false, view);
+		entities[i]->setVisible(true);
+	}
+	const double changedTime = timer.getElapsedTime();
+
+	CASE_ASSERT_EQUAL(gather.getRebuildCount(), 1u);
+	CASE_ASSERT_EQUAL(gather.getPatchCount(), (uint32_t)c_frameCount);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount - 1);
+
+	// Visibility, adding and removing entities and components patch list.
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount);
+
+	Ref< Entity > entity = createEntity(0);
+	world->addEntity(entity);
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount + 1);
+
+	entity->setComponent(new WorldGather_RenderableA());
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount + 2);
+	CASE_ASSERT(groupedByRenderer(view, entityRenderers));
+
+	world->removeEntity(entity);
+	entity->destroy();
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount);
+	CASE_ASSERT_EQUAL(gather.getRebuildCount(), 1u);
+
+	// Patched list must contain same renderables as a rebuilt list.
+	for (int32_t i = 0; i < 1000; ++i)
+		entities[(i * 7919) % c_entityCount]->setVisible((i % 3) == 0);
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT(groupedByRenderer(view, entityRenderers));
+	{
+		WorldGather rebuildGather;
+		GatherView rebuildView;
+		rebuildGather.gather(world, entityRenderers, nullptr, false, rebuildView);
+		CASE_ASSERT(sameRenderables(view, rebuildView));
+	}
+	for (int32_t i = 0; i < 1000; ++i)
+		entities[(i * 7919) % c_entityCount]->setVisible(true);
+
+	// Changing world components rebuild list.
+	world->setComponent(new IrradianceGridComponent());
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT_EQUAL(gather.getRebuildCount(), 2u);
+
+	// Filtered gather always rebuild.
+	const uint32_t rebuildCount = gather.getRebuildCount();
+	gather.gather(world, entityRenderers, [](const EntityState& state) { return false; }, false, view);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), 0);
+	gather.gather(world, entityRenderers, nullptr, false, view);
+	CASE_ASSERT_EQUAL((int32_t)view.renderables.size(), c_entityCount);
+	CASE_ASSERT_EQUAL(gather.getRebuildCount(), rebuildCount + 2);
+
+	log::info << c_entityCount * 2 << L" components; first gather " << int32_t(firstTime * 1000000.0) << L" us, " << c_frameCount << L" unchanged frames " << int32_t(cachedTime * 1000000.0) << L" us, " << c_frameCount << L" changed frames " << int32_t(changedTime * 1000000.0) << L" us." << Endl;
+
+	world->destroy();
+	world = nullptr;
+}
+
+}
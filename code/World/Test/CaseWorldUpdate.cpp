@@ -0,0 +1,308 @@
+/*
+ * TRAKTOR
+ * Copyright (c) 2024 Anders Pistol.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include <algorithm>
+#include "Core/Guid.h"
+#include "Core/Math/Aabb3.h"
+#include "Core/Math/Transform.h"
+#include "Render/IRenderSystem.h"
+#include "Resource/IResourceManager.h"
+#include "Resource/ResourceBundleLoad.h"
+#include "Resource/ResourceHandle.h"
+#include "World/Entity.h"
+#include "World/IEntityComponent.h"
+#include "World/World.h"
+#include "World/WorldTypes.h"
+#include "World/Test/CaseWorldUpdate.h"
+
+namespace traktor::world::test
+{
+	namespace
+	{
+
+const int32_t c_entityCount = 4000;
+const int32_t c_frameCount = 20;
+
+/*! Render system which doesn't create anything. */
+class NullRenderSystem : public render::IRenderSystem
+{
+public:
+	virtual bool create(const render::RenderSystemDesc& desc) override final { return true; }
+
+	virtual void destroy() override final {}
+
+	virtual bool reset(const render::RenderSystemDesc& desc) override final { return true; }
+
+	virtual void getInformation(render::RenderSystemInformation& outInfo) const override final {}
+
+	virtual bool supportRayTracing() const override final { return false; }
+
+	virtual uint32_t getDisplayCount() const override final { return 0; }
+
+	virtual uint32_t getDisplayModeCount(uint32_t display) const override final { return 0; }
+
+	virtual render::DisplayMode getDisplayMode(uint32_t display, uint32_t index) const override final { return render::DisplayMode(); }
+
+	virtual render::DisplayMode getCurrentDisplayMode(uint32_t display) const override final { return render::DisplayMode(); }
+
+	virtual float getDisplayAspectRatio(uint32_t display) const override final { return 1.0f; }
+
+	virtual Ref< render::IRenderView > createRenderView(const render::RenderViewDefaultDesc& desc) override final { return nullptr; }
+
+	virtual Ref< render::IRenderView > createRenderView(const render::RenderViewEmbeddedDesc& desc) override final { return nullptr; }
+
+	virtual Ref< render::Buffer > createBuffer(uint32_t usage, uint32_t bufferSize, bool dynamic) override final { return nullptr; }
+
+	virtual Ref< const render::IVertexLayout > createVertexLayout(const AlignedVector< render::VertexElement >& vertexElements) override final { return nullptr; }
+
+	virtual Ref< render::ITexture > createSimpleTexture(const render::SimpleTextureCreateDesc& desc, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::ITexture > createCubeTexture(const render::CubeTextureCreateDesc& desc, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::ITexture > createVolumeTexture(const render::VolumeTextureCreateDesc& desc, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::IRenderTargetSet > createRenderTargetSet(const render::RenderTargetSetCreateDesc& desc, render::IRenderTargetSet* sharedDepthStencil, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual Ref< render::IAccelerationStructure > createTopLevelAccelerationStructure(uint32_t numInstances) override final { return nullptr; }
+
+	virtual Ref< render::IAccelerationStructure > createAccelerationStructure(const render::Buffer* vertexBuffer, const render::IVertexLayout* vertexLayout, const render::Buffer* indexBuffer, render::IndexType indexType, const AlignedVector< render::Primitives >& primitives) override final { return nullptr; }
+
+	virtual Ref< render::IProgram > createProgram(const render::ProgramResource* programResource, const wchar_t* const tag) override final { return nullptr; }
+
+	virtual void purge() override final {}
+
+	virtual void getStatistics(render::RenderSystemStatistics& outStatistics) const override final {}
+
+	virtual void* getInternalHandle() const override final { return nullptr; }
+};
+
+/*! Resource manager which doesn't load anything. */
+class NullResourceManager : public resource::IResourceManager
+{
+public:
+	virtual void destroy() override final {}
+
+	virtual void addFactory(const resource::IResourceFactory* factory) override final {}
+
+	virtual void removeFactory(const resource::IResourceFactory* factory) override final {}
+
+	virtual void removeAllFactories() override final {}
+
+	virtual bool load(const resource::ResourceBundle* bundle) override final { return false; }
+
+	virtual Ref< resource::ResourceBundleLoad > loadAsync(const resource::ResourceBundle* bundle) override final { return nullptr; }
+
+	virtual Ref< resource::ResourceHandle > bind(const TypeInfo& productType, const Guid& guid) override final { return nullptr; }
+
+	virtual bool reload(const Guid& guid, bool flushedOnly) override final { return false; }
+
+	virtual void reload(const TypeInfo& productType, bool flushedOnly) override final {}
+
+	virtual void unload(const TypeInfo& productType) override final {}
+
+	virtual void unloadUnusedResident() override final {}
+
+	virtual void getStatistics(resource::ResourceManagerStatistics& outStatistics) const override final {}
+};
+
+class WorldUpdate_Component : public IEntityComponent
+{
+	T_RTTI_CLASS;
+
+public:
+	int32_t m_value = 0;
+
+	virtual void destroy() override {}
+
+	virtual void setOwner(Entity* owner) override { m_owner = owner; }
+
+	virtual void setTransform(const Transform& transform) override {}
+
+	virtual Aabb3 getBoundingBox() const override { return Aabb3(); }
+
+protected:
+	Entity* m_owner = nullptr;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldUpdate_Component", WorldUpdate_Component, IEntityComponent)
+
+/*! Move owner entity; parallel. */
+class WorldUpdate_Motion : public WorldUpdate_Component
+{
+	T_RTTI_CLASS;
+
+public:
+	explicit WorldUpdate_Motion(int32_t value)
+	{
+		m_value = value;
+	}
+
+	virtual void update(const UpdateParams& update) override final
+	{
+		m_value = (m_value * 7 + 3) % 1000;
+		m_owner->setTransform(Transform(Vector4(float(m_value % 50), 0.0f, float(m_value / 50), 1.0f)));
+	}
+
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const override final
+	{
+		outWrites.insert(&type_of< Entity >());
+		return true;
+	}
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldUpdate_Motion", WorldUpdate_Motion, WorldUpdate_Component)
+
+/*! Accumulate motion of owner entity; parallel, after motion. */
+class WorldUpdate_Accumulate : public WorldUpdate_Component
+{
+	T_RTTI_CLASS;
+
+public:
+	virtual void update(const UpdateParams& update) override final
+	{
+		m_value = (m_value + m_owner->getComponent< WorldUpdate_Motion >()->m_value) % 100000;
+	}
+
+	virtual bool getUpdateAccess(TypeInfoSet& outReads, TypeInfoSet& outWrites) const override final
+	{
+		outReads.insert(&type_of< WorldUpdate_Motion >());
+		return true;
+	}
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldUpdate_Accumulate", WorldUpdate_Accumulate, WorldUpdate_Component)
+
+Ref< Entity > createEntity(int32_t index, int32_t* spawnCount);
+
+/*! Spawn new entities and remove owner during update; serial. */
+class WorldUpdate_Spawner : public WorldUpdate_Component
+{
+	T_RTTI_CLASS;
+
+public:
+	explicit WorldUpdate_Spawner(int32_t index, int32_t* spawnCount)
+	:	m_index(index)
+	,	m_spawnCount(spawnCount)
+	{
+	}
+
+	virtual void setWorld(World* world) override final { m_world = world; }
+
+	virtual void update(const UpdateParams& update) override final
+	{
+		const int32_t frame = m_value++;
+		if (m_index % 13 == frame % 13)
+			m_world->addEntity(createEntity(c_entityCount + (*m_spawnCount)++, m_spawnCount));
+		if (m_index % 17 == 0 && frame == m_index % 5)
+			m_world->removeEntity(m_owner);
+	}
+
+private:
+	World* m_world = nullptr;
+	int32_t m_index;
+	int32_t* m_spawnCount;
+};
+
+T_IMPLEMENT_RTTI_CLASS(L"traktor.world.test.WorldUpdate_Spawner", WorldUpdate_Spawner, WorldUpdate_Component)
+
+Ref< Entity > createEntity(int32_t index, int32_t* spawnCount)
+{
+	RefArray< IEntityComponent > components;
+	components.push_back(new WorldUpdate_Motion(index));
+	components.push_back(new WorldUpdate_Accumulate());
+	if (index < c_entityCount)
+		components.push_back(new WorldUpdate_Spawner(index, spawnCount));
+	return new Entity(Guid(), L"", Transform::identity(), EntityState::All, components);
+}
+
+bool sameEntity(Entity* a, Entity* b)
+{
+	const Vector4 ta = a->getTransform().translation();
+	const Vector4 tb = b->getTransform().translation();
+	if (ta.x() != tb.x() || ta.y() != tb.y() || ta.z() != tb.z())
+		return false;
+
+	const RefArray< IEntityComponent >& ca = a->getComponents();
+	const RefArray< IEntityComponent >& cb = b->getComponents();
+	if (ca.size() != cb.size())
+		return false;
+
+	for (uint32_t i = 0; i < ca.size(); ++i)
+	{
+		if (static_cast< WorldUpdate_Component* >(ca[i])->m_value != static_cast< WorldUpdate_Component* >(cb[i])->m_value)
+			return false;
+	}
+
+	return true;
+}
+
+	}
+
+T_IMPLEMENT_RTTI_FACTORY_CLASS(L"traktor.world.test.CaseWorldUpdate", 0, CaseWorldUpdate, traktor::test::Case)
+
+void CaseWorldUpdate::run()
+{
+	NullRenderSystem renderSystem;
+	NullResourceManager resourceManager;
+
+	// Build two equal worlds, one updated serially and one in phases.
+	Ref< World > worlds[2];
+	int32_t spawnCounts[2] = { 0, 0 };
+	for (int32_t i = 0; i < 2; ++i)
+	{
+		worlds[i] = new World(&resourceManager, &renderSystem);
+		worlds[i]->setParallelUpdate(i == 1);
+		for (int32_t j = 0; j < c_entityCount; ++j)
+			worlds[i]->addEntity(createEntity(j, &spawnCounts[i]));
+	}
+
+	UpdateParams update;
+	for (int32_t frame = 0; frame < c_frameCount; ++frame)
+	{
+		update.totalTime = frame / 60.0;
+		update.deltaTime = 1.0 / 60.0;
+		for (int32_t i = 0; i < 2; ++i)
+			worlds[i]->update(update);
+	}
+
+	// Deferred add and remove has been applied in both worlds.
+	const RefArray< Entity >& serialEntities = worlds[0]->getEntities();
+	const RefArray< Entity >& phasedEntities = worlds[1]->getEntities();
+
+	CASE_ASSERT_EQUAL(spawnCounts[0], spawnCounts[1]);
+	CASE_ASSERT(spawnCounts[1] > 0);
+	CASE_ASSERT((int32_t)phasedEntities.size() < c_entityCount + spawnCounts[1]);
+	CASE_ASSERT_EQUAL(serialEntities.size(), phasedEntities.size());
+	if (serialEntities.size() != phasedEntities.size())
+		return;
+
+	// Phased update produce same state as serial update.
+	bool allSame = true;
+	for (uint32_t i = 0; i < serialEntities.size(); ++i)
+		allSame &= sameEntity(serialEntities[i], phasedEntities[i]);
+	CASE_ASSERT(allSame);
+
+	// Entities moved concurrently are all found at their new position.
+	AlignedVector< Entity* > found;
+	bool allFound = true;
+	for (auto entity : phasedEntities)
+	{
+		const Vector4 p = entity->getTransform().translation().xyz1();
+		worlds[1]->getEntitiesWithinBox(Aabb3(p - Vector4(0.1f, 0.1f, 0.1f, 0.0f), p + Vector4(0.1f, 0.1f, 0.1f, 0.0f)), found);
+		allFound &= (std::find(found.begin(), found.end(), entity) != found.end());
+	}
+	CASE_ASSERT(allFound);
+
+	const Aabb3 box(Vector4(0.0f, -1.0f, 0.0f, 1.0f), Vector4(20.0f, 1.0f, 10.0f, 1.0f));
+	CASE_ASSERT_EQUAL(worlds[0]->getEntitiesWithinBox(box, found), worlds[1]->getEntitiesWithinBox(box, found));
+
+	for (int32_t i = 0; i < 2; ++i)
+		worlds[i]->destroy();
+}
+
+}
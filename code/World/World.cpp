@@ -6,8 +6,15 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
+#include <algorithm>
+#include <cstring>
+#include "Core/Math/Frustum.h"
+#include "Core/Thread/Acquire.h"
+#include "Core/Thread/Atomic.h"
+#include "Core/Thread/JobManager.h"
 #include "Render/IRenderSystem.h"
 #include "World/Entity.h"
+#include "World/IEntityComponent.h"
 #include "World/IWorldComponent.h"
 #include "World/World.h"
 #include "World/Entity/CullingComponent.h"
@@ -17,11 +24,39 @@
 
 namespace traktor::world
 {
+	namespace
+	{
+
+const uint32_t c_maxChanges = 4096;	//!< Number of changes kept, oldest half are discarded when exceeded.
+int32_t s_revision = 0;
+
+/*! Bounding box of entity in world space, always containing entity position. */
+Aabb3 worldBounds(const Entity* entity)
+{
+	const Transform transform = entity->getTransform();
+	const Aabb3 boundingBox = entity->getBoundingBox();
+
+	Aabb3 bounds(transform.translation().xyz1(), transform.translation().xyz1());
+	if (!boundingBox.empty())
+		bounds.contain(boundingBox.transform(transform));
+	return bounds;
+}
+
+template < typename ArrayType >
+void removeFirst(ArrayType& arr, const Entity* entity)
+{
+	const auto it = std::find(arr.begin(), arr.end(), entity);
+	if (it != arr.end())
+		arr.erase(it);
+}
+
+	}
 
 T_IMPLEMENT_RTTI_CLASS(L"traktor.world.World", World, Object)
 
 World::World(resource::IResourceManager* resourceManager, render::IRenderSystem* renderSystem)
 {
+	changed(nullptr);
 	setComponent(new CullingComponent(resourceManager, renderSystem));
 	setComponent(new EventManagerComponent(512));
 	setComponent(new IrradianceGridComponent());
@@ -36,10 +71,17 @@ void World::destroy()
 
 	for (auto entity : m_entities)
 	{
+		entity->m_worldProxy = -1;
+		entity->m_worldDirty = false;
 		entity->setWorld(nullptr);
 		entity->destroy();
 	}
 	m_entities.clear();
+	m_entitiesById.clear();
+	m_entitiesByName.clear();
+	m_entityTree.clear();
+	m_movedEntities.clear();
+	m_changes.clear();
 
 	for (auto component : m_components)
 		component->destroy();
@@ -56,12 +98,14 @@ void World::setComponent(IWorldComponent* component)
 		if (is_type_of(type_of(comp), type_of(component)))
 		{
 			comp = component;
+			changed(nullptr);
 			return;
 		}
 	}
 
 	// No such component, add last.
 	m_components.push_back(component);
+	changed(nullptr);
 }
 
 IWorldComponent* World::getComponent(const TypeInfo& componentType) const
@@ -78,9 +122,15 @@ void World::addEntity(Entity* entity)
 {
 	T_FATAL_ASSERT(entity->getWorld() == nullptr);
 	if (m_update)
+	{
+		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
 		m_deferredAdd.push_back(entity);
+	}
 	else
+	{
 		m_entities.push_back(entity);
+		insertIndices(entity);
+	}
 	entity->setWorld(this);
 }
 
@@ -91,52 +141,64 @@ void World::removeEntity(Entity* entity)
 
 	T_FATAL_ASSERT(entity->getWorld() == this);
 	if (m_update)
+	{
+		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
 		m_deferredRemove.push_back(entity);
+	}
 	else
 	{
 		const bool removed = m_entities.remove(entity);
 		T_FATAL_ASSERT(removed);
+		removeIndices(entity);
 	}
 	entity->setWorld(nullptr);
 }
 
 bool World::haveEntity(const Entity* entity) const
 {
-	if (entity->getWorld() == this)
-		return std::find(m_entities.begin(), m_entities.end(), entity) != m_entities.end();
-	else
-		return false;
+	return entity->getWorld() == this && entity->m_worldProxy >= 0;
 }
 
 Entity* World::getEntity(const Guid& id) const
 {
-	for (auto entity : m_entities)
+	// Null ids are not indexed.
+	if (id.isNull())
 	{
-		if (entity->getId() == id)
-			return entity;
+		for (auto entity : m_entities)
+		{
+			if (entity->getId() == id)
+				return entity;
+		}
+		return nullptr;
 	}
-	return nullptr;
+
+	const auto it = m_entitiesById.find(id);
+	return it != m_entitiesById.end() ? it->second.front() : nullptr;
 }
 
 Entity* World::getEntity(const std::wstring& name, int32_t index) const
 {
-	for (auto entity : m_entities)
-	{
-		if (entity->getName() == name)
-		{
-			if (index-- <= 0)
-				return entity;
-		}
-	}
-	return nullptr;
+	const auto it = m_entitiesByName.find(name);
+	if (it == m_entitiesByName.end())
+		return nullptr;
+
+	const auto& entities = it->second;
+	if (index <= 0)
+		return entities.front();
+	else if (index < (int32_t)entities.size())
+		return entities[index];
+	else
+		return nullptr;
 }
 
 RefArray< Entity > World::getEntities(const std::wstring& name) const
 {
 	RefArray< Entity > entities;
-	for (auto entity : m_entities)
+	const auto it = m_entitiesByName.find(name);
+	if (it != m_entitiesByName.end())
 	{
-		if (entity->getName() == name)
+		entities.reserve(it->second.size());
+		for (auto entity : it->second)
 			entities.push_back(entity);
 	}
 	return entities;
@@ -144,16 +206,51 @@ RefArray< Entity > World::getEntities(const std::wstring& name) const
 
 RefArray< Entity > World::getEntitiesWithinRange(const Vector4& position, float range) const
 {
+	AlignedVector< Entity* > entitiesWithinRange;
+	getEntitiesWithinRange(position, range, entitiesWithinRange);
+
 	RefArray< Entity > entities;
-	for (auto entity : m_entities)
-	{
-		const Scalar distance = (entity->getTransform().translation() - position).xyz0().length();
-		if (distance <= range)
-			entities.push_back(entity);
-	}
+	entities.reserve(entitiesWithinRange.size());
+	for (auto entity : entitiesWithinRange)
+		entities.push_back(entity);
 	return entities;
 }
 
+uint32_t World::getEntitiesWithinRange(const Vector4& position, float range, AlignedVector< Entity* >& outEntities) const
+{
+	updateEntityTree();
+
+	const Vector4 extent(range, range, range, 0.0f);
+	outEntities.resize(0);
+	m_entityTree.queryBox(Aabb3(position - extent, position + extent), outEntities);
+
+	// Tree bounds contain entity position; refine by distance to position.
+	const Scalar range2(range * range);
+	auto it = std::remove_if(outEntities.begin(), outEntities.end(), [&](const Entity* entity) {
+		const Vector4 d = (entity->getTransform().translation() - position).xyz0();
+		return dot3(d, d) > range2;
+	});
+	outEntities.erase(it, outEntities.end());
+
+	return (uint32_t)outEntities.size();
+}
+
+uint32_t World::getEntitiesWithinBox(const Aabb3& box, AlignedVector< Entity* >& outEntities) const
+{
+	updateEntityTree();
+	outEntities.resize(0);
+	m_entityTree.queryBox(box, outEntities);
+	return (uint32_t)outEntities.size();
+}
+
+uint32_t World::getEntitiesWithinFrustum(const Frustum& frustum, AlignedVector< Entity* >& outEntities) const
+{
+	updateEntityTree();
+	outEntities.resize(0);
+	m_entityTree.queryFrustum(frustum, outEntities);
+	return (uint32_t)outEntities.size();
+}
+
 void World::update(const UpdateParams& update)
 {
 	// Update all world components.
@@ -162,17 +259,18 @@ void World::update(const UpdateParams& update)
 
 	// Update all entities.
 	m_update = true;
-	for (auto entity : m_entities)
-	{
-		if (entity->getWorld() != nullptr)
-			entity->update(update);
-	}
+	if (m_parallelUpdate)
+		updatePhased(update);
+	else
+		updateSerial(update);
 	m_update = false;
 	
 	// Add entities which has been added during entity update.
 	if (!m_deferredAdd.empty())
 	{
 		m_entities.insert(m_entities.end(), m_deferredAdd.begin(), m_deferredAdd.end());
+		for (auto entity : m_deferredAdd)
+			insertIndices(entity);
 		m_deferredAdd.resize(0);
 	}
 
@@ -183,9 +281,286 @@ void World::update(const UpdateParams& update)
 		{
 			const bool removed = m_entities.remove(entity);
 			T_FATAL_ASSERT(removed);
+			removeIndices(entity);
 		}
 		m_deferredRemove.resize(0);
 	}
 }
 
+size_t World::GuidHash::operator () (const Guid& guid) const
+{
+	// Guids are random enough; fold into a single word.
+	uint64_t h[2];
+	std::memcpy(h, (const uint8_t*)guid, sizeof(h));
+	return (size_t)(h[0] ^ h[1]);
+}
+
+void World::insertIndices(Entity* entity)
+{
+	changed(entity);
+	T_FATAL_ASSERT(entity->m_worldProxy < 0);
+
+	if (!entity->getId().isNull())
+		m_entitiesById[entity->getId()].push_back(entity);
+
+	m_entitiesByName[entity->getName()].push_back(entity);
+
+	entity->m_worldProxy = m_entityTree.insert(entity, worldBounds(entity));
+	entity->m_worldDirty = false;
+}
+
+void World::removeIndices(Entity* entity)
+{
+	changed(entity);
+	T_FATAL_ASSERT(entity->m_worldProxy >= 0);
+
+	if (!entity->getId().isNull())
+	{
+		auto it = m_entitiesById.find(entity->getId());
+		removeFirst(it->second, entity);
+		if (it->second.empty())
+			m_entitiesById.erase(it);
+	}
+
+	auto it = m_entitiesByName.find(entity->getName());
+	removeFirst(it->second, entity);
+	if (it->second.empty())
+		m_entitiesByName.erase(it);
+
+	m_entityTree.remove(entity->m_worldProxy);
+	entity->m_worldProxy = -1;
+
+	if (entity->m_worldDirty)
+	{
+		removeFirst(m_movedEntities, entity);
+		entity->m_worldDirty = false;
+	}
+}
+
+void World::entityMoved(Entity* entity)
+{
+	if (entity->m_worldProxy >= 0 && !entity->m_worldDirty)
+	{
+		// Entities can be moved concurrently by parallel component updates;
+		// check dirty again as another thread might have added entity.
+		T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
+		if (!entity->m_worldDirty)
+		{
+			entity->m_worldDirty = true;
+			m_movedEntities.push_back(entity);
+		}
+	}
+}
+
+bool World::getChangedEntities(uint32_t sinceRevision, RefArray< Entity >& outEntities) const
+{
+	T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
+
+	outEntities.resize(0);
+	if (sinceRevision < m_changesRevision)
+		return false;
+
+	// Changes are in order of revision; find first change after revision.
+	auto it = std::upper_bound(m_changes.begin(), m_changes.end(), sinceRevision, [](uint32_t revision, const Change& change) {
+		return revision < change.revision;
+	});
+	for (; it != m_changes.end(); ++it)
+		outEntities.push_back(it->entity);
+
+	return true;
+}
+
+void World::changed(Entity* entity)
+{
+	// Entity state can be changed concurrently by parallel component updates.
+	T_ANONYMOUS_VAR(Acquire< SpinLock >)(m_lock);
+
+	// Use a global counter so revisions are unique also across worlds.
+	m_revision = Atomic::increment(s_revision);
+
+	// Change of world components affect everything, no need to track entities.
+	if (!entity)
+	{
+		m_changes.resize(0);
+		m_changesRevision = (uint32_t)m_revision;
+		return;
+	}
+
+	if (m_changes.size() >= c_maxChanges)
+	{
+		m_changesRevision = m_changes[c_maxChanges / 2 - 1].revision;
+		m_changes.erase(m_changes.begin(), m_changes.begin() + c_maxChanges / 2);
+	}
+	m_changes.push_back({ (uint32_t)m_revision, entity });
+}
+
+void World::updateEntityTree() const
+{
+	for (auto entity : m_movedEntities)
+	{
+		m_entityTree.move(entity->m_worldProxy, worldBounds(entity));
+		entity->m_worldDirty = false;
+	}
+	m_movedEntities.resize(0);
+}
+
+void World::updateSerial(const UpdateParams& update)
+{
+	for (auto entity : m_entities)
+	{
+		if (entity->getWorld() != nullptr)
+			entity->update(update);
+	}
+}
+
+void World::updatePhased(const UpdateParams& update)
+{
+	// Gather component types, in order of first appearance, and
+	// rebuild phases only if set of types has changed.
+	AlignedVector< const TypeInfo* > updateTypes;
+	SmallMap< const TypeInfo*, int32_t > updateTypeIndices;
+
+	m_updateComponentPhases.resize(0);
+	for (auto entity : m_entities)
+	{
+		for (auto component : entity->getComponents())
+		{
+			const TypeInfo* componentType = &type_of(component);
+
+			auto it = updateTypeIndices.find(componentType);
+			if (it == updateTypeIndices.end())
+			{
+				if (m_updateAccess.find(componentType) == m_updateAccess.end())
+				{
+					UpdateAccess& access = m_updateAccess[componentType];
+					access.parallel = component->getUpdateAccess(access.reads, access.writes);
+					access.writes.insert(componentType);
+				}
+
+				m_updateComponentPhases.push_back((int32_t)updateTypes.size());
+				updateTypeIndices.insert(componentType, (int32_t)updateTypes.size());
+				updateTypes.push_back(componentType);
+			}
+			else
+				m_updateComponentPhases.push_back(it->second);
+		}
+	}
+
+	if (updateTypes != m_updateTypes)
+	{
+		m_updateTypes.swap(updateTypes);
+		buildUpdatePhases();
+	}
+
+	for (auto& componentPhase : m_updateComponentPhases)
+		componentPhase = m_updateTypePhases[componentPhase];
+
+	// Group components by phase; each span contain components of a single entity.
+	m_updateItems.resize(0);
+	m_updateSpans.resize(0);
+	for (int32_t phase = 0; phase < (int32_t)m_updatePhases.size(); ++phase)
+	{
+		UpdatePhase& updatePhase = m_updatePhases[phase];
+		updatePhase.spanOffset = (uint32_t)m_updateSpans.size();
+
+		uint32_t componentIndex = 0;
+		for (auto entity : m_entities)
+		{
+			const uint32_t offset = (uint32_t)m_updateItems.size();
+			for (auto component : entity->getComponents())
+			{
+				if (m_updateComponentPhases[componentIndex++] == phase)
+					m_updateItems.push_back({ entity, component });
+			}
+
+			const uint32_t count = (uint32_t)m_updateItems.size() - offset;
+			if (count > 0)
+				m_updateSpans.push_back({ offset, count });
+		}
+
+		updatePhase.spanCount = (uint32_t)m_updateSpans.size() - updatePhase.spanOffset;
+	}
+
+	// Update phases in order.
+	for (const auto& updatePhase : m_updatePhases)
+	{
+		auto updateSpans = [&](int32_t from, int32_t to) {
+			for (int32_t i = from; i < to; ++i)
+			{
+				const UpdateSpan& span = m_updateSpans[updatePhase.spanOffset + i];
+				Entity* entity = m_updateItems[span.offset].entity;
+				if (entity->getWorld() == nullptr)
+					continue;
+
+				for (uint32_t j = 0; j < span.count; ++j)
+					entity->updateComponent(m_updateItems[span.offset + j].component, update);
+			}
+		};
+
+		if (updatePhase.parallel)
+			JobManager::getInstance().parallelFor((int32_t)updatePhase.spanCount, 32, updateSpans);
+		else
+			updateSpans(0, (int32_t)updatePhase.spanCount);
+	}
+
+	// Release component references.
+	m_updateItems.resize(0);
+}
+
+void World::buildUpdatePhases()
+{
+	auto overlap = [](const TypeInfoSet& a, const TypeInfoSet& b) {
+		for (auto ta : a)
+		{
+			for (auto tb : b)
+			{
+				if (is_type_of(*ta, *tb) || is_type_of(*tb, *ta))
+					return true;
+			}
+		}
+		return false;
+	};
+
+	const int32_t typeCount = (int32_t)m_updateTypes.size();
+	m_updateTypePhases.resize(typeCount);
+	m_updatePhases.resize(0);
+
+	for (int32_t i = 0; i < typeCount; ++i)
+	{
+		const UpdateAccess& access = m_updateAccess[m_updateTypes[i]];
+		const int32_t phaseCount = (int32_t)m_updatePhases.size();
+
+		int32_t phase = 0;
+		if (!access.parallel)
+		{
+			// Serial components are barriers; consecutive serial components share phase
+			// so they are updated in order of entities as with serial update.
+			if (i > 0 && !m_updatePhases.back().parallel && m_updateTypePhases[i - 1] == phaseCount - 1)
+				phase = phaseCount - 1;
+			else
+				phase = phaseCount;
+		}
+		else
+		{
+			// Place after all earlier serial components and components
+			// with conflicting access.
+			for (int32_t j = 0; j < i; ++j)
+			{
+				const UpdateAccess& earlier = m_updateAccess[m_updateTypes[j]];
+				if (
+					!earlier.parallel ||
+					overlap(earlier.writes, access.reads) ||
+					overlap(earlier.writes, access.writes) ||
+					overlap(access.writes, earlier.reads)
+				)
+					phase = std::max(phase, m_updateTypePhases[j] + 1);
+			}
+		}
+
+		m_updateTypePhases[i] = phase;
+		if (phase >= phaseCount)
+			m_updatePhases.push_back({ access.parallel, 0, 0 });
+	}
+}
+
 }
@@ -8,10 +8,17 @@
  */
 #pragma once
 
+#include <string>
+#include <unordered_map>
 #include "Core/Guid.h"
 #include "Core/Object.h"
+#include "Core/Ref.h"
 #include "Core/RefArray.h"
+#include "Core/Containers/AlignedVector.h"
+#include "Core/Containers/SmallMap.h"
 #include "Core/Math/Vector4.h"
+#include "Core/Thread/SpinLock.h"
+#include "World/EntityTree.h"
 
 // import/export mechanism.
 #undef T_DLLCLASS
@@ -21,6 +28,13 @@
 #	define T_DLLCLASS T_DLLIMPORT
 #endif
 
+namespace traktor
+{
+
+class Frustum;
+
+}
+
 namespace traktor::resource
 {
 
@@ -39,6 +53,7 @@ namespace traktor::world
 {
 
 class Entity;
+class IEntityComponent;
 class IWorldComponent;
 struct UpdateParams;
 
@@ -46,6 +61,20 @@ struct UpdateParams;
  * 
  * The world is a container of all entities representing a world.
  * 
+ * Entities are indexed by id and name, and kept in a spatial
+ * tree by their world space bounding box. The tree is updated
+ * lazily, entities which have moved are refreshed on next query.
+ * 
+ * Entity components are updated in phases; components which
+ * declare their access are updated in parallel, other components
+ * are updated serially in order of entities.
+ *
+ * \note Components of an entity are updated in order of phases,
+ * not in order they were added to the entity, thus the order can
+ * differ from serial update. Conflicting component types are
+ * ordered by first appearance in the world; components which
+ * depend on update order within an entity must not declare access.
+ * 
  * \ingroup World
  */
 class T_DLLCLASS World : public Object
@@ -111,18 +140,144 @@ public:
 	/*! Get all entities within distance. */
 	RefArray< Entity > getEntitiesWithinRange(const Vector4& position, float range) const;
 
+	/*! Get all entities within distance.
+	 *
+	 * \param position Position in world space.
+	 * \param range Maximum distance from position to entity.
+	 * \param outEntities Entities within distance, array is cleared first.
+	 * \return Number of entities.
+	 */
+	uint32_t getEntitiesWithinRange(const Vector4& position, float range, AlignedVector< Entity* >& outEntities) const;
+
+	/*! Get all entities which bounding box overlap box.
+	 *
+	 * \param box Bounding box in world space.
+	 * \param outEntities Entities overlapping box, array is cleared first.
+	 * \return Number of entities.
+	 */
+	uint32_t getEntitiesWithinBox(const Aabb3& box, AlignedVector< Entity* >& outEntities) const;
+
+	/*! Get all entities which bounding box are partially or fully inside frustum.
+	 *
+	 * \param frustum Frustum in world space.
+	 * \param outEntities Entities inside frustum, array is cleared first.
+	 * \return Number of entities.
+	 */
+	uint32_t getEntitiesWithinFrustum(const Frustum& frustum, AlignedVector< Entity* >& outEntities) const;
+
 	/*! Update all entities in this world. */
 	void update(const UpdateParams& update);
 
+	/*! Enable parallel update of entity components.
+	 *
+	 * When disabled all components of each entity are updated
+	 * in order on calling thread, useful for debugging.
+	 */
+	void setParallelUpdate(bool parallelUpdate) { m_parallelUpdate = parallelUpdate; }
+
+	/*! Check if entity components are updated in parallel. */
+	bool getParallelUpdate() const { return m_parallelUpdate; }
+
 	/*! Get all entities of this world. */
 	const RefArray< Entity >& getEntities() const { return m_entities; }
 
+	/*! Get revision of world.
+	 *
+	 * Revision changes each time components or entities are added
+	 * or removed, or when state of an entity changes. Revisions are
+	 * unique across all worlds.
+	 */
+	uint32_t getRevision() const { return (uint32_t)m_revision; }
+
+	/*! Get entities which has changed since revision.
+	 *
+	 * Entities are reported once for each change, in order of change,
+	 * which might also be entities no longer part of this world.
+	 *
+	 * \param sinceRevision Revision from which changes are returned.
+	 * \param outEntities Changed entities, array is cleared first.
+	 * \return False if changes are no longer known, or world components has changed; everything must be considered changed.
+	 */
+	bool getChangedEntities(uint32_t sinceRevision, RefArray< Entity >& outEntities) const;
+
 private:
+	friend class Entity;
+
+	struct GuidHash
+	{
+		size_t operator () (const Guid& guid) const;
+	};
+
+	struct UpdateAccess
+	{
+		bool parallel = false;
+		TypeInfoSet reads;
+		TypeInfoSet writes;
+	};
+
+	struct UpdatePhase
+	{
+		bool parallel;
+		uint32_t spanOffset;
+		uint32_t spanCount;
+	};
+
+	struct UpdateItem
+	{
+		Entity* entity;
+		Ref< IEntityComponent > component;	//!< Referenced as components can be replaced by earlier phases.
+	};
+
+	struct UpdateSpan
+	{
+		uint32_t offset;	//!< First item of entity.
+		uint32_t count;
+	};
+
+	struct Change
+	{
+		uint32_t revision;
+		Ref< Entity > entity;
+	};
+
 	RefArray< IWorldComponent > m_components;
 	RefArray< Entity > m_entities;
 	RefArray< Entity > m_deferredAdd;
 	RefArray< Entity > m_deferredRemove;
+	std::unordered_map< Guid, AlignedVector< Entity* >, GuidHash > m_entitiesById;
+	std::unordered_map< std::wstring, AlignedVector< Entity* > > m_entitiesByName;
+	mutable EntityTree m_entityTree;
+	mutable AlignedVector< Entity* > m_movedEntities;
+	SmallMap< const TypeInfo*, UpdateAccess > m_updateAccess;
+	AlignedVector< const TypeInfo* > m_updateTypes;
+	AlignedVector< int32_t > m_updateTypePhases;
+	AlignedVector< UpdatePhase > m_updatePhases;
+	AlignedVector< int32_t > m_updateComponentPhases;
+	AlignedVector< UpdateItem > m_updateItems;
+	AlignedVector< UpdateSpan > m_updateSpans;
+	AlignedVector< Change > m_changes;
+	mutable SpinLock m_lock;
+	int32_t m_revision = 0;
+	uint32_t m_changesRevision = 0;	//!< Changes before, or at, this revision are not known.
+	bool m_parallelUpdate = true;
 	bool m_update = false;
+
+	void insertIndices(Entity* entity);
+
+	void removeIndices(Entity* entity);
+
+	void entityMoved(Entity* entity);
+
+	/*! Record change of entity, or world if entity is null. */
+	void changed(Entity* entity);
+
+	void updateEntityTree() const;
+
+	void updateSerial(const UpdateParams& update);
+
+	void updatePhased(const UpdateParams& update);
+
+	void buildUpdatePhases();
 };
 
 }
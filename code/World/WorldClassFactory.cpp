@@ -64,6 +64,11 @@ Entity* World_getEntity_2(World* self, const std::wstring& name, int32_t index)
 	return self->getEntity(name, index);
 }
 
+RefArray< Entity > World_getEntitiesWithinRange(World* self, const Vector4& position, float range)
+{
+	return self->getEntitiesWithinRange(position, range);
+}
+
 RefArray< Entity > World_getEntities_1(World* self)
 {
 	return self->getEntities();
@@ -192,7 +197,7 @@ void WorldClassFactory::createClasses(IRuntimeClassRegistrar* registrar) const
 	classWorld->addMethod("getEntity", &World_getEntity_2);
 	classWorld->addMethod("getEntities", &World_getEntities_1);
 	classWorld->addMethod("getEntities", &World_getEntities_2);
-	classWorld->addMethod("getEntitiesWithinRange", &World::getEntitiesWithinRange);
+	classWorld->addMethod("getEntitiesWithinRange", &World_getEntitiesWithinRange);
 	registrar->registerClass(classWorld);
 
 	auto classIEntityEventInstance = new AutoRuntimeClass< IEntityEventInstance >();
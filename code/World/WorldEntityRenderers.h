@@ -46,9 +46,13 @@ public:
 
 	const RefArray< IEntityRenderer >& get() const { return m_entityRenderers; }
 
+	/*! Get revision, changes each time renderers are added or removed. */
+	uint32_t getRevision() const { return m_revision; }
+
 private:
 	RefArray< IEntityRenderer > m_entityRenderers;
 	entity_renderer_map_t m_entityRendererMap;
+	uint32_t m_revision = 0;
 };
 
 }